@@ -17,13 +17,15 @@
 #include "nrf_error.h"
 #include "ble.h"
 #include "debug.h"
+#include "wunderbar_common.h"
 #include "nordic_common.h"
 #include <stdlib.h>
 #include <string.h>
 
 #define SRV_DISC_START_HANDLE         0x0001                        /**< Start handle value used during service discovery. */
+#define SRV_DISC_END_HANDLE           0xFFFF                        /**< Last handle of attribute table, service ending with it is the last one at the peer. */
 #define DB_DISCOVERY_MAX_USERS        BLE_DB_DISCOVERY_MAX_SRV      /**< Maximum number of users/registrations allowed by this module. */
-#define DB_LOG                        debug_log                     /**< Macro used for debug logging. */
+#define DB_LOG(...)                   debug_log_module(DEBUG_MODULE_DB, DEBUG_LEVEL_INFO, __VA_ARGS__)    /**< Macro used for debug logging. */
 
 /**@brief Array of structures containing information about the registered application modules. */
 static struct
@@ -32,46 +34,9 @@ static struct
     ble_db_discovery_evt_handler_t    evt_handler;                  /**< Event handler of the application module to be called in case there are any events.*/
 } m_registered_modules[DB_DISCOVERY_MAX_USERS];
 
-/**@brief   Array of structures containing events pending to be sent to the application modules.
- *
- * @details Whenever a discovery related event is to be raised to a user module, it shall be stored
- *          first in this array. And only when all services needed to be discovered have been
- *          discovered, all pending events will be sent to the corresponding user modules.
- **/
-static struct
-{
-    ble_db_discovery_evt_t            evt;                          /**< The pending event. */
-    ble_db_discovery_evt_handler_t    evt_handler;                  /**< The event handler which should be called to raise this event. */
-} m_pending_user_evts[DB_DISCOVERY_MAX_USERS];
-
-static uint8_t                        m_pending_usr_evt_index;      /**< The index to the pending user event array pointing to the last added pending user event. */
 static uint8_t                        m_num_of_modules_reg;         /**< Number of modules registered with the DB Discovery module. */
-static uint8_t                        m_num_of_discoveries_made;    /**< Variable indicating the total number of service discoveries made at a given instant. Used by the module to determine if all required service discoveries are made. Even if a service was not present at the peer, this variable will be incremented. */
 static bool                           m_initialized = false;        /**< Variable to indicate if the module is initialized or not. */
 
-/**@brief     Function for fetching the event handler provided by a registered application module.
- *
- * @param[in] srv_uuid UUID of the service.
- *
- * @retval    Event handler of the module registered for the given service UUID.
- * @retval    NULL if no event handler is found.
- */
-static ble_db_discovery_evt_handler_t registered_handler_get(ble_uuid_t * p_srv_uuid)
-{
-    uint8_t i;
-
-    for (i = 0; i < m_num_of_modules_reg; i++)
-    {
-        if (BLE_UUID_EQ(&(m_registered_modules[i].srv_uuid), p_srv_uuid))
-        {
-            return (m_registered_modules[i].evt_handler);
-        }
-    }
-
-    return NULL;
-}
-
-
 /**@brief     Function for storing the event handler provided by a registered application module.
  *
  * @param[in] p_srv_uuid    UUID of the service.
@@ -99,187 +64,153 @@ static uint32_t registered_handler_set(const ble_uuid_t * const       p_srv_uuid
 }
 
 
-/**@brief     Function for sending all pending discovery related events to the corresponding user
- *            modules.
+/**@brief     Function for finding the registered application module interested in a service.
+ *
+ * @param[in] p_srv_uuid    UUID of the service.
+ *
+ * @return    Index of the registered module, DB_DISCOVERY_MAX_USERS if no module registered for
+ *            the service.
  */
-static void pending_user_evts_send(void)
+static uint8_t registered_module_find(const ble_uuid_t * const p_srv_uuid)
 {
     uint8_t i;
 
     for (i = 0; i < m_num_of_modules_reg; i++)
     {
-        // Pass the event to the corresponding event handler.
-        m_pending_user_evts[i].evt_handler(&(m_pending_user_evts[i].evt));
+        if (
+            (p_srv_uuid->uuid == m_registered_modules[i].srv_uuid.uuid)
+            &&
+            (p_srv_uuid->type == m_registered_modules[i].srv_uuid.type)
+           )
+        {
+            return i;
+        }
     }
-    m_pending_usr_evt_index = 0;
+    return DB_DISCOVERY_MAX_USERS;
 }
 
 
-/**@brief     Function for indicating error to the application.
- *
- * @details   This function will fetch the event handler registered by the application for the
- *            UUID of the service being discovered and send the error code to the application using
- *            the event handler. If no event handler was found, then this function will do nothing.
+/**@brief     Function for requesting discovery of all primary services starting at given handle.
  *
- * @param[in] p_db_discovery      Pointer to the DB discovery structure.
- * @param[in] err_code            Error code that should be provided to the application.
+ * @param[in] p_db_discovery    Pointer to the DB discovery structure.
+ * @param[in] start_handle      Handle to start the discovery from.
  *
+ * @return    Error code returned by the SoftDevice API @ref sd_ble_gattc_primary_services_discover.
  */
-static void discovery_error_evt_trigger(ble_db_discovery_t * const   p_db_discovery,
-                                        uint32_t                     err_code)
+static uint32_t primary_services_discover(ble_db_discovery_t * const p_db_discovery,
+                                          uint16_t                   start_handle)
 {
-    ble_db_discovery_evt_handler_t p_evt_handler;
-    ble_db_discovery_srv_t *       p_srv_being_discovered;
+    p_db_discovery->requests++;
 
-    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
+    // No UUID given, so all primary services are returned and matched against registrations.
+    return sd_ble_gattc_primary_services_discover(p_db_discovery->conn_handle,
+                                                  start_handle,
+                                                  NULL);
+}
 
-    p_evt_handler          = registered_handler_get(&(p_srv_being_discovered->srv_uuid));
 
-    if (p_evt_handler != NULL)
+/**@brief     Function for sending all pending discovery related events of a connection to the
+ *            corresponding user modules.
+ *
+ * @details   Events are built from the discovery structure of the connection at the time they
+ *            are sent. Discovered services are passed by reference, as results are written in
+ *            place into the discovery structure of the connection.
+ *
+ * @param[in] p_db_discovery      Pointer to the DB discovery structure.
+ */
+static void pending_user_evts_send(ble_db_discovery_t * const p_db_discovery)
+{
+    uint8_t                          i;
+    ble_db_discovery_evt_t           evt;
+    ble_db_discovery_pending_evt_t * p_pending_evt;
+
+    for (i = 0; i < p_db_discovery->pending_evt_count; i++)
     {
-        if (m_pending_usr_evt_index < DB_DISCOVERY_MAX_USERS)
-        {
-            // Insert a event into the pending event list.
-            m_pending_user_evts[m_pending_usr_evt_index].evt.conn_handle     =
-                                                                       p_db_discovery->conn_handle;
-            m_pending_user_evts[m_pending_usr_evt_index].evt.evt_type        =
-                                                                       BLE_DB_DISCOVERY_ERROR;
-            m_pending_user_evts[m_pending_usr_evt_index].evt.params.err_code = err_code;
-            m_pending_user_evts[m_pending_usr_evt_index].evt_handler         = p_evt_handler;
+        p_pending_evt = &(p_db_discovery->pending_evts[i]);
 
-            m_pending_usr_evt_index++;
+        evt.conn_handle = p_db_discovery->conn_handle;
+        evt.evt_type    = (ble_db_discovery_evt_type_t)p_pending_evt->evt_type;
 
-            if (m_pending_usr_evt_index == m_num_of_modules_reg)
-            {
-                // All modules registered have pending events. Send all pending events to the user
-                // modules.
-                pending_user_evts_send();
-            }
+        if (evt.evt_type == BLE_DB_DISCOVERY_COMPLETE)
+        {
+            evt.params.p_discovered_db = &(p_db_discovery->services[p_pending_evt->srv_ind]);
         }
         else
         {
-            // Too many events pending. Do nothing. Ideally this should never happen.
+            evt.params.err_code = p_db_discovery->err_code;
         }
+
+        // Pass the event to the corresponding event handler.
+        m_registered_modules[p_pending_evt->srv_ind].evt_handler(&evt);
     }
+    p_db_discovery->pending_evt_count = 0;
 }
 
 
-/**@brief     Function for triggering a Discovery Complete or Service not found event to the
- *            application.
+/**@brief     Function for adding event of the service being discovered to the pending events of
+ *            the connection.
  *
- * @details   This function will fetch the event handler registered by the application for the
- *            UUID of the service being discovered and, using it, trigger an event indicating the
- *            completion of the service discovery. If no event handler was found, then this function
- *            will do nothing.
+ * @details   Pending events are sent when all registered services have an event. Error event
+ *            ends the discovery, so it is sent together with already pending events at once.
  *
  * @param[in] p_db_discovery      Pointer to the DB discovery structure.
- * @param[in] is_srv_found        Variable to indicate if the service was found at the peer.
+ * @param[in] evt_type            Type of event.
  */
-static void discovery_complete_evt_trigger(ble_db_discovery_t * const p_db_discovery, bool is_srv_found)
+static void pending_user_evt_add(ble_db_discovery_t * const  p_db_discovery,
+                                 ble_db_discovery_evt_type_t evt_type)
 {
-    ble_db_discovery_evt_handler_t  p_evt_handler;
-    ble_db_discovery_srv_t *        p_srv_being_discovered;
-
-    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
-
-    p_evt_handler = registered_handler_get(&(p_srv_being_discovered->srv_uuid));
-
-    if (p_evt_handler != NULL)
+    if (p_db_discovery->pending_evt_count < DB_DISCOVERY_MAX_USERS)
     {
-        if (m_pending_usr_evt_index < DB_DISCOVERY_MAX_USERS)
-        {
-            // Insert a event into the pending event list.
-            m_pending_user_evts[m_pending_usr_evt_index].evt.conn_handle = p_db_discovery->conn_handle;
-
-            if (is_srv_found)
-            {
-                m_pending_user_evts[m_pending_usr_evt_index].evt.evt_type = BLE_DB_DISCOVERY_COMPLETE;
+        // Insert a event into the pending event list.
+        p_db_discovery->pending_evts[p_db_discovery->pending_evt_count].srv_ind  =
+                                                                 p_db_discovery->curr_srv_ind;
+        p_db_discovery->pending_evts[p_db_discovery->pending_evt_count].evt_type = evt_type;
 
-                m_pending_user_evts[m_pending_usr_evt_index].evt.params.discovered_db = *p_srv_being_discovered;
-            }
-            else
-            {
-                m_pending_user_evts[m_pending_usr_evt_index].evt.evt_type = BLE_DB_DISCOVERY_SRV_NOT_FOUND;
-            }
-            m_pending_user_evts[m_pending_usr_evt_index].evt_handler = p_evt_handler;
-
-            m_pending_usr_evt_index++;
-
-            if (m_pending_usr_evt_index == m_num_of_modules_reg )
-            {
-                // All modules registered have pending events. Send all pending events to the user
-                // modules.
-                DB_LOG("[DB]: All modules registered have pending events. Connection handle: %d\r\n", p_db_discovery->conn_handle);
-                pending_user_evts_send();
-            }
-            else
-            {
-                // Too many events pending. Do nothing. Ideally this should never happen.
-            }
-        }
+        p_db_discovery->pending_evt_count++;
+    }
+    else
+    {
+        // Too many events pending. Do nothing. Ideally this should never happen.
     }
 
+    if (
+        (p_db_discovery->pending_evt_count == m_num_of_modules_reg)
+        ||
+        (evt_type == BLE_DB_DISCOVERY_ERROR)
+       )
+    {
+        // All modules registered have pending events. Send all pending events to the user
+        // modules.
+        DB_LOG("[DB]: All modules registered have pending events. Connection handle: %d\r\n", p_db_discovery->conn_handle);
+        pending_user_evts_send(p_db_discovery);
+    }
 }
 
 
-/**@brief     Function for handling service discovery completion.
+/**@brief     Function for indicating error to the application.
  *
- * @details   This function will be used to determine if more services to be discovered and if so
- *            initiate the discovery of the next service.
+ * @param[in] p_db_discovery      Pointer to the DB discovery structure.
+ * @param[in] err_code            Error code that should be provided to the application.
  *
- * @param[in] p_db_discovery Pointer to the DB Discovery Structure.
  */
-static void on_srv_disc_completion(ble_db_discovery_t * p_db_discovery)
+static void discovery_error_evt_trigger(ble_db_discovery_t * const   p_db_discovery,
+                                        uint32_t                     err_code)
 {
-    m_num_of_discoveries_made++;
-
-    // Check if more services need to be discovered.
-    if (m_num_of_discoveries_made < m_num_of_modules_reg)
-    {
-        // Reset the current characteristic index since a fresh service discovery is about to start.
-        p_db_discovery->curr_char_ind = 0;
-
-        // Initiate discovery of next service.
-        p_db_discovery->curr_srv_ind++;
-
-        ble_db_discovery_srv_t * p_srv_being_discovered;
-
-        p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
-
-        p_srv_being_discovered->srv_uuid =
-                                       m_registered_modules[p_db_discovery->curr_srv_ind].srv_uuid;
-
-        // Reset the characteristic count in the current service to zero since a fresh service
-        // discovery is about to start.
-        p_srv_being_discovered->char_count = 0;
-
-        DB_LOG("[DB]: Starting discovery of service with UUID 0x%x for Connection handle %d\r\n",
-                        p_srv_being_discovered->srv_uuid.uuid, p_db_discovery->conn_handle);
-
-        uint32_t err_code;
+    p_db_discovery->err_code = err_code;
+    pending_user_evt_add(p_db_discovery, BLE_DB_DISCOVERY_ERROR);
+}
 
-        err_code = sd_ble_gattc_primary_services_discover
-                                              (
-                                               p_db_discovery->conn_handle,
-                                               SRV_DISC_START_HANDLE,
-                                               &(p_srv_being_discovered->srv_uuid)
-                                              );
-        if (err_code != NRF_SUCCESS)
-        {
-            p_db_discovery->discovery_in_progress = false;
 
-            // Indicate the error to the user application registered for the service being
-            // discovered.
-            discovery_error_evt_trigger(p_db_discovery, err_code);
-
-            return;
-        }
-    }
-    else
-    {
-        // No more service discovery needed.
-        p_db_discovery->discovery_in_progress = false;
-    }
+/**@brief     Function for triggering a Discovery Complete or Service not found event to the
+ *            application.
+ *
+ * @param[in] p_db_discovery      Pointer to the DB discovery structure.
+ * @param[in] is_srv_found        Variable to indicate if the service was found at the peer.
+ */
+static void discovery_complete_evt_trigger(ble_db_discovery_t * const p_db_discovery, bool is_srv_found)
+{
+    pending_user_evt_add(p_db_discovery,
+                         is_srv_found ? BLE_DB_DISCOVERY_COMPLETE : BLE_DB_DISCOVERY_SRV_NOT_FOUND);
 }
 
 
@@ -298,7 +229,7 @@ static void on_srv_disc_completion(ble_db_discovery_t * p_db_discovery)
  * @return    True if a characteristic discovery is required. False otherwise.
  */
 static bool is_char_discovery_reqd(ble_db_discovery_t * const p_db_discovery,
-                                   ble_gattc_char_t *         p_after_char)
+                                   ble_db_discovery_char_t *  p_after_char)
 {
     if (
         p_after_char->handle_value
@@ -317,7 +248,9 @@ static bool is_char_discovery_reqd(ble_db_discovery_t * const p_db_discovery,
 
 /**@brief   Function to find out if a descriptor discovery is required.
  *
- * @details This function finds out if there is a possibility of existence of descriptors between
+ * @details Only CCCD is searched for, so characteristics which support neither notification nor
+ *          indication need no descriptor discovery.
+ *          This function finds out if there is a possibility of existence of descriptors between
  *          current characteristic and the next characteristic. If so, this function will compute
  *          the handle range on which the descriptors may be present and will return it.
  *          If the current characteristic is the last known characteristic, then this function will
@@ -340,12 +273,22 @@ static bool is_desc_discovery_reqd(ble_db_discovery_t *       p_db_discovery,
                                    ble_db_discovery_char_t *  p_next_char,
                                    ble_gattc_handle_range_t * p_handle_range)
 {
+    if (
+        !p_curr_char->char_props.notify
+        &&
+        !p_curr_char->char_props.indicate
+       )
+    {
+        // CCCD can not be present for the current characteristic.
+        return false;
+    }
+
     if (p_next_char == NULL)
     {
         // Current characteristic is the last characteristic in the service. Check if the value
         // handle of the current characteristic is equal to the service end handle.
         if (
-            p_curr_char->characteristic.handle_value
+            p_curr_char->handle_value
             ==
             p_db_discovery->services[p_db_discovery->curr_srv_ind].handle_range.end_handle
            )
@@ -355,7 +298,7 @@ static bool is_desc_discovery_reqd(ble_db_discovery_t *       p_db_discovery,
             return false;
         }
 
-        p_handle_range->start_handle = p_curr_char->characteristic.handle_value + 1;
+        p_handle_range->start_handle = p_curr_char->handle_value + 1;
         // Since the current characteristic is the last characteristic in the service, the end
         // handle should be the end handle of the service.
         p_handle_range->end_handle   =
@@ -367,22 +310,60 @@ static bool is_desc_discovery_reqd(ble_db_discovery_t *       p_db_discovery,
     // p_next_char != NULL. Check for existence of descriptors between the current and the next
     // characteristic.
     if (
-        (p_curr_char->characteristic.handle_value + 1)
+        (p_curr_char->handle_value + 1)
          ==
-         p_next_char->characteristic.handle_decl
+         (p_next_char->handle_value - 1)
     )
     {
         // No descriptors can exist between the two characteristic.
         return false;
     }
 
-    p_handle_range->start_handle = p_curr_char->characteristic.handle_value + 1;
-    p_handle_range->end_handle   = p_next_char->characteristic.handle_decl - 1;
+    p_handle_range->start_handle = p_curr_char->handle_value + 1;
+    // Declaration of the next characteristic is placed right before its value.
+    p_handle_range->end_handle   = p_next_char->handle_value - 2;
 
     return true;
 }
 
 
+/**@brief     Function for getting the first characteristic of the pool of the connection which is
+ *            not used by services discovered before the current one.
+ *
+ * @param[in] p_db_discovery Pointer to the DB Discovery structure.
+ *
+ * @return    Pointer to the first free characteristic.
+ */
+static ble_db_discovery_char_t * char_pool_next(ble_db_discovery_t * const p_db_discovery)
+{
+    uint8_t i;
+    uint8_t used = 0;
+
+    for (i = 0; i < p_db_discovery->curr_srv_ind; i++)
+    {
+        used += p_db_discovery->services[i].char_count;
+    }
+    return &(p_db_discovery->chars[used]);
+}
+
+
+/**@brief     Function for getting the number of characteristics the current service can hold, limited
+ *            by @ref BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV and by the free part of the pool.
+ *
+ * @param[in] p_db_discovery Pointer to the DB Discovery structure.
+ *
+ * @return    Maximum number of characteristics of the current service.
+ */
+static uint8_t char_limit(ble_db_discovery_t * const p_db_discovery)
+{
+    const ble_db_discovery_srv_t * p_srv  = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
+    const uint8_t                  remain = (uint8_t)(&(p_db_discovery->chars[BLE_DB_DISCOVERY_MAX_CHAR]) -
+                                                      p_srv->charateristics);
+
+    return (remain < BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV) ? remain : BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV;
+}
+
+
 /**@brief     Function for performing characteristic discovery.
  *
  * @param[in] p_db_discovery Pointer to the DB Discovery structure.
@@ -402,12 +383,12 @@ static uint32_t characteristics_discover(ble_db_discovery_t * const p_db_discove
     {
         // This is not the first characteristic being discovered. Hence the 'start handle' to be
         // be used must be computed using the handle_value of the previous characteristic.
-        ble_gattc_char_t *       p_prev_char;
-        uint8_t                  prev_char_ind = p_db_discovery->curr_char_ind - 1;
+        ble_db_discovery_char_t * p_prev_char;
+        uint8_t                   prev_char_ind = p_db_discovery->curr_char_ind - 1;
 
         p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
 
-        p_prev_char = &(p_srv_being_discovered->charateristics[prev_char_ind].characteristic);
+        p_prev_char = &(p_srv_being_discovered->charateristics[prev_char_ind]);
 
         handle_range.start_handle = p_prev_char->handle_value + 1;
     }
@@ -419,6 +400,8 @@ static uint32_t characteristics_discover(ble_db_discovery_t * const p_db_discove
 
     handle_range.end_handle = p_srv_being_discovered->handle_range.end_handle;
 
+    p_db_discovery->requests++;
+
     return sd_ble_gattc_characteristics_discover(p_db_discovery->conn_handle,
                                                  &handle_range);
 }
@@ -513,15 +496,90 @@ static uint32_t descriptors_discover(ble_db_discovery_t * const p_db_discovery,
 
     *p_raise_discov_complete = false;
 
+    p_db_discovery->requests++;
+
     return sd_ble_gattc_descriptors_discover(p_db_discovery->conn_handle,
                                              &handle_range);
 }
 
 
+/**@brief     Function for discovering characteristics of the next service found at the peer.
+ *
+ * @details   Services are processed in order of registration, starting with the current one.
+ *            Service Not Found event is triggered for each service which was not found during
+ *            primary service discovery. If all services are processed, the discovery is finished.
+ *
+ * @param[in] p_db_discovery    Pointer to the DB discovery structure.
+ */
+static void srv_discovery_continue(ble_db_discovery_t * const p_db_discovery)
+{
+    uint32_t                 err_code;
+    ble_db_discovery_srv_t * p_srv_being_discovered;
+
+    while (p_db_discovery->curr_srv_ind < m_num_of_modules_reg)
+    {
+        p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
+
+        // Reset the characteristic index and count since a fresh service discovery is about to
+        // start.
+        p_db_discovery->curr_char_ind          = 0;
+        p_srv_being_discovered->char_count     = 0;
+        p_srv_being_discovered->charateristics = char_pool_next(p_db_discovery);
+
+        if (p_db_discovery->srv_found & (1 << p_db_discovery->curr_srv_ind))
+        {
+            DB_LOG("[DB]: Starting discovery of service with UUID 0x%x for Connection handle %d\r\n",
+                            p_srv_being_discovered->srv_uuid.uuid, p_db_discovery->conn_handle);
+
+            err_code = characteristics_discover(p_db_discovery);
+            if (err_code != NRF_SUCCESS)
+            {
+                p_db_discovery->discovery_in_progress = false;
+
+                // Indicate the error to the user application registered for the service being
+                // discovered.
+                discovery_error_evt_trigger(p_db_discovery, err_code);
+            }
+            return;
+        }
+
+        // Trigger Service Not Found event to the application.
+        discovery_complete_evt_trigger(p_db_discovery, false);
+
+        p_db_discovery->discoveries_made++;
+        p_db_discovery->curr_srv_ind++;
+    }
+
+    // No more service discovery needed.
+    p_db_discovery->discovery_in_progress = false;
+
+    DB_LOG("[DB]: Discovery finished with %d requests for Connection handle %d\r\n",
+                    p_db_discovery->requests, p_db_discovery->conn_handle);
+}
+
+
+/**@brief     Function for handling service discovery completion.
+ *
+ * @details   This function will be used to determine if there are more services to be discovered,
+ *            and if so, initiate the discovery of the next service.
+ *
+ * @param[in] p_db_discovery    Pointer to the DB Discovery structure.
+ */
+static void on_srv_disc_completion(ble_db_discovery_t * const p_db_discovery)
+{
+    p_db_discovery->discoveries_made++;
+    p_db_discovery->curr_srv_ind++;
+
+    srv_discovery_continue(p_db_discovery);
+}
+
+
 /**@brief     Function for handling primary service discovery response.
  *
- * @details   This function will handle the primary service discovery response and start the
- *            discovery of characteristics within that service.
+ * @details   This function will match the services in the response against registered services.
+ *            If the attribute table may contain more services and not all registered services
+ *            were found yet, the discovery continues after the last service in the response.
+ *            Otherwise discovery of characteristics within the found services is started.
  *
  * @param[in] p_db_discovery    Pointer to the DB Discovery structure.
  * @param[in] p_ble_gattc_evt   Pointer to the GATT Client event.
@@ -529,36 +587,66 @@ static uint32_t descriptors_discover(ble_db_discovery_t * const p_db_discovery,
 static void on_prim_srv_disc_rsp(ble_db_discovery_t * const     p_db_discovery,
                                  const ble_gattc_evt_t * const  p_ble_gattc_evt)
 {
-    if (p_ble_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS)
+    if (
+        (p_ble_gattc_evt->gatt_status == BLE_GATT_STATUS_SUCCESS)
+        &&
+        (p_ble_gattc_evt->params.prim_srvc_disc_rsp.count > 0)
+       )
     {
         uint32_t                                   err_code;
+        uint8_t                                    i;
+        uint8_t                                    srv_ind;
+        uint16_t                                   last_end_handle;
         const ble_gattc_evt_prim_srvc_disc_rsp_t * p_prim_srvc_disc_rsp_evt;
-        ble_db_discovery_srv_t *                   p_srv_being_discovered;
-
-        p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
 
         p_prim_srvc_disc_rsp_evt = &(p_ble_gattc_evt->params.prim_srvc_disc_rsp);
 
-        p_srv_being_discovered->handle_range = p_prim_srvc_disc_rsp_evt->services[0].handle_range;
-        p_srv_being_discovered->srv_uuid     = p_prim_srvc_disc_rsp_evt->services[0].uuid;
+        for (i = 0; i < p_prim_srvc_disc_rsp_evt->count; i++)
+        {
+            srv_ind = registered_module_find(&(p_prim_srvc_disc_rsp_evt->services[i].uuid));
+
+            // Only the first instance of a registered service is kept.
+            if (
+                (srv_ind < DB_DISCOVERY_MAX_USERS)
+                &&
+                ((p_db_discovery->srv_found & (1 << srv_ind)) == 0)
+               )
+            {
+                p_db_discovery->services[srv_ind].srv_uuid     =
+                                                    p_prim_srvc_disc_rsp_evt->services[i].uuid;
+                p_db_discovery->services[srv_ind].handle_range =
+                                                    p_prim_srvc_disc_rsp_evt->services[i].handle_range;
 
-        err_code = characteristics_discover(p_db_discovery);
+                p_db_discovery->srv_found |= (1 << srv_ind);
+            }
+        }
 
-        if (err_code != NRF_SUCCESS)
+        last_end_handle =
+         p_prim_srvc_disc_rsp_evt->services[p_prim_srvc_disc_rsp_evt->count - 1].handle_range.end_handle;
+
+        if (
+            (last_end_handle != SRV_DISC_END_HANDLE)
+            &&
+            (p_db_discovery->srv_found != ((1 << m_num_of_modules_reg) - 1))
+           )
         {
-            p_db_discovery->discovery_in_progress = false;
-            // Indicate the error to the user application registered for the service
-            // being discovered.
-            discovery_error_evt_trigger(p_db_discovery, err_code);
+            err_code = primary_services_discover(p_db_discovery, last_end_handle + 1);
+
+            if (err_code != NRF_SUCCESS)
+            {
+                p_db_discovery->discovery_in_progress = false;
+                // Indicate the error to the user application registered for the first service.
+                discovery_error_evt_trigger(p_db_discovery, err_code);
+            }
+            return;
         }
     }
-    else
-    {
-        // Trigger Service Not Found event to the application.
-        discovery_complete_evt_trigger(p_db_discovery, false);
 
-        on_srv_disc_completion(p_db_discovery);
-    }
+    // Primary service discovery is finished, either the end of attribute table was reached or
+    // all registered services were found.
+    p_db_discovery->curr_srv_ind = 0;
+
+    srv_discovery_continue(p_db_discovery);
 }
 
 
@@ -588,9 +676,11 @@ static void on_char_disc_rsp(ble_db_discovery_t * const     p_db_discovery,
         // Find out the number of characteristics that are discovered currently (in the
         // characteristic discovery response being handled.
         uint8_t num_chars_curr_disc = p_char_disc_rsp_evt->count;
+        // Find out the number of characteristics the service can hold.
+        uint8_t num_chars_max       = char_limit(p_db_discovery);
 
         // Check if the total number of discovered characteristics are supported by this module.
-        if ((num_chars_prev_disc + num_chars_curr_disc) <= BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV)
+        if ((num_chars_prev_disc + num_chars_curr_disc) <= num_chars_max)
         {
             // Update the characteristics count.
             p_srv_being_discovered->char_count += num_chars_curr_disc;
@@ -600,7 +690,7 @@ static void on_char_disc_rsp(ble_db_discovery_t * const     p_db_discovery,
             // The number of characteristics discovered at the peer is more than the supported
             // maximum. This module will store only the first found supported number of
             // characteristics.
-            p_srv_being_discovered->char_count = BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV;
+            p_srv_being_discovered->char_count = num_chars_max;
         }
 
         uint16_t i;
@@ -608,22 +698,21 @@ static void on_char_disc_rsp(ble_db_discovery_t * const     p_db_discovery,
 
         for (i = num_chars_prev_disc, j = 0; i < p_srv_being_discovered->char_count; i++, j++)
         {
-            p_srv_being_discovered->charateristics[i].characteristic =
-                                                                      p_char_disc_rsp_evt->chars[j];
+            ble_db_discovery_char_t * p_char = &(p_srv_being_discovered->charateristics[i]);
 
-            p_srv_being_discovered->charateristics[i].cccd_handle    = BLE_GATT_HANDLE_INVALID;
+            p_char->uuid         = p_char_disc_rsp_evt->chars[j].uuid.uuid;
+            p_char->handle_value = p_char_disc_rsp_evt->chars[j].handle_value;
+            p_char->char_props   = p_char_disc_rsp_evt->chars[j].char_props;
+            p_char->field_id     = sensor_get_char_index(p_char->uuid);
+            p_char->cccd_handle  = BLE_GATT_HANDLE_INVALID;
         }
-        
-        ble_gattc_char_t * p_last_known_char;
-        
-        p_last_known_char = &(p_srv_being_discovered->charateristics[i - 1].characteristic);
 
-        // If no more characteristic discovery is required OR if the maximum number of supported
-        // characteristic per service has been reached, perform descriptor discovery.
+        // If the maximum number of supported characteristic of the service has been reached OR if no
+        // more characteristic discovery is required, perform descriptor discovery.
         if (
-            !is_char_discovery_reqd(p_db_discovery, p_last_known_char)
+            (p_srv_being_discovered->char_count == num_chars_max)
             ||
-            (p_srv_being_discovered->char_count == BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV)
+            !is_char_discovery_reqd(p_db_discovery, &(p_srv_being_discovered->charateristics[i - 1]))
            )
         {
             perform_desc_discov = true;
@@ -782,8 +871,6 @@ uint32_t ble_db_discovery_init(ble_db_discovery_init_t * p_db_discovery_init)
 
     m_num_of_modules_reg      = 0;
     m_initialized             = true;
-    m_num_of_discoveries_made = 0;
-    m_pending_usr_evt_index   = 0;
 
     return NRF_SUCCESS;
 }
@@ -793,8 +880,6 @@ uint32_t ble_db_discovery_close()
 {
     m_num_of_modules_reg      = 0;
     m_initialized             = false;
-    m_num_of_discoveries_made = 0;
-    m_pending_usr_evt_index   = 0;
 
     return NRF_SUCCESS;
 }
@@ -847,26 +932,30 @@ uint32_t ble_db_discovery_start(ble_db_discovery_t * const p_db_discovery,
         return NRF_ERROR_BUSY;
     }
 
-    ble_db_discovery_srv_t * p_srv_being_discovered;
+    uint8_t i;
 
-    m_num_of_discoveries_made             = 0;
-    m_pending_usr_evt_index               = 0;
+    p_db_discovery->discoveries_made      = 0;
+    p_db_discovery->pending_evt_count     = 0;
+    p_db_discovery->srv_found             = 0;
+    p_db_discovery->requests              = 0;
 
     p_db_discovery->curr_srv_ind          = 0;
+    p_db_discovery->curr_char_ind         = 0;
     p_db_discovery->conn_handle           = conn_handle;
 
-    p_srv_being_discovered = &(p_db_discovery->services[p_db_discovery->curr_srv_ind]);
+    for (i = 0; i < m_num_of_modules_reg; i++)
+    {
+        p_db_discovery->services[i].srv_uuid       = m_registered_modules[i].srv_uuid;
+        p_db_discovery->services[i].char_count     = 0;
+        p_db_discovery->services[i].charateristics = p_db_discovery->chars;
+    }
+
+    DB_LOG("[DB]: Starting discovery of primary services for Connection handle %d\r\n",
+                    p_db_discovery->conn_handle);
 
-    p_srv_being_discovered->srv_uuid = m_registered_modules[p_db_discovery->curr_srv_ind].srv_uuid;
-    
-    DB_LOG("[DB]: Starting discovery of service with UUID 0x%x for Connection handle %d\r\n",
-                    p_srv_being_discovered->srv_uuid.uuid, p_db_discovery->conn_handle);
-    
     uint32_t err_code;
 
-    err_code = sd_ble_gattc_primary_services_discover(p_db_discovery->conn_handle,
-                                                      SRV_DISC_START_HANDLE,
-                                                      &(p_srv_being_discovered->srv_uuid));
+    err_code = primary_services_discover(p_db_discovery, SRV_DISC_START_HANDLE);
     if (err_code != NRF_SUCCESS)
     {
         return err_code;
@@ -24,11 +24,17 @@
  *           @image html db_discovery.jpg
  *
  * @warning  The maximum number of characteristics per service that can be discovered by this module
- *           is indicated by the value of @ref BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV. If the peer
+ *           is indicated by the value of @ref BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV, and all services
+ *           of a connection share @ref BLE_DB_DISCOVERY_MAX_CHAR characteristics. If the peer
  *           has more than the supported number of characteristics, then the first found supported
  *           number of characteristics will only be discovered. Also no descriptors other than
  *           Client Characteristic Configuration Descriptors will be searched for at the peer.
  *
+ * @note     All primary services are discovered at once over the whole handle range and matched
+ *           against registered services. Characteristics are then discovered within the handle
+ *           range of each found service, and descriptors are searched for only where the
+ *           characteristic supports notification or indication.
+ *
  * @note     Presently only one instance of Primary Service can be discovered by this module. If
  *           there are multiple instances of the service at the peer, only the first instance
  *           of it at the peer is fetched and returned to the application.
@@ -52,8 +58,9 @@
  * @{
  */
 
-#define BLE_DB_DISCOVERY_MAX_SRV             3                                               /**< Maximum number of services supported by this module. This also indicates the maximum number of users allowed to be registered to this module (one user per service). */
+#define BLE_DB_DISCOVERY_MAX_SRV             4                                               /**< Maximum number of services supported by this module. This also indicates the maximum number of users allowed to be registered to this module (one user per service). */
 #define BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV    7                                               /**< Maximum number of characteristics per service supported by this module. */
+#define BLE_DB_DISCOVERY_MAX_CHAR            11                                              /**< Maximum number of characteristics of all services of one connection: Relayr service, battery level and three device information strings. */
 
 /** @} */
 
@@ -78,15 +85,22 @@ typedef enum
  * @{
  */
 
+#define BLE_DB_DISCOVERY_FIELD_ID_UNKNOWN    0xFF                                            /**< Field ID of characteristic which is not in the list of sensor characteristics. */
+
 /**@brief Structure for holding the characteristic and the handle of its CCCD found during the
  *        discovery process.
-
-*/
+ *
+ * @details Only the part of @ref ble_gattc_char_t used by the application is kept. Declaration
+ *          handle is not stored, as it always precedes the value handle.
+ */
 typedef struct
 {
-    ble_gattc_char_t               characteristic;                                           /**< Structure containing information about the characteristic. */
+    uint16_t                       uuid;                                                     /**< 16-bit UUID of the characteristic. */
+    uint16_t                       handle_value;                                             /**< Handle of the characteristic value. */
     uint16_t                       cccd_handle;                                              /**< CCCD Handle value for this characteristic. This will be set to BLE_GATT_HANDLE_INVALID if a CCCD is not present at the server. */
-} ble_db_discovery_char_t;
+    uint8_t                        field_id;                                                 /**< Field ID of the characteristic used in SPI frames, @ref BLE_DB_DISCOVERY_FIELD_ID_UNKNOWN if not known. */
+    ble_gatt_char_props_t          char_props;                                               /**< Characteristic properties. */
+} __attribute__((packed)) ble_db_discovery_char_t;
 
 /**@brief Structure for holding information about the service and the characteristics found during
  *        the discovery process.
@@ -95,10 +109,21 @@ typedef struct
 {
     ble_uuid_t                     srv_uuid;                                                 /**< UUID of the service. */    
     uint8_t                        char_count;                                               /**< Number of characteristics present in the service. */
-    ble_db_discovery_char_t        charateristics[BLE_DB_DISCOVERY_MAX_CHAR_PER_SRV];        /**< The array of information related to the characteristics present in the service. */
+    ble_db_discovery_char_t *      charateristics;                                           /**< Characteristics present in the service, part of the pool of the connection. */
     ble_gattc_handle_range_t       handle_range;                                             /**< Service Handle Range. */
 } ble_db_discovery_srv_t;
 
+/**@brief   Structure for holding discovery event which is waiting to be sent to the application.
+ *
+ * @details Only the type of the event and the index of the service (which is also index of the
+ *          registered user module) are kept. The event itself is built when it is sent.
+ */
+typedef struct
+{
+    uint8_t                        srv_ind;                                                  /**< Index of the service and of the registered user module. */
+    uint8_t                        evt_type;                                                 /**< Type of event, see @ref ble_db_discovery_evt_type_t. */
+} ble_db_discovery_pending_evt_t;
+
 /**@brief   Structure for holding the information related to the GATT database at the server.
  *
  * @details This structure will be used to identify an instance of this module. For example, there
@@ -109,11 +134,18 @@ typedef struct
 typedef struct
 {
     ble_db_discovery_srv_t         services[BLE_DB_DISCOVERY_MAX_SRV];                       /**< Information related to the current service being discovered. This is intended for internal use during service discovery.*/
+    ble_db_discovery_char_t        chars[BLE_DB_DISCOVERY_MAX_CHAR];                         /**< Pool of characteristics, services take their characteristics from it back to back in order of discovery. */
     uint16_t                       conn_handle;                                              /**< Connection handle as provided by the SoftDevice. */
     uint8_t                        srv_count;                                                /**< Number of services at the peers GATT database.*/
     uint8_t                        curr_char_ind;                                            /**< Index of the current characteristic being discovered. This is intended for internal use during service discovery.*/
     uint8_t                        curr_srv_ind;                                             /**< Index of the current service being discovered. This is intended for internal use during service discovery.*/
     bool                           discovery_in_progress;     /**< Variable to indicate if there is a service discovery in progress. */
+    uint8_t                        discoveries_made;                                         /**< Number of service discoveries made on this connection, including services not found at the peer. */
+    uint8_t                        srv_found;                                                /**< Bit mask of registered services found during primary service discovery, bit n for services[n]. */
+    uint8_t                        requests;                                                 /**< Number of GATT discovery requests issued by the current discovery. */
+    uint8_t                        pending_evt_count;                                        /**< Number of events in pending_evts. */
+    ble_db_discovery_pending_evt_t pending_evts[BLE_DB_DISCOVERY_MAX_SRV];                   /**< Events waiting until all registered services of this connection are discovered. */
+    uint32_t                       err_code;                                                 /**< Error code of the last BLE_DB_DISCOVERY_ERROR event. */
 } ble_db_discovery_t;
 
 
@@ -125,7 +157,7 @@ typedef struct
     uint16_t                       conn_handle;                                               /**< Handle of the connection for which this event has occurred. */
     union
     {   
-        ble_db_discovery_srv_t     discovered_db;                                             /**< Structure containing the information about the GATT Database at the server. This will be filled when the event type is @ref BLE_DB_DISCOVERY_COMPLETE.*/     
+        const ble_db_discovery_srv_t * p_discovered_db;                                       /**< Pointer to the discovered service in the DB Discovery structure of the connection. This will be filled when the event type is @ref BLE_DB_DISCOVERY_COMPLETE.*/
         uint32_t                   err_code;                                                  /**< nRF Error code indicating the type of error occurred in the DB Discovery module. This will be filled when the event type is @ref BLE_DB_DISCOVERY_ERROR. */
     } params;
 } ble_db_discovery_evt_t;
@@ -13,18 +13,26 @@
 #include "nrf_error.h"
 #include "nrf_soc.h"
 #include "onboard.h"
+#include "sensor_slots.h"
+#include "debug.h"
+#include "work_flags.h"
 #include <string.h>
 
+#define PS_LOG(...)                       debug_log_module(DEBUG_MODULE_PS, DEBUG_LEVEL_ERROR, __VA_ARGS__)   /**< Debug logger macro used for error messages. */
+#define PS_LOG_INFO(...)                  debug_log_module(DEBUG_MODULE_PS, DEBUG_LEVEL_INFO, __VA_ARGS__)    /**< Debug logger macro used for load and store results. */
+#define PS_LOG_VERBOSE(...)               debug_log_module(DEBUG_MODULE_PS, DEBUG_LEVEL_VERBOSE, __VA_ARGS__) /**< Debug logger macro used for storing state transitions. */
+
 #define PSTORAGE_DRIVER_MAGIC_NUM         0x45DEAAAA  /**< Value which will be written at the end of block in persistent memory. Used to check validity of store operation. */
-#define PSTORAGE_DRIVER_NUM_OF_BLOCKS     7           /**< Number of blocks requested by the module. */
+#define PSTORAGE_DRIVER_NUM_OF_BLOCKS     (6 + SENSOR_SLOTS_NUM + 1)  /**< Number of blocks requested by the module. 6 passkeys, sensor instance slots and spare block. */
 #define PSTORAGE_NUMBER_OF_STORE_STATES   4           /**< Number of states in storing process. */
 
+_Static_assert(PSTORAGE_DRIVER_NUM_OF_BLOCKS <= 32, "Blocks of 32 bytes do not fit one flash page");
+
 /**@brief  This record used to identify block into persistent memory by address of buffer RAM. */
 typedef struct 
 {
     uint8_t *          data;                                         /**< Pointer to data buffer. */
-    uint16_t           size;                                         /**< Size of data buffer. */
-    pstorage_handle_t  block_id;                                     /**< Block identifier to identify persistent memory blocks. */
+    uint16_t           size;                                         /**< Size of data buffer. Block identifier follows from index of the record. */
 } 
 pstorage_driver_block_t;
 
@@ -77,6 +85,7 @@ static void pstorage_driver_set_next_state(void);
 static void pstorage_driver_set_idle_state(void);
 static void pstorage_driver_update_store_status(void);
 static pstorage_driver_block_t * pstorage_driver_get_block(uint8_t * data);
+static uint32_t pstorage_driver_get_block_id(pstorage_driver_block_t * block, pstorage_handle_t * block_id);
 static void pstorage_driver_cb_handler(pstorage_handle_t * handle, uint8_t op_code, uint32_t result, uint8_t * p_data, uint32_t data_len);
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -107,6 +116,10 @@ bool pstorage_driver_cfg(uint16_t block_size)
     
 	  // Register with persistent storage interface.
     err_code = pstorage_register(&pstorage_driver.module_param, &pstorage_driver.base_id);
+    if (err_code != NRF_SUCCESS)
+    {
+        PS_LOG("[PS]: Register failed, error 0x%X\r\n", err_code);
+    }
     return (err_code == NRF_SUCCESS) ? true : false;
 }
 
@@ -123,15 +136,17 @@ bool pstorage_driver_cfg(uint16_t block_size)
 
 bool pstorage_driver_register_block(uint8_t * data, uint16_t size) 
 {
-    uint32_t err_code;
+    uint32_t          err_code;
+    pstorage_handle_t block_id;
     
     pstorage_driver.block[num_of_reg_blocks].data = data;  // Set data field of current block (which is determined by value of num_of_reg_blocks).
     pstorage_driver.block[num_of_reg_blocks].size = size;  // Set size field of current block (which is determined by value of num_of_reg_blocks).
     
 	  // Function to get block id with reference to base block id and current block (which is determined by value of num_of_reg_blocks).
-    err_code = pstorage_block_identifier_get(&pstorage_driver.base_id, num_of_reg_blocks, &pstorage_driver.block[num_of_reg_blocks].block_id);
+    err_code = pstorage_driver_get_block_id(&pstorage_driver.block[num_of_reg_blocks], &block_id);
     if (err_code != NRF_SUCCESS) 
     {
+        PS_LOG("[PS]: Block %d identifier failed, error 0x%X\r\n", num_of_reg_blocks, err_code);
         return false;
     }
 		
@@ -155,18 +170,25 @@ uint32_t pstorage_driver_load(uint8_t * dest_data)
     uint32_t err_code;
     uint16_t tmp_size;
     pstorage_driver_block_t * block;
+    pstorage_handle_t block_id;
    
     // Get pstorage_driver block, based on address of data.	
     block = pstorage_driver_get_block(dest_data);
     if(block == NULL) 
     {
+        PS_LOG("[PS]: Load of unregistered block\r\n");
         return PS_LOAD_STATUS_NOT_FOUND;                                       // Block with corresponding data not registered.
     }
     
     // Load persistently stored data.
-    err_code = pstorage_load(dest_data, &block->block_id, block->size, 0);
+    err_code = pstorage_driver_get_block_id(block, &block_id);
+    if(err_code == NRF_SUCCESS) 
+    {
+        err_code = pstorage_load(dest_data, &block_id, block->size, 0);
+    }
     if(err_code != NRF_SUCCESS) 
     {
+        PS_LOG("[PS]: Load of block %d failed, error 0x%X\r\n", (int)(block - pstorage_driver.block), err_code);
         return PS_LOAD_STATUS_FAIL;
     }
     
@@ -182,16 +204,19 @@ uint32_t pstorage_driver_load(uint8_t * dest_data)
     }
     
 		// Load persistently stored data. 
-    err_code = pstorage_load((uint8_t *)&tmp_magic_number, &block->block_id, 4, tmp_size);
+    err_code = pstorage_load((uint8_t *)&tmp_magic_number, &block_id, 4, tmp_size);
     if(err_code != NRF_SUCCESS) 
     {
+        PS_LOG("[PS]: Load of block %d magic failed, error 0x%X\r\n", (int)(block - pstorage_driver.block), err_code);
         return PS_LOAD_STATUS_FAIL;
     }
     else if(tmp_magic_number != PSTORAGE_DRIVER_MAGIC_NUM) 
     {
+        PS_LOG_INFO("[PS]: Block %d empty\r\n", (int)(block - pstorage_driver.block));
         return PS_LOAD_STATUS_EMPTY;                                           // Can be considered that the corresponding block is empty.
     }
     
+    PS_LOG_VERBOSE("[PS]: Block %d loaded\r\n", (int)(block - pstorage_driver.block));
     return PS_LOAD_STATUS_SUCCESS;
 }
 
@@ -228,6 +253,7 @@ bool pstorage_driver_request_store(uint8_t * source_data)
     // Return if storing is already in progress.	
     if(pstorage_driver_store.run_flag == true) 
     {
+        PS_LOG_INFO("[PS]: Store rejected, busy\r\n");
         return false;
     }
     
@@ -235,11 +261,14 @@ bool pstorage_driver_request_store(uint8_t * source_data)
     block = pstorage_driver_get_block(source_data);
     if(block == NULL) 
     {
+        PS_LOG("[PS]: Store of unregistered block\r\n");
         return false;
     }
     
+    PS_LOG_INFO("[PS]: Store of block %d started\r\n", (int)(block - pstorage_driver.block));
     pstorage_driver_store.block = block;
     pstorage_driver_store.run_flag = true;
+    work_flags_set(WORK_FLAG_PSTORAGE);
     
     return true;
 }
@@ -254,7 +283,8 @@ bool pstorage_driver_request_store(uint8_t * source_data)
 
 void pstorage_driver_run(void) 
 {
-    uint32_t err_code;
+    uint32_t          err_code;
+    pstorage_handle_t block_id;
 
     // Check whether the currently waiting for pstorage event.	
     if(pstorage_driver_store.wait_flag) 
@@ -291,7 +321,11 @@ void pstorage_driver_run(void)
             
             // Start storing "clear" value.
             tmp_magic_number = 0xFFFFFFFF;
-            err_code = pstorage_update(&pstorage_driver_store.block->block_id, (uint8_t *)&tmp_magic_number, 4, tmp_size);
+            err_code = pstorage_driver_get_block_id(pstorage_driver_store.block, &block_id);
+            if(err_code == NRF_SUCCESS) 
+            {
+                err_code = pstorage_update(&block_id, (uint8_t *)&tmp_magic_number, 4, tmp_size);
+            }
             if(err_code != NRF_SUCCESS) 
             {
                 // Stop storing process.
@@ -316,7 +350,11 @@ void pstorage_driver_run(void)
             } 
             
             // Start storing data.
-            err_code = pstorage_update(&pstorage_driver_store.block->block_id, pstorage_driver_store.block->data, tmp_size, 0);
+            err_code = pstorage_driver_get_block_id(pstorage_driver_store.block, &block_id);
+            if(err_code == NRF_SUCCESS) 
+            {
+                err_code = pstorage_update(&block_id, pstorage_driver_store.block->data, tmp_size, 0);
+            }
             if(err_code != NRF_SUCCESS) 
             {
                 // Stop storing process.
@@ -341,7 +379,11 @@ void pstorage_driver_run(void)
             }
             tmp_magic_number = PSTORAGE_DRIVER_MAGIC_NUM;
             // Start storing PSTORAGE_DRIVER_MAGIC_NUM value.
-            err_code = pstorage_update(&pstorage_driver_store.block->block_id, (uint8_t *)&tmp_magic_number, 4, tmp_size);
+            err_code = pstorage_driver_get_block_id(pstorage_driver_store.block, &block_id);
+            if(err_code == NRF_SUCCESS) 
+            {
+                err_code = pstorage_update(&block_id, (uint8_t *)&tmp_magic_number, 4, tmp_size);
+            }
             if(err_code != NRF_SUCCESS) 
             {
                 // Stop storing process.
@@ -380,6 +422,7 @@ static void pstorage_driver_set_next_state(void)
 {
     // Calculate value of next state.
     pstorage_driver_store.state = (pstorage_driver_store_state_t)((uint8_t)(pstorage_driver_store.state + 1) % PSTORAGE_NUMBER_OF_STORE_STATES);
+    PS_LOG_VERBOSE("[PS]: Store state %d\r\n", pstorage_driver_store.state);
   
     // If changed state is STORE_STATE_IDLE update value of run_flag field.
     if(pstorage_driver_store.state == STORE_STATE_IDLE) 
@@ -412,9 +455,26 @@ static void pstorage_driver_set_idle_state(void)
 
 static void pstorage_driver_update_store_status(void) 
 {
+    PS_LOG("[PS]: Store failed in state %d\r\n", pstorage_driver_store.state);
     pstorage_driver_store.error_status = pstorage_driver_store.state;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/** @brief  Get identifier of persistent memory block, from index of its record.
+ *
+ *  @param  block     Block record.
+ *  @param  block_id  Block identifier.
+ *
+ *  @return NRF_SUCCESS, or error code of pstorage_block_identifier_get().
+ */
+
+static uint32_t pstorage_driver_get_block_id(pstorage_driver_block_t * block, pstorage_handle_t * block_id) 
+{
+    return pstorage_block_identifier_get(&pstorage_driver.base_id, (pstorage_size_t)(block - pstorage_driver.block), block_id);
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -466,16 +526,22 @@ static void pstorage_driver_cb_handler(pstorage_handle_t * handle, uint8_t op_co
                 // Check if there is reached idle state of storing process, and cleared run_flag.
                 if(pstorage_driver_get_run_status() == false)
                 {
+                    PS_LOG_INFO("[PS]: Store complete\r\n");
                     onboard_on_store_complete(); 
                 }
             }
             else 
             {
+                PS_LOG("[PS]: Flash operation failed, result 0x%X\r\n", result);
                 // Stop storing process.
                 pstorage_driver_update_store_status();
                 pstorage_driver_set_idle_state();
             }
             pstorage_driver_store.wait_flag = false;
+            if(pstorage_driver_store.run_flag)
+            {
+                work_flags_set(WORK_FLAG_PSTORAGE);
+            }
             break;
         }
     }
@@ -0,0 +1,54 @@
+/** @file   bench.h
+ *  @brief  Benchmark scenarios of the host build. Every scenario runs in its own
+ *          process on a simulator seeded with SIM_SEED (default 1), results of
+ *          all scenarios are written to stdout as one JSON document.
+ *
+ *  @details Scenario sets sensors and firmware up, then measures a window of
+ *           traffic between bench_measure_start() and bench_measure_stop():
+ *           - frames received by the host and DATA_R frames per second,
+ *           - frames written, overwritten and dropped by spi_create_tx_packet(),
+ *           - host CPU time per BLE/SoC event, SPI interrupt, timer interrupt and
+ *             main loop wakeup, and longest run of each interrupt handler,
+ *           - latency from generation of DATA_R value on the sensor to end of
+ *             SPI transaction which delivered it, as percentiles.
+ *           Counts depend on the seed only, CPU times are measured with host
+ *           thread clock and vary between runs and machines.
+ *           Run "host_build/host_bench [name filter]".
+ */
+
+#ifndef BENCH_H__
+#define BENCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim.h"
+
+#define BENCH_TIMEOUT_S    300
+#define BENCH_METRICS_MAX  64
+
+typedef void (*bench_scenario_t)(void);
+
+void bench_register(const char * p_name, bench_scenario_t scenario);
+
+/**@brief Define scenario, registered before main() runs. */
+#define BENCH(name)                                                             \
+    static void name(void);                                                     \
+    __attribute__((constructor)) static void name##_register(void)              \
+    {                                                                           \
+        bench_register(#name, name);                                            \
+    }                                                                           \
+    static void name(void)
+
+/**@brief Clear counters and start measured window. Kinetis frame handler is taken until the window ends. */
+void bench_measure_start(void);
+
+/**@brief End measured window and record its metrics. */
+void bench_measure_stop(void);
+
+/**@brief Record metric specific to scenario. Metric recorded again is overwritten. */
+void bench_metric(const char * p_name, double value);
+
+/**@brief Write recorded metrics as JSON object members. */
+void bench_metrics_print(void);
+
+#endif // BENCH_H__
@@ -0,0 +1,124 @@
+/** @file   bench_adv_ingest.c
+ *  @brief  Throughput of the advertising report path: HTU and MIC carrying their
+ *          values in advertising packets at several rates, alone and among fast
+ *          foreign advertisers, against the same sensors connected.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+
+#define BENCH_ADV_INGEST_WINDOW_US    SIM_S(60)
+#define BENCH_ADV_INGEST_SETTLE_US    SIM_S(5)
+#define BENCH_ADV_INGEST_NOISE        24
+#define BENCH_ADV_INGEST_NOISE_MS     20
+
+/**@brief Sensor types whose value fits advertising packet with their name. */
+static const data_id_t bench_adv_ingest_types[] = { DATA_ID_DEV_HTU, DATA_ID_DEV_SOUND };
+
+#define BENCH_ADV_INGEST_TYPES        (sizeof(bench_adv_ingest_types) / sizeof(bench_adv_ingest_types[0]))
+
+/**@brief Run sensors for measured window.
+ *
+ * @param[in] ingest     Forward values from advertising packets, otherwise connect sensors.
+ * @param[in] adv_ms     Advertising interval of sensors.
+ * @param[in] notify_ms  Period of new value.
+ * @param[in] noise      Number of foreign advertisers.
+ */
+
+static void bench_adv_ingest_run(bool ingest, uint32_t adv_ms, uint32_t notify_ms, uint8_t noise)
+{
+    sim_sensor_t * p_sensors[BENCH_ADV_INGEST_TYPES];
+    uint32_t       values      = 0;
+    uint32_t       forwarded   = 0;
+    uint32_t       connections = 0;
+    stats_block_t  stats;
+    size_t         from;
+    uint8_t        index;
+
+    for(index = 0; index < BENCH_ADV_INGEST_TYPES; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(bench_adv_ingest_types[index]);
+
+        cfg.adv_data           = ingest;
+        cfg.adv_interval_ms    = adv_ms;
+        cfg.notify_interval_ms = notify_ms;
+        p_sensors[index]       = sim_sensor_add(&cfg);
+    }
+    for(index = 0; index < noise; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        cfg.mode            = SIM_SENSOR_NOISE;
+        cfg.p_name          = "Foreign";
+        cfg.adv_interval_ms = BENCH_ADV_INGEST_NOISE_MS;
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    for(index = 0; ingest && (index < BENCH_ADV_INGEST_TYPES); index++)
+    {
+        sim_fixture_set_adv_ingest(bench_adv_ingest_types[index], true);
+        sim_run_for(SIM_MS(20));
+    }
+    sim_fixture_run();
+    if( (ingest == false) && (sim_fixture_wait_all_running(SIM_S(60)) == false) )
+    {
+        sim_fail("sensors not running");
+    }
+    sim_run_for(BENCH_ADV_INGEST_SETTLE_US);
+    sim_fixture_read_stats(&stats, true);
+
+    for(index = 0; index < BENCH_ADV_INGEST_TYPES; index++)
+    {
+        values -= sim_sensor_stats(p_sensors[index])->values;
+    }
+    from = sim_kinetis_frame_count();
+
+    bench_measure_start();
+    sim_run_for(BENCH_ADV_INGEST_WINDOW_US);
+    bench_measure_stop();
+
+    for(index = 0; index < BENCH_ADV_INGEST_TYPES; index++)
+    {
+        values      += sim_sensor_stats(p_sensors[index])->values;
+        forwarded   += sim_fixture_check_values(bench_adv_ingest_types[index], from);
+        connections += sim_sensor_stats(p_sensors[index])->connections;
+    }
+    sim_fixture_read_stats(&stats, true);
+
+    bench_metric("adv_reports_per_s", (double)sim_softdevice_stats()->adv_reports * SIM_US_PER_S / BENCH_ADV_INGEST_WINDOW_US);
+    bench_metric("adv_reports_dropped", sim_softdevice_stats()->adv_reports_dropped);
+    bench_metric("values_forwarded_per_s", (double)forwarded * SIM_US_PER_S / BENCH_ADV_INGEST_WINDOW_US);
+    bench_metric("values_forwarded_ratio", (values != 0) ? ((double)forwarded / values) : 0);
+    bench_metric("adv_ingested", stats.adv_ingested);
+    bench_metric("sensor_connections", connections);
+    bench_metric("radio_ms_per_s", (double)(sim_softdevice_stats()->scan_us + sim_softdevice_stats()->initiator_us + sim_softdevice_stats()->conn_event_us) /
+                                   SIM_US_PER_MS * SIM_US_PER_S / BENCH_ADV_INGEST_WINDOW_US);
+}
+
+BENCH(adv_ingest_100ms)
+{
+    bench_adv_ingest_run(true, 100, 1000, 0);
+}
+
+BENCH(adv_ingest_20ms_fast_values)
+{
+    bench_adv_ingest_run(true, 20, 100, 0);
+}
+
+BENCH(adv_ingest_20ms_fast_values_noise)
+{
+    bench_adv_ingest_run(true, 20, 100, BENCH_ADV_INGEST_NOISE);
+}
+
+BENCH(adv_connected_fast_values)
+{
+    bench_adv_ingest_run(false, 100, 100, 0);
+}
+
+BENCH(adv_connected_fast_values_noise)
+{
+    bench_adv_ingest_run(false, 100, 100, BENCH_ADV_INGEST_NOISE);
+}
@@ -0,0 +1,136 @@
+/** @file   bench_adv_inventory.c
+ *  @brief  Cost of advertiser inventory update per advertising report: host CPU
+ *          time of adv_inventory_seen() when the advertiser is found first, last
+ *          or not at all in a full table, and advertising report handling with
+ *          the inventory among growing numbers of foreign advertisers, with the
+ *          time a dump of the table takes over SPI. Firmware runs in zero virtual
+ *          time, so RTC1 ticks of STATS_PATH_ADV_INVENTORY stay 0 on host.
+ */
+
+/* -- Includes -- */
+
+#include <time.h>
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+
+#define BENCH_ADV_INVENTORY_CALLS      1000000
+#define BENCH_ADV_INVENTORY_WINDOW_US  SIM_S(60)
+#define BENCH_ADV_INVENTORY_NOISE_MS   20
+
+static uint64_t bench_adv_inventory_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**@brief Call adv_inventory_seen() directly, cycling through advertisers.
+ *
+ * @param[in] known    Advertisers in the table before measurement.
+ * @param[in] cycled   Advertisers reported in turn, more than ADV_INVENTORY_SIZE evicts on every report.
+ * @param[in] first    Report the advertiser in the first entry only.
+ */
+
+static void bench_adv_inventory_direct(uint8_t known, uint8_t cycled, bool first)
+{
+    ble_gap_addr_t addr = { .addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC, .addr = { 0x10, 0x20, 0x30, 0x40, 0x50, 0xC0 } };
+    uint64_t       start;
+    uint32_t       call;
+
+    sim_fixture_boot();
+    adv_inventory_init();
+    for(addr.addr[0] = 0; addr.addr[0] < known; addr.addr[0]++)
+    {
+        adv_inventory_seen(&addr, DATA_ID_DEV_HTU, -60);
+    }
+
+    start = bench_adv_inventory_ns();
+    for(call = 0; call < BENCH_ADV_INVENTORY_CALLS; call++)
+    {
+        addr.addr[0] = first ? 0 : (uint8_t)(call % cycled);
+        adv_inventory_seen(&addr, DATA_ID_DEV_HTU, (int8_t)(-60 - (call & 7)));
+    }
+    bench_metric("ns_per_report", (double)(bench_adv_inventory_ns() - start) / BENCH_ADV_INVENTORY_CALLS);
+    bench_metric("table_size", ADV_INVENTORY_SIZE);
+    bench_metric("advertisers", first ? 1 : cycled);
+}
+
+/**@brief Six sensors and foreign advertisers around the master, window covers bring-up.
+ *
+ * @param[in] noise  Number of foreign advertisers.
+ */
+
+static void bench_adv_inventory_sim(uint8_t noise)
+{
+    adv_inventory_record_t records[ADV_INVENTORY_SIZE];
+    stats_block_t          stats;
+    data_id_t              type;
+    uint64_t               start;
+    uint8_t                count;
+    uint8_t                index;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+        (void)sim_sensor_add(&cfg);
+    }
+    for(index = 0; index < noise; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        cfg.mode            = SIM_SENSOR_NOISE;
+        cfg.p_name          = "Foreign";
+        cfg.adv_interval_ms = BENCH_ADV_INVENTORY_NOISE_MS;
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_read_stats(&stats, true);
+
+    bench_measure_start();
+    sim_fixture_run();
+    sim_run_for(BENCH_ADV_INVENTORY_WINDOW_US);
+    bench_measure_stop();
+    sim_fixture_read_stats(&stats, true);
+
+    start = sim_now();
+    count = sim_fixture_read_inventory(records);
+
+    bench_metric("advertisers", (DATA_ID_DEV_IR + 1) + noise);
+    bench_metric("adv_reports_per_s", (double)sim_softdevice_stats()->adv_reports * SIM_US_PER_S / BENCH_ADV_INVENTORY_WINDOW_US);
+    bench_metric("inventory_updates", stats.path[STATS_PATH_ADV_INVENTORY].count);
+    bench_metric("dump_records", count);
+    bench_metric("dump_ms", (double)(sim_now() - start) / SIM_US_PER_MS);
+}
+
+BENCH(adv_inventory_seen_first_entry)
+{
+    bench_adv_inventory_direct(ADV_INVENTORY_SIZE, 1, true);
+}
+
+BENCH(adv_inventory_seen_full_table)
+{
+    bench_adv_inventory_direct(ADV_INVENTORY_SIZE, ADV_INVENTORY_SIZE, false);
+}
+
+BENCH(adv_inventory_seen_evicting)
+{
+    bench_adv_inventory_direct(ADV_INVENTORY_SIZE, 2 * ADV_INVENTORY_SIZE, false);
+}
+
+BENCH(adv_inventory_noise_0)
+{
+    bench_adv_inventory_sim(0);
+}
+
+BENCH(adv_inventory_noise_8)
+{
+    bench_adv_inventory_sim(8);
+}
+
+BENCH(adv_inventory_noise_24)
+{
+    bench_adv_inventory_sim(24);
+}
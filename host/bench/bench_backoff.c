@@ -0,0 +1,122 @@
+/** @file   bench_backoff.c
+ *  @brief  Radio time and connection attempts wasted on a sensor with wrong
+ *          passkey, with peer backoff and with failure records cleared every
+ *          scan interval, which retries the sensor at once like the master did
+ *          before backoff. Healthy sensors around it show what the attempts
+ *          cost them.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "peer_backoff.h"
+
+#define BENCH_BACKOFF_WINDOW_US    SIM_S(600)
+#define BENCH_BACKOFF_CLEAR_US     SIM_MS(220)    /**< Scan interval. */
+#define BENCH_BACKOFF_HEALTHY      (DATA_ID_DEV_IR)
+
+static sim_event_t * bench_backoff_clear_event;
+
+static void bench_backoff_clear(void * p_ctx)
+{
+    (void)p_ctx;
+    peer_backoff_reset();
+    bench_backoff_clear_event = sim_schedule_in(BENCH_BACKOFF_CLEAR_US, bench_backoff_clear, NULL);
+}
+
+/**@brief Misconfigured HTU and healthy sensors of other types run for measured window.
+ *
+ * @param[in] backoff  Hold back failed peer, otherwise failure records are cleared.
+ * @param[in] healthy  Number of healthy sensors.
+ */
+
+static void bench_backoff_run(bool backoff, uint8_t healthy)
+{
+    const sim_softdevice_stats_t * p_sd = sim_softdevice_stats();
+    sim_sensor_t                 * p_bad;
+    sim_sensor_t                 * p_healthy[BENCH_BACKOFF_HEALTHY];
+    uint32_t                       values   = 0;
+    uint32_t                       received = 0;
+    uint64_t                       radio_us;
+    stats_block_t                  stats;
+    uint8_t                        index;
+
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        cfg.p_passkey = "654321";
+        p_bad = sim_sensor_add(&cfg);
+    }
+    for(index = 0; index < healthy; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg((data_id_t)(DATA_ID_DEV_HTU + 1 + index));
+
+        cfg.notify_interval_ms = 1000;
+        p_healthy[index]       = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_set_passkey(DATA_ID_DEV_HTU, "123456");
+    sim_fixture_read_stats(&stats, true);
+    if(backoff == false)
+    {
+        bench_backoff_clear(NULL);
+    }
+
+    for(index = 0; index < healthy; index++)
+    {
+        values -= sim_sensor_stats(p_healthy[index])->values;
+    }
+    radio_us = p_sd->scan_us;
+
+    bench_measure_start();
+    sim_fixture_run();
+    sim_run_for(BENCH_BACKOFF_WINDOW_US);
+    bench_measure_stop();
+
+    for(index = 0; index < healthy; index++)
+    {
+        values   += sim_sensor_stats(p_healthy[index])->values;
+        received += sim_sensor_stats(p_healthy[index])->notifications;
+    }
+    radio_us = p_sd->scan_us - radio_us;
+    sim_fixture_read_stats(&stats, true);
+    if(bench_backoff_clear_event != NULL)
+    {
+        sim_cancel(bench_backoff_clear_event);
+        bench_backoff_clear_event = NULL;
+    }
+
+    bench_metric("backoff", backoff);
+    bench_metric("healthy_sensors", healthy);
+    bench_metric("bad_connections", sim_sensor_stats(p_bad)->connections);
+    bench_metric("bad_pairings_failed", sim_sensor_stats(p_bad)->pairings_failed);
+    bench_metric("bad_attempts_per_min", (double)sim_sensor_stats(p_bad)->connections * 60 * SIM_US_PER_S / BENCH_BACKOFF_WINDOW_US);
+    bench_metric("peers_held_back", stats.peer_failures);
+    bench_metric("connect_requests", p_sd->connect_requests);
+    bench_metric("initiator_ms", (double)p_sd->initiator_us / SIM_US_PER_MS);
+    bench_metric("conn_event_ms", (double)p_sd->conn_event_us / SIM_US_PER_MS);
+    bench_metric("scan_ms", (double)radio_us / SIM_US_PER_MS);
+    bench_metric("healthy_values_received_ratio", (values != 0) ? ((double)received / values) : 0);
+}
+
+BENCH(backoff_misconfigured_alone)
+{
+    bench_backoff_run(true, 0);
+}
+
+BENCH(backoff_off_misconfigured_alone)
+{
+    bench_backoff_run(false, 0);
+}
+
+BENCH(backoff_misconfigured_healthy_5)
+{
+    bench_backoff_run(true, BENCH_BACKOFF_HEALTHY);
+}
+
+BENCH(backoff_off_misconfigured_healthy_5)
+{
+    bench_backoff_run(false, BENCH_BACKOFF_HEALTHY);
+}
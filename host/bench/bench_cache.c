@@ -0,0 +1,148 @@
+/** @file   bench_cache.c
+ *  @brief  Host polling sensors with plain reads against reads answered from the
+ *          value cache: read latency and GATT reads reaching the sensors.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+
+#define BENCH_CACHE_TYPES        4
+#define BENCH_CACHE_ROUNDS       60
+#define BENCH_CACHE_ROUND_US     SIM_S(2)
+#define BENCH_CACHE_NOTIFY_MS    250
+#define BENCH_CACHE_BEACON_AGE   60000       /**< Beacon frequency rarely changes. */
+#define BENCH_CACHE_DATA_AGE     500
+
+static const data_id_t bench_cache_types[BENCH_CACHE_TYPES] = { DATA_ID_DEV_HTU, DATA_ID_DEV_GYRO, DATA_ID_DEV_LIGHT, DATA_ID_DEV_SOUND };
+
+static int bench_cache_compare(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Send read of field to every sensor, plain or cached with maximum age. */
+
+static void bench_cache_read_all(uint8_t field, bool cached, uint16_t max_age_ms)
+{
+    uint8_t index;
+
+    for(index = 0; index < BENCH_CACHE_TYPES; index++)
+    {
+        const bool queued = cached ?
+            sim_kinetis_send(bench_cache_types[index], field, OPERATION_V1(OPERATION_READ_CACHED, sizeof(max_age_ms)),
+                             (const uint8_t *)&max_age_ms, sizeof(max_age_ms)) :
+            sim_kinetis_send(bench_cache_types[index], field, OPERATION_V1(OPERATION_READ, 0), NULL, 0);
+
+        if(queued == false)
+        {
+            sim_fail("command queue full");
+        }
+    }
+}
+
+static uint32_t bench_cache_gatt_reads(void)
+{
+    uint32_t reads = 0;
+    uint8_t  index;
+
+    for(index = 0; index < sim_sensor_count(); index++)
+    {
+        reads += sim_sensor_stats(sim_sensor_get(index))->att_reads;
+    }
+    return reads;
+}
+
+/**@brief Every round host reads beacon frequency, then DATA_R, of four streaming sensors. Latency is
+ *        measured on beacon frequency, DATA_R read may also be answered by notification.
+ */
+
+static void bench_cache_run(bool cached)
+{
+    static uint64_t latency[BENCH_CACHE_ROUNDS * BENCH_CACHE_TYPES];
+    stats_block_t   stats;
+    uint32_t        gatt_reads;
+    size_t          count = 0;
+    uint32_t        round;
+    uint8_t         index;
+
+    for(index = 0; index < BENCH_CACHE_TYPES; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(bench_cache_types[index]);
+
+        cfg.notify_interval_ms = BENCH_CACHE_NOTIFY_MS;
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(SIM_S(60)) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    sim_run_for(SIM_S(5));
+
+    gatt_reads = bench_cache_gatt_reads();
+    bench_measure_start();
+    for(round = 0; round < BENCH_CACHE_ROUNDS; round++)
+    {
+        const uint64_t start = sim_now();
+        size_t         from  = sim_kinetis_frame_count();
+
+        bench_cache_read_all(FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, cached, BENCH_CACHE_BEACON_AGE);
+        for(index = 0; index < BENCH_CACHE_TYPES; index++)
+        {
+            const sim_kinetis_frame_t * p_frame = sim_kinetis_wait(bench_cache_types[index], FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY,
+                                                                   from, SIM_S(1));
+
+            if(p_frame == NULL)
+            {
+                sim_fail("round %u type %u not answered", round, bench_cache_types[index]);
+            }
+            latency[count++] = p_frame->time - start;
+        }
+
+        from = sim_kinetis_frame_count();
+        bench_cache_read_all(FIELD_ID_CHAR_SENSOR_DATA_R, cached, BENCH_CACHE_DATA_AGE);
+        for(index = 0; index < BENCH_CACHE_TYPES; index++)
+        {
+            if(sim_kinetis_wait(bench_cache_types[index], FIELD_ID_CHAR_SENSOR_DATA_R, from, SIM_S(1)) == NULL)
+            {
+                sim_fail("round %u type %u sent no value", round, bench_cache_types[index]);
+            }
+        }
+        sim_run_until(start + BENCH_CACHE_ROUND_US);
+    }
+    bench_measure_stop();
+    gatt_reads = bench_cache_gatt_reads() - gatt_reads;
+
+    if(sim_fixture_count_frames(DATA_ID_RESPONSE_BUSY, 0xFF, 0) != 0)
+    {
+        sim_fail("read sent to busy sensor");
+    }
+    sim_fixture_read_stats(&stats, true);
+    qsort(latency, count, sizeof(uint64_t), bench_cache_compare);
+
+    bench_metric("host_reads", BENCH_CACHE_ROUNDS * BENCH_CACHE_TYPES * 2);
+    bench_metric("gatt_reads", gatt_reads);
+    bench_metric("gatt_reads_per_host_read", (double)gatt_reads / (BENCH_CACHE_ROUNDS * BENCH_CACHE_TYPES * 2));
+    bench_metric("cache_hits", stats.cache_hits);
+    bench_metric("cache_misses", stats.cache_misses);
+    bench_metric("read_latency_p50_us", latency[((count - 1) * 50) / 100]);
+    bench_metric("read_latency_p90_us", latency[((count - 1) * 90) / 100]);
+    bench_metric("read_latency_max_us", latency[count - 1]);
+}
+
+BENCH(reads_plain)
+{
+    bench_cache_run(false);
+}
+
+BENCH(reads_cached)
+{
+    bench_cache_run(true);
+}
@@ -0,0 +1,136 @@
+/** @file   bench_connect.c
+ *  @brief  Time to connect and failed connection requests of six sensors coming
+ *          back into range together, at increasing loss of advertising packets.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "app_timer.h"
+
+#define BENCH_CONNECT_SENSORS     (DATA_ID_DEV_IR + 1)
+#define BENCH_CONNECT_ROUNDS      10
+#define BENCH_CONNECT_OFF_US      SIM_S(10)     /**< Longer than supervision timeout. */
+#define BENCH_CONNECT_TIMEOUT_US  SIM_S(600)
+
+static sim_sensor_t * bench_connect_sensors[BENCH_CONNECT_SENSORS];
+
+static bool bench_connect_all(void * p_ctx)
+{
+    uint8_t index;
+
+    (void)p_ctx;
+    for(index = 0; index < BENCH_CONNECT_SENSORS; index++)
+    {
+        if(sim_sensor_connected(bench_connect_sensors[index]) == false)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int bench_connect_compare(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Sensors are onboarded, then powered off and on together in rounds. Time to connect of
+ *        a sensor is from power on to its connection.
+ *
+ * @param[in] adv_loss  Probability that advertising packet is not received.
+ */
+
+static void bench_connect_run(double adv_loss)
+{
+    static uint64_t                times[BENCH_CONNECT_ROUNDS * BENCH_CONNECT_SENSORS];
+    const sim_softdevice_stats_t * p_sd  = sim_softdevice_stats();
+    size_t                         count = 0;
+    stats_block_t                  stats;
+    uint8_t                        round;
+    uint8_t                        index;
+
+    for(index = 0; index < BENCH_CONNECT_SENSORS; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg((data_id_t)index);
+
+        cfg.adv_loss                 = adv_loss;
+        bench_connect_sensors[index] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_CONNECT_TIMEOUT_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    sim_fixture_read_stats(&stats, true);
+
+    bench_measure_start();
+    for(round = 0; round < BENCH_CONNECT_ROUNDS; round++)
+    {
+        uint64_t start;
+
+        for(index = 0; index < BENCH_CONNECT_SENSORS; index++)
+        {
+            sim_sensor_set_power(bench_connect_sensors[index], false);
+        }
+        sim_run_for(BENCH_CONNECT_OFF_US);
+
+        start = sim_now();
+        for(index = 0; index < BENCH_CONNECT_SENSORS; index++)
+        {
+            sim_sensor_set_power(bench_connect_sensors[index], true);
+        }
+        if(sim_run_until_cond(bench_connect_all, NULL, BENCH_CONNECT_TIMEOUT_US) == false)
+        {
+            sim_fail("sensors not connected in round %u", round);
+        }
+        for(index = 0; index < BENCH_CONNECT_SENSORS; index++)
+        {
+            times[count++] = sim_sensor_stats(bench_connect_sensors[index])->connected_us - start;
+        }
+    }
+    bench_measure_stop();
+    sim_fixture_read_stats(&stats, true);
+    qsort(times, count, sizeof(uint64_t), bench_connect_compare);
+
+    bench_metric("adv_loss", adv_loss);
+    bench_metric("connect_p50_ms", (double)times[(count - 1) / 2] / SIM_US_PER_MS);
+    bench_metric("connect_p90_ms", (double)times[((count - 1) * 90) / 100] / SIM_US_PER_MS);
+    bench_metric("connect_max_ms", (double)times[count - 1] / SIM_US_PER_MS);
+    bench_metric("connect_requests", p_sd->connect_requests);
+    bench_metric("connect_timeouts", p_sd->connect_timeouts);
+    bench_metric("failed_attempt_rate", (p_sd->connect_requests != 0) ? ((double)p_sd->connect_timeouts / p_sd->connect_requests) : 0);
+    bench_metric("requests_per_connection", (double)p_sd->connect_requests / count);
+    bench_metric("report_to_connect_avg_ms", (stats.connect.count != 0) ?
+                                             ((double)stats.connect.total_ticks * 1000 / APP_TIMER_CLOCK_FREQ / stats.connect.count) : 0);
+    bench_metric("report_to_connect_max_ms", (double)stats.connect.max_ticks * 1000 / APP_TIMER_CLOCK_FREQ);
+    bench_metric("peers_held_back", stats.peer_failures);
+    bench_metric("initiator_ms", (double)p_sd->initiator_us / SIM_US_PER_MS);
+}
+
+BENCH(connect_loss_0)
+{
+    bench_connect_run(0.0);
+}
+
+BENCH(connect_loss_50)
+{
+    bench_connect_run(0.5);
+}
+
+BENCH(connect_loss_80)
+{
+    bench_connect_run(0.8);
+}
+
+BENCH(connect_loss_90)
+{
+    bench_connect_run(0.9);
+}
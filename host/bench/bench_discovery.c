@@ -0,0 +1,79 @@
+/** @file   bench_discovery.c
+ *  @brief  GATT discovery of Wunderbar sensors: requests and time per discovery of
+ *          each sensor type, against discovery one service UUID at a time.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+
+#define BENCH_DISCOVERY_BRINGUP_US  SIM_S(60)
+
+/**@brief Metric names per sensor type: requests, requests of search per UUID and duration. */
+static const char * const bench_discovery_metrics[DATA_ID_DEV_IR + 1][3] =
+{
+    [DATA_ID_DEV_HTU]    = { "htu_requests",    "htu_requests_per_uuid",    "htu_discovery_ms" },
+    [DATA_ID_DEV_GYRO]   = { "gyro_requests",   "gyro_requests_per_uuid",   "gyro_discovery_ms" },
+    [DATA_ID_DEV_LIGHT]  = { "light_requests",  "light_requests_per_uuid",  "light_discovery_ms" },
+    [DATA_ID_DEV_SOUND]  = { "sound_requests",  "sound_requests_per_uuid",  "sound_discovery_ms" },
+    [DATA_ID_DEV_BRIDGE] = { "bridge_requests", "bridge_requests_per_uuid", "bridge_discovery_ms" },
+    [DATA_ID_DEV_IR]     = { "ir_requests",     "ir_requests_per_uuid",     "ir_discovery_ms" },
+};
+
+static void bench_discovery_run(sim_sensor_mode_t mode)
+{
+    sim_sensor_t * p_sensors[DATA_ID_DEV_IR + 1];
+    uint32_t       requests          = 0;
+    uint32_t       requests_per_uuid = 0;
+    data_id_t      type;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+        cfg.mode        = mode;
+        p_sensors[type] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+
+    // Window covers connection, discovery and security of all sensors.
+    bench_measure_start();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_DISCOVERY_BRINGUP_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    bench_measure_stop();
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        const sim_sensor_stats_t * p_stats = sim_sensor_stats(p_sensors[type]);
+
+        if(p_stats->connections != 1)
+        {
+            sim_fail("type %u connected %u times", type, p_stats->connections);
+        }
+        requests          += p_stats->att_discovery;
+        requests_per_uuid += sim_sensor_discovery_requests_per_uuid(p_sensors[type]);
+
+        bench_metric(bench_discovery_metrics[type][0], p_stats->att_discovery);
+        bench_metric(bench_discovery_metrics[type][1], sim_sensor_discovery_requests_per_uuid(p_sensors[type]));
+        bench_metric(bench_discovery_metrics[type][2],
+                     (double)(p_stats->discovery_last_us - p_stats->discovery_first_us) / SIM_US_PER_MS);
+    }
+    bench_metric("requests_per_discovery", (double)requests / (DATA_ID_DEV_IR + 1));
+    bench_metric("requests_per_discovery_per_uuid", (double)requests_per_uuid / (DATA_ID_DEV_IR + 1));
+    bench_metric("gattc_requests", sim_softdevice_stats()->gattc_requests);
+}
+
+BENCH(discovery_secured)
+{
+    bench_discovery_run(SIM_SENSOR_SECURED);
+}
+
+BENCH(discovery_open)
+{
+    bench_discovery_run(SIM_SENSOR_OPEN);
+}
@@ -0,0 +1,133 @@
+/** @file   bench_gatt_timeout.c
+ *  @brief  Recovery from dropped GATT responses: host reads a running sensor
+ *          once per second and the sensor loses a share of its read responses.
+ *          A lost response ends with disconnection at the deadline of the read
+ *          and the sensor is brought up again, instead of waiting for the 30 s
+ *          protocol timeout. Responses are dropped only to reads of the host,
+ *          so every bring-up completes; losses during discovery are covered by
+ *          test_gatt_timeout.c.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "client_handling.h"
+
+#define BENCH_GATT_TIMEOUT_WINDOW_US   SIM_S(600)
+#define BENCH_GATT_TIMEOUT_PERIOD_US   SIM_S(1)
+#define BENCH_GATT_TIMEOUT_READS       (BENCH_GATT_TIMEOUT_WINDOW_US / BENCH_GATT_TIMEOUT_PERIOD_US)
+#define BENCH_GATT_TIMEOUT_ANSWER_US   SIM_MS(CLIENT_TIMEOUT_WAIT_READ_RSP_MS + CLIENT_TIMEOUT_CHECK_MS)
+#define BENCH_GATT_TIMEOUT_RUNNING_US  SIM_S(60)
+
+static int bench_gatt_timeout_compare(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static double bench_gatt_timeout_ms(const uint64_t * p_times, size_t count, uint8_t percent)
+{
+    return (count != 0) ? ((double)p_times[((count - 1) * percent) / 100] / SIM_US_PER_MS) : 0;
+}
+
+/**@brief GYRO is read by host in measured window. Recovery time is from read whose response was
+ *        dropped to running state after reconnection.
+ *
+ * @param[in] rsp_drop  Probability that ATT response is lost.
+ */
+
+static void bench_gatt_timeout_run(double rsp_drop)
+{
+    static uint64_t  latency[BENCH_GATT_TIMEOUT_READS];
+    static uint64_t  recovery[BENCH_GATT_TIMEOUT_READS];
+    size_t           answered  = 0;
+    size_t           recovered = 0;
+    sim_sensor_t   * p_gyro;
+    stats_block_t    stats;
+    uint64_t         end;
+    uint16_t         timeouts  = 0;
+    uint8_t          client;
+
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_GYRO);
+
+        p_gyro = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    if(sim_fixture_wait_running(p_gyro, BENCH_GATT_TIMEOUT_RUNNING_US) == UINT64_MAX)
+    {
+        sim_fail("sensor not running");
+    }
+    sim_fixture_read_stats(&stats, true);
+
+    bench_measure_start();
+    end = sim_now() + BENCH_GATT_TIMEOUT_WINDOW_US;
+    while(sim_now() < end)
+    {
+        const uint64_t              start   = sim_now();
+        const uint32_t              dropped = sim_sensor_stats(p_gyro)->att_rsp_dropped;
+        const size_t                next    = sim_kinetis_frame_count();
+        const sim_kinetis_frame_t * p_frame;
+
+        sim_sensor_set_rsp_drop(p_gyro, rsp_drop);
+        (void)sim_kinetis_send(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, OPERATION_V1(OPERATION_READ, 0), NULL, 0);
+        p_frame = sim_kinetis_wait(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, next, BENCH_GATT_TIMEOUT_ANSWER_US);
+        sim_sensor_set_rsp_drop(p_gyro, 0.0);
+        if(p_frame != NULL)
+        {
+            latency[answered++] = p_frame->time - start;
+        }
+        else if(sim_sensor_stats(p_gyro)->att_rsp_dropped != dropped)
+        {
+            if(sim_fixture_wait_running(p_gyro, BENCH_GATT_TIMEOUT_RUNNING_US) == UINT64_MAX)
+            {
+                sim_fail("sensor not running again");
+            }
+            recovery[recovered++] = sim_now() - start;
+        }
+        if((sim_now() - start) < BENCH_GATT_TIMEOUT_PERIOD_US)
+        {
+            sim_run_for(BENCH_GATT_TIMEOUT_PERIOD_US - (sim_now() - start));
+        }
+    }
+    bench_measure_stop();
+    sim_fixture_read_stats(&stats, true);
+    qsort(latency, answered, sizeof(uint64_t), bench_gatt_timeout_compare);
+    qsort(recovery, recovered, sizeof(uint64_t), bench_gatt_timeout_compare);
+    for(client = 0; client < MAX_CLIENTS; client++)
+    {
+        timeouts += stats.gatt_timeouts[client];
+    }
+
+    bench_metric("rsp_drop", rsp_drop);
+    bench_metric("reads_answered", answered);
+    bench_metric("reads_lost", recovered);
+    bench_metric("read_p50_ms", bench_gatt_timeout_ms(latency, answered, 50));
+    bench_metric("read_p99_ms", bench_gatt_timeout_ms(latency, answered, 99));
+    bench_metric("recovery_p50_ms", bench_gatt_timeout_ms(recovery, recovered, 50));
+    bench_metric("recovery_max_ms", bench_gatt_timeout_ms(recovery, recovered, 100));
+    bench_metric("gatt_timeouts", timeouts);
+    bench_metric("protocol_timeouts", sim_softdevice_stats()->gattc_timeouts);
+    bench_metric("disconnections", sim_sensor_stats(p_gyro)->disconnections);
+}
+
+BENCH(gatt_timeout_drop_0)
+{
+    bench_gatt_timeout_run(0.0);
+}
+
+BENCH(gatt_timeout_drop_5)
+{
+    bench_gatt_timeout_run(0.05);
+}
+
+BENCH(gatt_timeout_drop_20)
+{
+    bench_gatt_timeout_run(0.2);
+}
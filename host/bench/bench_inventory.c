@@ -0,0 +1,100 @@
+/** @file   bench_inventory.c
+ *  @brief  Time until host holds device information and battery level of six
+ *          sensors: prefetched at connection, against the same number of reads
+ *          going to the sensors one at a time, as they did before prefetch.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "app_timer.h"
+
+#define BENCH_INVENTORY_BRINGUP_US   SIM_S(60)
+#define BENCH_INVENTORY_FIELDS       4
+
+/**@brief Prefetched fields. Beacon frequency is never prefetched, its read stands for GATT read of a field. */
+static const uint8_t bench_inventory_fields[BENCH_INVENTORY_FIELDS] =
+{
+    FIELD_ID_CHAR_MANUFACTURER_NAME, FIELD_ID_CHAR_HARDWARE_REVISION, FIELD_ID_CHAR_FIRMWARE_REVISION, FIELD_ID_CHAR_BATTERY_LEVEL,
+};
+
+static uint32_t bench_inventory_gatt_reads(void)
+{
+    uint32_t reads = 0;
+    uint8_t  index;
+
+    for(index = 0; index < sim_sensor_count(); index++)
+    {
+        reads += sim_sensor_stats(sim_sensor_get(index))->att_reads;
+    }
+    return reads;
+}
+
+static void bench_inventory_run(bool prefetched)
+{
+    stats_block_t stats;
+    uint64_t      start;
+    uint64_t      running;
+    uint32_t      reads;
+    data_id_t     type;
+    uint8_t       index;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+
+    bench_measure_start();
+    start = sim_now();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_INVENTORY_BRINGUP_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    running = sim_now();
+    reads   = bench_inventory_gatt_reads();
+
+    // Sensor has one SPI frame slot, fields are read one after another and sensors at once.
+    for(index = 0; index < BENCH_INVENTORY_FIELDS; index++)
+    {
+        const uint8_t field = prefetched ? bench_inventory_fields[index] : FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY;
+        const size_t  from  = sim_kinetis_frame_count();
+
+        for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+        {
+            (void)sim_kinetis_send(type, field, OPERATION_V1(OPERATION_READ, 0), NULL, 0);
+        }
+        for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+        {
+            if(sim_kinetis_wait(type, field, from, SIM_S(2)) == NULL)
+            {
+                sim_fail("type %u field %u not answered", type, field);
+            }
+        }
+    }
+    bench_measure_stop();
+    sim_fixture_read_stats(&stats, true);
+
+    bench_metric("bringup_all_ms", (double)(running - start) / SIM_US_PER_MS);
+    bench_metric("inventory_all_ms", (double)(sim_now() - start) / SIM_US_PER_MS);
+    bench_metric("inventory_after_running_ms", (double)(sim_now() - running) / SIM_US_PER_MS);
+    bench_metric("host_reads", BENCH_INVENTORY_FIELDS * (DATA_ID_DEV_IR + 1));
+    bench_metric("gatt_reads_at_connection", reads);
+    bench_metric("gatt_reads_for_host", bench_inventory_gatt_reads() - reads);
+    bench_metric("reads_saved", stats.info_reads);
+    bench_metric("inventory_max_ms", (double)stats.inventory_ticks * SIM_US_PER_S / APP_TIMER_CLOCK_FREQ / SIM_US_PER_MS);
+}
+
+BENCH(inventory_prefetched)
+{
+    bench_inventory_run(true);
+}
+
+BENCH(inventory_gatt_reads)
+{
+    bench_inventory_run(false);
+}
@@ -0,0 +1,150 @@
+/** @file   bench_link.c
+ *  @brief  Goodput of SPI bus against bit error rate, with link layer and with
+ *          legacy frames which carry no CRC.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "spi_slave_config.h"
+
+#define BENCH_LINK_WINDOW_US     SIM_S(30)
+#define BENCH_LINK_BRINGUP_US    SIM_S(60)
+#define BENCH_LINK_NOTIFY_MS     20
+
+static const data_id_t bench_link_types[] = { DATA_ID_DEV_GYRO, DATA_ID_DEV_SOUND, DATA_ID_DEV_BRIDGE };
+
+/**@brief Count DATA_R values received intact since frame index: pattern of the type after sequence
+ *        number, sequence number generated by the sensor and newer than previous value.
+ */
+
+static void bench_link_count_values(const sim_sensor_t * p_sensor, size_t from, uint32_t * p_intact, uint32_t * p_corrupted)
+{
+    const data_id_t             type = sim_sensor_type(p_sensor);
+    const uint8_t               len  = sensors_get_msg_size(type, FIELD_ID_CHAR_SENSOR_DATA_R);
+    const sim_kinetis_frame_t * p_frame;
+    uint32_t                    last = 0;
+    uint8_t                     i;
+
+    while((p_frame = sim_kinetis_find(type, FIELD_ID_CHAR_SENSOR_DATA_R, &from)) != NULL)
+    {
+        const uint32_t seq    = sim_sensor_value_seq(p_frame->frame.data, len);
+        bool           intact = (seq > last) && (seq <= sim_sensor_stats(p_sensor)->values);
+
+        for(i = sizeof(uint32_t); i < len; i++)
+        {
+            intact = intact && (p_frame->frame.data[i] == (uint8_t)(i ^ type));
+        }
+        if(intact)
+        {
+            (*p_intact)++;
+            last = seq;
+        }
+        else
+        {
+            (*p_corrupted)++;
+        }
+        from++;
+    }
+}
+
+static void bench_link_run(double bit_error_rate, bool link)
+{
+    sim_sensor_t    * p_sensors[sizeof(bench_link_types)];
+    sim_kinetis_cfg_t cfg       = sim_kinetis_default_cfg();
+    uint32_t          intact    = 0;
+    uint32_t          corrupted = 0;
+    size_t            from;
+    uint8_t           index;
+
+    for(index = 0; index < sizeof(bench_link_types); index++)
+    {
+        sim_sensor_cfg_t sensor = sim_sensor_default_cfg(bench_link_types[index]);
+
+        sensor.notify_interval_ms = BENCH_LINK_NOTIFY_MS;
+        p_sensors[index]          = sim_sensor_add(&sensor);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_LINK_BRINGUP_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    if(link)
+    {
+        sim_kinetis_link_enable();
+        sim_run_for(SIM_MS(10));
+        if(sim_kinetis_link_enabled() == false)
+        {
+            sim_fail("link layer not enabled");
+        }
+    }
+
+    // Bus gets noisy once sensors stream.
+    cfg.bit_error_rate = bit_error_rate;
+    sim_kinetis_set_cfg(&cfg);
+
+    from = sim_kinetis_frame_count();
+    bench_measure_start();
+    sim_run_for(BENCH_LINK_WINDOW_US);
+    bench_measure_stop();
+
+    for(index = 0; index < sizeof(bench_link_types); index++)
+    {
+        bench_link_count_values(p_sensors[index], from, &intact, &corrupted);
+    }
+
+    bench_metric("bit_error_rate", bit_error_rate);
+    bench_metric("goodput_values_per_s", (double)intact * SIM_US_PER_S / BENCH_LINK_WINDOW_US);
+    bench_metric("values_intact", intact);
+    bench_metric("values_corrupted", corrupted);
+    bench_metric("bits_flipped", sim_kinetis_stats()->bits_flipped);
+    bench_metric("host_crc_errors", sim_kinetis_stats()->crc_errors);
+    bench_metric("host_retransmits", sim_kinetis_stats()->retransmits);
+    bench_metric("host_duplicates", sim_kinetis_stats()->duplicates);
+    bench_metric("firmware_crc_errors", spi_get_link_counters()->crc_errors);
+    bench_metric("firmware_retransmits", spi_get_link_counters()->retransmits);
+    bench_metric("firmware_abandoned", spi_get_link_counters()->abandoned);
+    bench_metric("bus_utilization", (double)sim_kinetis_stats()->bus_us / BENCH_LINK_WINDOW_US);
+}
+
+BENCH(legacy_ber_0)
+{
+    bench_link_run(0, false);
+}
+
+BENCH(legacy_ber_1e5)
+{
+    bench_link_run(1e-5, false);
+}
+
+BENCH(legacy_ber_1e4)
+{
+    bench_link_run(1e-4, false);
+}
+
+BENCH(legacy_ber_1e3)
+{
+    bench_link_run(1e-3, false);
+}
+
+BENCH(link_ber_0)
+{
+    bench_link_run(0, true);
+}
+
+BENCH(link_ber_1e5)
+{
+    bench_link_run(1e-5, true);
+}
+
+BENCH(link_ber_1e4)
+{
+    bench_link_run(1e-4, true);
+}
+
+BENCH(link_ber_1e3)
+{
+    bench_link_run(1e-3, true);
+}
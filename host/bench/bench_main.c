@@ -0,0 +1,109 @@
+/** @file   bench_main.c
+ *  @brief  Runner of host benchmark scenarios, see bench.h.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "bench.h"
+
+#define BENCH_SCENARIOS_MAX   64
+
+typedef struct
+{
+    const char       * p_name;
+    bench_scenario_t   scenario;
+}
+bench_entry_t;
+
+static bench_entry_t bench_scenarios[BENCH_SCENARIOS_MAX];
+static uint32_t      bench_scenario_count;
+
+void bench_register(const char * p_name, bench_scenario_t scenario)
+{
+    if(bench_scenario_count == BENCH_SCENARIOS_MAX)
+    {
+        fprintf(stderr, "too many scenarios, raise BENCH_SCENARIOS_MAX\n");
+        exit(1);
+    }
+    bench_scenarios[bench_scenario_count].p_name   = p_name;
+    bench_scenarios[bench_scenario_count].scenario = scenario;
+    bench_scenario_count++;
+}
+
+/**@brief Run one scenario in child process, which prints its JSON object.
+ *
+ * @return true if scenario finished.
+ */
+
+static bool bench_run(const bench_entry_t * p_entry, uint64_t seed, bool first)
+{
+    pid_t pid;
+    int   status;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0)
+    {
+        alarm(BENCH_TIMEOUT_S);
+        sim_init(seed);
+        p_entry->scenario();
+
+        printf("%s\n    {\n      \"name\": \"%s\"", first ? "" : ",", p_entry->p_name);
+        bench_metrics_print();
+        printf("\n    }");
+        fflush(stdout);
+        _exit(0);
+    }
+
+    if(waitpid(pid, &status, 0) < 0)
+    {
+        perror("waitpid");
+        exit(1);
+    }
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char * argv[])
+{
+    const char * p_filter = (argc > 1) ? argv[1] : NULL;
+    const char * p_seed   = getenv("SIM_SEED");
+    uint64_t     seed     = (p_seed != NULL) ? strtoull(p_seed, NULL, 0) : 1;
+    uint32_t     printed  = 0;
+    uint32_t     failed   = 0;
+    uint32_t     index;
+
+    printf("{\n  \"seed\": %llu,\n  \"scenarios\": [", (unsigned long long)seed);
+    for(index = 0; index < bench_scenario_count; index++)
+    {
+        const bench_entry_t * p_entry = &bench_scenarios[index];
+
+        if( (p_filter != NULL) && (strstr(p_entry->p_name, p_filter) == NULL) )
+        {
+            continue;
+        }
+
+        fprintf(stderr, "bench %s\n", p_entry->p_name);
+        if(bench_run(p_entry, seed, printed == 0))
+        {
+            printed++;
+        }
+        else
+        {
+            fprintf(stderr, "bench %s failed\n", p_entry->p_name);
+            failed++;
+        }
+    }
+    printf("\n  ]\n}\n");
+
+    return (failed == 0) ? 0 : 1;
+}
@@ -0,0 +1,213 @@
+/** @file   bench_measure.c
+ *  @brief  Metrics of measured window, see bench.h.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "sim_kinetis.h"
+#include "sim_sensor.h"
+#include "sim_softdevice.h"
+#include "spi_slave_config.h"
+#include "debug.h"
+
+typedef struct
+{
+    const char * p_name;
+    double       value;
+}
+bench_metric_t;
+
+static bench_metric_t bench_metrics[BENCH_METRICS_MAX];
+static uint32_t       bench_metric_count;
+
+static uint64_t       bench_start_us;
+static uint32_t       bench_start_values;
+static uint32_t       bench_start_overflow;
+
+static uint64_t     * p_bench_latency;     /**< Latencies of DATA_R frames received in window. */
+static size_t         bench_latency_count;
+static size_t         bench_latency_size;
+
+void bench_metric(const char * p_name, double value)
+{
+    uint32_t index;
+
+    for(index = 0; index < bench_metric_count; index++)
+    {
+        if(strcmp(bench_metrics[index].p_name, p_name) == 0)
+        {
+            bench_metrics[index].value = value;
+            return;
+        }
+    }
+    if(bench_metric_count == BENCH_METRICS_MAX)
+    {
+        sim_fail("too many metrics, raise BENCH_METRICS_MAX");
+    }
+    bench_metrics[bench_metric_count].p_name = p_name;
+    bench_metrics[bench_metric_count].value  = value;
+    bench_metric_count++;
+}
+
+void bench_metrics_print(void)
+{
+    uint32_t index;
+
+    for(index = 0; index < bench_metric_count; index++)
+    {
+        printf(",\n      \"%s\": %.6g", bench_metrics[index].p_name, bench_metrics[index].value);
+    }
+}
+
+static void bench_sensor_totals(uint32_t * p_values, uint32_t * p_overflow)
+{
+    uint8_t index;
+
+    *p_values   = 0;
+    *p_overflow = 0;
+    for(index = 0; index < sim_sensor_count(); index++)
+    {
+        const sim_sensor_stats_t * p_stats = sim_sensor_stats(sim_sensor_get(index));
+
+        *p_values   += p_stats->values;
+        *p_overflow += p_stats->notify_overflow;
+    }
+}
+
+/**@brief Sensor which generated DATA_R value, first sensor of the type. */
+
+static const sim_sensor_t * bench_value_source(data_id_t data_id)
+{
+    uint8_t index;
+
+    for(index = 0; index < sim_sensor_count(); index++)
+    {
+        const sim_sensor_t * p_sensor = sim_sensor_get(index);
+
+        if(sim_sensor_type(p_sensor) == DATA_ID_GET_TYPE(data_id))
+        {
+            return p_sensor;
+        }
+    }
+    return NULL;
+}
+
+static int bench_compare_u64(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+static double bench_percentile(const uint64_t * p_sorted, size_t count, uint32_t percent)
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+    return (double)p_sorted[((count - 1) * percent) / 100];
+}
+
+/**@brief Record latency of DATA_R frame as it is received, history of sensor values is short. */
+
+static void bench_on_frame(const sim_kinetis_frame_t * p_frame, void * p_ctx)
+{
+    const sim_sensor_t * p_sensor;
+    uint64_t             generated;
+    uint8_t              len;
+
+    (void)p_ctx;
+    if(p_frame->frame.field_id != FIELD_ID_CHAR_SENSOR_DATA_R)
+    {
+        return;
+    }
+    p_sensor = bench_value_source(p_frame->frame.data_id);
+    if(p_sensor == NULL)
+    {
+        return;
+    }
+    len       = sensors_get_msg_size(sim_sensor_type(p_sensor), FIELD_ID_CHAR_SENSOR_DATA_R);
+    generated = sim_sensor_value_time(p_sensor, sim_sensor_value_seq(p_frame->frame.data, len));
+    if( (generated == 0) || (generated > p_frame->time) )
+    {
+        return;
+    }
+
+    if(bench_latency_count == bench_latency_size)
+    {
+        bench_latency_size = (bench_latency_size == 0) ? 1024 : (2 * bench_latency_size);
+        p_bench_latency    = realloc(p_bench_latency, sizeof(uint64_t) * bench_latency_size);
+    }
+    p_bench_latency[bench_latency_count++] = p_frame->time - generated;
+}
+
+void bench_measure_start(void)
+{
+    bench_start_us = sim_now();
+    bench_sensor_totals(&bench_start_values, &bench_start_overflow);
+
+    bench_latency_count = 0;
+    sim_kinetis_set_handler(bench_on_frame, NULL);
+
+    sim_cpu_reset();
+    sim_kinetis_stats_reset();
+    sim_softdevice_stats_reset();
+    spi_reset_frame_counters();
+}
+
+static double bench_ratio(double total, double count)
+{
+    return (count > 0) ? (total / count) : 0;
+}
+
+void bench_measure_stop(void)
+{
+    const double                   window_s = (double)(sim_now() - bench_start_us) / SIM_US_PER_S;
+    const sim_cpu_t              * p_cpu    = sim_cpu();
+    const sim_softdevice_stats_t * p_sd     = sim_softdevice_stats();
+    uint32_t                       written     = 0;
+    uint32_t                       overwritten = 0;
+    uint32_t                       dropped     = 0;
+    uint32_t                       values;
+    uint32_t                       overflow;
+    uint8_t                        index;
+
+    for(index = 0; index < SPI_FRAME_COUNTERS_NUM; index++)
+    {
+        written     += spi_get_frame_counters(index)->written;
+        overwritten += spi_get_frame_counters(index)->overwritten;
+        dropped     += spi_get_frame_counters(index)->dropped;
+    }
+    bench_sensor_totals(&values, &overflow);
+    sim_kinetis_set_handler(NULL, NULL);
+    qsort(p_bench_latency, bench_latency_count, sizeof(uint64_t), bench_compare_u64);
+
+    bench_metric("window_s", window_s);
+    bench_metric("frames_per_s", bench_ratio(sim_kinetis_stats()->frames, window_s));
+    bench_metric("data_frames_per_s", bench_ratio(bench_latency_count, window_s));
+    bench_metric("latency_p50_us", bench_percentile(p_bench_latency, bench_latency_count, 50));
+    bench_metric("latency_p90_us", bench_percentile(p_bench_latency, bench_latency_count, 90));
+    bench_metric("latency_p99_us", bench_percentile(p_bench_latency, bench_latency_count, 99));
+    bench_metric("latency_max_us", bench_percentile(p_bench_latency, bench_latency_count, 100));
+    bench_metric("values_generated", values - bench_start_values);
+    bench_metric("values_lost_on_air", overflow - bench_start_overflow);
+    bench_metric("frames_written", written);
+    bench_metric("frames_overwritten", overwritten);
+    bench_metric("frames_dropped", dropped);
+    bench_metric("log_dropped", debug_get_dropped());
+    bench_metric("ble_events", p_sd->ble_events);
+    bench_metric("adv_reports", p_sd->adv_reports);
+    bench_metric("wakeups", p_cpu->main_slices);
+    bench_metric("cpu_ns_per_sd_event", bench_ratio(p_cpu->isr_ns[SIM_IRQ_SWI2], p_sd->ble_events + p_sd->sys_events));
+    bench_metric("cpu_ns_per_spi_irq", bench_ratio(p_cpu->isr_ns[SIM_IRQ_SPI1], p_cpu->isr_count[SIM_IRQ_SPI1]));
+    bench_metric("cpu_ns_per_timer_irq", bench_ratio(p_cpu->isr_ns[SIM_IRQ_RTC1], p_cpu->isr_count[SIM_IRQ_RTC1]));
+    bench_metric("cpu_ns_per_wakeup", bench_ratio(p_cpu->main_ns, p_cpu->main_slices));
+    bench_metric("cpu_ns_max_sd_irq", p_cpu->isr_max_ns[SIM_IRQ_SWI2]);
+    bench_metric("cpu_ns_max_spi_irq", p_cpu->isr_max_ns[SIM_IRQ_SPI1]);
+    bench_metric("cpu_ns_max_timer_irq", p_cpu->isr_max_ns[SIM_IRQ_RTC1]);
+}
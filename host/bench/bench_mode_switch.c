@@ -0,0 +1,149 @@
+/** @file   bench_mode_switch.c
+ *  @brief  Data gap of running sensors while host switches to config mode,
+ *          onboards a new sensor and switches back to run, repeatedly. Same
+ *          window without switches shows the gap of normal operation.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+
+#define BENCH_MODE_SWITCH_RUNNING      5
+#define BENCH_MODE_SWITCH_CYCLES       10
+#define BENCH_MODE_SWITCH_RUN_US       SIM_S(20)
+#define BENCH_MODE_SWITCH_NOTIFY_MS    1000
+
+/**@brief Longest time between two values of sensor received by host after frame index from. */
+
+static uint64_t bench_mode_switch_max_gap(data_id_t data_id, size_t from)
+{
+    const sim_kinetis_frame_t * p_frame;
+    uint64_t                    last = 0;
+    uint64_t                    gap  = 0;
+
+    while( (p_frame = sim_kinetis_find(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, &from)) != NULL )
+    {
+        if( (last != 0) && ((p_frame->time - last) > gap) )
+        {
+            gap = p_frame->time - last;
+        }
+        last = p_frame->time;
+        from++;
+    }
+    return gap;
+}
+
+/**@brief Running sensors are served for measured cycles, each with run window and optional
+ *        config phase which onboards one new sensor.
+ *
+ * @param[in] switches  Switch to config mode and back in every cycle.
+ */
+
+static void bench_mode_switch_run(bool switches)
+{
+    sim_sensor_t * p_running[BENCH_MODE_SWITCH_RUNNING];
+    sim_sensor_t * p_new;
+    uint32_t       values      = 0;
+    uint32_t       received    = 0;
+    uint32_t       connections = 0;
+    uint32_t       onboarded   = 0;
+    uint64_t       gap_max     = 0;
+    uint64_t       onboard_sum = 0;
+    stats_block_t  stats;
+    size_t         from;
+    uint8_t        cycle;
+    uint8_t        index;
+
+    for(index = 0; index < BENCH_MODE_SWITCH_RUNNING; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg((data_id_t)(DATA_ID_DEV_HTU + index));
+
+        cfg.notify_interval_ms = BENCH_MODE_SWITCH_NOTIFY_MS;
+        p_running[index]       = sim_sensor_add(&cfg);
+    }
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_IR);
+
+        cfg.mode = SIM_SENSOR_CONFIG;
+        p_new    = sim_sensor_add(&cfg);
+    }
+    sim_sensor_set_power(p_new, false);
+    sim_fixture_boot();
+    sim_fixture_set_passkey(DATA_ID_DEV_IR, "246810");
+    sim_fixture_run();
+    for(index = 0; index < BENCH_MODE_SWITCH_RUNNING; index++)
+    {
+        if(sim_fixture_wait_running(p_running[index], SIM_S(60)) == UINT64_MAX)
+        {
+            sim_fail("sensor %u not running", index);
+        }
+    }
+    sim_fixture_read_stats(&stats, true);
+
+    for(index = 0; index < BENCH_MODE_SWITCH_RUNNING; index++)
+    {
+        values      -= sim_sensor_stats(p_running[index])->values;
+        connections -= sim_sensor_stats(p_running[index])->connections;
+    }
+    from = sim_kinetis_frame_count();
+
+    bench_measure_start();
+    for(cycle = 0; cycle < BENCH_MODE_SWITCH_CYCLES; cycle++)
+    {
+        if(switches)
+        {
+            const uint64_t start = sim_now();
+            const size_t   first = sim_kinetis_frame_count();
+
+            // New sensor is onboarded, then leaves again.
+            sim_fixture_config();
+            sim_sensor_set_mode(p_new, SIM_SENSOR_CONFIG);
+            sim_sensor_set_power(p_new, true);
+            if(sim_kinetis_wait(DATA_ID_DEV_IR, FIELD_ID_ONBOARD_DONE, first, SIM_S(30)) != NULL)
+            {
+                onboarded++;
+                onboard_sum += sim_now() - start;
+            }
+            sim_sensor_set_power(p_new, false);
+            sim_fixture_run();
+        }
+        sim_run_for(BENCH_MODE_SWITCH_RUN_US);
+    }
+    bench_measure_stop();
+
+    for(index = 0; index < BENCH_MODE_SWITCH_RUNNING; index++)
+    {
+        const sim_sensor_t * p_sensor = p_running[index];
+        const data_id_t      data_id  = sim_fixture_instance(p_sensor);
+        const uint64_t       gap      = bench_mode_switch_max_gap(data_id, from);
+
+        values      += sim_sensor_stats(p_sensor)->values;
+        connections += sim_sensor_stats(p_sensor)->connections;
+        received    += sim_fixture_count_frames(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, from);
+        if(gap > gap_max)
+        {
+            gap_max = gap;
+        }
+    }
+    sim_fixture_read_stats(&stats, true);
+
+    bench_metric("switches", switches ? (2 * BENCH_MODE_SWITCH_CYCLES) : 0);
+    bench_metric("onboarded", onboarded);
+    bench_metric("onboard_avg_ms", (onboarded != 0) ? ((double)onboard_sum / onboarded / SIM_US_PER_MS) : 0);
+    bench_metric("running_reconnections", connections);
+    bench_metric("running_gap_max_ms", (double)gap_max / SIM_US_PER_MS);
+    bench_metric("running_values_received_ratio", (values != 0) ? ((double)received / values) : 0);
+    bench_metric("mode_switch_count", stats.path[STATS_PATH_MODE_SWITCH].count);
+}
+
+BENCH(mode_switch_running_5)
+{
+    bench_mode_switch_run(true);
+}
+
+BENCH(mode_switch_none_running_5)
+{
+    bench_mode_switch_run(false);
+}
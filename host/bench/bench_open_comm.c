@@ -0,0 +1,128 @@
+/** @file   bench_open_comm.c
+ *  @brief  Bring-up time per reconnect of a sensor served over the open Relayr
+ *          service without security setup, against the same sensor secured
+ *          with stored keys and paired again on every reconnect.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "app_timer.h"
+
+#define BENCH_OPEN_COMM_ROUNDS      20
+#define BENCH_OPEN_COMM_OFF_US      SIM_S(10)     /**< Longer than supervision timeout. */
+#define BENCH_OPEN_COMM_TIMEOUT_US  SIM_S(60)
+
+#define BENCH_OPEN_COMM_TICKS_TO_MS(ticks)  ((double)(ticks) * 1000 / APP_TIMER_CLOCK_FREQ)
+
+/**@brief Security of sensor on reconnect. */
+typedef enum
+{
+    BENCH_OPEN_COMM_OPEN,          /**< Open service, allowed by host. */
+    BENCH_OPEN_COMM_RESUME,        /**< Relayr service, encrypted with stored keys. */
+    BENCH_OPEN_COMM_PAIR           /**< Relayr service, sensor forgets bond while off. */
+}
+bench_open_comm_path_t;
+
+static int bench_open_comm_compare(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Onboarded LIGHT is powered off and on in rounds. Bring-up time is from connection to
+ *        running state of the connection which reached it.
+ *
+ * @param[in] path       Security of sensor.
+ * @param[in] link_loss  Probability that connection event fails.
+ */
+
+static void bench_open_comm_run(bench_open_comm_path_t path, double link_loss)
+{
+    static uint64_t  bringup[BENCH_OPEN_COMM_ROUNDS];
+    sim_sensor_t   * p_light;
+    stats_block_t    stats;
+    uint32_t         att_requests;
+    uint8_t          round;
+
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_LIGHT);
+
+        cfg.mode      = (path == BENCH_OPEN_COMM_OPEN) ? SIM_SENSOR_OPEN : SIM_SENSOR_SECURED;
+        cfg.link_loss = link_loss;
+        p_light       = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_set_open_comm(DATA_ID_DEV_LIGHT, path == BENCH_OPEN_COMM_OPEN);
+    sim_fixture_run();
+    if(sim_fixture_wait_running(p_light, BENCH_OPEN_COMM_TIMEOUT_US) == UINT64_MAX)
+    {
+        sim_fail("sensor not running");
+    }
+    sim_fixture_read_stats(&stats, true);
+    att_requests = sim_sensor_stats(p_light)->att_requests;
+
+    bench_measure_start();
+    for(round = 0; round < BENCH_OPEN_COMM_ROUNDS; round++)
+    {
+        sim_sensor_set_power(p_light, false);
+        if(path == BENCH_OPEN_COMM_PAIR)
+        {
+            sim_sensor_forget_bond(p_light);
+        }
+        sim_run_for(BENCH_OPEN_COMM_OFF_US);
+        sim_sensor_set_power(p_light, true);
+        if(sim_fixture_wait_running(p_light, BENCH_OPEN_COMM_TIMEOUT_US) == UINT64_MAX)
+        {
+            sim_fail("sensor not running in round %u", round);
+        }
+        bringup[round] = sim_now() - sim_sensor_stats(p_light)->connected_us;
+    }
+    bench_measure_stop();
+    sim_fixture_read_stats(&stats, true);
+    qsort(bringup, BENCH_OPEN_COMM_ROUNDS, sizeof(uint64_t), bench_open_comm_compare);
+
+    bench_metric("link_loss", link_loss);
+    bench_metric("reconnects", BENCH_OPEN_COMM_ROUNDS);
+    bench_metric("bringup_p50_ms", (double)bringup[(BENCH_OPEN_COMM_ROUNDS - 1) / 2] / SIM_US_PER_MS);
+    bench_metric("bringup_max_ms", (double)bringup[BENCH_OPEN_COMM_ROUNDS - 1] / SIM_US_PER_MS);
+    bench_metric("bringup_open_count", stats.bringup_open.count);
+    bench_metric("bringup_open_avg_ms", (stats.bringup_open.count != 0) ?
+                                        (BENCH_OPEN_COMM_TICKS_TO_MS(stats.bringup_open.total_ticks) / stats.bringup_open.count) : 0);
+    bench_metric("bringup_secure_count", stats.bringup_secure.count);
+    bench_metric("bringup_secure_avg_ms", (stats.bringup_secure.count != 0) ?
+                                          (BENCH_OPEN_COMM_TICKS_TO_MS(stats.bringup_secure.total_ticks) / stats.bringup_secure.count) : 0);
+    bench_metric("att_requests_per_bringup", (double)(sim_sensor_stats(p_light)->att_requests - att_requests) / BENCH_OPEN_COMM_ROUNDS);
+    bench_metric("pairings", sim_sensor_stats(p_light)->pairings);
+    bench_metric("encryptions", sim_sensor_stats(p_light)->encryptions);
+}
+
+BENCH(open_comm_bringup_open)
+{
+    bench_open_comm_run(BENCH_OPEN_COMM_OPEN, 0.0);
+}
+
+BENCH(open_comm_bringup_resume)
+{
+    bench_open_comm_run(BENCH_OPEN_COMM_RESUME, 0.0);
+}
+
+BENCH(open_comm_bringup_pair)
+{
+    bench_open_comm_run(BENCH_OPEN_COMM_PAIR, 0.0);
+}
+
+BENCH(open_comm_bringup_open_loss_30)
+{
+    bench_open_comm_run(BENCH_OPEN_COMM_OPEN, 0.3);
+}
+
+BENCH(open_comm_bringup_resume_loss_30)
+{
+    bench_open_comm_run(BENCH_OPEN_COMM_RESUME, 0.3);
+}
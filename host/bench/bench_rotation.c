@@ -0,0 +1,209 @@
+/** @file   bench_rotation.c
+ *  @brief  Data freshness and throughput of most sensors one master is
+ *          configured for, every instance slot taken and every other type
+ *          present, rotated through the links with different periods, against
+ *          all of them asking to stay connected.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+#include "app_timer.h"
+#include "sensor_slots.h"
+
+#define BENCH_ROTATION_MULTI       (SENSOR_SLOTS_NUM / SENSOR_INSTANCES_MAX)    /**< Types with every instance, they take all slots. */
+#define BENCH_ROTATION_SENSORS     (SENSOR_SLOTS_NUM + SENSOR_TYPES_NUM - BENCH_ROTATION_MULTI)
+#define BENCH_ROTATION_WINDOW_S    3
+#define BENCH_ROTATION_ONBOARD_US  SIM_S(900)
+#define BENCH_ROTATION_RUN_US      SIM_S(600)
+#define BENCH_ROTATION_SAMPLE_US   SIM_S(1)
+
+static sim_sensor_t * bench_rotation_sensors[BENCH_ROTATION_SENSORS];
+
+/**@brief Sensors of first types are all their instances, each further type has instance 0 only. */
+static data_id_t bench_rotation_data_id(uint8_t index)
+{
+    if(index < SENSOR_SLOTS_NUM)
+    {
+        return DATA_ID_INSTANCE(index / SENSOR_INSTANCES_MAX, index % SENSOR_INSTANCES_MAX);
+    }
+    return DATA_ID_INSTANCE(BENCH_ROTATION_MULTI + index - SENSOR_SLOTS_NUM, 0);
+}
+
+/**@brief Sensor index of data ID, inverse of bench_rotation_data_id(). */
+static uint8_t bench_rotation_index(data_id_t data_id)
+{
+    if(DATA_ID_GET_TYPE(data_id) < BENCH_ROTATION_MULTI)
+    {
+        return (DATA_ID_GET_TYPE(data_id) * SENSOR_INSTANCES_MAX) + DATA_ID_GET_INSTANCE(data_id);
+    }
+    return SENSOR_SLOTS_NUM + DATA_ID_GET_TYPE(data_id) - BENCH_ROTATION_MULTI;
+}
+
+static bool bench_rotation_all_connected(void * p_ctx)
+{
+    uint8_t index;
+
+    (void)p_ctx;
+    for(index = 0; index < BENCH_ROTATION_SENSORS; index++)
+    {
+        if(sim_sensor_stats(bench_rotation_sensors[index])->connections == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int bench_rotation_compare(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Every second, age of the newest value the host holds of each sensor sending values is sampled.
+ *        Sensor whose value never reached the host counts with age since the start of measurement.
+ *
+ * @param[in] period_s  Rotation period, 0 if sensors stay connected.
+ */
+
+static void bench_rotation_run(uint16_t period_s)
+{
+    static uint64_t ages[(BENCH_ROTATION_RUN_US / BENCH_ROTATION_SAMPLE_US) * BENCH_ROTATION_SENSORS];
+    char            passkeys[BENCH_ROTATION_SENSORS][sizeof(passkey_t)];
+    uint64_t        generated[BENCH_ROTATION_SENSORS];
+    uint32_t        connections = 0;
+    uint32_t        values      = 0;
+    uint8_t         served      = 0;
+    size_t          count       = 0;
+    stats_block_t   stats;
+    uint64_t        start;
+    size_t          next;
+    uint8_t         index;
+
+    for(index = 0; index < BENCH_ROTATION_SENSORS; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_GET_TYPE(bench_rotation_data_id(index)));
+
+        (void)snprintf(passkeys[index], sizeof(passkeys[index]), "1000%02u", index);
+        cfg.p_passkey                 = passkeys[index];
+        bench_rotation_sensors[index] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    for(index = 0; index < BENCH_ROTATION_SENSORS; index++)
+    {
+        sim_fixture_set_passkey(bench_rotation_data_id(index), passkeys[index]);
+        if(period_s != 0)
+        {
+            sim_fixture_set_rotation(bench_rotation_data_id(index), period_s, BENCH_ROTATION_WINDOW_S);
+        }
+        sim_run_for(SIM_MS(20));
+    }
+
+    start = sim_now();
+    sim_fixture_run();
+    if(period_s != 0)
+    {
+        if(sim_run_until_cond(bench_rotation_all_connected, NULL, BENCH_ROTATION_ONBOARD_US) == false)
+        {
+            sim_fail("sensors not connected");
+        }
+        bench_metric("onboard_all_s", (double)(sim_now() - start) / SIM_US_PER_S);
+    }
+    sim_run_for((period_s != 0) ? SIM_S(period_s) : SIM_S(60));
+
+    for(index = 0; index < BENCH_ROTATION_SENSORS; index++)
+    {
+        generated[index]  = sim_now();
+        connections      -= sim_sensor_stats(bench_rotation_sensors[index])->connections;
+    }
+    next  = sim_kinetis_frame_count();
+    start = sim_now();
+
+    bench_measure_start();
+    while(sim_now() < (start + BENCH_ROTATION_RUN_US))
+    {
+        sim_run_for(BENCH_ROTATION_SAMPLE_US);
+
+        for(; next < sim_kinetis_frame_count(); next++)
+        {
+            const sim_kinetis_frame_t * p_frame = sim_kinetis_frame(next);
+            const data_id_t             data_id = (data_id_t)p_frame->frame.data_id;
+            uint8_t                     sensor;
+            uint64_t                    time;
+
+            if( (DATA_ID_IS_SENSOR(data_id) == false) || (p_frame->frame.field_id != FIELD_ID_CHAR_SENSOR_DATA_R) )
+            {
+                continue;
+            }
+            sensor = bench_rotation_index(data_id);
+            time   = sim_sensor_value_time(bench_rotation_sensors[sensor],
+                                           sim_sensor_value_seq(p_frame->frame.data, sensors_get_msg_size(DATA_ID_GET_TYPE(data_id), FIELD_ID_CHAR_SENSOR_DATA_R)));
+            if(time > generated[sensor])
+            {
+                generated[sensor] = time;
+            }
+            values++;
+        }
+
+        for(index = 0; index < BENCH_ROTATION_SENSORS; index++)
+        {
+            if(DATA_ID_GET_TYPE(bench_rotation_data_id(index)) != DATA_ID_DEV_IR)
+            {
+                ages[count++] = sim_now() - generated[index];
+            }
+        }
+    }
+    bench_measure_stop();
+
+    for(index = 0; index < BENCH_ROTATION_SENSORS; index++)
+    {
+        const uint32_t sensor_connections = sim_sensor_stats(bench_rotation_sensors[index])->connections;
+
+        connections += sensor_connections;
+        if(sim_sensor_connected(bench_rotation_sensors[index]) || (sensor_connections > 0))
+        {
+            served++;
+        }
+    }
+    sim_fixture_read_stats(&stats, true);
+    qsort(ages, count, sizeof(uint64_t), bench_rotation_compare);
+
+    bench_metric("sensors", BENCH_ROTATION_SENSORS);
+    bench_metric("links", MAX_CLIENTS);
+    bench_metric("sensors_served", served);
+    bench_metric("values_per_s", (double)values * SIM_US_PER_S / BENCH_ROTATION_RUN_US);
+    bench_metric("freshness_p50_s", (double)ages[((count - 1) * 50) / 100] / SIM_US_PER_S);
+    bench_metric("freshness_p90_s", (double)ages[((count - 1) * 90) / 100] / SIM_US_PER_S);
+    bench_metric("freshness_max_s", (double)ages[count - 1] / SIM_US_PER_S);
+    bench_metric("connections_per_min", (double)connections * 60 * SIM_US_PER_S / BENCH_ROTATION_RUN_US);
+    bench_metric("rotation_cycles", stats.rotation_cycles);
+    bench_metric("rotation_lag_max_ms", (double)stats.rotation_lag_ticks * 1000 / APP_TIMER_CLOCK_FREQ);
+    bench_metric("secure_resumed", stats.secure_resume.count);
+    bench_metric("secure_paired", stats.secure_pair.count);
+}
+
+BENCH(rotation_none)
+{
+    bench_rotation_run(0);
+}
+
+BENCH(rotation_period_30s)
+{
+    bench_rotation_run(30);
+}
+
+BENCH(rotation_period_60s)
+{
+    bench_rotation_run(60);
+}
+
+BENCH(rotation_period_120s)
+{
+    bench_rotation_run(120);
+}
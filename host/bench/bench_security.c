@@ -0,0 +1,127 @@
+/** @file   bench_security.c
+ *  @brief  Security setup time per reconnect of a bonded sensor: encryption
+ *          resumed with stored keys against passkey pairing of a sensor which
+ *          lost its bond, with and without lost connection events.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "app_timer.h"
+
+#define BENCH_SECURITY_ROUNDS      20
+#define BENCH_SECURITY_OFF_US      SIM_S(10)     /**< Longer than supervision timeout. */
+#define BENCH_SECURITY_TIMEOUT_US  SIM_S(60)
+
+#define BENCH_SECURITY_TICKS_TO_MS(ticks)  ((double)(ticks) * 1000 / APP_TIMER_CLOCK_FREQ)
+
+static int bench_security_compare(const void * p_a, const void * p_b)
+{
+    const uint64_t a = *(const uint64_t *)p_a;
+    const uint64_t b = *(const uint64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+/**@brief Onboarded HTU is powered off and on in rounds. Security time is from connection to
+ *        secured link, bring-up time from connection to running state, both of the connection
+ *        which reached running state. Reconnect time is from power on to running state and
+ *        includes the connection closed after stored keys were rejected.
+ *
+ * @param[in] forget     Sensor forgets its bond while off, so it is paired on every reconnect.
+ * @param[in] link_loss  Probability that connection event fails.
+ */
+
+static void bench_security_run(bool forget, double link_loss)
+{
+    static uint64_t  secure[BENCH_SECURITY_ROUNDS];
+    static uint64_t  bringup[BENCH_SECURITY_ROUNDS];
+    static uint64_t  reconnect[BENCH_SECURITY_ROUNDS];
+    sim_sensor_t   * p_htu;
+    stats_block_t    stats;
+    uint32_t         connections;
+    uint8_t          round;
+
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        cfg.link_loss = link_loss;
+        p_htu         = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    if(sim_fixture_wait_running(p_htu, BENCH_SECURITY_TIMEOUT_US) == UINT64_MAX)
+    {
+        sim_fail("sensor not running");
+    }
+    sim_fixture_read_stats(&stats, true);
+    connections = sim_sensor_stats(p_htu)->connections;
+
+    bench_measure_start();
+    for(round = 0; round < BENCH_SECURITY_ROUNDS; round++)
+    {
+        const sim_sensor_stats_t * p_stats = sim_sensor_stats(p_htu);
+
+        sim_sensor_set_power(p_htu, false);
+        if(forget)
+        {
+            sim_sensor_forget_bond(p_htu);
+        }
+        sim_run_for(BENCH_SECURITY_OFF_US);
+        sim_sensor_set_power(p_htu, true);
+        reconnect[round] = sim_fixture_wait_running(p_htu, BENCH_SECURITY_TIMEOUT_US);
+        if(reconnect[round] == UINT64_MAX)
+        {
+            sim_fail("sensor not running in round %u", round);
+        }
+        secure[round]  = p_stats->secured_us - p_stats->connected_us;
+        bringup[round] = sim_now() - p_stats->connected_us;
+    }
+    bench_measure_stop();
+    sim_fixture_read_stats(&stats, true);
+    qsort(secure, BENCH_SECURITY_ROUNDS, sizeof(uint64_t), bench_security_compare);
+    qsort(bringup, BENCH_SECURITY_ROUNDS, sizeof(uint64_t), bench_security_compare);
+    qsort(reconnect, BENCH_SECURITY_ROUNDS, sizeof(uint64_t), bench_security_compare);
+
+    bench_metric("link_loss", link_loss);
+    bench_metric("reconnects", BENCH_SECURITY_ROUNDS);
+    bench_metric("connections", sim_sensor_stats(p_htu)->connections - connections);
+    bench_metric("encryptions", sim_sensor_stats(p_htu)->encryptions);
+    bench_metric("pairings", sim_sensor_stats(p_htu)->pairings - 1);
+    bench_metric("secure_p50_ms", (double)secure[(BENCH_SECURITY_ROUNDS - 1) / 2] / SIM_US_PER_MS);
+    bench_metric("secure_max_ms", (double)secure[BENCH_SECURITY_ROUNDS - 1] / SIM_US_PER_MS);
+    bench_metric("bringup_p50_ms", (double)bringup[(BENCH_SECURITY_ROUNDS - 1) / 2] / SIM_US_PER_MS);
+    bench_metric("bringup_max_ms", (double)bringup[BENCH_SECURITY_ROUNDS - 1] / SIM_US_PER_MS);
+    bench_metric("reconnect_p50_ms", (double)reconnect[(BENCH_SECURITY_ROUNDS - 1) / 2] / SIM_US_PER_MS);
+    bench_metric("reconnect_max_ms", (double)reconnect[BENCH_SECURITY_ROUNDS - 1] / SIM_US_PER_MS);
+    bench_metric("secure_resume_count", stats.secure_resume.count);
+    bench_metric("secure_resume_avg_ms", (stats.secure_resume.count != 0) ?
+                                         (BENCH_SECURITY_TICKS_TO_MS(stats.secure_resume.total_ticks) / stats.secure_resume.count) : 0);
+    bench_metric("secure_pair_count", stats.secure_pair.count);
+    bench_metric("secure_pair_avg_ms", (stats.secure_pair.count != 0) ?
+                                       (BENCH_SECURITY_TICKS_TO_MS(stats.secure_pair.total_ticks) / stats.secure_pair.count) : 0);
+    bench_metric("conn_events_lost", sim_softdevice_stats()->conn_events_lost);
+}
+
+BENCH(security_reconnect_resume)
+{
+    bench_security_run(false, 0.0);
+}
+
+BENCH(security_reconnect_pair)
+{
+    bench_security_run(true, 0.0);
+}
+
+BENCH(security_reconnect_resume_loss_30)
+{
+    bench_security_run(false, 0.3);
+}
+
+BENCH(security_reconnect_pair_loss_30)
+{
+    bench_security_run(true, 0.3);
+}
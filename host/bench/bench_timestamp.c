@@ -0,0 +1,115 @@
+/** @file   bench_timestamp.c
+ *  @brief  Queueing delay of sensor values at the master, from stamp taken on
+ *          notification to end of SPI transaction, as histogram and percentiles.
+ *          Stamp unit is ~0.98 ms and stamps are truncated, delays below it are
+ *          resolution of the stamp rather than queueing.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include "bench.h"
+#include "sim_fixture.h"
+
+#define BENCH_STAMP_WINDOW_US    SIM_S(60)
+#define BENCH_STAMP_BRINGUP_US   SIM_S(60)
+#define BENCH_STAMP_BUCKETS      9
+
+/**@brief Period of DATA_R values, fast enough for sensors to compete for SPI. */
+static const uint32_t bench_stamp_notify_ms[] =
+{
+    [DATA_ID_DEV_HTU]    = 1000,
+    [DATA_ID_DEV_GYRO]   = 20,
+    [DATA_ID_DEV_LIGHT]  = 50,
+    [DATA_ID_DEV_SOUND]  = 20,
+    [DATA_ID_DEV_BRIDGE] = 20,
+    [DATA_ID_DEV_IR]     = 0,
+};
+
+/**@brief Upper bounds of histogram buckets, last one is open. */
+static const uint32_t     bench_stamp_bucket_us[BENCH_STAMP_BUCKETS - 1] = { 250, 500, 1000, 2000, 5000, 10000, 20000, 50000 };
+static const char * const bench_stamp_bucket_names[BENCH_STAMP_BUCKETS] =
+{
+    "queue_delay_lt_250us", "queue_delay_lt_500us", "queue_delay_lt_1ms",  "queue_delay_lt_2ms", "queue_delay_lt_5ms",
+    "queue_delay_lt_10ms",  "queue_delay_lt_20ms",  "queue_delay_lt_50ms", "queue_delay_ge_50ms",
+};
+
+static int bench_stamp_compare(const void * p_a, const void * p_b)
+{
+    const int64_t a = *(const int64_t *)p_a;
+    const int64_t b = *(const int64_t *)p_b;
+
+    return (a > b) - (a < b);
+}
+
+BENCH(queueing_delay)
+{
+    const sim_kinetis_frame_t * p_frame;
+    sim_kinetis_frame_t         sync;
+    uint32_t                    histogram[BENCH_STAMP_BUCKETS] = { 0 };
+    int64_t                   * p_delays;
+    size_t                      count = 0;
+    size_t                      from;
+    size_t                      index;
+    uint8_t                     bucket;
+    data_id_t                   type;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+        cfg.notify_interval_ms = bench_stamp_notify_ms[type];
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_STAMP_BRINGUP_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    sim_kinetis_link_enable();
+    sim_run_for(SIM_MS(10));
+    sync = *sim_fixture_time_sync();
+
+    from = sim_kinetis_frame_count();
+    bench_measure_start();
+    sim_run_for(BENCH_STAMP_WINDOW_US);
+    bench_measure_stop();
+
+    // Delays of stamped DATA_R frames received in window.
+    p_delays = malloc(sizeof(int64_t) * (sim_kinetis_frame_count() - from + 1));
+    for(index = from; index < sim_kinetis_frame_count(); index++)
+    {
+        p_frame = sim_kinetis_frame(index);
+        if( (p_frame->frame.field_id != FIELD_ID_CHAR_SENSOR_DATA_R) || (p_frame->stamped == false) )
+        {
+            continue;
+        }
+        p_delays[count] = (int64_t)p_frame->time - sim_fixture_stamp_time(&sync, p_frame);
+        for(bucket = 0; bucket < (BENCH_STAMP_BUCKETS - 1); bucket++)
+        {
+            if(p_delays[count] < (int64_t)bench_stamp_bucket_us[bucket])
+            {
+                break;
+            }
+        }
+        histogram[bucket]++;
+        count++;
+    }
+    if(count == 0)
+    {
+        sim_fail("no stamped values");
+    }
+    qsort(p_delays, count, sizeof(int64_t), bench_stamp_compare);
+
+    bench_metric("stamped_values", count);
+    bench_metric("queue_delay_p50_us", p_delays[((count - 1) * 50) / 100]);
+    bench_metric("queue_delay_p90_us", p_delays[((count - 1) * 90) / 100]);
+    bench_metric("queue_delay_p99_us", p_delays[((count - 1) * 99) / 100]);
+    bench_metric("queue_delay_max_us", p_delays[count - 1]);
+    for(bucket = 0; bucket < BENCH_STAMP_BUCKETS; bucket++)
+    {
+        bench_metric(bench_stamp_bucket_names[bucket], histogram[bucket]);
+    }
+    free(p_delays);
+}
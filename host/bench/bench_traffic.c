@@ -0,0 +1,231 @@
+/** @file   bench_traffic.c
+ *  @brief  Traffic scenarios: six sensors streaming, reconnect storms, onboarding,
+ *          BRIDGE bursts and dense advertising environment.
+ */
+
+/* -- Includes -- */
+
+#include "bench.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+
+#define BENCH_WINDOW_US          SIM_S(60)
+#define BENCH_BRINGUP_US         SIM_S(60)
+#define BENCH_NOISE_SENSORS      24
+#define BENCH_NOISE_ADV_MS       20
+#define BENCH_STORM_PERIOD_US    SIM_S(120)
+#define BENCH_STORM_OFF_US       SIM_S(5)
+#define BENCH_BURST_PERIOD_US    SIM_S(5)
+#define BENCH_BURST_US           SIM_S(1)
+#define BENCH_BURST_INTERVAL_MS  10
+
+/**@brief Period of DATA_R values of six sensors, IR has no DATA_R. */
+static const uint32_t bench_notify_ms[] =
+{
+    [DATA_ID_DEV_HTU]    = 1000,
+    [DATA_ID_DEV_GYRO]   = 100,
+    [DATA_ID_DEV_LIGHT]  = 200,
+    [DATA_ID_DEV_SOUND]  = 100,
+    [DATA_ID_DEV_BRIDGE] = 500,
+    [DATA_ID_DEV_IR]     = 0,
+};
+
+static sim_sensor_t * bench_sensors[DATA_ID_DEV_IR + 1];
+
+static void bench_six_sensors_add(sim_sensor_mode_t mode)
+{
+    data_id_t type;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+        cfg.mode               = mode;
+        cfg.notify_interval_ms = bench_notify_ms[type];
+        bench_sensors[type]    = sim_sensor_add(&cfg);
+    }
+}
+
+/**@brief Boot, select running mode and wait until all sensors stream. */
+
+static void bench_six_sensors_run(void)
+{
+    uint64_t start;
+
+    sim_fixture_boot();
+    start = sim_now();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_BRINGUP_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    bench_metric("bringup_all_ms", (double)(sim_now() - start) / SIM_US_PER_MS);
+
+    // Device information is read before values are forwarded.
+    sim_run_for(SIM_S(5));
+}
+
+static void bench_six_sensors_power(bool on)
+{
+    data_id_t type;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_set_power(bench_sensors[type], on);
+    }
+}
+
+BENCH(six_sensors_streaming)
+{
+    bench_six_sensors_add(SIM_SENSOR_SECURED);
+    bench_six_sensors_run();
+
+    bench_measure_start();
+    sim_run_for(BENCH_WINDOW_US);
+    bench_measure_stop();
+}
+
+BENCH(reconnect_storm)
+{
+    uint64_t recovery_max = 0;
+    uint64_t recovery_sum = 0;
+    uint32_t storms       = 0;
+    uint64_t end;
+
+    bench_six_sensors_add(SIM_SENSOR_SECURED);
+    bench_six_sensors_run();
+
+    // All sensors drop their links at once and come back, e.g. after power outage.
+    bench_measure_start();
+    end = sim_now() + (3 * BENCH_STORM_PERIOD_US);
+    while(sim_now() < end)
+    {
+        const uint64_t storm_end = sim_now() + BENCH_STORM_PERIOD_US;
+        uint64_t       back;
+
+        bench_six_sensors_power(false);
+        sim_run_for(BENCH_STORM_OFF_US);
+        bench_six_sensors_power(true);
+        back = sim_now();
+        if(sim_fixture_wait_all_running(storm_end - back) == false)
+        {
+            sim_fail("sensors not running after storm %u", storms);
+        }
+
+        recovery_sum += sim_now() - back;
+        if((sim_now() - back) > recovery_max)
+        {
+            recovery_max = sim_now() - back;
+        }
+        storms++;
+        sim_run_until(storm_end);
+    }
+    bench_measure_stop();
+
+    bench_metric("storms", storms);
+    bench_metric("recovery_avg_ms", (double)recovery_sum / storms / SIM_US_PER_MS);
+    bench_metric("recovery_max_ms", (double)recovery_max / SIM_US_PER_MS);
+    bench_metric("connections", sim_softdevice_stats()->connections);
+    bench_metric("connect_timeouts", sim_softdevice_stats()->connect_timeouts);
+}
+
+BENCH(onboarding)
+{
+    const uint64_t timeout = BENCH_BRINGUP_US;
+    uint32_t       done    = 0;
+    uint64_t       start;
+    size_t         from;
+    data_id_t      type;
+
+    bench_six_sensors_add(SIM_SENSOR_CONFIG);
+    sim_fixture_boot();
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_fixture_set_passkey(type, "246810");
+    }
+    sim_run_for(SIM_MS(100));
+
+    bench_measure_start();
+    start = sim_now();
+    from  = sim_kinetis_frame_count();
+    sim_fixture_config();
+
+    // Every sensor gets new passkey and is reported with FIELD_ID_ONBOARD_DONE.
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        const uint64_t spent = sim_now() - start;
+
+        if( (spent < timeout) && (sim_kinetis_wait(type, FIELD_ID_ONBOARD_DONE, from, timeout - spent) != NULL) )
+        {
+            done++;
+        }
+    }
+    bench_measure_stop();
+
+    if(done != (DATA_ID_DEV_IR + 1))
+    {
+        sim_fail("%u of %u sensors onboarded", done, DATA_ID_DEV_IR + 1);
+    }
+    bench_metric("onboard_all_ms", (double)(sim_now() - start) / SIM_US_PER_MS);
+    bench_metric("pairings", sim_softdevice_stats()->pairings);
+    bench_metric("gattc_requests", sim_softdevice_stats()->gattc_requests);
+}
+
+BENCH(bridge_bursts)
+{
+    uint32_t bursts = 0;
+    uint64_t end;
+
+    bench_six_sensors_add(SIM_SENSOR_SECURED);
+    bench_six_sensors_run();
+
+    // BRIDGE passes traffic of its UART peer, which arrives in bursts.
+    bench_measure_start();
+    end = sim_now() + BENCH_WINDOW_US;
+    while(sim_now() < end)
+    {
+        sim_sensor_set_notify_interval(bench_sensors[DATA_ID_DEV_BRIDGE], BENCH_BURST_INTERVAL_MS);
+        sim_run_for(BENCH_BURST_US);
+        sim_sensor_set_notify_interval(bench_sensors[DATA_ID_DEV_BRIDGE], bench_notify_ms[DATA_ID_DEV_BRIDGE]);
+        sim_run_for(BENCH_BURST_PERIOD_US - BENCH_BURST_US);
+        bursts++;
+    }
+    bench_measure_stop();
+
+    bench_metric("bursts", bursts);
+    bench_metric("bridge_values_lost_on_air", sim_sensor_stats(bench_sensors[DATA_ID_DEV_BRIDGE])->notify_overflow);
+}
+
+BENCH(dense_advertising)
+{
+    uint64_t start;
+    uint32_t index;
+
+    bench_six_sensors_add(SIM_SENSOR_SECURED);
+
+    // Foreign devices advertise fast around the master.
+    for(index = 0; index < BENCH_NOISE_SENSORS; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        cfg.mode            = SIM_SENSOR_NOISE;
+        cfg.p_name          = "Foreign";
+        cfg.adv_interval_ms = BENCH_NOISE_ADV_MS;
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+
+    // Scanning runs until all sensors are connected, window covers bring-up.
+    bench_measure_start();
+    start = sim_now();
+    sim_fixture_run();
+    if(sim_fixture_wait_all_running(BENCH_BRINGUP_US) == false)
+    {
+        sim_fail("sensors not running");
+    }
+    bench_metric("bringup_all_ms", (double)(sim_now() - start) / SIM_US_PER_MS);
+    sim_run_for(BENCH_WINDOW_US);
+    bench_measure_stop();
+
+    bench_metric("adv_reports_dropped", sim_softdevice_stats()->adv_reports_dropped);
+}
@@ -0,0 +1,8 @@
+/** @file   app_gpiote.h
+ *  @brief  Host build stand-in, nothing of app_gpiote.h is used by the firmware.
+ */
+
+#ifndef APP_GPIOTE_H__
+#define APP_GPIOTE_H__
+
+#endif // APP_GPIOTE_H__
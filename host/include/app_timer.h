@@ -0,0 +1,72 @@
+/** @file   app_timer.h
+ *  @brief  Host build stand-in for SDK application timer, timers run on virtual
+ *          RTC1, see host/sim/sim_timer.c.
+ */
+
+#ifndef APP_TIMER_H__
+#define APP_TIMER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "app_error.h"
+
+#define APP_TIMER_CLOCK_FREQ          32768     /**< Clock frequency of the RTC timer used to implement the app timer module. */
+#define APP_TIMER_MIN_TIMEOUT_TICKS   5         /**< Minimum value of the timeout_ticks parameter of app_timer_start(). */
+#define APP_TIMER_NODE_SIZE           40
+#define APP_TIMER_USER_OP_SIZE        24
+#define APP_TIMER_USER_SIZE           8
+#define APP_TIMER_INT_LEVELS          3
+
+#define APP_TIMER_BUF_SIZE(MAX_TIMERS, OP_QUEUE_SIZE)                                \
+    (                                                                                \
+        ((MAX_TIMERS) * APP_TIMER_NODE_SIZE)                                         \
+        +                                                                            \
+        (                                                                            \
+            APP_TIMER_INT_LEVELS                                                     \
+            *                                                                        \
+            (APP_TIMER_USER_SIZE + ((OP_QUEUE_SIZE) + 1) * APP_TIMER_USER_OP_SIZE)   \
+        )                                                                            \
+    )
+
+#define APP_TIMER_TICKS(MS, PRESCALER)                                               \
+            ((uint32_t)(((MS) * (uint64_t)APP_TIMER_CLOCK_FREQ) / (((PRESCALER) + 1) * 1000)))
+
+typedef uint32_t app_timer_id_t;
+
+typedef void (*app_timer_timeout_handler_t)(void * p_context);
+
+typedef enum
+{
+    APP_TIMER_MODE_SINGLE_SHOT,
+    APP_TIMER_MODE_REPEATED
+}
+app_timer_mode_t;
+
+#define APP_TIMER_INIT(PRESCALER, MAX_TIMERS, OP_QUEUES_SIZE, USE_SCHEDULER)         \
+    do                                                                               \
+    {                                                                                \
+        static uint32_t APP_TIMER_BUF[(APP_TIMER_BUF_SIZE((MAX_TIMERS),              \
+                                                          (OP_QUEUES_SIZE) + 1)      \
+                                       + sizeof(uint32_t) - 1) / sizeof(uint32_t)];  \
+        uint32_t ERR_CODE = app_timer_init((PRESCALER),                              \
+                                           (MAX_TIMERS),                             \
+                                           (OP_QUEUES_SIZE) + 1,                     \
+                                           APP_TIMER_BUF,                            \
+                                           NULL);                                    \
+        APP_ERROR_CHECK(ERR_CODE);                                                   \
+    } while (0)
+
+typedef uint32_t (*app_timer_evt_schedule_func_t) (app_timer_timeout_handler_t timeout_handler, void * p_context);
+
+uint32_t app_timer_init(uint32_t prescaler, uint8_t max_timers, uint8_t op_queues_size,
+                        void * p_buffer, app_timer_evt_schedule_func_t evt_schedule_func);
+uint32_t app_timer_create(app_timer_id_t * p_timer_id, app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler);
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context);
+uint32_t app_timer_stop(app_timer_id_t timer_id);
+uint32_t app_timer_stop_all(void);
+uint32_t app_timer_cnt_get(uint32_t * p_ticks);
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t * p_ticks_diff);
+
+#endif // APP_TIMER_H__
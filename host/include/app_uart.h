@@ -0,0 +1,8 @@
+/** @file   app_uart.h
+ *  @brief  Host build stand-in, nothing of app_uart.h is used by the firmware.
+ */
+
+#ifndef APP_UART_H__
+#define APP_UART_H__
+
+#endif // APP_UART_H__
@@ -0,0 +1,24 @@
+/** @file   app_util_platform.h
+ *  @brief  Host build stand-in for SDK platform utilities. Critical region is
+ *          tracked by the simulator, interrupts are held back while it is entered.
+ */
+
+#ifndef APP_UTIL_PLATFORM_H__
+#define APP_UTIL_PLATFORM_H__
+
+#include <stdint.h>
+#include "nrf_soc.h"
+
+#define APP_IRQ_PRIORITY_HIGH  1
+#define APP_IRQ_PRIORITY_LOW   3
+
+#define CRITICAL_REGION_ENTER()                                                      \
+    {                                                                                \
+        uint8_t IS_NESTED_CRITICAL_REGION = 0;                                       \
+        sd_nvic_critical_region_enter(&IS_NESTED_CRITICAL_REGION);
+
+#define CRITICAL_REGION_EXIT()                                                       \
+        sd_nvic_critical_region_exit(IS_NESTED_CRITICAL_REGION);                     \
+    }
+
+#endif // APP_UTIL_PLATFORM_H__
@@ -0,0 +1,75 @@
+/** @file   ble.h
+ *  @brief  Host build stand-in for SoftDevice S120 BLE event definitions.
+ */
+
+#ifndef BLE_H__
+#define BLE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nrf.h"
+#include "nrf_error.h"
+#include "app_error.h"
+#include "nordic_common.h"
+#include "ble_types.h"
+#include "ble_gap.h"
+#include "ble_gattc.h"
+
+#define BLE_GAP_EVT_BASE       0x10
+#define BLE_GATTC_EVT_BASE     0x30
+
+/**@brief GAP Event IDs. */
+enum BLE_GAP_EVTS
+{
+    BLE_GAP_EVT_CONNECTED = BLE_GAP_EVT_BASE,
+    BLE_GAP_EVT_DISCONNECTED,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE,
+    BLE_GAP_EVT_SEC_PARAMS_REQUEST,
+    BLE_GAP_EVT_SEC_INFO_REQUEST,
+    BLE_GAP_EVT_PASSKEY_DISPLAY,
+    BLE_GAP_EVT_AUTH_KEY_REQUEST,
+    BLE_GAP_EVT_AUTH_STATUS,
+    BLE_GAP_EVT_CONN_SEC_UPDATE,
+    BLE_GAP_EVT_TIMEOUT,
+    BLE_GAP_EVT_RSSI_CHANGED,
+    BLE_GAP_EVT_ADV_REPORT,
+    BLE_GAP_EVT_SEC_REQUEST,
+    BLE_GAP_EVT_CONN_PARAM_UPDATE_REQUEST,
+    BLE_GAP_EVT_SCAN_REQ_REPORT,
+};
+
+/**@brief GATT Client Event IDs. */
+enum BLE_GATTC_EVTS
+{
+    BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP = BLE_GATTC_EVT_BASE,
+    BLE_GATTC_EVT_REL_DISC_RSP,
+    BLE_GATTC_EVT_CHAR_DISC_RSP,
+    BLE_GATTC_EVT_DESC_DISC_RSP,
+    BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP,
+    BLE_GATTC_EVT_READ_RSP,
+    BLE_GATTC_EVT_CHAR_VALS_READ_RSP,
+    BLE_GATTC_EVT_WRITE_RSP,
+    BLE_GATTC_EVT_HVX,
+    BLE_GATTC_EVT_TIMEOUT,
+};
+
+typedef struct
+{
+    uint16_t evt_id;
+    uint16_t evt_len;
+}
+ble_evt_hdr_t;
+
+typedef struct
+{
+    ble_evt_hdr_t header;
+    union
+    {
+        ble_gap_evt_t   gap_evt;
+        ble_gattc_evt_t gattc_evt;
+    } evt;
+}
+ble_evt_t;
+
+#endif // BLE_H__
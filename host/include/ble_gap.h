@@ -0,0 +1,204 @@
+/** @file   ble_gap.h
+ *  @brief  Host build stand-in for SoftDevice S120 GAP API.
+ */
+
+#ifndef BLE_GAP_H__
+#define BLE_GAP_H__
+
+#include <stdint.h>
+#include "ble_types.h"
+
+#define BLE_GAP_ADDR_LEN                                  6
+#define BLE_GAP_ADDR_TYPE_PUBLIC                          0x00
+#define BLE_GAP_ADDR_TYPE_RANDOM_STATIC                   0x01
+
+#define BLE_GAP_ADV_MAX_SIZE                              31
+#define BLE_GAP_ADV_TYPE_ADV_IND                          0x00
+
+#define BLE_GAP_AD_TYPE_FLAGS                             0x01
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_MORE_AVAILABLE 0x02
+#define BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE       0x03
+#define BLE_GAP_AD_TYPE_SHORT_LOCAL_NAME                  0x08
+#define BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME               0x09
+#define BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA        0xFF
+
+#define BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE             0x02
+#define BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED             0x04
+
+#define BLE_GAP_TIMEOUT_SRC_ADVERTISEMENT                 0x00
+#define BLE_GAP_TIMEOUT_SRC_SECURITY_REQUEST              0x01
+#define BLE_GAP_TIMEOUT_SRC_SCAN                          0x02
+#define BLE_GAP_TIMEOUT_SRC_CONN                          0x03
+
+#define BLE_GAP_IO_CAPS_DISPLAY_ONLY                      0x00
+#define BLE_GAP_IO_CAPS_DISPLAY_YESNO                     0x01
+#define BLE_GAP_IO_CAPS_KEYBOARD_ONLY                     0x02
+#define BLE_GAP_IO_CAPS_NONE                              0x03
+#define BLE_GAP_IO_CAPS_KEYBOARD_DISPLAY                  0x04
+
+#define BLE_GAP_AUTH_KEY_TYPE_NONE                        0x00
+#define BLE_GAP_AUTH_KEY_TYPE_PASSKEY                     0x01
+#define BLE_GAP_AUTH_KEY_TYPE_OOB                         0x02
+
+#define BLE_GAP_PASSKEY_LEN                               6
+
+#define BLE_GAP_SEC_STATUS_SUCCESS                        0x00
+#define BLE_GAP_SEC_STATUS_TIMEOUT                        0x01
+#define BLE_GAP_SEC_STATUS_PASSKEY_ENTRY_FAILED           0x81
+#define BLE_GAP_SEC_STATUS_AUTH_REQ                       0x83
+#define BLE_GAP_SEC_STATUS_CONFIRM_VALUE                  0x84
+#define BLE_GAP_SEC_STATUS_PAIRING_NOT_SUPP               0x85
+#define BLE_GAP_SEC_STATUS_PIN_OR_KEY_MISSING             0x86
+#define BLE_GAP_SEC_STATUS_UNSPECIFIED                    0x88
+
+#define BLE_GAP_SEC_STATUS_SOURCE_LOCAL                   0x00
+#define BLE_GAP_SEC_STATUS_SOURCE_REMOTE                  0x01
+
+typedef struct
+{
+    uint8_t addr_type;
+    uint8_t addr[BLE_GAP_ADDR_LEN];
+}
+ble_gap_addr_t;
+
+typedef struct
+{
+    uint16_t min_conn_interval;         /**< Minimum Connection Interval in 1.25 ms units. */
+    uint16_t max_conn_interval;         /**< Maximum Connection Interval in 1.25 ms units. */
+    uint16_t slave_latency;             /**< Slave Latency in number of connection events. */
+    uint16_t conn_sup_timeout;          /**< Connection Supervision Timeout in 10 ms units. */
+}
+ble_gap_conn_params_t;
+
+typedef struct
+{
+    uint8_t    active      : 1;
+    uint8_t    selective   : 1;
+    void     * p_whitelist;
+    uint16_t   interval;                /**< Scan interval in 625 us units. */
+    uint16_t   window;                  /**< Scan window in 625 us units. */
+    uint16_t   timeout;                 /**< Scan timeout in seconds, 0 disables timeout. */
+}
+ble_gap_scan_params_t;
+
+typedef struct
+{
+    uint8_t sm : 4;                     /**< Security Mode (1 or 2), 0 for no permissions at all. */
+    uint8_t lv : 4;                     /**< Level (1, 2 or 3), 0 for no permissions at all. */
+}
+ble_gap_conn_sec_mode_t;
+
+#define BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(ptr)          do {(ptr)->sm = 0; (ptr)->lv = 0;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_OPEN(ptr)               do {(ptr)->sm = 1; (ptr)->lv = 1;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(ptr)        do {(ptr)->sm = 1; (ptr)->lv = 2;} while(0)
+#define BLE_GAP_CONN_SEC_MODE_SET_ENC_WITH_MITM(ptr)      do {(ptr)->sm = 1; (ptr)->lv = 3;} while(0)
+
+typedef struct
+{
+    ble_gap_conn_sec_mode_t sec_mode;
+    uint8_t                 encr_key_size;
+}
+ble_gap_conn_sec_t;
+
+typedef struct
+{
+    uint8_t enc  : 1;
+    uint8_t id   : 1;
+    uint8_t sign : 1;
+}
+ble_gap_kdist_t;
+
+typedef struct
+{
+    uint8_t         bond         : 1;   /**< Perform bonding. */
+    uint8_t         mitm         : 1;   /**< Man In The Middle protection required. */
+    uint8_t         io_caps      : 3;   /**< IO capabilities, see BLE_GAP_IO_CAPS_*. */
+    uint8_t         oob          : 1;   /**< Out Of Band data available. */
+    uint8_t         min_key_size;
+    uint8_t         max_key_size;
+    ble_gap_kdist_t kdist_periph;       /**< Key distribution bitmap: keys that the peripheral device will distribute. */
+    ble_gap_kdist_t kdist_central;      /**< Key distribution bitmap: keys that the central device will distribute. */
+}
+ble_gap_sec_params_t;
+
+typedef struct
+{
+    ble_gap_addr_t        peer_addr;
+    uint8_t               irk_match     : 1;
+    uint8_t               irk_match_idx : 7;
+    ble_gap_conn_params_t conn_params;
+}
+ble_gap_evt_connected_t;
+
+typedef struct
+{
+    uint8_t reason;                     /**< HCI error code, see ble_hci.h. */
+}
+ble_gap_evt_disconnected_t;
+
+typedef struct
+{
+    uint8_t key_type;                   /**< See BLE_GAP_AUTH_KEY_TYPE_*. */
+}
+ble_gap_evt_auth_key_request_t;
+
+typedef struct
+{
+    uint8_t auth_status;                /**< Authentication status, see BLE_GAP_SEC_STATUS_*. */
+    uint8_t error_src;                  /**< On error, source that caused the failure, see BLE_GAP_SEC_STATUS_SOURCE_*. */
+    uint8_t bonded : 1;                 /**< Procedure resulted in a bond. */
+    uint8_t mitm   : 1;                 /**< Keys were exchanged with MITM protection. */
+}
+ble_gap_evt_auth_status_t;
+
+typedef struct
+{
+    ble_gap_conn_sec_t conn_sec;
+}
+ble_gap_evt_conn_sec_update_t;
+
+typedef struct
+{
+    uint8_t src;                        /**< Source of timeout event, see BLE_GAP_TIMEOUT_SRC_*. */
+}
+ble_gap_evt_timeout_t;
+
+typedef struct
+{
+    ble_gap_addr_t peer_addr;
+    int8_t         rssi;
+    uint8_t        scan_rsp : 1;
+    uint8_t        type     : 2;
+    uint8_t        dlen     : 5;
+    uint8_t        data[BLE_GAP_ADV_MAX_SIZE];
+}
+ble_gap_evt_adv_report_t;
+
+typedef struct
+{
+    uint16_t conn_handle;
+    union
+    {
+        ble_gap_evt_connected_t         connected;
+        ble_gap_evt_disconnected_t      disconnected;
+        ble_gap_evt_auth_key_request_t  auth_key_request;
+        ble_gap_evt_auth_status_t       auth_status;
+        ble_gap_evt_conn_sec_update_t   conn_sec_update;
+        ble_gap_evt_timeout_t           timeout;
+        ble_gap_evt_adv_report_t        adv_report;
+    } params;
+}
+ble_gap_evt_t;
+
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const * const p_scan_params);
+uint32_t sd_ble_gap_scan_stop(void);
+uint32_t sd_ble_gap_connect(ble_gap_addr_t const * const p_addr, ble_gap_scan_params_t const * const p_scan_params,
+                            ble_gap_conn_params_t const * const p_conn_params);
+uint32_t sd_ble_gap_connect_cancel(void);
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code);
+uint32_t sd_ble_gap_authenticate(uint16_t conn_handle, ble_gap_sec_params_t const * const p_sec_params);
+uint32_t sd_ble_gap_auth_key_reply(uint16_t conn_handle, uint8_t key_type, uint8_t const * const key);
+uint32_t sd_ble_gap_conn_sec_get(uint16_t conn_handle, ble_gap_conn_sec_t * const p_conn_sec);
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * const p_write_perm, uint8_t const * const p_dev_name, uint16_t len);
+
+#endif // BLE_GAP_H__
@@ -0,0 +1,54 @@
+/** @file   ble_gatt.h
+ *  @brief  Host build stand-in for SoftDevice S120 common GATT definitions.
+ */
+
+#ifndef BLE_GATT_H__
+#define BLE_GATT_H__
+
+#include <stdint.h>
+
+#define BLE_GATT_ATT_MTU_DEFAULT                     23
+
+#define BLE_GATT_HANDLE_INVALID                      0x0000
+#define BLE_GATT_HANDLE_START                        0x0001
+#define BLE_GATT_HANDLE_END                          0xFFFF
+
+#define BLE_GATT_TIMEOUT_SRC_PROTOCOL                0x00
+
+#define BLE_GATT_OP_INVALID                          0x00
+#define BLE_GATT_OP_WRITE_REQ                        0x01
+#define BLE_GATT_OP_WRITE_CMD                        0x02
+
+#define BLE_GATT_HVX_INVALID                         0x00
+#define BLE_GATT_HVX_NOTIFICATION                    0x01
+#define BLE_GATT_HVX_INDICATION                      0x02
+
+#define BLE_GATT_STATUS_SUCCESS                      0x0000
+#define BLE_GATT_STATUS_UNKNOWN                      0x0001
+#define BLE_GATT_STATUS_ATTERR_INVALID_HANDLE        0x0101
+#define BLE_GATT_STATUS_ATTERR_READ_NOT_PERMITTED    0x0102
+#define BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED   0x0103
+#define BLE_GATT_STATUS_ATTERR_INVALID_PDU           0x0104
+#define BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION  0x0105
+#define BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED 0x0106
+#define BLE_GATT_STATUS_ATTERR_INVALID_OFFSET        0x0107
+#define BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND   0x010A
+#define BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH 0x010D
+#define BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION      0x010F
+
+#define BLE_CCCD_VALUE_LEN                           2
+
+/**@brief GATT Characteristic Properties. */
+typedef struct
+{
+    uint8_t broadcast       :1;
+    uint8_t read            :1;
+    uint8_t write_wo_resp   :1;
+    uint8_t write           :1;
+    uint8_t notify          :1;
+    uint8_t indicate        :1;
+    uint8_t auth_signed_wr  :1;
+}
+ble_gatt_char_props_t;
+
+#endif // BLE_GATT_H__
@@ -0,0 +1,152 @@
+/** @file   ble_gattc.h
+ *  @brief  Host build stand-in for SoftDevice S120 GATT client API. Responses
+ *          carry variable number of entries after the structure, as the
+ *          SoftDevice does.
+ */
+
+#ifndef BLE_GATTC_H__
+#define BLE_GATTC_H__
+
+#include <stdint.h>
+#include "ble_types.h"
+#include "ble_gatt.h"
+
+typedef struct
+{
+    uint16_t start_handle;
+    uint16_t end_handle;
+}
+ble_gattc_handle_range_t;
+
+typedef struct
+{
+    ble_uuid_t               uuid;
+    ble_gattc_handle_range_t handle_range;
+}
+ble_gattc_service_t;
+
+typedef struct
+{
+    ble_uuid_t              uuid;
+    ble_gatt_char_props_t   char_props;
+    uint8_t                 char_ext_props : 1;
+    uint16_t                handle_decl;
+    uint16_t                handle_value;
+}
+ble_gattc_char_t;
+
+typedef struct
+{
+    uint16_t   handle;
+    ble_uuid_t uuid;
+}
+ble_gattc_desc_t;
+
+typedef struct
+{
+    uint8_t         write_op;
+    uint16_t        handle;
+    uint16_t        offset;
+    uint16_t        len;
+    uint8_t const * p_value;
+    uint8_t         flags;
+}
+ble_gattc_write_params_t;
+
+typedef struct
+{
+    uint16_t             count;
+    ble_gattc_service_t  services[1];
+}
+ble_gattc_evt_prim_srvc_disc_rsp_t;
+
+typedef struct
+{
+    uint16_t          count;
+    ble_gattc_char_t  chars[1];
+}
+ble_gattc_evt_char_disc_rsp_t;
+
+typedef struct
+{
+    uint16_t          count;
+    ble_gattc_desc_t  descs[1];
+}
+ble_gattc_evt_desc_disc_rsp_t;
+
+typedef struct
+{
+    uint16_t  handle;
+    uint8_t  *p_value;
+}
+ble_gattc_handle_value_t;
+
+typedef struct
+{
+    uint16_t                  count;
+    uint16_t                  value_len;
+    ble_gattc_handle_value_t  handle_value[1];
+}
+ble_gattc_evt_char_val_by_uuid_read_rsp_t;
+
+typedef struct
+{
+    uint16_t  handle;
+    uint16_t  offset;
+    uint16_t  len;
+    uint8_t   data[1];
+}
+ble_gattc_evt_read_rsp_t;
+
+typedef struct
+{
+    uint16_t  handle;
+    uint8_t   write_op;
+    uint16_t  offset;
+    uint16_t  len;
+    uint8_t   data[1];
+}
+ble_gattc_evt_write_rsp_t;
+
+typedef struct
+{
+    uint16_t  handle;
+    uint8_t   type;
+    uint16_t  len;
+    uint8_t   data[1];
+}
+ble_gattc_evt_hvx_t;
+
+typedef struct
+{
+    uint8_t  src;
+}
+ble_gattc_evt_timeout_t;
+
+typedef struct
+{
+    uint16_t  conn_handle;
+    uint16_t  gatt_status;
+    uint16_t  error_handle;
+    union
+    {
+        ble_gattc_evt_prim_srvc_disc_rsp_t         prim_srvc_disc_rsp;
+        ble_gattc_evt_char_disc_rsp_t              char_disc_rsp;
+        ble_gattc_evt_desc_disc_rsp_t              desc_disc_rsp;
+        ble_gattc_evt_char_val_by_uuid_read_rsp_t  char_val_by_uuid_read_rsp;
+        ble_gattc_evt_read_rsp_t                   read_rsp;
+        ble_gattc_evt_write_rsp_t                  write_rsp;
+        ble_gattc_evt_hvx_t                        hvx;
+        ble_gattc_evt_timeout_t                    timeout;
+    } params;
+}
+ble_gattc_evt_t;
+
+uint32_t sd_ble_gattc_primary_services_discover(uint16_t conn_handle, uint16_t start_handle, ble_uuid_t const * const p_srvc_uuid);
+uint32_t sd_ble_gattc_characteristics_discover(uint16_t conn_handle, ble_gattc_handle_range_t const * const p_handle_range);
+uint32_t sd_ble_gattc_descriptors_discover(uint16_t conn_handle, ble_gattc_handle_range_t const * const p_handle_range);
+uint32_t sd_ble_gattc_char_value_by_uuid_read(uint16_t conn_handle, ble_uuid_t const * const p_uuid, ble_gattc_handle_range_t const * const p_handle_range);
+uint32_t sd_ble_gattc_read(uint16_t conn_handle, uint16_t handle, uint16_t offset);
+uint32_t sd_ble_gattc_write(uint16_t conn_handle, ble_gattc_write_params_t const * const p_write_params);
+
+#endif // BLE_GATTC_H__
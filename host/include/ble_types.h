@@ -0,0 +1,53 @@
+/** @file   ble_types.h
+ *  @brief  Host build stand-in for SoftDevice S120 common BLE types.
+ */
+
+#ifndef BLE_TYPES_H__
+#define BLE_TYPES_H__
+
+#include <stdint.h>
+
+#define BLE_CONN_HANDLE_INVALID              0xFFFF
+#define BLE_CONN_HANDLE_ALL                  0xFFFE
+
+#define BLE_UUID_TYPE_UNKNOWN                0x00
+#define BLE_UUID_TYPE_BLE                    0x01
+#define BLE_UUID_TYPE_VENDOR_BEGIN           0x02
+
+#define BLE_UUID_SERVICE_PRIMARY             0x2800
+#define BLE_UUID_SERVICE_SECONDARY           0x2801
+#define BLE_UUID_CHARACTERISTIC              0x2803
+#define BLE_UUID_GAP                         0x1800
+#define BLE_UUID_GATT                        0x1801
+#define BLE_UUID_GAP_CHARACTERISTIC_DEVICE_NAME  0x2A00
+#define BLE_UUID_GAP_CHARACTERISTIC_APPEARANCE   0x2A01
+
+#define BLE_UUID_BATTERY_SERVICE                 0x180F
+#define BLE_UUID_DEVICE_INFORMATION_SERVICE      0x180A
+#define BLE_UUID_BATTERY_LEVEL_CHAR              0x2A19
+#define BLE_UUID_MANUFACTURER_NAME_STRING_CHAR   0x2A29
+#define BLE_UUID_HARDWARE_REVISION_STRING_CHAR   0x2A27
+#define BLE_UUID_FIRMWARE_REVISION_STRING_CHAR   0x2A26
+#define BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG   0x2902
+
+#define MSEC_TO_UNITS(TIME, RESOLUTION)  (((TIME) * 1000) / (RESOLUTION))
+
+enum
+{
+    UNIT_0_625_MS = 625,
+    UNIT_1_25_MS  = 1250,
+    UNIT_10_MS    = 10000
+};
+
+/**@brief Bluetooth Low Energy UUID type, encapsulates both 16-bit and 128-bit UUIDs. */
+typedef struct
+{
+    uint16_t uuid;
+    uint8_t  type;
+}
+ble_uuid_t;
+
+#define BLE_UUID_EQ(p_uuid1, p_uuid2) \
+    (((p_uuid1)->type == (p_uuid2)->type) && ((p_uuid1)->uuid == (p_uuid2)->uuid))
+
+#endif // BLE_TYPES_H__
@@ -0,0 +1,84 @@
+/** @file   device_manager.h
+ *  @brief  Host build stand-in for SDK central Device Manager, see host/sim/sim_dm.c.
+ */
+
+#ifndef DEVICE_MANAGER_H__
+#define DEVICE_MANAGER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "ble_gap.h"
+#include "device_manager_cnfg.h"
+
+#define DM_INVALID_ID                          0xFF
+
+#define DM_PROTOCOL_CNTXT_NONE                 0x00
+#define DM_PROTOCOL_CNTXT_GATT_SRVR_ID         0x01
+#define DM_PROTOCOL_CNTXT_GATT_CLI_ID          0x02
+#define DM_PROTOCOL_CNTXT_ALL                  (DM_PROTOCOL_CNTXT_GATT_SRVR_ID | DM_PROTOCOL_CNTXT_GATT_CLI_ID)
+
+#define DM_EVT_RFU                             0x00
+#define DM_EVT_CONNECTION                      0x11
+#define DM_EVT_DISCONNECTION                   0x12
+#define DM_EVT_SECURITY_SETUP                  0x21
+#define DM_EVT_SECURITY_SETUP_COMPLETE         0x22
+#define DM_EVT_LINK_SECURED                    0x23
+#define DM_EVT_SECURITY_SETUP_REFRESH          0x24
+#define DM_EVT_DEVICE_CONTEXT_LOADED           0x31
+#define DM_EVT_DEVICE_CONTEXT_STORED           0x32
+#define DM_EVT_DEVICE_CONTEXT_DELETED          0x33
+#define DM_EVT_SERVICE_CONTEXT_LOADED          0x41
+#define DM_EVT_SERVICE_CONTEXT_STORED          0x42
+#define DM_EVT_SERVICE_CONTEXT_DELETED         0x43
+#define DM_EVT_APPL_CONTEXT_LOADED             0x51
+#define DM_EVT_APPL_CONTEXT_STORED             0x52
+#define DM_EVT_APPL_CONTEXT_DELETED            0x53
+#define DM_EVT_ERROR                           0x60
+
+typedef uint32_t api_result_t;
+typedef uint8_t  dm_application_instance_t;
+
+typedef struct
+{
+    uint8_t appl_id;
+    uint8_t connection_id;
+    uint8_t device_id;
+    uint8_t service_id;
+}
+dm_handle_t;
+
+typedef struct
+{
+    uint8_t event_id;
+    union
+    {
+        ble_gap_evt_t * p_gap_param;
+    } event_param;
+    uint16_t event_paramlen;
+}
+dm_event_t;
+
+typedef api_result_t (*dm_event_cb_t)(dm_handle_t const * p_handle, dm_event_t const * p_event, api_result_t event_result);
+
+typedef struct
+{
+    dm_event_cb_t        evt_handler;
+    uint8_t              service_type;
+    ble_gap_sec_params_t sec_param;
+}
+dm_application_param_t;
+
+typedef struct
+{
+    bool clear_persistent_data;
+}
+dm_init_param_t;
+
+api_result_t dm_init(dm_init_param_t const * p_init_param);
+api_result_t dm_register(dm_application_instance_t * p_appl_instance, dm_application_param_t const * p_appl_param);
+api_result_t dm_security_setup_req(dm_handle_t * p_handle);
+api_result_t dm_device_delete(dm_handle_t const * p_handle);
+void dm_ble_evt_handler(ble_evt_t * p_ble_evt);
+
+#endif // DEVICE_MANAGER_H__
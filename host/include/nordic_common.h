@@ -0,0 +1,11 @@
+/** @file   nordic_common.h
+ *  @brief  Host build stand-in for common SDK macros.
+ */
+
+#ifndef NORDIC_COMMON_H__
+#define NORDIC_COMMON_H__
+
+#define UNUSED_VARIABLE(X)   ((void)(X))
+#define UNUSED_PARAMETER(X)  UNUSED_VARIABLE(X)
+
+#endif // NORDIC_COMMON_H__
@@ -0,0 +1,113 @@
+/** @file   nrf.h
+ *  @brief  Host build stand-in for nRF51 device header. Peripherals used by the
+ *          firmware are simulated, see host/sim/sim_spis.c.
+ */
+
+#ifndef NRF_H__
+#define NRF_H__
+
+#include <stdint.h>
+
+/**@brief GPIO registers used by the firmware. */
+typedef struct
+{
+    volatile uint32_t OUT;
+    volatile uint32_t OUTSET;
+    volatile uint32_t OUTCLR;
+    volatile uint32_t IN;
+    volatile uint32_t DIR;
+    volatile uint32_t DIRSET;
+    volatile uint32_t DIRCLR;
+    volatile uint32_t PIN_CNF[32];
+}
+NRF_GPIO_Type;
+
+/**@brief SPI slave registers. TASKS_* written by the firmware take effect on next register access. */
+typedef struct
+{
+    volatile uint32_t TASKS_ACQUIRE;
+    volatile uint32_t TASKS_RELEASE;
+    volatile uint32_t EVENTS_END;
+    volatile uint32_t EVENTS_ACQUIRED;
+    volatile uint32_t SHORTS;
+    volatile uint32_t INTENSET;
+    volatile uint32_t INTENCLR;
+    volatile uint32_t SEMSTAT;
+    volatile uint32_t STATUS;
+    volatile uint32_t ENABLE;
+    volatile uint32_t PSELSCK;
+    volatile uint32_t PSELMISO;
+    volatile uint32_t PSELMOSI;
+    volatile uint32_t PSELCSN;
+    volatile uint32_t RXDPTR;
+    volatile uint32_t MAXRX;
+    volatile uint32_t AMOUNTRX;
+    volatile uint32_t TXDPTR;
+    volatile uint32_t MAXTX;
+    volatile uint32_t AMOUNTTX;
+    volatile uint32_t CONFIG;
+    volatile uint32_t DEF;
+    volatile uint32_t ORC;
+}
+NRF_SPIS_Type;
+
+NRF_GPIO_Type * sim_gpio_regs(void);
+NRF_SPIS_Type * sim_spis_regs(void);
+
+#define NRF_GPIO   (sim_gpio_regs())
+#define NRF_SPIS1  (sim_spis_regs())
+
+#define GPIO_PIN_CNF_DIR_Pos                 0
+#define GPIO_PIN_CNF_DIR_Input               0
+#define GPIO_PIN_CNF_DIR_Output              1
+#define GPIO_PIN_CNF_INPUT_Pos               1
+#define GPIO_PIN_CNF_INPUT_Connect           0
+#define GPIO_PIN_CNF_INPUT_Disconnect        1
+#define GPIO_PIN_CNF_PULL_Pos                2
+#define GPIO_PIN_CNF_PULL_Disabled           0
+#define GPIO_PIN_CNF_PULL_Pulldown           1
+#define GPIO_PIN_CNF_PULL_Pullup             3
+#define GPIO_PIN_CNF_DRIVE_Pos               8
+#define GPIO_PIN_CNF_DRIVE_S0S1              0
+#define GPIO_PIN_CNF_SENSE_Pos               16
+#define GPIO_PIN_CNF_SENSE_Disabled          0
+
+#define SPIS_CONFIG_ORDER_Pos                0
+#define SPIS_CONFIG_ORDER_MsbFirst           0
+#define SPIS_CONFIG_CPHA_Pos                 1
+#define SPIS_CONFIG_CPHA_Leading             0
+#define SPIS_CONFIG_CPHA_Trailing            1
+#define SPIS_CONFIG_CPOL_Pos                 2
+#define SPIS_CONFIG_CPOL_ActiveHigh          0
+#define SPIS_CONFIG_CPOL_ActiveLow           1
+#define SPIS_INTENSET_END_Pos                1
+#define SPIS_INTENSET_END_Enabled            1
+#define SPIS_INTENSET_ACQUIRED_Pos           10
+#define SPIS_INTENSET_ACQUIRED_Enabled       1
+#define SPIS_ENABLE_ENABLE_Pos               0
+#define SPIS_ENABLE_ENABLE_Disabled          0
+#define SPIS_ENABLE_ENABLE_Enabled           2
+#define SPIS_SHORTS_END_ACQUIRE_Pos          2
+#define SPIS_SHORTS_END_ACQUIRE_Enabled      1
+#define SPIS_SEMSTAT_SEMSTAT_Free            0
+#define SPIS_SEMSTAT_SEMSTAT_CPU             1
+#define SPIS_SEMSTAT_SEMSTAT_SPIS            2
+#define SPIS_SEMSTAT_SEMSTAT_CPUPending      3
+
+typedef enum
+{
+    SPI1_TWI1_IRQn = 4,
+    RTC1_IRQn      = 17,
+    SWI2_IRQn      = 22,
+}
+IRQn_Type;
+
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+void NVIC_SystemReset(void);
+
+#define __DMB()  __asm volatile ("" ::: "memory")
+
+#endif // NRF_H__
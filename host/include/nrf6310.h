@@ -0,0 +1,8 @@
+/** @file   nrf6310.h
+ *  @brief  Host build stand-in, nothing of nrf6310.h is used by the firmware.
+ */
+
+#ifndef NRF6310_H__
+#define NRF6310_H__
+
+#endif // NRF6310_H__
@@ -0,0 +1,14 @@
+/** @file   nrf_gpio.h
+ *  @brief  Host build stand-in for SDK GPIO helpers.
+ */
+
+#ifndef NRF_GPIO_H__
+#define NRF_GPIO_H__
+
+#include <stdint.h>
+#include "nrf.h"
+
+void nrf_gpio_range_cfg_output(uint32_t pin_range_start, uint32_t pin_range_end);
+void nrf_gpio_cfg_output(uint32_t pin_number);
+
+#endif // NRF_GPIO_H__
@@ -0,0 +1,27 @@
+/** @file   nrf_soc.h
+ *  @brief  Host build stand-in for SoftDevice SoC API.
+ */
+
+#ifndef NRF_SOC_H__
+#define NRF_SOC_H__
+
+#include <stdint.h>
+#include "nrf_error.h"
+
+/**@brief SoC events, passed to system event handler. */
+enum NRF_SOC_EVTS
+{
+    NRF_EVT_HFCLKSTARTED,
+    NRF_EVT_POWER_FAILURE_WARNING,
+    NRF_EVT_FLASH_OPERATION_SUCCESS,
+    NRF_EVT_FLASH_OPERATION_ERROR,
+    NRF_EVT_RADIO_BLOCKED,
+    NRF_EVT_RADIO_CANCELED,
+    NRF_EVT_NUMBER_OF_EVTS
+};
+
+uint32_t sd_app_evt_wait(void);
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region);
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region);
+
+#endif // NRF_SOC_H__
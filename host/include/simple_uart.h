@@ -0,0 +1,8 @@
+/** @file   simple_uart.h
+ *  @brief  Host build stand-in, nothing of simple_uart.h is used by the firmware.
+ */
+
+#ifndef SIMPLE_UART_H__
+#define SIMPLE_UART_H__
+
+#endif // SIMPLE_UART_H__
@@ -0,0 +1,32 @@
+/** @file   softdevice_handler.h
+ *  @brief  Host build stand-in for SDK SoftDevice handler. Events of the simulated
+ *          SoftDevice are passed to registered handlers from simulated SWI2
+ *          interrupt, see host/sim/sim_softdevice.c.
+ */
+
+#ifndef SOFTDEVICE_HANDLER_H__
+#define SOFTDEVICE_HANDLER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_soc.h"
+#include "ble.h"
+#include "app_error.h"
+
+#define NRF_CLOCK_LFCLKSRC_XTAL_20_PPM   0
+
+typedef void (*ble_evt_handler_t) (ble_evt_t * p_ble_evt);
+typedef void (*sys_evt_handler_t) (uint32_t evt_id);
+
+uint32_t softdevice_handler_init(uint32_t clock_source, bool use_scheduler);
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler);
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler);
+
+#define SOFTDEVICE_HANDLER_INIT(CLOCK_SOURCE, USE_SCHEDULER)                         \
+    do                                                                               \
+    {                                                                                \
+        uint32_t ERR_CODE = softdevice_handler_init((CLOCK_SOURCE), (USE_SCHEDULER)); \
+        APP_ERROR_CHECK(ERR_CODE);                                                   \
+    } while (0)
+
+#endif // SOFTDEVICE_HANDLER_H__
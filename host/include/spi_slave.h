@@ -0,0 +1,8 @@
+/** @file   spi_slave.h
+ *  @brief  Host build stand-in, nothing of spi_slave.h is used by the firmware.
+ */
+
+#ifndef SPI_SLAVE_H__
+#define SPI_SLAVE_H__
+
+#endif // SPI_SLAVE_H__
@@ -0,0 +1,731 @@
+/** @file   sim.c
+ *  @brief  Discrete-event clock, firmware coroutine, interrupt dispatch and
+ *          critical regions of the host simulator.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <setjmp.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "nrf_soc.h"
+#include "SEGGER_RTT.h"
+
+#define SIM_FW_STACK_SIZE   (256 * 1024)
+#define SIM_LOG_MAX         (8 * 1024 * 1024)
+#define SIM_FAIL_LOG_TAIL   4000
+
+/**@brief Firmware entry, main() of the firmware is renamed by the host build. */
+extern int  firmware_main(void);
+extern void SPI1_TWI1_IRQHandler(void);
+
+/**@brief Static data of the firmware, gathered by host/sim/sim_firmware.ld. */
+extern uint8_t sim_fw_state_start[];
+extern uint8_t sim_fw_state_end[];
+
+struct sim_event_s
+{
+    uint64_t      at;
+    uint64_t      seq;
+    sim_handler_t handler;
+    void        * p_ctx;
+};
+
+/**@brief Event queue, binary heap ordered by time and scheduling order. */
+static sim_event_t ** sim_heap;
+static size_t         sim_heap_len;
+static size_t         sim_heap_cap;
+static uint64_t       sim_time;
+static uint64_t       sim_seq;
+static uint64_t       sim_rand_state;
+
+/**@brief Firmware coroutine. */
+static ucontext_t     sim_harness_ctx;
+static ucontext_t     sim_fw_ctx;
+static uint8_t      * sim_fw_stack;
+static bool           sim_fw_waiting;
+static bool           sim_fw_dead;
+static bool           sim_on_fw;
+static uint8_t      * sim_fw_state_image;    /**< Initial static data of the firmware. */
+static volatile bool  sim_evt_flag;
+static uint32_t       sim_busy_count;
+static uint64_t       sim_slice_start;
+static jmp_buf      * sim_reset_jmp;
+
+/**@brief Interrupts. */
+static bool           sim_irq_pending[SIM_IRQ_NUM];
+static bool           sim_irq_enabled[SIM_IRQ_NUM];
+static bool           sim_isr_active;
+static sim_irq_t      sim_isr_irq = SIM_IRQ_NUM;
+static bool           sim_critical;
+static sim_cpu_t      sim_cpu_stats;
+static uint64_t       sim_isr_ns_in_slice;
+
+/**@brief Firmware log. */
+static char         * sim_log_buf;
+static size_t         sim_log_used;
+static size_t         sim_log_base;
+static bool           sim_log_echo;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Event queue. */
+
+static bool sim_event_before(const sim_event_t * p_a, const sim_event_t * p_b)
+{
+    return (p_a->at < p_b->at) || ((p_a->at == p_b->at) && (p_a->seq < p_b->seq));
+}
+
+static void sim_heap_push(sim_event_t * p_event)
+{
+    size_t pos;
+
+    if(sim_heap_len == sim_heap_cap)
+    {
+        sim_heap_cap = (sim_heap_cap == 0) ? 256 : (sim_heap_cap * 2);
+        sim_heap     = realloc(sim_heap, sim_heap_cap * sizeof(sim_event_t *));
+    }
+
+    pos = sim_heap_len++;
+    while( (pos > 0) && sim_event_before(p_event, sim_heap[(pos - 1) / 2]) )
+    {
+        sim_heap[pos] = sim_heap[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    sim_heap[pos] = p_event;
+}
+
+static sim_event_t * sim_heap_pop(void)
+{
+    sim_event_t * p_top  = sim_heap[0];
+    sim_event_t * p_last = sim_heap[--sim_heap_len];
+    size_t        pos    = 0;
+
+    for(;;)
+    {
+        size_t child = (2 * pos) + 1;
+
+        if(child >= sim_heap_len)
+        {
+            break;
+        }
+        if( ((child + 1) < sim_heap_len) && sim_event_before(sim_heap[child + 1], sim_heap[child]) )
+        {
+            child++;
+        }
+        if(sim_event_before(p_last, sim_heap[child]) == false)
+        {
+            sim_heap[pos] = sim_heap[child];
+            pos = child;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if(sim_heap_len != 0)
+    {
+        sim_heap[pos] = p_last;
+    }
+    return p_top;
+}
+
+sim_event_t * sim_schedule(uint64_t at, sim_handler_t handler, void * p_ctx)
+{
+    sim_event_t * p_event = malloc(sizeof(sim_event_t));
+
+    p_event->at      = (at < sim_time) ? sim_time : at;
+    p_event->seq     = sim_seq++;
+    p_event->handler = handler;
+    p_event->p_ctx   = p_ctx;
+    sim_heap_push(p_event);
+    return p_event;
+}
+
+sim_event_t * sim_schedule_in(uint64_t delay, sim_handler_t handler, void * p_ctx)
+{
+    return sim_schedule(sim_time + delay, handler, p_ctx);
+}
+
+void sim_cancel(sim_event_t * p_event)
+{
+    if(p_event != NULL)
+    {
+        p_event->handler = NULL;
+    }
+}
+
+uint64_t sim_now(void)
+{
+    return sim_time;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Pseudo random generator, xorshift64*. */
+
+uint32_t sim_random(void)
+{
+    sim_rand_state ^= sim_rand_state >> 12;
+    sim_rand_state ^= sim_rand_state << 25;
+    sim_rand_state ^= sim_rand_state >> 27;
+    return (uint32_t)((sim_rand_state * 2685821657736338717ULL) >> 32);
+}
+
+double sim_random_unit(void)
+{
+    return (double)sim_random() / 4294967296.0;
+}
+
+bool sim_random_chance(double probability)
+{
+    return (probability > 0.0) && (sim_random_unit() < probability);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Firmware log and CPU time. */
+
+static uint64_t sim_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static void sim_log_append(char c)
+{
+    if(sim_log_used == SIM_LOG_MAX)
+    {
+        memmove(sim_log_buf, sim_log_buf + (SIM_LOG_MAX / 2), SIM_LOG_MAX / 2);
+        sim_log_used  = SIM_LOG_MAX / 2;
+        sim_log_base += SIM_LOG_MAX / 2;
+    }
+    sim_log_buf[sim_log_used++] = c;
+    sim_log_buf[sim_log_used]   = '\0';
+}
+
+static void sim_rtt_drain(void)
+{
+    SEGGER_RTT_BUFFER_UP * p_up = &_SEGGER_RTT.aUp[0];
+
+    if(p_up->pBuffer == NULL)
+    {
+        return;
+    }
+    while(p_up->RdOff != p_up->WrOff)
+    {
+        char c = p_up->pBuffer[p_up->RdOff];
+
+        sim_log_append(c);
+        if(sim_log_echo)
+        {
+            fputc(c, stderr);
+        }
+        p_up->RdOff = (p_up->RdOff + 1) % p_up->SizeOfBuffer;
+    }
+}
+
+const char * sim_log(void)
+{
+    return sim_log_buf;
+}
+
+size_t sim_log_len(void)
+{
+    return sim_log_base + sim_log_used;
+}
+
+bool sim_log_contains_since(size_t offset, const char * p_text)
+{
+    size_t start = (offset > sim_log_base) ? (offset - sim_log_base) : 0;
+
+    if(start > sim_log_used)
+    {
+        return false;
+    }
+    return strstr(sim_log_buf + start, p_text) != NULL;
+}
+
+void sim_rtt_input(const char * p_text)
+{
+    SEGGER_RTT_BUFFER_DOWN * p_down = &_SEGGER_RTT.aDown[0];
+
+    if(p_down->pBuffer == NULL)
+    {
+        sim_fail("RTT is not initialized");
+    }
+    while(*p_text != '\0')
+    {
+        p_down->pBuffer[p_down->WrOff] = *p_text++;
+        p_down->WrOff = (p_down->WrOff + 1) % p_down->SizeOfBuffer;
+    }
+}
+
+const sim_cpu_t * sim_cpu(void)
+{
+    return &sim_cpu_stats;
+}
+
+void sim_cpu_reset(void)
+{
+    memset(&sim_cpu_stats, 0, sizeof(sim_cpu_stats));
+}
+
+void sim_fail(const char * p_format, ...)
+{
+    va_list args;
+    size_t  tail = (sim_log_used > SIM_FAIL_LOG_TAIL) ? (sim_log_used - SIM_FAIL_LOG_TAIL) : 0;
+
+    sim_rtt_drain();
+    fflush(stdout);
+    if(sim_log_buf != NULL)
+    {
+        fprintf(stderr, "---- firmware log tail ----\n%s\n---------------------------\n", sim_log_buf + tail);
+    }
+    fprintf(stderr, "SIM FAIL at %llu us: ", (unsigned long long)sim_time);
+    va_start(args, p_format);
+    vfprintf(stderr, p_format, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    fflush(stderr);
+    _exit(1);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Interrupts. All lines share one priority, so handlers do not preempt each other. */
+
+static void sim_after_firmware(void)
+{
+    sim_spis_sync();
+    sim_rtt_drain();
+}
+
+static void sim_run_isr(sim_irq_t irq)
+{
+    uint64_t start = sim_cpu_ns();
+    uint64_t spent;
+
+    sim_isr_active = true;
+    sim_isr_irq    = irq;
+    switch(irq)
+    {
+        case SIM_IRQ_SPI1:
+            SPI1_TWI1_IRQHandler();
+            break;
+
+        case SIM_IRQ_RTC1:
+            sim_timer_isr();
+            break;
+
+        default:
+            sim_softdevice_isr();
+            break;
+    }
+    sim_isr_active = false;
+    sim_isr_irq    = SIM_IRQ_NUM;
+
+    spent = sim_cpu_ns() - start;
+    sim_cpu_stats.isr_ns[irq] += spent;
+    sim_cpu_stats.isr_count[irq]++;
+    if(spent > sim_cpu_stats.isr_max_ns[irq])
+    {
+        sim_cpu_stats.isr_max_ns[irq] = spent;
+    }
+    if(sim_on_fw)
+    {
+        sim_isr_ns_in_slice += spent;
+    }
+
+    // Any interrupt wakes main loop from sd_app_evt_wait().
+    sim_evt_flag = true;
+    sim_after_firmware();
+}
+
+static void sim_dispatch_irqs(void)
+{
+    bool run = true;
+
+    while(run)
+    {
+        uint8_t irq;
+
+        run = false;
+        if( sim_isr_active || sim_critical || sim_fw_dead )
+        {
+            return;
+        }
+        for(irq = 0; irq < SIM_IRQ_NUM; irq++)
+        {
+            if( sim_irq_pending[irq] && sim_irq_enabled[irq] )
+            {
+                sim_irq_pending[irq] = false;
+                sim_run_isr((sim_irq_t)irq);
+                run = true;
+                break;
+            }
+        }
+    }
+}
+
+void sim_irq_set_pending(sim_irq_t irq)
+{
+    if(sim_fw_dead == false)
+    {
+        sim_irq_pending[irq] = true;
+    }
+}
+
+bool sim_in_isr(void)
+{
+    return sim_isr_active;
+}
+
+sim_irq_t sim_isr_current(void)
+{
+    return sim_isr_irq;
+}
+
+bool sim_in_firmware_main(void)
+{
+    return sim_on_fw && (sim_isr_active == false);
+}
+
+static sim_irq_t sim_irq_from_irqn(IRQn_Type irqn)
+{
+    switch(irqn)
+    {
+        case SPI1_TWI1_IRQn:
+            return SIM_IRQ_SPI1;
+
+        case RTC1_IRQn:
+            return SIM_IRQ_RTC1;
+
+        default:
+            return SIM_IRQ_SWI2;
+    }
+}
+
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority)
+{
+    (void)irqn;
+    (void)priority;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn)
+{
+    sim_irq_pending[sim_irq_from_irqn(irqn)] = false;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irqn)
+{
+    sim_irq_enabled[sim_irq_from_irqn(irqn)] = true;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn)
+{
+    sim_irq_enabled[sim_irq_from_irqn(irqn)] = false;
+}
+
+uint32_t sd_nvic_critical_region_enter(uint8_t * p_is_nested_critical_region)
+{
+    *p_is_nested_critical_region = sim_critical ? 1 : 0;
+    sim_critical = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_nvic_critical_region_exit(uint8_t is_nested_critical_region)
+{
+    if(is_nested_critical_region == 0)
+    {
+        sim_critical = false;
+
+        // Interrupt pended meanwhile runs right after the region.
+        if(sim_in_firmware_main())
+        {
+            sim_dispatch_irqs();
+        }
+    }
+    return NRF_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Firmware coroutine. */
+
+static void sim_fw_entry(void)
+{
+    firmware_main();
+    sim_fail("firmware main() returned");
+}
+
+static void sim_fw_resume(void)
+{
+    uint64_t start;
+
+    sim_busy_count      = 0;
+    sim_slice_start     = sim_time;
+    sim_isr_ns_in_slice = 0;
+    sim_on_fw           = true;
+
+    start = sim_cpu_ns();
+    swapcontext(&sim_harness_ctx, &sim_fw_ctx);
+    sim_on_fw = false;
+
+    sim_cpu_stats.main_ns += (sim_cpu_ns() - start) - sim_isr_ns_in_slice;
+    sim_cpu_stats.main_slices++;
+    sim_after_firmware();
+}
+
+uint32_t sd_app_evt_wait(void)
+{
+    if(sim_in_firmware_main() == false)
+    {
+        sim_fail("sd_app_evt_wait() called outside of main loop");
+    }
+
+    sim_dispatch_irqs();
+    while(sim_evt_flag == false)
+    {
+        sim_fw_waiting = true;
+        swapcontext(&sim_fw_ctx, &sim_harness_ctx);
+        sim_fw_waiting = false;
+        sim_dispatch_irqs();
+    }
+    sim_evt_flag = false;
+    return NRF_SUCCESS;
+}
+
+/**@brief Stop the firmware, SoftDevice and peripherals drop their state. */
+
+static void sim_fw_stop(void)
+{
+    sim_fw_dead    = true;
+    sim_fw_waiting = false;
+    sim_evt_flag   = false;
+    sim_isr_active = false;
+    sim_critical   = false;
+    memset(sim_irq_pending, 0, sizeof(sim_irq_pending));
+    sim_rtt_drain();
+
+    sim_softdevice_on_reset();
+    sim_timer_on_reset();
+    sim_pstorage_on_reset();
+}
+
+void NVIC_SystemReset(void)
+{
+    sim_fw_stop();
+
+    // Firmware stack is abandoned, its code never runs again in this process.
+    if(sim_on_fw)
+    {
+        swapcontext(&sim_fw_ctx, &sim_harness_ctx);
+    }
+    else if(sim_reset_jmp != NULL)
+    {
+        longjmp(*sim_reset_jmp, 1);
+    }
+    sim_fail("firmware reset outside of simulation run");
+}
+
+bool sim_firmware_reset(void)
+{
+    return sim_fw_dead;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Run loop. */
+
+/**@brief Run next event due until given time.
+ *
+ * @return false if there is no such event.
+ */
+
+static bool sim_step_event(uint64_t limit)
+{
+    sim_event_t * p_event;
+    sim_handler_t handler;
+    void        * p_ctx;
+
+    if( (sim_heap_len == 0) || (sim_heap[0]->at > limit) )
+    {
+        return false;
+    }
+
+    p_event = sim_heap_pop();
+    handler = p_event->handler;
+    p_ctx   = p_event->p_ctx;
+    free(p_event);
+
+    if(handler != NULL)
+    {
+        handler(p_ctx);
+        sim_dispatch_irqs();
+    }
+    return true;
+}
+
+static bool sim_step(uint64_t limit)
+{
+    if( sim_fw_waiting && sim_evt_flag && (sim_fw_dead == false) )
+    {
+        sim_fw_resume();
+        return true;
+    }
+    if( (sim_heap_len == 0) || (sim_heap[0]->at > limit) )
+    {
+        return false;
+    }
+    sim_time = sim_heap[0]->at;
+    return sim_step_event(limit);
+}
+
+void sim_busy_wait_tick(void)
+{
+    if(sim_in_firmware_main() == false)
+    {
+        return;
+    }
+    if((++sim_busy_count % SIM_BUSY_WAIT_STEP) != 0)
+    {
+        return;
+    }
+    if((sim_time - sim_slice_start) > SIM_DEADLOCK_US)
+    {
+        sim_fail("deadlock: main loop spins on peripheral for %llu us",
+                 (unsigned long long)(sim_time - sim_slice_start));
+    }
+    if(sim_heap_len == 0)
+    {
+        sim_fail("deadlock: main loop spins on peripheral and no event is pending");
+    }
+
+    // Main loop takes time, peripheral and interrupts go on meanwhile.
+    sim_time = sim_heap[0]->at;
+    (void)sim_step_event(sim_time);
+}
+
+void sim_run_until(uint64_t at)
+{
+    jmp_buf   reset_jmp;
+    jmp_buf * p_prev = sim_reset_jmp;
+
+    sim_reset_jmp = &reset_jmp;
+    (void)setjmp(reset_jmp);
+
+    while(sim_step(at))
+    {
+    }
+    if(sim_time < at)
+    {
+        sim_time = at;
+    }
+    sim_reset_jmp = p_prev;
+}
+
+void sim_run_for(uint64_t duration)
+{
+    sim_run_until(sim_time + duration);
+}
+
+bool sim_run_until_cond(sim_cond_t cond, void * p_ctx, uint64_t timeout)
+{
+    jmp_buf   reset_jmp;
+    jmp_buf * p_prev   = sim_reset_jmp;
+    uint64_t  deadline = sim_time + timeout;
+    bool      result   = false;
+
+    sim_reset_jmp = &reset_jmp;
+    (void)setjmp(reset_jmp);
+
+    for(;;)
+    {
+        if(cond(p_ctx))
+        {
+            result = true;
+            break;
+        }
+        if(sim_step(deadline) == false)
+        {
+            sim_time = deadline;
+            result   = cond(p_ctx);
+            break;
+        }
+    }
+    sim_reset_jmp = p_prev;
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void sim_init(uint64_t seed)
+{
+    sim_rand_state = (seed * 0x9E3779B97F4A7C15ULL) | 1;
+    sim_time       = 0;
+
+    sim_log_buf    = malloc(SIM_LOG_MAX + 1);
+    sim_log_buf[0] = '\0';
+    sim_log_echo   = (getenv("SIM_LOG") != NULL);
+
+    sim_fw_state_image = malloc(sim_fw_state_end - sim_fw_state_start);
+    memcpy(sim_fw_state_image, sim_fw_state_start, sim_fw_state_end - sim_fw_state_start);
+
+    // SoftDevice interrupts are enabled by the stack.
+    sim_irq_enabled[SIM_IRQ_RTC1] = true;
+    sim_irq_enabled[SIM_IRQ_SWI2] = true;
+}
+
+void sim_boot(void)
+{
+    sim_fw_stack = malloc(SIM_FW_STACK_SIZE);
+
+    getcontext(&sim_fw_ctx);
+    sim_fw_ctx.uc_stack.ss_sp   = sim_fw_stack;
+    sim_fw_ctx.uc_stack.ss_size = SIM_FW_STACK_SIZE;
+    sim_fw_ctx.uc_link          = NULL;
+    makecontext(&sim_fw_ctx, sim_fw_entry, 0);
+
+    sim_fw_resume();
+    sim_run_until(sim_time);
+}
+
+void sim_reboot(void)
+{
+    if(sim_on_fw)
+    {
+        sim_fail("sim_reboot() called from firmware");
+    }
+    if(sim_fw_dead == false)
+    {
+        sim_fw_stop();
+    }
+
+    // Static data of the firmware gets its initial values, as after power on.
+    memcpy(sim_fw_state_start, sim_fw_state_image, sim_fw_state_end - sim_fw_state_start);
+    memset(sim_irq_enabled, 0, sizeof(sim_irq_enabled));
+    sim_irq_enabled[SIM_IRQ_RTC1] = true;
+    sim_irq_enabled[SIM_IRQ_SWI2] = true;
+    free(sim_fw_stack);
+    sim_fw_dead = false;
+
+    sim_boot();
+}
@@ -0,0 +1,126 @@
+/** @file   sim.h
+ *  @brief  Host simulator of the master module. Firmware is compiled unchanged
+ *          against stand-ins of SDK and SoftDevice headers (host/include) and
+ *          runs as a coroutine on a deterministic discrete-event clock. Peripherals,
+ *          SoftDevice, virtual sensors and Kinetis SPI master are simulated.
+ *
+ *  @details Virtual time passes only between events, firmware code runs in zero
+ *           virtual time. Main loop of the firmware runs until it waits in
+ *           sd_app_evt_wait(), interrupts are dispatched whenever no other
+ *           interrupt runs and no critical region is entered. Main loop which
+ *           spins on SPIS registers advances the clock to the next event, so the
+ *           peripheral can change state meanwhile; main loop which spins for more
+ *           than SIM_DEADLOCK_US of virtual time is reported as deadlock.
+ *
+ *           Firmware state is kept in static variables, so every simulation runs
+ *           in its own process, see host/tests/test.h. Reboot restores initial
+ *           values of the static data, which host/sim/sim_firmware.ld gathers
+ *           in one section. Flash and bonds are kept.
+ */
+
+#ifndef SIM_H__
+#define SIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nrf.h"
+
+#define SIM_US_PER_MS        1000ULL
+#define SIM_US_PER_S         1000000ULL
+#define SIM_MS(ms)           ((uint64_t)(ms) * SIM_US_PER_MS)
+#define SIM_S(s)             ((uint64_t)(s) * SIM_US_PER_S)
+
+#define SIM_DEADLOCK_US      SIM_MS(100)   /**< Longest time main loop may spin on a peripheral register. */
+#define SIM_BUSY_WAIT_STEP   64            /**< Register accesses of main loop after which the clock advances. */
+
+/**@brief Simulated interrupt lines. */
+typedef enum
+{
+    SIM_IRQ_SPI1,
+    SIM_IRQ_RTC1,
+    SIM_IRQ_SWI2,
+    SIM_IRQ_NUM
+}
+sim_irq_t;
+
+/**@brief CPU time spent in firmware, measured with host thread clock. */
+typedef struct
+{
+    uint64_t main_ns;                     /**< Main loop. */
+    uint64_t isr_ns[SIM_IRQ_NUM];         /**< Interrupt handlers. */
+    uint32_t isr_count[SIM_IRQ_NUM];      /**< Interrupt handler invocations. */
+    uint64_t isr_max_ns[SIM_IRQ_NUM];     /**< Longest run of interrupt handler. */
+    uint32_t main_slices;                 /**< Main loop runs between two waits. */
+}
+sim_cpu_t;
+
+typedef void (*sim_handler_t)(void * p_ctx);
+typedef bool (*sim_cond_t)(void * p_ctx);
+
+typedef struct sim_event_s sim_event_t;
+
+/**@brief Initialize simulator. Shall be called once per process, before any other sim_* function.
+ *
+ * @param[in] seed  Seed of pseudo random generator, runs with the same seed are identical.
+ */
+void sim_init(uint64_t seed);
+
+/**@brief Start firmware and run it until it first waits for an event. */
+void sim_boot(void);
+
+/**@brief Reset the firmware if it runs, as on power cycle, and start it again from initial
+ *        state. Content of flash and bonds of the device manager are kept.
+ */
+void sim_reboot(void);
+
+uint64_t sim_now(void);
+
+/**@brief Schedule handler at given virtual time. Events of the same time run in order of scheduling.
+ *
+ * @return Event, valid until handler runs or event is cancelled.
+ */
+sim_event_t * sim_schedule(uint64_t at, sim_handler_t handler, void * p_ctx);
+sim_event_t * sim_schedule_in(uint64_t delay, sim_handler_t handler, void * p_ctx);
+void          sim_cancel(sim_event_t * p_event);
+
+void sim_run_until(uint64_t at);
+void sim_run_for(uint64_t duration);
+
+/**@brief Run until condition holds or timeout elapses. Condition is checked after every event.
+ *
+ * @return true if condition holds.
+ */
+bool sim_run_until_cond(sim_cond_t cond, void * p_ctx, uint64_t timeout);
+
+/**@brief Pend interrupt, it is dispatched as soon as firmware allows. */
+void sim_irq_set_pending(sim_irq_t irq);
+bool sim_in_isr(void);
+
+/**@brief Interrupt being handled, SIM_IRQ_NUM in main loop. */
+sim_irq_t sim_isr_current(void);
+bool sim_in_firmware_main(void);
+
+/**@brief Called by peripherals on register access of main loop, advances the clock if main loop spins. */
+void sim_busy_wait_tick(void);
+
+uint32_t sim_random(void);
+double   sim_random_unit(void);
+bool     sim_random_chance(double probability);
+
+/**@brief Report failure of simulation with log tail of the firmware and exit. */
+void sim_fail(const char * p_format, ...) __attribute__((format(printf, 1, 2), noreturn));
+
+bool               sim_firmware_reset(void);
+const sim_cpu_t  * sim_cpu(void);
+void               sim_cpu_reset(void);
+
+/**@brief Log of the firmware, drained from RTT up-buffer. */
+const char * sim_log(void);
+size_t       sim_log_len(void);
+bool         sim_log_contains_since(size_t offset, const char * p_text);
+
+/**@brief Pass characters to RTT down-buffer, read by debug_poll(). */
+void sim_rtt_input(const char * p_text);
+
+#endif // SIM_H__
@@ -0,0 +1,347 @@
+/** @file   sim_dm.c
+ *  @brief  Simulated SDK central Device Manager, see sim_dm.h. Events follow the
+ *          SDK module: link secured with stored keys is reported with
+ *          DM_EVT_LINK_SECURED only, pairing with DM_EVT_LINK_SECURED and
+ *          DM_EVT_SECURITY_SETUP_COMPLETE, and a new bond with
+ *          DM_EVT_DEVICE_CONTEXT_STORED once it is written to flash.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "sim_dm.h"
+#include "sim_softdevice.h"
+
+#define SIM_DM_FLASH_US         25000      /**< Time to write or erase bond in flash. */
+
+typedef struct
+{
+    bool           used;
+    ble_gap_addr_t addr;
+    uint32_t       key;
+    bool           mitm;
+}
+sim_bond_t;
+
+typedef struct
+{
+    bool           connected;
+    ble_gap_addr_t addr;
+    uint8_t        device_id;
+}
+sim_dm_conn_t;
+
+/**@brief Event passed after flash operation. */
+typedef struct
+{
+    uint32_t       generation;
+    uint8_t        event_id;
+    dm_handle_t    handle;
+}
+sim_dm_deferred_t;
+
+static sim_bond_t     sim_bonds[DEVICE_MANAGER_MAX_BONDS];     /**< Flash, kept across firmware resets. */
+static sim_dm_conn_t  sim_conns[SIM_SD_LINKS_MAX];
+static bool           sim_dm_initialized;
+static bool           sim_dm_registered;
+static dm_event_cb_t  sim_dm_handler;
+static ble_gap_sec_params_t sim_dm_sec_params;
+static uint32_t       sim_dm_generation;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t sim_bond_find(const ble_gap_addr_t * p_addr)
+{
+    uint8_t device_id;
+
+    for(device_id = 0; device_id < DEVICE_MANAGER_MAX_BONDS; device_id++)
+    {
+        if( sim_bonds[device_id].used &&
+            (memcmp(&sim_bonds[device_id].addr, p_addr, sizeof(ble_gap_addr_t)) == 0) )
+        {
+            return device_id;
+        }
+    }
+    return DM_INVALID_ID;
+}
+
+static void sim_dm_conns_clear(void)
+{
+    uint8_t conn;
+
+    for(conn = 0; conn < SIM_SD_LINKS_MAX; conn++)
+    {
+        memset(&sim_conns[conn], 0, sizeof(sim_dm_conn_t));
+        sim_conns[conn].device_id = DM_INVALID_ID;
+    }
+}
+
+static dm_handle_t sim_dm_handle(uint16_t conn_handle)
+{
+    dm_handle_t handle;
+
+    handle.appl_id       = 0;
+    handle.connection_id = (uint8_t)conn_handle;
+    handle.device_id     = (conn_handle < SIM_SD_LINKS_MAX) ? sim_conns[conn_handle].device_id : DM_INVALID_ID;
+    handle.service_id    = DM_PROTOCOL_CNTXT_GATT_CLI_ID;
+    return handle;
+}
+
+static void sim_dm_notify(const dm_handle_t * p_handle, uint8_t event_id, ble_gap_evt_t * p_gap_evt, api_result_t result)
+{
+    dm_event_t event;
+
+    event.event_id                = event_id;
+    event.event_param.p_gap_param = p_gap_evt;
+    event.event_paramlen          = sizeof(ble_gap_evt_t);
+    (void)sim_dm_handler(p_handle, &event, result);
+}
+
+static void sim_dm_deferred_run(void * p_ctx)
+{
+    sim_dm_deferred_t * p_deferred = p_ctx;
+    ble_gap_evt_t       gap_evt;
+
+    if( sim_dm_registered && (p_deferred->generation == sim_dm_generation) )
+    {
+        memset(&gap_evt, 0, sizeof(gap_evt));
+        gap_evt.conn_handle = p_deferred->handle.connection_id;
+        sim_dm_notify(&p_deferred->handle, p_deferred->event_id, &gap_evt, NRF_SUCCESS);
+    }
+    free(p_deferred);
+}
+
+static void sim_dm_deferred_post(void * p_ctx)
+{
+    sim_softdevice_post_call(sim_dm_deferred_run, p_ctx);
+}
+
+/**@brief Pass context event once flash operation completes. */
+
+static void sim_dm_defer(uint8_t event_id, const dm_handle_t * p_handle)
+{
+    sim_dm_deferred_t * p_deferred = malloc(sizeof(sim_dm_deferred_t));
+
+    p_deferred->generation = sim_dm_generation;
+    p_deferred->event_id   = event_id;
+    p_deferred->handle     = *p_handle;
+    (void)sim_schedule_in(SIM_DM_FLASH_US, sim_dm_deferred_post, p_deferred);
+}
+
+static void sim_dm_on_auth_status(ble_gap_evt_t * p_gap_evt)
+{
+    const uint16_t conn_handle = p_gap_evt->conn_handle;
+    const ble_gap_evt_auth_status_t * p_status = &p_gap_evt->params.auth_status;
+    dm_handle_t handle;
+    bool        stored = false;
+
+    if( (p_status->auth_status == BLE_GAP_SEC_STATUS_SUCCESS) && p_status->bonded )
+    {
+        const ble_gap_addr_t * p_addr = &sim_conns[conn_handle].addr;
+        uint8_t                device_id;
+
+        device_id = sim_bond_find(p_addr);
+        if(device_id == DM_INVALID_ID)
+        {
+            for(device_id = 0; (device_id < DEVICE_MANAGER_MAX_BONDS) && sim_bonds[device_id].used; device_id++)
+            {
+            }
+        }
+        if(device_id < DEVICE_MANAGER_MAX_BONDS)
+        {
+            sim_bonds[device_id].used = true;
+            sim_bonds[device_id].addr = *p_addr;
+            sim_bonds[device_id].key  = sim_softdevice_link_key(conn_handle);
+            sim_bonds[device_id].mitm = p_status->mitm;
+            sim_conns[conn_handle].device_id = device_id;
+            stored = true;
+        }
+    }
+
+    handle = sim_dm_handle(conn_handle);
+    sim_dm_notify(&handle, DM_EVT_SECURITY_SETUP_COMPLETE, p_gap_evt, p_status->auth_status);
+    if(stored)
+    {
+        sim_dm_defer(DM_EVT_DEVICE_CONTEXT_STORED, &handle);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+api_result_t dm_init(dm_init_param_t const * p_init_param)
+{
+    if(p_init_param == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if(p_init_param->clear_persistent_data)
+    {
+        memset(sim_bonds, 0, sizeof(sim_bonds));
+    }
+    sim_dm_conns_clear();
+    sim_dm_initialized = true;
+    return NRF_SUCCESS;
+}
+
+api_result_t dm_register(dm_application_instance_t * p_appl_instance, dm_application_param_t const * p_appl_param)
+{
+    if(sim_dm_initialized == false)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if( (p_appl_instance == NULL) || (p_appl_param == NULL) || (p_appl_param->evt_handler == NULL) )
+    {
+        return NRF_ERROR_NULL;
+    }
+
+    // One application instance is configured, see DEVICE_MANAGER_MAX_APPLICATIONS.
+    if(sim_dm_registered)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    sim_dm_registered  = true;
+    sim_dm_handler     = p_appl_param->evt_handler;
+    sim_dm_sec_params  = p_appl_param->sec_param;
+    *p_appl_instance   = 0;
+    return NRF_SUCCESS;
+}
+
+api_result_t dm_security_setup_req(dm_handle_t * p_handle)
+{
+    uint32_t err_code;
+    uint8_t  device_id;
+
+    if(sim_dm_registered == false)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if( (p_handle == NULL) || (p_handle->connection_id >= SIM_SD_LINKS_MAX) ||
+        (sim_conns[p_handle->connection_id].connected == false) )
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    device_id = sim_conns[p_handle->connection_id].device_id;
+    if(device_id != DM_INVALID_ID)
+    {
+        err_code = sim_softdevice_encrypt(p_handle->connection_id, sim_bonds[device_id].key);
+    }
+    else
+    {
+        err_code = sd_ble_gap_authenticate(p_handle->connection_id, &sim_dm_sec_params);
+    }
+
+    // Procedure already running on the link serves the request as well.
+    return (err_code == NRF_ERROR_BUSY) ? NRF_SUCCESS : err_code;
+}
+
+api_result_t dm_device_delete(dm_handle_t const * p_handle)
+{
+    uint8_t conn;
+
+    if(sim_dm_registered == false)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if( (p_handle == NULL) || (p_handle->device_id >= DEVICE_MANAGER_MAX_BONDS) ||
+        (sim_bonds[p_handle->device_id].used == false) )
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    memset(&sim_bonds[p_handle->device_id], 0, sizeof(sim_bond_t));
+    for(conn = 0; conn < SIM_SD_LINKS_MAX; conn++)
+    {
+        if(sim_conns[conn].device_id == p_handle->device_id)
+        {
+            sim_conns[conn].device_id = DM_INVALID_ID;
+        }
+    }
+    sim_dm_defer(DM_EVT_DEVICE_CONTEXT_DELETED, p_handle);
+    return NRF_SUCCESS;
+}
+
+void dm_ble_evt_handler(ble_evt_t * p_ble_evt)
+{
+    ble_gap_evt_t * p_gap_evt = &p_ble_evt->evt.gap_evt;
+    dm_handle_t     handle;
+
+    if(sim_dm_registered == false)
+    {
+        return;
+    }
+
+    switch(p_ble_evt->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            sim_conns[p_gap_evt->conn_handle].connected = true;
+            sim_conns[p_gap_evt->conn_handle].addr      = p_gap_evt->params.connected.peer_addr;
+            sim_conns[p_gap_evt->conn_handle].device_id = sim_bond_find(&p_gap_evt->params.connected.peer_addr);
+            handle = sim_dm_handle(p_gap_evt->conn_handle);
+            sim_dm_notify(&handle, DM_EVT_CONNECTION, p_gap_evt, NRF_SUCCESS);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            handle = sim_dm_handle(p_gap_evt->conn_handle);
+            sim_dm_notify(&handle, DM_EVT_DISCONNECTION, p_gap_evt, NRF_SUCCESS);
+            sim_conns[p_gap_evt->conn_handle].connected = false;
+            sim_conns[p_gap_evt->conn_handle].device_id = DM_INVALID_ID;
+            break;
+
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+            handle = sim_dm_handle(p_gap_evt->conn_handle);
+            sim_dm_notify(&handle, DM_EVT_LINK_SECURED, p_gap_evt, NRF_SUCCESS);
+            break;
+
+        case BLE_GAP_EVT_AUTH_STATUS:
+            sim_dm_on_auth_status(p_gap_evt);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void sim_dm_on_reset(void)
+{
+    sim_dm_initialized = false;
+    sim_dm_registered  = false;
+    sim_dm_handler     = NULL;
+    sim_dm_generation++;
+    sim_dm_conns_clear();
+}
+
+uint8_t sim_dm_bond_count(void)
+{
+    uint8_t count = 0;
+    uint8_t device_id;
+
+    for(device_id = 0; device_id < DEVICE_MANAGER_MAX_BONDS; device_id++)
+    {
+        count += sim_bonds[device_id].used ? 1 : 0;
+    }
+    return count;
+}
+
+bool sim_dm_bonded(const ble_gap_addr_t * p_addr, bool * p_mitm)
+{
+    const uint8_t device_id = sim_bond_find(p_addr);
+
+    if(device_id == DM_INVALID_ID)
+    {
+        return false;
+    }
+    if(p_mitm != NULL)
+    {
+        *p_mitm = sim_bonds[device_id].mitm;
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+/** @file   sim_dm.h
+ *  @brief  Simulated SDK central Device Manager. Bonds are kept in simulated
+ *          flash across firmware resets, security of links is set up with the
+ *          simulated SoftDevice.
+ */
+
+#ifndef SIM_DM_H__
+#define SIM_DM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "device_manager.h"
+
+/**@brief Number of bonds stored. */
+uint8_t sim_dm_bond_count(void);
+
+/**@brief Check if a bond with peer is stored.
+ *
+ * @param[in]  p_addr  Address of peer.
+ * @param[out] p_mitm  Set if bond was created by MITM protected pairing, may be NULL.
+ *
+ * @return true if bond is stored.
+ */
+bool sim_dm_bonded(const ble_gap_addr_t * p_addr, bool * p_mitm);
+
+#endif // SIM_DM_H__
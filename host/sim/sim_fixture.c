@@ -0,0 +1,325 @@
+/** @file   sim_fixture.c
+ *  @brief  Steps shared by tests and benchmarks.
+ */
+
+/* -- Includes -- */
+
+#include <stddef.h>
+#include <string.h>
+#include "sim_fixture.h"
+#include "onboard.h"
+#include "timestamp.h"
+#include "rotation.h"
+#include "adv_inventory.h"
+#include "app_timer.h"
+
+#define SIM_FIXTURE_BOOT_TIMEOUT_US   SIM_MS(100)
+#define SIM_FIXTURE_STATS_TIMEOUT_US  SIM_MS(100)
+#define SIM_FIXTURE_SYNC_TIMEOUT_US   SIM_MS(100)
+#define SIM_FIXTURE_DUMP_TIMEOUT_US   SIM_MS(100)
+
+typedef struct
+{
+    const sim_sensor_t * p_sensor;
+    bool                 connected;
+}
+sim_fixture_wait_t;
+
+void sim_fixture_boot(void)
+{
+    sim_boot();
+    if(sim_kinetis_wait(DATA_ID_DEV_CENTRAL, FIELD_ID_CHAR_FIRMWARE_REVISION, 0, SIM_FIXTURE_BOOT_TIMEOUT_US) == NULL)
+    {
+        sim_fail("firmware revision frame not received after boot");
+    }
+}
+
+void sim_fixture_reboot(void)
+{
+    const size_t from = sim_kinetis_frame_count();
+
+    sim_reboot();
+    if(sim_kinetis_wait(DATA_ID_DEV_CENTRAL, FIELD_ID_CHAR_FIRMWARE_REVISION, from, SIM_FIXTURE_BOOT_TIMEOUT_US) == NULL)
+    {
+        sim_fail("firmware revision frame not received after reboot");
+    }
+}
+
+void sim_fixture_run(void)
+{
+    (void)sim_kinetis_send_config(FIELD_ID_RUN, NULL, 0);
+}
+
+void sim_fixture_config(void)
+{
+    (void)sim_kinetis_send_config(FIELD_ID_CONFIG_START, NULL, 0);
+}
+
+void sim_fixture_set_passkey(data_id_t data_id, const char * p_passkey)
+{
+    uint8_t data[1 + sizeof(passkey_t)] = { 0 };
+
+    if(DATA_ID_GET_INSTANCE(data_id) == 0)
+    {
+        memcpy(data, p_passkey, PASSKEY_SIZE);
+        (void)sim_kinetis_send_config(data_id, data, sizeof(passkey_t));
+    }
+    else
+    {
+        data[0] = data_id;
+        memcpy(&data[1], p_passkey, PASSKEY_SIZE);
+        (void)sim_kinetis_send_config(FIELD_ID_CONFIG_INSTANCE_PASS, data, sizeof(data));
+    }
+}
+
+void sim_fixture_set_rotation(data_id_t data_id, uint16_t period_s, uint8_t window_s)
+{
+    uint8_t data[1 + sizeof(rotation_plan_t)];
+
+    data[0] = data_id;
+    memcpy(&data[1], &period_s, sizeof(period_s));
+    data[1 + sizeof(period_s)] = window_s;
+    (void)sim_kinetis_send_config(FIELD_ID_ROTATION, data, sizeof(data));
+}
+
+void sim_fixture_set_adv_ingest(data_id_t data_id, bool enable)
+{
+    const uint8_t data[2] = { data_id, enable ? 1 : 0 };
+
+    (void)sim_kinetis_send_config(FIELD_ID_ADV_INGEST, data, sizeof(data));
+}
+
+void sim_fixture_set_open_comm(data_id_t data_id, bool allow)
+{
+    const uint8_t data[2] = { data_id, allow ? 1 : 0 };
+
+    (void)sim_kinetis_send_config(FIELD_ID_OPEN_COMM, data, sizeof(data));
+}
+
+/**@brief Progress of search for SENSOR_STATUS frames of a sensor. */
+typedef struct
+{
+    const sim_sensor_t * p_sensor;
+    size_t               next;           /**< Next frame to check. */
+    uint64_t             opened_us;      /**< Time of last CONNECTION_OPENED frame with ID of the sensor. */
+}
+sim_fixture_status_t;
+
+/**@brief CONNECTION_OPENED frame of sensor, under data ID of any instance of its type. */
+static bool sim_fixture_is_opened(const sim_kinetis_frame_t * p_frame, const sim_sensor_t * p_sensor)
+{
+    return DATA_ID_IS_SENSOR(p_frame->frame.data_id) &&
+           (DATA_ID_GET_TYPE(p_frame->frame.data_id) == sim_sensor_type(p_sensor)) &&
+           (p_frame->frame.field_id == FIELD_ID_SENSOR_STATUS) &&
+           (p_frame->frame.operation == CONNECTION_OPENED) &&
+           (memcmp(p_frame->frame.data, sim_sensor_id(p_sensor), sizeof(sensorID_t)) == 0);
+}
+
+static bool sim_fixture_running(sim_fixture_status_t * p_status)
+{
+    for(; p_status->next < sim_kinetis_frame_count(); p_status->next++)
+    {
+        const sim_kinetis_frame_t * p_frame = sim_kinetis_frame(p_status->next);
+
+        if(sim_fixture_is_opened(p_frame, p_status->p_sensor))
+        {
+            p_status->opened_us = p_frame->time;
+        }
+    }
+
+    // Status frame of previous connection does not count.
+    return sim_sensor_connected(p_status->p_sensor) &&
+           (p_status->opened_us >= sim_sensor_stats(p_status->p_sensor)->connected_us);
+}
+
+static bool sim_fixture_running_cond(void * p_ctx)
+{
+    return sim_fixture_running((sim_fixture_status_t *)p_ctx);
+}
+
+uint64_t sim_fixture_wait_running(const sim_sensor_t * p_sensor, uint64_t timeout)
+{
+    const uint64_t       start  = sim_now();
+    sim_fixture_status_t status = { .p_sensor = p_sensor };
+
+    if(sim_run_until_cond(sim_fixture_running_cond, &status, timeout) == false)
+    {
+        return UINT64_MAX;
+    }
+    return sim_now() - start;
+}
+
+static bool sim_fixture_all_running_cond(void * p_ctx)
+{
+    sim_fixture_status_t * p_status = p_ctx;
+    uint8_t                index;
+
+    for(index = 0; index < sim_sensor_count(); index++)
+    {
+        if( (sim_sensor_cfg(p_status[index].p_sensor)->mode != SIM_SENSOR_NOISE) &&
+            (sim_fixture_running(&p_status[index]) == false) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sim_fixture_wait_all_running(uint64_t timeout)
+{
+    sim_fixture_status_t status[SIM_SENSOR_MAX] = { { 0 } };
+    uint8_t              index;
+
+    for(index = 0; index < sim_sensor_count(); index++)
+    {
+        status[index].p_sensor = sim_sensor_get(index);
+    }
+    return sim_run_until_cond(sim_fixture_all_running_cond, status, timeout);
+}
+
+static bool sim_fixture_connected_cond(void * p_ctx)
+{
+    const sim_fixture_wait_t * p_wait = p_ctx;
+
+    return sim_sensor_connected(p_wait->p_sensor) == p_wait->connected;
+}
+
+bool sim_fixture_wait_connected(const sim_sensor_t * p_sensor, bool connected, uint64_t timeout)
+{
+    sim_fixture_wait_t wait = { .p_sensor = p_sensor, .connected = connected };
+
+    return sim_run_until_cond(sim_fixture_connected_cond, &wait, timeout);
+}
+
+data_id_t sim_fixture_instance(const sim_sensor_t * p_sensor)
+{
+    size_t index;
+
+    for(index = sim_kinetis_frame_count(); index > 0; index--)
+    {
+        const sim_kinetis_frame_t * p_frame = sim_kinetis_frame(index - 1);
+
+        if(sim_fixture_is_opened(p_frame, p_sensor))
+        {
+            return (data_id_t)p_frame->frame.data_id;
+        }
+    }
+    return DATA_ID_ERROR;
+}
+
+uint32_t sim_fixture_count_frames(data_id_t data_id, uint8_t field_id, size_t from)
+{
+    uint32_t count = 0;
+
+    while(sim_kinetis_find(data_id, field_id, &from) != NULL)
+    {
+        count++;
+        from++;
+    }
+    return count;
+}
+
+uint32_t sim_fixture_check_values(data_id_t data_id, size_t from)
+{
+    const data_id_t             type  = DATA_ID_GET_TYPE(data_id);
+    const uint8_t               len   = sensors_get_msg_size(type, FIELD_ID_CHAR_SENSOR_DATA_R);
+    const sim_kinetis_frame_t * p_frame;
+    uint32_t                    count = 0;
+    uint8_t                     i;
+
+    while((p_frame = sim_kinetis_find(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, &from)) != NULL)
+    {
+        for(i = sizeof(uint32_t); i < len; i++)
+        {
+            if(p_frame->frame.data[i] != (uint8_t)(i ^ type))
+            {
+                sim_fail("data id 0x%02x frame %zu byte %u corrupted", data_id, from, i);
+            }
+        }
+        count++;
+        from++;
+    }
+    return count;
+}
+
+const sim_kinetis_frame_t * sim_fixture_time_sync(void)
+{
+    const uint32_t              host_time = (uint32_t)(sim_now() / SIM_US_PER_MS);
+    const size_t                from      = sim_kinetis_frame_count();
+    const sim_kinetis_frame_t * p_sync;
+
+    (void)sim_kinetis_send_config(FIELD_ID_TIME_SYNC, (const uint8_t *)&host_time, sizeof(host_time));
+    p_sync = sim_kinetis_wait(DATA_ID_DEV_CENTRAL, FIELD_ID_TIME_SYNC, from, SIM_FIXTURE_SYNC_TIMEOUT_US);
+    if( (p_sync == NULL) || (memcmp(&p_sync->frame.data[offsetof(timestamp_sync_t, host_time)], &host_time, sizeof(host_time)) != 0) )
+    {
+        sim_fail("time sync frame not received");
+    }
+    return p_sync;
+}
+
+int64_t sim_fixture_stamp_time(const sim_kinetis_frame_t * p_sync, const sim_kinetis_frame_t * p_frame)
+{
+    const int32_t ticks = (int32_t)(p_frame->ticks - p_sync->ticks);
+
+    return (int64_t)p_sync->time + ((int64_t)ticks * (int64_t)SIM_US_PER_S) / APP_TIMER_CLOCK_FREQ;
+}
+
+void sim_fixture_read_stats(stats_block_t * p_stats, bool snapshot)
+{
+    uint8_t page;
+
+    for(page = 0; page < STATS_NUM_OF_PAGES; page++)
+    {
+        const uint8_t               request[2] = { page, ((page == 0) && snapshot) ? 1 : 0 };
+        const size_t                from       = sim_kinetis_frame_count();
+        const sim_kinetis_frame_t * p_frame;
+        const size_t                offset     = (size_t)page * STATS_PAGE_DATA_SIZE;
+        size_t                      len        = sizeof(stats_block_t) - offset;
+
+        (void)sim_kinetis_send_config(FIELD_ID_STATS, request, sizeof(request));
+        p_frame = sim_kinetis_wait(DATA_ID_DEV_CENTRAL, FIELD_ID_STATS, from, SIM_FIXTURE_STATS_TIMEOUT_US);
+        if( (p_frame == NULL) || (p_frame->frame.data[0] != page) )
+        {
+            sim_fail("statistics page %u not received", page);
+        }
+
+        if(len > STATS_PAGE_DATA_SIZE)
+        {
+            len = STATS_PAGE_DATA_SIZE;
+        }
+        memcpy((uint8_t *)p_stats + offset, &p_frame->frame.data[1], len);
+    }
+}
+
+uint8_t sim_fixture_read_inventory(adv_inventory_record_t * p_records)
+{
+    size_t  next  = sim_kinetis_frame_count();
+    uint8_t count = 0;
+
+    (void)sim_kinetis_send_config(FIELD_ID_INVENTORY, NULL, 0);
+    for(;;)
+    {
+        const sim_kinetis_frame_t * p_frame = sim_kinetis_wait(DATA_ID_DEV_CENTRAL, FIELD_ID_INVENTORY, next, SIM_FIXTURE_DUMP_TIMEOUT_US);
+
+        if(p_frame == NULL)
+        {
+            sim_fail("inventory frame %u not received", count);
+        }
+        (void)sim_kinetis_find(DATA_ID_DEV_CENTRAL, FIELD_ID_INVENTORY, &next);
+        next++;
+
+        if(p_frame->frame.data[0] == ADV_INVENTORY_END)
+        {
+            if(p_frame->frame.data[1] != count)
+            {
+                sim_fail("inventory dump of %u records ended with %u", count, p_frame->frame.data[1]);
+            }
+            return count;
+        }
+        if(count == ADV_INVENTORY_SIZE)
+        {
+            sim_fail("inventory dump longer than %u records", ADV_INVENTORY_SIZE);
+        }
+        memcpy(&p_records[count++], &p_frame->frame.data[1], sizeof(adv_inventory_record_t));
+    }
+}
@@ -0,0 +1,115 @@
+/** @file   sim_fixture.h
+ *  @brief  Steps shared by tests and benchmarks: boot, mode selection over SPI
+ *          and waiting for sensors to be served.
+ */
+
+#ifndef SIM_FIXTURE_H__
+#define SIM_FIXTURE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim.h"
+#include "sim_sensor.h"
+#include "sim_kinetis.h"
+#include "stats.h"
+#include "adv_inventory.h"
+
+/**@brief Boot firmware and wait for firmware revision frame it reports on SPI. Fails simulation if it is not reported. */
+void sim_fixture_boot(void);
+
+/**@brief Power cycle the firmware, see sim_reboot(), and wait for firmware revision frame again.
+ *        Mode has to be selected again.
+ */
+void sim_fixture_reboot(void);
+
+/**@brief Select mode with FIELD_ID_RUN or FIELD_ID_CONFIG_START command. */
+void sim_fixture_run(void);
+void sim_fixture_config(void);
+
+/**@brief Pass passkey of sensor instance to the firmware, as host does before onboarding.
+ *
+ * @param[in] data_id    Sensor type and instance, see DATA_ID_INSTANCE().
+ * @param[in] p_passkey  Six digits.
+ */
+void sim_fixture_set_passkey(data_id_t data_id, const char * p_passkey);
+
+/**@brief Set duty plan of sensor instance with FIELD_ID_ROTATION command, see rotation_plan_t. */
+void sim_fixture_set_rotation(data_id_t data_id, uint16_t period_s, uint8_t window_s);
+
+/**@brief Enable or disable forwarding of sensor instance values from advertising packets with
+ *        FIELD_ID_ADV_INGEST command, see ADV_DATA_COMPANY_ID.
+ */
+void sim_fixture_set_adv_ingest(data_id_t data_id, bool enable);
+
+/**@brief Allow or forbid sensor type offering open Relayr service to skip security setup, with
+ *        FIELD_ID_OPEN_COMM command.
+ */
+void sim_fixture_set_open_comm(data_id_t data_id, bool allow);
+
+/**@brief Run until sensor is connected and the firmware reported it to the host as running, with
+ *        FIELD_ID_SENSOR_STATUS frame carrying the sensor ID, under data ID of any instance of its type.
+ *
+ * @return Time it took, UINT64_MAX on timeout.
+ */
+uint64_t sim_fixture_wait_running(const sim_sensor_t * p_sensor, uint64_t timeout);
+
+/**@brief Run until all sensors except NOISE ones are running.
+ *
+ * @return true if they have.
+ */
+bool sim_fixture_wait_all_running(uint64_t timeout);
+
+/**@brief Run until sensor is connected, or disconnected.
+ *
+ * @return true if state was reached.
+ */
+bool sim_fixture_wait_connected(const sim_sensor_t * p_sensor, bool connected, uint64_t timeout);
+
+/**@brief Data ID of instance the sensor was last reported running as, see DATA_ID_INSTANCE().
+ *
+ * @return Data ID, DATA_ID_ERROR if sensor was not reported.
+ */
+data_id_t sim_fixture_instance(const sim_sensor_t * p_sensor);
+
+/**@brief Count frames of a field received from data_id since frame index, 0xFF matches any field. */
+uint32_t sim_fixture_count_frames(data_id_t data_id, uint8_t field_id, size_t from);
+
+/**@brief Check DATA_R frames of sensor instance received since frame index: bytes after sequence
+ *        number carry pattern of the type. Fails simulation on corrupted value.
+ *
+ * @return Number of frames checked.
+ */
+uint32_t sim_fixture_check_values(data_id_t data_id, size_t from);
+
+/**@brief Start stamping with FIELD_ID_TIME_SYNC command and wait for time sync frame it answers with.
+ *        Fails simulation if it is not received.
+ *
+ * @return Time sync frame, reference of sim_fixture_stamp_time().
+ */
+const sim_kinetis_frame_t * sim_fixture_time_sync(void);
+
+/**@brief Simulation time of master time a frame was stamped with, as host derives it from reference
+ *        sync frame. Master time wraps at 32 bits, frames within 18 hours of reference are resolved.
+ *
+ * @param[in] p_sync   Reference time sync frame, reception time is taken as its master time.
+ * @param[in] p_frame  Stamped frame, see sim_kinetis_frame_t.stamped.
+ */
+int64_t sim_fixture_stamp_time(const sim_kinetis_frame_t * p_sync, const sim_kinetis_frame_t * p_frame);
+
+/**@brief Read statistics block page by page with FIELD_ID_STATS commands, as host does.
+ *
+ * @param[out] p_stats   Statistics block.
+ * @param[in]  snapshot  Take new snapshot and clear counters before reading.
+ */
+void sim_fixture_read_stats(stats_block_t * p_stats, bool snapshot);
+
+/**@brief Dump inventory of advertisers with FIELD_ID_INVENTORY command, as host does. Fails simulation
+ *        if dump does not end within ADV_INVENTORY_SIZE records.
+ *
+ * @param[out] p_records  ADV_INVENTORY_SIZE records.
+ *
+ * @return Number of records.
+ */
+uint8_t sim_fixture_read_inventory(adv_inventory_record_t * p_records);
+
+#endif // SIM_FIXTURE_H__
@@ -0,0 +1,110 @@
+/** @file   sim_internal.h
+ *  @brief  Hooks between modules of the simulator, not used by tests.
+ */
+
+#ifndef SIM_INTERNAL_H__
+#define SIM_INTERNAL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "sim_sensor.h"
+
+/**@brief Interrupt handlers of simulated peripherals. */
+void sim_timer_isr(void);
+void sim_softdevice_isr(void);
+
+/**@brief Applies tasks triggered by the firmware to SPIS, called after every run of firmware code. */
+void sim_spis_sync(void);
+
+/**@brief SPIS side of transaction started by Kinetis model.
+ *
+ * @details sim_spis_begin() is called when CSN falls and returns false if SPIS ignores the
+ *          transaction, then sim_spis_ignored() fills MISO with DEF characters when CSN rises.
+ *          Otherwise sim_spis_end() exchanges buffers and generates END event.
+ */
+bool sim_spis_begin(void);
+void sim_spis_end(const uint8_t * p_mosi, uint8_t * p_miso, uint8_t len);
+void sim_spis_ignored(uint8_t * p_miso, uint8_t len);
+
+/**@brief Drops state of simulated SoftDevice and peripherals after firmware reset. */
+void sim_softdevice_on_reset(void);
+void sim_timer_on_reset(void);
+void sim_pstorage_on_reset(void);
+
+/**@brief Notifies Kinetis model about change of RDY line driven by the firmware. */
+void sim_kinetis_on_rdy(bool level);
+
+/**@brief CSN line driven by Kinetis model. */
+bool sim_kinetis_csn(void);
+
+/**@brief Called on main loop read of CSN line, lets stress mode start transaction at that moment. */
+void sim_kinetis_on_csn_poll(void);
+
+/**@brief Queue system event or deferred call of a SoftDevice module, passed to the firmware from SWI2. */
+void sim_softdevice_post_sys_evt(uint32_t evt_id);
+void sim_softdevice_post_call(void (*handler)(void * p_ctx), void * p_ctx);
+
+/**@brief Link encryption with keys of a bond, started by device manager.
+ *
+ * @return NRF_SUCCESS or error code of sd_ble_gap_encrypt().
+ */
+uint32_t sim_softdevice_encrypt(uint16_t conn_handle, uint32_t key);
+
+/**@brief Key of bond created by last pairing of the link, 0 if none. */
+uint32_t sim_softdevice_link_key(uint16_t conn_handle);
+
+/**@brief Security level of the link: 1 open, 2 encrypted, 3 encrypted with MITM keys. */
+uint8_t sim_softdevice_link_level(uint16_t conn_handle);
+
+/**@brief Sensor advertises, SoftDevice delivers report or connects if master scans. */
+void sim_softdevice_on_adv(sim_sensor_t * p_sensor, const uint8_t * p_data, uint8_t len);
+
+/**@brief Sensor drops its link, e.g. it was powered off. Master sees supervision timeout. */
+void sim_softdevice_on_peer_lost(sim_sensor_t * p_sensor);
+
+/**@brief Sensor side of a link. */
+void sim_sensor_on_connected(sim_sensor_t * p_sensor);
+void sim_sensor_on_disconnected(sim_sensor_t * p_sensor);
+
+/**@brief Passkey entry of pairing, sensor displays its passkey.
+ *
+ * @return true if passkey entered at the master matches.
+ */
+bool sim_sensor_passkey_check(sim_sensor_t * p_sensor, const uint8_t * p_passkey);
+
+/**@brief Pairing finished, sensor keeps the key if it bonds. */
+void sim_sensor_on_paired(sim_sensor_t * p_sensor, bool success, uint32_t key, bool mitm, uint8_t level);
+
+/**@brief Encryption with stored keys requested by the master.
+ *
+ * @return true if sensor has the key.
+ */
+bool sim_sensor_on_encrypt(sim_sensor_t * p_sensor, uint32_t key, uint8_t * p_level);
+
+/**@brief ATT server of the sensor. Responses carry as many entries as fit into default MTU.
+ *
+ * @return GATT status, see BLE_GATT_STATUS_*.
+ */
+uint16_t sim_sensor_att_services(sim_sensor_t * p_sensor, uint16_t start, ble_gattc_evt_prim_srvc_disc_rsp_t * p_rsp);
+uint16_t sim_sensor_att_chars(sim_sensor_t * p_sensor, const ble_gattc_handle_range_t * p_range, ble_gattc_evt_char_disc_rsp_t * p_rsp);
+uint16_t sim_sensor_att_descs(sim_sensor_t * p_sensor, const ble_gattc_handle_range_t * p_range, ble_gattc_evt_desc_disc_rsp_t * p_rsp);
+uint16_t sim_sensor_att_read(sim_sensor_t * p_sensor, uint16_t handle, uint8_t level, uint8_t * p_data, uint16_t * p_len);
+uint16_t sim_sensor_att_read_by_uuid(sim_sensor_t * p_sensor, uint16_t uuid, const ble_gattc_handle_range_t * p_range,
+                                     uint8_t level, uint16_t * p_handle, uint8_t * p_data, uint16_t * p_len);
+uint16_t sim_sensor_att_write(sim_sensor_t * p_sensor, uint16_t handle, uint8_t level, const uint8_t * p_data, uint16_t len);
+
+/**@brief Next notification queued by the sensor.
+ *
+ * @return false if there is none.
+ */
+bool sim_sensor_notify_pop(sim_sensor_t * p_sensor, uint16_t * p_handle, uint8_t * p_data, uint16_t * p_len);
+void sim_sensor_on_notified(sim_sensor_t * p_sensor);
+
+/**@brief ATT response of the sensor was lost on air. */
+void sim_sensor_on_rsp_dropped(sim_sensor_t * p_sensor);
+
+/**@brief Drops connections and registration of simulated device manager after firmware reset, bonds are kept. */
+void sim_dm_on_reset(void);
+
+#endif // SIM_INTERNAL_H__
@@ -0,0 +1,597 @@
+/** @file   sim_kinetis.c
+ *  @brief  Kinetis SPI master model: transaction timing driven by RDY line,
+ *          command queue, link layer of the host side and bit error injection.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "sim_kinetis.h"
+#include "timestamp.h"
+
+#define SIM_KINETIS_CSN_SETUP_US   2           /**< CSN low before first clock and after last one. */
+#define SIM_KINETIS_CRC_SIZE       (sizeof(spi_link_frame_t) - sizeof(uint16_t))
+
+typedef struct
+{
+    uint8_t bytes[SIM_KINETIS_FRAME_LEN];
+    uint8_t len;
+    bool    raw;
+}
+sim_kinetis_cmd_t;
+
+/**@brief Command sent with link layer, waiting for acknowledge. */
+typedef struct
+{
+    bool              valid;
+    sim_kinetis_cmd_t cmd;
+    uint8_t           retries;
+}
+sim_kinetis_sent_t;
+
+static sim_kinetis_cfg_t     sim_kinetis_cfg =
+{
+    .clock_hz       = 1000000,
+    .rdy_latency_us = 50,
+    .gap_us         = 20,
+};
+
+static sim_kinetis_stats_t   sim_kinetis_counters;
+static sim_kinetis_handler_t sim_kinetis_handler;
+static void                * sim_kinetis_handler_ctx;
+
+/**@brief Bus state. */
+static bool                  sim_kinetis_rdy;
+static bool                  sim_kinetis_csn_low;
+static bool                  sim_kinetis_owned;        /**< SPIS took part in transaction in progress. */
+static sim_event_t         * sim_kinetis_start_event;
+static uint64_t              sim_kinetis_last_end;
+static uint8_t               sim_kinetis_mosi[SIM_KINETIS_FRAME_LEN];
+static uint8_t               sim_kinetis_mosi_len;
+static bool                  sim_kinetis_mosi_cmd;     /**< Transaction carries head of command queue. */
+
+/**@brief Command queue. */
+static sim_kinetis_cmd_t     sim_kinetis_queue[SIM_KINETIS_QUEUE_SIZE];
+static uint8_t               sim_kinetis_queue_head;
+static uint8_t               sim_kinetis_queue_count;
+
+/**@brief Link layer, host side. */
+static bool                  sim_kinetis_link;
+static bool                  sim_kinetis_link_requested;
+static bool                  sim_kinetis_link_nak;
+static uint8_t               sim_kinetis_tx_seq;
+static uint8_t               sim_kinetis_rx_seq;
+static sim_kinetis_sent_t    sim_kinetis_pending_cmd;  /**< Sent in previous transaction. */
+static sim_kinetis_sent_t    sim_kinetis_retry;        /**< To be sent again with its sequence number. */
+
+/**@brief Time sync frames received, by sync_id. */
+static timestamp_sync_t      sim_kinetis_syncs[TIMESTAMP_SYNC_ID_MASK + 1];
+static uint16_t              sim_kinetis_syncs_valid;
+
+/**@brief Log of received frames. */
+static sim_kinetis_frame_t * sim_kinetis_log;
+static size_t                sim_kinetis_log_len;
+static size_t                sim_kinetis_log_cap;
+
+static void sim_kinetis_kick(void);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Frames. */
+
+static void sim_kinetis_flip_bits(uint8_t * p_bytes, uint8_t len)
+{
+    uint8_t cnt;
+    uint8_t bit;
+
+    if(sim_kinetis_cfg.bit_error_rate <= 0.0)
+    {
+        return;
+    }
+    for(cnt = 0; cnt < len; cnt++)
+    {
+        for(bit = 0; bit < 8; bit++)
+        {
+            if(sim_random_chance(sim_kinetis_cfg.bit_error_rate))
+            {
+                p_bytes[cnt] ^= (uint8_t)(1u << bit);
+                sim_kinetis_counters.bits_flipped++;
+            }
+        }
+    }
+}
+
+static void sim_kinetis_seal(uint8_t * p_bytes, uint8_t seq)
+{
+    spi_link_frame_t * p_frame = (spi_link_frame_t *)p_bytes;
+
+    p_frame->link.seq   = seq;
+    p_frame->link.ack   = sim_kinetis_rx_seq;
+    p_frame->link.flags = sim_kinetis_link_nak ? SPI_LINK_FLAG_NAK : 0;
+    p_frame->link.stamp = 0xFFFF;
+    p_frame->link.crc   = crc16_ccitt_compute(p_bytes, SIM_KINETIS_CRC_SIZE, 0xFFFF);
+}
+
+static void sim_kinetis_log_frame(const spi_link_frame_t * p_rx)
+{
+    sim_kinetis_frame_t * p_entry;
+
+    if(sim_kinetis_log_len == sim_kinetis_log_cap)
+    {
+        sim_kinetis_log_cap = (sim_kinetis_log_cap == 0) ? 1024 : (sim_kinetis_log_cap * 2);
+        sim_kinetis_log     = realloc(sim_kinetis_log, sim_kinetis_log_cap * sizeof(sim_kinetis_frame_t));
+    }
+
+    p_entry = &sim_kinetis_log[sim_kinetis_log_len++];
+    p_entry->time    = sim_now();
+    p_entry->frame   = p_rx->frame;
+    p_entry->link    = p_rx->link;
+    p_entry->stamped = false;
+    p_entry->ticks   = 0;
+    sim_kinetis_counters.frames++;
+
+    // Sync frame is sent ahead of frames stamped against it.
+    if( (p_rx->frame.data_id == DATA_ID_DEV_CENTRAL) && (p_rx->frame.field_id == FIELD_ID_TIME_SYNC) )
+    {
+        timestamp_sync_t sync;
+
+        memcpy(&sync, p_rx->frame.data, sizeof(sync));
+        sync.sync_id &= TIMESTAMP_SYNC_ID_MASK;
+        sim_kinetis_syncs[sync.sync_id] = sync;
+        sim_kinetis_syncs_valid        |= (uint16_t)(1u << sync.sync_id);
+        p_entry->stamped = true;
+        p_entry->ticks   = sync.ticks;
+    }
+    else if(sim_kinetis_link && (p_rx->link.stamp != TIMESTAMP_NONE))
+    {
+        const uint8_t sync_id = (p_rx->link.flags & SPI_LINK_FLAG_SYNC_MASK) >> SPI_LINK_FLAG_SYNC_POS;
+
+        if((sim_kinetis_syncs_valid & (1u << sync_id)) != 0)
+        {
+            p_entry->stamped = true;
+            p_entry->ticks   = sim_kinetis_syncs[sync_id].ticks + ((uint32_t)p_rx->link.stamp << sim_kinetis_syncs[sync_id].unit_shift);
+        }
+    }
+
+    if(sim_kinetis_handler != NULL)
+    {
+        sim_kinetis_handler(p_entry, sim_kinetis_handler_ctx);
+    }
+}
+
+static bool sim_kinetis_queue_push(const sim_kinetis_cmd_t * p_cmd)
+{
+    if(sim_kinetis_queue_count == SIM_KINETIS_QUEUE_SIZE)
+    {
+        sim_kinetis_counters.queue_full++;
+        return false;
+    }
+    sim_kinetis_queue[(sim_kinetis_queue_head + sim_kinetis_queue_count) % SIM_KINETIS_QUEUE_SIZE] = *p_cmd;
+    sim_kinetis_queue_count++;
+    sim_kinetis_kick();
+    return true;
+}
+
+static void sim_kinetis_queue_pop(void)
+{
+    sim_kinetis_queue_head = (sim_kinetis_queue_head + 1) % SIM_KINETIS_QUEUE_SIZE;
+    sim_kinetis_queue_count--;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Link layer, mirrors the firmware side in spi_slave_config.c. */
+
+/**@brief Verdict of the firmware on command sent in previous transaction. */
+static void sim_kinetis_link_verdict(bool acked)
+{
+    if(sim_kinetis_pending_cmd.valid == false)
+    {
+        return;
+    }
+    if(acked == false)
+    {
+        if(sim_kinetis_pending_cmd.retries >= SPI_LINK_MAX_RETRIES)
+        {
+            sim_kinetis_counters.abandoned++;
+        }
+        else
+        {
+            sim_kinetis_retry = sim_kinetis_pending_cmd;
+            sim_kinetis_retry.retries++;
+            sim_kinetis_counters.retransmits++;
+        }
+    }
+    sim_kinetis_pending_cmd.valid = false;
+}
+
+static void sim_kinetis_link_rx(const spi_link_frame_t * p_rx)
+{
+    if(crc16_ccitt_compute((const uint8_t *)p_rx, SIM_KINETIS_CRC_SIZE, 0xFFFF) != p_rx->link.crc)
+    {
+        sim_kinetis_counters.crc_errors++;
+        sim_kinetis_link_nak = true;
+        sim_kinetis_link_verdict(false);
+        return;
+    }
+
+    sim_kinetis_link_nak = false;
+    sim_kinetis_link_verdict( ((p_rx->link.flags & SPI_LINK_FLAG_NAK) == 0) &&
+                              (p_rx->link.ack == sim_kinetis_pending_cmd.cmd.bytes[sizeof(spi_frame_t)]) );
+
+    if(p_rx->frame.data_id == DATA_ID_ERROR)
+    {
+        return;
+    }
+    if(p_rx->link.seq == sim_kinetis_rx_seq)
+    {
+        sim_kinetis_counters.duplicates++;
+        return;
+    }
+    sim_kinetis_rx_seq = p_rx->link.seq;
+    sim_kinetis_log_frame(p_rx);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Transactions. */
+
+/**@brief Prepare MOSI of next transaction: command to retransmit, head of queue or empty frame. */
+static void sim_kinetis_mosi_build(void)
+{
+    const sim_kinetis_cmd_t * p_cmd = NULL;
+    uint8_t                   seq   = sim_kinetis_tx_seq;
+
+    sim_kinetis_mosi_cmd = false;
+    if(sim_kinetis_retry.valid)
+    {
+        p_cmd = &sim_kinetis_retry.cmd;
+        seq   = p_cmd->bytes[sizeof(spi_frame_t)];
+    }
+    else if(sim_kinetis_queue_count != 0)
+    {
+        p_cmd = &sim_kinetis_queue[sim_kinetis_queue_head];
+        sim_kinetis_mosi_cmd = true;
+        seq   = (sim_kinetis_tx_seq == 0xFF) ? 1 : (sim_kinetis_tx_seq + 1);
+    }
+
+    if(p_cmd != NULL)
+    {
+        memcpy(sim_kinetis_mosi, p_cmd->bytes, SIM_KINETIS_FRAME_LEN);
+        sim_kinetis_mosi_len = p_cmd->len;
+        if(p_cmd->raw)
+        {
+            return;
+        }
+    }
+    else
+    {
+        memset(sim_kinetis_mosi, 0xFF, SIM_KINETIS_FRAME_LEN);
+        sim_kinetis_mosi_len = SIM_KINETIS_FRAME_LEN;
+    }
+
+    if(sim_kinetis_link || sim_kinetis_link_requested)
+    {
+        sim_kinetis_seal(sim_kinetis_mosi, seq);
+    }
+}
+
+static void sim_kinetis_end(void * p_ctx)
+{
+    uint8_t            miso[SIM_KINETIS_FRAME_LEN];
+    uint8_t            mosi[SIM_KINETIS_FRAME_LEN];
+    spi_link_frame_t   rx;
+    sim_kinetis_cmd_t  sent;
+    bool               has_cmd = false;
+    uint8_t            retries = 0;
+
+    (void)p_ctx;
+
+    memcpy(mosi, sim_kinetis_mosi, sizeof(mosi));
+    sim_kinetis_flip_bits(mosi, sim_kinetis_mosi_len);
+
+    if(sim_kinetis_owned)
+    {
+        sim_spis_end(mosi, miso, sim_kinetis_mosi_len);
+    }
+    else
+    {
+        sim_spis_ignored(miso, sim_kinetis_mosi_len);
+    }
+    sim_kinetis_csn_low  = false;
+    sim_kinetis_last_end = sim_now();
+    sim_kinetis_counters.bus_us += SIM_KINETIS_CSN_SETUP_US * 2 + (uint64_t)sim_kinetis_mosi_len * 8 * SIM_US_PER_S / sim_kinetis_cfg.clock_hz;
+
+    if(sim_kinetis_owned == false)
+    {
+        // Nothing was received, the same command goes in next transaction.
+        sim_kinetis_counters.ignored++;
+        sim_kinetis_kick();
+        return;
+    }
+
+    // Command clocked in leaves queue, with link layer it waits for acknowledge.
+    if(sim_kinetis_retry.valid)
+    {
+        sent    = sim_kinetis_retry.cmd;
+        retries = sim_kinetis_retry.retries;
+        has_cmd = true;
+        sim_kinetis_retry.valid = false;
+        sim_kinetis_counters.commands++;
+    }
+    else if(sim_kinetis_mosi_cmd)
+    {
+        sent = sim_kinetis_queue[sim_kinetis_queue_head];
+        memcpy(sent.bytes, sim_kinetis_mosi, SIM_KINETIS_FRAME_LEN);
+        has_cmd = true;
+        sim_kinetis_queue_pop();
+        sim_kinetis_counters.commands++;
+        if(sim_kinetis_link || sim_kinetis_link_requested)
+        {
+            sim_kinetis_tx_seq = sim_kinetis_mosi[sizeof(spi_frame_t)];
+        }
+    }
+
+    sim_kinetis_flip_bits(miso, sim_kinetis_mosi_len);
+    memset(&rx, 0xFF, sizeof(rx));
+    memcpy(&rx, miso, sim_kinetis_mosi_len);
+
+    // Host switches link layer on with first frame carrying valid trailer after FIELD_ID_LINK.
+    if( sim_kinetis_link_requested &&
+        (crc16_ccitt_compute((const uint8_t *)&rx, SIM_KINETIS_CRC_SIZE, 0xFFFF) == rx.link.crc) )
+    {
+        sim_kinetis_link_requested = false;
+        sim_kinetis_link           = true;
+        sim_kinetis_rx_seq         = 0;
+    }
+
+    if(sim_kinetis_link)
+    {
+        sim_kinetis_link_rx(&rx);
+        if(has_cmd && (sent.raw == false))
+        {
+            sim_kinetis_pending_cmd.valid   = true;
+            sim_kinetis_pending_cmd.cmd     = sent;
+            sim_kinetis_pending_cmd.retries = retries;
+        }
+    }
+    else if(rx.frame.data_id != DATA_ID_ERROR)
+    {
+        sim_kinetis_log_frame(&rx);
+    }
+
+    sim_kinetis_kick();
+}
+
+static void sim_kinetis_start(void * p_ctx)
+{
+    uint64_t duration;
+
+    (void)p_ctx;
+    sim_kinetis_start_event = NULL;
+
+    sim_kinetis_mosi_build();
+    sim_kinetis_csn_low = true;
+    sim_kinetis_owned   = sim_spis_begin();
+    sim_kinetis_counters.transactions++;
+
+    duration = SIM_KINETIS_CSN_SETUP_US * 2 + (uint64_t)sim_kinetis_mosi_len * 8 * SIM_US_PER_S / sim_kinetis_cfg.clock_hz;
+    (void)sim_schedule_in(duration, sim_kinetis_end, NULL);
+}
+
+/**@brief Schedule next transaction if there is anything to send or RDY is high. */
+static void sim_kinetis_kick(void)
+{
+    uint64_t at;
+
+    if( sim_kinetis_csn_low || (sim_kinetis_start_event != NULL) )
+    {
+        return;
+    }
+    if( (sim_kinetis_rdy == false) && (sim_kinetis_queue_count == 0) && (sim_kinetis_retry.valid == false) &&
+        (sim_kinetis_pending_cmd.valid == false) )
+    {
+        return;
+    }
+
+    at = sim_now() + (sim_kinetis_rdy ? sim_kinetis_cfg.rdy_latency_us : 0);
+    if(at < (sim_kinetis_last_end + sim_kinetis_cfg.gap_us))
+    {
+        at = sim_kinetis_last_end + sim_kinetis_cfg.gap_us;
+    }
+    sim_kinetis_start_event = sim_schedule(at, sim_kinetis_start, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Lines. */
+
+void sim_kinetis_on_rdy(bool level)
+{
+    sim_kinetis_rdy = level;
+    if(level)
+    {
+        sim_kinetis_kick();
+    }
+}
+
+bool sim_kinetis_csn(void)
+{
+    return (sim_kinetis_csn_low == false);
+}
+
+void sim_kinetis_on_csn_poll(void)
+{
+    if( (sim_kinetis_cfg.csn_race <= 0.0) || sim_kinetis_csn_low ||
+        (sim_random_chance(sim_kinetis_cfg.csn_race) == false) )
+    {
+        return;
+    }
+
+    // CSN falls right after it was sampled high.
+    if(sim_kinetis_start_event != NULL)
+    {
+        sim_cancel(sim_kinetis_start_event);
+        sim_kinetis_start_event = NULL;
+    }
+    sim_kinetis_start(NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+sim_kinetis_cfg_t sim_kinetis_default_cfg(void)
+{
+    sim_kinetis_cfg_t cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.clock_hz       = 1000000;
+    cfg.rdy_latency_us = 50;
+    cfg.gap_us         = 20;
+    return cfg;
+}
+
+void sim_kinetis_set_cfg(const sim_kinetis_cfg_t * p_cfg)
+{
+    sim_kinetis_cfg = *p_cfg;
+}
+
+bool sim_kinetis_send(data_id_t data_id, uint8_t field_id, uint8_t operation, const uint8_t * p_data, uint8_t len)
+{
+    sim_kinetis_cmd_t  cmd;
+    spi_frame_t      * p_frame = (spi_frame_t *)cmd.bytes;
+
+    if(len > SPI_PACKET_DATA_SIZE)
+    {
+        sim_fail("command payload of %u bytes", len);
+    }
+
+    memset(&cmd, 0xFF, sizeof(cmd));
+    p_frame->data_id   = data_id;
+    p_frame->field_id  = field_id;
+    p_frame->operation = (operation_t)operation;
+    if(len != 0)
+    {
+        memcpy(p_frame->data, p_data, len);
+    }
+    cmd.len = SIM_KINETIS_FRAME_LEN;
+    cmd.raw = false;
+    return sim_kinetis_queue_push(&cmd);
+}
+
+bool sim_kinetis_send_config(uint8_t field_id, const uint8_t * p_data, uint8_t len)
+{
+    return sim_kinetis_send(DATA_ID_CONFIG, field_id, OPERATION_V1(OPERATION_WRITE, len), p_data, len);
+}
+
+bool sim_kinetis_send_raw(const uint8_t * p_bytes, uint8_t len)
+{
+    sim_kinetis_cmd_t cmd;
+
+    if(len > SIM_KINETIS_FRAME_LEN)
+    {
+        len = SIM_KINETIS_FRAME_LEN;
+    }
+    memset(&cmd, 0xFF, sizeof(cmd));
+    memcpy(cmd.bytes, p_bytes, len);
+    cmd.len = len;
+    cmd.raw = true;
+    return sim_kinetis_queue_push(&cmd);
+}
+
+void sim_kinetis_link_enable(void)
+{
+    const uint8_t capability = SPI_LINK_CAPABILITY;
+
+    sim_kinetis_link_requested = true;
+    sim_kinetis_tx_seq         = 0;
+    (void)sim_kinetis_send_config(FIELD_ID_LINK, &capability, sizeof(capability));
+}
+
+bool sim_kinetis_link_enabled(void)
+{
+    return sim_kinetis_link;
+}
+
+uint8_t sim_kinetis_pending(void)
+{
+    return sim_kinetis_queue_count + (sim_kinetis_retry.valid ? 1 : 0) + (sim_kinetis_pending_cmd.valid ? 1 : 0);
+}
+
+void sim_kinetis_set_handler(sim_kinetis_handler_t handler, void * p_ctx)
+{
+    sim_kinetis_handler     = handler;
+    sim_kinetis_handler_ctx = p_ctx;
+}
+
+size_t sim_kinetis_frame_count(void)
+{
+    return sim_kinetis_log_len;
+}
+
+const sim_kinetis_frame_t * sim_kinetis_frame(size_t index)
+{
+    return (index < sim_kinetis_log_len) ? &sim_kinetis_log[index] : NULL;
+}
+
+const sim_kinetis_frame_t * sim_kinetis_find(data_id_t data_id, uint8_t field_id, size_t * p_index)
+{
+    size_t index;
+
+    for(index = *p_index; index < sim_kinetis_log_len; index++)
+    {
+        const spi_frame_t * p_frame = &sim_kinetis_log[index].frame;
+
+        if( (p_frame->data_id == data_id) && ((field_id == 0xFF) || (p_frame->field_id == field_id)) )
+        {
+            *p_index = index;
+            return &sim_kinetis_log[index];
+        }
+    }
+    *p_index = sim_kinetis_log_len;
+    return NULL;
+}
+
+typedef struct
+{
+    data_id_t data_id;
+    uint8_t   field_id;
+    size_t    index;
+}
+sim_kinetis_wait_t;
+
+static bool sim_kinetis_wait_cond(void * p_ctx)
+{
+    sim_kinetis_wait_t * p_wait = p_ctx;
+
+    return sim_kinetis_find(p_wait->data_id, p_wait->field_id, &p_wait->index) != NULL;
+}
+
+const sim_kinetis_frame_t * sim_kinetis_wait(data_id_t data_id, uint8_t field_id, size_t from, uint64_t timeout)
+{
+    sim_kinetis_wait_t wait = { .data_id = data_id, .field_id = field_id, .index = from };
+
+    if(sim_run_until_cond(sim_kinetis_wait_cond, &wait, timeout) == false)
+    {
+        return NULL;
+    }
+    return &sim_kinetis_log[wait.index];
+}
+
+const sim_kinetis_stats_t * sim_kinetis_stats(void)
+{
+    return &sim_kinetis_counters;
+}
+
+void sim_kinetis_stats_reset(void)
+{
+    memset(&sim_kinetis_counters, 0, sizeof(sim_kinetis_counters));
+}
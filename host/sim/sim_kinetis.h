@@ -0,0 +1,113 @@
+/** @file   sim_kinetis.h
+ *  @brief  Kinetis host MCU as SPI master of the master module. It clocks out
+ *          queued commands and reads frames whenever RDY is high, optionally with
+ *          the link layer, see spi_link_frame_t in wunderbar_common.h.
+ *
+ *  @details Every transaction is sizeof(spi_link_frame_t) bytes long, frame
+ *           trailer is ignored by the firmware while link layer is disabled.
+ *           Transaction ignored by SPIS (semaphore owned by CPU) is repeated with
+ *           the same command. With link layer enabled, commands are sealed with
+ *           sequence number and CRC, and retransmitted if not acknowledged.
+ *           Stamps of received frames are decoded against time sync frames, as
+ *           the host does after FIELD_ID_TIME_SYNC command.
+ */
+
+#ifndef SIM_KINETIS_H__
+#define SIM_KINETIS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "wunderbar_common.h"
+
+#define SIM_KINETIS_FRAME_LEN    sizeof(spi_link_frame_t)
+#define SIM_KINETIS_QUEUE_SIZE   16        /**< Commands waiting to be clocked out. */
+
+typedef struct
+{
+    uint32_t clock_hz;            /**< SCK frequency. */
+    uint32_t rdy_latency_us;      /**< Delay from RDY high to CSN low. */
+    uint32_t gap_us;              /**< Shortest time between two transactions. */
+    double   bit_error_rate;      /**< Probability of flipped bit, on MOSI and MISO. */
+    double   csn_race;            /**< Probability that transaction starts right after main loop sampled CSN high or acquired SPIS semaphore. */
+}
+sim_kinetis_cfg_t;
+
+/**@brief Frame with data received from the firmware. */
+typedef struct
+{
+    uint64_t            time;     /**< End of transaction. */
+    spi_frame_t         frame;
+    spi_link_trailer_t  link;     /**< Valid if link layer was enabled. */
+    bool                stamped;  /**< Stamp of link trailer was decoded against time sync frame. */
+    uint32_t            ticks;    /**< Master time frame was created at, RTC1 ticks extended to 32 bits. */
+}
+sim_kinetis_frame_t;
+
+typedef struct
+{
+    uint32_t transactions;
+    uint32_t ignored;             /**< Transactions ignored by SPIS, DEF characters clocked out. */
+    uint32_t frames;              /**< Frames with data received, duplicates excluded. */
+    uint32_t commands;            /**< Commands clocked out, retransmissions included. */
+    uint32_t queue_full;          /**< Commands not queued. */
+    uint32_t crc_errors;          /**< Frames of the firmware failing link layer CRC check. */
+    uint32_t duplicates;          /**< Retransmitted frames discarded. */
+    uint32_t retransmits;         /**< Commands sent again as firmware did not acknowledge them. */
+    uint32_t abandoned;           /**< Commands given up after SPI_LINK_MAX_RETRIES. */
+    uint32_t bits_flipped;
+    uint64_t bus_us;              /**< Time CSN was low. */
+}
+sim_kinetis_stats_t;
+
+typedef void (*sim_kinetis_handler_t)(const sim_kinetis_frame_t * p_frame, void * p_ctx);
+
+/**@brief Defaults: 1 MHz clock, 50 us RDY latency, 20 us gap, no bit errors, no CSN race. */
+sim_kinetis_cfg_t sim_kinetis_default_cfg(void);
+void              sim_kinetis_set_cfg(const sim_kinetis_cfg_t * p_cfg);
+
+/**@brief Queue command frame. Payload is padded with 0xFF.
+ *
+ * @return false if queue is full.
+ */
+bool sim_kinetis_send(data_id_t data_id, uint8_t field_id, uint8_t operation, const uint8_t * p_data, uint8_t len);
+
+/**@brief Queue version 1 config command, see OPERATION_V1. */
+bool sim_kinetis_send_config(uint8_t field_id, const uint8_t * p_data, uint8_t len);
+
+/**@brief Queue raw bytes clocked out as they are, transaction is len bytes long. Link layer trailer is not added. */
+bool sim_kinetis_send_raw(const uint8_t * p_bytes, uint8_t len);
+
+/**@brief Enable link layer with FIELD_ID_LINK command, host side switches on first frame with valid trailer. */
+void sim_kinetis_link_enable(void);
+bool sim_kinetis_link_enabled(void);
+
+/**@brief Commands waiting to be clocked out or acknowledged. */
+uint8_t sim_kinetis_pending(void);
+
+/**@brief Handler called for every frame received, after it was logged. */
+void sim_kinetis_set_handler(sim_kinetis_handler_t handler, void * p_ctx);
+
+size_t                      sim_kinetis_frame_count(void);
+const sim_kinetis_frame_t * sim_kinetis_frame(size_t index);
+
+/**@brief Find first logged frame matching data_id and field_id, 0xFF matches any field.
+ *
+ * @param[in]    data_id   Data ID.
+ * @param[in]    field_id  Field ID or 0xFF.
+ * @param[inout] p_index   Index to start search at, index of frame found on return.
+ *
+ * @return Frame, NULL if not found.
+ */
+const sim_kinetis_frame_t * sim_kinetis_find(data_id_t data_id, uint8_t field_id, size_t * p_index);
+
+/**@brief Run simulation until matching frame is received after frame index from.
+ *
+ * @return Frame, NULL on timeout.
+ */
+const sim_kinetis_frame_t * sim_kinetis_wait(data_id_t data_id, uint8_t field_id, size_t from, uint64_t timeout);
+
+const sim_kinetis_stats_t * sim_kinetis_stats(void);
+void                        sim_kinetis_stats_reset(void);
+
+#endif // SIM_KINETIS_H__
@@ -0,0 +1,238 @@
+/** @file   sim_pstorage.c
+ *  @brief  Persistent storage on simulated flash. Loads are synchronous, stores,
+ *          updates and clears are queued and complete one after another with a
+ *          flash operation system event, as with the SDK module.
+ */
+
+/* -- Includes -- */
+
+#include <string.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "pstorage.h"
+#include "nrf_soc.h"
+
+#define SIM_FLASH_MODULE_SIZE   4096
+#define SIM_FLASH_OP_US         25000      /**< Duration of flash page update, erase included. */
+
+typedef struct
+{
+    uint8_t             op_code;
+    pstorage_handle_t   handle;
+    uint8_t           * p_src;
+    pstorage_size_t     size;
+    pstorage_size_t     offset;
+}
+sim_flash_op_t;
+
+static uint8_t                  sim_flash[PSTORAGE_MAX_APPLICATIONS][SIM_FLASH_MODULE_SIZE];
+static pstorage_module_param_t  sim_modules[PSTORAGE_MAX_APPLICATIONS];
+static uint8_t                  sim_module_count;
+static sim_flash_op_t           sim_ops[PSTORAGE_CMD_QUEUE_SIZE];
+static uint8_t                  sim_op_head;
+static uint8_t                  sim_op_count;
+static bool                     sim_op_running;
+static sim_event_t            * sim_op_event;
+static bool                     sim_flash_erased;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t * sim_flash_addr(pstorage_handle_t const * p_handle, pstorage_size_t offset)
+{
+    return &sim_flash[p_handle->module_id][p_handle->block_id + offset];
+}
+
+static bool sim_flash_access_valid(pstorage_handle_t const * p_handle, pstorage_size_t size, pstorage_size_t offset)
+{
+    if(p_handle->module_id >= sim_module_count)
+    {
+        return false;
+    }
+    return ((uint32_t)p_handle->block_id + offset + size) <= SIM_FLASH_MODULE_SIZE;
+}
+
+static void sim_flash_op_done(void * p_ctx)
+{
+    sim_flash_op_t * p_op  = &sim_ops[sim_op_head];
+    uint8_t        * p_dst = sim_flash_addr(&p_op->handle, p_op->offset);
+    pstorage_size_t  i;
+
+    (void)p_ctx;
+
+    sim_op_event = NULL;
+    switch(p_op->op_code)
+    {
+        case PSTORAGE_STORE_OP_CODE:
+            // Flash write only clears bits.
+            for(i = 0; i < p_op->size; i++)
+            {
+                p_dst[i] &= p_op->p_src[i];
+            }
+            break;
+
+        case PSTORAGE_UPDATE_OP_CODE:
+            memcpy(p_dst, p_op->p_src, p_op->size);
+            break;
+
+        default:
+            memset(p_dst, 0xFF, p_op->size);
+            break;
+    }
+    sim_softdevice_post_sys_evt(NRF_EVT_FLASH_OPERATION_SUCCESS);
+}
+
+static void sim_flash_op_start(void)
+{
+    if( (sim_op_running == false) && (sim_op_count != 0) )
+    {
+        sim_op_running = true;
+        sim_op_event   = sim_schedule_in(SIM_FLASH_OP_US, sim_flash_op_done, NULL);
+    }
+}
+
+static uint32_t sim_flash_op_queue(uint8_t op_code, pstorage_handle_t * p_dest, uint8_t * p_src,
+                                   pstorage_size_t size, pstorage_size_t offset)
+{
+    sim_flash_op_t * p_op;
+
+    if( (p_dest == NULL) || ((p_src == NULL) && (op_code != PSTORAGE_CLEAR_OP_CODE)) )
+    {
+        return NRF_ERROR_NULL;
+    }
+    if(sim_flash_access_valid(p_dest, size, offset) == false)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    if(sim_op_count == PSTORAGE_CMD_QUEUE_SIZE)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_op = &sim_ops[(sim_op_head + sim_op_count) % PSTORAGE_CMD_QUEUE_SIZE];
+    p_op->op_code = op_code;
+    p_op->handle  = *p_dest;
+    p_op->p_src   = p_src;
+    p_op->size    = size;
+    p_op->offset  = offset;
+    sim_op_count++;
+
+    sim_flash_op_start();
+    return NRF_SUCCESS;
+}
+
+void sim_pstorage_on_reset(void)
+{
+    // Operation in progress is lost, flash keeps what was written before.
+    sim_cancel(sim_op_event);
+    sim_op_event   = NULL;
+    sim_op_head    = 0;
+    sim_op_count   = 0;
+    sim_op_running = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief SDK persistent storage API. */
+
+void pstorage_sys_event_handler(uint32_t sys_evt)
+{
+    sim_flash_op_t op;
+
+    if( (sys_evt != NRF_EVT_FLASH_OPERATION_SUCCESS) || (sim_op_running == false) )
+    {
+        return;
+    }
+
+    op = sim_ops[sim_op_head];
+    sim_op_head    = (sim_op_head + 1) % PSTORAGE_CMD_QUEUE_SIZE;
+    sim_op_count--;
+    sim_op_running = false;
+    sim_flash_op_start();
+
+    sim_modules[op.handle.module_id].cb(&op.handle, op.op_code, NRF_SUCCESS, op.p_src, op.size);
+}
+
+uint32_t pstorage_init(void)
+{
+    if(sim_flash_erased == false)
+    {
+        memset(sim_flash, 0xFF, sizeof(sim_flash));
+        sim_flash_erased = true;
+    }
+    sim_module_count = 0;
+    sim_op_head      = 0;
+    sim_op_count     = 0;
+    sim_op_running   = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_register(pstorage_module_param_t * p_module_param, pstorage_handle_t * p_block_id)
+{
+    if( (p_module_param == NULL) || (p_block_id == NULL) || (p_module_param->cb == NULL) )
+    {
+        return NRF_ERROR_NULL;
+    }
+    if( (sim_module_count == PSTORAGE_MAX_APPLICATIONS) ||
+        (((uint32_t)p_module_param->block_size * p_module_param->block_count) > SIM_FLASH_MODULE_SIZE) )
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    sim_modules[sim_module_count] = *p_module_param;
+    p_block_id->module_id = sim_module_count++;
+    p_block_id->block_id  = 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_block_identifier_get(pstorage_handle_t * p_base_id, pstorage_size_t block_num,
+                                       pstorage_handle_t * p_block_id)
+{
+    pstorage_module_param_t * p_module;
+
+    if( (p_base_id == NULL) || (p_block_id == NULL) || (p_base_id->module_id >= sim_module_count) )
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_module = &sim_modules[p_base_id->module_id];
+    if(block_num >= p_module->block_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_block_id->module_id = p_base_id->module_id;
+    p_block_id->block_id  = p_base_id->block_id + ((uint32_t)block_num * p_module->block_size);
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_load(uint8_t * p_dest, pstorage_handle_t * p_src, pstorage_size_t size, pstorage_size_t offset)
+{
+    if( (p_dest == NULL) || (p_src == NULL) )
+    {
+        return NRF_ERROR_NULL;
+    }
+    if(sim_flash_access_valid(p_src, size, offset) == false)
+    {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    memcpy(p_dest, sim_flash_addr(p_src, offset), size);
+    return NRF_SUCCESS;
+}
+
+uint32_t pstorage_store(pstorage_handle_t * p_dest, uint8_t * p_src, pstorage_size_t size, pstorage_size_t offset)
+{
+    return sim_flash_op_queue(PSTORAGE_STORE_OP_CODE, p_dest, p_src, size, offset);
+}
+
+uint32_t pstorage_update(pstorage_handle_t * p_dest, uint8_t * p_src, pstorage_size_t size, pstorage_size_t offset)
+{
+    return sim_flash_op_queue(PSTORAGE_UPDATE_OP_CODE, p_dest, p_src, size, offset);
+}
+
+uint32_t pstorage_clear(pstorage_handle_t * p_base_id, pstorage_size_t size)
+{
+    return sim_flash_op_queue(PSTORAGE_CLEAR_OP_CODE, p_base_id, NULL, size, 0);
+}
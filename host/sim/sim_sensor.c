@@ -0,0 +1,1005 @@
+/** @file   sim_sensor.c
+ *  @brief  Virtual Wunderbar sensors: advertising, GATT database generated from
+ *          SENSOR_SCHEMA, security of sensor firmware and data notifications.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "sim_sensor.h"
+#include "onboard.h"
+
+#define SIM_ATT_MAX               48
+#define SIM_ATT_VALUE_MAX         (BLE_GATT_ATT_MTU_DEFAULT - 1)
+#define SIM_ADV_JITTER_US         10000       /**< Advertising delay added to each interval, 0..10 ms. */
+#define SIM_VALUE_HISTORY         256
+
+#define SIM_SEC_OPEN              1
+#define SIM_SEC_ENC               2
+#define SIM_SEC_MITM              3
+
+#define SIM_ATT_SRV_PER_RSP       3           /**< 16-bit UUID services in one Read By Group Type response. */
+#define SIM_ATT_CHAR_PER_RSP      3           /**< 16-bit UUID characteristics in one Read By Type response. */
+#define SIM_ATT_DESC_PER_RSP      5           /**< 16-bit UUID descriptors in one Find Information response. */
+
+extern const uint8_t  SENSORS_DEVICE_NAME[MAX_CLIENTS][BLE_DEVNAME_MAX_LEN + 1];
+
+typedef struct
+{
+    uint16_t              type;      /**< Attribute type: service or characteristic declaration, CCCD, 0 for value. */
+    uint16_t              uuid;      /**< UUID of service or characteristic. */
+    uint16_t              end;       /**< End handle of service. */
+    ble_gatt_char_props_t props;
+    uint8_t               sec;       /**< Security level needed to access value. */
+    uint8_t               field;     /**< Field ID of sensor characteristic, 0xFF if none. */
+    uint8_t               len;
+    uint8_t               value[SIM_ATT_VALUE_MAX];
+}
+sim_att_t;
+
+typedef struct
+{
+    uint16_t handle;
+    uint16_t len;
+    uint8_t  data[SIM_ATT_VALUE_MAX];
+}
+sim_notification_t;
+
+struct sim_sensor_s
+{
+    sim_sensor_cfg_t     cfg;
+    char                 name[BLE_DEVNAME_MAX_LEN + 1];
+    char                 passkey[PASSKEY_SIZE + 1];
+    ble_gap_addr_t       addr;
+    uint8_t              id[sizeof(sensorID_t)];
+
+    bool                 powered;
+    bool                 connected;
+    bool                 bonded;
+    uint32_t             bond_key;
+
+    sim_att_t            att[SIM_ATT_MAX];
+    uint16_t             att_count;
+    uint16_t             data_r_handle;
+    uint16_t             batt_handle;
+    bool                 notify_data;
+    bool                 notify_batt;
+
+    sim_notification_t   queue[SIM_SENSOR_NOTIFY_QUEUE];
+    uint8_t              queue_head;
+    uint8_t              queue_count;
+
+    uint32_t             value_seq;
+    uint8_t              value[SPI_PACKET_DATA_SIZE];
+    uint64_t             value_time[SIM_VALUE_HISTORY];
+
+    sim_event_t        * p_adv_event;
+    sim_event_t        * p_value_event;
+    sim_sensor_stats_t   stats;
+};
+
+static sim_sensor_t * sim_sensors[SIM_SENSOR_MAX];
+static uint8_t        sim_sensor_num;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief GATT database. */
+
+static uint16_t sim_att_add(sim_sensor_t * p_sensor, uint16_t type, uint16_t uuid)
+{
+    sim_att_t * p_att;
+
+    if(p_sensor->att_count == SIM_ATT_MAX)
+    {
+        sim_fail("GATT database of %s does not fit", p_sensor->name);
+    }
+
+    p_att = &p_sensor->att[p_sensor->att_count++];
+    memset(p_att, 0, sizeof(sim_att_t));
+    p_att->type  = type;
+    p_att->uuid  = uuid;
+    p_att->sec   = SIM_SEC_OPEN;
+    p_att->field = 0xFF;
+    return p_sensor->att_count;
+}
+
+static sim_att_t * sim_att_get(sim_sensor_t * p_sensor, uint16_t handle)
+{
+    if( (handle == 0) || (handle > p_sensor->att_count) )
+    {
+        return NULL;
+    }
+    return &p_sensor->att[handle - 1];
+}
+
+static void sim_service_add(sim_sensor_t * p_sensor, uint16_t uuid)
+{
+    // Previous service ends right before this one.
+    if(p_sensor->att_count != 0)
+    {
+        uint16_t handle;
+
+        for(handle = p_sensor->att_count; handle > 0; handle--)
+        {
+            if(p_sensor->att[handle - 1].type == BLE_UUID_SERVICE_PRIMARY)
+            {
+                p_sensor->att[handle - 1].end = p_sensor->att_count;
+                break;
+            }
+        }
+    }
+    (void)sim_att_add(p_sensor, BLE_UUID_SERVICE_PRIMARY, uuid);
+}
+
+static uint16_t sim_char_add(sim_sensor_t * p_sensor, uint16_t uuid, bool read, bool write, bool notify,
+                             uint8_t sec, const void * p_value, uint8_t len)
+{
+    uint16_t    handle;
+    sim_att_t * p_att;
+
+    handle = sim_att_add(p_sensor, BLE_UUID_CHARACTERISTIC, uuid);
+    p_att  = sim_att_get(p_sensor, handle);
+    p_att->props.read   = read;
+    p_att->props.write  = write;
+    p_att->props.notify = notify;
+
+    handle = sim_att_add(p_sensor, 0, uuid);
+    p_att  = sim_att_get(p_sensor, handle);
+    p_att->props.read   = read;
+    p_att->props.write  = write;
+    p_att->sec          = sec;
+    p_att->field        = sensor_get_char_index(uuid);
+    p_att->len          = len;
+    if(p_value != NULL)
+    {
+        memcpy(p_att->value, p_value, len);
+    }
+
+    if(notify)
+    {
+        (void)sim_att_add(p_sensor, BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG, BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG);
+    }
+    return handle;
+}
+
+static void sim_relayr_chars_add(sim_sensor_t * p_sensor, uint8_t sec)
+{
+    extern const uint16_t SENSOR_CHAR_UUIDS[NUMBER_OF_RELAYR_CHARACTERISTICS + 4];
+    uint8_t  field;
+    uint8_t  value[SPI_PACKET_DATA_SIZE];
+
+    for(field = FIELD_ID_CHAR_SENSOR_ID; field <= FIELD_ID_CHAR_SENSOR_DATA_W; field++)
+    {
+        const uint8_t len    = sensors_get_msg_size(p_sensor->cfg.type, field);
+        const bool    read   = sensor_field_is_valid(p_sensor->cfg.type, field, OPERATION_READ);
+        const bool    write  = sensor_field_is_valid(p_sensor->cfg.type, field, OPERATION_WRITE);
+        const bool    notify = (SENSOR_FIELDS_NOTIFY & SENSOR_FIELD(field)) != 0;
+        uint16_t      handle;
+
+        if(read == false)
+        {
+            continue;
+        }
+
+        memset(value, 0, sizeof(value));
+        if(field == FIELD_ID_CHAR_SENSOR_ID)
+        {
+            memcpy(value, p_sensor->id, sizeof(p_sensor->id));
+        }
+
+        // DATA_W is written by the host only, it is not read back.
+        handle = sim_char_add(p_sensor, SENSOR_CHAR_UUIDS[field], (field != FIELD_ID_CHAR_SENSOR_DATA_W),
+                              write, notify, sec, value, len);
+        if(field == FIELD_ID_CHAR_SENSOR_DATA_R)
+        {
+            p_sensor->data_r_handle = handle;
+        }
+    }
+}
+
+static void sim_sensor_build_db(sim_sensor_t * p_sensor)
+{
+    static const char manufacturer[] = "relayr";
+    static const char hw_revision[]  = "WB-1.1";
+    static const char fw_revision[]  = "1.3.0";
+    uint8_t           flag;
+
+    p_sensor->att_count     = 0;
+    p_sensor->data_r_handle = 0;
+    p_sensor->batt_handle   = 0;
+
+    sim_service_add(p_sensor, BLE_UUID_GAP);
+    sim_char_add(p_sensor, BLE_UUID_GAP_CHARACTERISTIC_DEVICE_NAME, true, false, false, SIM_SEC_OPEN,
+                 p_sensor->name, strlen(p_sensor->name));
+    sim_char_add(p_sensor, BLE_UUID_GAP_CHARACTERISTIC_APPEARANCE, true, false, false, SIM_SEC_OPEN, "\0\0", 2);
+
+    sim_service_add(p_sensor, BLE_UUID_GATT);
+    sim_char_add(p_sensor, 0x2A05, false, false, true, SIM_SEC_OPEN, NULL, 4);
+
+    switch(p_sensor->cfg.mode)
+    {
+        case SIM_SENSOR_OPEN:
+            sim_service_add(p_sensor, SHORT_SERVICE_RELAYR_OPEN_COMM_UUID);
+            sim_relayr_chars_add(p_sensor, SIM_SEC_OPEN);
+
+            // Flag is read by UUID, it follows characteristics discovered by the master.
+            flag = p_sensor->cfg.open_mitm_flag ? 1 : 0;
+            sim_char_add(p_sensor, CHARACTERISTIC_SENSOR_MITM_REQ_FLAG_UUID, true, false, false, SIM_SEC_OPEN, &flag, 1);
+            break;
+
+        case SIM_SENSOR_CONFIG:
+            sim_service_add(p_sensor, SHORT_SERVICE_CONFIG_UUID);
+            sim_char_add(p_sensor, CHARACTERISTIC_SENSOR_ID_UUID, true, false, false, SIM_SEC_ENC,
+                         p_sensor->id, sizeof(p_sensor->id));
+            sim_char_add(p_sensor, CHARACTERISTIC_SENSOR_PASSKEY_UUID, true, true, false, SIM_SEC_ENC,
+                         p_sensor->passkey, PASSKEY_SIZE);
+            break;
+
+        default:
+            sim_service_add(p_sensor, SHORT_SERVICE_RELAYR_UUID);
+            sim_relayr_chars_add(p_sensor, SIM_SEC_MITM);
+            break;
+    }
+
+    sim_service_add(p_sensor, BLE_UUID_BATTERY_SERVICE);
+    flag = 87;
+    p_sensor->batt_handle = sim_char_add(p_sensor, BLE_UUID_BATTERY_LEVEL_CHAR, true, false, true, SIM_SEC_OPEN, &flag, 1);
+
+    sim_service_add(p_sensor, BLE_UUID_DEVICE_INFORMATION_SERVICE);
+    sim_char_add(p_sensor, BLE_UUID_MANUFACTURER_NAME_STRING_CHAR, true, false, false, SIM_SEC_OPEN,
+                 manufacturer, strlen(manufacturer));
+    sim_char_add(p_sensor, BLE_UUID_HARDWARE_REVISION_STRING_CHAR, true, false, false, SIM_SEC_OPEN,
+                 hw_revision, strlen(hw_revision));
+    sim_char_add(p_sensor, BLE_UUID_FIRMWARE_REVISION_STRING_CHAR, true, false, false, SIM_SEC_OPEN,
+                 fw_revision, strlen(fw_revision));
+
+    // Last service ends with attribute table.
+    sim_service_add(p_sensor, 0);
+    p_sensor->att_count--;
+    {
+        uint16_t handle;
+
+        for(handle = p_sensor->att_count; handle > 0; handle--)
+        {
+            if(p_sensor->att[handle - 1].type == BLE_UUID_SERVICE_PRIMARY)
+            {
+                p_sensor->att[handle - 1].end = BLE_GATT_HANDLE_END;
+                break;
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Advertising and values. */
+
+static uint8_t sim_sensor_value_len(const sim_sensor_t * p_sensor)
+{
+    return sensors_get_msg_size(p_sensor->cfg.type, FIELD_ID_CHAR_SENSOR_DATA_R);
+}
+
+static uint16_t sim_sensor_service_uuid(const sim_sensor_t * p_sensor)
+{
+    switch(p_sensor->cfg.mode)
+    {
+        case SIM_SENSOR_OPEN:
+            return SHORT_SERVICE_RELAYR_OPEN_COMM_UUID;
+
+        case SIM_SENSOR_CONFIG:
+            return SHORT_SERVICE_CONFIG_UUID;
+
+        default:
+            return SHORT_SERVICE_RELAYR_UUID;
+    }
+}
+
+static uint8_t sim_sensor_adv_build(const sim_sensor_t * p_sensor, uint8_t * p_data)
+{
+    const uint16_t uuids[3]  = { sim_sensor_service_uuid(p_sensor), BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_BATTERY_SERVICE };
+    const uint8_t  name_len  = strlen(p_sensor->name);
+    const uint8_t  value_len = sim_sensor_value_len(p_sensor);
+    const bool     adv_data  = p_sensor->cfg.adv_data && (value_len != 0);
+    const uint8_t  uuid_num  = adv_data ? 1 : 3;
+    uint8_t        len = 0;
+    uint8_t        i;
+
+    p_data[len++] = 2;
+    p_data[len++] = BLE_GAP_AD_TYPE_FLAGS;
+    p_data[len++] = BLE_GAP_ADV_FLAG_LE_GENERAL_DISC_MODE | BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+
+    // Sensor with data in advertising packet lists its main service only, to fit the value.
+    p_data[len++] = 1 + (2 * uuid_num);
+    p_data[len++] = BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE;
+    for(i = 0; i < uuid_num; i++)
+    {
+        p_data[len++] = (uint8_t)uuids[i];
+        p_data[len++] = (uint8_t)(uuids[i] >> 8);
+    }
+
+    p_data[len++] = 1 + name_len;
+    p_data[len++] = BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME;
+    memcpy(&p_data[len], p_sensor->name, name_len);
+    len += name_len;
+
+    if( adv_data && ((len + 2 + ADV_DATA_HEADER_SIZE + value_len) <= BLE_GAP_ADV_MAX_SIZE) )
+    {
+        p_data[len++] = 1 + ADV_DATA_HEADER_SIZE + value_len;
+        p_data[len++] = BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA;
+        p_data[len++] = (uint8_t)ADV_DATA_COMPANY_ID;
+        p_data[len++] = (uint8_t)(ADV_DATA_COMPANY_ID >> 8);
+        p_data[len++] = (uint8_t)p_sensor->value_seq;
+        memcpy(&p_data[len], p_sensor->value, value_len);
+        len += value_len;
+    }
+    return len;
+}
+
+static void sim_sensor_adv(void * p_ctx)
+{
+    sim_sensor_t * p_sensor = p_ctx;
+    uint8_t        data[BLE_GAP_ADV_MAX_SIZE + SIM_ATT_VALUE_MAX];
+    uint8_t        len;
+
+    p_sensor->p_adv_event = sim_schedule_in(SIM_MS(p_sensor->cfg.adv_interval_ms) + (sim_random() % SIM_ADV_JITTER_US),
+                                            sim_sensor_adv, p_sensor);
+
+    if( (p_sensor->powered == false) || p_sensor->connected )
+    {
+        return;
+    }
+
+    len = sim_sensor_adv_build(p_sensor, data);
+    p_sensor->stats.adv_sent++;
+    sim_softdevice_on_adv(p_sensor, data, len);
+}
+
+static void sim_sensor_notify_push(sim_sensor_t * p_sensor, uint16_t handle, const uint8_t * p_data, uint16_t len)
+{
+    sim_notification_t * p_ntf;
+
+    if(p_sensor->queue_count == SIM_SENSOR_NOTIFY_QUEUE)
+    {
+        p_sensor->stats.notify_overflow++;
+        return;
+    }
+
+    p_ntf = &p_sensor->queue[(p_sensor->queue_head + p_sensor->queue_count) % SIM_SENSOR_NOTIFY_QUEUE];
+    p_ntf->handle = handle;
+    p_ntf->len    = len;
+    memcpy(p_ntf->data, p_data, len);
+    p_sensor->queue_count++;
+}
+
+static void sim_sensor_value_new(void * p_ctx)
+{
+    sim_sensor_t * p_sensor = p_ctx;
+    const uint8_t  len      = sim_sensor_value_len(p_sensor);
+    uint8_t        i;
+
+    p_sensor->p_value_event = NULL;
+    if(p_sensor->cfg.notify_interval_ms != 0)
+    {
+        p_sensor->p_value_event = sim_schedule_in(SIM_MS(p_sensor->cfg.notify_interval_ms), sim_sensor_value_new, p_sensor);
+    }
+    if( (p_sensor->powered == false) || (len == 0) )
+    {
+        return;
+    }
+
+    // Value starts with its sequence number, so latency of each value can be measured at SPI.
+    p_sensor->value_seq++;
+    for(i = 0; i < len; i++)
+    {
+        p_sensor->value[i] = (i < sizeof(uint32_t)) ? (uint8_t)(p_sensor->value_seq >> (8 * i)) : (uint8_t)(i ^ p_sensor->cfg.type);
+    }
+    p_sensor->value_time[p_sensor->value_seq % SIM_VALUE_HISTORY] = sim_now();
+    p_sensor->stats.values++;
+
+    if(p_sensor->data_r_handle != 0)
+    {
+        sim_att_t * p_att = sim_att_get(p_sensor, p_sensor->data_r_handle);
+
+        memcpy(p_att->value, p_sensor->value, len);
+        if( p_sensor->connected && p_sensor->notify_data )
+        {
+            sim_sensor_notify_push(p_sensor, p_sensor->data_r_handle, p_sensor->value, len);
+        }
+    }
+}
+
+static void sim_sensor_value_restart(sim_sensor_t * p_sensor)
+{
+    sim_cancel(p_sensor->p_value_event);
+    p_sensor->p_value_event = NULL;
+    if(p_sensor->cfg.notify_interval_ms != 0)
+    {
+        p_sensor->p_value_event = sim_schedule_in(sim_random() % SIM_MS(p_sensor->cfg.notify_interval_ms) + 1,
+                                                  sim_sensor_value_new, p_sensor);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Public API. */
+
+sim_sensor_cfg_t sim_sensor_default_cfg(data_id_t type)
+{
+    sim_sensor_cfg_t cfg;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.type               = type;
+    cfg.mode               = SIM_SENSOR_SECURED;
+    cfg.adv_interval_ms    = ADV_INTERVAL_MS;
+    cfg.notify_interval_ms = 1000;
+    return cfg;
+}
+
+sim_sensor_t * sim_sensor_add(const sim_sensor_cfg_t * p_cfg)
+{
+    sim_sensor_t * p_sensor;
+    uint8_t        i;
+
+    if(sim_sensor_num == SIM_SENSOR_MAX)
+    {
+        sim_fail("too many sensors");
+    }
+
+    p_sensor = calloc(1, sizeof(sim_sensor_t));
+    p_sensor->cfg = *p_cfg;
+    if(p_sensor->cfg.adv_interval_ms == 0)
+    {
+        p_sensor->cfg.adv_interval_ms = ADV_INTERVAL_MS;
+    }
+    snprintf(p_sensor->name, sizeof(p_sensor->name), "%s",
+             (p_cfg->p_name != NULL) ? p_cfg->p_name : (const char *)SENSORS_DEVICE_NAME[p_cfg->type]);
+    snprintf(p_sensor->passkey, sizeof(p_sensor->passkey), "%s",
+             (p_cfg->p_passkey != NULL) ? p_cfg->p_passkey : (const char *)DEFAULT_SENSOR_PASSKEY);
+    p_sensor->cfg.p_name    = NULL;
+    p_sensor->cfg.p_passkey = NULL;
+
+    // Random static address, distinct per sensor.
+    p_sensor->addr.addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC;
+    p_sensor->addr.addr[0]   = sim_sensor_num;
+    for(i = 1; i < BLE_GAP_ADDR_LEN; i++)
+    {
+        p_sensor->addr.addr[i] = (uint8_t)sim_random();
+    }
+    p_sensor->addr.addr[BLE_GAP_ADDR_LEN - 1] |= 0xC0;
+    for(i = 0; i < sizeof(p_sensor->id); i++)
+    {
+        p_sensor->id[i] = (uint8_t)sim_random();
+    }
+
+    p_sensor->powered = true;
+    sim_sensor_build_db(p_sensor);
+
+    sim_sensors[sim_sensor_num++] = p_sensor;
+    p_sensor->p_adv_event = sim_schedule_in(sim_random() % SIM_MS(p_sensor->cfg.adv_interval_ms), sim_sensor_adv, p_sensor);
+    sim_sensor_value_restart(p_sensor);
+    return p_sensor;
+}
+
+void sim_sensor_set_mode(sim_sensor_t * p_sensor, sim_sensor_mode_t mode)
+{
+    if(p_sensor->connected)
+    {
+        sim_softdevice_on_peer_lost(p_sensor);
+    }
+    p_sensor->cfg.mode = mode;
+    sim_sensor_build_db(p_sensor);
+}
+
+void sim_sensor_set_power(sim_sensor_t * p_sensor, bool on)
+{
+    if( (on == false) && p_sensor->connected )
+    {
+        sim_softdevice_on_peer_lost(p_sensor);
+    }
+    p_sensor->powered = on;
+}
+
+void sim_sensor_set_link_loss(sim_sensor_t * p_sensor, double link_loss)
+{
+    p_sensor->cfg.link_loss = link_loss;
+}
+
+void sim_sensor_set_rsp_drop(sim_sensor_t * p_sensor, double rsp_drop)
+{
+    p_sensor->cfg.rsp_drop = rsp_drop;
+}
+
+void sim_sensor_set_notify_interval(sim_sensor_t * p_sensor, uint32_t notify_interval_ms)
+{
+    p_sensor->cfg.notify_interval_ms = notify_interval_ms;
+    sim_sensor_value_restart(p_sensor);
+}
+
+void sim_sensor_forget_bond(sim_sensor_t * p_sensor)
+{
+    p_sensor->bonded   = false;
+    p_sensor->bond_key = 0;
+}
+
+bool sim_sensor_connected(const sim_sensor_t * p_sensor)
+{
+    return p_sensor->connected;
+}
+
+bool sim_sensor_bonded(const sim_sensor_t * p_sensor)
+{
+    return p_sensor->bonded;
+}
+
+bool sim_sensor_notifying(const sim_sensor_t * p_sensor)
+{
+    return p_sensor->connected && p_sensor->notify_data;
+}
+
+const char * sim_sensor_passkey(const sim_sensor_t * p_sensor)
+{
+    return p_sensor->passkey;
+}
+
+const uint8_t * sim_sensor_id(const sim_sensor_t * p_sensor)
+{
+    return p_sensor->id;
+}
+
+data_id_t sim_sensor_type(const sim_sensor_t * p_sensor)
+{
+    return p_sensor->cfg.type;
+}
+
+uint8_t sim_sensor_count(void)
+{
+    return sim_sensor_num;
+}
+
+sim_sensor_t * sim_sensor_get(uint8_t index)
+{
+    return (index < sim_sensor_num) ? sim_sensors[index] : NULL;
+}
+
+const sim_sensor_stats_t * sim_sensor_stats(const sim_sensor_t * p_sensor)
+{
+    return &p_sensor->stats;
+}
+
+const uint8_t * sim_sensor_value(const sim_sensor_t * p_sensor, uint32_t * p_seq)
+{
+    if(p_seq != NULL)
+    {
+        *p_seq = p_sensor->value_seq;
+    }
+    return p_sensor->value;
+}
+
+uint64_t sim_sensor_value_time(const sim_sensor_t * p_sensor, uint32_t seq)
+{
+    if( (seq == 0) || (seq > p_sensor->value_seq) || ((p_sensor->value_seq - seq) >= SIM_VALUE_HISTORY) )
+    {
+        return 0;
+    }
+    return p_sensor->value_time[seq % SIM_VALUE_HISTORY];
+}
+
+uint32_t sim_sensor_value_seq(const uint8_t * p_value, uint8_t len)
+{
+    uint32_t seq = 0;
+    uint8_t  i;
+
+    for(i = 0; (i < len) && (i < sizeof(uint32_t)); i++)
+    {
+        seq |= (uint32_t)p_value[i] << (8 * i);
+    }
+    return seq;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Link and security, called by simulated SoftDevice. */
+
+const ble_gap_addr_t * sim_sensor_addr(const sim_sensor_t * p_sensor)
+{
+    return &p_sensor->addr;
+}
+
+const sim_sensor_cfg_t * sim_sensor_cfg(const sim_sensor_t * p_sensor)
+{
+    return &p_sensor->cfg;
+}
+
+void sim_sensor_on_connected(sim_sensor_t * p_sensor)
+{
+    p_sensor->connected          = true;
+    p_sensor->notify_data        = false;
+    p_sensor->notify_batt        = false;
+    p_sensor->queue_count        = 0;
+    p_sensor->stats.connections++;
+    p_sensor->stats.connected_us       = sim_now();
+    p_sensor->stats.secured_us         = 0;
+    p_sensor->stats.discovery_first_us = 0;
+    p_sensor->stats.discovery_last_us  = 0;
+}
+
+void sim_sensor_on_disconnected(sim_sensor_t * p_sensor)
+{
+    p_sensor->connected   = false;
+    p_sensor->notify_data = false;
+    p_sensor->notify_batt = false;
+    p_sensor->queue_count = 0;
+    p_sensor->stats.disconnections++;
+}
+
+bool sim_sensor_passkey_check(sim_sensor_t * p_sensor, const uint8_t * p_passkey)
+{
+    return (p_passkey != NULL) && (memcmp(p_sensor->passkey, p_passkey, PASSKEY_SIZE) == 0);
+}
+
+void sim_sensor_on_paired(sim_sensor_t * p_sensor, bool success, uint32_t key, bool mitm, uint8_t level)
+{
+    (void)mitm;
+    (void)level;
+
+    if(success == false)
+    {
+        p_sensor->stats.pairings_failed++;
+        return;
+    }
+
+    p_sensor->stats.pairings++;
+    p_sensor->stats.secured_us = sim_now();
+    if(key != 0)
+    {
+        p_sensor->bonded   = true;
+        p_sensor->bond_key = key;
+    }
+}
+
+bool sim_sensor_on_encrypt(sim_sensor_t * p_sensor, uint32_t key, uint8_t * p_level)
+{
+    if( (p_sensor->bonded == false) || (p_sensor->bond_key != key) )
+    {
+        return false;
+    }
+
+    // Key id carries MITM flag of pairing which created it, see sim_softdevice.c.
+    *p_level = ((key & 1) != 0) ? SIM_SEC_MITM : SIM_SEC_ENC;
+    p_sensor->stats.encryptions++;
+    p_sensor->stats.secured_us = sim_now();
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief ATT server. */
+
+static uint16_t sim_att_access_status(const sim_att_t * p_att, uint8_t level)
+{
+    if(level >= p_att->sec)
+    {
+        return BLE_GATT_STATUS_SUCCESS;
+    }
+    return (p_att->sec == SIM_SEC_MITM) ? BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION : BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION;
+}
+
+static void sim_sensor_count_discovery(sim_sensor_t * p_sensor)
+{
+    p_sensor->stats.att_requests++;
+    p_sensor->stats.att_discovery++;
+    if(p_sensor->stats.discovery_first_us == 0)
+    {
+        p_sensor->stats.discovery_first_us = sim_now();
+    }
+    p_sensor->stats.discovery_last_us = sim_now();
+}
+
+uint16_t sim_sensor_att_services(sim_sensor_t * p_sensor, uint16_t start, ble_gattc_evt_prim_srvc_disc_rsp_t * p_rsp)
+{
+    uint16_t handle;
+
+    sim_sensor_count_discovery(p_sensor);
+
+    p_rsp->count = 0;
+    for(handle = (start == 0) ? 1 : start; (handle <= p_sensor->att_count) && (p_rsp->count < SIM_ATT_SRV_PER_RSP); handle++)
+    {
+        const sim_att_t * p_att = sim_att_get(p_sensor, handle);
+
+        if(p_att->type == BLE_UUID_SERVICE_PRIMARY)
+        {
+            ble_gattc_service_t * p_srv = &p_rsp->services[p_rsp->count++];
+
+            p_srv->uuid.type                 = BLE_UUID_TYPE_BLE;
+            p_srv->uuid.uuid                 = p_att->uuid;
+            p_srv->handle_range.start_handle = handle;
+            p_srv->handle_range.end_handle   = p_att->end;
+        }
+    }
+    return (p_rsp->count == 0) ? BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND : BLE_GATT_STATUS_SUCCESS;
+}
+
+uint16_t sim_sensor_att_chars(sim_sensor_t * p_sensor, const ble_gattc_handle_range_t * p_range, ble_gattc_evt_char_disc_rsp_t * p_rsp)
+{
+    uint32_t handle;
+
+    sim_sensor_count_discovery(p_sensor);
+
+    p_rsp->count = 0;
+    for(handle = p_range->start_handle;
+        (handle <= p_range->end_handle) && (handle <= p_sensor->att_count) && (p_rsp->count < SIM_ATT_CHAR_PER_RSP);
+        handle++)
+    {
+        const sim_att_t * p_att = sim_att_get(p_sensor, handle);
+
+        if(p_att->type == BLE_UUID_CHARACTERISTIC)
+        {
+            ble_gattc_char_t * p_char = &p_rsp->chars[p_rsp->count++];
+
+            memset(p_char, 0, sizeof(ble_gattc_char_t));
+            p_char->uuid.type    = BLE_UUID_TYPE_BLE;
+            p_char->uuid.uuid    = p_att->uuid;
+            p_char->char_props   = p_att->props;
+            p_char->handle_decl  = handle;
+            p_char->handle_value = handle + 1;
+        }
+    }
+    return (p_rsp->count == 0) ? BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND : BLE_GATT_STATUS_SUCCESS;
+}
+
+uint16_t sim_sensor_att_descs(sim_sensor_t * p_sensor, const ble_gattc_handle_range_t * p_range, ble_gattc_evt_desc_disc_rsp_t * p_rsp)
+{
+    uint32_t handle;
+
+    sim_sensor_count_discovery(p_sensor);
+
+    p_rsp->count = 0;
+    for(handle = p_range->start_handle;
+        (handle <= p_range->end_handle) && (handle <= p_sensor->att_count) && (p_rsp->count < SIM_ATT_DESC_PER_RSP);
+        handle++)
+    {
+        const sim_att_t  * p_att  = sim_att_get(p_sensor, handle);
+        ble_gattc_desc_t * p_desc = &p_rsp->descs[p_rsp->count++];
+
+        p_desc->handle    = handle;
+        p_desc->uuid.type = BLE_UUID_TYPE_BLE;
+        p_desc->uuid.uuid = (p_att->type != 0) ? p_att->type : p_att->uuid;
+    }
+    return (p_rsp->count == 0) ? BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND : BLE_GATT_STATUS_SUCCESS;
+}
+
+uint32_t sim_sensor_discovery_requests_per_uuid(const sim_sensor_t * p_sensor)
+{
+    // Services registered by the master in run and config mode, in order of registration.
+    static const uint16_t run_uuids[]    = { SHORT_SERVICE_RELAYR_UUID, SHORT_SERVICE_RELAYR_OPEN_COMM_UUID,
+                                             BLE_UUID_BATTERY_SERVICE, BLE_UUID_DEVICE_INFORMATION_SERVICE };
+    static const uint16_t config_uuids[] = { SHORT_SERVICE_CONFIG_UUID,
+                                             BLE_UUID_BATTERY_SERVICE, BLE_UUID_DEVICE_INFORMATION_SERVICE };
+    const bool            config   = (p_sensor->cfg.mode == SIM_SENSOR_CONFIG);
+    const uint16_t      * p_uuids  = config ? config_uuids : run_uuids;
+    const uint8_t         count    = config ? (sizeof(config_uuids) / sizeof(uint16_t)) : (sizeof(run_uuids) / sizeof(uint16_t));
+    uint32_t              requests = 0;
+    uint8_t               index;
+
+    for(index = 0; index < count; index++)
+    {
+        uint16_t decls[SIM_ATT_MAX];
+        uint16_t decl_count = 0;
+        uint16_t start      = 0;
+        uint16_t end;
+        uint16_t handle;
+        uint16_t i;
+
+        // Primary service discovery by UUID.
+        requests++;
+        for(handle = 1; handle <= p_sensor->att_count; handle++)
+        {
+            if( (p_sensor->att[handle - 1].type == BLE_UUID_SERVICE_PRIMARY) &&
+                (p_sensor->att[handle - 1].uuid == p_uuids[index]) )
+            {
+                start = handle;
+                break;
+            }
+        }
+        if(start == 0)
+        {
+            continue;
+        }
+        end = p_sensor->att[start - 1].end;
+
+        // Characteristic discovery resumed after last value handle, until service end is reached.
+        handle = start;
+        for(;;)
+        {
+            uint16_t found = 0;
+
+            requests++;
+            for(; (handle <= end) && (handle <= p_sensor->att_count) && (found < SIM_ATT_CHAR_PER_RSP); handle++)
+            {
+                if(p_sensor->att[handle - 1].type == BLE_UUID_CHARACTERISTIC)
+                {
+                    decls[decl_count++] = handle;
+                    found++;
+                }
+            }
+            if( (found == 0) || ((decls[decl_count - 1] + 1) >= end) )
+            {
+                break;
+            }
+            handle = decls[decl_count - 1] + 2;
+        }
+
+        // Descriptor discovery for every characteristic followed by handles other than next declaration.
+        for(i = 0; i < decl_count; i++)
+        {
+            const uint16_t value = decls[i] + 1;
+
+            if( ((i + 1) < decl_count) ? ((value + 1) != decls[i + 1]) : (value != end) )
+            {
+                requests++;
+            }
+        }
+    }
+    return requests;
+}
+
+uint16_t sim_sensor_att_read(sim_sensor_t * p_sensor, uint16_t handle, uint8_t level, uint8_t * p_data, uint16_t * p_len)
+{
+    const sim_att_t * p_att = sim_att_get(p_sensor, handle);
+    uint16_t          status;
+
+    p_sensor->stats.att_requests++;
+    p_sensor->stats.att_reads++;
+
+    *p_len = 0;
+    if(p_att == NULL)
+    {
+        return BLE_GATT_STATUS_ATTERR_INVALID_HANDLE;
+    }
+    if( (p_att->type == 0) && (p_att->props.read == 0) )
+    {
+        return BLE_GATT_STATUS_ATTERR_READ_NOT_PERMITTED;
+    }
+    status = sim_att_access_status(p_att, level);
+    if(status != BLE_GATT_STATUS_SUCCESS)
+    {
+        return status;
+    }
+
+    if(p_att->type == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)
+    {
+        const bool enabled = (handle == (p_sensor->data_r_handle + 1)) ? p_sensor->notify_data :
+                             (handle == (p_sensor->batt_handle + 1))   ? p_sensor->notify_batt : false;
+
+        p_data[0] = enabled ? BLE_GATT_HVX_NOTIFICATION : 0;
+        p_data[1] = 0;
+        *p_len    = BLE_CCCD_VALUE_LEN;
+        return BLE_GATT_STATUS_SUCCESS;
+    }
+
+    memcpy(p_data, p_att->value, p_att->len);
+    *p_len = p_att->len;
+    return BLE_GATT_STATUS_SUCCESS;
+}
+
+uint16_t sim_sensor_att_read_by_uuid(sim_sensor_t * p_sensor, uint16_t uuid, const ble_gattc_handle_range_t * p_range,
+                                     uint8_t level, uint16_t * p_handle, uint8_t * p_data, uint16_t * p_len)
+{
+    uint32_t handle;
+
+    for(handle = p_range->start_handle; (handle <= p_range->end_handle) && (handle <= p_sensor->att_count); handle++)
+    {
+        const sim_att_t * p_att = sim_att_get(p_sensor, handle);
+
+        if( (p_att->type == 0) && (p_att->uuid == uuid) )
+        {
+            *p_handle = handle;
+            return sim_sensor_att_read(p_sensor, handle, level, p_data, p_len);
+        }
+    }
+
+    p_sensor->stats.att_requests++;
+    p_sensor->stats.att_reads++;
+    *p_len = 0;
+    return BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND;
+}
+
+uint16_t sim_sensor_att_write(sim_sensor_t * p_sensor, uint16_t handle, uint8_t level, const uint8_t * p_data, uint16_t len)
+{
+    sim_att_t * p_att = sim_att_get(p_sensor, handle);
+    uint16_t    status;
+
+    p_sensor->stats.att_requests++;
+    p_sensor->stats.att_writes++;
+
+    if(p_att == NULL)
+    {
+        return BLE_GATT_STATUS_ATTERR_INVALID_HANDLE;
+    }
+
+    if(p_att->type == BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG)
+    {
+        const bool enable = (len == BLE_CCCD_VALUE_LEN) && ((p_data[0] & BLE_GATT_HVX_NOTIFICATION) != 0);
+
+        if(len != BLE_CCCD_VALUE_LEN)
+        {
+            return BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+        }
+        if(handle == (p_sensor->data_r_handle + 1))
+        {
+            p_sensor->notify_data = enable;
+        }
+        else if(handle == (p_sensor->batt_handle + 1))
+        {
+            p_sensor->notify_batt = enable;
+        }
+        return BLE_GATT_STATUS_SUCCESS;
+    }
+
+    if( (p_att->type != 0) || (p_att->props.write == 0) )
+    {
+        return BLE_GATT_STATUS_ATTERR_WRITE_NOT_PERMITTED;
+    }
+    status = sim_att_access_status(p_att, level);
+    if(status != BLE_GATT_STATUS_SUCCESS)
+    {
+        return status;
+    }
+    if(len > SIM_ATT_VALUE_MAX)
+    {
+        return BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+
+    memcpy(p_att->value, p_data, len);
+    p_att->len = len;
+
+    // Onboarding writes passkey used by following pairings.
+    if(p_att->uuid == CHARACTERISTIC_SENSOR_PASSKEY_UUID)
+    {
+        if(len < PASSKEY_SIZE)
+        {
+            return BLE_GATT_STATUS_ATTERR_INVALID_ATT_VAL_LENGTH;
+        }
+        memcpy(p_sensor->passkey, p_data, PASSKEY_SIZE);
+        p_sensor->passkey[PASSKEY_SIZE] = '\0';
+    }
+    return BLE_GATT_STATUS_SUCCESS;
+}
+
+bool sim_sensor_notify_pop(sim_sensor_t * p_sensor, uint16_t * p_handle, uint8_t * p_data, uint16_t * p_len)
+{
+    sim_notification_t * p_ntf;
+
+    if(p_sensor->queue_count == 0)
+    {
+        return false;
+    }
+
+    p_ntf = &p_sensor->queue[p_sensor->queue_head];
+    *p_handle = p_ntf->handle;
+    *p_len    = p_ntf->len;
+    memcpy(p_data, p_ntf->data, p_ntf->len);
+
+    p_sensor->queue_head = (p_sensor->queue_head + 1) % SIM_SENSOR_NOTIFY_QUEUE;
+    p_sensor->queue_count--;
+    return true;
+}
+
+void sim_sensor_on_notified(sim_sensor_t * p_sensor)
+{
+    p_sensor->stats.notifications++;
+}
+
+void sim_sensor_on_rsp_dropped(sim_sensor_t * p_sensor)
+{
+    p_sensor->stats.att_rsp_dropped++;
+}
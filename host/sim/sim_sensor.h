@@ -0,0 +1,126 @@
+/** @file   sim_sensor.h
+ *  @brief  Virtual Wunderbar sensors. Each sensor advertises, accepts one
+ *          connection of the master and serves the GATT database of its type,
+ *          generated from SENSOR_SCHEMA, with security the sensor firmware
+ *          applies in the selected mode.
+ */
+
+#ifndef SIM_SENSOR_H__
+#define SIM_SENSOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wunderbar_common.h"
+#include "ble_gap.h"
+
+#define SIM_SENSOR_MAX            32
+#define SIM_SENSOR_NOTIFY_QUEUE   8       /**< Notifications a sensor buffers while link can not send them. */
+
+/**@brief Mode of sensor firmware. */
+typedef enum
+{
+    SIM_SENSOR_SECURED,      /**< Relayr service, passkey pairing with MITM required. */
+    SIM_SENSOR_OPEN,         /**< Open variant of Relayr service, no security. */
+    SIM_SENSOR_CONFIG,       /**< Config service, passkey can be written over encrypted link. */
+    SIM_SENSOR_NOISE,        /**< Advertises only, e.g. foreign device. Does not accept connections. */
+}
+sim_sensor_mode_t;
+
+typedef struct
+{
+    data_id_t          type;              /**< DATA_ID_DEV_*, selects name and GATT database. */
+    sim_sensor_mode_t  mode;
+    const char       * p_name;            /**< Advertised name, NULL for name of the type. */
+    const char       * p_passkey;         /**< Six digits, NULL for default passkey "000000". */
+    uint32_t           adv_interval_ms;   /**< 0 for ADV_INTERVAL_MS. */
+    uint32_t           notify_interval_ms;/**< Period of new DATA_R value, 0 for none. */
+    double             adv_loss;          /**< Probability that advertising packet is not received. */
+    double             link_loss;         /**< Probability that connection event fails. */
+    double             rsp_drop;          /**< Probability that ATT response is lost, see BLE_GATTC_EVT_TIMEOUT. */
+    bool               adv_data;          /**< Carry DATA_R value in manufacturer specific data. */
+    bool               open_mitm_flag;    /**< Value of MITM required flag in open mode. */
+}
+sim_sensor_cfg_t;
+
+/**@brief Counters of a sensor, since it was added. */
+typedef struct
+{
+    uint32_t adv_sent;
+    uint32_t connections;
+    uint32_t disconnections;
+    uint32_t pairings;                    /**< Completed pairings, passkey or Just Works. */
+    uint32_t pairings_failed;
+    uint32_t encryptions;                 /**< Links encrypted with stored bond. */
+    uint32_t att_requests;                /**< All ATT requests. */
+    uint32_t att_discovery;               /**< Service, characteristic and descriptor discovery requests. */
+    uint32_t att_reads;
+    uint32_t att_writes;
+    uint32_t att_rsp_dropped;
+    uint32_t values;                      /**< DATA_R values generated. */
+    uint32_t notifications;               /**< Notifications received by the master. */
+    uint32_t notify_overflow;             /**< Values lost as notification queue was full. */
+    uint64_t connected_us;                /**< Time of last connection. */
+    uint64_t secured_us;                  /**< Time link of last connection was secured, 0 if it was not. */
+    uint64_t discovery_first_us;          /**< Time of first discovery request of last connection. */
+    uint64_t discovery_last_us;           /**< Time of last discovery request of last connection. */
+}
+sim_sensor_stats_t;
+
+typedef struct sim_sensor_s sim_sensor_t;
+
+/**@brief Add sensor, it starts advertising at random time within its interval.
+ *
+ * @param[in] p_cfg  Configuration, copied.
+ *
+ * @return Sensor.
+ */
+sim_sensor_t * sim_sensor_add(const sim_sensor_cfg_t * p_cfg);
+
+/**@brief Default configuration of sensor type: secured mode, default passkey, one value per second. */
+sim_sensor_cfg_t sim_sensor_default_cfg(data_id_t type);
+
+/**@brief Switch sensor firmware mode, as the sensor button does. Link is dropped. */
+void sim_sensor_set_mode(sim_sensor_t * p_sensor, sim_sensor_mode_t mode);
+
+/**@brief Power sensor off or on. Powered off sensor neither advertises nor keeps its link. */
+void sim_sensor_set_power(sim_sensor_t * p_sensor, bool on);
+
+void sim_sensor_set_link_loss(sim_sensor_t * p_sensor, double link_loss);
+void sim_sensor_set_rsp_drop(sim_sensor_t * p_sensor, double rsp_drop);
+void sim_sensor_set_notify_interval(sim_sensor_t * p_sensor, uint32_t notify_interval_ms);
+
+/**@brief Drop bond of the sensor with the master, e.g. after its factory reset. */
+void sim_sensor_forget_bond(sim_sensor_t * p_sensor);
+
+const sim_sensor_cfg_t * sim_sensor_cfg(const sim_sensor_t * p_sensor);
+bool          sim_sensor_connected(const sim_sensor_t * p_sensor);
+bool          sim_sensor_bonded(const sim_sensor_t * p_sensor);
+bool          sim_sensor_notifying(const sim_sensor_t * p_sensor);
+const char  * sim_sensor_passkey(const sim_sensor_t * p_sensor);
+const uint8_t * sim_sensor_id(const sim_sensor_t * p_sensor);
+const ble_gap_addr_t * sim_sensor_addr(const sim_sensor_t * p_sensor);
+data_id_t     sim_sensor_type(const sim_sensor_t * p_sensor);
+uint8_t       sim_sensor_count(void);
+sim_sensor_t * sim_sensor_get(uint8_t index);
+const sim_sensor_stats_t * sim_sensor_stats(const sim_sensor_t * p_sensor);
+
+/**@brief Discovery requests the engine used before handle range discovery would issue on the
+ *        attribute table of the sensor: one primary service discovery per registered UUID,
+ *        characteristic discovery resumed after last value handle, and descriptor discovery
+ *        after every characteristic with other handles before the next declaration.
+ *        Baseline for att_discovery of the current engine.
+ */
+uint32_t sim_sensor_discovery_requests_per_uuid(const sim_sensor_t * p_sensor);
+
+/**@brief Last DATA_R value generated by sensor, with its sequence number. Value bytes follow
+ *        sensors_get_msg_size(type, FIELD_ID_CHAR_SENSOR_DATA_R).
+ */
+const uint8_t * sim_sensor_value(const sim_sensor_t * p_sensor, uint32_t * p_seq);
+
+/**@brief Time value with given sequence number was generated, 0 if it is too old to be known. */
+uint64_t sim_sensor_value_time(const sim_sensor_t * p_sensor, uint32_t seq);
+
+/**@brief Sequence number carried by DATA_R value, first four bytes of every value. */
+uint32_t sim_sensor_value_seq(const uint8_t * p_value, uint8_t len);
+
+#endif // SIM_SENSOR_H__
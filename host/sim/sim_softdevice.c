@@ -0,0 +1,1205 @@
+/** @file   sim_softdevice.c
+ *  @brief  Simulated S120 SoftDevice and SDK softdevice_handler, see sim_softdevice.h.
+ */
+
+/* -- Includes -- */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "sim_softdevice.h"
+#include "softdevice_handler.h"
+#include "ble_hci.h"
+
+#define SIM_SD_RSSI_BASE          (-48)
+#define SIM_SD_RSSI_STEP          3
+#define SIM_SD_RSSI_JITTER        5
+
+typedef enum
+{
+    SIM_SD_ITEM_BLE,
+    SIM_SD_ITEM_SYS,
+    SIM_SD_ITEM_CALL
+}
+sim_sd_item_kind_t;
+
+/**@brief Event waiting for the firmware. BLE event owns space for its variable length data. */
+typedef struct sim_sd_item_s
+{
+    struct sim_sd_item_s * p_next;
+    sim_sd_item_kind_t     kind;
+    uint32_t               sys_evt;
+    void                (* call)(void * p_ctx);
+    void                 * p_ctx;
+    union
+    {
+        ble_evt_t          evt;
+        uint8_t            raw[sizeof(ble_evt_t) + SIM_SD_EVT_DATA_MAX];
+    } ble;
+}
+sim_sd_item_t;
+
+typedef enum
+{
+    SIM_SEC_IDLE,
+    SIM_SEC_PAIR_REQ,                  /**< Pairing request to be sent. */
+    SIM_SEC_WAIT_KEY,                  /**< Passkey requested from the firmware. */
+    SIM_SEC_PAIR_EXCHANGE,             /**< Confirm and key exchange. */
+    SIM_SEC_ENCRYPT                    /**< Encryption with stored keys. */
+}
+sim_sec_state_t;
+
+typedef enum
+{
+    SIM_ATT_IDLE,
+    SIM_ATT_QUEUED,                    /**< Request waits for connection event. */
+    SIM_ATT_SENT,                      /**< Response arrives at next connection event. */
+    SIM_ATT_LOST                       /**< Response lost, ATT timeout runs. */
+}
+sim_att_state_t;
+
+typedef enum
+{
+    SIM_REQ_PRIM_SRVC,
+    SIM_REQ_CHARS,
+    SIM_REQ_DESCS,
+    SIM_REQ_READ,
+    SIM_REQ_READ_BY_UUID,
+    SIM_REQ_WRITE
+}
+sim_req_t;
+
+typedef struct
+{
+    bool                     in_use;
+    uint16_t                 conn_handle;
+    sim_sensor_t           * p_sensor;
+    uint64_t                 interval_us;
+    uint64_t                 supervision_us;
+    uint64_t                 last_good_us;
+    sim_event_t            * p_event;
+    bool                     peer_lost;
+    bool                     disconnecting;
+
+    uint8_t                  level;
+    uint32_t                 key;
+    sim_sec_state_t          sec_state;
+    ble_gap_sec_params_t     sec_params;
+    bool                     passkey_ok;
+    uint32_t                 encrypt_key;
+
+    sim_att_state_t          att_state;
+    sim_req_t                req;
+    uint16_t                 req_uuid;
+    uint16_t                 req_handle;
+    ble_gattc_handle_range_t req_range;
+    uint8_t                  req_data[BLE_GATT_ATT_MTU_DEFAULT];
+    uint16_t                 req_len;
+    sim_sd_item_t          * p_rsp;
+    sim_event_t            * p_att_timeout;
+}
+sim_link_t;
+
+static ble_evt_handler_t      sim_ble_handler;
+static sys_evt_handler_t      sim_sys_handler;
+static bool                   sim_sd_enabled;
+
+static sim_sd_item_t        * sim_queue_head;
+static sim_sd_item_t        * sim_queue_tail;
+static uint32_t               sim_queue_len;
+
+static bool                   sim_scanning;
+static ble_gap_scan_params_t  sim_scan_params;
+static uint64_t               sim_scan_since;
+static sim_event_t          * p_sim_scan_timeout;
+
+static bool                   sim_connecting;
+static ble_gap_addr_t         sim_connect_addr;
+static ble_gap_scan_params_t  sim_connect_scan;
+static ble_gap_conn_params_t  sim_connect_params;
+static uint64_t               sim_connect_since;
+static sim_event_t          * p_sim_connect_timeout;
+
+static sim_link_t             sim_links[SIM_SD_LINKS_MAX];
+static uint32_t               sim_key_counter;
+static sim_softdevice_stats_t sim_sd_stats;
+
+static void sim_link_event(void * p_ctx);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Event queue, drained by SWI2 handler. */
+
+static void sim_queue_push(sim_sd_item_t * p_item)
+{
+    p_item->p_next = NULL;
+    if(sim_queue_tail == NULL)
+    {
+        sim_queue_head = p_item;
+    }
+    else
+    {
+        sim_queue_tail->p_next = p_item;
+    }
+    sim_queue_tail = p_item;
+    sim_queue_len++;
+    if(sim_queue_len > sim_sd_stats.evt_queue_max)
+    {
+        sim_sd_stats.evt_queue_max = sim_queue_len;
+    }
+    sim_irq_set_pending(SIM_IRQ_SWI2);
+}
+
+static sim_sd_item_t * sim_queue_pop(void)
+{
+    sim_sd_item_t * p_item = sim_queue_head;
+
+    if(p_item != NULL)
+    {
+        sim_queue_head = p_item->p_next;
+        if(sim_queue_head == NULL)
+        {
+            sim_queue_tail = NULL;
+        }
+        sim_queue_len--;
+    }
+    return p_item;
+}
+
+static void sim_queue_clear(void)
+{
+    sim_sd_item_t * p_item;
+
+    while((p_item = sim_queue_pop()) != NULL)
+    {
+        free(p_item);
+    }
+}
+
+static sim_sd_item_t * sim_ble_evt_new(uint16_t evt_id, uint16_t conn_handle)
+{
+    sim_sd_item_t * p_item = calloc(1, sizeof(sim_sd_item_t));
+
+    p_item->kind                       = SIM_SD_ITEM_BLE;
+    p_item->ble.evt.header.evt_id      = evt_id;
+    p_item->ble.evt.header.evt_len     = sizeof(p_item->ble.raw) - sizeof(ble_evt_hdr_t);
+    p_item->ble.evt.evt.gap_evt.conn_handle = conn_handle;
+    return p_item;
+}
+
+void sim_softdevice_post_sys_evt(uint32_t evt_id)
+{
+    sim_sd_item_t * p_item = calloc(1, sizeof(sim_sd_item_t));
+
+    p_item->kind    = SIM_SD_ITEM_SYS;
+    p_item->sys_evt = evt_id;
+    sim_queue_push(p_item);
+}
+
+void sim_softdevice_post_call(void (*handler)(void * p_ctx), void * p_ctx)
+{
+    sim_sd_item_t * p_item = calloc(1, sizeof(sim_sd_item_t));
+
+    p_item->kind  = SIM_SD_ITEM_CALL;
+    p_item->call  = handler;
+    p_item->p_ctx = p_ctx;
+    sim_queue_push(p_item);
+}
+
+void sim_softdevice_isr(void)
+{
+    sim_sd_item_t * p_item;
+
+    while((p_item = sim_queue_pop()) != NULL)
+    {
+        switch(p_item->kind)
+        {
+            case SIM_SD_ITEM_BLE:
+                sim_sd_stats.ble_events++;
+                if(sim_ble_handler != NULL)
+                {
+                    sim_ble_handler(&p_item->ble.evt);
+                }
+                break;
+
+            case SIM_SD_ITEM_SYS:
+                sim_sd_stats.sys_events++;
+                if(sim_sys_handler != NULL)
+                {
+                    sim_sys_handler(p_item->sys_evt);
+                }
+                break;
+
+            default:
+                p_item->call(p_item->p_ctx);
+                break;
+        }
+        free(p_item);
+
+        // Handler may reset the firmware, the rest of events is dropped then.
+        if(sim_firmware_reset())
+        {
+            return;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Radio time accounting. */
+
+static uint64_t sim_duty_us(uint64_t since, const ble_gap_scan_params_t * p_params)
+{
+    if(p_params->interval == 0)
+    {
+        return 0;
+    }
+    return ((sim_now() - since) * p_params->window) / p_params->interval;
+}
+
+static void sim_scan_account(void)
+{
+    if(sim_scanning)
+    {
+        sim_sd_stats.scan_us += sim_duty_us(sim_scan_since, &sim_scan_params);
+        sim_scan_since = sim_now();
+    }
+    if(sim_connecting)
+    {
+        sim_sd_stats.initiator_us += sim_duty_us(sim_connect_since, &sim_connect_scan);
+        sim_connect_since = sim_now();
+    }
+}
+
+const sim_softdevice_stats_t * sim_softdevice_stats(void)
+{
+    sim_scan_account();
+    return &sim_sd_stats;
+}
+
+void sim_softdevice_stats_reset(void)
+{
+    sim_scan_account();
+    memset(&sim_sd_stats, 0, sizeof(sim_sd_stats));
+}
+
+bool sim_softdevice_scanning(void)
+{
+    return sim_scanning;
+}
+
+bool sim_softdevice_connecting(void)
+{
+    return sim_connecting;
+}
+
+uint8_t sim_softdevice_link_count(void)
+{
+    uint8_t count = 0;
+    uint8_t i;
+
+    for(i = 0; i < SIM_SD_LINKS_MAX; i++)
+    {
+        count += sim_links[i].in_use ? 1 : 0;
+    }
+    return count;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Links. */
+
+static sim_link_t * sim_link_get(uint16_t conn_handle)
+{
+    if( (conn_handle >= SIM_SD_LINKS_MAX) || (sim_links[conn_handle].in_use == false) )
+    {
+        return NULL;
+    }
+    return &sim_links[conn_handle];
+}
+
+static sim_link_t * sim_link_of_sensor(const sim_sensor_t * p_sensor)
+{
+    uint8_t i;
+
+    for(i = 0; i < SIM_SD_LINKS_MAX; i++)
+    {
+        if( sim_links[i].in_use && (sim_links[i].p_sensor == p_sensor) )
+        {
+            return &sim_links[i];
+        }
+    }
+    return NULL;
+}
+
+uint16_t sim_softdevice_conn_handle(const sim_sensor_t * p_sensor)
+{
+    const sim_link_t * p_link = sim_link_of_sensor(p_sensor);
+
+    return (p_link != NULL) ? p_link->conn_handle : BLE_CONN_HANDLE_INVALID;
+}
+
+static void sim_link_free(sim_link_t * p_link, uint8_t reason)
+{
+    sim_sd_item_t * p_item;
+
+    sim_cancel(p_link->p_event);
+    sim_cancel(p_link->p_att_timeout);
+    free(p_link->p_rsp);
+    if(p_link->peer_lost == false)
+    {
+        sim_sensor_on_disconnected(p_link->p_sensor);
+    }
+
+    p_item = sim_ble_evt_new(BLE_GAP_EVT_DISCONNECTED, p_link->conn_handle);
+    p_item->ble.evt.evt.gap_evt.params.disconnected.reason = reason;
+    sim_queue_push(p_item);
+
+    memset(p_link, 0, sizeof(sim_link_t));
+    sim_sd_stats.disconnections++;
+}
+
+static void sim_link_open(sim_sensor_t * p_sensor)
+{
+    sim_link_t    * p_link = NULL;
+    sim_sd_item_t * p_item;
+    uint8_t         i;
+
+    for(i = 0; i < SIM_SD_LINKS_MAX; i++)
+    {
+        if(sim_links[i].in_use == false)
+        {
+            p_link = &sim_links[i];
+            break;
+        }
+    }
+    if(p_link == NULL)
+    {
+        sim_fail("connection requested with all links in use");
+    }
+
+    memset(p_link, 0, sizeof(sim_link_t));
+    p_link->in_use         = true;
+    p_link->conn_handle    = i;
+    p_link->p_sensor       = p_sensor;
+    p_link->interval_us    = ((uint64_t)sim_connect_params.max_conn_interval * 1250);
+    p_link->supervision_us = ((uint64_t)sim_connect_params.conn_sup_timeout * 10000);
+    p_link->last_good_us   = sim_now();
+    p_link->level          = 1;
+    p_link->p_event        = sim_schedule_in(p_link->interval_us, sim_link_event, p_link);
+
+    sim_sensor_on_connected(p_sensor);
+    sim_sd_stats.connections++;
+
+    p_item = sim_ble_evt_new(BLE_GAP_EVT_CONNECTED, p_link->conn_handle);
+    p_item->ble.evt.evt.gap_evt.params.connected.peer_addr   = *sim_sensor_addr(p_sensor);
+    p_item->ble.evt.evt.gap_evt.params.connected.conn_params = sim_connect_params;
+    sim_queue_push(p_item);
+}
+
+/**@brief Security procedure step at successful connection event.
+ *
+ * @return true if a PDU was exchanged.
+ */
+
+static bool sim_link_security(sim_link_t * p_link)
+{
+    sim_sd_item_t * p_item;
+
+    switch(p_link->sec_state)
+    {
+        case SIM_SEC_PAIR_REQ:
+            if( p_link->sec_params.mitm && (p_link->sec_params.io_caps != BLE_GAP_IO_CAPS_NONE) )
+            {
+                p_item = sim_ble_evt_new(BLE_GAP_EVT_AUTH_KEY_REQUEST, p_link->conn_handle);
+                p_item->ble.evt.evt.gap_evt.params.auth_key_request.key_type = BLE_GAP_AUTH_KEY_TYPE_PASSKEY;
+                sim_queue_push(p_item);
+                p_link->sec_state = SIM_SEC_WAIT_KEY;
+            }
+            else
+            {
+                // Just Works.
+                p_link->passkey_ok = true;
+                p_link->sec_state  = SIM_SEC_PAIR_EXCHANGE;
+            }
+            return true;
+
+        case SIM_SEC_PAIR_EXCHANGE:
+        {
+            const bool mitm = p_link->sec_params.mitm && (p_link->sec_params.io_caps != BLE_GAP_IO_CAPS_NONE);
+
+            p_link->sec_state = SIM_SEC_IDLE;
+            if(p_link->passkey_ok == false)
+            {
+                sim_sensor_on_paired(p_link->p_sensor, false, 0, false, p_link->level);
+
+                p_item = sim_ble_evt_new(BLE_GAP_EVT_AUTH_STATUS, p_link->conn_handle);
+                p_item->ble.evt.evt.gap_evt.params.auth_status.auth_status = BLE_GAP_SEC_STATUS_CONFIRM_VALUE;
+                p_item->ble.evt.evt.gap_evt.params.auth_status.error_src   = BLE_GAP_SEC_STATUS_SOURCE_REMOTE;
+                sim_queue_push(p_item);
+                return true;
+            }
+
+            // Key id carries MITM flag, see sim_sensor_on_encrypt().
+            p_link->level = mitm ? 3 : 2;
+            p_link->key   = p_link->sec_params.bond ? (((++sim_key_counter) << 1) | (mitm ? 1 : 0)) : 0;
+            sim_sensor_on_paired(p_link->p_sensor, true, p_link->key, mitm, p_link->level);
+            sim_sd_stats.pairings++;
+
+            p_item = sim_ble_evt_new(BLE_GAP_EVT_CONN_SEC_UPDATE, p_link->conn_handle);
+            p_item->ble.evt.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm = 1;
+            p_item->ble.evt.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv = p_link->level;
+            p_item->ble.evt.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = p_link->sec_params.max_key_size;
+            sim_queue_push(p_item);
+
+            p_item = sim_ble_evt_new(BLE_GAP_EVT_AUTH_STATUS, p_link->conn_handle);
+            p_item->ble.evt.evt.gap_evt.params.auth_status.auth_status = BLE_GAP_SEC_STATUS_SUCCESS;
+            p_item->ble.evt.evt.gap_evt.params.auth_status.bonded      = (p_link->key != 0);
+            p_item->ble.evt.evt.gap_evt.params.auth_status.mitm        = mitm;
+            sim_queue_push(p_item);
+            return true;
+        }
+
+        case SIM_SEC_ENCRYPT:
+        {
+            uint8_t level;
+
+            p_link->sec_state = SIM_SEC_IDLE;
+            if(sim_sensor_on_encrypt(p_link->p_sensor, p_link->encrypt_key, &level) == false)
+            {
+                // Peer lost its keys, it rejects encryption and the link is closed.
+                sim_link_free(p_link, BLE_HCI_STATUS_CODE_PIN_OR_KEY_MISSING);
+                return true;
+            }
+
+            p_link->level = level;
+            p_link->key   = p_link->encrypt_key;
+            sim_sd_stats.encryptions++;
+
+            p_item = sim_ble_evt_new(BLE_GAP_EVT_CONN_SEC_UPDATE, p_link->conn_handle);
+            p_item->ble.evt.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.sm    = 1;
+            p_item->ble.evt.evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv    = level;
+            p_item->ble.evt.evt.gap_evt.params.conn_sec_update.conn_sec.encr_key_size = 16;
+            sim_queue_push(p_item);
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+static void sim_att_timeout(void * p_ctx)
+{
+    sim_link_t    * p_link = p_ctx;
+    sim_sd_item_t * p_item;
+
+    p_link->p_att_timeout = NULL;
+    p_link->att_state     = SIM_ATT_IDLE;
+    sim_sd_stats.gattc_timeouts++;
+
+    p_item = sim_ble_evt_new(BLE_GATTC_EVT_TIMEOUT, p_link->conn_handle);
+    p_item->ble.evt.evt.gattc_evt.params.timeout.src = BLE_GATT_TIMEOUT_SRC_PROTOCOL;
+    sim_queue_push(p_item);
+}
+
+/**@brief Sensor serves the request, response is delivered at next connection event. */
+
+static void sim_att_serve(sim_link_t * p_link)
+{
+    sim_sd_item_t   * p_item;
+    ble_gattc_evt_t * p_gattc;
+    uint8_t           data[BLE_GATT_ATT_MTU_DEFAULT];
+    uint16_t          len    = 0;
+    uint16_t          handle = p_link->req_handle;
+    uint16_t          status;
+
+    switch(p_link->req)
+    {
+        case SIM_REQ_PRIM_SRVC:
+            p_item  = sim_ble_evt_new(BLE_GATTC_EVT_PRIM_SRVC_DISC_RSP, p_link->conn_handle);
+            p_gattc = &p_item->ble.evt.evt.gattc_evt;
+            status  = sim_sensor_att_services(p_link->p_sensor, p_link->req_handle, &p_gattc->params.prim_srvc_disc_rsp);
+            if( (status == BLE_GATT_STATUS_SUCCESS) && (p_link->req_uuid != 0) )
+            {
+                // Discovery by UUID keeps matching services only.
+                ble_gattc_evt_prim_srvc_disc_rsp_t * p_rsp = &p_gattc->params.prim_srvc_disc_rsp;
+                uint16_t                             i;
+                uint16_t                             count = 0;
+
+                for(i = 0; i < p_rsp->count; i++)
+                {
+                    if(p_rsp->services[i].uuid.uuid == p_link->req_uuid)
+                    {
+                        p_rsp->services[count++] = p_rsp->services[i];
+                    }
+                }
+                p_rsp->count = count;
+                status = (count == 0) ? BLE_GATT_STATUS_ATTERR_ATTRIBUTE_NOT_FOUND : BLE_GATT_STATUS_SUCCESS;
+            }
+            break;
+
+        case SIM_REQ_CHARS:
+            p_item  = sim_ble_evt_new(BLE_GATTC_EVT_CHAR_DISC_RSP, p_link->conn_handle);
+            p_gattc = &p_item->ble.evt.evt.gattc_evt;
+            status  = sim_sensor_att_chars(p_link->p_sensor, &p_link->req_range, &p_gattc->params.char_disc_rsp);
+            break;
+
+        case SIM_REQ_DESCS:
+            p_item  = sim_ble_evt_new(BLE_GATTC_EVT_DESC_DISC_RSP, p_link->conn_handle);
+            p_gattc = &p_item->ble.evt.evt.gattc_evt;
+            status  = sim_sensor_att_descs(p_link->p_sensor, &p_link->req_range, &p_gattc->params.desc_disc_rsp);
+            break;
+
+        case SIM_REQ_READ:
+            p_item  = sim_ble_evt_new(BLE_GATTC_EVT_READ_RSP, p_link->conn_handle);
+            p_gattc = &p_item->ble.evt.evt.gattc_evt;
+            status  = sim_sensor_att_read(p_link->p_sensor, handle, p_link->level, data, &len);
+            p_gattc->params.read_rsp.handle = handle;
+            p_gattc->params.read_rsp.offset = 0;
+            p_gattc->params.read_rsp.len    = len;
+            memcpy(p_gattc->params.read_rsp.data, data, len);
+            break;
+
+        case SIM_REQ_READ_BY_UUID:
+        {
+            ble_gattc_evt_char_val_by_uuid_read_rsp_t * p_rsp;
+            uint8_t                                   * p_value;
+
+            p_item  = sim_ble_evt_new(BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP, p_link->conn_handle);
+            p_gattc = &p_item->ble.evt.evt.gattc_evt;
+            p_rsp   = &p_gattc->params.char_val_by_uuid_read_rsp;
+            status  = sim_sensor_att_read_by_uuid(p_link->p_sensor, p_link->req_uuid, &p_link->req_range, p_link->level,
+                                                  &handle, data, &len);
+
+            // Value follows handle-value pair, within the event buffer.
+            p_value = (uint8_t *)&p_rsp->handle_value[1];
+            memcpy(p_value, data, len);
+            p_rsp->count                    = (status == BLE_GATT_STATUS_SUCCESS) ? 1 : 0;
+            p_rsp->value_len                = len;
+            p_rsp->handle_value[0].handle   = handle;
+            p_rsp->handle_value[0].p_value  = p_value;
+            break;
+        }
+
+        default:
+            p_item  = sim_ble_evt_new(BLE_GATTC_EVT_WRITE_RSP, p_link->conn_handle);
+            p_gattc = &p_item->ble.evt.evt.gattc_evt;
+            status  = sim_sensor_att_write(p_link->p_sensor, handle, p_link->level, p_link->req_data, p_link->req_len);
+            p_gattc->params.write_rsp.handle   = handle;
+            p_gattc->params.write_rsp.write_op = BLE_GATT_OP_WRITE_REQ;
+            p_gattc->params.write_rsp.len      = p_link->req_len;
+            memcpy(p_gattc->params.write_rsp.data, p_link->req_data, p_link->req_len);
+            break;
+    }
+
+    p_gattc->gatt_status  = status;
+    p_gattc->error_handle = (status == BLE_GATT_STATUS_SUCCESS) ? BLE_GATT_HANDLE_INVALID : handle;
+    p_link->p_rsp         = p_item;
+}
+
+/**@brief ATT step at successful connection event.
+ *
+ * @return Number of PDUs exchanged.
+ */
+
+static uint8_t sim_link_att(sim_link_t * p_link)
+{
+    switch(p_link->att_state)
+    {
+        case SIM_ATT_QUEUED:
+            sim_att_serve(p_link);
+            p_link->att_state = SIM_ATT_SENT;
+            return 1;
+
+        case SIM_ATT_SENT:
+            if(sim_random_chance(sim_sensor_cfg(p_link->p_sensor)->rsp_drop))
+            {
+                free(p_link->p_rsp);
+                p_link->p_rsp         = NULL;
+                p_link->att_state     = SIM_ATT_LOST;
+                p_link->p_att_timeout = sim_schedule_in(SIM_SD_ATT_TIMEOUT_US, sim_att_timeout, p_link);
+                sim_sensor_on_rsp_dropped(p_link->p_sensor);
+                return 1;
+            }
+            sim_queue_push(p_link->p_rsp);
+            p_link->p_rsp     = NULL;
+            p_link->att_state = SIM_ATT_IDLE;
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+static uint8_t sim_link_notifications(sim_link_t * p_link)
+{
+    uint8_t count;
+
+    for(count = 0; count < SIM_SD_NOTIFY_PER_EVENT; count++)
+    {
+        sim_sd_item_t * p_item = sim_ble_evt_new(BLE_GATTC_EVT_HVX, p_link->conn_handle);
+        ble_gattc_evt_hvx_t * p_hvx = &p_item->ble.evt.evt.gattc_evt.params.hvx;
+
+        if(sim_sensor_notify_pop(p_link->p_sensor, &p_hvx->handle, p_hvx->data, &p_hvx->len) == false)
+        {
+            free(p_item);
+            break;
+        }
+        p_hvx->type = BLE_GATT_HVX_NOTIFICATION;
+        sim_queue_push(p_item);
+        sim_sensor_on_notified(p_link->p_sensor);
+        sim_sd_stats.notifications++;
+    }
+    return count;
+}
+
+static void sim_link_event(void * p_ctx)
+{
+    sim_link_t * p_link = p_ctx;
+    uint8_t      pdus   = 0;
+
+    p_link->p_event = NULL;
+    sim_sd_stats.conn_events++;
+
+    if( p_link->peer_lost ||
+        sim_random_chance(sim_sensor_cfg(p_link->p_sensor)->link_loss) )
+    {
+        sim_sd_stats.conn_events_lost++;
+        sim_sd_stats.conn_event_us += SIM_SD_CONN_EVENT_US;
+        if((sim_now() - p_link->last_good_us) >= p_link->supervision_us)
+        {
+            sim_sd_stats.supervision_timeouts++;
+            sim_link_free(p_link, BLE_HCI_CONNECTION_TIMEOUT);
+            return;
+        }
+        p_link->p_event = sim_schedule_in(p_link->interval_us, sim_link_event, p_link);
+        return;
+    }
+
+    p_link->last_good_us = sim_now();
+    if(p_link->disconnecting)
+    {
+        sim_link_free(p_link, BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION);
+        return;
+    }
+
+    if(sim_link_security(p_link))
+    {
+        pdus++;
+        if(p_link->in_use == false)
+        {
+            return;
+        }
+    }
+    pdus += sim_link_att(p_link);
+    pdus += sim_link_notifications(p_link);
+
+    sim_sd_stats.conn_event_us += SIM_SD_CONN_EVENT_US + (pdus * SIM_SD_PDU_US);
+    p_link->p_event = sim_schedule_in(p_link->interval_us, sim_link_event, p_link);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Radio side of sensors. */
+
+static bool sim_adv_received(const sim_sensor_t * p_sensor, const ble_gap_scan_params_t * p_params)
+{
+    const double duty = (p_params->interval != 0) ? ((double)p_params->window / (double)p_params->interval) : 0.0;
+
+    return sim_random_chance(duty * (1.0 - sim_sensor_cfg(p_sensor)->adv_loss));
+}
+
+void sim_softdevice_on_adv(sim_sensor_t * p_sensor, const uint8_t * p_data, uint8_t len)
+{
+    const sim_sensor_cfg_t * p_cfg = sim_sensor_cfg(p_sensor);
+
+    if( sim_connecting &&
+        (memcmp(&sim_connect_addr, sim_sensor_addr(p_sensor), sizeof(ble_gap_addr_t)) == 0) &&
+        (p_cfg->mode != SIM_SENSOR_NOISE) &&
+        sim_adv_received(p_sensor, &sim_connect_scan) )
+    {
+        sim_scan_account();
+        sim_connecting = false;
+        sim_cancel(p_sim_connect_timeout);
+        p_sim_connect_timeout = NULL;
+        sim_link_open(p_sensor);
+        return;
+    }
+
+    if( sim_scanning && sim_adv_received(p_sensor, &sim_scan_params) )
+    {
+        sim_sd_item_t            * p_item;
+        ble_gap_evt_adv_report_t * p_report;
+        uint8_t                    index;
+
+        if(sim_queue_len >= SIM_SD_EVT_QUEUE_MAX)
+        {
+            sim_sd_stats.adv_reports_dropped++;
+            return;
+        }
+
+        for(index = 0; sim_sensor_get(index) != p_sensor; index++)
+        {
+        }
+
+        p_item   = sim_ble_evt_new(BLE_GAP_EVT_ADV_REPORT, BLE_CONN_HANDLE_INVALID);
+        p_report = &p_item->ble.evt.evt.gap_evt.params.adv_report;
+        p_report->peer_addr = *sim_sensor_addr(p_sensor);
+        p_report->rssi      = SIM_SD_RSSI_BASE - (SIM_SD_RSSI_STEP * (index % 12)) - (int8_t)(sim_random() % SIM_SD_RSSI_JITTER);
+        p_report->type      = BLE_GAP_ADV_TYPE_ADV_IND;
+        p_report->dlen      = (len > BLE_GAP_ADV_MAX_SIZE) ? BLE_GAP_ADV_MAX_SIZE : len;
+        memcpy(p_report->data, p_data, p_report->dlen);
+        sim_queue_push(p_item);
+        sim_sd_stats.adv_reports++;
+    }
+}
+
+void sim_softdevice_on_peer_lost(sim_sensor_t * p_sensor)
+{
+    sim_link_t * p_link = sim_link_of_sensor(p_sensor);
+
+    if(p_link != NULL)
+    {
+        p_link->peer_lost = true;
+        sim_sensor_on_disconnected(p_sensor);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Security, used by device manager. */
+
+uint32_t sim_softdevice_encrypt(uint16_t conn_handle, uint32_t key)
+{
+    sim_link_t * p_link = sim_link_get(conn_handle);
+
+    if(p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if(p_link->sec_state != SIM_SEC_IDLE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    p_link->encrypt_key = key;
+    p_link->sec_state   = SIM_SEC_ENCRYPT;
+    return NRF_SUCCESS;
+}
+
+uint32_t sim_softdevice_link_key(uint16_t conn_handle)
+{
+    const sim_link_t * p_link = sim_link_get(conn_handle);
+
+    return (p_link != NULL) ? p_link->key : 0;
+}
+
+uint8_t sim_softdevice_link_level(uint16_t conn_handle)
+{
+    const sim_link_t * p_link = sim_link_get(conn_handle);
+
+    return (p_link != NULL) ? p_link->level : 0;
+}
+
+void sim_softdevice_on_reset(void)
+{
+    uint8_t i;
+
+    // Radio of the master stops, peers see their links time out.
+    for(i = 0; i < SIM_SD_LINKS_MAX; i++)
+    {
+        if(sim_links[i].in_use)
+        {
+            sim_cancel(sim_links[i].p_event);
+            sim_cancel(sim_links[i].p_att_timeout);
+            free(sim_links[i].p_rsp);
+            if(sim_links[i].peer_lost == false)
+            {
+                sim_sensor_on_disconnected(sim_links[i].p_sensor);
+            }
+            memset(&sim_links[i], 0, sizeof(sim_link_t));
+        }
+    }
+    sim_scan_account();
+    sim_scanning   = false;
+    sim_connecting = false;
+    sim_cancel(p_sim_scan_timeout);
+    sim_cancel(p_sim_connect_timeout);
+    p_sim_scan_timeout    = NULL;
+    p_sim_connect_timeout = NULL;
+
+    sim_queue_clear();
+    sim_ble_handler = NULL;
+    sim_sys_handler = NULL;
+    sim_sd_enabled  = false;
+    sim_dm_on_reset();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief SDK softdevice_handler. */
+
+uint32_t softdevice_handler_init(uint32_t clock_source, bool use_scheduler)
+{
+    (void)clock_source;
+
+    if(use_scheduler)
+    {
+        sim_fail("SoftDevice handler with scheduler is not simulated");
+    }
+
+    // Firmware initializes the handler twice, see main.c, second call keeps the stack running.
+    sim_sd_enabled = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_ble_evt_handler_set(ble_evt_handler_t ble_evt_handler)
+{
+    if(ble_evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    sim_ble_handler = ble_evt_handler;
+    return NRF_SUCCESS;
+}
+
+uint32_t softdevice_sys_evt_handler_set(sys_evt_handler_t sys_evt_handler)
+{
+    if(sys_evt_handler == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    sim_sys_handler = sys_evt_handler;
+    return NRF_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief GAP API. */
+
+static void sim_scan_timeout(void * p_ctx)
+{
+    sim_sd_item_t * p_item;
+
+    (void)p_ctx;
+    p_sim_scan_timeout = NULL;
+    sim_scan_account();
+    sim_scanning = false;
+
+    p_item = sim_ble_evt_new(BLE_GAP_EVT_TIMEOUT, BLE_CONN_HANDLE_INVALID);
+    p_item->ble.evt.evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_SCAN;
+    sim_queue_push(p_item);
+}
+
+static void sim_connect_timeout(void * p_ctx)
+{
+    sim_sd_item_t * p_item;
+
+    (void)p_ctx;
+    p_sim_connect_timeout = NULL;
+    sim_scan_account();
+    sim_connecting = false;
+    sim_sd_stats.connect_timeouts++;
+
+    p_item = sim_ble_evt_new(BLE_GAP_EVT_TIMEOUT, BLE_CONN_HANDLE_INVALID);
+    p_item->ble.evt.evt.gap_evt.params.timeout.src = BLE_GAP_TIMEOUT_SRC_CONN;
+    sim_queue_push(p_item);
+}
+
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const * const p_scan_params)
+{
+    if(sim_sd_enabled == false)
+    {
+        return NRF_ERROR_SOFTDEVICE_NOT_ENABLED;
+    }
+    if( sim_scanning || sim_connecting )
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if( (p_scan_params == NULL) || (p_scan_params->window > p_scan_params->interval) || (p_scan_params->window == 0) )
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    sim_scan_params = *p_scan_params;
+    sim_scan_since  = sim_now();
+    sim_scanning    = true;
+    if(p_scan_params->timeout != 0)
+    {
+        p_sim_scan_timeout = sim_schedule_in(SIM_S(p_scan_params->timeout), sim_scan_timeout, NULL);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_scan_stop(void)
+{
+    if(sim_scanning == false)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    sim_scan_account();
+    sim_scanning = false;
+    sim_cancel(p_sim_scan_timeout);
+    p_sim_scan_timeout = NULL;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_connect(ble_gap_addr_t const * const p_addr, ble_gap_scan_params_t const * const p_scan_params,
+                            ble_gap_conn_params_t const * const p_conn_params)
+{
+    if( sim_scanning || sim_connecting )
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if( (p_addr == NULL) || (p_scan_params == NULL) || (p_conn_params == NULL) ||
+        (p_scan_params->window == 0) || (p_scan_params->window > p_scan_params->interval) ||
+        (p_conn_params->max_conn_interval == 0) || (p_conn_params->conn_sup_timeout == 0) )
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if(sim_softdevice_link_count() == SIM_SD_LINKS_MAX)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    sim_connect_addr   = *p_addr;
+    sim_connect_scan   = *p_scan_params;
+    sim_connect_params = *p_conn_params;
+    sim_connect_since  = sim_now();
+    sim_connecting     = true;
+    sim_sd_stats.connect_requests++;
+    if(p_scan_params->timeout != 0)
+    {
+        p_sim_connect_timeout = sim_schedule_in(SIM_S(p_scan_params->timeout), sim_connect_timeout, NULL);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_connect_cancel(void)
+{
+    if(sim_connecting == false)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    sim_scan_account();
+    sim_connecting = false;
+    sim_cancel(p_sim_connect_timeout);
+    p_sim_connect_timeout = NULL;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code)
+{
+    sim_link_t * p_link = sim_link_get(conn_handle);
+
+    (void)hci_status_code;
+
+    if(p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if(p_link->disconnecting)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    p_link->disconnecting = true;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_authenticate(uint16_t conn_handle, ble_gap_sec_params_t const * const p_sec_params)
+{
+    sim_link_t * p_link = sim_link_get(conn_handle);
+
+    if(p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if(p_sec_params == NULL)
+    {
+        return NRF_ERROR_NULL;
+    }
+    if(p_link->sec_state != SIM_SEC_IDLE)
+    {
+        return NRF_ERROR_BUSY;
+    }
+    p_link->sec_params = *p_sec_params;
+    p_link->passkey_ok = false;
+    p_link->sec_state  = SIM_SEC_PAIR_REQ;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_auth_key_reply(uint16_t conn_handle, uint8_t key_type, uint8_t const * const key)
+{
+    sim_link_t * p_link = sim_link_get(conn_handle);
+
+    if(p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if(p_link->sec_state != SIM_SEC_WAIT_KEY)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    if(key_type != BLE_GAP_AUTH_KEY_TYPE_PASSKEY)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    p_link->passkey_ok = sim_sensor_passkey_check(p_link->p_sensor, key);
+    p_link->sec_state  = SIM_SEC_PAIR_EXCHANGE;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_conn_sec_get(uint16_t conn_handle, ble_gap_conn_sec_t * const p_conn_sec)
+{
+    const sim_link_t * p_link = sim_link_get(conn_handle);
+
+    if(p_link == NULL)
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    p_conn_sec->sec_mode.sm   = 1;
+    p_conn_sec->sec_mode.lv   = p_link->level;
+    p_conn_sec->encr_key_size = (p_link->level > 1) ? 16 : 0;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const * const p_write_perm, uint8_t const * const p_dev_name, uint16_t len)
+{
+    (void)p_write_perm;
+    return ((p_dev_name == NULL) || (len > BLE_DEVNAME_MAX_LEN)) ? NRF_ERROR_INVALID_PARAM : NRF_SUCCESS;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief GATT client API, one request per link at a time. */
+
+static uint32_t sim_gattc_request(uint16_t conn_handle, sim_link_t ** pp_link)
+{
+    sim_link_t * p_link = sim_link_get(conn_handle);
+
+    if(sim_isr_current() == SIM_IRQ_SPI1)
+    {
+        sim_sd_stats.gattc_from_spi_irq++;
+    }
+    if( (p_link == NULL) || p_link->disconnecting )
+    {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    if(p_link->att_state != SIM_ATT_IDLE)
+    {
+        sim_sd_stats.gattc_busy++;
+        return NRF_ERROR_BUSY;
+    }
+    p_link->att_state = SIM_ATT_QUEUED;
+    sim_sd_stats.gattc_requests++;
+    *pp_link = p_link;
+    return NRF_SUCCESS;
+}
+
+uint32_t sd_ble_gattc_primary_services_discover(uint16_t conn_handle, uint16_t start_handle, ble_uuid_t const * const p_srvc_uuid)
+{
+    sim_link_t * p_link;
+    uint32_t     err_code = sim_gattc_request(conn_handle, &p_link);
+
+    if(err_code == NRF_SUCCESS)
+    {
+        p_link->req        = SIM_REQ_PRIM_SRVC;
+        p_link->req_handle = start_handle;
+        p_link->req_uuid   = (p_srvc_uuid != NULL) ? p_srvc_uuid->uuid : 0;
+    }
+    return err_code;
+}
+
+uint32_t sd_ble_gattc_characteristics_discover(uint16_t conn_handle, ble_gattc_handle_range_t const * const p_handle_range)
+{
+    sim_link_t * p_link;
+    uint32_t     err_code = sim_gattc_request(conn_handle, &p_link);
+
+    if(err_code == NRF_SUCCESS)
+    {
+        p_link->req        = SIM_REQ_CHARS;
+        p_link->req_range  = *p_handle_range;
+        p_link->req_handle = p_handle_range->start_handle;
+    }
+    return err_code;
+}
+
+uint32_t sd_ble_gattc_descriptors_discover(uint16_t conn_handle, ble_gattc_handle_range_t const * const p_handle_range)
+{
+    sim_link_t * p_link;
+    uint32_t     err_code = sim_gattc_request(conn_handle, &p_link);
+
+    if(err_code == NRF_SUCCESS)
+    {
+        p_link->req        = SIM_REQ_DESCS;
+        p_link->req_range  = *p_handle_range;
+        p_link->req_handle = p_handle_range->start_handle;
+    }
+    return err_code;
+}
+
+uint32_t sd_ble_gattc_char_value_by_uuid_read(uint16_t conn_handle, ble_uuid_t const * const p_uuid, ble_gattc_handle_range_t const * const p_handle_range)
+{
+    sim_link_t * p_link;
+    uint32_t     err_code = sim_gattc_request(conn_handle, &p_link);
+
+    if(err_code == NRF_SUCCESS)
+    {
+        p_link->req        = SIM_REQ_READ_BY_UUID;
+        p_link->req_uuid   = p_uuid->uuid;
+        p_link->req_range  = *p_handle_range;
+        p_link->req_handle = p_handle_range->start_handle;
+    }
+    return err_code;
+}
+
+uint32_t sd_ble_gattc_read(uint16_t conn_handle, uint16_t handle, uint16_t offset)
+{
+    sim_link_t * p_link;
+    uint32_t     err_code;
+
+    if(offset != 0)
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    err_code = sim_gattc_request(conn_handle, &p_link);
+    if(err_code == NRF_SUCCESS)
+    {
+        p_link->req        = SIM_REQ_READ;
+        p_link->req_handle = handle;
+    }
+    return err_code;
+}
+
+uint32_t sd_ble_gattc_write(uint16_t conn_handle, ble_gattc_write_params_t const * const p_write_params)
+{
+    sim_link_t * p_link;
+    uint32_t     err_code;
+
+    if( (p_write_params == NULL) || (p_write_params->write_op != BLE_GATT_OP_WRITE_REQ) )
+    {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+    if(p_write_params->len > (BLE_GATT_ATT_MTU_DEFAULT - 3))
+    {
+        return NRF_ERROR_DATA_SIZE;
+    }
+    err_code = sim_gattc_request(conn_handle, &p_link);
+    if(err_code == NRF_SUCCESS)
+    {
+        p_link->req        = SIM_REQ_WRITE;
+        p_link->req_handle = p_write_params->handle;
+        p_link->req_len    = p_write_params->len;
+        memcpy(p_link->req_data, p_write_params->p_value, p_write_params->len);
+    }
+    return err_code;
+}
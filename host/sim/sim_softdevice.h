@@ -0,0 +1,69 @@
+/** @file   sim_softdevice.h
+ *  @brief  Simulated S120 SoftDevice: scanner, initiator, up to seven links with
+ *          connection events, SMP pairing and encryption, and one ATT request per
+ *          link at a time. Events are passed to the firmware from SWI2, as
+ *          softdevice_handler does.
+ *
+ *  @details Link timing follows connection parameters requested by the firmware.
+ *           ATT request is sent at next successful connection event and its
+ *           response received at the following one. Lost connection events
+ *           delay both, link without successful event for supervision timeout
+ *           is dropped with reason BLE_HCI_CONNECTION_TIMEOUT. Response lost on
+ *           air is reported with BLE_GATTC_EVT_TIMEOUT after ATT timeout.
+ */
+
+#ifndef SIM_SOFTDEVICE_H__
+#define SIM_SOFTDEVICE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble.h"
+#include "sim_sensor.h"
+
+#define SIM_SD_LINKS_MAX             7           /**< Links of the master, as DEVICE_MANAGER_MAX_CONNECTIONS. */
+#define SIM_SD_ATT_TIMEOUT_US        30000000    /**< ATT transaction timeout. */
+#define SIM_SD_EVT_QUEUE_MAX         32          /**< Events buffered by the stack, advertising reports are dropped above. */
+#define SIM_SD_EVT_DATA_MAX          64          /**< Space for variable length data of an event. */
+#define SIM_SD_NOTIFY_PER_EVENT      4           /**< Notifications received per connection event. */
+#define SIM_SD_CONN_EVENT_US         400         /**< Radio time of connection event with empty packets. */
+#define SIM_SD_PDU_US                300         /**< Radio time added by each PDU with data. */
+
+/**@brief Counters of the simulated SoftDevice. */
+typedef struct
+{
+    uint64_t scan_us;                   /**< Radio time spent scanning, scan window duty applied. */
+    uint64_t initiator_us;              /**< Radio time spent by pending connection requests. */
+    uint64_t conn_event_us;             /**< Radio time of connection events. */
+    uint32_t adv_reports;               /**< Advertising reports passed to the firmware. */
+    uint32_t adv_reports_dropped;       /**< Advertising reports dropped as event buffer was full. */
+    uint32_t connect_requests;
+    uint32_t connect_timeouts;
+    uint32_t connections;
+    uint32_t disconnections;
+    uint32_t supervision_timeouts;
+    uint32_t conn_events;
+    uint32_t conn_events_lost;
+    uint32_t gattc_requests;            /**< ATT requests accepted from the firmware. */
+    uint32_t gattc_busy;                /**< ATT requests rejected with NRF_ERROR_BUSY. */
+    uint32_t gattc_from_spi_irq;        /**< ATT requests issued from SPI interrupt handler. */
+    uint32_t gattc_timeouts;
+    uint32_t notifications;
+    uint32_t pairings;
+    uint32_t encryptions;
+    uint32_t evt_queue_max;             /**< Highest number of events waiting for the firmware. */
+    uint32_t ble_events;                /**< BLE events passed to the firmware. */
+    uint32_t sys_events;                /**< SoC events passed to the firmware. */
+}
+sim_softdevice_stats_t;
+
+const sim_softdevice_stats_t * sim_softdevice_stats(void);
+void sim_softdevice_stats_reset(void);
+
+bool    sim_softdevice_scanning(void);
+bool    sim_softdevice_connecting(void);
+uint8_t sim_softdevice_link_count(void);
+
+/**@brief Connection handle of the link to sensor, BLE_CONN_HANDLE_INVALID if it is not connected. */
+uint16_t sim_softdevice_conn_handle(const sim_sensor_t * p_sensor);
+
+#endif // SIM_SOFTDEVICE_H__
@@ -0,0 +1,228 @@
+/** @file   sim_spis.c
+ *  @brief  GPIO and SPIS1 peripherals of the host simulator.
+ *
+ *  @details SPIS semaphore follows nRF51 reference manual: CPU acquires it with
+ *           TASKS_ACQUIRE if it is free, or gets it at the end of transaction in
+ *           progress (CPUPending). Transaction started while CPU owns semaphore is
+ *           ignored, DEF character is clocked out and nothing is received.
+ *           END_ACQUIRE shortcut hands semaphore to CPU at the end of transaction.
+ *           Tasks written by the firmware take effect on next register access or
+ *           when firmware code returns, whichever comes first.
+ */
+
+/* -- Includes -- */
+
+#include <string.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "gpio.h"
+#include "nrf_gpio.h"
+
+#define SIM_SPIS_RDY_PIN   2
+#define SIM_SPIS_CSN_PIN   3
+
+static NRF_GPIO_Type  sim_gpio;
+static NRF_SPIS_Type  sim_spis;
+static uint32_t       sim_spis_inten;
+static bool           sim_spis_rdy;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief SPIS. */
+
+static void sim_spis_acquired(void)
+{
+    sim_spis.SEMSTAT         = SPIS_SEMSTAT_SEMSTAT_CPU;
+    sim_spis.EVENTS_ACQUIRED = 1;
+    if((sim_spis_inten & (1UL << SPIS_INTENSET_ACQUIRED_Pos)) != 0)
+    {
+        sim_irq_set_pending(SIM_IRQ_SPI1);
+    }
+
+    // Master may also start transaction while main loop rewrites TX buffer.
+    if(sim_in_firmware_main())
+    {
+        sim_kinetis_on_csn_poll();
+    }
+}
+
+void sim_spis_sync(void)
+{
+    if(sim_spis.INTENSET != 0)
+    {
+        sim_spis_inten    |= sim_spis.INTENSET;
+        sim_spis.INTENSET  = 0;
+    }
+    if(sim_spis.INTENCLR != 0)
+    {
+        sim_spis_inten    &= ~sim_spis.INTENCLR;
+        sim_spis.INTENCLR  = 0;
+    }
+
+    if(sim_spis.TASKS_ACQUIRE != 0)
+    {
+        sim_spis.TASKS_ACQUIRE = 0;
+        if(sim_spis.ENABLE == SPIS_ENABLE_ENABLE_Enabled)
+        {
+            if(sim_spis.SEMSTAT == SPIS_SEMSTAT_SEMSTAT_Free)
+            {
+                sim_spis_acquired();
+            }
+            else if(sim_spis.SEMSTAT == SPIS_SEMSTAT_SEMSTAT_SPIS)
+            {
+                sim_spis.SEMSTAT = SPIS_SEMSTAT_SEMSTAT_CPUPending;
+            }
+        }
+    }
+
+    if(sim_spis.TASKS_RELEASE != 0)
+    {
+        sim_spis.TASKS_RELEASE = 0;
+        if(sim_spis.SEMSTAT == SPIS_SEMSTAT_SEMSTAT_CPU)
+        {
+            sim_spis.SEMSTAT = SPIS_SEMSTAT_SEMSTAT_Free;
+        }
+    }
+}
+
+NRF_SPIS_Type * sim_spis_regs(void)
+{
+    sim_spis_sync();
+    sim_busy_wait_tick();
+    return &sim_spis;
+}
+
+bool sim_spis_begin(void)
+{
+    sim_spis_sync();
+    if( (sim_spis.ENABLE != SPIS_ENABLE_ENABLE_Enabled) ||
+        (sim_spis.SEMSTAT != SPIS_SEMSTAT_SEMSTAT_Free) )
+    {
+        return false;
+    }
+    sim_spis.SEMSTAT = SPIS_SEMSTAT_SEMSTAT_SPIS;
+    return true;
+}
+
+void sim_spis_end(const uint8_t * p_mosi, uint8_t * p_miso, uint8_t len)
+{
+    uint8_t * p_tx = (uint8_t *)(uintptr_t)sim_spis.TXDPTR;
+    uint8_t * p_rx = (uint8_t *)(uintptr_t)sim_spis.RXDPTR;
+    uint8_t   cnt;
+    bool      pending;
+
+    sim_spis_sync();
+
+    // MISO is sampled at the end, so CPU writes to TX buffer during transaction are seen by master.
+    for(cnt = 0; cnt < len; cnt++)
+    {
+        p_miso[cnt] = (cnt < sim_spis.MAXTX) ? p_tx[cnt] : (uint8_t)sim_spis.ORC;
+    }
+    sim_spis.AMOUNTTX = (len < sim_spis.MAXTX) ? len : sim_spis.MAXTX;
+    sim_spis.AMOUNTRX = (len < sim_spis.MAXRX) ? len : sim_spis.MAXRX;
+    memcpy(p_rx, p_mosi, sim_spis.AMOUNTRX);
+
+    pending = (sim_spis.SEMSTAT == SPIS_SEMSTAT_SEMSTAT_CPUPending);
+    sim_spis.SEMSTAT = SPIS_SEMSTAT_SEMSTAT_Free;
+
+    sim_spis.EVENTS_END = 1;
+    if( pending ||
+        ((sim_spis.SHORTS & (SPIS_SHORTS_END_ACQUIRE_Enabled << SPIS_SHORTS_END_ACQUIRE_Pos)) != 0) )
+    {
+        sim_spis_acquired();
+    }
+    if((sim_spis_inten & (1UL << SPIS_INTENSET_END_Pos)) != 0)
+    {
+        sim_irq_set_pending(SIM_IRQ_SPI1);
+    }
+}
+
+void sim_spis_ignored(uint8_t * p_miso, uint8_t len)
+{
+    memset(p_miso, (uint8_t)sim_spis.DEF, len);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief GPIO. Firmware driver common/gpio.c is replaced, CSN input is driven by Kinetis model and RDY output is passed to it. */
+
+NRF_GPIO_Type * sim_gpio_regs(void)
+{
+    return &sim_gpio;
+}
+
+void gpio_set_pin_digital_input(uint8_t pin, PIN_PULL pull_mode)
+{
+    sim_gpio.PIN_CNF[pin] = (GPIO_PIN_CNF_DIR_Input << GPIO_PIN_CNF_DIR_Pos) | ((uint32_t)pull_mode << GPIO_PIN_CNF_PULL_Pos);
+    sim_gpio.DIR         &= ~(1UL << pin);
+}
+
+void gpio_set_pin_digital_output(uint8_t pin, PIN_DRIVE drive_mode)
+{
+    sim_gpio.PIN_CNF[pin] = (GPIO_PIN_CNF_DIR_Output << GPIO_PIN_CNF_DIR_Pos) | ((uint32_t)drive_mode << GPIO_PIN_CNF_DRIVE_Pos);
+    sim_gpio.DIR         |= (1UL << pin);
+    gpio_write(pin, (sim_gpio.OUT & (1UL << pin)) != 0);
+}
+
+void gpio_disconnect_pin(uint8_t pin)
+{
+    sim_gpio.PIN_CNF[pin] = (GPIO_PIN_CNF_INPUT_Disconnect << GPIO_PIN_CNF_INPUT_Pos);
+    sim_gpio.DIR         &= ~(1UL << pin);
+}
+
+bool gpio_read(uint8_t pin)
+{
+    if(pin == SIM_SPIS_CSN_PIN)
+    {
+        if(sim_in_firmware_main())
+        {
+            sim_kinetis_on_csn_poll();
+        }
+        return sim_kinetis_csn();
+    }
+    return (sim_gpio.OUT & (1UL << pin)) != 0;
+}
+
+void gpio_write(uint8_t pin, bool value)
+{
+    bool rdy;
+
+    if(value)
+    {
+        sim_gpio.OUT |= (1UL << pin);
+    }
+    else
+    {
+        sim_gpio.OUT &= ~(1UL << pin);
+    }
+
+    if(pin != SIM_SPIS_RDY_PIN)
+    {
+        return;
+    }
+
+    // Pin drives the line only when configured as output.
+    rdy = value && ((sim_gpio.DIR & (1UL << pin)) != 0);
+    if(rdy != sim_spis_rdy)
+    {
+        sim_spis_rdy = rdy;
+        sim_spis_sync();
+        sim_kinetis_on_rdy(rdy);
+    }
+}
+
+void nrf_gpio_range_cfg_output(uint32_t pin_range_start, uint32_t pin_range_end)
+{
+    for(; pin_range_start <= pin_range_end; pin_range_start++)
+    {
+        nrf_gpio_cfg_output(pin_range_start);
+    }
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number)
+{
+    sim_gpio.PIN_CNF[pin_number] = (GPIO_PIN_CNF_DIR_Output << GPIO_PIN_CNF_DIR_Pos);
+    sim_gpio.DIR                |= (1UL << pin_number);
+}
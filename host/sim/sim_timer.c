@@ -0,0 +1,195 @@
+/** @file   sim_timer.c
+ *  @brief  Application timers on simulated 24-bit RTC1, expired timers are
+ *          handled in RTC1 interrupt as the SDK does.
+ */
+
+/* -- Includes -- */
+
+#include <string.h>
+#include "sim.h"
+#include "sim_internal.h"
+#include "sim_timer.h"
+#include "app_timer.h"
+
+#define SIM_TIMER_MAX        8
+#define SIM_RTC_MASK         0x00FFFFFF
+
+typedef struct
+{
+    bool                         created;
+    bool                         running;
+    bool                         expired;
+    app_timer_mode_t             mode;
+    app_timer_timeout_handler_t  handler;
+    void                       * p_context;
+    uint32_t                     ticks;
+    sim_event_t                * p_event;
+}
+sim_timer_t;
+
+static sim_timer_t sim_timers[SIM_TIMER_MAX];
+static uint8_t     sim_timer_count;
+static uint8_t     sim_timer_max;
+static uint32_t    sim_rtc_offset;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint64_t sim_timer_ticks_to_us(uint32_t ticks)
+{
+    return (((uint64_t)ticks * SIM_US_PER_S) + (APP_TIMER_CLOCK_FREQ - 1)) / APP_TIMER_CLOCK_FREQ;
+}
+
+static void sim_timer_expire(void * p_ctx)
+{
+    sim_timer_t * p_timer = p_ctx;
+
+    p_timer->p_event = NULL;
+    p_timer->expired = true;
+
+    if(p_timer->mode == APP_TIMER_MODE_REPEATED)
+    {
+        p_timer->p_event = sim_schedule_in(sim_timer_ticks_to_us(p_timer->ticks), sim_timer_expire, p_timer);
+    }
+    else
+    {
+        p_timer->running = false;
+    }
+    sim_irq_set_pending(SIM_IRQ_RTC1);
+}
+
+void sim_timer_isr(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < sim_timer_count; i++)
+    {
+        sim_timer_t * p_timer = &sim_timers[i];
+
+        if(p_timer->expired)
+        {
+            p_timer->expired = false;
+            p_timer->handler(p_timer->p_context);
+        }
+    }
+}
+
+void sim_timer_on_reset(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < sim_timer_count; i++)
+    {
+        sim_cancel(sim_timers[i].p_event);
+    }
+    memset(sim_timers, 0, sizeof(sim_timers));
+    sim_timer_count = 0;
+}
+
+void sim_timer_set_rtc_offset(uint32_t ticks)
+{
+    sim_rtc_offset = ticks;
+}
+
+uint32_t sim_timer_rtc(void)
+{
+    return (uint32_t)(((sim_now() * APP_TIMER_CLOCK_FREQ) / SIM_US_PER_S) + sim_rtc_offset) & SIM_RTC_MASK;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief SDK application timer API. */
+
+uint32_t app_timer_init(uint32_t prescaler, uint8_t max_timers, uint8_t op_queues_size,
+                        void * p_buffer, app_timer_evt_schedule_func_t evt_schedule_func)
+{
+    (void)op_queues_size;
+    (void)p_buffer;
+
+    if( (prescaler != 0) || (evt_schedule_func != NULL) || (max_timers > SIM_TIMER_MAX) )
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    sim_timer_max = max_timers;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_create(app_timer_id_t * p_timer_id, app_timer_mode_t mode,
+                          app_timer_timeout_handler_t timeout_handler)
+{
+    if( (p_timer_id == NULL) || (timeout_handler == NULL) )
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if(sim_timer_count >= sim_timer_max)
+    {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    sim_timers[sim_timer_count].created = true;
+    sim_timers[sim_timer_count].mode    = mode;
+    sim_timers[sim_timer_count].handler = timeout_handler;
+    *p_timer_id = sim_timer_count++;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void * p_context)
+{
+    sim_timer_t * p_timer;
+
+    if( (timer_id >= sim_timer_count) || (timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) )
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_timer = &sim_timers[timer_id];
+    sim_cancel(p_timer->p_event);
+    p_timer->running   = true;
+    p_timer->expired   = false;
+    p_timer->ticks     = timeout_ticks;
+    p_timer->p_context = p_context;
+    p_timer->p_event   = sim_schedule_in(sim_timer_ticks_to_us(timeout_ticks), sim_timer_expire, p_timer);
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop(app_timer_id_t timer_id)
+{
+    sim_timer_t * p_timer;
+
+    if(timer_id >= sim_timer_count)
+    {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_timer = &sim_timers[timer_id];
+    sim_cancel(p_timer->p_event);
+    p_timer->p_event = NULL;
+    p_timer->running = false;
+    p_timer->expired = false;
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_stop_all(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < sim_timer_count; i++)
+    {
+        (void)app_timer_stop(i);
+    }
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_get(uint32_t * p_ticks)
+{
+    *p_ticks = sim_timer_rtc();
+    return NRF_SUCCESS;
+}
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from, uint32_t * p_ticks_diff)
+{
+    *p_ticks_diff = (ticks_to - ticks_from) & SIM_RTC_MASK;
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,19 @@
+/** @file   sim_timer.h
+ *  @brief  Simulated RTC1 and application timers.
+ */
+
+#ifndef SIM_TIMER_H__
+#define SIM_TIMER_H__
+
+#include <stdint.h>
+
+/**@brief Offset added to RTC1 counter, lets tests start close to the 24-bit wrap.
+ *
+ * @param[in] ticks  Offset in RTC ticks.
+ */
+void sim_timer_set_rtc_offset(uint32_t ticks);
+
+/**@brief Current RTC1 counter, as app_timer_cnt_get() returns it. */
+uint32_t sim_timer_rtc(void);
+
+#endif // SIM_TIMER_H__
@@ -0,0 +1,51 @@
+/** @file   test.h
+ *  @brief  Test cases of the host build. Every case runs in its own process with
+ *          fresh firmware state, on a simulator seeded with SIM_SEED (default 1).
+ *
+ *  @details Case fails if an assertion fails, the firmware hits APP_ERROR_CHECK
+ *           or deadlocks, or it does not finish within TEST_TIMEOUT_S of real time.
+ *           Run "host_build/host_tests [name filter]", SIM_LOG=1 echoes log of the
+ *           firmware.
+ */
+
+#ifndef TEST_H__
+#define TEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim.h"
+
+#define TEST_TIMEOUT_S   120
+
+typedef void (*test_case_t)(void);
+
+void test_register(const char * p_name, test_case_t test_case);
+
+/**@brief Define test case, registered before main() runs. */
+#define TEST(name)                                                              \
+    static void name(void);                                                     \
+    __attribute__((constructor)) static void name##_register(void)              \
+    {                                                                           \
+        test_register(#name, name);                                             \
+    }                                                                           \
+    static void name(void)
+
+#define TEST_ASSERT(cond)                                                       \
+    do                                                                          \
+    {                                                                           \
+        if(!(cond))                                                             \
+        {                                                                       \
+            sim_fail("%s:%d: assertion failed: %s", __FILE__, __LINE__, #cond); \
+        }                                                                       \
+    } while(0)
+
+#define TEST_ASSERT_MSG(cond, ...)                                              \
+    do                                                                          \
+    {                                                                           \
+        if(!(cond))                                                             \
+        {                                                                       \
+            sim_fail(__VA_ARGS__);                                              \
+        }                                                                       \
+    } while(0)
+
+#endif // TEST_H__
@@ -0,0 +1,158 @@
+/** @file   test_adv_ingest.c
+ *  @brief  Sensor values carried in advertising packets are forwarded to the
+ *          host without connecting, once per value, next to connected sensors.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_ADV_INGEST_INTERVAL_MS  100
+#define TEST_ADV_INGEST_LOSS         0.3
+#define TEST_ADV_INGEST_RUN_US       SIM_S(20)
+#define TEST_ADV_INGEST_LATENCY_US   SIM_S(1)             /**< Before sensor generates next value, whatever packets are lost. */
+
+static sim_sensor_t * test_adv_ingest_add(data_id_t type)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+    cfg.adv_data        = true;
+    cfg.adv_interval_ms = TEST_ADV_INGEST_INTERVAL_MS;
+    cfg.adv_loss        = TEST_ADV_INGEST_LOSS;
+    return sim_sensor_add(&cfg);
+}
+
+static void test_adv_ingest_enable(data_id_t data_id, bool enable)
+{
+    const size_t from = sim_kinetis_frame_count();
+
+    sim_fixture_set_adv_ingest(data_id, enable);
+    TEST_ASSERT_MSG(sim_kinetis_wait(DATA_ID_CONFIG, FIELD_ID_CONFIG_ACK, from, SIM_MS(10)) != NULL, "data id 0x%02x", data_id);
+}
+
+/**@brief Check DATA_R frames of sensor since frame index: every value generated meanwhile arrived
+ *        once, in order and soon after it was generated.
+ *
+ * @return Number of values.
+ */
+
+static uint32_t test_adv_ingest_check_stream(const sim_sensor_t * p_sensor, size_t from)
+{
+    const data_id_t             type   = sim_sensor_type(p_sensor);
+    const uint8_t               len    = sensors_get_msg_size(type, FIELD_ID_CHAR_SENSOR_DATA_R);
+    uint32_t                    values = 0;
+    uint32_t                    last   = 0;
+    size_t                      next   = from;
+    const sim_kinetis_frame_t * p_frame;
+
+    while((p_frame = sim_kinetis_find(type, FIELD_ID_CHAR_SENSOR_DATA_R, &next)) != NULL)
+    {
+        const uint32_t seq = sim_sensor_value_seq(p_frame->frame.data, len);
+
+        TEST_ASSERT_MSG((values == 0) || (seq == (last + 1)), "type %u value %u after %u", type, seq, last);
+        TEST_ASSERT_MSG((p_frame->time - sim_sensor_value_time(p_sensor, seq)) < TEST_ADV_INGEST_LATENCY_US, "type %u value %u", type, seq);
+        last = seq;
+        values++;
+        next++;
+    }
+    (void)sim_fixture_check_values(type, from);
+    return values;
+}
+
+TEST(adv_values_forwarded_without_connection)
+{
+    sim_sensor_t * p_htu   = test_adv_ingest_add(DATA_ID_DEV_HTU);
+    sim_sensor_t * p_mic   = test_adv_ingest_add(DATA_ID_DEV_SOUND);
+    sim_sensor_t * p_gyro;
+    size_t         from;
+
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_GYRO);
+
+        p_gyro = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    test_adv_ingest_enable(DATA_ID_DEV_HTU, true);
+    test_adv_ingest_enable(DATA_ID_DEV_SOUND, true);
+    sim_fixture_run();
+
+    // Sensor which does not carry values in advertising packets is connected as before.
+    TEST_ASSERT(sim_fixture_wait_running(p_gyro, SIM_S(30)) != UINT64_MAX);
+
+    from = sim_kinetis_frame_count();
+    sim_run_for(TEST_ADV_INGEST_RUN_US);
+
+    // Values are forwarded once each, though every one is advertised several times and some packets are lost.
+    TEST_ASSERT(test_adv_ingest_check_stream(p_htu, from) >= (TEST_ADV_INGEST_RUN_US / SIM_S(1) - 1));
+    TEST_ASSERT(test_adv_ingest_check_stream(p_mic, from) >= (TEST_ADV_INGEST_RUN_US / SIM_S(1) - 1));
+    TEST_ASSERT(sim_fixture_check_values(DATA_ID_DEV_GYRO, from) >= (TEST_ADV_INGEST_RUN_US / SIM_S(1) - 1));
+    TEST_ASSERT(sim_sensor_stats(p_htu)->connections == 0);
+    TEST_ASSERT(sim_sensor_stats(p_mic)->connections == 0);
+}
+
+TEST(adv_ingest_replaces_connection)
+{
+    sim_sensor_t * p_htu = test_adv_ingest_add(DATA_ID_DEV_HTU);
+    uint32_t       values;
+    size_t         from;
+
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+
+    // Connected sensor is let go, its values keep coming from advertising packets.
+    test_adv_ingest_enable(DATA_ID_DEV_HTU, true);
+    TEST_ASSERT(sim_fixture_wait_connected(p_htu, false, SIM_S(2)));
+    sim_run_for(SIM_S(2));
+    from = sim_kinetis_frame_count();
+    sim_run_for(SIM_S(10));
+    values = test_adv_ingest_check_stream(p_htu, from);
+    printf("  %u values forwarded from %u advertising packets\n", values, sim_sensor_stats(p_htu)->adv_sent);
+    TEST_ASSERT(values >= 9);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->connections == 1);
+
+    // Disabled again, sensor is connected.
+    test_adv_ingest_enable(DATA_ID_DEV_HTU, false);
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->connections == 2);
+}
+
+TEST(adv_ingest_rejects_types_that_do_not_fit)
+{
+    const data_id_t types[] = { DATA_ID_DEV_GYRO, DATA_ID_DEV_LIGHT, DATA_ID_DEV_BRIDGE };
+    uint8_t         index;
+
+    sim_fixture_boot();
+    for(index = 0; index < sizeof(types) / sizeof(types[0]); index++)
+    {
+        const size_t                from = sim_kinetis_frame_count();
+        const sim_kinetis_frame_t * p_error;
+
+        sim_fixture_set_adv_ingest(types[index], true);
+        p_error = sim_kinetis_wait(DATA_ID_RESPONSE_ERROR, RESPONSE_ERROR_VALUE, from, SIM_MS(10));
+        TEST_ASSERT_MSG(p_error != NULL, "type %u", types[index]);
+        TEST_ASSERT(p_error->frame.data[1] == FIELD_ID_ADV_INGEST);
+    }
+}
+
+TEST(adv_ingest_ignores_other_sensor_of_type)
+{
+    sim_sensor_t * p_first  = test_adv_ingest_add(DATA_ID_DEV_HTU);
+    sim_sensor_t * p_second = test_adv_ingest_add(DATA_ID_DEV_HTU);
+    size_t         from;
+
+    sim_sensor_set_power(p_second, false);
+    sim_fixture_boot();
+    test_adv_ingest_enable(DATA_ID_DEV_HTU, true);
+    sim_fixture_run();
+    sim_run_for(SIM_S(3));
+
+    // Sequence numbers and values of the second sensor would interleave with those of the first one.
+    sim_sensor_set_power(p_second, true);
+    from = sim_kinetis_frame_count();
+    sim_run_for(SIM_S(10));
+    TEST_ASSERT(test_adv_ingest_check_stream(p_first, from) >= 9);
+    TEST_ASSERT(sim_sensor_stats(p_second)->adv_sent > 0);
+}
@@ -0,0 +1,168 @@
+/** @file   test_backoff.c
+ *  @brief  Sensor which fails to pair is held back with doubling wait time,
+ *          does not disturb other sensors, and pairs at once after its
+ *          passkey is corrected.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "peer_backoff.h"
+
+#define TEST_BACKOFF_FAILURES     8
+#define TEST_BACKOFF_SLACK_US     SIM_S(2)     /**< Advertising interval, scan window and pairing on top of wait time. */
+#define TEST_BACKOFF_POLL_US      SIM_MS(10)
+
+static sim_sensor_t * test_backoff_misconfigured_add(void)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+    cfg.p_passkey = "654321";
+    return sim_sensor_add(&cfg);
+}
+
+/**@brief Run until sensor is connected again.
+ *
+ * @param[in] p_sensor  Sensor.
+ * @param[in] timeout   Longest time to wait.
+ *
+ * @return    Time of connection, UINT64_MAX on timeout.
+ */
+
+static uint64_t test_backoff_next_connection(const sim_sensor_t * p_sensor, uint64_t timeout)
+{
+    const uint32_t connections = sim_sensor_stats(p_sensor)->connections;
+    const uint64_t end         = sim_now() + timeout;
+
+    while(sim_now() < end)
+    {
+        sim_run_for(TEST_BACKOFF_POLL_US);
+        if(sim_sensor_stats(p_sensor)->connections != connections)
+        {
+            return sim_sensor_stats(p_sensor)->connected_us;
+        }
+    }
+    return UINT64_MAX;
+}
+
+static void test_backoff_wait_disconnected(const sim_sensor_t * p_sensor)
+{
+    while(sim_sensor_connected(p_sensor))
+    {
+        sim_run_for(TEST_BACKOFF_POLL_US);
+    }
+}
+
+static uint8_t test_backoff_status(const sim_sensor_t * p_sensor)
+{
+    adv_inventory_record_t records[ADV_INVENTORY_SIZE];
+    const uint8_t          count = sim_fixture_read_inventory(records);
+    uint8_t                index;
+
+    for(index = 0; index < count; index++)
+    {
+        if(memcmp(records[index].addr, sim_sensor_addr(p_sensor)->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return records[index].status;
+        }
+    }
+    return 0;
+}
+
+TEST(backoff_doubles_wait_of_misconfigured_sensor)
+{
+    sim_sensor_t * p_bad;
+    sim_sensor_t * p_good;
+    stats_block_t  stats;
+    uint64_t       last;
+    uint32_t       values;
+    uint8_t        failure;
+
+    p_bad = test_backoff_misconfigured_add();
+    {
+        sim_sensor_cfg_t good = sim_sensor_default_cfg(DATA_ID_DEV_SOUND);
+
+        p_good = sim_sensor_add(&good);
+    }
+    sim_fixture_boot();
+    sim_fixture_set_passkey(DATA_ID_DEV_HTU, "123456");
+    sim_fixture_read_stats(&stats, true);
+    sim_fixture_run();
+
+    TEST_ASSERT(sim_fixture_wait_running(p_good, SIM_S(30)) != UINT64_MAX);
+    test_backoff_wait_disconnected(p_bad);
+    values = sim_sensor_stats(p_good)->notifications;
+    last   = sim_sensor_stats(p_bad)->connected_us;
+    TEST_ASSERT(sim_sensor_stats(p_bad)->pairings_failed > 0);
+
+    // Every failed pairing doubles the wait time until next connection.
+    for(failure = sim_sensor_stats(p_bad)->pairings_failed; failure <= TEST_BACKOFF_FAILURES; failure++)
+    {
+        const uint64_t wait = SIM_S((uint64_t)PEER_BACKOFF_BASE_S << (failure - 1));
+        const uint64_t next = test_backoff_next_connection(p_bad, wait + TEST_BACKOFF_SLACK_US);
+
+        TEST_ASSERT_MSG(next != UINT64_MAX, "failure %u", failure);
+        printf("  failure %u, connected again after %llu ms\n", failure, (unsigned long long)((next - last) / SIM_US_PER_MS));
+        TEST_ASSERT_MSG((next - last) >= wait, "failure %u after %llu ms", failure, (unsigned long long)((next - last) / SIM_US_PER_MS));
+        last = next;
+
+        if(failure == 5)
+        {
+            // Held back sensor is marked in inventory.
+            sim_run_for(SIM_S(1));
+            TEST_ASSERT(test_backoff_status(p_bad) & ADV_INVENTORY_STATUS_BACKOFF);
+        }
+    }
+    test_backoff_wait_disconnected(p_bad);
+    TEST_ASSERT(sim_sensor_stats(p_bad)->pairings_failed == TEST_BACKOFF_FAILURES + 1);
+    TEST_ASSERT(sim_sensor_stats(p_bad)->pairings == 0);
+    TEST_ASSERT(sim_fixture_instance(p_bad) == DATA_ID_ERROR);
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.peer_failures == TEST_BACKOFF_FAILURES + 1);
+
+    // Other sensor kept running meanwhile.
+    TEST_ASSERT(sim_sensor_connected(p_good));
+    TEST_ASSERT(sim_sensor_stats(p_good)->connections == 1);
+    TEST_ASSERT(sim_sensor_stats(p_good)->notifications > values);
+}
+
+TEST(backoff_ends_when_passkey_is_corrected)
+{
+    sim_sensor_t * p_bad;
+    uint64_t       start;
+    uint8_t        failure;
+
+    p_bad = test_backoff_misconfigured_add();
+    sim_fixture_boot();
+    sim_fixture_set_passkey(DATA_ID_DEV_HTU, "123456");
+    sim_fixture_run();
+
+    for(failure = 0; failure < 5; failure++)
+    {
+        TEST_ASSERT(test_backoff_next_connection(p_bad, SIM_S(60)) != UINT64_MAX);
+    }
+    sim_run_for(SIM_S(1));
+    TEST_ASSERT(test_backoff_status(p_bad) & ADV_INVENTORY_STATUS_BACKOFF);
+
+    // New passkey clears the wait of more than a minute.
+    start = sim_now();
+    sim_fixture_set_passkey(DATA_ID_DEV_HTU, "654321");
+    TEST_ASSERT(sim_fixture_wait_running(p_bad, SIM_S(30)) != UINT64_MAX);
+    printf("  secured %llu ms after passkey update\n", (unsigned long long)((sim_sensor_stats(p_bad)->secured_us - start) / SIM_US_PER_MS));
+    TEST_ASSERT((sim_sensor_stats(p_bad)->secured_us - start) < TEST_BACKOFF_SLACK_US);
+    TEST_ASSERT(sim_fixture_instance(p_bad) == DATA_ID_DEV_HTU);
+    TEST_ASSERT((test_backoff_status(p_bad) & ADV_INVENTORY_STATUS_BACKOFF) == 0);
+
+    // Secured link cleared failure record, sensor out of range is connected again without wait.
+    sim_sensor_set_power(p_bad, false);
+    sim_run_for(SIM_S(10));
+    start = sim_now();
+    sim_sensor_set_power(p_bad, true);
+    TEST_ASSERT(sim_fixture_wait_running(p_bad, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT((sim_sensor_stats(p_bad)->secured_us - start) < TEST_BACKOFF_SLACK_US);
+    TEST_ASSERT(sim_sensor_stats(p_bad)->pairings == 1);
+    TEST_ASSERT(sim_sensor_stats(p_bad)->encryptions == 1);
+}
@@ -0,0 +1,60 @@
+/** @file   test_bringup.c
+ *  @brief  Boot and SPI link with the host before mode is selected.
+ */
+
+/* -- Includes -- */
+
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "spi_slave_config.h"
+
+TEST(boot_reports_firmware_revision)
+{
+    const sim_kinetis_frame_t * p_frame;
+
+    sim_boot();
+    p_frame = sim_kinetis_wait(DATA_ID_DEV_CENTRAL, FIELD_ID_CHAR_FIRMWARE_REVISION, 0, SIM_MS(10));
+    TEST_ASSERT(p_frame != NULL);
+    TEST_ASSERT(p_frame->frame.data[SPI_PACKET_DATA_SIZE - 1] == SPI_LINK_CAPABILITY);
+
+    // Nothing but SPI is served until mode is selected.
+    sim_run_for(SIM_S(5));
+    TEST_ASSERT(sim_softdevice_scanning() == false);
+    TEST_ASSERT(sim_softdevice_stats()->connect_requests == 0);
+}
+
+TEST(link_layer_is_enabled_by_host)
+{
+    const sim_kinetis_frame_t * p_ack;
+    size_t                      from;
+
+    sim_fixture_boot();
+    from = sim_kinetis_frame_count();
+    sim_kinetis_link_enable();
+
+    p_ack = sim_kinetis_wait(DATA_ID_CONFIG, FIELD_ID_CONFIG_ACK, from, SIM_MS(10));
+    TEST_ASSERT(p_ack != NULL);
+    TEST_ASSERT(sim_kinetis_link_enabled());
+
+    // Acknowledge is sent in new format, frames of both sides pass CRC check.
+    sim_run_for(SIM_MS(10));
+    TEST_ASSERT(sim_kinetis_stats()->crc_errors == 0);
+    TEST_ASSERT(spi_get_link_counters()->crc_errors == 0);
+    TEST_ASSERT(sim_kinetis_pending() == 0);
+}
+
+TEST(unknown_config_field_is_rejected)
+{
+    const sim_kinetis_frame_t * p_error;
+    size_t                      from;
+
+    sim_fixture_boot();
+    from = sim_kinetis_frame_count();
+    (void)sim_kinetis_send_config(0x3F, NULL, 0);
+
+    p_error = sim_kinetis_wait(DATA_ID_RESPONSE_ERROR, RESPONSE_ERROR_FIELD_ID, from, SIM_MS(10));
+    TEST_ASSERT(p_error != NULL);
+    TEST_ASSERT(p_error->frame.data[0] == DATA_ID_CONFIG);
+    TEST_ASSERT(p_error->frame.data[1] == 0x3F);
+}
@@ -0,0 +1,140 @@
+/** @file   test_connect.c
+ *  @brief  Connection manager picks the strongest advertiser of a sensor, and
+ *          failed or timed out connection requests neither stop scanning nor
+ *          keep other sensors waiting.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "conn_manager.h"
+#include "app_timer.h"
+
+#define TEST_CONNECT_RSSI_GAP     10       /**< Foreign advertisers between the two sensors, each weakens RSSI by 3 dB. */
+
+static sim_sensor_t * test_connect_noise_add(void)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+    cfg.mode   = SIM_SENSOR_NOISE;
+    cfg.p_name = "Foreign";
+    return sim_sensor_add(&cfg);
+}
+
+static bool test_connect_any(void * p_ctx)
+{
+    sim_sensor_t * const * p_sensors = p_ctx;
+
+    return sim_sensor_connected(p_sensors[0]) || sim_sensor_connected(p_sensors[1]);
+}
+
+static bool test_connect_requested(void * p_ctx)
+{
+    (void)p_ctx;
+    return sim_softdevice_connecting();
+}
+
+TEST(connect_prefers_strongest_advertiser)
+{
+    sim_sensor_t * p_sensors[2];
+    uint8_t        index;
+
+    {
+        sim_sensor_cfg_t strong = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+        sim_sensor_cfg_t weak   = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        // Strong sensor advertises often enough to be heard within collection time.
+        strong.adv_interval_ms = 50;
+        p_sensors[0] = sim_sensor_add(&strong);
+        for(index = 0; index < TEST_CONNECT_RSSI_GAP; index++)
+        {
+            (void)test_connect_noise_add();
+        }
+        p_sensors[1] = sim_sensor_add(&weak);
+    }
+    sim_sensor_set_power(p_sensors[0], false);
+    sim_fixture_boot();
+    sim_fixture_run();
+
+    // Weak sensor is heard first.
+    while(sim_sensor_stats(p_sensors[1])->adv_sent == 0)
+    {
+        sim_run_for(SIM_MS(1));
+    }
+    sim_sensor_set_power(p_sensors[0], true);
+
+    TEST_ASSERT(sim_run_until_cond(test_connect_any, p_sensors, SIM_S(10)));
+    TEST_ASSERT(sim_sensor_connected(p_sensors[0]));
+    TEST_ASSERT(sim_sensor_connected(p_sensors[1]) == false);
+    TEST_ASSERT(sim_fixture_wait_running(p_sensors[0], SIM_S(10)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_instance(p_sensors[0]) == DATA_ID_DEV_HTU);
+}
+
+TEST(connect_timeouts_resume_scanning_under_loss)
+{
+    const sim_softdevice_stats_t * p_sd = sim_softdevice_stats();
+    sim_sensor_t                 * p_lossy;
+    sim_sensor_t                 * p_clean;
+    stats_block_t                  stats;
+
+    {
+        sim_sensor_cfg_t lossy = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+        sim_sensor_cfg_t clean = sim_sensor_default_cfg(DATA_ID_DEV_SOUND);
+
+        lossy.adv_loss = 0.9;
+        p_lossy = sim_sensor_add(&lossy);
+        p_clean = sim_sensor_add(&clean);
+    }
+    sim_fixture_boot();
+    sim_fixture_read_stats(&stats, true);
+    sim_fixture_run();
+
+    TEST_ASSERT(sim_fixture_wait_running(p_clean, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_wait_running(p_lossy, SIM_S(300)) != UINT64_MAX);
+    sim_fixture_read_stats(&stats, true);
+    printf("  %u connection requests, %u timed out, longest time to connect %u ms\n",
+           p_sd->connect_requests, p_sd->connect_timeouts,
+           (unsigned)((uint64_t)stats.connect.max_ticks * 1000 / APP_TIMER_CLOCK_FREQ));
+
+    // Every request either connected or timed out and was counted, and scanning went on after it.
+    TEST_ASSERT(p_sd->connect_requests == (p_sd->connections + p_sd->connect_timeouts));
+    TEST_ASSERT(stats.connect.count == p_sd->connections);
+    TEST_ASSERT(stats.connect_failures == p_sd->connect_timeouts);
+    TEST_ASSERT(sim_softdevice_scanning());
+}
+
+TEST(connect_retries_of_vanished_sensor_are_bounded)
+{
+    const sim_softdevice_stats_t * p_sd = sim_softdevice_stats();
+    sim_sensor_t                 * p_gone;
+    sim_sensor_t                 * p_late;
+    uint32_t                       requests;
+
+    {
+        sim_sensor_cfg_t gone = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+        sim_sensor_cfg_t late = sim_sensor_default_cfg(DATA_ID_DEV_SOUND);
+
+        p_gone = sim_sensor_add(&gone);
+        p_late = sim_sensor_add(&late);
+    }
+    sim_sensor_set_power(p_late, false);
+    sim_fixture_boot();
+    sim_fixture_run();
+
+    // Sensor goes out of range as it is connected.
+    TEST_ASSERT(sim_run_until_cond(test_connect_requested, NULL, SIM_S(10)));
+    sim_sensor_set_power(p_gone, false);
+    sim_run_for(SIM_S(20));
+    requests = p_sd->connect_requests;
+    TEST_ASSERT_MSG(requests <= CONN_MANAGER_RETRIES, "%u requests", requests);
+    TEST_ASSERT(p_sd->connections == 0);
+    TEST_ASSERT(sim_softdevice_scanning());
+
+    // Other sensor is connected meanwhile.
+    sim_sensor_set_power(p_late, true);
+    TEST_ASSERT(sim_fixture_wait_running(p_late, SIM_S(10)) != UINT64_MAX);
+    TEST_ASSERT(p_sd->connect_requests == (requests + 1));
+}
@@ -0,0 +1,67 @@
+/** @file   test_discovery.c
+ *  @brief  GATT discovery of several sensors connected at the same time.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_DISCOVERY_PEERS   3
+
+static const data_id_t test_discovery_types[TEST_DISCOVERY_PEERS] = { DATA_ID_DEV_GYRO, DATA_ID_DEV_LIGHT, DATA_ID_DEV_BRIDGE };
+
+static void test_discovery_run(double link_loss)
+{
+    sim_sensor_t * p_sensors[TEST_DISCOVERY_PEERS];
+    uint64_t       first_max = 0;
+    uint64_t       last_min  = UINT64_MAX;
+    uint8_t        index;
+
+    for(index = 0; index < TEST_DISCOVERY_PEERS; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(test_discovery_types[index]);
+
+        cfg.link_loss    = link_loss;
+        p_sensors[index] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(120)));
+    sim_run_for(SIM_S(10));
+
+    for(index = 0; index < TEST_DISCOVERY_PEERS; index++)
+    {
+        const sim_sensor_stats_t * p_stats = sim_sensor_stats(p_sensors[index]);
+
+        TEST_ASSERT(p_stats->connections == 1);
+        printf("  type %u: discovery %.2f..%.2f s, %u requests, %u if searched per UUID\n", test_discovery_types[index],
+               (double)p_stats->discovery_first_us / SIM_US_PER_S, (double)p_stats->discovery_last_us / SIM_US_PER_S,
+               p_stats->att_discovery, sim_sensor_discovery_requests_per_uuid(p_sensors[index]));
+        TEST_ASSERT(p_stats->att_discovery < sim_sensor_discovery_requests_per_uuid(p_sensors[index]));
+        if(p_stats->discovery_first_us > first_max)
+        {
+            first_max = p_stats->discovery_first_us;
+        }
+        if(p_stats->discovery_last_us < last_min)
+        {
+            last_min = p_stats->discovery_last_us;
+        }
+        TEST_ASSERT(sim_fixture_check_values(test_discovery_types[index], 0) >= 5);
+    }
+
+    // Responses of all three peers were interleaved: every discovery started before any ended.
+    TEST_ASSERT_MSG(first_max < last_min, "discoveries did not overlap");
+}
+
+TEST(three_peers_discover_in_parallel)
+{
+    test_discovery_run(0);
+}
+
+TEST(three_peers_discover_in_parallel_with_lost_events)
+{
+    // Lost connection events shift responses of each peer, so their order varies.
+    test_discovery_run(0.2);
+}
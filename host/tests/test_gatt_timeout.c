@@ -0,0 +1,176 @@
+/** @file   test_gatt_timeout.c
+ *  @brief  Sensor which stops answering GATT requests is disconnected when the
+ *          operation misses its deadline, long before the 30 s protocol
+ *          timeout, the host learns the result of its pending write, and the
+ *          sensor is served again once it answers.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "client_handling.h"
+
+#define TEST_GATT_TIMEOUT_LATE_US   SIM_MS(CLIENT_TIMEOUT_CHECK_MS + (2 * CONNECTION_INTERVAL_MS))  /**< Check period and disconnection. */
+
+/**@brief Count GATT timeouts of sensor over all client slots. */
+
+static uint16_t test_gatt_timeout_count(const stats_block_t * p_stats, data_id_t data_id)
+{
+    uint16_t count = 0;
+    uint8_t  client;
+
+    for(client = 0; client < MAX_CLIENTS; client++)
+    {
+        if(p_stats->gatt_timeout_ids[client] == data_id)
+        {
+            count += p_stats->gatt_timeouts[client];
+        }
+    }
+    return count;
+}
+
+static bool test_gatt_timeout_disconnected(void * p_ctx)
+{
+    return sim_sensor_connected(p_ctx) == false;
+}
+
+static bool test_gatt_timeout_discovering(void * p_ctx)
+{
+    return sim_sensor_stats(p_ctx)->att_discovery > 0;
+}
+
+/**@brief Run until sensor is disconnected after its response was dropped.
+ *
+ * @return Time from dropped response to disconnection.
+ */
+
+static uint64_t test_gatt_timeout_recovery(sim_sensor_t * p_sensor, uint32_t dropped, uint64_t deadline)
+{
+    uint64_t drop_us;
+
+    while(sim_sensor_stats(p_sensor)->att_rsp_dropped == dropped)
+    {
+        sim_run_for(SIM_MS(1));
+    }
+    drop_us = sim_now();
+    TEST_ASSERT(sim_run_until_cond(test_gatt_timeout_disconnected, p_sensor, deadline + TEST_GATT_TIMEOUT_LATE_US));
+    return sim_now() - drop_us;
+}
+
+TEST(gatt_timeout_disconnects_sensor_stuck_in_read)
+{
+    const sim_softdevice_stats_t * p_sd = sim_softdevice_stats();
+    const sim_kinetis_frame_t    * p_frame;
+    sim_sensor_t                 * p_gyro;
+    stats_block_t                  stats;
+    uint64_t                       recovery;
+    size_t                         from;
+
+    {
+        sim_sensor_cfg_t gyro = sim_sensor_default_cfg(DATA_ID_DEV_GYRO);
+
+        p_gyro = sim_sensor_add(&gyro);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_gyro, SIM_S(30)) != UINT64_MAX);
+    sim_fixture_read_stats(&stats, true);
+
+    // Sensor stops answering, read from host stays pending.
+    sim_sensor_set_rsp_drop(p_gyro, 1.0);
+    from = sim_kinetis_frame_count();
+    TEST_ASSERT(sim_kinetis_send(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, OPERATION_V1(OPERATION_READ, 0), NULL, 0));
+    recovery = test_gatt_timeout_recovery(p_gyro, 0, SIM_MS(CLIENT_TIMEOUT_WAIT_READ_RSP_MS));
+    printf("  read: disconnected %llu ms after dropped response\n", (unsigned long long)(recovery / SIM_US_PER_MS));
+    TEST_ASSERT(sim_kinetis_find(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, &from) == NULL);
+
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(test_gatt_timeout_count(&stats, DATA_ID_DEV_GYRO) == 1);
+
+    // Sensor answers again and is served without waiting for protocol timeout.
+    sim_sensor_set_rsp_drop(p_gyro, 0.0);
+    TEST_ASSERT(sim_fixture_wait_running(p_gyro, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(p_sd->gattc_timeouts == 0);
+
+    from    = sim_kinetis_frame_count();
+    TEST_ASSERT(sim_kinetis_send(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, OPERATION_V1(OPERATION_READ, 0), NULL, 0));
+    p_frame = sim_kinetis_wait(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, from, SIM_S(5));
+    TEST_ASSERT(p_frame != NULL);
+}
+
+TEST(gatt_timeout_fails_pending_write)
+{
+    const sim_kinetis_frame_t * p_frame;
+    sim_sensor_t              * p_gyro;
+    stats_block_t               stats;
+    const uint8_t               led = 1;
+    uint64_t                    recovery;
+    size_t                      from;
+
+    {
+        sim_sensor_cfg_t gyro = sim_sensor_default_cfg(DATA_ID_DEV_GYRO);
+
+        p_gyro = sim_sensor_add(&gyro);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_gyro, SIM_S(30)) != UINT64_MAX);
+    sim_fixture_read_stats(&stats, true);
+
+    sim_sensor_set_rsp_drop(p_gyro, 1.0);
+    from = sim_kinetis_frame_count();
+    TEST_ASSERT(sim_kinetis_send(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_LED_STATE, OPERATION_V1(OPERATION_WRITE, 1), &led, 1));
+    recovery = test_gatt_timeout_recovery(p_gyro, 0, SIM_MS(CLIENT_TIMEOUT_WAIT_WRITE_RSP_MS));
+    printf("  write: disconnected %llu ms after dropped response\n", (unsigned long long)(recovery / SIM_US_PER_MS));
+
+    // Host is told write failed.
+    p_frame = sim_kinetis_wait(DATA_ID_DEV_GYRO, FIELD_ID_SENSOR_WRITE_OK, from, SIM_S(1));
+    TEST_ASSERT(p_frame != NULL);
+    TEST_ASSERT(p_frame->frame.data[0] == 0);
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(test_gatt_timeout_count(&stats, DATA_ID_DEV_GYRO) == 1);
+}
+
+TEST(gatt_timeout_bounds_service_discovery)
+{
+    sim_sensor_t * p_htu;
+    sim_sensor_t * p_mic;
+    stats_block_t  stats;
+    uint64_t       recovery;
+    uint32_t       values;
+
+    {
+        sim_sensor_cfg_t htu = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+        sim_sensor_cfg_t mic = sim_sensor_default_cfg(DATA_ID_DEV_SOUND);
+
+        p_mic = sim_sensor_add(&mic);
+        p_htu = sim_sensor_add(&htu);
+    }
+    sim_sensor_set_power(p_htu, false);
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_mic, SIM_S(30)) != UINT64_MAX);
+    sim_fixture_read_stats(&stats, true);
+
+    // Sensor stops answering while it is discovered.
+    sim_sensor_set_power(p_htu, true);
+    TEST_ASSERT(sim_run_until_cond(test_gatt_timeout_discovering, p_htu, SIM_S(10)));
+    sim_sensor_set_rsp_drop(p_htu, 1.0);
+    values   = sim_sensor_stats(p_mic)->notifications;
+    recovery = test_gatt_timeout_recovery(p_htu, 0, SIM_MS(CLIENT_TIMEOUT_SERVICE_DISC_MS));
+    printf("  discovery: disconnected %llu ms after dropped response\n", (unsigned long long)(recovery / SIM_US_PER_MS));
+    TEST_ASSERT(recovery < SIM_S(30));
+
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(test_gatt_timeout_count(&stats, DATA_ID_DEV_HTU) == 1);
+    TEST_ASSERT(test_gatt_timeout_count(&stats, DATA_ID_DEV_SOUND) == 0);
+
+    // Other sensor was served meanwhile, stuck one is served once it answers.
+    TEST_ASSERT(sim_sensor_stats(p_mic)->notifications > values);
+    sim_sensor_set_rsp_drop(p_htu, 0.0);
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_softdevice_stats()->gattc_timeouts == 0);
+}
@@ -0,0 +1,177 @@
+/** @file   test_instances.c
+ *  @brief  Several sensors of one type, each onboarded with passkey of its own
+ *          instance, are routed by instance data ID and keep the instance over
+ *          reconnection and reboot.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_INSTANCES_NUM    3
+
+static const char * const test_instances_passkeys[TEST_INSTANCES_NUM] = { "111111", "222222", "333333" };
+
+/**@brief Write LED of instance and check that the write reached only the sensor reported under it. */
+
+static void test_instances_write_led(sim_sensor_t * const * p_sensors, data_id_t data_id)
+{
+    uint32_t      writes[TEST_INSTANCES_NUM];
+    const uint8_t led  = 1;
+    const size_t  from = sim_kinetis_frame_count();
+    uint8_t       index;
+
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        writes[index] = sim_sensor_stats(p_sensors[index])->att_writes;
+    }
+    TEST_ASSERT(sim_kinetis_send(data_id, FIELD_ID_CHAR_SENSOR_LED_STATE, OPERATION_V1(OPERATION_WRITE, 1), &led, 1));
+    TEST_ASSERT_MSG(sim_kinetis_wait(data_id, FIELD_ID_SENSOR_WRITE_OK, from, SIM_S(1)) != NULL, "data id 0x%02x", data_id);
+
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        const uint32_t expected = writes[index] + ((sim_fixture_instance(p_sensors[index]) == data_id) ? 1 : 0);
+
+        TEST_ASSERT_MSG(sim_sensor_stats(p_sensors[index])->att_writes == expected, "data id 0x%02x sensor %u", data_id, index);
+    }
+}
+
+TEST(same_type_sensors_routed_by_instance)
+{
+    sim_sensor_t * p_sensors[TEST_INSTANCES_NUM];
+    data_id_t      instances[TEST_INSTANCES_NUM];
+    uint64_t       start;
+    size_t         from;
+    uint8_t        index;
+
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        cfg.p_passkey    = test_instances_passkeys[index];
+        p_sensors[index] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        sim_fixture_set_passkey(DATA_ID_INSTANCE(DATA_ID_DEV_HTU, index), test_instances_passkeys[index]);
+    }
+    start = sim_now();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(120)));
+    printf("  %u sensors of one type running after %llu ms\n", TEST_INSTANCES_NUM,
+           (unsigned long long)((sim_now() - start) / SIM_US_PER_MS));
+
+    // Sensor gets the instance its passkey belongs to, whatever order it is found in.
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        instances[index] = sim_fixture_instance(p_sensors[index]);
+        TEST_ASSERT_MSG(instances[index] == DATA_ID_INSTANCE(DATA_ID_DEV_HTU, index), "sensor %u as 0x%02x", index, instances[index]);
+    }
+
+    // Values and commands are carried under instance data ID.
+    from = sim_kinetis_frame_count();
+    sim_run_for(SIM_S(5));
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        TEST_ASSERT_MSG(sim_fixture_check_values(instances[index], from) >= 3, "data id 0x%02x", instances[index]);
+        test_instances_write_led(p_sensors, instances[index]);
+    }
+
+    // Slot is kept by bonded address, sensors return under the same instance in any order.
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        sim_sensor_set_power(p_sensors[index], false);
+    }
+    sim_run_for(SIM_S(10));
+    for(index = TEST_INSTANCES_NUM; index > 0; index--)
+    {
+        sim_sensor_set_power(p_sensors[index - 1], true);
+        sim_run_for(SIM_S(1));
+    }
+    for(index = 0; index < TEST_INSTANCES_NUM; index++)
+    {
+        TEST_ASSERT(sim_fixture_wait_running(p_sensors[index], SIM_S(60)) != UINT64_MAX);
+        TEST_ASSERT_MSG(sim_fixture_instance(p_sensors[index]) == instances[index], "sensor %u", index);
+        TEST_ASSERT(sim_sensor_stats(p_sensors[index])->pairings == 1);
+    }
+}
+
+TEST(instances_bound_survive_reboot)
+{
+    static const data_id_t types[] = { DATA_ID_DEV_HTU, DATA_ID_DEV_GYRO, DATA_ID_DEV_LIGHT };
+    const uint8_t          count   = sizeof(types) * SENSOR_INSTANCES_MAX;
+    sim_sensor_t         * p_sensors[sizeof(types) * SENSOR_INSTANCES_MAX];
+    char                   passkeys[sizeof(types) * SENSOR_INSTANCES_MAX][8];
+    uint32_t               failed[sizeof(types) * SENSOR_INSTANCES_MAX];
+    size_t                 from;
+    uint8_t                index;
+    uint8_t                cnt;
+    uint8_t                pass;
+
+    // More instances than there are bits in a byte, sensors of one type at a time.
+    for(index = 0; index < count; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(types[index / SENSOR_INSTANCES_MAX]);
+
+        snprintf(passkeys[index], sizeof(passkeys[index]), "%06u", 100000u + index);
+        cfg.p_passkey    = passkeys[index];
+        p_sensors[index] = sim_sensor_add(&cfg);
+        sim_sensor_set_power(p_sensors[index], false);
+    }
+    sim_fixture_boot();
+    for(index = 0; index < count; index++)
+    {
+        sim_fixture_set_passkey(DATA_ID_INSTANCE(types[index / SENSOR_INSTANCES_MAX], index % SENSOR_INSTANCES_MAX), passkeys[index]);
+    }
+
+    // Host stores passkeys with onboarding.
+    from = sim_kinetis_frame_count();
+    TEST_ASSERT(sim_kinetis_send_config(FIELD_ID_CONFIG_STORE_PASSKEYS, NULL, 0));
+    sim_fixture_config();
+    TEST_ASSERT(sim_kinetis_wait(DATA_ID_CONFIG, FIELD_ID_CONFIG_COMPLETE, from, SIM_S(10)) != NULL);
+
+    for(pass = 0; pass < 2; pass++)
+    {
+        sim_fixture_run();
+        for(index = 0; index < count; index += SENSOR_INSTANCES_MAX)
+        {
+            for(cnt = index; cnt < (index + SENSOR_INSTANCES_MAX); cnt++)
+            {
+                sim_sensor_set_power(p_sensors[cnt], true);
+            }
+            for(cnt = index; cnt < (index + SENSOR_INSTANCES_MAX); cnt++)
+            {
+                const data_id_t expected = DATA_ID_INSTANCE(types[cnt / SENSOR_INSTANCES_MAX], cnt % SENSOR_INSTANCES_MAX);
+
+                TEST_ASSERT_MSG(sim_fixture_wait_running(p_sensors[cnt], SIM_S(120)) != UINT64_MAX, "pass %u sensor %u", pass, cnt);
+                TEST_ASSERT_MSG(sim_fixture_instance(p_sensors[cnt]) == expected, "pass %u sensor %u as 0x%02x",
+                                pass, cnt, sim_fixture_instance(p_sensors[cnt]));
+            }
+            for(cnt = index; cnt < (index + SENSOR_INSTANCES_MAX); cnt++)
+            {
+                sim_sensor_set_power(p_sensors[cnt], false);
+            }
+        }
+
+        // Bindings are stored, then the firmware is power cycled.
+        sim_run_for(SIM_S(10));
+        if(pass == 0)
+        {
+            for(index = 0; index < count; index++)
+            {
+                failed[index] = sim_sensor_stats(p_sensors[index])->pairings_failed;
+            }
+            sim_fixture_reboot();
+        }
+    }
+
+    // Bound sensor got its instance right away, it was not tried with passkeys of other instances.
+    for(index = 0; index < count; index++)
+    {
+        TEST_ASSERT_MSG(sim_sensor_stats(p_sensors[index])->pairings_failed == failed[index], "sensor %u failed %u pairings after reboot",
+                        index, sim_sensor_stats(p_sensors[index])->pairings_failed - failed[index]);
+    }
+}
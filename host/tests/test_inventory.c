@@ -0,0 +1,134 @@
+/** @file   test_inventory.c
+ *  @brief  Inventory dump tells the host which advertisers are in range, how
+ *          strong and how recently seen they are, and why they are not served.
+ */
+
+/* -- Includes -- */
+
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_INVENTORY_NOISE    20
+#define TEST_INVENTORY_RSSI     (-48)      /**< RSSI of first sensor, each next one is 3 dB weaker and up to 4 dB jitter. */
+
+static const adv_inventory_record_t * test_inventory_find(const adv_inventory_record_t * p_records, uint8_t count,
+                                                          const sim_sensor_t * p_sensor)
+{
+    uint8_t index;
+
+    for(index = 0; index < count; index++)
+    {
+        if(memcmp(p_records[index].addr, sim_sensor_addr(p_sensor)->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return &p_records[index];
+        }
+    }
+    return NULL;
+}
+
+static sim_sensor_t * test_inventory_noise_add(void)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+    cfg.mode   = SIM_SENSOR_NOISE;
+    cfg.p_name = "Foreign";
+    return sim_sensor_add(&cfg);
+}
+
+TEST(inventory_reports_why_advertisers_are_not_served)
+{
+    adv_inventory_record_t         records[ADV_INVENTORY_SIZE];
+    const adv_inventory_record_t * p_record;
+    sim_sensor_t                 * p_sensors[4];
+    uint8_t                        count;
+    uint8_t                        index;
+
+    {
+        sim_sensor_cfg_t htu   = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+        sim_sensor_cfg_t mic   = sim_sensor_default_cfg(DATA_ID_DEV_SOUND);
+        sim_sensor_cfg_t light = sim_sensor_default_cfg(DATA_ID_DEV_LIGHT);
+
+        mic.adv_data = true;
+        p_sensors[0] = sim_sensor_add(&htu);
+        p_sensors[1] = sim_sensor_add(&mic);
+        p_sensors[2] = sim_sensor_add(&light);
+        p_sensors[3] = test_inventory_noise_add();
+    }
+    sim_fixture_boot();
+    sim_fixture_set_adv_ingest(DATA_ID_DEV_SOUND, true);
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_sensors[0], SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_wait_running(p_sensors[2], SIM_S(30)) != UINT64_MAX);
+
+    // LIGHT goes out of range.
+    sim_sensor_set_power(p_sensors[2], false);
+    sim_run_for(SIM_S(10));
+
+    count = sim_fixture_read_inventory(records);
+    TEST_ASSERT(count == 4);
+    for(index = 0; index < 4; index++)
+    {
+        const int8_t rssi = TEST_INVENTORY_RSSI - (3 * index);
+
+        p_record = test_inventory_find(records, count, p_sensors[index]);
+        TEST_ASSERT_MSG(p_record != NULL, "sensor %u", index);
+        TEST_ASSERT_MSG((p_record->rssi_max <= rssi) && (p_record->rssi_min >= (rssi - 4)), "sensor %u", index);
+        TEST_ASSERT_MSG((p_record->rssi_min <= p_record->rssi_avg) && (p_record->rssi_avg <= p_record->rssi_max), "sensor %u", index);
+        TEST_ASSERT_MSG(p_record->count > 0, "sensor %u", index);
+    }
+
+    p_record = test_inventory_find(records, count, p_sensors[0]);
+    TEST_ASSERT(p_record->data_id == DATA_ID_DEV_HTU);
+    TEST_ASSERT(p_record->status == ADV_INVENTORY_STATUS_CONNECTED);
+
+    // Ingested sensor advertises all the time.
+    p_record = test_inventory_find(records, count, p_sensors[1]);
+    TEST_ASSERT(p_record->data_id == DATA_ID_DEV_SOUND);
+    TEST_ASSERT(p_record->status == ADV_INVENTORY_STATUS_INGEST);
+    TEST_ASSERT(p_record->age_s == 0);
+    TEST_ASSERT(p_record->count >= (sim_sensor_stats(p_sensors[1])->adv_sent / 2));
+
+    // Sensor out of range is neither connected nor seen recently.
+    p_record = test_inventory_find(records, count, p_sensors[2]);
+    TEST_ASSERT(p_record->data_id == DATA_ID_DEV_LIGHT);
+    TEST_ASSERT(p_record->status == 0);
+    TEST_ASSERT(p_record->age_s >= 10);
+
+    p_record = test_inventory_find(records, count, p_sensors[3]);
+    TEST_ASSERT(p_record->data_id == DATA_ID_ERROR);
+    TEST_ASSERT(p_record->status == ADV_INVENTORY_STATUS_IGNORED);
+}
+
+TEST(inventory_keeps_recently_seen_advertisers)
+{
+    adv_inventory_record_t records[ADV_INVENTORY_SIZE];
+    sim_sensor_t         * p_sensors[TEST_INVENTORY_NOISE];
+    uint8_t                count;
+    uint8_t                index;
+
+    for(index = 0; index < TEST_INVENTORY_NOISE; index++)
+    {
+        p_sensors[index] = test_inventory_noise_add();
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    sim_run_for(SIM_S(5));
+
+    // Table is full, advertisers which went silent are replaced first.
+    for(index = 0; index < (TEST_INVENTORY_NOISE - ADV_INVENTORY_SIZE); index++)
+    {
+        sim_sensor_set_power(p_sensors[index], false);
+    }
+    sim_run_for(SIM_S(5));
+
+    count = sim_fixture_read_inventory(records);
+    TEST_ASSERT(count == ADV_INVENTORY_SIZE);
+    for(index = 0; index < TEST_INVENTORY_NOISE; index++)
+    {
+        const adv_inventory_record_t * p_record = test_inventory_find(records, count, p_sensors[index]);
+
+        TEST_ASSERT_MSG((p_record != NULL) == (index >= (TEST_INVENTORY_NOISE - ADV_INVENTORY_SIZE)), "sensor %u", index);
+        TEST_ASSERT_MSG((p_record == NULL) || (p_record->age_s <= 1), "sensor %u", index);
+    }
+}
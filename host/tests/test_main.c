@@ -0,0 +1,111 @@
+/** @file   test_main.c
+ *  @brief  Runner of host test cases, see test.h.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "test.h"
+
+#define TEST_CASES_MAX   128
+
+typedef struct
+{
+    const char  * p_name;
+    test_case_t   test_case;
+}
+test_entry_t;
+
+static test_entry_t test_cases[TEST_CASES_MAX];
+static uint32_t     test_case_count;
+
+void test_register(const char * p_name, test_case_t test_case)
+{
+    if(test_case_count == TEST_CASES_MAX)
+    {
+        fprintf(stderr, "too many test cases, raise TEST_CASES_MAX\n");
+        exit(1);
+    }
+    test_cases[test_case_count].p_name    = p_name;
+    test_cases[test_case_count].test_case = test_case;
+    test_case_count++;
+}
+
+/**@brief Run one case in child process.
+ *
+ * @return true if it passed.
+ */
+
+static bool test_run(const test_entry_t * p_entry, uint64_t seed)
+{
+    pid_t pid;
+    int   status;
+
+    fflush(stdout);
+    pid = fork();
+    if(pid < 0)
+    {
+        perror("fork");
+        exit(1);
+    }
+    if(pid == 0)
+    {
+        alarm(TEST_TIMEOUT_S);
+        sim_init(seed);
+        p_entry->test_case();
+        fflush(stdout);
+        _exit(0);
+    }
+
+    if(waitpid(pid, &status, 0) < 0)
+    {
+        perror("waitpid");
+        exit(1);
+    }
+    if(WIFSIGNALED(status))
+    {
+        printf("%s: killed by signal %d%s\n", p_entry->p_name, WTERMSIG(status),
+               (WTERMSIG(status) == SIGALRM) ? " (timeout)" : "");
+        return false;
+    }
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char * argv[])
+{
+    const char * p_filter = (argc > 1) ? argv[1] : NULL;
+    const char * p_seed   = getenv("SIM_SEED");
+    uint64_t     seed     = (p_seed != NULL) ? strtoull(p_seed, NULL, 0) : 1;
+    uint32_t     run      = 0;
+    uint32_t     failed   = 0;
+    uint32_t     index;
+
+    for(index = 0; index < test_case_count; index++)
+    {
+        const test_entry_t * p_entry = &test_cases[index];
+
+        if( (p_filter != NULL) && (strstr(p_entry->p_name, p_filter) == NULL) )
+        {
+            continue;
+        }
+
+        run++;
+        if(test_run(p_entry, seed))
+        {
+            printf("PASS %s\n", p_entry->p_name);
+        }
+        else
+        {
+            printf("FAIL %s\n", p_entry->p_name);
+            failed++;
+        }
+    }
+
+    printf("%u of %u test cases passed\n", run - failed, run);
+    return (failed == 0) ? 0 : 1;
+}
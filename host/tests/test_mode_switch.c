@@ -0,0 +1,179 @@
+/** @file   test_mode_switch.c
+ *  @brief  Switch between run and config mode keeps links of running sensors
+ *          up, so their values reach the host without gap. Sensors are paired
+ *          directly without bond in config mode, and bonds of sensors
+ *          onboarded meanwhile are deleted on the switch back to run.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "sim_dm.h"
+
+#define TEST_MODE_SWITCH_NOTIFY_MS    1000
+#define TEST_MODE_SWITCH_GAP_US       SIM_MS(2 * TEST_MODE_SWITCH_NOTIFY_MS)    /**< One lost value at most. */
+
+static sim_sensor_t * test_mode_switch_add(data_id_t type, sim_sensor_mode_t mode)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+    cfg.mode               = mode;
+    cfg.notify_interval_ms = TEST_MODE_SWITCH_NOTIFY_MS;
+    return sim_sensor_add(&cfg);
+}
+
+/**@brief Longest time between two values of sensor received by host after frame index from. */
+
+static uint64_t test_mode_switch_max_gap(data_id_t data_id, size_t from)
+{
+    const sim_kinetis_frame_t * p_frame;
+    uint64_t                    last = 0;
+    uint64_t                    gap  = 0;
+
+    while( (p_frame = sim_kinetis_find(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, &from)) != NULL )
+    {
+        if( (last != 0) && ((p_frame->time - last) > gap) )
+        {
+            gap = p_frame->time - last;
+        }
+        last = p_frame->time;
+        from++;
+    }
+    return gap;
+}
+
+/**@brief Onboard sensor in config mode.
+ *
+ * @return true if host got FIELD_ID_ONBOARD_DONE for sensor type.
+ */
+
+static bool test_mode_switch_onboard(sim_sensor_t * p_sensor, data_id_t type)
+{
+    const size_t from = sim_kinetis_frame_count();
+
+    sim_sensor_set_mode(p_sensor, SIM_SENSOR_CONFIG);
+    sim_sensor_set_power(p_sensor, true);
+    return (sim_kinetis_wait(type, FIELD_ID_ONBOARD_DONE, from, SIM_S(30)) != NULL);
+}
+
+TEST(mode_switch_keeps_running_sensors)
+{
+    sim_sensor_t * p_htu;
+    sim_sensor_t * p_mic;
+    sim_sensor_t * p_light;
+    stats_block_t  stats;
+    uint64_t       gap;
+    size_t         from;
+
+    p_htu   = test_mode_switch_add(DATA_ID_DEV_HTU, SIM_SENSOR_SECURED);
+    p_mic   = test_mode_switch_add(DATA_ID_DEV_SOUND, SIM_SENSOR_SECURED);
+    p_light = test_mode_switch_add(DATA_ID_DEV_LIGHT, SIM_SENSOR_CONFIG);
+    sim_sensor_set_power(p_light, false);
+    sim_fixture_boot();
+    sim_fixture_set_passkey(DATA_ID_DEV_LIGHT, "246810");
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_wait_running(p_mic, SIM_S(30)) != UINT64_MAX);
+    sim_run_for(SIM_S(5));
+    sim_fixture_read_stats(&stats, true);
+
+    // New sensor is onboarded while the others keep running.
+    from = sim_kinetis_frame_count();
+    sim_fixture_config();
+    TEST_ASSERT(test_mode_switch_onboard(p_light, DATA_ID_DEV_LIGHT));
+    sim_fixture_run();
+    sim_run_for(SIM_S(10));
+
+    TEST_ASSERT(sim_sensor_connected(p_htu));
+    TEST_ASSERT(sim_sensor_connected(p_mic));
+    TEST_ASSERT(sim_sensor_stats(p_htu)->connections == 1);
+    TEST_ASSERT(sim_sensor_stats(p_mic)->connections == 1);
+
+    gap = test_mode_switch_max_gap(sim_fixture_instance(p_htu), from);
+    printf("  htu: longest gap %llu ms\n", (unsigned long long)(gap / SIM_US_PER_MS));
+    TEST_ASSERT((gap != 0) && (gap <= TEST_MODE_SWITCH_GAP_US));
+    gap = test_mode_switch_max_gap(sim_fixture_instance(p_mic), from);
+    printf("  mic: longest gap %llu ms\n", (unsigned long long)(gap / SIM_US_PER_MS));
+    TEST_ASSERT((gap != 0) && (gap <= TEST_MODE_SWITCH_GAP_US));
+
+    // Config link was paired once, without bond, with passkey written by onboarding.
+    TEST_ASSERT(sim_sensor_stats(p_light)->pairings == 1);
+    TEST_ASSERT(sim_sensor_bonded(p_light) == false);
+    TEST_ASSERT(sim_dm_bonded(sim_sensor_addr(p_light), NULL) == false);
+    TEST_ASSERT(sim_dm_bond_count() == 2);
+    TEST_ASSERT(strcmp(sim_sensor_passkey(p_light), "246810") == 0);
+
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.path[STATS_PATH_MODE_SWITCH].count == 2);
+}
+
+TEST(mode_switch_onboarded_sensor_pairs_with_new_passkey)
+{
+    sim_sensor_t * p_htu;
+    sim_sensor_t * p_light;
+
+    p_htu   = test_mode_switch_add(DATA_ID_DEV_HTU, SIM_SENSOR_SECURED);
+    p_light = test_mode_switch_add(DATA_ID_DEV_LIGHT, SIM_SENSOR_CONFIG);
+    sim_sensor_set_power(p_light, false);
+    sim_fixture_boot();
+    sim_fixture_set_passkey(DATA_ID_DEV_LIGHT, "246810");
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+
+    sim_fixture_config();
+    TEST_ASSERT(test_mode_switch_onboard(p_light, DATA_ID_DEV_LIGHT));
+
+    // Sensor restarts with its new passkey and is paired with it in run mode.
+    sim_sensor_set_mode(p_light, SIM_SENSOR_SECURED);
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_light, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_instance(p_light) == DATA_ID_DEV_LIGHT);
+    TEST_ASSERT(sim_sensor_stats(p_light)->pairings == 2);
+    TEST_ASSERT(sim_sensor_bonded(p_light));
+    TEST_ASSERT(sim_dm_bonded(sim_sensor_addr(p_light), NULL));
+    TEST_ASSERT(sim_sensor_stats(p_htu)->connections == 1);
+}
+
+TEST(mode_switch_deletes_bond_of_onboarded_sensor)
+{
+    sim_sensor_t * p_htu;
+    sim_sensor_t * p_mic;
+
+    p_htu = test_mode_switch_add(DATA_ID_DEV_HTU, SIM_SENSOR_SECURED);
+    p_mic = test_mode_switch_add(DATA_ID_DEV_SOUND, SIM_SENSOR_SECURED);
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_wait_running(p_mic, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_dm_bonded(sim_sensor_addr(p_htu), NULL));
+
+    // Bonded sensor is onboarded again with new passkey. Stored keys are not used for it.
+    sim_fixture_set_passkey(DATA_ID_DEV_HTU, "246810");
+    sim_fixture_config();
+    TEST_ASSERT(test_mode_switch_onboard(p_htu, DATA_ID_DEV_HTU));
+    TEST_ASSERT(sim_sensor_stats(p_htu)->pairings == 2);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->encryptions == 0);
+    TEST_ASSERT(sim_dm_bonded(sim_sensor_addr(p_htu), NULL));
+
+    // Switch to run deletes its bond, sensor still holds old keys but is paired with new passkey.
+    sim_sensor_set_mode(p_htu, SIM_SENSOR_SECURED);
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_log_contains_since(0, "Deleting bond"));
+    TEST_ASSERT(sim_sensor_stats(p_htu)->pairings == 3);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->encryptions == 0);
+    TEST_ASSERT(sim_dm_bonded(sim_sensor_addr(p_htu), NULL));
+
+    // Bond of sensor which was not onboarded is kept, and used on its next connection.
+    TEST_ASSERT(sim_sensor_stats(p_mic)->connections == 1);
+    sim_sensor_set_power(p_mic, false);
+    sim_run_for(SIM_S(10));
+    sim_sensor_set_power(p_mic, true);
+    TEST_ASSERT(sim_fixture_wait_running(p_mic, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_mic)->pairings == 1);
+    TEST_ASSERT(sim_sensor_stats(p_mic)->encryptions == 1);
+}
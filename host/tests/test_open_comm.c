@@ -0,0 +1,143 @@
+/** @file   test_open_comm.c
+ *  @brief  Sensor offering the open Relayr service is served without security
+ *          setup when the host allows its type and the sensor confirms it
+ *          needs no MITM protection, and is paired as usual otherwise.
+ */
+
+/* -- Includes -- */
+
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+
+static sim_sensor_t * test_open_comm_add(data_id_t type, bool mitm_flag)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+    cfg.mode           = SIM_SENSOR_OPEN;
+    cfg.open_mitm_flag = mitm_flag;
+    return sim_sensor_add(&cfg);
+}
+
+static void test_open_comm_allow(data_id_t data_id)
+{
+    const size_t from = sim_kinetis_frame_count();
+
+    sim_fixture_set_open_comm(data_id, true);
+    TEST_ASSERT_MSG(sim_kinetis_wait(DATA_ID_CONFIG, FIELD_ID_CONFIG_ACK, from, SIM_MS(10)) != NULL, "data id 0x%02x", data_id);
+}
+
+TEST(open_comm_sensor_served_without_security)
+{
+    sim_sensor_t * p_open;
+    sim_sensor_t * p_secured;
+    stats_block_t  stats;
+
+    p_open = test_open_comm_add(DATA_ID_DEV_LIGHT, false);
+    {
+        sim_sensor_cfg_t htu = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        p_secured = sim_sensor_add(&htu);
+    }
+    sim_fixture_boot();
+    test_open_comm_allow(DATA_ID_DEV_LIGHT);
+    sim_fixture_read_stats(&stats, true);
+    sim_fixture_run();
+
+    TEST_ASSERT(sim_fixture_wait_running(p_open, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_wait_running(p_secured, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_fixture_instance(p_open) == DATA_ID_DEV_LIGHT);
+
+    // Open sensor was neither paired nor encrypted, the other one paired as usual.
+    TEST_ASSERT(sim_sensor_stats(p_open)->pairings == 0);
+    TEST_ASSERT(sim_sensor_stats(p_open)->encryptions == 0);
+    TEST_ASSERT(sim_sensor_stats(p_open)->secured_us == 0);
+    TEST_ASSERT(sim_sensor_stats(p_secured)->pairings == 1);
+
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.bringup_open.count == 1);
+    TEST_ASSERT(stats.bringup_secure.count == 1);
+    TEST_ASSERT(stats.secure_pair.count == 1);
+
+    // Values of open sensor reach the host.
+    sim_run_for(SIM_S(5));
+    TEST_ASSERT(sim_sensor_stats(p_open)->notifications > 0);
+    TEST_ASSERT(sim_fixture_count_frames(DATA_ID_DEV_LIGHT, FIELD_ID_CHAR_SENSOR_DATA_R, 0) > 0);
+}
+
+TEST(open_comm_needs_permission_of_host)
+{
+    sim_sensor_t * p_open;
+    stats_block_t  stats;
+
+    p_open = test_open_comm_add(DATA_ID_DEV_LIGHT, false);
+    sim_fixture_boot();
+    sim_fixture_read_stats(&stats, true);
+    sim_fixture_run();
+
+    // Type is not allowed, sensor is paired although it offers open service.
+    TEST_ASSERT(sim_fixture_wait_running(p_open, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_open)->pairings == 1);
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.bringup_open.count == 0);
+    TEST_ASSERT(stats.bringup_secure.count == 1);
+}
+
+TEST(open_comm_sensor_requiring_mitm_is_not_served)
+{
+    sim_sensor_t * p_open;
+    stats_block_t  stats;
+
+    p_open = test_open_comm_add(DATA_ID_DEV_LIGHT, true);
+    sim_fixture_boot();
+    test_open_comm_allow(DATA_ID_DEV_LIGHT);
+    sim_fixture_read_stats(&stats, true);
+    sim_fixture_run();
+
+    // Sensor is disconnected after its flag was read, and never reported as running.
+    TEST_ASSERT(sim_fixture_wait_running(p_open, SIM_S(30)) == UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_open)->connections > 0);
+    TEST_ASSERT(sim_sensor_stats(p_open)->pairings == 0);
+    TEST_ASSERT(sim_log_contains_since(0, "does not confirm open communication"));
+    TEST_ASSERT(sim_fixture_count_frames(DATA_ID_DEV_LIGHT, FIELD_ID_CHAR_SENSOR_DATA_R, 0) == 0);
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.bringup_open.count == 0);
+}
+
+TEST(open_comm_confirmation_kept_across_reconnect)
+{
+    sim_sensor_t * p_open;
+    uint32_t       first;
+    uint32_t       reads;
+
+    p_open = test_open_comm_add(DATA_ID_DEV_LIGHT, false);
+    sim_fixture_boot();
+    test_open_comm_allow(DATA_ID_DEV_LIGHT);
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_open, SIM_S(30)) != UINT64_MAX);
+    first = sim_sensor_stats(p_open)->att_reads;
+
+    // Reconnecting sensor is identified without its MITM flag being read again.
+    sim_sensor_set_power(p_open, false);
+    sim_run_for(SIM_S(10));
+    reads = sim_sensor_stats(p_open)->att_reads;
+    sim_sensor_set_power(p_open, true);
+    TEST_ASSERT(sim_fixture_wait_running(p_open, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT_MSG((sim_sensor_stats(p_open)->att_reads - reads) == (first - 1),
+                    "%u reads on first connection, %u on reconnect", first, sim_sensor_stats(p_open)->att_reads - reads);
+    TEST_ASSERT(sim_sensor_stats(p_open)->pairings == 0);
+    TEST_ASSERT(sim_fixture_instance(p_open) == DATA_ID_DEV_LIGHT);
+}
+
+TEST(open_comm_rejects_data_id_of_no_sensor)
+{
+    const sim_kinetis_frame_t * p_error;
+    size_t                      from;
+
+    sim_fixture_boot();
+    from = sim_kinetis_frame_count();
+    sim_fixture_set_open_comm(DATA_ID_DEV_CENTRAL, true);
+    p_error = sim_kinetis_wait(DATA_ID_RESPONSE_ERROR, RESPONSE_ERROR_VALUE, from, SIM_MS(10));
+    TEST_ASSERT(p_error != NULL);
+    TEST_ASSERT(p_error->frame.data[1] == FIELD_ID_OPEN_COMM);
+}
@@ -0,0 +1,77 @@
+/** @file   test_power.c
+ *  @brief  Main loop wakeups and handlers run per wakeup, in running mode.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_POWER_WINDOW_US   SIM_S(60)
+
+/**@brief Add HTU sensor, select running mode and wait for its first DATA_R frame.
+ *
+ * @return Index of the first DATA_R frame.
+ */
+
+static size_t test_power_stream_start(void)
+{
+    sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+    sim_sensor_t   * p_sensor;
+    size_t           index = 0;
+
+    p_sensor = sim_sensor_add(&cfg);
+    sim_fixture_boot();
+    sim_fixture_run();
+
+    TEST_ASSERT(sim_fixture_wait_running(p_sensor, SIM_S(20)) != UINT64_MAX);
+    TEST_ASSERT(sim_kinetis_wait(DATA_ID_DEV_HTU, FIELD_ID_CHAR_SENSOR_DATA_R, 0, SIM_S(5)) != NULL);
+    TEST_ASSERT(sim_kinetis_find(DATA_ID_DEV_HTU, FIELD_ID_CHAR_SENSOR_DATA_R, &index) != NULL);
+    return index;
+}
+
+TEST(run_command_starts_sensor_stream)
+{
+    size_t from = test_power_stream_start();
+
+    // Sensor notifies one value per second.
+    sim_run_for(SIM_S(10));
+    TEST_ASSERT(sim_fixture_count_frames(DATA_ID_DEV_HTU, FIELD_ID_CHAR_SENSOR_DATA_R, from) >= 10);
+}
+
+TEST(wakeup_runs_only_handlers_with_work)
+{
+    stats_block_t    stats;
+    const sim_cpu_t *p_cpu;
+    uint32_t         handlers;
+    uint32_t         frames;
+    size_t           from;
+
+    (void)test_power_stream_start();
+    sim_fixture_read_stats(&stats, true);
+    sim_cpu_reset();
+    from = sim_kinetis_frame_count();
+
+    sim_run_for(TEST_POWER_WINDOW_US);
+    p_cpu  = sim_cpu();
+    frames = sim_fixture_count_frames(DATA_ID_DEV_HTU, FIELD_ID_CHAR_SENSOR_DATA_R, from);
+    sim_fixture_read_stats(&stats, true);
+
+    handlers = stats.path[STATS_PATH_ONBOARD].count + stats.path[STATS_PATH_PSTORAGE_RUN].count +
+               stats.path[STATS_PATH_CLIENT_EVENT].count + stats.path[STATS_PATH_SPI_RX].count +
+               stats.path[STATS_PATH_SPI_TX_READY].count;
+
+    printf("  %u wakeups, %u handler runs, %.1f us main loop per wakeup, %u DATA_R frames in %llu s\n",
+           stats.wakeups, handlers, (double)p_cpu->main_ns / 1000.0 / (double)p_cpu->main_slices,
+           frames, (unsigned long long)(TEST_POWER_WINDOW_US / SIM_US_PER_S));
+
+    // No client error, clients are not scanned.
+    TEST_ASSERT(stats.path[STATS_PATH_CLIENT_EVENT].count == 0);
+    TEST_ASSERT(frames >= 58);
+    TEST_ASSERT(stats.wakeups > 0);
+
+    // Each value takes notification, SPI transaction and RDY handling, no wakeup runs all handlers.
+    TEST_ASSERT_MSG(handlers < 2 * stats.wakeups, "%u handler runs in %u wakeups", handlers, stats.wakeups);
+    TEST_ASSERT_MSG(stats.wakeups < 20 * frames, "%u wakeups for %u frames", stats.wakeups, frames);
+}
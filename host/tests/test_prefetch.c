@@ -0,0 +1,106 @@
+/** @file   test_prefetch.c
+ *  @brief  Device information and battery level read at connection are served to
+ *          the host without GATT requests. Values notified meanwhile are
+ *          not lost.
+ */
+
+/* -- Includes -- */
+
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_PREFETCH_LOCAL_US    SIM_MS(20)
+
+typedef struct
+{
+    uint8_t      field;
+    const char * p_value;       /**< As the simulated sensor holds it. */
+    uint8_t      len;
+}
+test_prefetch_field_t;
+
+static const test_prefetch_field_t test_prefetch_fields[] =
+{
+    { FIELD_ID_CHAR_MANUFACTURER_NAME,  "relayr", 6 },
+    { FIELD_ID_CHAR_HARDWARE_REVISION,  "WB-1.1", 6 },
+    { FIELD_ID_CHAR_FIRMWARE_REVISION,  "1.3.0",  5 },
+    { FIELD_ID_CHAR_BATTERY_LEVEL,      "\x57",   1 },
+};
+
+TEST(prefetched_info_served_without_gatt)
+{
+    sim_sensor_t * p_sensors[DATA_ID_DEV_IR + 1];
+    uint32_t       reads[DATA_ID_DEV_IR + 1];
+    data_id_t      type;
+    uint8_t        index;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(type);
+
+        p_sensors[type] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(60)));
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        // Prefetch read every field once before the sensor was reported running.
+        reads[type] = sim_sensor_stats(p_sensors[type])->att_reads;
+        TEST_ASSERT_MSG(reads[type] >= sizeof(test_prefetch_fields) / sizeof(test_prefetch_fields[0]),
+                        "type %u read %u times", type, reads[type]);
+    }
+
+    // Sensor has one SPI frame slot, fields are read one after another and sensors at once.
+    for(index = 0; index < sizeof(test_prefetch_fields) / sizeof(test_prefetch_fields[0]); index++)
+    {
+        const test_prefetch_field_t * p_field = &test_prefetch_fields[index];
+        const uint64_t                start   = sim_now();
+        const size_t                  from    = sim_kinetis_frame_count();
+
+        for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+        {
+            TEST_ASSERT(sim_kinetis_send(type, p_field->field, OPERATION_V1(OPERATION_READ, 0), NULL, 0));
+        }
+        for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+        {
+            const sim_kinetis_frame_t * p_frame = sim_kinetis_wait(type, p_field->field, from, SIM_S(1));
+
+            TEST_ASSERT_MSG(p_frame != NULL, "type %u field %u not answered", type, p_field->field);
+            TEST_ASSERT_MSG(memcmp(p_frame->frame.data, p_field->p_value, p_field->len) == 0, "type %u field %u", type, p_field->field);
+            TEST_ASSERT((p_frame->time - start) < TEST_PREFETCH_LOCAL_US);
+        }
+    }
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        TEST_ASSERT_MSG(sim_sensor_stats(p_sensors[type])->att_reads == reads[type], "type %u was read", type);
+    }
+}
+
+TEST(prefetch_keeps_notified_values)
+{
+    sim_sensor_cfg_t            cfg     = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+    const char                * p_notified;
+    const char                * p_running;
+    sim_sensor_t              * p_htu;
+    stats_block_t               stats;
+
+    // Values are notified faster than prefetch reads complete.
+    cfg.notify_interval_ms = 10;
+    p_htu = sim_sensor_add(&cfg);
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+
+    p_notified = strstr(sim_log(), "Notification->");
+    p_running  = strstr(sim_log(), "Go to running state");
+    TEST_ASSERT((p_notified != NULL) && (p_running != NULL) && (p_notified < p_running));
+
+    // Every notification was taken, including those of prefetch.
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT_MSG(stats.notifications[DATA_ID_DEV_HTU] == sim_sensor_stats(p_htu)->notifications,
+                    "%u of %u notifications", stats.notifications[DATA_ID_DEV_HTU], sim_sensor_stats(p_htu)->notifications);
+}
@@ -0,0 +1,131 @@
+/** @file   test_rotation.c
+ *  @brief  More sensors than connections served by rotation: every sensor is
+ *          connected once per period and its values reach the host.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "app_timer.h"
+#include "sensor_slots.h"
+
+#define TEST_ROTATION_TYPES       (DATA_ID_DEV_BRIDGE + 1)                     /**< IR sends no values. */
+#define TEST_ROTATION_MULTI       (SENSOR_SLOTS_NUM / SENSOR_INSTANCES_MAX)    /**< Types with every instance, they take all slots. */
+#define TEST_ROTATION_SENSORS     (SENSOR_SLOTS_NUM + TEST_ROTATION_TYPES - TEST_ROTATION_MULTI)
+#define TEST_ROTATION_PERIOD_S    120
+#define TEST_ROTATION_WINDOW_S    3
+#define TEST_ROTATION_ONBOARD_US  SIM_S(900)
+#define TEST_ROTATION_RUN_US      SIM_S(3 * TEST_ROTATION_PERIOD_S)
+
+static sim_sensor_t * test_rotation_sensors[TEST_ROTATION_SENSORS];
+
+/**@brief Sensors of first types are all their instances, each further type has instance 0 only. */
+static data_id_t test_rotation_data_id(uint8_t index)
+{
+    if(index < SENSOR_SLOTS_NUM)
+    {
+        return DATA_ID_INSTANCE(index / SENSOR_INSTANCES_MAX, index % SENSOR_INSTANCES_MAX);
+    }
+    return DATA_ID_INSTANCE(TEST_ROTATION_MULTI + index - SENSOR_SLOTS_NUM, 0);
+}
+
+static bool test_rotation_all_known(void * p_ctx)
+{
+    uint8_t index;
+
+    (void)p_ctx;
+    for(index = 0; index < TEST_ROTATION_SENSORS; index++)
+    {
+        if(sim_fixture_instance(test_rotation_sensors[index]) == DATA_ID_ERROR)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(rotation_serves_more_sensors_than_links)
+{
+    char           passkeys[TEST_ROTATION_SENSORS][sizeof(passkey_t)];
+    uint32_t       connections[TEST_ROTATION_SENSORS];
+    stats_block_t  stats;
+    uint64_t       longest = 0;
+    uint64_t       start;
+    size_t         from;
+    uint8_t        index;
+
+    // Each sensor has passkey of its instance.
+    for(index = 0; index < TEST_ROTATION_SENSORS; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(DATA_ID_GET_TYPE(test_rotation_data_id(index)));
+
+        (void)snprintf(passkeys[index], sizeof(passkeys[index]), "1000%02u", index);
+        cfg.p_passkey                = passkeys[index];
+        test_rotation_sensors[index] = sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    for(index = 0; index < TEST_ROTATION_SENSORS; index++)
+    {
+        sim_fixture_set_passkey(test_rotation_data_id(index), passkeys[index]);
+        sim_fixture_set_rotation(test_rotation_data_id(index), TEST_ROTATION_PERIOD_S, TEST_ROTATION_WINDOW_S);
+        sim_run_for(SIM_MS(20));
+    }
+    start = sim_now();
+    sim_fixture_run();
+    TEST_ASSERT(sim_run_until_cond(test_rotation_all_known, NULL, TEST_ROTATION_ONBOARD_US));
+    printf("  %u sensors onboarded on %u links after %llu s\n", TEST_ROTATION_SENSORS, MAX_CLIENTS,
+           (unsigned long long)((sim_now() - start) / SIM_US_PER_S));
+
+    // Rotation settles within a period after the last sensor was onboarded.
+    sim_run_for(SIM_S(TEST_ROTATION_PERIOD_S));
+    for(index = 0; index < TEST_ROTATION_SENSORS; index++)
+    {
+        TEST_ASSERT_MSG(sim_fixture_instance(test_rotation_sensors[index]) == test_rotation_data_id(index),
+                        "sensor %u as 0x%02x", index, sim_fixture_instance(test_rotation_sensors[index]));
+        connections[index] = sim_sensor_stats(test_rotation_sensors[index])->connections;
+    }
+    from = sim_kinetis_frame_count();
+    sim_run_for(TEST_ROTATION_RUN_US);
+
+    // Every sensor is connected once per period, give or take its lag, and delivers values in every window.
+    for(index = 0; index < TEST_ROTATION_SENSORS; index++)
+    {
+        const data_id_t             data_id = test_rotation_data_id(index);
+        uint64_t                    last    = sim_now() - TEST_ROTATION_RUN_US;
+        size_t                      next    = from;
+        const sim_kinetis_frame_t * p_frame;
+
+        while((p_frame = sim_kinetis_find(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, &next)) != NULL)
+        {
+            if((p_frame->time - last) > longest)
+            {
+                longest = p_frame->time - last;
+            }
+            last = p_frame->time;
+            next++;
+        }
+        if((sim_now() - last) > longest)
+        {
+            longest = sim_now() - last;
+        }
+        TEST_ASSERT_MSG((sim_sensor_stats(test_rotation_sensors[index])->connections - connections[index]) >= (TEST_ROTATION_RUN_US / SIM_S(TEST_ROTATION_PERIOD_S) - 1),
+                        "sensor %u", index);
+        TEST_ASSERT(sim_fixture_check_values(data_id, from) >= (TEST_ROTATION_RUN_US / SIM_S(TEST_ROTATION_PERIOD_S) - 1));
+
+        // Planned disconnections are not reported to the host.
+        next = from;
+        while((p_frame = sim_kinetis_find(data_id, FIELD_ID_SENSOR_STATUS, &next)) != NULL)
+        {
+            TEST_ASSERT_MSG(p_frame->frame.operation != CONNECTION_CLOSED, "sensor %u", index);
+            next++;
+        }
+    }
+
+    sim_fixture_read_stats(&stats, true);
+    printf("  longest gap between values %llu s, %u rotation cycles, longest lag %u ms\n",
+           (unsigned long long)(longest / SIM_US_PER_S), stats.rotation_cycles,
+           (unsigned)((uint64_t)stats.rotation_lag_ticks * 1000 / APP_TIMER_CLOCK_FREQ));
+    TEST_ASSERT(longest < SIM_S(2 * TEST_ROTATION_PERIOD_S));
+}
@@ -0,0 +1,157 @@
+/** @file   test_schema.c
+ *  @brief  Tables generated from SENSOR_SCHEMA against sensor structs, and SPI
+ *          command validation which uses them.
+ */
+
+/* -- Includes -- */
+
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+extern const uint8_t SENSORS_DEVICE_NAME[MAX_CLIENTS][BLE_DEVNAME_MAX_LEN + 1];
+
+/**@brief Expected layout of a sensor, written out from its structs. Size 0 means field is absent. */
+typedef struct
+{
+    const char * p_name;
+    uint8_t      frequency;
+    uint8_t      threshold;
+    uint8_t      config;
+    uint8_t      data_r;
+    uint8_t      data_w;
+}
+test_schema_t;
+
+static const test_schema_t test_schema[DATA_ID_DEV_IR + 1] =
+{
+    [DATA_ID_DEV_HTU]    = { "WunderbarHTU",   sizeof(frequency_t), sizeof(sensor_htu_threshold_t),
+                             sizeof(sensor_htu_config_t), sizeof(sensor_htu_data_t), 0 },
+    [DATA_ID_DEV_GYRO]   = { "WunderbarGYRO",  sizeof(frequency_t), sizeof(sensor_gyro_threshold_t),
+                             sizeof(sensor_gyro_config_t), sizeof(sensor_gyro_data_t), 0 },
+    [DATA_ID_DEV_LIGHT]  = { "WunderbarLIGHT", sizeof(frequency_t), sizeof(sensor_lightprox_threshold_t),
+                             sizeof(sensor_lightprox_config_t), sizeof(sensor_lightprox_data_t), 0 },
+    [DATA_ID_DEV_SOUND]  = { "WunderbarMIC",   sizeof(frequency_t), sizeof(sensor_microphone_threshold_t),
+                             0, sizeof(sensor_microphone_data_t), 0 },
+    [DATA_ID_DEV_BRIDGE] = { "WunderbarBRIDG", 0, 0,
+                             sizeof(sensor_bridge_config_t), sizeof(sensor_bridge_data_t), sizeof(sensor_bridge_data_t) },
+    [DATA_ID_DEV_IR]     = { "WunderbarIR",    0, 0,
+                             0, 0, sizeof(sensor_ir_data_t) },
+};
+
+/**@brief Expected size of sensor field, 0 if sensor has no such field. */
+
+static uint8_t test_schema_size(data_id_t type, uint8_t field)
+{
+    const test_schema_t * p_schema = &test_schema[type];
+
+    switch(field)
+    {
+        case FIELD_ID_CHAR_SENSOR_ID:               return sizeof(sensorID_t);
+        case FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY: return sizeof(beaconFrequency_t);
+        case FIELD_ID_CHAR_SENSOR_FREQUENCY:        return p_schema->frequency;
+        case FIELD_ID_CHAR_SENSOR_LED_STATE:        return sizeof(led_state_t);
+        case FIELD_ID_CHAR_SENSOR_THRESHOLD:        return p_schema->threshold;
+        case FIELD_ID_CHAR_SENSOR_CONFIG:           return p_schema->config;
+        case FIELD_ID_CHAR_SENSOR_DATA_R:           return p_schema->data_r;
+        case FIELD_ID_CHAR_SENSOR_DATA_W:           return p_schema->data_w;
+        case FIELD_ID_CHAR_BATTERY_LEVEL:           return 1;
+        case FIELD_ID_CHAR_MANUFACTURER_NAME:
+        case FIELD_ID_CHAR_HARDWARE_REVISION:
+        case FIELD_ID_CHAR_FIRMWARE_REVISION:       return SPI_PACKET_DATA_SIZE;
+        default:                                    return 0;
+    }
+}
+
+static bool test_schema_writable(uint8_t field)
+{
+    return (field >= FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY) && (field <= FIELD_ID_CHAR_SENSOR_DATA_W) &&
+           (field != FIELD_ID_CHAR_SENSOR_DATA_R);
+}
+
+TEST(schema_tables_match_sensor_structs)
+{
+    data_id_t type;
+    uint8_t   field;
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        TEST_ASSERT_MSG(strcmp((const char *)SENSORS_DEVICE_NAME[type], test_schema[type].p_name) == 0,
+                        "type %u named %s", type, SENSORS_DEVICE_NAME[type]);
+
+        for(field = 0; field < FIELD_ID_SENSOR_STATUS; field++)
+        {
+            const uint8_t size    = test_schema_size(type, field);
+            const bool    present = sensor_field_is_valid(type, field, OPERATION_READ);
+
+            TEST_ASSERT_MSG(present == (size != 0), "type %u field %u present %d, expected size %u", type, field, present, size);
+            TEST_ASSERT_MSG(sensor_field_is_valid(type, field, OPERATION_WRITE) == (present && test_schema_writable(field)),
+                            "type %u field %u writable", type, field);
+            if(present)
+            {
+                TEST_ASSERT_MSG(sensors_get_msg_size(type, field) == size, "type %u field %u size %u, struct %u",
+                                type, field, sensors_get_msg_size(type, field), size);
+            }
+        }
+        TEST_ASSERT(sensors_get_msg_size(type, FIELD_ID_SENSOR_STATUS) == sizeof(sensorID_t));
+    }
+
+    // Out of range requests have no size and no field.
+    TEST_ASSERT(sensors_get_msg_size(DATA_ID_DEV_CFG_APP + 1, FIELD_ID_CHAR_SENSOR_ID) == 0);
+    TEST_ASSERT(sensors_get_msg_size(DATA_ID_DEV_HTU, FIELD_ID_SENSOR_STATUS + 1) == 0);
+    TEST_ASSERT(sensor_field_is_valid(DATA_ID_DEV_CFG_APP, FIELD_ID_CHAR_SENSOR_ID, OPERATION_READ) == false);
+}
+
+/**@brief Send write of field with given length, return error code of response, 0 if there was none. */
+
+static uint8_t test_schema_write_error(data_id_t type, uint8_t field, uint8_t len)
+{
+    static const uint8_t        data[SPI_PACKET_DATA_SIZE];
+    const sim_kinetis_frame_t * p_error;
+    const size_t                from = sim_kinetis_frame_count();
+    size_t                      index;
+
+    TEST_ASSERT(sim_kinetis_send(type, field, OPERATION_V1(OPERATION_WRITE, len), data, len));
+    sim_run_for(SIM_MS(20));
+
+    for(index = from; (p_error = sim_kinetis_find(DATA_ID_RESPONSE_ERROR, 0xFF, &index)) != NULL; index++)
+    {
+        if( (p_error->frame.data[0] == type) && (p_error->frame.data[1] == field) )
+        {
+            return p_error->frame.field_id;
+        }
+    }
+    return 0;
+}
+
+TEST(spi_validates_commands_by_schema)
+{
+    data_id_t type;
+    uint8_t   field;
+
+    sim_fixture_boot();
+    sim_kinetis_link_enable();
+    sim_run_for(SIM_MS(10));
+
+    for(type = DATA_ID_DEV_HTU; type <= DATA_ID_DEV_IR; type++)
+    {
+        for(field = 0; field <= FIELD_ID_CHAR_SENSOR_DATA_W; field++)
+        {
+            const uint8_t size = test_schema_size(type, field);
+
+            if(size == 0)
+            {
+                TEST_ASSERT_MSG(test_schema_write_error(type, field, 0) == RESPONSE_ERROR_FIELD_ID, "type %u field %u", type, field);
+            }
+            else if(test_schema_writable(field) == false)
+            {
+                TEST_ASSERT_MSG(test_schema_write_error(type, field, size) == RESPONSE_ERROR_OPERATION, "type %u field %u", type, field);
+            }
+            else
+            {
+                // Payload one byte shorter than struct of the field.
+                TEST_ASSERT_MSG(test_schema_write_error(type, field, size - 1) == RESPONSE_ERROR_LENGTH, "type %u field %u", type, field);
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/** @file   test_security.c
+ *  @brief  Bonded sensor is reconnected with stored keys and discovered while
+ *          its link is encrypted, and paired again only when its keys are
+ *          rejected.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "app_timer.h"
+
+#define TEST_SECURITY_ROUNDS      3
+#define TEST_SECURITY_OFF_US      SIM_S(10)    /**< Longer than supervision timeout. */
+
+#define TEST_SECURITY_TICKS_TO_US(ticks)  ((uint64_t)(ticks) * SIM_US_PER_S / APP_TIMER_CLOCK_FREQ)
+
+static void test_security_reconnect(sim_sensor_t * p_sensor)
+{
+    sim_sensor_set_power(p_sensor, false);
+    sim_run_for(TEST_SECURITY_OFF_US);
+    sim_sensor_set_power(p_sensor, true);
+}
+
+TEST(reconnect_resumes_encryption_without_pairing)
+{
+    sim_sensor_t * p_htu;
+    stats_block_t  stats;
+    uint8_t        round;
+
+    {
+        sim_sensor_cfg_t htu = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        p_htu = sim_sensor_add(&htu);
+    }
+    sim_fixture_boot();
+    sim_fixture_read_stats(&stats, true);
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->pairings == 1);
+    TEST_ASSERT(sim_sensor_bonded(p_htu));
+
+    for(round = 0; round < TEST_SECURITY_ROUNDS; round++)
+    {
+        const sim_sensor_stats_t * p_stats;
+
+        test_security_reconnect(p_htu);
+        TEST_ASSERT_MSG(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX, "round %u", round);
+        p_stats = sim_sensor_stats(p_htu);
+        printf("  round %u: secured after %llu ms, discovery from %llu ms\n", round,
+               (unsigned long long)((p_stats->secured_us - p_stats->connected_us) / SIM_US_PER_MS),
+               (unsigned long long)((p_stats->discovery_first_us - p_stats->connected_us) / SIM_US_PER_MS));
+
+        // Link is encrypted with stored keys. Discovery is requested before, link layer sends it
+        // with first encrypted packet.
+        TEST_ASSERT_MSG(p_stats->encryptions == (round + 1u), "round %u", round);
+        TEST_ASSERT_MSG(p_stats->secured_us != 0, "round %u", round);
+        TEST_ASSERT_MSG(p_stats->discovery_first_us <= p_stats->secured_us, "round %u", round);
+    }
+    TEST_ASSERT(sim_sensor_stats(p_htu)->pairings == 1);
+    TEST_ASSERT(sim_fixture_instance(p_htu) == DATA_ID_DEV_HTU);
+
+    // Every secured link is timed on its path, resumed encryption is faster than pairing.
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.secure_pair.count == 1);
+    TEST_ASSERT(stats.secure_resume.count == TEST_SECURITY_ROUNDS);
+    TEST_ASSERT(stats.secure_resume.max_ticks < stats.secure_pair.total_ticks);
+    printf("  pairing %llu ms, resume max %llu ms\n",
+           (unsigned long long)(TEST_SECURITY_TICKS_TO_US(stats.secure_pair.total_ticks) / SIM_US_PER_MS),
+           (unsigned long long)(TEST_SECURITY_TICKS_TO_US(stats.secure_resume.max_ticks) / SIM_US_PER_MS));
+}
+
+TEST(reconnect_pairs_again_when_keys_are_rejected)
+{
+    sim_sensor_t * p_htu;
+    stats_block_t  stats;
+
+    {
+        sim_sensor_cfg_t htu = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+
+        p_htu = sim_sensor_add(&htu);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    sim_fixture_read_stats(&stats, true);
+
+    // Sensor lost its bond while it was away, e.g. after factory reset.
+    sim_sensor_set_power(p_htu, false);
+    sim_sensor_forget_bond(p_htu);
+    sim_run_for(TEST_SECURITY_OFF_US);
+    sim_sensor_set_power(p_htu, true);
+
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->pairings == 2);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->encryptions == 0);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->connections == 3);
+    TEST_ASSERT(sim_sensor_bonded(p_htu));
+
+    // Rejected keys are not a failure of the peer.
+    sim_fixture_read_stats(&stats, true);
+    TEST_ASSERT(stats.peer_failures == 0);
+    TEST_ASSERT(stats.secure_pair.count == 1);
+    TEST_ASSERT(stats.secure_resume.count == 0);
+
+    // New bond is used on next reconnect.
+    test_security_reconnect(p_htu);
+    TEST_ASSERT(sim_fixture_wait_running(p_htu, SIM_S(30)) != UINT64_MAX);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->pairings == 2);
+    TEST_ASSERT(sim_sensor_stats(p_htu)->encryptions == 1);
+}
@@ -0,0 +1,153 @@
+/** @file   test_spi_fuzz.c
+ *  @brief  Random frames on the SPI command path while sensors stream.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_FUZZ_FRAMES      3000
+#define TEST_FUZZ_GAP_US      SIM_MS(5)
+
+/**@brief Config fields which change mode or link of the host, they are not fuzzed. */
+static bool test_fuzz_field_excluded(uint8_t data_id, uint8_t field_id)
+{
+    if(data_id != DATA_ID_CONFIG)
+    {
+        return false;
+    }
+    switch(field_id)
+    {
+        case FIELD_ID_CONFIG_START:
+        case FIELD_ID_CONFIG_COMPLETE:
+        case FIELD_ID_CONFIG_STOP:
+        case FIELD_ID_RUN:
+        case FIELD_ID_KILL:
+        case FIELD_ID_LINK:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**@brief Fill frame with random header and payload, build length and operation around valid ones. */
+
+static uint8_t test_fuzz_frame(uint8_t * p_bytes)
+{
+    spi_frame_t * p_frame = (spi_frame_t *)p_bytes;
+    uint8_t       len     = SIM_KINETIS_FRAME_LEN;
+    uint8_t       index;
+
+    for(index = 0; index < SIM_KINETIS_FRAME_LEN; index++)
+    {
+        p_bytes[index] = (uint8_t)sim_random();
+    }
+
+    do
+    {
+        switch(sim_random() % 4)
+        {
+            case 0:
+                p_frame->data_id = (uint8_t)sim_random();
+                break;
+
+            case 1:
+                p_frame->data_id = DATA_ID_CONFIG;
+                break;
+
+            default:
+                p_frame->data_id = sim_random() % (DATA_ID_DEV_IR + 1);
+                break;
+        }
+        p_frame->field_id = (sim_random() % 2) ? (uint8_t)sim_random() : (uint8_t)(sim_random() % (FIELD_ID_OPEN_COMM + 1));
+    } while(test_fuzz_field_excluded(p_frame->data_id, p_frame->field_id));
+
+    switch(sim_random() % 4)
+    {
+        case 0:
+            p_frame->operation = (operation_t)sim_random();
+            break;
+
+        case 1:
+            p_frame->operation = (operation_t)(sim_random() % (OPERATION_READ_CACHED + 1));
+            break;
+
+        default:
+            p_frame->operation = (operation_t)OPERATION_V1(sim_random() % 4, sim_random() % (SPI_PACKET_DATA_SIZE + 2));
+            break;
+    }
+
+    // Some transactions end before the frame does.
+    if(sim_random_chance(0.1))
+    {
+        len = 1 + (sim_random() % SIM_KINETIS_FRAME_LEN);
+    }
+    return len;
+}
+
+TEST(spi_fuzz_keeps_firmware_serving)
+{
+    static const data_id_t      types[] = { DATA_ID_DEV_HTU, DATA_ID_DEV_GYRO, DATA_ID_DEV_BRIDGE };
+    uint32_t                    errors[RESPONSE_ERROR_REJECTED + 1];
+    const sim_kinetis_frame_t * p_frame;
+    uint8_t                     bytes[SIM_KINETIS_FRAME_LEN];
+    uint32_t                    count;
+    size_t                      from;
+    size_t                      index;
+    uint8_t                     type;
+
+    for(type = 0; type < sizeof(types); type++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(types[type]);
+
+        cfg.notify_interval_ms = 200;
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(60)));
+
+    from = sim_kinetis_frame_count();
+    for(count = 0; count < TEST_FUZZ_FRAMES; count++)
+    {
+        const uint8_t len = test_fuzz_frame(bytes);
+
+        while(sim_kinetis_send_raw(bytes, len) == false)
+        {
+            sim_run_for(TEST_FUZZ_GAP_US);
+        }
+        sim_run_for(TEST_FUZZ_GAP_US);
+    }
+    sim_run_for(SIM_S(1));
+    TEST_ASSERT(sim_kinetis_pending() == 0);
+
+    memset(errors, 0, sizeof(errors));
+    for(index = from; (p_frame = sim_kinetis_find(DATA_ID_RESPONSE_ERROR, 0xFF, &index)) != NULL; index++)
+    {
+        if(p_frame->frame.field_id <= RESPONSE_ERROR_REJECTED)
+        {
+            errors[p_frame->frame.field_id]++;
+        }
+    }
+    printf("  %u frames, rejected: frame %u, data id %u, field %u, operation %u, length %u, value %u, not idle %u, rejected %u\n",
+           TEST_FUZZ_FRAMES, errors[RESPONSE_ERROR_FRAME], errors[RESPONSE_ERROR_DATA_ID], errors[RESPONSE_ERROR_FIELD_ID],
+           errors[RESPONSE_ERROR_OPERATION], errors[RESPONSE_ERROR_LENGTH], errors[RESPONSE_ERROR_VALUE],
+           errors[RESPONSE_ERROR_NOT_IDLE], errors[RESPONSE_ERROR_REJECTED]);
+    TEST_ASSERT(errors[RESPONSE_ERROR_FIELD_ID] > 0);
+    TEST_ASSERT(errors[RESPONSE_ERROR_LENGTH] > 0);
+
+    // Valid command is still served and every sensor keeps streaming.
+    from = sim_kinetis_frame_count();
+    TEST_ASSERT(sim_kinetis_send(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, OPERATION_V1(OPERATION_READ, 0), NULL, 0));
+    TEST_ASSERT(sim_kinetis_wait(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, from, SIM_S(2)) != NULL);
+
+    sim_run_for(SIM_S(5));
+    for(type = 0; type < sizeof(types); type++)
+    {
+        TEST_ASSERT_MSG(sim_fixture_count_frames(types[type], FIELD_ID_CHAR_SENSOR_DATA_R, from) > 0, "type %u stopped", types[type]);
+    }
+}
@@ -0,0 +1,138 @@
+/** @file   test_spi_irq.c
+ *  @brief  SPI interrupt handler only queues received frames: its duration, and
+ *          commands racing with CSN while sensors stream.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_softdevice.h"
+#include "spi_slave_config.h"
+
+#define TEST_IRQ_QUIET        3
+#define TEST_IRQ_STREAMING    2
+
+/**@brief Sensors answering commands, they send no values so responses are not overwritten. */
+static const data_id_t test_irq_quiet[TEST_IRQ_QUIET]         = { DATA_ID_DEV_HTU, DATA_ID_DEV_LIGHT, DATA_ID_DEV_SOUND };
+static const data_id_t test_irq_streaming[TEST_IRQ_STREAMING] = { DATA_ID_DEV_GYRO, DATA_ID_DEV_BRIDGE };
+
+static void test_irq_setup(uint32_t notify_interval_ms)
+{
+    uint8_t index;
+
+    for(index = 0; index < TEST_IRQ_QUIET; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(test_irq_quiet[index]);
+
+        cfg.notify_interval_ms = 0;
+        (void)sim_sensor_add(&cfg);
+    }
+    for(index = 0; index < TEST_IRQ_STREAMING; index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(test_irq_streaming[index]);
+
+        cfg.notify_interval_ms = notify_interval_ms;
+        (void)sim_sensor_add(&cfg);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(60)));
+}
+
+/**@brief Send read or LED write to every quiet sensor at once, then wait for all answers.
+ *
+ * @return Number of commands answered.
+ */
+
+static uint32_t test_irq_round(uint32_t round)
+{
+    const bool    write    = (round % 2) != 0;
+    const uint8_t led      = (uint8_t)(round % 4 < 2);
+    const uint8_t field    = write ? FIELD_ID_CHAR_SENSOR_LED_STATE : FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY;
+    const uint8_t answer   = write ? FIELD_ID_SENSOR_WRITE_OK : FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY;
+    const size_t  from     = sim_kinetis_frame_count();
+    uint32_t      answered = 0;
+    uint8_t       index;
+
+    for(index = 0; index < TEST_IRQ_QUIET; index++)
+    {
+        TEST_ASSERT(sim_kinetis_send(test_irq_quiet[index], field,
+                                     OPERATION_V1(write ? OPERATION_WRITE : OPERATION_READ, write ? 1 : 0),
+                                     &led, write ? 1 : 0));
+    }
+    for(index = 0; index < TEST_IRQ_QUIET; index++)
+    {
+        if(sim_kinetis_wait(test_irq_quiet[index], answer, from, SIM_S(1)) != NULL)
+        {
+            answered++;
+        }
+    }
+    return answered;
+}
+
+TEST(spi_irq_does_not_call_softdevice)
+{
+    const sim_cpu_t * p_cpu = sim_cpu();
+    uint32_t          round;
+
+    test_irq_setup(100);
+
+    sim_cpu_reset();
+    sim_softdevice_stats_reset();
+    for(round = 0; round < 100; round++)
+    {
+        TEST_ASSERT_MSG(test_irq_round(round) == TEST_IRQ_QUIET, "round %u not answered", round);
+    }
+
+    printf("  SPI irq: %u runs, %.0f ns average, %llu ns longest; SoftDevice irq: %.0f ns average, %llu ns longest\n",
+           p_cpu->isr_count[SIM_IRQ_SPI1], (double)p_cpu->isr_ns[SIM_IRQ_SPI1] / p_cpu->isr_count[SIM_IRQ_SPI1],
+           (unsigned long long)p_cpu->isr_max_ns[SIM_IRQ_SPI1],
+           (double)p_cpu->isr_ns[SIM_IRQ_SWI2] / p_cpu->isr_count[SIM_IRQ_SWI2],
+           (unsigned long long)p_cpu->isr_max_ns[SIM_IRQ_SWI2]);
+
+    // Commands reached sensors from the main loop only.
+    TEST_ASSERT(sim_softdevice_stats()->gattc_requests >= (100 * TEST_IRQ_QUIET));
+    TEST_ASSERT(sim_softdevice_stats()->gattc_from_spi_irq == 0);
+}
+
+TEST(spi_commands_survive_csn_race)
+{
+    sim_kinetis_cfg_t cfg = sim_kinetis_default_cfg();
+    uint32_t          answered = 0;
+    uint32_t          rounds   = 0;
+    size_t            from;
+    uint64_t          end;
+    uint8_t           index;
+
+    test_irq_setup(20);
+    sim_kinetis_link_enable();
+    sim_run_for(SIM_MS(10));
+    TEST_ASSERT(sim_kinetis_link_enabled());
+
+    // Host pulls CSN low right after main loop sampled it high, as often as it can.
+    cfg.csn_race = 0.5;
+    sim_kinetis_set_cfg(&cfg);
+
+    from = sim_kinetis_frame_count();
+    end  = sim_now() + SIM_S(30);
+    while(sim_now() < end)
+    {
+        answered += test_irq_round(rounds);
+        rounds++;
+    }
+    printf("  %u of %u commands answered, %u frames, %u transactions ignored\n", answered, rounds * TEST_IRQ_QUIET,
+           sim_kinetis_stats()->frames, sim_kinetis_stats()->ignored);
+
+    TEST_ASSERT(answered == (rounds * TEST_IRQ_QUIET));
+    TEST_ASSERT(sim_kinetis_stats()->crc_errors == 0);
+    TEST_ASSERT(sim_kinetis_stats()->abandoned == 0);
+    TEST_ASSERT(spi_get_link_counters()->crc_errors == 0);
+
+    // Values streamed meanwhile are intact.
+    for(index = 0; index < TEST_IRQ_STREAMING; index++)
+    {
+        TEST_ASSERT_MSG(sim_fixture_check_values(test_irq_streaming[index], from) > 100, "type %u stopped", test_irq_streaming[index]);
+    }
+}
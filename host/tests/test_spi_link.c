@@ -0,0 +1,80 @@
+/** @file   test_spi_link.c
+ *  @brief  SPI link layer with bit errors injected on MOSI and MISO: CRC rejects
+ *          corrupted frames on both sides and retransmission recovers them.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "spi_slave_config.h"
+
+#define TEST_LINK_BER         2e-4
+#define TEST_LINK_WINDOW_US   SIM_S(20)
+
+static const data_id_t test_link_streaming[] = { DATA_ID_DEV_GYRO, DATA_ID_DEV_BRIDGE };
+
+TEST(spi_link_recovers_bit_errors)
+{
+    const spi_link_counters_t * p_link = spi_get_link_counters();
+    sim_kinetis_cfg_t           cfg    = sim_kinetis_default_cfg();
+    sim_sensor_cfg_t            quiet  = sim_sensor_default_cfg(DATA_ID_DEV_HTU);
+    uint32_t                    answered = 0;
+    uint32_t                    reads    = 0;
+    size_t                      from;
+    uint64_t                    end;
+    uint8_t                     index;
+
+    quiet.notify_interval_ms = 0;
+    (void)sim_sensor_add(&quiet);
+    for(index = 0; index < sizeof(test_link_streaming); index++)
+    {
+        sim_sensor_cfg_t streaming = sim_sensor_default_cfg(test_link_streaming[index]);
+
+        streaming.notify_interval_ms = 20;
+        (void)sim_sensor_add(&streaming);
+    }
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(60)));
+
+    sim_kinetis_link_enable();
+    sim_run_for(SIM_MS(10));
+    TEST_ASSERT(sim_kinetis_link_enabled());
+
+    cfg.bit_error_rate = TEST_LINK_BER;
+    sim_kinetis_set_cfg(&cfg);
+
+    // Commands and their answers cross the noisy bus too.
+    from = sim_kinetis_frame_count();
+    end  = sim_now() + TEST_LINK_WINDOW_US;
+    while(sim_now() < end)
+    {
+        const size_t round_from = sim_kinetis_frame_count();
+
+        TEST_ASSERT(sim_kinetis_send(DATA_ID_DEV_HTU, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, OPERATION_V1(OPERATION_READ, 0), NULL, 0));
+        reads++;
+        if(sim_kinetis_wait(DATA_ID_DEV_HTU, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, round_from, SIM_S(1)) != NULL)
+        {
+            answered++;
+        }
+    }
+    printf("  %u bits flipped; host: %u crc errors, %u retransmits; firmware: %u crc errors, %u retransmits\n",
+           sim_kinetis_stats()->bits_flipped, sim_kinetis_stats()->crc_errors, sim_kinetis_stats()->retransmits,
+           p_link->crc_errors, p_link->retransmits);
+
+    TEST_ASSERT(answered == reads);
+    TEST_ASSERT(sim_kinetis_stats()->crc_errors > 0);
+    TEST_ASSERT(sim_kinetis_stats()->retransmits > 0);
+    TEST_ASSERT(sim_kinetis_stats()->abandoned == 0);
+    TEST_ASSERT(p_link->crc_errors > 0);
+    TEST_ASSERT(p_link->retransmits > 0);
+    TEST_ASSERT(p_link->abandoned == 0);
+
+    // No corrupted value passed CRC check of the host.
+    for(index = 0; index < sizeof(test_link_streaming); index++)
+    {
+        TEST_ASSERT_MSG(sim_fixture_check_values(test_link_streaming[index], from) > 50, "type %u stopped", test_link_streaming[index]);
+    }
+}
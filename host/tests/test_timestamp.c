@@ -0,0 +1,131 @@
+/** @file   test_timestamp.c
+ *  @brief  Stamps of sensor data decoded by the host across RTC1 wraparound and
+ *          sync_id wraparound, and histogram of queueing delay derived from them.
+ */
+
+/* -- Includes -- */
+
+#include <stdio.h>
+#include <string.h>
+#include "test.h"
+#include "sim_fixture.h"
+#include "sim_timer.h"
+#include "timestamp.h"
+#include "app_timer.h"
+
+#define TEST_STAMP_RTC_WRAP        (1UL << 24)
+#define TEST_STAMP_WRAP_AFTER_S    45                  /**< Between two periodic syncs. */
+#define TEST_STAMP_WINDOW_US       SIM_S(540)          /**< Longer than 16 sync periods, sync_id wraps. */
+#define TEST_STAMP_TOLERANCE_US    SIM_MS(2)           /**< Stamp unit, and sync frame delay of the reference. */
+#define TEST_STAMP_BUCKETS         8
+
+static const data_id_t test_stamp_types[] = { DATA_ID_DEV_HTU, DATA_ID_DEV_GYRO, DATA_ID_DEV_BRIDGE };
+
+/**@brief Upper bounds of queueing delay histogram buckets, last one is open. */
+static const uint32_t  test_stamp_bucket_ms[TEST_STAMP_BUCKETS - 1] = { 1, 2, 5, 10, 20, 50, 100 };
+
+typedef struct
+{
+    sim_kinetis_frame_t  sync;                         /**< Reference, log entries move as log grows. */
+    const sim_sensor_t * p_sensors[sizeof(test_stamp_types)];
+    int64_t              last[sizeof(test_stamp_types)];
+    uint32_t             values;
+    uint32_t             syncs;
+    uint32_t             histogram[TEST_STAMP_BUCKETS];
+}
+test_stamp_t;
+
+/**@brief Check stamp of every DATA_R frame as it is received, history of sensor values is short. */
+
+static void test_stamp_on_frame(const sim_kinetis_frame_t * p_frame, void * p_ctx)
+{
+    test_stamp_t * p_test = p_ctx;
+    uint64_t       generated;
+    int64_t        stamp;
+    uint8_t        bucket;
+    uint8_t        index;
+    uint8_t        len;
+
+    if( (p_frame->frame.data_id == DATA_ID_DEV_CENTRAL) && (p_frame->frame.field_id == FIELD_ID_TIME_SYNC) )
+    {
+        p_test->syncs++;
+        return;
+    }
+    if(p_frame->frame.field_id != FIELD_ID_CHAR_SENSOR_DATA_R)
+    {
+        return;
+    }
+    for(index = 0; index < sizeof(test_stamp_types); index++)
+    {
+        if(p_frame->frame.data_id == test_stamp_types[index])
+        {
+            break;
+        }
+    }
+    TEST_ASSERT(index < sizeof(test_stamp_types));
+    TEST_ASSERT_MSG(p_frame->stamped, "type %u value not stamped", p_frame->frame.data_id);
+
+    len       = sensors_get_msg_size(p_frame->frame.data_id, FIELD_ID_CHAR_SENSOR_DATA_R);
+    generated = sim_sensor_value_time(p_test->p_sensors[index], sim_sensor_value_seq(p_frame->frame.data, len));
+    stamp     = sim_fixture_stamp_time(&p_test->sync, p_frame);
+    TEST_ASSERT(generated != 0);
+
+    // Stamp lies between generation on the sensor and reception by the host, in order.
+    TEST_ASSERT_MSG(stamp + (int64_t)TEST_STAMP_TOLERANCE_US >= (int64_t)generated,
+                    "type %u stamped at %lld, generated at %llu", p_frame->frame.data_id, (long long)stamp, (unsigned long long)generated);
+    TEST_ASSERT_MSG(stamp <= (int64_t)(p_frame->time + TEST_STAMP_TOLERANCE_US),
+                    "type %u stamped at %lld, received at %llu", p_frame->frame.data_id, (long long)stamp, (unsigned long long)p_frame->time);
+    TEST_ASSERT(stamp >= p_test->last[index]);
+    p_test->last[index] = stamp;
+    p_test->values++;
+
+    for(bucket = 0; bucket < (TEST_STAMP_BUCKETS - 1); bucket++)
+    {
+        if((int64_t)p_frame->time - stamp < (int64_t)SIM_MS(test_stamp_bucket_ms[bucket]))
+        {
+            break;
+        }
+    }
+    p_test->histogram[bucket]++;
+}
+
+TEST(timestamp_wraps_with_rtc_and_sync_id)
+{
+    static test_stamp_t test;
+    uint8_t             index;
+
+    memset(&test, 0, sizeof(test));
+    for(index = 0; index < sizeof(test_stamp_types); index++)
+    {
+        sim_sensor_cfg_t cfg = sim_sensor_default_cfg(test_stamp_types[index]);
+
+        cfg.notify_interval_ms = 300;
+        test.p_sensors[index]  = sim_sensor_add(&cfg);
+    }
+
+    // RTC1 counter wraps while sensors stream, halfway between two sync frames.
+    sim_timer_set_rtc_offset(TEST_STAMP_RTC_WRAP - (TEST_STAMP_WRAP_AFTER_S * APP_TIMER_CLOCK_FREQ));
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(40)));
+
+    sim_kinetis_link_enable();
+    sim_run_for(SIM_MS(10));
+    TEST_ASSERT(sim_kinetis_link_enabled());
+
+    test.sync = *sim_fixture_time_sync();
+    sim_kinetis_set_handler(test_stamp_on_frame, &test);
+    sim_run_for(TEST_STAMP_WINDOW_US);
+    sim_kinetis_set_handler(NULL, NULL);
+
+    printf("  %u values, %u sync frames; queueing delay:", test.values, test.syncs);
+    for(index = 0; index < (TEST_STAMP_BUCKETS - 1); index++)
+    {
+        printf(" <%ums %u,", test_stamp_bucket_ms[index], test.histogram[index]);
+    }
+    printf(" more %u\n", test.histogram[TEST_STAMP_BUCKETS - 1]);
+
+    TEST_ASSERT(sim_now() > SIM_S(TEST_STAMP_WRAP_AFTER_S));
+    TEST_ASSERT(test.syncs > (TIMESTAMP_SYNC_ID_MASK + 1));
+    TEST_ASSERT(test.values > 1000);
+}
@@ -0,0 +1,79 @@
+/** @file   test_value_cache.c
+ *  @brief  Cached reads answered by the master without GATT traffic, maximum age,
+ *          and invalidation on write.
+ */
+
+/* -- Includes -- */
+
+#include "test.h"
+#include "sim_fixture.h"
+
+#define TEST_CACHE_LOCAL_US    SIM_MS(20)         /**< Answer from cache does not wait for connection event. */
+
+/**@brief Send read of field, cached with maximum age or plain if it is 0, and wait for the answer.
+ *
+ * @return Time it took.
+ */
+
+static uint64_t test_cache_read(data_id_t type, uint8_t field, uint16_t max_age_ms)
+{
+    const uint64_t              start = sim_now();
+    const size_t                from  = sim_kinetis_frame_count();
+    const sim_kinetis_frame_t * p_frame;
+
+    if(max_age_ms != 0)
+    {
+        TEST_ASSERT(sim_kinetis_send(type, field, OPERATION_V1(OPERATION_READ_CACHED, sizeof(max_age_ms)),
+                                     (const uint8_t *)&max_age_ms, sizeof(max_age_ms)));
+    }
+    else
+    {
+        TEST_ASSERT(sim_kinetis_send(type, field, OPERATION_V1(OPERATION_READ, 0), NULL, 0));
+    }
+    p_frame = sim_kinetis_wait(type, field, from, SIM_S(1));
+    TEST_ASSERT_MSG(p_frame != NULL, "type %u field %u not answered", type, field);
+    return p_frame->time - start;
+}
+
+TEST(value_cache_answers_locally)
+{
+    sim_sensor_cfg_t           cfg     = sim_sensor_default_cfg(DATA_ID_DEV_GYRO);
+    const sim_sensor_stats_t * p_stats;
+    sim_sensor_t             * p_gyro;
+    const uint8_t              led     = 1;
+    uint32_t                   reads;
+    size_t                     from;
+
+    cfg.notify_interval_ms = 100;
+    p_gyro  = sim_sensor_add(&cfg);
+    p_stats = sim_sensor_stats(p_gyro);
+    sim_fixture_boot();
+    sim_fixture_run();
+    TEST_ASSERT(sim_fixture_wait_all_running(SIM_S(60)));
+    sim_run_for(SIM_S(5));
+
+    // Value seen in notification is served without asking the sensor.
+    reads = p_stats->att_reads;
+    from  = sim_kinetis_frame_count();
+    TEST_ASSERT(test_cache_read(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_DATA_R, 500) < TEST_CACHE_LOCAL_US);
+    TEST_ASSERT(p_stats->att_reads == reads);
+    TEST_ASSERT(sim_fixture_check_values(DATA_ID_DEV_GYRO, from) > 0);
+
+    // Field never notified is read once, then served from cache.
+    TEST_ASSERT(test_cache_read(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, 0) > TEST_CACHE_LOCAL_US);
+    TEST_ASSERT(p_stats->att_reads == (reads + 1));
+    TEST_ASSERT(test_cache_read(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, 5000) < TEST_CACHE_LOCAL_US);
+    TEST_ASSERT(p_stats->att_reads == (reads + 1));
+
+    // Value older than maximum age goes to the sensor.
+    sim_run_for(SIM_MS(600));
+    TEST_ASSERT(test_cache_read(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, 500) > TEST_CACHE_LOCAL_US);
+    TEST_ASSERT(p_stats->att_reads == (reads + 2));
+
+    // Write drops cached values of the sensor.
+    from = sim_kinetis_frame_count();
+    TEST_ASSERT(sim_kinetis_send(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_LED_STATE, OPERATION_V1(OPERATION_WRITE, 1), &led, 1));
+    TEST_ASSERT(sim_kinetis_wait(DATA_ID_DEV_GYRO, FIELD_ID_SENSOR_WRITE_OK, from, SIM_S(1)) != NULL);
+    TEST_ASSERT(test_cache_read(DATA_ID_DEV_GYRO, FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY, 5000) > TEST_CACHE_LOCAL_US);
+    TEST_ASSERT(p_stats->att_reads == (reads + 3));
+}
@@ -0,0 +1,226 @@
+
+/** @file   adv_ingest.c
+ *  @brief  Forwarding of sensor data carried in advertising packets
+ *          without connecting to the sensor.
+ */
+
+/* -- Includes -- */
+
+#include "adv_ingest.h"
+#include "client_handling.h"
+#include "spi_slave_config.h"
+#include "value_cache.h"
+#include "stats.h"
+#include "sensor_slots.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+#define ADV_INGEST_SENSORS_NUM   SENSOR_SLOTS_SENSORS_NUM                      /**< One entry per configured sensor, see sensor_slots_sensor_index(). */
+#define ADV_INGEST_FIXED_SIZE    (3 + 4 + 2 + 2 + ADV_DATA_HEADER_SIZE)         /**< Flags, Relayr service UUID, headers of name and manufacturer specific AD fields, field header. */
+
+_Static_assert(ADV_INGEST_SENSORS_NUM <= 32, "Sensors do not fit ingest bitmasks");
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Extern variables. */
+
+extern const uint8_t  SENSORS_DEVICE_NAME[MAX_CLIENTS][BLE_DEVNAME_MAX_LEN + 1];
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static uint32_t  adv_ingest_enabled;                       /**< Bit n set if ingest of sensor n is enabled. */
+static uint32_t  adv_ingest_seq_valid;                     /**< Bit n set if sequence number of sensor n was received. */
+static uint8_t   adv_ingest_seq[ADV_INGEST_SENSORS_NUM];   /**< Sequence number of last forwarded value. */
+static uint8_t   adv_ingest_addr[ADV_INGEST_SENSORS_NUM][BLE_GAP_ADDR_LEN];  /**< Address of sensor whose values are forwarded, valid with sequence number. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns bit of sensor in ingest bitmasks.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    Bit of sensor, 0 if data ID is not sensor or instance has no slot.
+ */
+
+static uint32_t adv_ingest_bit(data_id_t data_id)
+{
+    const uint8_t index = sensor_slots_sensor_index(data_id);
+
+    if(index == ADV_INGEST_SENSORS_NUM)
+    {
+        return 0;
+    }
+    return (1UL << index);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if data of sensor type fits one legacy advertising packet. Complete name
+ *        is needed in the same packet, see on_ble_evt(), so that sensor type can be found.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    true if sensor type can carry its data in advertising packets, otherwise false.
+ */
+
+static bool adv_ingest_fits(data_id_t data_id)
+{
+    const data_id_t type      = DATA_ID_GET_TYPE(data_id);
+    const uint8_t   value_len = sensors_get_msg_size(type, FIELD_ID_CHAR_SENSOR_DATA_R);
+
+    return ( (value_len != 0) &&
+             ((ADV_INGEST_FIXED_SIZE + strlen((const char *)SENSORS_DEVICE_NAME[type]) + value_len) <= BLE_GAP_ADV_MAX_SIZE) );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes advertising ingest.
+ */
+
+void adv_ingest_init(void)
+{
+    adv_ingest_enabled   = 0;
+    adv_ingest_seq_valid = 0;
+    memset(adv_ingest_seq, 0, sizeof(adv_ingest_seq));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function enables or disables ingest of sensor. Called from main loop. Sensor type whose
+ *        data does not fit advertising packet can not be enabled, e.g. GYRO, LIGHT and BRIDGE.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ * @param[in] enable   true to forward data from advertising packets instead of connecting sensor.
+ *
+ * @return    false if data ID is not sensor or sensor type can not be enabled, otherwise true.
+ */
+
+bool adv_ingest_enable(data_id_t data_id, bool enable)
+{
+    const uint32_t bit = adv_ingest_bit(data_id);
+    client_t *     p_client;
+
+    if( (bit == 0) ||
+        (enable && (adv_ingest_fits(data_id) == false)) )
+    {
+        return false;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if(enable)
+    {
+        adv_ingest_enabled |= bit;
+
+        // Sensor is served without connection from now on.
+        p_client = find_client_by_data_id(data_id);
+        if( (p_client != NULL) && (p_client->state != STATE_ERROR) && (p_client->state != STATE_DISCONNECTING) )
+        {
+            client_handling_disconnect(p_client);
+        }
+    }
+    else
+    {
+        adv_ingest_enabled &= ~bit;
+    }
+    adv_ingest_seq_valid &= ~bit;
+
+    CRITICAL_REGION_EXIT();
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if ingest of sensor is enabled.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    true if sensor is not connected and its data is taken from advertising packets.
+ */
+
+bool adv_ingest_is_enabled(data_id_t data_id)
+{
+    return ((adv_ingest_enabled & adv_ingest_bit(data_id)) != 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if ingest is enabled for any sensor.
+ *
+ * @return    true if ingest is enabled for any sensor, otherwise false.
+ */
+
+bool adv_ingest_active(void)
+{
+    return (adv_ingest_enabled != 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function forwards sensor data from manufacturer specific AD field, as if it was notification
+ *        of sensor data characteristic. Repeated packets with the same sequence number are dropped.
+ *        Sensors which are not bound to instance all resolve to the same free instance, so instance
+ *        forwards values of the first sensor it received value from, until ingest is enabled again.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ * @param[in] p_addr   Address of sensor.
+ * @param[in] p_data   Content of AD field.
+ * @param[in] len      Length of AD field content.
+ *
+ * @return    true if new value was forwarded, false if field is not valid or value was already forwarded.
+ */
+
+bool adv_ingest_process(data_id_t data_id, const ble_gap_addr_t * p_addr, const uint8_t * p_data, uint8_t len)
+{
+    const uint32_t bit = adv_ingest_bit(data_id);
+    const uint8_t  index = sensor_slots_sensor_index(data_id);
+    uint8_t        value_len;
+
+    if((adv_ingest_enabled & bit) == 0)
+    {
+        return false;
+    }
+
+    value_len = sensors_get_msg_size(DATA_ID_GET_TYPE(data_id), FIELD_ID_CHAR_SENSOR_DATA_R);
+    if( (value_len == 0) ||
+        (len != (ADV_DATA_HEADER_SIZE + value_len)) ||
+        (p_data[0] != (ADV_DATA_COMPANY_ID & 0xFF)) ||
+        (p_data[1] != (ADV_DATA_COMPANY_ID >> 8)) )
+    {
+        return false;
+    }
+
+    if((adv_ingest_seq_valid & bit) != 0)
+    {
+        // Other sensor of the same type would mix its sequence numbers and values in.
+        if( (memcmp(adv_ingest_addr[index], p_addr->addr, BLE_GAP_ADDR_LEN) != 0) ||
+            (adv_ingest_seq[index] == p_data[2]) )
+        {
+            return false;
+        }
+    }
+    else
+    {
+        memcpy(adv_ingest_addr[index], p_addr->addr, BLE_GAP_ADDR_LEN);
+    }
+    adv_ingest_seq[index] = p_data[2];
+    adv_ingest_seq_valid |= bit;
+
+    stats_count_adv_ingest();
+    value_cache_store(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, &p_data[ADV_DATA_HEADER_SIZE], value_len);
+    spi_create_tx_packet(data_id, FIELD_ID_CHAR_SENSOR_DATA_R, OPERATION_WRITE, (uint8_t *)&p_data[ADV_DATA_HEADER_SIZE], value_len);
+
+    return true;
+}
@@ -0,0 +1,57 @@
+
+/** @file   adv_ingest.h
+ *  @brief  Forwarding of sensor data carried in advertising packets
+ *          without connecting to the sensor.
+ */
+
+#ifndef ADV_INGEST_H__
+#define ADV_INGEST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wunderbar_common.h"
+#include "ble_gap.h"
+
+/** @brief  Initialize advertising ingest. Ingest is disabled for all sensors.
+ *
+ *  @return Void.
+ */
+void adv_ingest_init(void);
+
+/** @brief  Enable or disable ingest of sensor. Connected sensor is disconnected when ingest is enabled.
+ *          Only sensor types whose data fits one advertising packet with sensor name can be enabled.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *  @param  enable   true to forward data from advertising packets instead of connecting sensor.
+ *
+ *  @return false if data ID is not sensor or sensor type can not be enabled, otherwise true.
+ */
+bool adv_ingest_enable(data_id_t data_id, bool enable);
+
+/** @brief  Check if ingest of sensor is enabled.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *
+ *  @return true if sensor is not connected and its data is taken from advertising packets.
+ */
+bool adv_ingest_is_enabled(data_id_t data_id);
+
+/** @brief  Check if ingest is enabled for any sensor, so that scanning shall not be stopped.
+ *
+ *  @return true if ingest is enabled for any sensor, otherwise false.
+ */
+bool adv_ingest_active(void);
+
+/** @brief  Forward sensor data from manufacturer specific AD field. Called from BLE event handler.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *  @param  p_addr   Address of sensor.
+ *  @param  p_data   Content of AD field, see ADV_DATA_COMPANY_ID.
+ *  @param  len      Length of AD field content.
+ *
+ *  @return true if new value was forwarded, false if field is not valid, value was already forwarded
+ *          or instance forwards values of other sensor.
+ */
+bool adv_ingest_process(data_id_t data_id, const ble_gap_addr_t * p_addr, const uint8_t * p_data, uint8_t len);
+
+#endif // ADV_INGEST_H__
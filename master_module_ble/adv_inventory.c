@@ -0,0 +1,238 @@
+
+/** @file   adv_inventory.c
+ *  @brief  Inventory of seen Wunderbar advertisers,
+ *          dumpable over SPI.
+ */
+
+/* -- Includes -- */
+
+#include "adv_inventory.h"
+#include "client_handling.h"
+#include "spi_slave_config.h"
+#include "rotation.h"
+#include "adv_ingest.h"
+#include "peer_backoff.h"
+#include "timestamp.h"
+#include "stats.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+#define ADV_INVENTORY_DUMP_IDLE   (ADV_INVENTORY_SIZE + 1)   /**< Dump index when no dump is in progress. */
+#define ADV_INVENTORY_AVG_SHIFT   3                          /**< RSSI average weight of new report is 1/8. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**@brief Inventory entry. */
+typedef struct
+{
+    uint32_t        last_seen;     /**< Master time of last report. */
+    ble_gap_addr_t  addr;
+    uint8_t         data_id;
+    uint8_t         used;          /**< 0 if entry is free. */
+    int8_t          rssi_min;
+    int8_t          rssi_max;
+    int16_t         rssi_avg;      /**< Average scaled by 2^ADV_INVENTORY_AVG_SHIFT. */
+    uint16_t        count;
+}
+adv_inventory_entry_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static adv_inventory_entry_t  adv_inventory[ADV_INVENTORY_SIZE];
+static uint8_t                adv_inventory_dump_index;
+static uint8_t                adv_inventory_dump_count;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes inventory.
+ */
+
+void adv_inventory_init(void)
+{
+    memset((uint8_t *)adv_inventory, 0, sizeof(adv_inventory));
+    adv_inventory_dump_index = ADV_INVENTORY_DUMP_IDLE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records advertising report. Cost is bounded by ADV_INVENTORY_SIZE address compares.
+ *
+ * @param[in] p_addr   Address of advertiser.
+ * @param[in] data_id  Sensor type and instance, DATA_ID_ERROR if it is not known.
+ * @param[in] rssi     RSSI of report.
+ */
+
+void adv_inventory_seen(const ble_gap_addr_t * p_addr, data_id_t data_id, int8_t rssi)
+{
+    adv_inventory_entry_t * p_entry     = NULL;
+    adv_inventory_entry_t * p_oldest    = &adv_inventory[0];
+    const uint32_t          stats_start = stats_path_begin();
+    const uint32_t          now         = timestamp_now();
+    uint8_t                 cnt;
+
+    for(cnt = 0; cnt < ADV_INVENTORY_SIZE; cnt++)
+    {
+        if(adv_inventory[cnt].used == 0)
+        {
+            p_oldest = &adv_inventory[cnt];
+            break;
+        }
+        if(memcmp((uint8_t *)&adv_inventory[cnt].addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) == 0)
+        {
+            p_entry = &adv_inventory[cnt];
+            break;
+        }
+        if((now - adv_inventory[cnt].last_seen) > (now - p_oldest->last_seen))
+        {
+            p_oldest = &adv_inventory[cnt];
+        }
+    }
+
+    if(p_entry == NULL)
+    {
+        p_entry = p_oldest;
+        memcpy((uint8_t *)&p_entry->addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t));
+        p_entry->used     = 1;
+        p_entry->data_id  = DATA_ID_ERROR;
+        p_entry->rssi_min = rssi;
+        p_entry->rssi_max = rssi;
+        p_entry->rssi_avg = (int16_t)rssi << ADV_INVENTORY_AVG_SHIFT;
+        p_entry->count    = 0;
+    }
+
+    // Ignored advertisers are reported without name, keep the one seen before.
+    if(data_id != DATA_ID_ERROR)
+    {
+        p_entry->data_id = data_id;
+    }
+    if(rssi < p_entry->rssi_min)
+    {
+        p_entry->rssi_min = rssi;
+    }
+    if(rssi > p_entry->rssi_max)
+    {
+        p_entry->rssi_max = rssi;
+    }
+    p_entry->rssi_avg += rssi - (p_entry->rssi_avg >> ADV_INVENTORY_AVG_SHIFT);
+    if(p_entry->count != 0xFFFF)
+    {
+        p_entry->count++;
+    }
+    p_entry->last_seen = now;
+
+    stats_path_end(STATS_PATH_ADV_INVENTORY, stats_start);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function fills inventory record sent to the host. Shall be called from critical region.
+ *
+ * @param[in]  p_entry   Inventory entry.
+ * @param[out] p_record  Record.
+ */
+
+static void adv_inventory_fill_record(adv_inventory_entry_t * p_entry, adv_inventory_record_t * p_record)
+{
+    const uint32_t age_s    = (timestamp_now() - p_entry->last_seen) / APP_TIMER_CLOCK_FREQ;
+    client_t *     p_client = find_client_by_data_id((data_id_t)p_entry->data_id);
+
+    memcpy(p_record->addr, p_entry->addr.addr, BLE_GAP_ADDR_LEN);
+    p_record->addr_type = p_entry->addr.addr_type;
+    p_record->data_id   = p_entry->data_id;
+    p_record->rssi_min  = p_entry->rssi_min;
+    p_record->rssi_avg  = (int8_t)(p_entry->rssi_avg >> ADV_INVENTORY_AVG_SHIFT);
+    p_record->rssi_max  = p_entry->rssi_max;
+    p_record->count     = p_entry->count;
+    p_record->age_s     = (age_s > 0xFFFF) ? 0xFFFF : (uint16_t)age_s;
+
+    p_record->status = 0;
+    if(ignore_list_search(&p_entry->addr))
+    {
+        p_record->status |= ADV_INVENTORY_STATUS_IGNORED;
+    }
+    if( (p_client != NULL) &&
+        (memcmp((uint8_t *)&p_client->peer_addr, (uint8_t *)&p_entry->addr, sizeof(ble_gap_addr_t)) == 0) )
+    {
+        p_record->status |= ADV_INVENTORY_STATUS_CONNECTED;
+    }
+    if(adv_ingest_is_enabled((data_id_t)p_entry->data_id))
+    {
+        p_record->status |= ADV_INVENTORY_STATUS_INGEST;
+    }
+    if(rotation_is_parked((data_id_t)p_entry->data_id))
+    {
+        p_record->status |= ADV_INVENTORY_STATUS_PARKED;
+    }
+    if(peer_backoff_is_waiting(&p_entry->addr))
+    {
+        p_record->status |= ADV_INVENTORY_STATUS_BACKOFF;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function starts dump of inventory to the host. Dump in progress starts over.
+ */
+
+void adv_inventory_dump_start(void)
+{
+    adv_inventory_dump_index = 0;
+    adv_inventory_dump_count = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function sends next frame of dump, if dump is in progress and response frame is free.
+ *        Called from main loop on WORK_FLAG_SPI_TX, which is set when response frame was clocked out.
+ */
+
+void adv_inventory_dump_next(void)
+{
+    uint8_t data[SPI_PACKET_DATA_SIZE];
+
+    if( (adv_inventory_dump_index == ADV_INVENTORY_DUMP_IDLE) ||
+        (spi_response_is_free() == false) )
+    {
+        return;
+    }
+
+    memset(data, 0, sizeof(data));
+
+    // Inventory is updated from BLE interrupt.
+    CRITICAL_REGION_ENTER();
+
+    while( (adv_inventory_dump_index < ADV_INVENTORY_SIZE) &&
+           (adv_inventory[adv_inventory_dump_index].used == 0) )
+    {
+        adv_inventory_dump_index++;
+    }
+
+    if(adv_inventory_dump_index < ADV_INVENTORY_SIZE)
+    {
+        data[0] = adv_inventory_dump_index;
+        adv_inventory_fill_record(&adv_inventory[adv_inventory_dump_index], (adv_inventory_record_t *)&data[1]);
+        adv_inventory_dump_index++;
+        adv_inventory_dump_count++;
+    }
+    else
+    {
+        data[0] = ADV_INVENTORY_END;
+        data[1] = adv_inventory_dump_count;
+        adv_inventory_dump_index = ADV_INVENTORY_DUMP_IDLE;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    spi_create_tx_packet(DATA_ID_DEV_CENTRAL, FIELD_ID_INVENTORY, OPERATION_READ, data, sizeof(data));
+}
@@ -0,0 +1,72 @@
+
+/** @file   adv_inventory.h
+ *  @brief  Inventory of seen Wunderbar advertisers,
+ *          dumpable over SPI.
+ */
+
+#ifndef ADV_INVENTORY_H__
+#define ADV_INVENTORY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+#include "wunderbar_common.h"
+
+#define ADV_INVENTORY_SIZE              8       /**< Number of advertisers kept, least recently seen one is replaced. */
+#define ADV_INVENTORY_END               0xFF    /**< Index in last frame of dump, data[1] carries number of records. */
+
+#define ADV_INVENTORY_STATUS_IGNORED    0x01    /**< Advertiser is in ignore list. */
+#define ADV_INVENTORY_STATUS_CONNECTED  0x02    /**< Advertiser is connected. */
+#define ADV_INVENTORY_STATUS_INGEST     0x04    /**< Data of advertiser is taken from advertising packets. */
+#define ADV_INVENTORY_STATUS_PARKED     0x08    /**< Advertiser waits for its rotation slot. */
+#define ADV_INVENTORY_STATUS_BACKOFF    0x10    /**< Advertiser is held back after failed connection or pairing. */
+
+/**@brief Inventory record, sent to the host in DATA_ID_DEV_CENTRAL, FIELD_ID_INVENTORY frames.
+ *
+ * @details Dump is requested with FIELD_ID_INVENTORY config command. One frame is sent per record,
+ *          data[0] - index, data[1..] - record, as soon as response frame is free. Dump ends with
+ *          frame with index ADV_INVENTORY_END.
+ */
+typedef struct
+{
+    uint8_t   addr[BLE_GAP_ADDR_LEN];
+    uint8_t   addr_type;
+    uint8_t   data_id;     /**< Sensor type and instance, DATA_ID_ERROR if name is not valid. */
+    uint8_t   status;      /**< ADV_INVENTORY_STATUS_* flags. */
+    int8_t    rssi_min;
+    int8_t    rssi_avg;    /**< Moving average over last 8 reports. */
+    int8_t    rssi_max;
+    uint16_t  count;       /**< Number of reports, saturated. */
+    uint16_t  age_s;       /**< Seconds since last report, saturated. */
+}
+__attribute__((packed)) adv_inventory_record_t;
+
+/** @brief  Initialize inventory.
+ *
+ *  @return Void.
+ */
+void adv_inventory_init(void);
+
+/** @brief  Record advertising report. Called from BLE event handler.
+ *
+ *  @param  p_addr   Address of advertiser.
+ *  @param  data_id  Sensor type and instance, DATA_ID_ERROR if it is not known.
+ *  @param  rssi     RSSI of report.
+ *
+ *  @return Void.
+ */
+void adv_inventory_seen(const ble_gap_addr_t * p_addr, data_id_t data_id, int8_t rssi);
+
+/** @brief  Start dump of inventory to the host.
+ *
+ *  @return Void.
+ */
+void adv_inventory_dump_start(void);
+
+/** @brief  Send next frame of dump, if dump is in progress and response frame is free. Called from main loop.
+ *
+ *  @return Void.
+ */
+void adv_inventory_dump_next(void);
+
+#endif // ADV_INVENTORY_H__
@@ -17,25 +17,40 @@
 #include "spi_slave_config.h"
 #include "onboard.h"
 #include "app_error.h"
-
-#define APPL_LOG                   debug_log      /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include "stats.h"
+#include "work_flags.h"
+#include "value_cache.h"
+#include "timestamp.h"
+#include "sensor_slots.h"
+#include "rotation.h"
+#include "adv_ingest.h"
+#include "conn_manager.h"
+
+#define APPL_LOG(...)              debug_log_module(DEBUG_MODULE_CL, DEBUG_LEVEL_INFO, __VA_ARGS__)   /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#define APPL_LOG_ERROR(...)        debug_log_module(DEBUG_MODULE_CL, DEBUG_LEVEL_ERROR, __VA_ARGS__)  /**< Debug logger macro used for error messages. */
 
 #define IGNORE_LIST_NUM_OF_ENTRIES 10
+#define OPEN_LIST_NUM_OF_ENTRIES   4
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief Extern variables. */
 
 extern const ble_gap_scan_params_t * m_scan_param;   /**< Scan parameters requested for scanning and connection. */
 
-extern passkey_t        sensors_passkey[MAX_CLIENTS];
-
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief Static global variables. */
 
 client_t               m_client[MAX_CLIENTS];                              /**< Client context information list. */
 static ble_gap_addr_t  peer_addr_ignore_list[IGNORE_LIST_NUM_OF_ENTRIES];  /**< List of Bluetooth Low Energy Addresses which will be ignored. */
 static uint16_t        ignore_list_index = 0;                              /**< Index of entry in IgnoreList which will be populated next. */
+static uint8_t         open_list[OPEN_LIST_NUM_OF_ENTRIES][BLE_GAP_ADDR_LEN];  /**< Addresses of sensors which confirmed open communication, their MITM flag is not read again. */
+static uint8_t         open_list_count = 0;                                /**< Number of valid entries in open list. */
+static uint8_t         open_list_index = 0;                                /**< Index of entry in open list which will be populated next. */
 static bool            scan_start_flag = false;                            /**< State of scanning process (true if scanner running). */
+static app_timer_id_t  client_timer_id;                                    /**< Timer which checks deadlines of GATT operations. */
+static bool            client_timer_running = false;                       /**< true while any GATT operation has deadline. */
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief List of DeviceNames of sensors. */
@@ -149,6 +164,50 @@ bool ignore_list_search(ble_gap_addr_t * p_peer_addr)
     return false;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief This function adds address of sensor which confirmed open communication, oldest entry is replaced.
+ *
+ * @param p_peer_addr Bluetooth Low Energy Address to be added.
+ *
+ * @return Void.
+ */
+
+static void open_list_add(const ble_gap_addr_t * p_peer_addr)
+{
+    memcpy(open_list[open_list_index], p_peer_addr->addr, BLE_GAP_ADDR_LEN);
+    open_list_index = (open_list_index + 1) % OPEN_LIST_NUM_OF_ENTRIES;
+    if(open_list_count < OPEN_LIST_NUM_OF_ENTRIES)
+    {
+        open_list_count++;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief This function searches open list for address of sensor.
+ *
+ * @param p_peer_addr Bluetooth Low Energy Address to be searched.
+ *
+ * @return    true if sensor confirmed open communication before, other way false.
+ */
+
+static bool open_list_search(const ble_gap_addr_t * p_peer_addr)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < open_list_count; cnt++)
+    {
+        if(memcmp(open_list[cnt], p_peer_addr->addr, BLE_GAP_ADDR_LEN) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,10 +229,276 @@ uint16_t search_for_client_configuring(void)
     return cnt;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function resumes scanning if there is free link, so next sensor connects while
+ *        clients connected before are still discovered.
+ *
+ * @return Void.
+ */
+
+static void client_scan_resume(void)
+{
+    if ( (get_active_client_number() < DEVICE_MANAGER_MAX_CONNECTIONS) || adv_ingest_active() )
+    {
+        scan_start();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief This function puts client into ERROR state and schedules search_for_client_event().
+ *
+ * @param p_client  Client context information.
+ *
+ * @return Void.
+ */
+
+static void client_set_error(client_t * p_client)
+{
+    p_client->state = STATE_ERROR;
+    work_flags_set(WORK_FLAG_CLIENT_EVENT);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns deadline of GATT operation pending in client state.
+ *
+ * @param state  Client state.
+ *
+ * @return Deadline in RTC1 ticks, 0 if client does not wait for GATT response in this state.
+ */
+
+static uint32_t client_timeout_ticks(uint8_t state)
+{
+    switch(state)
+    {
+        case STATE_SERVICE_DISC:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_SERVICE_DISC_MS, APP_TIMER_PRESCALER);
+
+        case STATE_DEVICE_IDENTIFYING:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_DEVICE_IDENTIFYING_MS, APP_TIMER_PRESCALER);
+
+        case STATE_NOTIF_ENABLE:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_NOTIF_ENABLE_MS, APP_TIMER_PRESCALER);
+
+        case STATE_PREFETCH:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_PREFETCH_MS, APP_TIMER_PRESCALER);
+
+        case STATE_WAIT_READ_RSP:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_WAIT_READ_RSP_MS, APP_TIMER_PRESCALER);
+
+        case STATE_WAIT_WRITE_RSP:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_WAIT_WRITE_RSP_MS, APP_TIMER_PRESCALER);
+
+        case STATE_CONFIGURE:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_CONFIGURE_MS, APP_TIMER_PRESCALER);
+
+        case STATE_CHECK_CONFIG:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_CHECK_CONFIG_MS, APP_TIMER_PRESCALER);
+
+        case STATE_CHECK_OPEN:
+            return APP_TIMER_TICKS(CLIENT_TIMEOUT_CHECK_OPEN_MS, APP_TIMER_PRESCALER);
+
+        default:
+            return 0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function puts client into state which waits for GATT response and sets deadline of the response.
+ *
+ * @param p_client  Client context information.
+ * @param state     State of client while operation is pending.
+ *
+ * @return Void.
+ */
+
+static void client_wait(client_t * p_client, client_state_t state)
+{
+    CRITICAL_REGION_ENTER();
+
+    p_client->state       = state;
+    p_client->op_state    = state;
+    p_client->op_deadline = timestamp_now() + client_timeout_ticks(state);
+
+    if(client_timer_running == false)
+    {
+        client_timer_running = (app_timer_start(client_timer_id,
+                                                APP_TIMER_TICKS(CLIENT_TIMEOUT_CHECK_MS, APP_TIMER_PRESCALER),
+                                                NULL) == NRF_SUCCESS);
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function moves running client to state of operation requested from main loop. State is
+ *        changed before request is sent, so response handled in BLE interrupt finds it.
+ *
+ * @param p_client  Client context information.
+ * @param state     State of client while operation is pending.
+ *
+ * @return true if client was running, otherwise false.
+ */
+
+static bool client_claim(client_t * p_client, client_state_t state)
+{
+    bool claimed;
+
+    CRITICAL_REGION_ENTER();
+    claimed = (p_client->state == STATE_RUNNING);
+    if(claimed)
+    {
+        client_wait(p_client, state);
+    }
+    CRITICAL_REGION_EXIT();
+
+    return claimed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns client to running state after its request was not accepted, unless
+ *        client left the state meanwhile, e.g. because it was disconnected.
+ *
+ * @param p_client  Client context information.
+ * @param state     State set by client_claim.
+ *
+ * @return Void.
+ */
+
+static void client_release(client_t * p_client, client_state_t state)
+{
+    CRITICAL_REGION_ENTER();
+    if(p_client->state == state)
+    {
+        p_client->state = STATE_RUNNING;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Timeout handler of deadline timer. Deadlines are checked from main loop.
+ *
+ * @param[in] p_context  Not used.
+ */
+
+static void client_timer_handler(void * p_context)
+{
+    work_flags_set(WORK_FLAG_CLIENT_TIMEOUT);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function creates timer which checks deadlines of GATT operations. App timer module shall be initialized before.
+ *
+ * @return false in case error occurred, otherwise true.
+ */
+
+bool timers_init(void)
+{
+    client_timer_running = false;
+
+    return (app_timer_create(&client_timer_id, APP_TIMER_MODE_REPEATED, client_timer_handler) == NRF_SUCCESS);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks deadlines of pending GATT operations, client which missed its deadline is
+ *        disconnected. Operation is not issued again: Soft Device refuses new request while the
+ *        late one is still pending. Called from main loop on WORK_FLAG_CLIENT_TIMEOUT. Timer is
+ *        stopped once no operation is pending.
+ *
+ * @return Void.
+ */
+
+void check_client_timeout(void)
+{
+    const uint32_t now     = timestamp_now();
+    bool           waiting = false;
+    bool           expired;
+    client_t *     p_client;
+    uint8_t        cnt;
+    uint8_t        status;
+
+    for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
+    {
+        p_client = &m_client[cnt];
+        expired  = false;
+
+        // Responses are handled in BLE interrupt.
+        CRITICAL_REGION_ENTER();
+
+        if( (p_client->state == p_client->op_state) &&
+            (client_timeout_ticks(p_client->state) != 0) )
+        {
+            if((int32_t)(now - p_client->op_deadline) < 0)
+            {
+                waiting = true;
+            }
+            else
+            {
+                client_set_error(p_client);
+                expired = true;
+            }
+        }
+
+        CRITICAL_REGION_EXIT();
+
+        if(expired)
+        {
+            APPL_LOG_ERROR("[CL]: GATT operation timed out in state %d, disconnecting %s\r\n", p_client->op_state, p_client->device_name);
+            stats_count_gatt_timeout(cnt, p_client->data_id);
+
+            // Host waits for result of write.
+            if(p_client->op_state == STATE_WAIT_WRITE_RSP)
+            {
+                status = 0;
+                spi_create_tx_packet(p_client->data_id, FIELD_ID_SENSOR_WRITE_OK, OPERATION_WRITE, &status, sizeof(status));
+                spi_lock_tx_packet(p_client->data_id);
+            }
+        }
+    }
+
+    CRITICAL_REGION_ENTER();
+    if( (waiting == false) && client_timer_running )
+    {
+        // Operation may have started since its client was checked.
+        for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
+        {
+            if( (m_client[cnt].state == m_client[cnt].op_state) &&
+                (client_timeout_ticks(m_client[cnt].state) != 0) )
+            {
+                waiting = true;
+            }
+        }
+        if(waiting == false)
+        {
+            app_timer_stop(client_timer_id);
+            client_timer_running = false;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief This function checks if there is client in ERROR state. In such case disconnect request for that client sends.
+ *        Only one client is handled per call, so search is scheduled again after successful request.
  *
  * @return Void.
  */
@@ -192,6 +517,7 @@ void search_for_client_event(void)
             if(err_code == NRF_SUCCESS)
             {
                 m_client[cnt].state = STATE_DISCONNECTING;
+                work_flags_set(WORK_FLAG_CLIENT_EVENT);
             }
             if(err_code > NRF_ERROR_BUSY)
             {
@@ -203,6 +529,22 @@ void search_for_client_event(void)
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief This function requests disconnection of client, e.g. to give its link to other sensor.
+ *
+ * @param p_client  Client context information.
+ *
+ * @return Void.
+ */
+
+void client_handling_disconnect(client_t * p_client)
+{
+    APPL_LOG("[CL]: Releasing link of client %d\r\n", p_client->data_id);
+    client_set_error(p_client);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -214,7 +556,10 @@ void search_for_client_event(void)
 void scan_start(void)
 {
     uint32_t err_code;
-    if(scan_start_flag == false)
+
+    // Scanning is resumed when connection request completes.
+    if( (scan_start_flag == false) &&
+        (conn_manager_is_connecting() == false) )
     {
         err_code = sd_ble_gap_scan_start(m_scan_param);
         APPL_LOG("[CL]: Scan requested with err_code %lu\r\n\r\n", err_code);
@@ -295,6 +640,31 @@ client_t * find_client_by_dev_name(const uint8_t * device_name, uint8_t len)
     return NULL;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function for finding client context information based on sensor type and instance.
+ *
+ * @param data_id  Data ID of sensor instance.
+ *
+ * @return client context information or NULL upon failure.
+ */
+
+client_t * find_client_by_data_id(data_id_t data_id)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
+    {
+        if( (m_client[cnt].state != STATE_IDLE) &&
+            (m_client[cnt].data_id == data_id) )
+        {
+            return &m_client[cnt];
+        }
+    }
+    return NULL;
+}
+
 client_t * find_sensor_id_by_dev_name(const uint8_t * device_name)
 {
     uint8_t cnt;
@@ -347,12 +717,12 @@ ble_db_discovery_char_t * find_char_by_uuid(uint16_t char_uuid, client_t * p_cli
   uint8_t cnt_srv, cnt_chr;
   ble_db_discovery_srv_t * service;
 
-  for(cnt_srv = 0; cnt_srv < 3; cnt_srv++)
+  for(cnt_srv = 0; cnt_srv < BLE_DB_DISCOVERY_MAX_SRV; cnt_srv++)
   {
       service = &p_client->srv_db.services[cnt_srv];
       for(cnt_chr = 0; cnt_chr < service->char_count; cnt_chr++)
       {
-          if(service->charateristics[cnt_chr].characteristic.uuid.uuid == char_uuid)
+          if(service->charateristics[cnt_chr].uuid == char_uuid)
           {
               return &(service->charateristics[cnt_chr]);
           }
@@ -377,12 +747,12 @@ ble_db_discovery_char_t * find_char_by_handle_value(uint16_t handle_value, clien
   uint8_t cnt_srv, cnt_chr;
   ble_db_discovery_srv_t * service;
 
-  for(cnt_srv = 0; cnt_srv < 3; cnt_srv++)
+  for(cnt_srv = 0; cnt_srv < BLE_DB_DISCOVERY_MAX_SRV; cnt_srv++)
   {
       service = &p_client->srv_db.services[cnt_srv];
       for(cnt_chr = 0; cnt_chr < service->char_count; cnt_chr++)
       {
-          if(service->charateristics[cnt_chr].characteristic.handle_value == handle_value)
+          if(service->charateristics[cnt_chr].handle_value == handle_value)
           {
               return &(service->charateristics[cnt_chr]);
           }
@@ -413,6 +783,7 @@ static uint32_t service_discover(client_t * p_client)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief Function for handling enabling notifications. Function found "next" characteristic with notification properties, and write to proper cccd.
+ *        Only characteristics listed in SENSOR_FIELDS_NOTIFY are enabled.
  *
  * @param p_client Client context information.
  *
@@ -428,12 +799,17 @@ static bool notif_enable(client_t * p_client)
     ble_db_discovery_srv_t * service;
 
     // Search next characteristic with notification properties.
-    for(cnt_srv = p_client->srv_index; cnt_srv < 3; cnt_srv++)
+    for(cnt_srv = p_client->srv_index; cnt_srv < BLE_DB_DISCOVERY_MAX_SRV; cnt_srv++)
     {
         service = &p_client->srv_db.services[cnt_srv];
         for(cnt_chr = p_client->char_index; cnt_chr < service->char_count; cnt_chr++)
         {
-            if(service->charateristics[cnt_chr].characteristic.char_props.notify == 1)
+            const uint8_t field_id = service->charateristics[cnt_chr].field_id;
+
+            if((service->charateristics[cnt_chr].char_props.notify == 1) &&
+               (service->charateristics[cnt_chr].cccd_handle != BLE_GATT_HANDLE_INVALID) &&
+               (field_id <= FIELD_ID_CHAR_FIRMWARE_REVISION) &&
+               ((SENSOR_FIELDS_NOTIFY & SENSOR_FIELD(field_id)) != 0))
             {
                 buf[0] = BLE_GATT_HVX_NOTIFICATION;
                 buf[1] = 0;
@@ -443,11 +819,11 @@ static bool notif_enable(client_t * p_client)
                 write_params.offset   = 0;
                 write_params.len      = sizeof(buf);
                 write_params.p_value  = buf;
-                APPL_LOG("[CL]: Request Notification Enable for %02x Characteristic\r\n", service->charateristics[cnt_chr].characteristic.uuid.uuid);
+                APPL_LOG("[CL]: Request Notification Enable for %02x Characteristic\r\n", service->charateristics[cnt_chr].uuid);
                 err_code = sd_ble_gattc_write(p_client->srv_db.conn_handle, &write_params);
                 APP_ERROR_CHECK(err_code);
 
-                p_client->state = STATE_NOTIF_ENABLE;
+                client_wait(p_client, STATE_NOTIF_ENABLE);
                 p_client->srv_index  = cnt_srv;
                 p_client->char_index = cnt_chr + 1;
                 return true;
@@ -459,6 +835,196 @@ static bool notif_enable(client_t * p_client)
     return false;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function stores device information or battery level of client. Strings are stored only
+ *        while prefetching, when they are read once in field order.
+ *
+ * @param p_client  Client context information.
+ * @param field_id  Field ID of characteristic.
+ * @param data      Value.
+ * @param len       Value length.
+ *
+ * @return Void.
+ */
+
+static void client_info_store(client_t * p_client, uint8_t field_id, const uint8_t * data, uint16_t len)
+{
+    client_info_t * p_info = &p_client->info;
+    uint8_t         offset = 0;
+    uint8_t         cnt;
+
+    if(field_id == FIELD_ID_CHAR_BATTERY_LEVEL)
+    {
+        if(len == sizeof(p_info->battery_level))
+        {
+            p_info->battery_level = data[0];
+            p_info->battery_ticks = timestamp_now();
+            p_info->valid        |= 1;
+        }
+        return;
+    }
+
+    if( (field_id < FIELD_ID_CHAR_MANUFACTURER_NAME) ||
+        (field_id > FIELD_ID_CHAR_FIRMWARE_REVISION) )
+    {
+        return;
+    }
+
+    // Offset of string depends on lengths of strings before it, which are final only once prefetch
+    // passed them. String read later on demand, e.g. after its prefetch failed, would overwrite
+    // strings which follow it, so it is not stored.
+    if(p_client->state != STATE_PREFETCH)
+    {
+        return;
+    }
+
+    // Strings are read once, in field order, so each one follows previous ones.
+    field_id -= FIELD_ID_CHAR_MANUFACTURER_NAME;
+    for(cnt = 0; cnt < field_id; cnt++)
+    {
+        offset += p_info->len[cnt];
+    }
+
+    // String which does not fit is read from the sensor on demand.
+    if( ((p_info->valid & (2 << field_id)) != 0) ||
+        ((offset + len) > CLIENT_INFO_DATA_SIZE) )
+    {
+        return;
+    }
+
+    memcpy(&p_info->data[offset], data, len);
+    p_info->len[field_id] = (uint8_t)len;
+    p_info->valid        |= (2 << field_id);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns prefetched device information or battery level of client.
+ *        Battery level older than BATTERY_LEVEL_MEAS_INTERVAL is not returned.
+ *
+ * @param p_client  Client context information.
+ * @param field_id  Field ID of characteristic.
+ * @param data      Destination buffer, at least SPI_PACKET_DATA_SIZE bytes long.
+ * @param p_len     Value length.
+ *
+ * @return    true if value is stored, otherwise false.
+ */
+
+bool client_info_get(client_t * p_client, uint8_t field_id, uint8_t * data, uint8_t * p_len)
+{
+    client_info_t * p_info = &p_client->info;
+    uint8_t         offset = 0;
+    uint8_t         cnt;
+
+    if( (field_id < FIELD_ID_CHAR_BATTERY_LEVEL) ||
+        (field_id > FIELD_ID_CHAR_FIRMWARE_REVISION) ||
+        ((p_info->valid & (1 << (field_id - FIELD_ID_CHAR_BATTERY_LEVEL))) == 0) )
+    {
+        return false;
+    }
+
+    if(field_id == FIELD_ID_CHAR_BATTERY_LEVEL)
+    {
+        if((timestamp_now() - p_info->battery_ticks) > BATTERY_LEVEL_MEAS_INTERVAL)
+        {
+            return false;
+        }
+        data[0] = p_info->battery_level;
+        *p_len  = sizeof(p_info->battery_level);
+        return true;
+    }
+
+    field_id -= FIELD_ID_CHAR_MANUFACTURER_NAME;
+    for(cnt = 0; cnt < field_id; cnt++)
+    {
+        offset += p_info->len[cnt];
+    }
+
+    // Called from main loop, strings are stored from BLE interrupt.
+    CRITICAL_REGION_ENTER();
+    *p_len = p_info->len[field_id];
+    memcpy(data, &p_info->data[offset], *p_len);
+    CRITICAL_REGION_EXIT();
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function requests read of next device information or battery level characteristic.
+ *        Reads are issued back to back, right after discovery, while the link is still busy.
+ *
+ * @param p_client Client context information.
+ *
+ * @return true if read was requested, false if there is nothing more to read.
+ */
+
+static bool client_prefetch_next(client_t * p_client)
+{
+    ble_db_discovery_char_t * char_to_read;
+
+    // Strings first, in field order, battery level last.
+    while(p_client->prefetch_field != FIELD_ID_CHAR_SENSOR_ID)
+    {
+        char_to_read = find_char_by_uuid(SENSOR_CHAR_UUIDS[p_client->prefetch_field], p_client);
+
+        if(p_client->prefetch_field == FIELD_ID_CHAR_BATTERY_LEVEL)
+        {
+            p_client->prefetch_field = FIELD_ID_CHAR_SENSOR_ID;
+        }
+        else if(p_client->prefetch_field == FIELD_ID_CHAR_FIRMWARE_REVISION)
+        {
+            p_client->prefetch_field = FIELD_ID_CHAR_BATTERY_LEVEL;
+        }
+        else
+        {
+            p_client->prefetch_field++;
+        }
+
+        if( (char_to_read != NULL) &&
+            (char_to_read->char_props.read != 0) &&
+            (sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->handle_value, 0) == NRF_SUCCESS) )
+        {
+            client_wait(p_client, STATE_PREFETCH);
+            return true;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function puts client into running state and reports connection to the host.
+ *
+ * @param p_client Client context information.
+ *
+ * @return Void.
+ */
+
+static void client_set_running(client_t * p_client)
+{
+    data_id_t data_id;
+
+    data_id = p_client->data_id;
+    spi_create_tx_packet(data_id, FIELD_ID_SENSOR_STATUS, CONNECTION_OPENED, p_client->id, sizeof(sensorID_t));
+    spi_lock_tx_packet(data_id);
+
+    stats_record_inventory(timestamp_now() - p_client->connected_ticks);
+    stats_record_bringup((p_client->flags & CLIENT_FLAG_OPEN_COMM) != 0, timestamp_now() - p_client->connected_ticks);
+
+    APPL_LOG("[CL]: Go to running state\r\n");
+
+    p_client->state = STATE_RUNNING;
+
+    rotation_on_running(p_client);
+
+    client_scan_resume();
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -477,16 +1043,11 @@ bool write_characteristic_value(client_t * p_client, uint16_t uuid, uint8_t * da
     ble_db_discovery_char_t * char_to_write;
     ble_gattc_write_params_t write_params;
 
-    if(p_client->state != STATE_RUNNING)
-    {
-        return false;
-    }
-
     char_to_write = find_char_by_uuid(uuid, p_client);
 
     if(
        (char_to_write == NULL) ||
-       (char_to_write->characteristic.char_props.write == 0)
+       (char_to_write->char_props.write == 0)
       )
     {
         return false;
@@ -494,16 +1055,24 @@ bool write_characteristic_value(client_t * p_client, uint16_t uuid, uint8_t * da
 
     write_params.write_op = BLE_GATT_OP_WRITE_REQ;
 
-    write_params.handle   = char_to_write->characteristic.handle_value;
+    write_params.handle   = char_to_write->handle_value;
     write_params.offset   = 0;
     write_params.len      = len;
     write_params.p_value  = data;
 
+    // Called also from main loop, client may change state or disconnect meanwhile.
+    if(client_claim(p_client, STATE_WAIT_WRITE_RSP) == false)
+    {
+        return false;
+    }
+
     APPL_LOG("[CL]: Write char %02x\r\n", uuid);
     err_code = sd_ble_gattc_write(p_client->srv_db.conn_handle, &write_params);
-    APP_ERROR_CHECK(err_code);
-
-    p_client->state = STATE_WAIT_WRITE_RSP;
+    if(err_code != NRF_SUCCESS)
+    {
+        client_release(p_client, STATE_WAIT_WRITE_RSP);
+        return false;
+    }
 
     return true;
 }
@@ -518,68 +1087,173 @@ bool write_char_value(client_t * p_client, uint16_t uuid, uint8_t * data, uint16
 
     if(
        (char_to_write == NULL) ||
-       (char_to_write->characteristic.char_props.write == 0)
+       (char_to_write->char_props.write == 0)
+      )
+    {
+        return false;
+    }
+
+    write_params.write_op = BLE_GATT_OP_WRITE_REQ;
+
+    write_params.handle   = char_to_write->handle_value;
+    write_params.offset   = 0;
+    write_params.len      = len;
+    write_params.p_value  = data;
+
+    APPL_LOG("[CL]: Write char %02x\r\n", uuid);
+    err_code = sd_ble_gattc_write(p_client->srv_db.conn_handle, &write_params);
+    APP_ERROR_CHECK(err_code);
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function for initiate GATT Read of characteristic value
+ *
+ * @param p_client Client context information.
+ * @param uuid     Short UUID of characteristic
+ * @return    true in case of succeed read request procedure, false in other case.
+ */
+
+bool read_characteristic_value(client_t * p_client, uint16_t uuid)
+{
+    uint32_t                 err_code;
+    ble_db_discovery_char_t * char_to_read;
+
+    APPL_LOG("[CL]: Initiate Read of %02x Characteristic Vlue\r\n", uuid);
+
+    char_to_read = find_char_by_uuid(uuid, p_client);
+    if(
+       (char_to_read == NULL) ||
+       (char_to_read->char_props.read == 0)
       )
     {
         return false;
     }
 
-    write_params.write_op = BLE_GATT_OP_WRITE_REQ;
-
-    write_params.handle   = char_to_write->characteristic.handle_value;
-    write_params.offset   = 0;
-    write_params.len      = len;
-    write_params.p_value  = data;
-
-    APPL_LOG("[CL]: Write char %02x\r\n", uuid);
-    err_code = sd_ble_gattc_write(p_client->srv_db.conn_handle, &write_params);
-    APP_ERROR_CHECK(err_code);
-
+    // Called also from main loop, client may change state or disconnect meanwhile.
+    if(client_claim(p_client, STATE_WAIT_READ_RSP) == false)
+    {
+        return false;
+    }
+
+    err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->handle_value, 0);
+    if(err_code != NRF_SUCCESS)
+    {
+        client_release(p_client, STATE_WAIT_READ_RSP);
+        return false;
+    }
+
     return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief Function for initiate GATT Read of characteristic value
+/**@brief Function starts read of first characteristic after discovery. Client stays in ERROR state
+ *        if read can not be started.
  *
- * @param p_client Client context information.
- * @param uuid     Short UUID of characteristic
- * @return    true in case of succeed read request procedure, false in other case.
+ * @param p_client    Client context information.
+ * @param uuid        UUID of characteristic.
+ * @param next_state  State of client while read is pending.
+ *
+ * @return Void.
  */
 
-bool read_characteristic_value(client_t * p_client, uint16_t uuid)
+static void client_read_after_discovery(client_t * p_client, uint16_t uuid, client_state_t next_state)
 {
-    uint32_t                 err_code;
+    uint32_t                  err_code;
     ble_db_discovery_char_t * char_to_read;
 
-    if(p_client->state != STATE_RUNNING)
+    char_to_read = find_char_by_uuid(uuid, p_client);
+    APPL_LOG("[CL]: Char to read 0x%lX\r\n", (uint32_t)(char_to_read));
+    if(char_to_read != NULL)
     {
-        return false;
+        err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->handle_value, 0);
+        if(err_code == NRF_SUCCESS)
+        {
+            client_wait(p_client, next_state);
+        } else {
+            APPL_LOG_ERROR("[CL]: Failure while calling gattc_read 0x%lX\r\n", err_code);
+        }
     }
+}
 
-    APPL_LOG("[CL]: Initiate Read of %02x Characteristic Vlue\r\n", uuid);
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function reads MITM required flag of sensor served over open Relayr service. Flag is read by
+ *        UUID over handle range of the service, it need not be among discovered characteristics.
+ *        Client stays in ERROR state if read can not be started.
+ *
+ * @param p_client    Client context information.
+ *
+ * @return Void.
+ */
 
-    char_to_read = find_char_by_uuid(uuid, p_client);
-    if(
-       (char_to_read == NULL) ||
-       (char_to_read->characteristic.char_props.read == 0)
-      )
+static void client_check_open(client_t * p_client)
+{
+    uint32_t     err_code;
+    uint8_t      cnt_srv;
+    ble_uuid_t   uuid;
+
+    uuid.type = BLE_UUID_TYPE_BLE;
+    uuid.uuid = CHARACTERISTIC_SENSOR_MITM_REQ_FLAG_UUID;
+
+    // Discovery fills services by registration, srv_count is not maintained.
+    for(cnt_srv = 0; cnt_srv < BLE_DB_DISCOVERY_MAX_SRV; cnt_srv++)
     {
-        return false;
+        if(p_client->srv_db.services[cnt_srv].srv_uuid.uuid == SHORT_SERVICE_RELAYR_OPEN_COMM_UUID)
+        {
+            err_code = sd_ble_gattc_char_value_by_uuid_read(p_client->srv_db.conn_handle, &uuid,
+                                                            &p_client->srv_db.services[cnt_srv].handle_range);
+            if(err_code == NRF_SUCCESS)
+            {
+                client_wait(p_client, STATE_CHECK_OPEN);
+            } else {
+                APPL_LOG_ERROR("[CL]: Failure while calling gattc_char_value_by_uuid_read 0x%lX\r\n", err_code);
+            }
+            return;
+        }
     }
+}
 
-    err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->characteristic.handle_value, 0);
-    APP_ERROR_CHECK(err_code);
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function starts identification of sensor once Relayr service is known and link is secured.
+ *        Sensor served over open Relayr service is identified only after it confirmed that it does not
+ *        require MITM. Confirmation is kept in open list, so reconnecting sensor is identified at once.
+ *
+ * @param p_client    Client context information.
+ *
+ * @return Void.
+ */
 
-    p_client->state = STATE_WAIT_READ_RSP;
-    return true;
+static void client_identify(client_t * p_client)
+{
+    if( ((p_client->flags & CLIENT_FLAG_OPEN_COMM) != 0) &&
+        (open_list_search(&p_client->peer_addr) == false) )
+    {
+        client_check_open(p_client);
+        return;
+    }
+
+    // Instance keeps confirmed sensor, other open advertisers of its type get other instances.
+    if((p_client->flags & CLIENT_FLAG_OPEN_COMM) != 0)
+    {
+        sensor_slots_bind(p_client->data_id, &p_client->peer_addr);
+    }
+    client_read_after_discovery(p_client, CHARACTERISTIC_SENSOR_ID_UUID, STATE_DEVICE_IDENTIFYING);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief Function for handling Relayr Service discovery events
+/**@brief Function for handling Relayr Service discovery events. Handles both Relayr service and
+ *        its open variant, sensor exposes one of them.
  *
  * @param p_evt event from the DB discovery.
  *
@@ -588,60 +1262,97 @@ bool read_characteristic_value(client_t * p_client, uint16_t uuid)
 
 static void service_relayr_dsc_evt_handler(ble_db_discovery_evt_t * p_evt)
 {
-    uint32_t   err_code;
     client_t * p_client;
-    ble_db_discovery_char_t * char_to_read = NULL;
 
     // Find the client using the connection handle.
     p_client = find_client_by_conn_handle(p_evt->conn_handle);
-    p_client->state = STATE_ERROR;
 
     switch(p_evt->evt_type)
     {
 
       case BLE_DB_DISCOVERY_COMPLETE:
       {
-        APPL_LOG("[CL]: Discovery Relayr Complete\r\n");
+        APPL_LOG("[CL]: Discovery Relayr 0x%04X Complete\r\n", p_evt->params.p_discovered_db->srv_uuid.uuid);
 
-        char_to_read = find_char_by_uuid(CHARACTERISTIC_SENSOR_ID_UUID, p_client);
-        APPL_LOG("[CL]: Char to read 0x%lX\r\n", (uint32_t)(char_to_read));
-        if(char_to_read != NULL)
+        // First variant found is used.
+        if((p_client->flags & CLIENT_FLAG_MAIN_FOUND) != 0)
         {
-            err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->characteristic.handle_value, 0);
-            if(err_code == NRF_SUCCESS)
-            {
-                p_client->state = STATE_DEVICE_IDENTIFYING;
-            } else {
-                APPL_LOG("[CL]: Failure while calling gattc_read 0x%lX\r\n", err_code);
-            }
+            break;
         }
+        p_client->flags |= CLIENT_FLAG_MAIN_FOUND;
+        client_set_error(p_client);
+
+        if((p_client->flags & CLIENT_FLAG_SECURED) == 0)
+        {
+            p_client->flags |= CLIENT_FLAG_WAIT_RELAYR;
+            p_client->state  = STATE_SERVICE_DISC;
+            break;
+        }
+        client_identify(p_client);
         break;
       }
 
       case BLE_DB_DISCOVERY_ERROR:
       {
-          APPL_LOG("[CL]: Discovery Error\r\n");
+          APPL_LOG_ERROR("[CL]: Discovery Error\r\n");
+          client_set_error(p_client);
           break;
       }
 
       case BLE_DB_DISCOVERY_SRV_NOT_FOUND:
       {
           APPL_LOG("[CL]: Relayr Not Found\r\n");
+
+          // Error once neither variant was found.
+          if((p_client->flags & CLIENT_FLAG_MAIN_FOUND) != 0)
+          {
+              break;
+          }
+          if((p_client->flags & CLIENT_FLAG_MAIN_MISSING) != 0)
+          {
+              client_set_error(p_client);
+          }
+          p_client->flags |= CLIENT_FLAG_MAIN_MISSING;
           break;
       }
 
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function continues client whose handles were restored after rotation, as if discovery
+ *        of Relayr service completed.
+ *
+ * @param p_client Client context information.
+ *
+ * @return Void.
+ */
+
+static void client_restore_after_rotation(client_t * p_client)
+{
+    APPL_LOG("[CL]: Handles restored after rotation\r\n");
+
+    p_client->flags |= CLIENT_FLAG_MAIN_FOUND;
+    client_set_error(p_client);
+
+    if((p_client->flags & CLIENT_FLAG_SECURED) == 0)
+    {
+        p_client->flags |= CLIENT_FLAG_WAIT_RELAYR;
+        p_client->state  = STATE_SERVICE_DISC;
+        return;
+    }
+    client_identify(p_client);
+}
+
 static void service_config_dsc_evt_handler(ble_db_discovery_evt_t * p_evt)
 {
-    uint32_t   err_code;
     client_t * p_client;
-    ble_db_discovery_char_t * char_to_read = NULL;
 
     // Find the client using the connection handle.
     p_client = find_client_by_conn_handle(p_evt->conn_handle);
-    p_client->state = STATE_ERROR;
+    client_set_error(p_client);
 
     switch(p_evt->evt_type)
     {
@@ -650,25 +1361,19 @@ static void service_config_dsc_evt_handler(ble_db_discovery_evt_t * p_evt)
       {
             APPL_LOG("[CL]: Discovery Relayr Sensor Config Complete\r\n");
 
-            char_to_read = find_char_by_uuid(CHARACTERISTIC_SENSOR_PASSKEY_UUID, p_client);
-            APPL_LOG("[CL]: Char to read 0x%lX\r\n", (uint32_t)(char_to_read));
-            if(char_to_read != NULL)
+            if((p_client->flags & CLIENT_FLAG_SECURED) == 0)
             {
-                err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->characteristic.handle_value, 0);
-                if(err_code == NRF_SUCCESS)
-                {
-                    p_client->state = STATE_CHECK_CONFIG;
-                } else {
-                    APPL_LOG("[CL]: Failure while calling gattc_read 0x%lX\r\n", err_code);
-                }
+                p_client->flags |= CLIENT_FLAG_WAIT_CONFIG;
+                p_client->state  = STATE_SERVICE_DISC;
+                break;
             }
-
+            client_read_after_discovery(p_client, CHARACTERISTIC_SENSOR_PASSKEY_UUID, STATE_CHECK_CONFIG);
             break;
       }
 
       case BLE_DB_DISCOVERY_ERROR:
       {
-          APPL_LOG("[CL]: Discovery Error\r\n");
+          APPL_LOG_ERROR("[CL]: Discovery Error\r\n");
           break;
       }
 
@@ -709,17 +1414,17 @@ static void service_deviceinf_dsc_evt_handler(ble_db_discovery_evt_t * p_evt)
 
         case BLE_DB_DISCOVERY_ERROR:
         {
-            APPL_LOG("[CL]: Discovery Error\r\n");
-            p_client->state = STATE_ERROR;
+            APPL_LOG_ERROR("[CL]: Discovery Error\r\n");
+            client_set_error(p_client);
             break;
         }
 
         case BLE_DB_DISCOVERY_SRV_NOT_FOUND:
         {
-            if(sensor_get_name_index(p_client->device_name) != DATA_ID_DEV_CFG_APP)
+            if(p_client->data_id != DATA_ID_DEV_CFG_APP)
             {
                 APPL_LOG("[CL]: Discovery Device Information Not Found\r\n");
-                p_client->state = STATE_ERROR;
+                client_set_error(p_client);
             }
             break;
         }
@@ -754,17 +1459,17 @@ static void service_batterylev_dsc_evt_handler(ble_db_discovery_evt_t * p_evt)
 
         case BLE_DB_DISCOVERY_ERROR:
         {
-            APPL_LOG("[CL]: Discovery Error\r\n");
-            p_client->state = STATE_ERROR;
+            APPL_LOG_ERROR("[CL]: Discovery Error\r\n");
+            client_set_error(p_client);
             break;
         }
 
         case BLE_DB_DISCOVERY_SRV_NOT_FOUND:
         {
-            if(sensor_get_name_index(p_client->device_name) != DATA_ID_DEV_CFG_APP)
+            if(p_client->data_id != DATA_ID_DEV_CFG_APP)
             {
                 APPL_LOG("[CL]: Discovery Battery Not Found\r\n");
-                p_client->state = STATE_ERROR;
+                client_set_error(p_client);
             }
             break;
         }
@@ -801,30 +1506,21 @@ static void on_evt_write_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
             {
                 // Got response from unexpected handle.
                 APPL_LOG("[CL]: Got response from unexpected handle\r\n");
-                p_client->state = STATE_ERROR;
+                client_set_error(p_client);
             }
             else
             {
                 APPL_LOG("[CL]: Complete Notification Enable for %02x Characteristic\r\n",
-                          p_client->srv_db.services[p_client->srv_index].charateristics[p_client->char_index - 1].characteristic.uuid.uuid);
+                          p_client->srv_db.services[p_client->srv_index].charateristics[p_client->char_index - 1].uuid);
 
                 // Search for more characteristics with notification properties.
                 if(notif_enable(p_client) == false)
                 {
-                    data_id_t data_id;
-
-                    data_id = (data_id_t)sensor_get_name_index(p_client->device_name);
-                    spi_create_tx_packet(data_id, FIELD_ID_SENSOR_STATUS, CONNECTION_OPENED, p_client->id, sizeof(sensorID_t));
-                    spi_lock_tx_packet(data_id);
-
                     // All characterisitics with notification properties are enabled.
-                    APPL_LOG("[CL]: Go to running state\r\n");
-
-                    p_client->state = STATE_RUNNING;
-
-                    if (get_active_client_number() < DEVICE_MANAGER_MAX_CONNECTIONS)
+                    p_client->prefetch_field = FIELD_ID_CHAR_MANUFACTURER_NAME;
+                    if(client_prefetch_next(p_client) == false)
                     {
-                        scan_start();
+                        client_set_running(p_client);
                     }
                 }
             }
@@ -837,12 +1533,12 @@ static void on_evt_write_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
             APPL_LOG("[CL]: Char to read 0x%lX\r\n", (uint32_t)(char_to_read));
             if(char_to_read != NULL)
             {
-                uint32_t err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->characteristic.handle_value, 0);
+                uint32_t err_code = sd_ble_gattc_read(p_client->srv_db.conn_handle, char_to_read->handle_value, 0);
                 if(err_code == NRF_SUCCESS)
                 {
-                    p_client->state = STATE_CHECK_CONFIG;
+                    client_wait(p_client, STATE_CHECK_CONFIG);
                 } else {
-                    APPL_LOG("[CL]: Failure while calling gattc_read 0x%lX\r\n", err_code);
+                    APPL_LOG_ERROR("[CL]: Failure while calling gattc_read 0x%lX\r\n", err_code);
                 }
             }
 
@@ -852,7 +1548,7 @@ static void on_evt_write_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
         // Send OK write response through SPI.
         case STATE_WAIT_WRITE_RSP:
         {
-            data_id_t sensor_id = (data_id_t)sensor_get_name_index(p_client->device_name);
+            data_id_t sensor_id = p_client->data_id;
 
             uint8_t status = (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_SUCCESS) ? 1 : 0;
             spi_create_tx_packet(sensor_id, FIELD_ID_SENSOR_WRITE_OK, OPERATION_WRITE, &status, sizeof(status));
@@ -908,19 +1604,30 @@ static void on_evt_read_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
             memcpy((uint8_t *)p_client->id, (uint8_t *)&read_rsp->data, read_rsp->len);
             p_client->char_index = 0;
             p_client->srv_index  = 0;
-            notif_enable(p_client);
+            if(notif_enable(p_client) == false)
+            {
+                // Sensor has no characteristic which notifies.
+                p_client->prefetch_field = FIELD_ID_CHAR_MANUFACTURER_NAME;
+                if(client_prefetch_next(p_client) == false)
+                {
+                    client_set_running(p_client);
+                }
+            }
             break;
         }
 
         case STATE_CHECK_CONFIG:
         {
-            const uint8_t sensor_id = sensor_get_name_index(p_client->device_name);
-            if (0xFF == sensor_id)
+            const data_id_t sensor_id = p_client->data_id;
+            const uint8_t * passkey   = sensor_slots_get_passkey(sensor_id);
+            if (NULL == passkey)
             {
-                APPL_LOG("[CL]: Critical error, wrong device name %s \r\n", p_client->device_name);
+                APPL_LOG_ERROR("[CL]: Critical error, no passkey for %s instance 0x%02X \r\n", p_client->device_name, sensor_id);
+                client_set_error(p_client);
+                break;
             }
 
-            const bool password_match = (0 == memcmp(sensors_passkey[sensor_id], (uint8_t *)&read_rsp->data, PASSKEY_SIZE));
+            const bool password_match = (0 == memcmp(passkey, (uint8_t *)&read_rsp->data, PASSKEY_SIZE));
 
             if (password_match)
             {
@@ -939,7 +1646,7 @@ static void on_evt_read_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
                 }
                 else
                 {
-                    APPL_LOG("[CL]: Disconnect failed with status %lu \r\n", err_code);
+                    APPL_LOG_ERROR("[CL]: Disconnect failed with status %lu \r\n", err_code);
 
                     if (err_code > NRF_ERROR_BUSY)
                     {
@@ -951,17 +1658,28 @@ static void on_evt_read_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
             {
                 APPL_LOG("[CL]: Requested password differs on the target, commencing config 0x%s \r\n", (char*)find_char_by_uuid(CHARACTERISTIC_SENSOR_PASSKEY_UUID, p_client));
 
-                const uint8_t sensor_id = sensor_get_name_index(p_client->device_name);
-                if (0xFF == sensor_id)
-                {
-                    APPL_LOG("[CL]: Critical error, wrong device name %s \r\n", p_client->device_name);
-                }
+                write_char_value(p_client, CHARACTERISTIC_SENSOR_PASSKEY_UUID, (uint8_t *)passkey, PASSKEY_SIZE);
+
+                client_wait(p_client, STATE_CONFIGURE);
+            }
+
+            break;
+        }
 
-                write_char_value(p_client, CHARACTERISTIC_SENSOR_PASSKEY_UUID, sensors_passkey[sensor_id], PASSKEY_SIZE);
+        case STATE_PREFETCH:
+        {
+            ble_db_discovery_char_t * characterisitc = find_char_by_handle_value(read_rsp->handle, p_client);
 
-                p_client->state = STATE_CONFIGURE;
+            if( (characterisitc != NULL) &&
+                (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_SUCCESS) )
+            {
+                client_info_store(p_client, characterisitc->field_id, read_rsp->data, read_rsp->len);
             }
 
+            if(client_prefetch_next(p_client) == false)
+            {
+                client_set_running(p_client);
+            }
             break;
         }
 
@@ -973,9 +1691,15 @@ static void on_evt_read_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
 
             p_client->state = STATE_RUNNING;
 
-            data_id = (data_id_t)sensor_get_name_index(p_client->device_name);
+            data_id = p_client->data_id;
             characterisitc = find_char_by_handle_value(read_rsp->handle, p_client);
-            char_id = sensor_get_char_index(characterisitc->characteristic.uuid.uuid);
+            if(characterisitc == NULL)
+            {
+                break;
+            }
+            char_id = characterisitc->field_id;
+            value_cache_store(data_id, char_id, read_rsp->data, read_rsp->len);
+            client_info_store(p_client, char_id, read_rsp->data, read_rsp->len);
 
             if( (onboard_get_state() == ONBOARD_STATE_IDLE) &&
                 (data_id != DATA_ID_DEV_CFG_APP) )
@@ -993,7 +1717,45 @@ static void on_evt_read_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief Function for handling notification received events.
+/**@brief Function for handling response of MITM required flag read. Sensor is served over open Relayr
+ *        service only if it has the flag and the flag is cleared, otherwise it is disconnected.
+ *
+ * @param p_ble_evt Event to handle.
+ * @param p_client  Client context information.
+ *
+ * @return Void.
+ */
+
+static void on_evt_char_val_by_uuid_read_rsp(ble_evt_t * p_ble_evt, client_t * p_client)
+{
+    const ble_gattc_evt_char_val_by_uuid_read_rsp_t * p_rsp = &p_ble_evt->evt.gattc_evt.params.char_val_by_uuid_read_rsp;
+
+    if(p_client->state != STATE_CHECK_OPEN)
+    {
+        return;
+    }
+
+    client_set_error(p_client);
+
+    if( (p_ble_evt->evt.gattc_evt.gatt_status != BLE_GATT_STATUS_SUCCESS) ||
+        (p_rsp->count == 0) ||
+        (p_rsp->value_len == 0) ||
+        (p_rsp->handle_value[0].p_value[0] != 0) )
+    {
+        APPL_LOG_ERROR("[CL]: %s does not confirm open communication\r\n", p_client->device_name);
+        return;
+    }
+
+    open_list_add(&p_client->peer_addr);
+    client_identify(p_client);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function for handling notification received events. Value notified while further
+ *        notifications are enabled or device information is prefetched is kept in value cache,
+ *        host learns of the sensor from CONNECTION_OPENED only after that.
  *
  * @param p_ble_evt Event to handle.
  * @param p_client  Client context information.
@@ -1006,7 +1768,8 @@ static void on_evt_hvx(ble_evt_t * p_ble_evt, client_t * p_client)
     uint8_t cnt;
     if (
             (p_client != NULL) &&
-            ((p_client->state == STATE_RUNNING)||(p_client->state == STATE_WAIT_WRITE_RSP)||(p_client->state == STATE_WAIT_READ_RSP))
+            ((p_client->state == STATE_RUNNING)||(p_client->state == STATE_WAIT_WRITE_RSP)||(p_client->state == STATE_WAIT_READ_RSP)||
+             (p_client->state == STATE_NOTIF_ENABLE)||(p_client->state == STATE_PREFETCH))
         )
     {
         data_id_t            data_id;
@@ -1016,12 +1779,27 @@ static void on_evt_hvx(ble_evt_t * p_ble_evt, client_t * p_client)
 
         hvx = &p_ble_evt->evt.gattc_evt.params.hvx;
 
-        data_id = (data_id_t)sensor_get_name_index(p_client->device_name);
+        data_id = p_client->data_id;
+        stats_count_notification(DATA_ID_GET_TYPE(data_id));
 
         characterisitc = find_char_by_handle_value(hvx->handle, p_client);
-        char_id = sensor_get_char_index(characterisitc->characteristic.uuid.uuid);
+        if(characterisitc == NULL)
+        {
+            return;
+        }
+        char_id = characterisitc->field_id;
+        value_cache_store(data_id, char_id, hvx->data, hvx->len);
 
-        spi_create_tx_packet(data_id, char_id, OPERATION_WRITE, hvx->data, hvx->len);
+        if( (p_client->state != STATE_NOTIF_ENABLE) && (p_client->state != STATE_PREFETCH) )
+        {
+            client_info_store(p_client, char_id, hvx->data, hvx->len);
+            spi_create_tx_packet(data_id, char_id, OPERATION_WRITE, hvx->data, hvx->len);
+        }
+        else if(char_id == FIELD_ID_CHAR_BATTERY_LEVEL)
+        {
+            // Strings are stored from prefetch reads only, in field order.
+            client_info_store(p_client, char_id, hvx->data, hvx->len);
+        }
 
         APPL_LOG("[CL]: Notification-> ConHandle:  %d; Handle:  0x%X; Device Name: %s;  Value: 0x",
                 p_client->srv_db.conn_handle, hvx->handle, p_client->device_name);
@@ -1052,7 +1830,7 @@ static void on_evt_timeout(ble_evt_t * p_ble_evt, client_t * p_client)
 
     if (p_client != NULL)
     {
-        p_client->state = STATE_ERROR;
+        client_set_error(p_client);
     }
 }
 
@@ -1114,8 +1892,10 @@ void client_handling_ble_evt_handler(ble_evt_t * p_ble_evt)
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GATTC_EVT_WRITE_RSP:
-            if ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
-                (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION))
+            // Device manager pairs with run mode params, config mode links are paired only once by main.
+            if ((onboard_get_mode() == ONBOARD_MODE_RUN) &&
+                ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
+                 (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION)))
             {
                 uint32_t err_code = dm_security_setup_req(&p_client->handle);
                 APP_ERROR_CHECK(err_code);
@@ -1125,8 +1905,9 @@ void client_handling_ble_evt_handler(ble_evt_t * p_ble_evt)
             break;
 
         case BLE_GATTC_EVT_READ_RSP:
-            if ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
-                (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION))
+            if ((onboard_get_mode() == ONBOARD_MODE_RUN) &&
+                ((p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_AUTHENTICATION) ||
+                 (p_ble_evt->evt.gattc_evt.gatt_status == BLE_GATT_STATUS_ATTERR_INSUF_ENCRYPTION)))
             {
                 uint32_t err_code = dm_security_setup_req(&p_client->handle);
                 APP_ERROR_CHECK(err_code);
@@ -1135,6 +1916,10 @@ void client_handling_ble_evt_handler(ble_evt_t * p_ble_evt)
             on_evt_read_rsp(p_ble_evt, p_client);
             break;
 
+        case BLE_GATTC_EVT_CHAR_VAL_BY_UUID_READ_RSP:
+            on_evt_char_val_by_uuid_read_rsp(p_ble_evt, p_client);
+            break;
+
         case BLE_GATTC_EVT_HVX:
             on_evt_hvx(p_ble_evt, p_client);
             break;
@@ -1148,7 +1933,10 @@ void client_handling_ble_evt_handler(ble_evt_t * p_ble_evt)
     }
 
 
-    if (p_client != NULL)
+    // Services of client dropped by mode switch are registered for previous mode, only its disconnection is passed.
+    if( (p_client != NULL) &&
+        ( ((p_client->flags & CLIENT_FLAG_DROPPED) == 0) ||
+          (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED) ) )
     {
         ble_db_discovery_on_ble_evt(&(p_client->srv_db), p_ble_evt);
     }
@@ -1173,22 +1961,17 @@ static void db_discovery_init(void)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief Function for initializing the client handling.
+/**@brief Function registers services of onboarding mode with discovery module. Registrations of
+ *        previous mode are dropped.
+ *
+ * @param onboard_mode  Onboarding mode.
  *
  * @return Void.
  */
 
-void client_handling_init(onboard_mode_t onboard_mode)
+static void client_discovery_register(onboard_mode_t onboard_mode)
 {
     uint32_t err_code;
-    uint32_t i;
-
-    nrf_gpio_range_cfg_output(8, 15);
-
-    for (i = 0; i < MAX_CLIENTS; i++)
-    {
-        m_client[i].state  = STATE_IDLE;
-    }
 
     db_discovery_init();
 
@@ -1209,6 +1992,14 @@ void client_handling_init(onboard_mode_t onboard_mode)
     err_code = ble_db_discovery_register(&uuid, main_service_dsc_evt_handle);
     APP_ERROR_CHECK(err_code);
 
+    // Sensors which do not require MITM offer open variant of Relayr service instead.
+    if (ONBOARD_MODE_CONFIG != onboard_mode) {
+        uuid.uuid = SHORT_SERVICE_RELAYR_OPEN_COMM_UUID;
+
+        err_code = ble_db_discovery_register(&uuid, service_relayr_dsc_evt_handler);
+        APP_ERROR_CHECK(err_code);
+    }
+
     uuid.type = BLE_UUID_TYPE_BLE;
     uuid.uuid = BLE_UUID_BATTERY_SERVICE;
 
@@ -1222,6 +2013,69 @@ void client_handling_init(onboard_mode_t onboard_mode)
     APP_ERROR_CHECK(err_code);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function for initializing the client handling.
+ *
+ * @return Void.
+ */
+
+void client_handling_init(onboard_mode_t onboard_mode)
+{
+    uint32_t i;
+
+    nrf_gpio_range_cfg_output(8, 15);
+
+    for (i = 0; i < MAX_CLIENTS; i++)
+    {
+        m_client[i].state    = STATE_IDLE;
+        m_client[i].op_state = STATE_IDLE;
+    }
+
+    client_discovery_register(onboard_mode);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function switches onboarding mode of client handling, links stay up. Running sensors keep
+ *        their discovered services. Other clients are disconnected, as their discovery and security
+ *        follow previous mode. Called from main loop.
+ *
+ * @param onboard_mode  New onboarding mode.
+ *
+ * @return Void.
+ */
+
+void client_handling_set_mode(onboard_mode_t onboard_mode)
+{
+    client_t * p_client;
+    uint8_t    cnt;
+
+    for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
+    {
+        p_client = &m_client[cnt];
+
+        CRITICAL_REGION_ENTER();
+
+        if( (p_client->state != STATE_IDLE) &&
+            (p_client->state != STATE_DISCONNECTING) &&
+            ( (DATA_ID_IS_SENSOR(p_client->data_id) == false) ||
+              ( (p_client->state != STATE_RUNNING) &&
+                (p_client->state != STATE_WAIT_READ_RSP) &&
+                (p_client->state != STATE_WAIT_WRITE_RSP) ) ) )
+        {
+            p_client->flags |= CLIENT_FLAG_DROPPED;
+            client_set_error(p_client);
+        }
+
+        CRITICAL_REGION_EXIT();
+    }
+
+    client_discovery_register(onboard_mode);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1230,28 +2084,99 @@ void client_handling_init(onboard_mode_t onboard_mode)
  * @return Void.
  */
 
-uint32_t client_handling_create(const dm_handle_t * p_handle, uint16_t conn_handle, current_conn_device_t * current_conn_device)
+uint32_t client_handling_create(const dm_handle_t * p_handle, uint16_t conn_handle, current_conn_device_t * current_conn_device, bool secured)
 {
     uint32_t err_code;
 
     m_client[p_handle->connection_id].srv_db.conn_handle = conn_handle;
     m_client[p_handle->connection_id].handle             = (*p_handle);
     m_client[p_handle->connection_id].device_name        = current_conn_device->device_name;
+    m_client[p_handle->connection_id].data_id            = current_conn_device->data_id;
+    m_client[p_handle->connection_id].connected_ticks    = current_conn_device->connected_ticks;
+    memset((uint8_t *)&m_client[p_handle->connection_id].info, 0, sizeof(client_info_t));
     memcpy( (uint8_t *)&m_client[p_handle->connection_id].peer_addr, (uint8_t *)&current_conn_device->peer_addr, sizeof(ble_gap_addr_t));
-    err_code = service_discover(&m_client[p_handle->connection_id]);
+    m_client[p_handle->connection_id].flags              = 0;
+
+    // Deadline covers discovery and encryption of bonded sensor.
+    client_wait(&m_client[p_handle->connection_id], STATE_SERVICE_DISC);
 
-    if(err_code == NRF_SUCCESS)
+    if(current_conn_device->open_comm)
     {
-        m_client[p_handle->connection_id].state = STATE_SERVICE_DISC;
+        // Link stays unsecured, sensor is trusted by policy.
+        m_client[p_handle->connection_id].flags = CLIENT_FLAG_SECURED | CLIENT_FLAG_OPEN_COMM;
     }
-    else
+    else if(secured)
+    {
+        m_client[p_handle->connection_id].flags = CLIENT_FLAG_SECURED;
+
+        // Link is secured, so sensor keeps its instance from now on.
+        sensor_slots_bind(current_conn_device->data_id, &current_conn_device->peer_addr);
+    }
+
+    // Sensor coming back from rotation keeps handles it had, discovery is skipped.
+    if( (onboard_get_mode() == ONBOARD_MODE_RUN) &&
+        rotation_restore_handles(&m_client[p_handle->connection_id]) )
+    {
+        client_restore_after_rotation(&m_client[p_handle->connection_id]);
+        return NRF_SUCCESS;
+    }
+
+    err_code = service_discover(&m_client[p_handle->connection_id]);
+    if(err_code != NRF_SUCCESS)
+    {
+        client_set_error(&m_client[p_handle->connection_id]);
+    }
+    else if(secured)
     {
-        m_client[p_handle->connection_id].state = STATE_ERROR;
+        // Security setup is done, context of connected device is not needed any more.
+        client_scan_resume();
     }
 
     return err_code;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function continues client created before its link was secured. Read which waited for
+ *        secured link is started, discovery still in progress continues as usual.
+ *
+ * @param[in] p_handle  Device Manager Handle.
+ *
+ * @return    false if there is no client for link, otherwise true.
+ */
+
+bool client_handling_on_secured(const dm_handle_t * p_handle)
+{
+    client_t * p_client = &m_client[p_handle->connection_id];
+
+    if(p_client->state == STATE_IDLE)
+    {
+        return false;
+    }
+    if( (p_client->state != STATE_SERVICE_DISC) ||
+        ((p_client->flags & CLIENT_FLAG_SECURED) != 0) )
+    {
+        return true;
+    }
+
+    p_client->flags |= CLIENT_FLAG_SECURED;
+    sensor_slots_bind(p_client->data_id, &p_client->peer_addr);
+    client_scan_resume();
+
+    if((p_client->flags & CLIENT_FLAG_WAIT_RELAYR) != 0)
+    {
+        client_set_error(p_client);
+        client_read_after_discovery(p_client, CHARACTERISTIC_SENSOR_ID_UUID, STATE_DEVICE_IDENTIFYING);
+    }
+    else if((p_client->flags & CLIENT_FLAG_WAIT_CONFIG) != 0)
+    {
+        client_set_error(p_client);
+        client_read_after_discovery(p_client, CHARACTERISTIC_SENSOR_PASSKEY_UUID, STATE_CHECK_CONFIG);
+    }
+    return true;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1270,10 +2195,16 @@ uint32_t client_handling_destroy(const dm_handle_t * p_handle)
     {
         data_id_t data_id;
 
-        data_id = (data_id_t)sensor_get_name_index(p_client->device_name);
+        data_id = p_client->data_id;
         APPL_LOG("[CL]: Client %d goes to Idle: \r\n", data_id);
         memset((uint8_t *)p_client->id, 0, 8);
-        spi_create_tx_packet(data_id, FIELD_ID_SENSOR_STATUS, CONNECTION_CLOSED, NULL, 0);
+
+        // Sensor in rotation is still present for the host, its last values stay cached.
+        if(rotation_on_disconnect(p_client) == false)
+        {
+            value_cache_invalidate(data_id, VALUE_CACHE_ALL_FIELDS);
+            spi_create_tx_packet(data_id, FIELD_ID_SENSOR_STATUS, CONNECTION_CLOSED, NULL, 0);
+        }
 
         p_client->state = STATE_IDLE;
     }
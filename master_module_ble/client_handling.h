@@ -36,14 +36,16 @@ typedef enum
     STATE_SERVICE_DISC         = 0,    // Service discovery state.
     STATE_DEVICE_IDENTIFYING   = 1,    // Check Wunderbar ID.
     STATE_NOTIF_ENABLE         = 2,    // State where the request to enable notifications is sent to the peer.
-    STATE_RUNNING              = 3,    // Running state.
-    STATE_WAIT_READ_RSP        = 4,    // Wait for read response.
-    STATE_WAIT_WRITE_RSP       = 5,    // Wait for write response.
-    STATE_DISCONNECTING        = 6,    // Disconnect request is sent.
-    STATE_IDLE                 = 7,    // Idle state.
-    STATE_ERROR                = 8,    // Error state.
-    STATE_CONFIGURE            = 9,    // Sensor under configuration
-    STATE_CHECK_CONFIG         = 10    // Validating config
+    STATE_PREFETCH             = 3,    // Reading device information and battery level.
+    STATE_RUNNING              = 4,    // Running state.
+    STATE_WAIT_READ_RSP        = 5,    // Wait for read response.
+    STATE_WAIT_WRITE_RSP       = 6,    // Wait for write response.
+    STATE_DISCONNECTING        = 7,    // Disconnect request is sent.
+    STATE_IDLE                 = 8,    // Idle state.
+    STATE_ERROR                = 9,    // Error state.
+    STATE_CONFIGURE            = 10,   // Sensor under configuration
+    STATE_CHECK_CONFIG         = 11,   // Validating config
+    STATE_CHECK_OPEN           = 12    // Checking that sensor served over open Relayr service does not require MITM.
 }
 client_state_t;
 
@@ -53,12 +55,61 @@ client_state_t;
 typedef struct
 {
     const uint8_t * device_name;
+    data_id_t       data_id;
     ble_gap_addr_t  peer_addr;
 	  bool            bonded_flag;
+    bool            open_comm;         /**< Sensor offers Relayr service without MITM and policy lets it skip security setup. */
+    uint32_t        connected_ticks;   /**< Master time of connection. */
 }
 current_conn_device_t;
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Client flags. Discovery of bonded sensor runs while link is encrypted, first read waits for secured link. */
+
+#define CLIENT_FLAG_SECURED         0x01  // Link is secured, or needs no security, see CLIENT_FLAG_OPEN_COMM.
+#define CLIENT_FLAG_WAIT_RELAYR     0x02  // Relayr service discovered, sensor ID is read once link is secured.
+#define CLIENT_FLAG_WAIT_CONFIG     0x04  // Config service discovered, passkey is read once link is secured.
+#define CLIENT_FLAG_MAIN_FOUND      0x08  // Relayr service or its open variant discovered.
+#define CLIENT_FLAG_MAIN_MISSING    0x10  // One of Relayr service variants not found.
+#define CLIENT_FLAG_OPEN_COMM       0x20  // Link is not secured, sensor is served over open Relayr service.
+#define CLIENT_FLAG_DROPPED         0x40  // Client was being brought up when onboarding mode changed, it is disconnected.
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Deadlines of GATT operations, per client state. Sensor answers within one slave latency period,
+ *        deadline allows two. Operation which missed its deadline ends with disconnection, so client
+ *        recovers long before 30 s GATT protocol timeout. Service discovery issues several requests
+ *        and waits for encryption of bonded sensor, its deadline covers both. */
+
+#define CLIENT_GATT_RSP_MS                     (2 * (SLAVE_LATENCY + 1) * CONNECTION_INTERVAL_MS)
+
+#define CLIENT_TIMEOUT_SERVICE_DISC_MS         (8 * CLIENT_GATT_RSP_MS)
+#define CLIENT_TIMEOUT_DEVICE_IDENTIFYING_MS   CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_NOTIF_ENABLE_MS         CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_PREFETCH_MS             CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_WAIT_READ_RSP_MS        CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_WAIT_WRITE_RSP_MS       CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_CONFIGURE_MS            (2 * CLIENT_GATT_RSP_MS)   // Sensor stores passkey in flash before it answers.
+#define CLIENT_TIMEOUT_CHECK_CONFIG_MS         CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_CHECK_OPEN_MS           CLIENT_GATT_RSP_MS
+#define CLIENT_TIMEOUT_CHECK_MS                250                        // Deadlines are checked with this period while any operation is pending.
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Device information and battery level, read right after connection. */
+
+#define CLIENT_INFO_STRINGS         3     // Manufacturer name, hardware revision, firmware revision.
+#define CLIENT_INFO_DATA_SIZE       32    // Space for all strings, stored back to back.
+
+typedef struct
+{
+    uint32_t              battery_ticks;                      /**< Master time battery level was received. */
+    uint8_t               battery_level;
+    uint8_t               valid;                              /**< Bit n set if field FIELD_ID_CHAR_BATTERY_LEVEL + n is stored. */
+    uint8_t               len[CLIENT_INFO_STRINGS];           /**< String lengths. */
+    uint8_t               data[CLIENT_INFO_DATA_SIZE];        /**< Strings. */
+}
+client_info_t;
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief Client context information. */
 
@@ -67,11 +118,18 @@ typedef struct
     ble_db_discovery_t    srv_db;            /**< The DB Discovery module instance associated with this client. */
     dm_handle_t           handle;            /**< Device manager identifier for the device. */
     const uint8_t *       device_name;       /**< Client Device Name. */
+    data_id_t             data_id;           /**< Sensor type and instance. */
     ble_gap_addr_t        peer_addr;         /**< Bluetooth Low Energy address. */
     sensorID_t            id;                /**< Bluetooth Low Energy address. */
     uint8_t               state;             /**< Client state. */
+    uint8_t               flags;             /**< CLIENT_FLAG_* flags. */
     uint8_t               srv_index;         /**< These two fields determine last found characteristic with notification properties. Used to enable services. */
     uint8_t               char_index;        /**<                                                                                                             */
+    uint8_t               prefetch_field;    /**< Field ID of next characteristic to be read in STATE_PREFETCH. */
+    uint32_t              connected_ticks;   /**< Master time of connection. */
+    uint32_t              op_deadline;       /**< Master time pending GATT operation shall be answered by. */
+    uint8_t               op_state;          /**< State deadline was set for, deadline is void once client leaves it. */
+    client_info_t         info;              /**< Prefetched device information and battery level. */
 }
 client_t;
 
@@ -79,6 +137,7 @@ client_t;
 /**@brief Functions declarations. */
 bool read_characteristic_value(client_t * p_client, uint16_t uuid);
 client_t * find_client_by_dev_name(const uint8_t * device_name, uint8_t len);
+client_t * find_client_by_data_id(data_id_t data_id);
 ble_db_discovery_char_t * find_char_by_uuid(uint16_t char_uuid, client_t * p_client);
 ble_db_discovery_char_t * find_char_by_handle_value(uint16_t handle_value, client_t * p_client);
 bool write_characteristic_value(client_t * p_client, uint16_t uuid, uint8_t * data, uint16_t len);
@@ -94,6 +153,7 @@ bool validate_device_name(uint8_t * device_name, uint16_t len, const uint8_t **
 void check_client_timeout(void);
 bool timers_init(void);
 uint8_t get_active_client_number(void);
+bool client_info_get(client_t * p_client, uint8_t field_id, uint8_t * data, uint8_t * p_len);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -103,6 +163,16 @@ uint8_t get_active_client_number(void);
 
 void client_handling_init(onboard_mode_t onboard_mode);
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Funtion for switching onboarding mode while links stay up. Running sensors stay connected.
+ *
+ * @param[in] onboard_mode  New onboarding mode.
+ */
+
+void client_handling_set_mode(onboard_mode_t onboard_mode);
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -122,10 +192,23 @@ uint8_t client_handling_count(void);
  *                        identifies the peer.
  *
  * @param[in] conn_handle Identifies link for which client is created.
+ * @param[in] secured     false if link of bonded sensor is still being encrypted, see client_handling_on_secured().
  * @return NRF_SUCCESS on success, any other on failure.
  */
 
-uint32_t client_handling_create(const dm_handle_t * p_handle, uint16_t conn_handle, current_conn_device_t * current_conn_device);
+uint32_t client_handling_create(const dm_handle_t * p_handle, uint16_t conn_handle, current_conn_device_t * current_conn_device, bool secured);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Funtion for continuing client created before its link was secured.
+ *
+ * @param[in] p_handle  Device Manager Handle.
+ *
+ * @return false if there is no client for link, otherwise true.
+ */
+
+bool client_handling_on_secured(const dm_handle_t * p_handle);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -140,6 +223,16 @@ uint32_t client_handling_create(const dm_handle_t * p_handle, uint16_t conn_hand
 
 uint32_t client_handling_destroy(const dm_handle_t * p_handle);
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Funtion for requesting disconnection of client. Client goes to idle state when link is closed.
+ *
+ * @param[in] p_client  Client context information.
+ */
+
+void client_handling_disconnect(client_t * p_client);
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
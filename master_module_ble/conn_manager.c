@@ -0,0 +1,406 @@
+
+/** @file   conn_manager.c
+ *  @brief  Connection manager which ranks sensor advertisers by RSSI,
+ *          connects the best candidate and handles connection timeouts.
+ */
+
+/* -- Includes -- */
+
+#include "conn_manager.h"
+#include "debug.h"
+#include "stats.h"
+#include "peer_backoff.h"
+#include "timestamp.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+#define APPL_LOG(...)                debug_log_module(DEBUG_MODULE_CL, DEBUG_LEVEL_INFO, __VA_ARGS__)   /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#define APPL_LOG_ERROR(...)          debug_log_module(DEBUG_MODULE_CL, DEBUG_LEVEL_ERROR, __VA_ARGS__)  /**< Debug logger macro used for error messages. */
+
+#define CONN_MANAGER_COLLECT_TICKS   APP_TIMER_TICKS(CONN_MANAGER_COLLECT_MS, APP_TIMER_PRESCALER)
+#define CONN_MANAGER_STALE_TICKS     APP_TIMER_TICKS(CONN_MANAGER_STALE_MS, APP_TIMER_PRESCALER)
+#define CONN_MANAGER_COOLOFF_TICKS   APP_TIMER_TICKS(CONN_MANAGER_COOLOFF_MS, APP_TIMER_PRESCALER)
+#define CONN_MANAGER_NONE            CONN_MANAGER_CANDIDATES                                        /**< No candidate is being connected. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**@brief Advertiser of missing sensor. */
+typedef struct
+{
+    ble_gap_addr_t   addr;
+    const uint8_t *  device_name;
+    uint32_t         first_seen;    /**< Master time of first report, start of time to connect. */
+    uint32_t         last_seen;
+    uint32_t         last_attempt;  /**< Master time of last connection request. */
+    uint8_t          data_id;       /**< DATA_ID_ERROR if entry is free. */
+    int8_t           rssi;          /**< Average of last reports. */
+    uint8_t          attempts;      /**< Connection requests sent. */
+    uint8_t          open_comm;     /**< Sensor may be served without security setup. */
+}
+conn_candidate_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Extern variables. */
+
+extern const ble_gap_conn_params_t * m_connection_param;
+extern const ble_gap_scan_params_t * m_scan_param;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static conn_candidate_t       conn_candidates[CONN_MANAGER_CANDIDATES];
+static uint8_t                conn_connecting;           /**< Index of candidate being connected, CONN_MANAGER_NONE if idle. */
+static uint16_t               conn_securing;             /**< Link connected last until its security setup ends, BLE_CONN_HANDLE_INVALID if none. */
+static ble_gap_scan_params_t  conn_scan_param;           /**< Scan parameters of connection request, with timeout. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function frees all candidates of sensor.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ */
+
+static void conn_manager_drop(data_id_t data_id)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < CONN_MANAGER_CANDIDATES; cnt++)
+    {
+        if(conn_candidates[cnt].data_id == data_id)
+        {
+            conn_candidates[cnt].data_id = DATA_ID_ERROR;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function compares candidates for replacement. Candidate which used its retries is weaker
+ *        than any other, otherwise lower RSSI is weaker.
+ *
+ * @param[in] p_a  Candidate.
+ * @param[in] p_b  Candidate compared to.
+ *
+ * @return    true if p_a is weaker than p_b, otherwise false.
+ */
+
+static bool conn_manager_is_weaker(const conn_candidate_t * p_a, const conn_candidate_t * p_b)
+{
+    const bool a_used = (p_a->attempts >= CONN_MANAGER_RETRIES);
+    const bool b_used = (p_b->attempts >= CONN_MANAGER_RETRIES);
+
+    if(a_used != b_used)
+    {
+        return a_used;
+    }
+    return (p_a->rssi < p_b->rssi);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds entry of advertiser, or entry it may take. Stale candidates are freed.
+ *        Free entry is preferred, then candidate which used its retries, then the weakest one.
+ *
+ * @param[in] p_addr   Address of advertiser.
+ * @param[in] data_id  Data ID of sensor.
+ * @param[in] rssi     RSSI of report.
+ * @param[in] now      Master time.
+ *
+ * @return    Entry, NULL if advertiser is not kept.
+ */
+
+static conn_candidate_t * conn_manager_find(const ble_gap_addr_t * p_addr, data_id_t data_id, int8_t rssi, uint32_t now)
+{
+    conn_candidate_t * p_free = NULL;
+    conn_candidate_t * p_weak = NULL;
+    uint8_t            cnt;
+
+    for(cnt = 0; cnt < CONN_MANAGER_CANDIDATES; cnt++)
+    {
+        conn_candidate_t * p_cand = &conn_candidates[cnt];
+
+        if( (p_cand->data_id != DATA_ID_ERROR) &&
+            ((now - p_cand->last_seen) > CONN_MANAGER_STALE_TICKS) )
+        {
+            p_cand->data_id = DATA_ID_ERROR;
+        }
+
+        if(p_cand->data_id == DATA_ID_ERROR)
+        {
+            p_free = (p_free == NULL) ? p_cand : p_free;
+        }
+        else if( (p_cand->data_id == data_id) &&
+                 (memcmp((uint8_t *)&p_cand->addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) == 0) )
+        {
+            return p_cand;
+        }
+        else if( (p_weak == NULL) || conn_manager_is_weaker(p_cand, p_weak) )
+        {
+            p_weak = p_cand;
+        }
+    }
+
+    if(p_free != NULL)
+    {
+        return p_free;
+    }
+    if( (p_weak != NULL) &&
+        ((p_weak->attempts >= CONN_MANAGER_RETRIES) || (p_weak->rssi < rssi)) )
+    {
+        return p_weak;
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes connection manager.
+ */
+
+void conn_manager_init(void)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < CONN_MANAGER_CANDIDATES; cnt++)
+    {
+        conn_candidates[cnt].data_id = DATA_ID_ERROR;
+    }
+    conn_connecting = CONN_MANAGER_NONE;
+    conn_securing   = BLE_CONN_HANDLE_INVALID;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function offers advertiser of missing sensor. Advertisers of the same sensor are collected
+ *        for CONN_MANAGER_COLLECT_MS, then the one with the best RSSI, which has retries left, is connected.
+ *        Candidate which used its retries gets them again after CONN_MANAGER_COOLOFF_MS.
+ *
+ * @param[in]  p_addr       Address of advertiser.
+ * @param[in]  data_id      Sensor type and instance.
+ * @param[in]  device_name  Entry in list of sensor names.
+ * @param[in]  rssi         RSSI of report.
+ * @param[in]  open_comm    true if sensor may be served without security setup.
+ * @param[out] p_device     Filled with connected device if connection was requested.
+ *
+ * @return     true if connection was requested, otherwise false.
+ */
+
+bool conn_manager_offer(const ble_gap_addr_t * p_addr, data_id_t data_id, const uint8_t * device_name,
+                        int8_t rssi, bool open_comm, current_conn_device_t * p_device)
+{
+    const uint32_t     now    = timestamp_now();
+    conn_candidate_t * p_cand;
+    conn_candidate_t * p_best = NULL;
+    uint32_t           first  = now;
+    uint32_t           err_code;
+    uint8_t            cnt;
+
+    if(conn_manager_is_connecting())
+    {
+        return false;
+    }
+
+    p_cand = conn_manager_find(p_addr, data_id, rssi, now);
+    if(p_cand != NULL)
+    {
+        if( (p_cand->data_id != data_id) ||
+            (memcmp((uint8_t *)&p_cand->addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) != 0) )
+        {
+            memcpy((uint8_t *)&p_cand->addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t));
+            p_cand->data_id    = data_id;
+            p_cand->first_seen = now;
+            p_cand->rssi       = rssi;
+            p_cand->attempts   = 0;
+        }
+        p_cand->device_name = device_name;
+        p_cand->open_comm   = open_comm;
+        p_cand->last_seen   = now;
+        p_cand->rssi        = (int8_t)(((int16_t)p_cand->rssi + rssi) / 2);
+    }
+
+    // Strongest advertiser of sensor is connected once its advertisers were collected long enough.
+    for(cnt = 0; cnt < CONN_MANAGER_CANDIDATES; cnt++)
+    {
+        conn_candidate_t * p_entry = &conn_candidates[cnt];
+
+        // Sensor which keeps advertising is not locked out after its retries were used.
+        if( (p_entry->data_id == data_id) &&
+            (p_entry->attempts >= CONN_MANAGER_RETRIES) &&
+            ((now - p_entry->last_attempt) >= CONN_MANAGER_COOLOFF_TICKS) )
+        {
+            p_entry->attempts   = 0;
+            p_entry->first_seen = now;
+        }
+
+        if( (p_entry->data_id != data_id) ||
+            (p_entry->attempts >= CONN_MANAGER_RETRIES) )
+        {
+            continue;
+        }
+        if((now - p_entry->first_seen) > (now - first))
+        {
+            first = p_entry->first_seen;
+        }
+        if((p_best == NULL) || (p_entry->rssi > p_best->rssi))
+        {
+            p_best = p_entry;
+        }
+    }
+
+    if( (p_best == NULL) ||
+        ((now - first) < CONN_MANAGER_COLLECT_TICKS) )
+    {
+        return false;
+    }
+
+    scan_stop();
+
+    memcpy((uint8_t *)&conn_scan_param, (uint8_t *)m_scan_param, sizeof(conn_scan_param));
+    conn_scan_param.timeout = CONN_MANAGER_CONNECT_TIMEOUT_S;
+
+    p_best->attempts++;
+    p_best->last_attempt = now;
+    err_code = sd_ble_gap_connect(&p_best->addr, &conn_scan_param, m_connection_param);
+    if(err_code != NRF_SUCCESS)
+    {
+        APPL_LOG_ERROR("[CL]: Connection Request Failed, reason %lu\r\n", err_code);
+        stats_record_connect(false, 0);
+        scan_start();
+        return false;
+    }
+
+    conn_connecting = (uint8_t)(p_best - conn_candidates);
+
+    memcpy((uint8_t *)&p_device->peer_addr, (uint8_t *)&p_best->addr, sizeof(ble_gap_addr_t));
+    p_device->bonded_flag = false;
+    p_device->device_name = p_best->device_name;
+    p_device->data_id     = (data_id_t)p_best->data_id;
+    p_device->open_comm   = (p_best->open_comm != 0);
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if connection request is pending, or link connected last is not secured yet.
+ *        Security setup of that link uses device record filled for connection request, so next
+ *        request waits for it.
+ *
+ * @return    true if connection request or security setup is pending, otherwise false.
+ */
+
+bool conn_manager_is_connecting(void)
+{
+    return (conn_connecting != CONN_MANAGER_NONE) || (conn_securing != BLE_CONN_HANDLE_INVALID);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function cancels pending connection request and drops all candidates, as they were collected
+ *        for previous onboarding mode. Called from main loop while scanning is stopped.
+ */
+
+void conn_manager_cancel(void)
+{
+    uint8_t cnt;
+
+    CRITICAL_REGION_ENTER();
+
+    if(conn_connecting != CONN_MANAGER_NONE)
+    {
+        // Link may be established meanwhile, it is then handled as unexpected peer.
+        (void)sd_ble_gap_connect_cancel();
+        conn_connecting = CONN_MANAGER_NONE;
+    }
+    for(cnt = 0; cnt < CONN_MANAGER_CANDIDATES; cnt++)
+    {
+        conn_candidates[cnt].data_id = DATA_ID_ERROR;
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function handles timeout of connection request. Candidate stays in list until its retries
+ *        are used, and scanning is resumed.
+ */
+
+void conn_manager_on_timeout(void)
+{
+    if(conn_connecting == CONN_MANAGER_NONE)
+    {
+        return;
+    }
+
+    APPL_LOG("[CL]: Connection request timed out, attempt %d\r\n", conn_candidates[conn_connecting].attempts);
+
+    peer_backoff_failed(&conn_candidates[conn_connecting].addr);
+    conn_connecting = CONN_MANAGER_NONE;
+    stats_record_connect(false, 0);
+    scan_start();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function handles established connection. Time from first report of connected candidate
+ *        is recorded, and candidates of its sensor are dropped. Next connection request waits until
+ *        security setup of the link ends, see conn_manager_on_secured().
+ *
+ * @param[in] p_addr       Address of peer.
+ * @param[in] conn_handle  Handle of link.
+ */
+
+void conn_manager_on_connected(const ble_gap_addr_t * p_addr, uint16_t conn_handle)
+{
+    conn_candidate_t * p_cand;
+
+    conn_securing = conn_handle;
+
+    if(conn_connecting == CONN_MANAGER_NONE)
+    {
+        return;
+    }
+
+    p_cand = &conn_candidates[conn_connecting];
+    conn_connecting = CONN_MANAGER_NONE;
+
+    if(memcmp((uint8_t *)&p_cand->addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) == 0)
+    {
+        stats_record_connect(true, timestamp_now() - p_cand->first_seen);
+        conn_manager_drop((data_id_t)p_cand->data_id);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function handles end of security setup of link, successful or not, or its disconnection.
+ *        Scanning for next sensor may be resumed from then on.
+ *
+ * @param[in] conn_handle  Handle of link.
+ */
+
+void conn_manager_on_secured(uint16_t conn_handle)
+{
+    if(conn_securing == conn_handle)
+    {
+        conn_securing = BLE_CONN_HANDLE_INVALID;
+    }
+}
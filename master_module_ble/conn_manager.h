@@ -0,0 +1,79 @@
+
+/** @file   conn_manager.h
+ *  @brief  Connection manager which ranks sensor advertisers by RSSI,
+ *          connects the best candidate and handles connection timeouts.
+ */
+
+#ifndef CONN_MANAGER_H__
+#define CONN_MANAGER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+#include "wunderbar_common.h"
+#include "client_handling.h"
+
+#define CONN_MANAGER_CANDIDATES        4       /**< Advertisers kept over all missing sensors. */
+#define CONN_MANAGER_COLLECT_MS        300     /**< Time advertisers of sensor are collected before the strongest one is connected. */
+#define CONN_MANAGER_STALE_MS          3000    /**< Candidate not heard for this time is dropped. */
+#define CONN_MANAGER_CONNECT_TIMEOUT_S 2       /**< Timeout of connection request. */
+#define CONN_MANAGER_RETRIES           3       /**< Connection requests per candidate, candidate is skipped afterwards. */
+#define CONN_MANAGER_COOLOFF_MS        30000   /**< Time candidate which used its retries is skipped, its retries are given again afterwards. */
+
+/** @brief  Initialize connection manager.
+ *
+ *  @return Void.
+ */
+void conn_manager_init(void);
+
+/** @brief  Offer advertiser of missing sensor. Advertisers of the same sensor are collected for
+ *          CONN_MANAGER_COLLECT_MS, then the one with the best RSSI is connected. Called from BLE event handler.
+ *
+ *  @param  p_addr       Address of advertiser.
+ *  @param  data_id      Sensor type and instance.
+ *  @param  device_name  Entry in list of sensor names.
+ *  @param  rssi         RSSI of report.
+ *  @param  open_comm    true if sensor may be served without security setup.
+ *  @param  p_device     Filled with connected device if connection was requested.
+ *
+ *  @return true if connection was requested, otherwise false.
+ */
+bool conn_manager_offer(const ble_gap_addr_t * p_addr, data_id_t data_id, const uint8_t * device_name,
+                        int8_t rssi, bool open_comm, current_conn_device_t * p_device);
+
+/** @brief  Check if connection request is pending, or link connected last is not secured yet.
+ *
+ *  @return true if connection request or security setup is pending, otherwise false.
+ */
+bool conn_manager_is_connecting(void);
+
+/** @brief  Cancel pending connection request and drop all candidates.
+ *
+ *  @return Void.
+ */
+void conn_manager_cancel(void);
+
+/** @brief  Handle timeout of connection request. Scanning is resumed.
+ *
+ *  @return Void.
+ */
+void conn_manager_on_timeout(void);
+
+/** @brief  Handle established connection.
+ *
+ *  @param  p_addr       Address of peer.
+ *  @param  conn_handle  Handle of link.
+ *
+ *  @return Void.
+ */
+void conn_manager_on_connected(const ble_gap_addr_t * p_addr, uint16_t conn_handle);
+
+/** @brief  Handle end of security setup of link, or its disconnection.
+ *
+ *  @param  conn_handle  Handle of link.
+ *
+ *  @return Void.
+ */
+void conn_manager_on_secured(uint16_t conn_handle);
+
+#endif // CONN_MANAGER_H__
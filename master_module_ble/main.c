@@ -17,17 +17,33 @@
 #include "nrf6310.h"
 #include "pstorage_driver.h"
 #include "device_manager.h"
+#include "ble_hci.h"
 #include "debug.h"
 #include "spi_slave_config.h"
 #include "onboard.h"
-
-#define APPL_LOG                         debug_log                                      /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#include "stats.h"
+#include "work_flags.h"
+#include "timestamp.h"
+#include "value_cache.h"
+#include "sensor_slots.h"
+#include "rotation.h"
+#include "adv_ingest.h"
+#include "adv_inventory.h"
+#include "conn_manager.h"
+#include "peer_backoff.h"
+#include "app_timer.h"
+
+#define APPL_LOG(...)                    debug_log_module(DEBUG_MODULE_AP, DEBUG_LEVEL_INFO, __VA_ARGS__)  /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#define APPL_LOG_ERROR(...)              debug_log_module(DEBUG_MODULE_AP, DEBUG_LEVEL_ERROR, __VA_ARGS__) /**< Debug logger macro used for error messages. */
 
 #define SEC_PARAM_MITM                   1                                              /**< Man In The Middle protection required. */
 
 #define MAX_PEER_COUNT                   DEVICE_MANAGER_MAX_CONNECTIONS                 /**< Maximum number of peer's application intends to manage. */
 #define UUID16_SIZE                      2                                              /**< Size of 16 bit UUID */
 
+#define APP_TIMER_MAX_TIMERS             4                                              /**< Maximum number of simultaneously created timers. */
+#define APP_TIMER_OP_QUEUE_SIZE          2                                              /**< Size of timer operation queues. Client and rotation timers queue one operation each at most, others are started once. */
+
 const char CENTRAL_BLE_FIRMWARE_REV[20] = "1.0.2";
 
 //used to limit torrent of power manage traces
@@ -52,17 +68,29 @@ typedef struct
 }
 data_t;
 
-extern const ble_gap_sec_params_t*  sec_params;
+/**@brief Link paired directly with SoftDevice, see direct_pairing_start(). */
+
+typedef struct
+{
+    dm_handle_t handle;         /**< Device Manager Handle of peer. */
+    uint16_t    conn_handle;    /**< Connection handle of link, BLE_CONN_HANDLE_INVALID if link pairs through device manager. */
+}
+direct_pairing_t;
+
 extern const ble_gap_conn_params_t* m_connection_param;
 extern const ble_gap_scan_params_t* m_scan_param;
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static dm_application_instance_t m_dm_app_id;              /**< Application identifier. */
+static direct_pairing_t          m_direct_pairing[MAX_CLIENTS];    /**< Links paired directly in config mode, indexed by connection id. */
+static uint8_t                   m_bonds_onboarded;                /**< Device ids of bonded sensors connected in config mode, bit per id. */
 static current_conn_device_t     current_conn_device;
 
 passkey_t  sensors_passkey[MAX_CLIENTS] __attribute__((aligned(4)));
 
+extern sensor_slot_t sensor_slots[SENSOR_SLOTS_NUM];
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -77,7 +105,7 @@ passkey_t  sensors_passkey[MAX_CLIENTS] __attribute__((aligned(4)));
 
 void app_error_handler(uint32_t error_code, uint32_t line_num, const uint8_t * p_file_name)
 {
-    APPL_LOG("[AP]: ASSERT: %s, %lu, error 0x%08lx\r\n", p_file_name, line_num, error_code);
+    APPL_LOG_ERROR("[AP]: ASSERT: %s, %lu, error 0x%08lx\r\n", p_file_name, line_num, error_code);
 
     // This call can be used for debug purposes during development of an application.
     // @note CAUTION: Activating this code will write the stack to flash on an error.
@@ -114,6 +142,127 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
     app_error_handler(0xDEADBEEF, line_num, p_file_name);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function deletes bond of peer whose stored keys were rejected, so that peer is paired again
+ *        on next connection instead of being held back.
+ *
+ * @param   p_handle  Device Manager Handle of peer.
+ */
+
+static void bond_forget(const dm_handle_t * p_handle)
+{
+    uint32_t err_code;
+
+    APPL_LOG("[AP]: [0x%02X] Stored keys rejected, deleting bond\r\n", p_handle->connection_id);
+    err_code = dm_device_delete(p_handle);
+    if(err_code != NRF_SUCCESS)
+    {
+        APPL_LOG_ERROR("[AP]: Bond delete failed, reason %lu\r\n", err_code);
+    }
+    current_conn_device.bonded_flag = false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if link is encrypted with keys of MITM authenticated pairing. Bonds
+ *        without MITM, e.g. from Just Works pairing, shall not replace passkey pairing.
+ *
+ * @param   conn_handle  Connection handle of link.
+ *
+ * @return  true if link is authenticated, otherwise false.
+ */
+
+static bool link_is_authenticated(uint16_t conn_handle)
+{
+    ble_gap_conn_sec_t conn_sec;
+
+    if(sd_ble_gap_conn_sec_get(conn_handle, &conn_sec) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    return ( (conn_sec.sec_mode.sm == 1) && (conn_sec.sec_mode.lv >= 3) );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function pairs link of config mode directly with SoftDevice.
+ *
+ * @details Device manager is registered once with run mode params and applies them to every
+ *          procedure it starts. Config mode pairs with its own params instead: Just Works without
+ *          bonding, no keys are distributed, so device manager has nothing to store for the link.
+ *          Device manager still sees BLE_GAP_EVT_AUTH_STATUS of this procedure, its security events
+ *          for the link are ignored and the result is taken from BLE_GAP_EVT_AUTH_STATUS in
+ *          on_ble_evt() instead. No passkey is requested, as config params have no IO capabilities.
+ *
+ * @param   p_handle     Device Manager Handle of peer.
+ * @param   conn_handle  Connection handle of link.
+ *
+ * @return  NRF_SUCCESS on success, otherwise an error code.
+ */
+
+static uint32_t direct_pairing_start(const dm_handle_t * p_handle, uint16_t conn_handle)
+{
+    const ble_gap_sec_params_t * p_params = onboard_get_sec_params(ONBOARD_MODE_CONFIG);
+
+    m_direct_pairing[p_handle->connection_id].handle      = (*p_handle);
+    m_direct_pairing[p_handle->connection_id].conn_handle = conn_handle;
+
+    return sd_ble_gap_authenticate(conn_handle, p_params);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if link is paired directly, see direct_pairing_start().
+ *
+ * @param   connection_id  Connection id of link.
+ *
+ * @return  true if link is paired directly, otherwise false.
+ */
+
+static bool direct_pairing_is_active(uint8_t connection_id)
+{
+    return ( (connection_id < MAX_CLIENTS) && (m_direct_pairing[connection_id].conn_handle != BLE_CONN_HANDLE_INVALID) );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function deletes bonds of sensors which were connected in config mode. Their passkey may
+ *        have been changed by onboarding, so they are paired with passkey on next connection.
+ *        Config mode itself creates no bonds.
+ *
+ * @return Void.
+ */
+
+static void bonds_delete_onboarded(void)
+{
+    uint32_t    err_code;
+    dm_handle_t handle;
+
+    handle.appl_id       = m_dm_app_id;
+    handle.connection_id = DM_INVALID_ID;
+    handle.service_id    = DM_INVALID_ID;
+
+    for(handle.device_id = 0; handle.device_id < DEVICE_MANAGER_MAX_BONDS; handle.device_id++)
+    {
+        if((m_bonds_onboarded & (1 << handle.device_id)) != 0)
+        {
+            APPL_LOG("[AP]: Deleting bond %d of onboarded sensor\r\n", handle.device_id);
+            err_code = dm_device_delete(&handle);
+            if(err_code != NRF_SUCCESS)
+            {
+                APPL_LOG_ERROR("[AP]: Bond delete failed, reason %lu\r\n", err_code);
+            }
+        }
+    }
+    m_bonds_onboarded = 0;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -146,19 +295,65 @@ static api_result_t device_manager_event_handler(const dm_handle_t    * p_handle
                             p_peer_addr->addr[0], p_peer_addr->addr[1], p_peer_addr->addr[2],
                             p_peer_addr->addr[3], p_peer_addr->addr[4], p_peer_addr->addr[5], current_conn_device.device_name);
 
-            if(memcmp((uint8_t *)&current_conn_device.peer_addr, (uint8_t *)p_peer_addr, sizeof(ble_gap_addr_t)) == 0)
+            conn_manager_on_connected(p_peer_addr, p_event->event_param.p_gap_param->conn_handle);
+
+            current_conn_device.connected_ticks = timestamp_now();
+
+            if(memcmp((uint8_t *)&current_conn_device.peer_addr, (uint8_t *)p_peer_addr, sizeof(ble_gap_addr_t)) != 0)
             {
-                APPL_LOG("[AP]: [CI 0x%02X]: Requesting GAP Authenticate\r\n", p_handle->connection_id);
+                APPL_LOG("[AP]: Wrong Peer Address\r\n");
+                sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
+            }
+            else if(current_conn_device.open_comm)
+            {
+                // Sensor offers open Relayr service and policy lets it skip security setup.
+                APPL_LOG("[AP]: [CI 0x%02X]: Open communication, no security setup\r\n", p_handle->connection_id);
+                conn_manager_on_secured(p_event->event_param.p_gap_param->conn_handle);
 
-                dm_handle_t handle = (*p_handle);
-                err_code = dm_security_setup_req(&handle);
-                APP_ERROR_CHECK(err_code);
+                err_code = client_handling_create(p_handle, p_event->event_param.p_gap_param->conn_handle, &current_conn_device, true);
+                if(err_code != NRF_SUCCESS)
+                {
+                    sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
+                }
+                else
+                {
+                    peer_backoff_succeeded(&current_conn_device.peer_addr);
+                }
+            }
+            else if(onboard_get_mode() == ONBOARD_MODE_CONFIG)
+            {
+                APPL_LOG("[AP]: [CI 0x%02X]: Requesting GAP Authenticate, config mode\r\n", p_handle->connection_id);
 
+                // Stored keys are not used for onboarding, bond is deleted when mode switches to run.
+                if(p_handle->device_id != DM_INVALID_ID)
+                {
+                    m_bonds_onboarded |= (1 << p_handle->device_id);
+                }
+                current_conn_device.bonded_flag = false;
+
+                err_code = direct_pairing_start(p_handle, p_event->event_param.p_gap_param->conn_handle);
+                APP_ERROR_CHECK(err_code);
             }
             else
             {
-                APPL_LOG("[AP]: Wrong Peer Address\r\n");
-                sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
+                dm_handle_t handle = (*p_handle);
+
+                APPL_LOG("[AP]: [CI 0x%02X]: Requesting GAP Authenticate\r\n", p_handle->connection_id);
+
+                // Link of bonded sensor is encrypted with stored keys, no pairing.
+                err_code = dm_security_setup_req(&handle);
+                APP_ERROR_CHECK(err_code);
+
+                // Discovery does not need encrypted link, so it runs while link of bonded sensor is encrypted.
+                if(p_handle->device_id != DM_INVALID_ID)
+                {
+                    current_conn_device.bonded_flag = true;
+                    err_code = client_handling_create(p_handle, p_event->event_param.p_gap_param->conn_handle, &current_conn_device, false);
+                    if(err_code != NRF_SUCCESS)
+                    {
+                        sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
+                    }
+                }
             }
 
 
@@ -172,6 +367,19 @@ static api_result_t device_manager_event_handler(const dm_handle_t    * p_handle
             uint16_t conf_client_connection_id;
             APPL_LOG("[AP]: [0x%02X] >> DM_EVT_DISCONNECTION\r\n", p_handle->connection_id);
 
+            // Bonded sensor which lost its keys is paired again on next connection.
+            if( (p_handle->device_id != DM_INVALID_ID) &&
+                (p_event->event_param.p_gap_param->params.disconnected.reason == BLE_HCI_STATUS_CODE_PIN_OR_KEY_MISSING) )
+            {
+                bond_forget(p_handle);
+            }
+
+            if(p_handle->connection_id < MAX_CLIENTS)
+            {
+                m_direct_pairing[p_handle->connection_id].conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            conn_manager_on_secured(p_event->event_param.p_gap_param->conn_handle);
+
             // Try to destroy client.
             err_code = client_handling_destroy(p_handle);
 
@@ -192,20 +400,55 @@ static api_result_t device_manager_event_handler(const dm_handle_t    * p_handle
         {
             APPL_LOG("[AP]: [0x%02X] >> DM_EVT_SECURITY_SETUP_COMPLETE, result 0x%08lX\r\n", p_handle->connection_id, event_result);
 
-            if(event_result == NRF_SUCCESS)
+            // Next sensor may be connected, current_conn_device is not used for this link any more.
+            if(direct_pairing_is_active(p_handle->connection_id) == false)
             {
-                APPL_LOG("[AP]: [CI 0x%02X]: Requesting GATT client create\r\n", p_handle->connection_id);
-                err_code = client_handling_create(p_handle, p_event->event_param.p_gap_param->conn_handle, &current_conn_device);
-                if(err_code != NRF_SUCCESS)
+                conn_manager_on_secured(p_event->event_param.p_gap_param->conn_handle);
+            }
+
+            if(direct_pairing_is_active(p_handle->connection_id))
+            {
+                // Result is taken from BLE_GAP_EVT_AUTH_STATUS.
+            }
+            else if(event_result == NRF_SUCCESS)
+            {
+                peer_backoff_succeeded(&current_conn_device.peer_addr);
+
+                if(current_conn_device.bonded_flag == false)
+                {
+                    stats_record_security(false, timestamp_now() - current_conn_device.connected_ticks);
+                }
+
+                if( (current_conn_device.bonded_flag == true) &&
+                    (link_is_authenticated(p_event->event_param.p_gap_param->conn_handle) == false) )
                 {
+                    // Bond without MITM, sensor is paired with passkey on next connection.
+                    bond_forget(p_handle);
                     sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
                 }
+                else if( (current_conn_device.bonded_flag == false) ||
+                         (client_handling_on_secured(p_handle) == false) )
+                {
+                    APPL_LOG("[AP]: [CI 0x%02X]: Requesting GATT client create\r\n", p_handle->connection_id);
+                    err_code = client_handling_create(p_handle, p_event->event_param.p_gap_param->conn_handle, &current_conn_device, true);
+                    if(err_code != NRF_SUCCESS)
+                    {
+                        sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
+                    }
+                }
+            }
+            else if(current_conn_device.bonded_flag == true)
+            {
+                // Key mismatch, sensor is paired again on next connection.
+                bond_forget(p_handle);
+                sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
             }
             else
             {
-                if(onboard_get_mode() != ONBOARD_MODE_CONFIG)
+                // Unknown sensor may have passkey of another instance of its type.
+                if(sensor_slots_try_next(current_conn_device.data_id) == false)
                 {
-                    ignore_list_add(&current_conn_device.peer_addr);
+                    peer_backoff_failed(&current_conn_device.peer_addr);
                 }
                 sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
             }
@@ -227,13 +470,34 @@ static api_result_t device_manager_event_handler(const dm_handle_t    * p_handle
             APPL_LOG("[AP]: [0x%02X] >> DM_LINK_SECURED_IND bonded: %s, result 0x%08lX\r\n", p_handle->connection_id, current_conn_device.bonded_flag == true? "true":"false",event_result);
             APPL_LOG("[AP]: [0x%02X] << DM_LINK_SECURED_IND bonded: %s\r\n", p_handle->connection_id, current_conn_device.bonded_flag == true? "true":"false");
 
-                if(current_conn_device.bonded_flag == true)
+                if( (current_conn_device.bonded_flag == false) ||
+                    direct_pairing_is_active(p_handle->connection_id) )
                 {
-                        err_code = client_handling_create(p_handle, p_event->event_param.p_gap_param->conn_handle, &current_conn_device);
+                    // Link secured by pairing, client is created on DM_EVT_SECURITY_SETUP_COMPLETE or BLE_GAP_EVT_AUTH_STATUS.
+                }
+                else if( (event_result == NRF_SUCCESS) &&
+                         link_is_authenticated(p_event->event_param.p_gap_param->conn_handle) )
+                {
+                    conn_manager_on_secured(p_event->event_param.p_gap_param->conn_handle);
+                    peer_backoff_succeeded(&current_conn_device.peer_addr);
+                    stats_record_security(true, timestamp_now() - current_conn_device.connected_ticks);
+
+                    // Client is created here if bond was not known at connection.
+                    if(client_handling_on_secured(p_handle) == false)
+                    {
+                        err_code = client_handling_create(p_handle, p_event->event_param.p_gap_param->conn_handle, &current_conn_device, true);
                         if(err_code != NRF_SUCCESS)
                         {
-                                sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
+                            sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
                         }
+                    }
+                }
+                else
+                {
+                    // Key mismatch or bond without MITM, sensor is paired again on next connection.
+                    conn_manager_on_secured(p_event->event_param.p_gap_param->conn_handle);
+                    bond_forget(p_handle);
+                    sd_ble_gap_disconnect(p_handle->connection_id, 0x13);
                 }
 
             break;
@@ -273,9 +537,9 @@ static api_result_t device_manager_event_handler(const dm_handle_t    * p_handle
 
         case DM_EVT_ERROR:
         {
-            APPL_LOG("[AP]: [0x%02X] >> DM_EVT_ERROR\r\n", p_handle->connection_id);
+            APPL_LOG_ERROR("[AP]: [0x%02X] >> DM_EVT_ERROR\r\n", p_handle->connection_id);
             APP_ERROR_CHECK(event_result);
-            APPL_LOG("[AP]: [0x%02X] << DM_EVT_ERROR\r\n", p_handle->connection_id);
+            APPL_LOG_ERROR("[AP]: [0x%02X] << DM_EVT_ERROR\r\n", p_handle->connection_id);
             break;
         }
 
@@ -353,6 +617,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
         {
             data_t adv_data;
             data_t type_data;
+            bool   open_comm;
 
             if(onboard_get_mode() == ONBOARD_MODE_IDLE)
             {
@@ -364,6 +629,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
             if(ignore_list_search(peer_addr) == true)
             {
                 APPL_LOG("[AP]: Device is in ignore list\r\n");
+                adv_inventory_seen(peer_addr, DATA_ID_ERROR, p_ble_evt->evt.gap_evt.params.adv_report.rssi);
                 return;
             }
 
@@ -374,7 +640,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
             err_code = adv_report_parse(BLE_GAP_AD_TYPE_16BIT_SERVICE_UUID_COMPLETE, &adv_data, &type_data);
 
             // Verify if list of services matches target.
-            if( (err_code == NRF_SUCCESS) && (memcmp((uint8_t *)onboard_get_service_list(), type_data.p_data, type_data.data_len) == 0))
+            if( (err_code == NRF_SUCCESS) && onboard_match_service_list(type_data.p_data, type_data.data_len, &open_comm) )
             {
                 err_code = adv_report_parse(BLE_GAP_AD_TYPE_COMPLETE_LOCAL_NAME, &adv_data, &type_data);
 
@@ -382,34 +648,48 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
                 if (err_code == NRF_SUCCESS)
                 {
                     const uint8_t * found_device_name;
+                    data_id_t       data_id = DATA_ID_ERROR;
 
                     if(validate_device_name(type_data.p_data, type_data.data_len, &found_device_name) == false)
                     {
-                        APPL_LOG("[AP]: Invalid device name %s len %d. Adding to ignore list\r\n", type_data.p_data, type_data.data_len);
+                        APPL_LOG_ERROR("[AP]: Invalid device name %s len %d. Adding to ignore list\r\n", type_data.p_data, type_data.data_len);
                         ignore_list_add(&p_ble_evt->evt.gap_evt.params.adv_report.peer_addr);
                     }
-                    else if(find_client_by_dev_name(type_data.p_data, type_data.data_len) != NULL)
+                    else if((data_id = sensor_slots_resolve((data_id_t)sensor_get_name_index(found_device_name), peer_addr)) == DATA_ID_ERROR)
                     {
-                        APPL_LOG("[AP]: Device with this name is already connected.\r\n");
+                        APPL_LOG("[AP]: No free instance of %s.\r\n", found_device_name);
                     }
-                    else
+                    else if(adv_ingest_is_enabled(data_id))
                     {
-                        APPL_LOG("\r\n[AP]: Found device %s\r\n\r\n", found_device_name);
-                        scan_stop();
-
-                        err_code = sd_ble_gap_connect(&p_ble_evt->evt.gap_evt.params.adv_report.peer_addr, m_scan_param, m_connection_param);
-                        if (err_code == NRF_SUCCESS)
-                        {
-                                memcpy((uint8_t *)&current_conn_device.peer_addr, (uint8_t *)peer_addr, sizeof(ble_gap_addr_t));
-                                current_conn_device.bonded_flag = false;
-                                current_conn_device.device_name = found_device_name;
-                        }
-                        else
+                        // Sensor is not connected, its data is taken from advertising packets.
+                        if(adv_report_parse(BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA, &adv_data, &type_data) == NRF_SUCCESS)
                         {
-                                APPL_LOG("[AP]: Connection Request Failed, reason %lu\r\n", err_code);
+                            adv_ingest_process(data_id, peer_addr, type_data.p_data, type_data.data_len);
                         }
-
                     }
+                    else if(find_client_by_data_id(data_id) != NULL)
+                    {
+                        APPL_LOG("[AP]: Device with this name is already connected.\r\n");
+                    }
+                    else if(rotation_may_connect(data_id) == false)
+                    {
+                        APPL_LOG("[AP]: Device %s waits for its rotation slot.\r\n", found_device_name);
+                    }
+                    else if(get_active_client_number() >= MAX_CLIENTS)
+                    {
+                        // Scanning goes on for advertising ingest while all links are used.
+                    }
+                    else if(peer_backoff_is_waiting(peer_addr))
+                    {
+                        APPL_LOG("[AP]: Device %s is held back after failure.\r\n", found_device_name);
+                    }
+                    else if(conn_manager_offer(peer_addr, data_id, found_device_name, p_ble_evt->evt.gap_evt.params.adv_report.rssi,
+                                               open_comm && onboard_open_comm_allowed(data_id), &current_conn_device))
+                    {
+                        APPL_LOG("\r\n[AP]: Found device %s\r\n\r\n", current_conn_device.device_name);
+                    }
+
+                    adv_inventory_seen(peer_addr, data_id, p_ble_evt->evt.gap_evt.params.adv_report.rssi);
                 }
             }
             break;
@@ -427,6 +707,7 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
             else if (p_ble_evt->evt.gap_evt.params.timeout.src == BLE_GAP_TIMEOUT_SRC_CONN)
             {
                 APPL_LOG("[AP]: Connection Request Timedout.\r\n");
+                conn_manager_on_timeout();
             }
             break;
         }
@@ -434,12 +715,58 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
 
         case BLE_GAP_EVT_AUTH_KEY_REQUEST:
         {
-            uint8_t passkey_index;
+            const uint8_t * passkey;
             APPL_LOG("[AP]: Authentication Key Request Received\r\n");
-            passkey_index = sensor_get_name_index(current_conn_device.device_name);
-            err_code = sd_ble_gap_auth_key_reply(p_ble_evt->evt.gap_evt.conn_handle, BLE_GAP_AUTH_KEY_TYPE_PASSKEY, sensors_passkey[passkey_index]);
+            passkey = sensor_slots_get_passkey(current_conn_device.data_id);
+            if(passkey == NULL)
+            {
+                passkey = DEFAULT_SENSOR_PASSKEY;
+            }
+            err_code = sd_ble_gap_auth_key_reply(p_ble_evt->evt.gap_evt.conn_handle, BLE_GAP_AUTH_KEY_TYPE_PASSKEY, passkey);
             APP_ERROR_CHECK(err_code);
-            APPL_LOG("[AP]: Authentication Key Response Send -> %s\r\n", sensors_passkey[passkey_index]);
+            APPL_LOG("[AP]: Authentication Key Response Send -> %s\r\n", passkey);
+            break;
+        }
+
+        case BLE_GAP_EVT_AUTH_STATUS:
+        {
+            uint8_t connection_id;
+
+            // Only links paired directly are handled here, device manager reports the others.
+            for(connection_id = 0; connection_id < MAX_CLIENTS; connection_id++)
+            {
+                if(m_direct_pairing[connection_id].conn_handle == p_ble_evt->evt.gap_evt.conn_handle)
+                {
+                    break;
+                }
+            }
+            if(connection_id == MAX_CLIENTS)
+            {
+                break;
+            }
+
+            APPL_LOG("[AP]: [0x%02X] Direct pairing status 0x%02X\r\n", connection_id, p_ble_evt->evt.gap_evt.params.auth_status.auth_status);
+            conn_manager_on_secured(p_ble_evt->evt.gap_evt.conn_handle);
+
+            if(p_ble_evt->evt.gap_evt.params.auth_status.auth_status == BLE_GAP_SEC_STATUS_SUCCESS)
+            {
+                peer_backoff_succeeded(&current_conn_device.peer_addr);
+                stats_record_security(false, timestamp_now() - current_conn_device.connected_ticks);
+
+                err_code = client_handling_create(&m_direct_pairing[connection_id].handle, p_ble_evt->evt.gap_evt.conn_handle, &current_conn_device, true);
+                if(err_code != NRF_SUCCESS)
+                {
+                    sd_ble_gap_disconnect(p_ble_evt->evt.gap_evt.conn_handle, 0x13);
+                }
+            }
+            else
+            {
+                if(sensor_slots_try_next(current_conn_device.data_id) == false)
+                {
+                    peer_backoff_failed(&current_conn_device.peer_addr);
+                }
+                sd_ble_gap_disconnect(p_ble_evt->evt.gap_evt.conn_handle, 0x13);
+            }
             break;
         }
 
@@ -466,9 +793,13 @@ static void on_ble_evt(ble_evt_t * p_ble_evt)
  */
 static void ble_evt_dispatch(ble_evt_t * p_ble_evt)
 {
+    const uint32_t stats_start = stats_path_begin();
+
     dm_ble_evt_handler(p_ble_evt);
     client_handling_ble_evt_handler(p_ble_evt);
     on_ble_evt(p_ble_evt);
+
+    stats_path_end(STATS_PATH_BLE_EVT, stats_start);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -531,7 +862,8 @@ static void ble_stack_init(void)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief Function for initializing the Device Manager.
  *
- * @details Device manager is initialized here.
+ * @details Device manager is initialized here. It is registered once with run mode security params,
+ *          config mode pairs its links directly, see direct_pairing_start().
  *
  * @param   sec_params  Pointer to security params structure.
  *
@@ -544,9 +876,16 @@ static void device_manager_init(const ble_gap_sec_params_t * sec_params)
     dm_init_param_t        init_param;
 
     uint32_t err_code;
+    uint8_t  connection_id;
+
+    for(connection_id = 0; connection_id < MAX_CLIENTS; connection_id++)
+    {
+        m_direct_pairing[connection_id].conn_handle = BLE_CONN_HANDLE_INVALID;
+    }
+    m_bonds_onboarded = 0;
 
-    // Clear all bonded devices if user requests to.
-    init_param.clear_persistent_data = true;
+    // Bonds are kept in run mode, so known sensors reconnect without pairing. Onboarding starts clean.
+    init_param.clear_persistent_data = (onboard_get_mode() == ONBOARD_MODE_CONFIG);
 
     err_code = dm_init(&init_param);
     APPL_LOG("[DM]: init, status: %lu \r\n", err_code);
@@ -565,8 +904,9 @@ static void device_manager_init(const ble_gap_sec_params_t * sec_params)
     // Secuirty parameters to be used for security procedures.
     memcpy((uint8_t*)&param.sec_param, (uint8_t*)sec_params, sizeof(ble_gap_sec_params_t));
 
-    param.sec_param.kdist_periph.enc   = 1;
-    param.sec_param.kdist_periph.id    = 1;
+    // Keys are distributed only if they are kept.
+    param.sec_param.kdist_periph.enc   = param.sec_param.bond;
+    param.sec_param.kdist_periph.id    = param.sec_param.bond;
 
     err_code = dm_register(&m_dm_app_id,&param);
     APPL_LOG("[DM]: register, status: %lu \r\n", err_code);
@@ -622,7 +962,9 @@ bool init_global(uint8_t * global, uint8_t * default_value, uint16_t size)
 
 bool pstorage_driver_init()
 {
-    uint32_t err_code;
+    uint32_t      err_code;
+    sensor_slot_t free_slot;
+    uint8_t       cnt;
 
     err_code = pstorage_init();
     APP_ERROR_CHECK(err_code);
@@ -665,6 +1007,17 @@ bool pstorage_driver_init()
         return false;
     }
 
+    // Read sensor instance slots from p_storage, empty blocks are free slots.
+    memset((uint8_t *)&free_slot, 0xFF, sizeof(free_slot));
+    for(cnt = 0; cnt < SENSOR_SLOTS_NUM; cnt++)
+    {
+        if(!init_global((uint8_t*)&sensor_slots[cnt], (uint8_t*)&free_slot, sizeof(sensor_slot_t)))
+        {
+            return false;
+        }
+    }
+    sensor_slots_init();
+
     return true;
 }
 
@@ -686,6 +1039,104 @@ static void power_manage(void)
 
     uint32_t err_code = sd_app_evt_wait();
     APP_ERROR_CHECK(err_code);
+
+    stats_count_wakeup();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function runs handlers with pending work, until there is no more work to do.
+ *
+ * @param mask  Work flags which are handled in current mode.
+ *
+ * @return Void.
+ *
+ */
+
+static void run_pending_work(uint32_t mask)
+{
+    uint32_t work;
+    uint32_t stats_start;
+    const uint32_t active_start = stats_path_begin();
+
+    while((work = work_flags_take(mask)) != 0)
+    {
+        if(work & WORK_FLAG_ONBOARD)
+        {
+            stats_start = stats_path_begin();
+            onboard_state_handle();
+            stats_path_end(STATS_PATH_ONBOARD, stats_start);
+        }
+
+        if(work & WORK_FLAG_PSTORAGE)
+        {
+            stats_start = stats_path_begin();
+            pstorage_driver_run();
+            stats_path_end(STATS_PATH_PSTORAGE_RUN, stats_start);
+        }
+
+        if(work & WORK_FLAG_CLIENT_EVENT)
+        {
+            stats_start = stats_path_begin();
+            search_for_client_event();
+            stats_path_end(STATS_PATH_CLIENT_EVENT, stats_start);
+        }
+
+        if(work & WORK_FLAG_SPI_RX)
+        {
+            stats_start = stats_path_begin();
+            spi_process_rx_queue();
+            stats_path_end(STATS_PATH_SPI_RX, stats_start);
+        }
+
+        if(work & WORK_FLAG_SPI_TX)
+        {
+            adv_inventory_dump_next();
+            spi_check_tx_ready();
+        }
+
+        if(work & WORK_FLAG_ROTATION)
+        {
+            rotation_run();
+        }
+
+        if(work & WORK_FLAG_CLIENT_TIMEOUT)
+        {
+            check_client_timeout();
+        }
+    }
+
+    stats_path_end(STATS_PATH_ACTIVE, active_start);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function switches onboarding mode while stack, device manager and links of running sensors
+ *        stay up. Their notifications are forwarded meanwhile, only scanning pauses. Bonds of sensors
+ *        connected in config mode are deleted when run mode is entered.
+ *
+ * @param   onboard_mode  New onboarding mode.
+ *
+ * @return Void.
+ */
+
+static void mode_switch(onboard_mode_t onboard_mode)
+{
+    const uint32_t stats_start = stats_path_begin();
+
+    scan_stop();
+    conn_manager_cancel();
+    onboard_set_sec_params(onboard_mode);
+    client_handling_set_mode(onboard_mode);
+    if(onboard_mode == ONBOARD_MODE_RUN)
+    {
+        bonds_delete_onboarded();
+    }
+    scan_start();
+
+    stats_path_end(STATS_PATH_MODE_SWITCH, stats_start);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -700,6 +1151,17 @@ int main(void)
     debug_init();
     APPL_LOG("[AP]: SD Clock init\r\n\r\n");
     softdevice_clock_init();
+    APPL_LOG("[AP]: Timers init\r\n\r\n");
+    APP_TIMER_INIT(APP_TIMER_PRESCALER, APP_TIMER_MAX_TIMERS, APP_TIMER_OP_QUEUE_SIZE, false);
+    stats_init();
+    timestamp_init();
+    value_cache_init();
+    rotation_init();
+    adv_ingest_init();
+    adv_inventory_init();
+    conn_manager_init();
+    peer_backoff_init();
+    timers_init();
     APPL_LOG("[AP]: Pstorage init\r\n\r\n");
     pstorage_driver_init();
     APPL_LOG("[AP]: SPI init\r\n\r\n");
@@ -715,8 +1177,15 @@ int main(void)
 
         if(ONBOARD_MODE_IDLE == curr_mode)
         {
-            spi_check_tx_ready();
-            power_manage();
+            // Only SPI is served until mode is selected, the rest of work stays pending.
+            run_pending_work(WORK_FLAG_SPI_RX | WORK_FLAG_SPI_TX);
+            debug_poll();
+
+            // Mode selected by command just executed is entered without waiting for next event.
+            if(ONBOARD_MODE_IDLE == onboard_get_mode())
+            {
+                power_manage();
+            }
         }
         else
         {
@@ -725,25 +1194,29 @@ int main(void)
             onboard_set_sec_params(curr_mode);
 
             APPL_LOG("[AP]: DM init\r\n\r\n");
-            device_manager_init(sec_params);
+            device_manager_init(onboard_get_sec_params(ONBOARD_MODE_RUN));
 
             // Start scanning for devices.
             APPL_LOG("[AP]: Start Scan\r\n\r\n");
             scan_start();
 
+            // Mode never returns to idle, later switches keep stack and links up.
+            onboard_mode_t active_mode = curr_mode;
+
             for (;;)
             {
-                power_manage();
-                onboard_state_handle();
-                pstorage_driver_run();
-                search_for_client_event();
-                spi_check_tx_ready();
-                if (curr_mode != onboard_get_mode())
+                run_pending_work(WORK_FLAG_ONBOARD | WORK_FLAG_PSTORAGE | WORK_FLAG_CLIENT_EVENT | WORK_FLAG_SPI_RX | WORK_FLAG_SPI_TX | WORK_FLAG_ROTATION | WORK_FLAG_CLIENT_TIMEOUT);
+                debug_poll();
+                if (active_mode != onboard_get_mode())
                 {
-                    APPL_LOG("[AP]: Switch modes from %d to %d\n", curr_mode, onboard_get_mode());
-                    scan_stop();
-                    break;
+                    APPL_LOG("[AP]: Switch modes from %d to %d\n", active_mode, onboard_get_mode());
+                    active_mode = onboard_get_mode();
+                    mode_switch(active_mode);
+
+                    // Work flagged by the switch from thread mode raises no event, it is run before sleeping.
+                    continue;
                 }
+                power_manage();
             }
         }
     }
@@ -12,10 +12,15 @@
 #include "spi_slave_config.h"
 #include "pstorage_driver.h"
 #include "debug.h"
+#include "work_flags.h"
+#include "sensor_slots.h"
+#include <string.h>
 
-#define APPL_LOG        debug_log      /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#define APPL_LOG(...)        debug_log_module(DEBUG_MODULE_OB, DEBUG_LEVEL_INFO, __VA_ARGS__)   /**< Debug logger macro that will be used in this file to do logging of debug information over UART. */
+#define APPL_LOG_ERROR(...)  debug_log_module(DEBUG_MODULE_OB, DEBUG_LEVEL_ERROR, __VA_ARGS__)  /**< Debug logger macro used for error messages. */
 
 #define SEC_PARAM_BOND                   1                                              /**< Perform bonding. */
+#define SEC_PARAM_NO_BOND                0                                              /**< Pair without bonding. */
 #define SEC_PARAM_OOB                    0                                              /**< Out Of Band data not available. */
 #define SEC_PARAM_MIN_KEY_SIZE           7                                              /**< Minimum encryption key size. */
 #define SEC_PARAM_MAX_KEY_SIZE           16                                             /**< Maximum encryption key size. */
@@ -33,9 +38,10 @@ static const ble_gap_sec_params_t  sec_params_run_mode =
     SEC_PARAM_MAX_KEY_SIZE        // max_key_size
 };
 
+/** Config mode pairs without MITM and keeps no keys, so sensors pair with passkey in run mode. */
 static const ble_gap_sec_params_t  sec_params_config_mode =
 {
-    SEC_PARAM_BOND,               // bond
+    SEC_PARAM_NO_BOND,            // bond
     0,                            // mitm
     BLE_GAP_IO_CAPS_NONE,         // io_caps
     SEC_PARAM_OOB,                // oob
@@ -101,6 +107,11 @@ bool onboard_store_passkeys = false;
 
 static const uint16_t service_uuid_list_config_mode[3] = {SHORT_SERVICE_CONFIG_UUID, BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_BATTERY_SERVICE};
 static const uint16_t service_uuid_list_run_mode[3]    = {SHORT_SERVICE_RELAYR_UUID, BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_BATTERY_SERVICE};
+static const uint16_t service_uuid_list_open_comm[3]   = {SHORT_SERVICE_RELAYR_OPEN_COMM_UUID, BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_BATTERY_SERVICE};
+
+/**@brief  Sensor types allowed to skip security setup when they offer open Relayr service, bit n for type n.
+ *         No type is allowed until host allows it with FIELD_ID_OPEN_COMM, every sensor pairs as usual. */
+static uint8_t onboard_open_comm_types = 0;
 
 /** @brief  Set onboarding mode.
  *
@@ -136,6 +147,10 @@ void onboard_set_state(onboard_state_t new_state)
 {
     APPL_LOG("[OB]: Set state %d\r\n", new_state);
     onboard_state = new_state;
+    if(new_state != ONBOARD_STATE_IDLE)
+    {
+        work_flags_set(WORK_FLAG_ONBOARD);
+    }
 }
 
 void onboard_set_sec_params(onboard_mode_t onboard_mode)
@@ -151,6 +166,18 @@ void onboard_set_sec_params(onboard_mode_t onboard_mode)
     }
 }
 
+/** @brief  Get security params of onboarding mode.
+ *
+ *  @param  onboard_mode  Onboarding mode.
+ *
+ *  @return  Pointer to security params used in given mode.
+ */
+
+const ble_gap_sec_params_t * onboard_get_sec_params(onboard_mode_t onboard_mode)
+{
+    return (ONBOARD_MODE_CONFIG == onboard_mode) ? &sec_params_config_mode : &sec_params_run_mode;
+}
+
 /** @brief  Get onboarding state.
  *
  *  @return  Current onboarding state.
@@ -218,14 +245,24 @@ void onboard_on_store_complete(void)
         }
 
 
+        // Passkeys and addresses of further sensor instances are stored after those of first instances.
         case ONBOARD_STATE_STORING_IR_PASS:
         {
-            onboard_state++;
+            if(sensor_slots_store_next() == false)
+            {
+                onboard_state++;
+                work_flags_set(WORK_FLAG_ONBOARD);
+            }
             break;
         }
 
         default:
         {
+            // Sensor instance bound to its address at runtime.
+            if(sensor_slots_on_store_complete())
+            {
+                break;
+            }
             spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, OPERATION_WRITE, NULL, 0);
         }
     }
@@ -233,11 +270,13 @@ void onboard_on_store_complete(void)
 
 /** @brief  Function saves locally passkey received from kinetis mcu.
  *
- *  @return  Void.
+ *  @param   passkey_index  Sensor type and instance, see DATA_ID_INSTANCE().
+ *
+ *  @return  false if there is no slot for further instance, otherwise true.
  */
-void onboard_save_passkey_from_wifi(uint8_t passkey_index, uint8_t * data)
+bool onboard_save_passkey_from_wifi(uint8_t passkey_index, uint8_t * data)
 {
-    memcpy((uint8_t*)&sensors_passkey[passkey_index], data, PASSKEY_SIZE);
+    return sensor_slots_set_passkey((data_id_t)passkey_index, data);
 }
 
 
@@ -285,7 +324,7 @@ void onboard_state_handle(void)
 
         case ONBOARD_STATE_ERROR:
         {
-            APPL_LOG("[OB]: Config ERROR.\r\n");
+            APPL_LOG_ERROR("[OB]: Config ERROR.\r\n");
             spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ERROR, NOT_USED, NULL, 0);
             onboard_set_state(ONBOARD_STATE_IDLE);
             break;
@@ -312,6 +351,70 @@ void onboard_state_handle(void)
     return serv_list;
 }
 
+/** @brief  Check advertised list of 16-bit service UUIDs. In run mode open variant of Relayr
+ *          service is accepted too.
+ *
+ *  @param  p_data       Advertised UUID list.
+ *  @param  len          Length of list in bytes.
+ *  @param  p_open_comm  Set to true if list contains open Relayr service.
+ *
+ *  @return  true if list matches services of current mode, otherwise false.
+ */
+
+bool onboard_match_service_list(const uint8_t * p_data, uint16_t len, bool * p_open_comm)
+{
+    *p_open_comm = false;
+
+    if (len > sizeof(service_uuid_list_run_mode)) {
+        return false;
+    }
+    if (memcmp((uint8_t *)onboard_get_service_list(), p_data, len) == 0) {
+        return true;
+    }
+    if ( (ONBOARD_MODE_RUN == onboard_get_mode()) &&
+         (memcmp((uint8_t *)service_uuid_list_open_comm, p_data, len) == 0) ) {
+        *p_open_comm = true;
+        return true;
+    }
+    return false;
+}
+
+/** @brief  Allow or deny sensor type to skip security setup when it offers open Relayr service.
+ *          Called from main loop.
+ *
+ *  @param  data_id  Data ID of sensor, instance is ignored.
+ *  @param  allow    true to serve sensor type without security setup.
+ *
+ *  @return  false if data ID is not sensor, otherwise true.
+ */
+
+bool onboard_set_open_comm(data_id_t data_id, bool allow)
+{
+    if (DATA_ID_IS_SENSOR(data_id) == false) {
+        return false;
+    }
+
+    if (allow) {
+        onboard_open_comm_types |= (1 << DATA_ID_GET_TYPE(data_id));
+    } else {
+        onboard_open_comm_types &= ~(1 << DATA_ID_GET_TYPE(data_id));
+    }
+    return true;
+}
+
+/** @brief  Check if sensor may skip security setup when it offers open Relayr service.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *
+ *  @return  true if sensor is served without security setup, otherwise false.
+ */
+
+bool onboard_open_comm_allowed(data_id_t data_id)
+{
+    return ( DATA_ID_IS_SENSOR(data_id) &&
+             ((onboard_open_comm_types & (1 << DATA_ID_GET_TYPE(data_id))) != 0) );
+}
+
 void onboard_set_store_passkeys()
 {
     onboard_store_passkeys = true;
@@ -11,6 +11,7 @@
 #define ONBOARD_H__
 
 #include "wunderbar_common.h"
+#include "ble_gap.h"
 
 #define PASSKEY_SIZE 6
 
@@ -49,12 +50,16 @@ onboard_mode_t onboard_get_mode(void);
 void onboard_set_mode(onboard_mode_t new_mode);
 void onboard_set_state(onboard_state_t new_state);
 void onboard_set_sec_params(onboard_mode_t onboard_mode);
+const ble_gap_sec_params_t * onboard_get_sec_params(onboard_mode_t onboard_mode);
 void onboard_on_store_complete(void);
 onboard_state_t onboard_get_state(void);
 void onboard_state_handle(void);
-void onboard_save_passkey_from_wifi(uint8_t passkey_index, uint8_t * data);
+bool onboard_save_passkey_from_wifi(uint8_t passkey_index, uint8_t * data);
 bool onboard_store_passkey_from_wifi(uint8_t passkey_index);
 const uint16_t* onboard_get_service_list(void);
+bool onboard_match_service_list(const uint8_t * p_data, uint16_t len, bool * p_open_comm);
+bool onboard_set_open_comm(data_id_t data_id, bool allow);
+bool onboard_open_comm_allowed(data_id_t data_id);
 void onboard_set_store_passkeys();
 
 #endif // ONBOARD_H__
@@ -0,0 +1,202 @@
+
+/** @file   peer_backoff.c
+ *  @brief  Exponential backoff of peers whose connection or pairing
+ *          failed.
+ */
+
+/* -- Includes -- */
+
+#include "peer_backoff.h"
+#include "stats.h"
+#include "timestamp.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+#define PEER_BACKOFF_S_TO_TICKS(s)   ((uint32_t)(s) * APP_TIMER_CLOCK_FREQ)
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**@brief Failure record of peer. */
+typedef struct
+{
+    ble_gap_addr_t  addr;
+    uint8_t         failures;     /**< Consecutive failures, 0 if entry is free. */
+    uint32_t        until;        /**< Master time until which peer is held back. */
+}
+peer_backoff_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static peer_backoff_t  peer_backoff[PEER_BACKOFF_NUM_OF_ENTRIES];
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns time peer still has to wait.
+ *
+ * @param[in] p_entry  Failure record.
+ * @param[in] now      Master time.
+ *
+ * @return    Remaining wait time in RTC1 ticks, 0 if wait time elapsed.
+ */
+
+static uint32_t peer_backoff_remaining(const peer_backoff_t * p_entry, uint32_t now)
+{
+    const int32_t remaining = (int32_t)(p_entry->until - now);
+
+    return (remaining > 0) ? (uint32_t)remaining : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds failure record of peer.
+ *
+ * @param[in] p_addr  Address of peer.
+ *
+ * @return    Failure record, NULL if peer has none.
+ */
+
+static peer_backoff_t * peer_backoff_find(const ble_gap_addr_t * p_addr)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < PEER_BACKOFF_NUM_OF_ENTRIES; cnt++)
+    {
+        if( (peer_backoff[cnt].failures != 0) &&
+            (memcmp((uint8_t *)&peer_backoff[cnt].addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) == 0) )
+        {
+            return &peer_backoff[cnt];
+        }
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes failure records.
+ */
+
+void peer_backoff_init(void)
+{
+    memset((uint8_t *)peer_backoff, 0, sizeof(peer_backoff));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records failure of connection or pairing. Peer without record takes free entry,
+ *        otherwise entry of peer which waits least.
+ *
+ * @param[in] p_addr  Address of peer.
+ */
+
+void peer_backoff_failed(const ble_gap_addr_t * p_addr)
+{
+    const uint32_t   now     = timestamp_now();
+    peer_backoff_t * p_entry;
+    uint32_t         wait_s;
+    uint8_t          cnt;
+
+    stats_count_peer_failure();
+
+    CRITICAL_REGION_ENTER();
+
+    p_entry = peer_backoff_find(p_addr);
+    if(p_entry == NULL)
+    {
+        p_entry = &peer_backoff[0];
+        for(cnt = 0; cnt < PEER_BACKOFF_NUM_OF_ENTRIES; cnt++)
+        {
+            if(peer_backoff[cnt].failures == 0)
+            {
+                p_entry = &peer_backoff[cnt];
+                break;
+            }
+            if(peer_backoff_remaining(&peer_backoff[cnt], now) < peer_backoff_remaining(p_entry, now))
+            {
+                p_entry = &peer_backoff[cnt];
+            }
+        }
+        memcpy((uint8_t *)&p_entry->addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t));
+        p_entry->failures = 0;
+    }
+
+    if(p_entry->failures != 0xFF)
+    {
+        p_entry->failures++;
+    }
+
+    wait_s = PEER_BACKOFF_BASE_S;
+    for(cnt = 1; (cnt < p_entry->failures) && (wait_s < PEER_BACKOFF_MAX_S); cnt++)
+    {
+        wait_s <<= 1;
+    }
+    if(wait_s > PEER_BACKOFF_MAX_S)
+    {
+        wait_s = PEER_BACKOFF_MAX_S;
+    }
+    p_entry->until = now + PEER_BACKOFF_S_TO_TICKS(wait_s);
+
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function clears failure record of peer, after its link was secured.
+ *
+ * @param[in] p_addr  Address of peer.
+ */
+
+void peer_backoff_succeeded(const ble_gap_addr_t * p_addr)
+{
+    peer_backoff_t * p_entry;
+
+    CRITICAL_REGION_ENTER();
+    p_entry = peer_backoff_find(p_addr);
+    if(p_entry != NULL)
+    {
+        p_entry->failures = 0;
+    }
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function clears all failure records. Called from main loop when passkeys changed,
+ *        as peers may pair with new passkey.
+ */
+
+void peer_backoff_reset(void)
+{
+    CRITICAL_REGION_ENTER();
+    memset((uint8_t *)peer_backoff, 0, sizeof(peer_backoff));
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if peer is held back. Called from BLE event handler for every advertising report.
+ *
+ * @param[in] p_addr  Address of peer.
+ *
+ * @return    true if peer shall not be connected now, otherwise false.
+ */
+
+bool peer_backoff_is_waiting(const ble_gap_addr_t * p_addr)
+{
+    const peer_backoff_t * p_entry = peer_backoff_find(p_addr);
+
+    return ( (p_entry != NULL) &&
+             (peer_backoff_remaining(p_entry, timestamp_now()) != 0) );
+}
@@ -0,0 +1,55 @@
+
+/** @file   peer_backoff.h
+ *  @brief  Exponential backoff of peers whose connection or pairing
+ *          failed.
+ */
+
+#ifndef PEER_BACKOFF_H__
+#define PEER_BACKOFF_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+
+#define PEER_BACKOFF_NUM_OF_ENTRIES   8       /**< Peers with failure record, the one which waits least is replaced. */
+#define PEER_BACKOFF_BASE_S           2       /**< Wait time after first failure, doubled on every further failure. */
+#define PEER_BACKOFF_MAX_S            600     /**< Longest wait time. */
+
+/** @brief  Initialize failure records.
+ *
+ *  @return Void.
+ */
+void peer_backoff_init(void);
+
+/** @brief  Record failure of connection or pairing. Peer is held back for PEER_BACKOFF_BASE_S
+ *          doubled for every previous failure, up to PEER_BACKOFF_MAX_S.
+ *
+ *  @param  p_addr  Address of peer.
+ *
+ *  @return Void.
+ */
+void peer_backoff_failed(const ble_gap_addr_t * p_addr);
+
+/** @brief  Clear failure record of peer, after its link was secured.
+ *
+ *  @param  p_addr  Address of peer.
+ *
+ *  @return Void.
+ */
+void peer_backoff_succeeded(const ble_gap_addr_t * p_addr);
+
+/** @brief  Clear all failure records, e.g. after passkeys changed.
+ *
+ *  @return Void.
+ */
+void peer_backoff_reset(void);
+
+/** @brief  Check if peer is held back.
+ *
+ *  @param  p_addr  Address of peer.
+ *
+ *  @return true if peer shall not be connected now, otherwise false.
+ */
+bool peer_backoff_is_waiting(const ble_gap_addr_t * p_addr);
+
+#endif // PEER_BACKOFF_H__
@@ -0,0 +1,702 @@
+
+/** @file   rotation.c
+ *  @brief  Rotation of slow sensors through shared connections,
+ *          parking each sensor between its read windows.
+ */
+
+/* -- Includes -- */
+
+#include "rotation.h"
+#include "spi_slave_config.h"
+#include "value_cache.h"
+#include "timestamp.h"
+#include "stats.h"
+#include "work_flags.h"
+#include "onboard.h"
+#include "sensor_slots.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+#define ROTATION_SENSORS_NUM     SENSOR_SLOTS_SENSORS_NUM                                /**< One entry per configured sensor, see sensor_slots_sensor_index(). */
+#define ROTATION_TIMER_INTERVAL  APP_TIMER_TICKS(ROTATION_TICK_MS, APP_TIMER_PRESCALER)
+#define ROTATION_S_TO_TICKS(s)   ((uint32_t)(s) * APP_TIMER_CLOCK_FREQ)
+
+#define ROTATION_FLAG_PARKING    0x01    /**< Link is being closed by rotation. */
+#define ROTATION_FLAG_PARKED     0x02    /**< Link was closed by rotation, sensor waits for its next connection. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**@brief Rotation state of sensor. */
+typedef struct
+{
+    rotation_plan_t  plan;
+    uint8_t          flags;
+    uint8_t          missed;   /**< Periods parked sensor was not found. */
+    uint32_t         due;      /**< End of window while connected, time of next connection while parked. */
+}
+rotation_sensor_t;
+
+/**@brief Characteristic kept for parked sensor, its UUID follows from field ID. */
+typedef struct
+{
+    uint8_t                field_id;
+    ble_gatt_char_props_t  char_props;
+    uint16_t               handle_value;
+    uint16_t               cccd_handle;
+}
+rotation_char_t;
+
+/**@brief Value and CCCD handles discovered before sensor was parked. Only characteristics with
+ *        field ID are kept, in order of their services. */
+typedef struct
+{
+    uint8_t          data_id;                                 /**< DATA_ID_ERROR if entry is free. */
+    ble_gap_addr_t   peer_addr;
+    uint8_t          char_count[BLE_DB_DISCOVERY_MAX_SRV];    /**< Number of characteristics kept of each service. */
+    rotation_char_t  chars[BLE_DB_DISCOVERY_MAX_CHAR];
+}
+rotation_handles_t;
+
+/**@brief Write waiting for next connection of sensor. */
+typedef struct
+{
+    uint8_t   data_id;         /**< DATA_ID_ERROR if entry is free. */
+    uint8_t   field_id;
+    uint8_t   len;
+    uint8_t   data[SPI_PACKET_DATA_SIZE];
+}
+rotation_write_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Extern variables. */
+
+extern client_t        m_client[MAX_CLIENTS];
+extern const uint16_t  SENSOR_CHAR_UUIDS[NUMBER_OF_RELAYR_CHARACTERISTICS + 4];
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static app_timer_id_t     rotation_timer_id;
+static bool               rotation_timer_running;
+static rotation_sensor_t  rotation_sensors[ROTATION_SENSORS_NUM];
+static rotation_write_t   rotation_writes[ROTATION_PENDING_WRITES];
+static rotation_handles_t rotation_handles[ROTATION_HANDLE_CACHE];
+static uint8_t            rotation_handles_next;     /**< Entry replaced when there is no free one. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns rotation state of sensor.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    Pointer to rotation state, NULL if data ID is not sensor or instance has no slot.
+ */
+
+static rotation_sensor_t * rotation_sensor(data_id_t data_id)
+{
+    const uint8_t index = sensor_slots_sensor_index(data_id);
+
+    if(index == ROTATION_SENSORS_NUM)
+    {
+        return NULL;
+    }
+    return &rotation_sensors[index];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if due time of sensor has come.
+ *
+ * @param[in] p_sensor  Rotation state of sensor.
+ *
+ * @return    true if due time has come, otherwise false.
+ */
+
+static bool rotation_is_due(const rotation_sensor_t * p_sensor)
+{
+    return ((int32_t)(timestamp_now() - p_sensor->due) >= 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds pending write of sensor.
+ *
+ * @param[in] data_id  Data ID of sensor, DATA_ID_ERROR for free entry.
+ *
+ * @return    Pointer to entry, NULL if there is none.
+ */
+
+static rotation_write_t * rotation_find_write(data_id_t data_id)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < ROTATION_PENDING_WRITES; cnt++)
+    {
+        if(rotation_writes[cnt].data_id == data_id)
+        {
+            return &rotation_writes[cnt];
+        }
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds handles kept for sensor.
+ *
+ * @param[in] data_id  Data ID of sensor, DATA_ID_ERROR for free entry.
+ *
+ * @return    Pointer to entry, NULL if there is none.
+ */
+
+static rotation_handles_t * rotation_find_handles(data_id_t data_id)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < ROTATION_HANDLE_CACHE; cnt++)
+    {
+        if(rotation_handles[cnt].data_id == data_id)
+        {
+            return &rotation_handles[cnt];
+        }
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function drops handles kept for sensor, e.g. when sensor leaves rotation or is lost.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ */
+
+static void rotation_drop_handles(data_id_t data_id)
+{
+    rotation_handles_t * p_handles = rotation_find_handles(data_id);
+
+    if(p_handles != NULL)
+    {
+        p_handles->data_id = DATA_ID_ERROR;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function keeps handles of sensor being parked. Entry of sensor parked first is replaced
+ *        when all entries are used.
+ *
+ * @param[in] p_client  Client context information.
+ */
+
+static void rotation_store_handles(const client_t * p_client)
+{
+    rotation_handles_t * p_handles = rotation_find_handles(p_client->data_id);
+    uint8_t              count     = 0;
+    uint8_t              srv;
+    uint8_t              cnt;
+
+    if(p_handles == NULL)
+    {
+        p_handles = rotation_find_handles(DATA_ID_ERROR);
+    }
+    if(p_handles == NULL)
+    {
+        p_handles = &rotation_handles[rotation_handles_next];
+        rotation_handles_next = (rotation_handles_next + 1) % ROTATION_HANDLE_CACHE;
+    }
+
+    p_handles->data_id = p_client->data_id;
+    memcpy((uint8_t *)&p_handles->peer_addr, (uint8_t *)&p_client->peer_addr, sizeof(ble_gap_addr_t));
+
+    for(srv = 0; srv < BLE_DB_DISCOVERY_MAX_SRV; srv++)
+    {
+        const ble_db_discovery_srv_t * p_srv = &p_client->srv_db.services[srv];
+
+        p_handles->char_count[srv] = 0;
+        for(cnt = 0; cnt < p_srv->char_count; cnt++)
+        {
+            const ble_db_discovery_char_t * p_char = &p_srv->charateristics[cnt];
+
+            if(p_char->field_id == BLE_DB_DISCOVERY_FIELD_ID_UNKNOWN)
+            {
+                continue;
+            }
+            p_handles->chars[count].field_id     = p_char->field_id;
+            p_handles->chars[count].char_props   = p_char->char_props;
+            p_handles->chars[count].handle_value = p_char->handle_value;
+            p_handles->chars[count].cccd_handle  = p_char->cccd_handle;
+            p_handles->char_count[srv]++;
+            count++;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function reports sensor which missed ROTATION_MISSED_WINDOWS periods as closed
+ *        connection. Due time of parked sensor moves by one period for every missed period, so
+ *        sensor may still be connected as soon as it is found.
+ *
+ * @param[in] data_id   Data ID of sensor.
+ * @param[in] p_sensor  Rotation state of sensor.
+ */
+
+static void rotation_check_missed(data_id_t data_id, rotation_sensor_t * p_sensor)
+{
+    const uint32_t period = ROTATION_S_TO_TICKS(p_sensor->plan.period_s);
+
+    if( ((p_sensor->flags & ROTATION_FLAG_PARKED) == 0) ||
+        (rotation_is_due(p_sensor) == false) ||
+        ((timestamp_now() - p_sensor->due) < period) )
+    {
+        return;
+    }
+
+    p_sensor->due += period;
+    p_sensor->missed++;
+    if(p_sensor->missed < ROTATION_MISSED_WINDOWS)
+    {
+        return;
+    }
+
+    p_sensor->flags  = 0;
+    p_sensor->missed = 0;
+    rotation_drop_handles(data_id);
+    value_cache_invalidate(data_id, VALUE_CACHE_ALL_FIELDS);
+    spi_create_tx_packet(data_id, FIELD_ID_SENSOR_STATUS, CONNECTION_CLOSED, NULL, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function pushes pending write to connected sensor. Sensor confirms it with FIELD_ID_SENSOR_WRITE_OK.
+ *
+ * @param[in] p_client  Client context information, in running state.
+ */
+
+static void rotation_push_write(client_t * p_client)
+{
+    rotation_write_t * p_write = rotation_find_write(p_client->data_id);
+    uint8_t            status  = 0;
+
+    if(p_write == NULL)
+    {
+        return;
+    }
+
+    if(write_characteristic_value(p_client, SENSOR_CHAR_UUIDS[p_write->field_id], p_write->data, p_write->len))
+    {
+        // Written field may change others, e.g. config changes data.
+        value_cache_invalidate(p_client->data_id, VALUE_CACHE_ALL_FIELDS);
+    }
+    else
+    {
+        spi_create_tx_packet(p_client->data_id, FIELD_ID_SENSOR_WRITE_OK, OPERATION_WRITE, &status, sizeof(status));
+    }
+    p_write->data_id = DATA_ID_ERROR;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function runs rotation timer only while there are sensors in rotation or pending writes,
+ *        so that main loop is not woken up otherwise.
+ */
+
+static void rotation_timer_update(void)
+{
+    bool    needed = false;
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < ROTATION_PENDING_WRITES; cnt++)
+    {
+        if(rotation_writes[cnt].data_id != DATA_ID_ERROR)
+        {
+            needed = true;
+        }
+    }
+    for(cnt = 0; cnt < ROTATION_SENSORS_NUM; cnt++)
+    {
+        if(rotation_sensors[cnt].plan.period_s != 0)
+        {
+            needed = true;
+        }
+    }
+
+    if(needed == rotation_timer_running)
+    {
+        return;
+    }
+
+    if(needed)
+    {
+        APP_ERROR_CHECK(app_timer_start(rotation_timer_id, ROTATION_TIMER_INTERVAL, NULL));
+    }
+    else
+    {
+        APP_ERROR_CHECK(app_timer_stop(rotation_timer_id));
+    }
+    rotation_timer_running = needed;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Timeout handler of rotation timer. Rotation is checked from main loop.
+ *
+ * @param[in] p_context  Not used.
+ */
+
+static void rotation_timer_handler(void * p_context)
+{
+    work_flags_set(WORK_FLAG_ROTATION);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes rotation. All sensors stay connected until host sets their plan.
+ *
+ * @return    false in case error occurred, otherwise true.
+ */
+
+bool rotation_init(void)
+{
+    uint8_t cnt;
+
+    memset((uint8_t *)rotation_sensors, 0, sizeof(rotation_sensors));
+    for(cnt = 0; cnt < ROTATION_PENDING_WRITES; cnt++)
+    {
+        rotation_writes[cnt].data_id = DATA_ID_ERROR;
+    }
+    for(cnt = 0; cnt < ROTATION_HANDLE_CACHE; cnt++)
+    {
+        rotation_handles[cnt].data_id = DATA_ID_ERROR;
+    }
+    rotation_handles_next  = 0;
+    rotation_timer_running = false;
+
+    return (app_timer_create(&rotation_timer_id, APP_TIMER_MODE_REPEATED, rotation_timer_handler) == NRF_SUCCESS);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function sets duty plan of sensor. Sensor which leaves rotation may be connected right away.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ * @param[in] p_plan   Duty plan.
+ *
+ * @return    false if plan is not valid, otherwise true.
+ */
+
+bool rotation_set_plan(data_id_t data_id, const rotation_plan_t * p_plan)
+{
+    rotation_sensor_t * p_sensor = rotation_sensor(data_id);
+
+    if( (p_sensor == NULL) ||
+        ( (p_plan->period_s != 0) && ((p_plan->window_s == 0) || (p_plan->window_s >= p_plan->period_s)) ) )
+    {
+        return false;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    p_sensor->plan = *p_plan;
+    if(p_plan->period_s == 0)
+    {
+        p_sensor->flags &= ~ROTATION_FLAG_PARKED;
+        rotation_drop_handles(data_id);
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    rotation_timer_update();
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function pushes pending writes, closes links of sensors whose window elapsed and
+ *        reports parked sensors which were not found. Called from main loop, clients are changed
+ *        also from BLE interrupt.
+ */
+
+void rotation_run(void)
+{
+    uint8_t cnt;
+
+    if( (onboard_get_mode() != ONBOARD_MODE_RUN) ||
+        (onboard_get_state() != ONBOARD_STATE_IDLE) )
+    {
+        return;
+    }
+
+    for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
+    {
+        client_t *          p_client = &m_client[cnt];
+        rotation_sensor_t * p_sensor;
+
+        CRITICAL_REGION_ENTER();
+
+        p_sensor = rotation_sensor(p_client->data_id);
+        if( (p_client->state == STATE_RUNNING) && (p_sensor != NULL) )
+        {
+            if(rotation_find_write(p_client->data_id) != NULL)
+            {
+                rotation_push_write(p_client);
+            }
+            else if( (p_sensor->plan.period_s != 0) &&
+                     ((p_sensor->flags & ROTATION_FLAG_PARKING) == 0) &&
+                     rotation_is_due(p_sensor) )
+            {
+                p_sensor->flags |= ROTATION_FLAG_PARKING;
+                client_handling_disconnect(p_client);
+            }
+        }
+
+        CRITICAL_REGION_EXIT();
+    }
+
+    for(cnt = 0; cnt < ROTATION_SENSORS_NUM; cnt++)
+    {
+        CRITICAL_REGION_ENTER();
+        rotation_check_missed(sensor_slots_sensor_data_id(cnt), &rotation_sensors[cnt]);
+        CRITICAL_REGION_EXIT();
+    }
+
+    rotation_timer_update();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if sensor may be connected now. Parked sensor is connected when its period
+ *        elapsed, or earlier if host sent write for it.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    false if sensor waits for its next connection, otherwise true.
+ */
+
+bool rotation_may_connect(data_id_t data_id)
+{
+    rotation_sensor_t * p_sensor = rotation_sensor(data_id);
+
+    if( (p_sensor == NULL) ||
+        ((p_sensor->flags & ROTATION_FLAG_PARKED) == 0) )
+    {
+        return true;
+    }
+    return rotation_is_due(p_sensor) || (rotation_find_write(data_id) != NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if sensor is disconnected by rotation.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    true if sensor waits for its next connection, otherwise false.
+ */
+
+bool rotation_is_parked(data_id_t data_id)
+{
+    rotation_sensor_t * p_sensor = rotation_sensor(data_id);
+
+    return ( (p_sensor != NULL) && ((p_sensor->flags & ROTATION_FLAG_PARKED) != 0) );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function keeps write for sensor waiting for its next connection. Newer write of the same
+ *        field replaces older one.
+ *
+ * @param[in] data_id   Data ID of sensor.
+ * @param[in] field_id  Field ID of characteristic.
+ * @param[in] data      Value.
+ * @param[in] len       Value length.
+ *
+ * @return    false if sensor is not parked or there is no free entry, otherwise true.
+ */
+
+bool rotation_queue_write(data_id_t data_id, uint8_t field_id, const uint8_t * data, uint8_t len)
+{
+    rotation_write_t * p_write = NULL;
+    uint8_t            cnt;
+    bool               queued  = false;
+
+    if(len > SPI_PACKET_DATA_SIZE)
+    {
+        return false;
+    }
+
+    CRITICAL_REGION_ENTER();
+
+    if(rotation_is_parked(data_id))
+    {
+        for(cnt = 0; cnt < ROTATION_PENDING_WRITES; cnt++)
+        {
+            if( (rotation_writes[cnt].data_id == data_id) &&
+                (rotation_writes[cnt].field_id == field_id) )
+            {
+                p_write = &rotation_writes[cnt];
+                break;
+            }
+        }
+        if(p_write == NULL)
+        {
+            p_write = rotation_find_write(DATA_ID_ERROR);
+        }
+
+        if(p_write != NULL)
+        {
+            p_write->data_id  = data_id;
+            p_write->field_id = field_id;
+            p_write->len      = len;
+            memcpy(p_write->data, data, len);
+            queued = true;
+        }
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    return queued;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function starts window of sensor and pushes pending write. Called from BLE event handler
+ *        when client reached running state.
+ *
+ * @param[in] p_client  Client context information.
+ */
+
+void rotation_on_running(client_t * p_client)
+{
+    rotation_sensor_t * p_sensor = rotation_sensor(p_client->data_id);
+    const uint32_t      now      = timestamp_now();
+
+    if(p_sensor == NULL)
+    {
+        return;
+    }
+
+    if((p_sensor->flags & ROTATION_FLAG_PARKED) != 0)
+    {
+        // Lateness of connection shows how fresh rotated data is.
+        stats_record_rotation(rotation_is_due(p_sensor) ? (now - p_sensor->due) : 0);
+    }
+
+    p_sensor->flags  = 0;
+    p_sensor->missed = 0;
+    p_sensor->due    = now + ROTATION_S_TO_TICKS(p_sensor->plan.window_s);
+
+    rotation_push_write(p_client);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function handles disconnection of sensor. Handles of parked sensor are kept, handles of
+ *        sensor which lost its link are dropped, its database may have changed meanwhile.
+ *        Called from BLE event handler.
+ *
+ * @param[in] p_client  Client context information.
+ *
+ * @return    true if link was closed by rotation, otherwise false.
+ */
+
+bool rotation_on_disconnect(const client_t * p_client)
+{
+    rotation_sensor_t * p_sensor = rotation_sensor(p_client->data_id);
+
+    if(p_sensor == NULL)
+    {
+        return false;
+    }
+
+    if((p_sensor->flags & ROTATION_FLAG_PARKING) == 0)
+    {
+        // Lost link is restored as soon as sensor is found again.
+        p_sensor->flags = 0;
+        rotation_drop_handles(p_client->data_id);
+        return false;
+    }
+
+    // Sensor could leave rotation while its link was being closed.
+    if(p_sensor->plan.period_s == 0)
+    {
+        p_sensor->flags = 0;
+        return true;
+    }
+
+    rotation_store_handles(p_client);
+    p_sensor->flags  = ROTATION_FLAG_PARKED;
+    p_sensor->missed = 0;
+    p_sensor->due    = timestamp_now() + ROTATION_S_TO_TICKS(p_sensor->plan.period_s - p_sensor->plan.window_s);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function restores handles kept for reconnected sensor. Entry is used once, it is kept
+ *        again when sensor is parked next time. Called from BLE event handler.
+ *
+ * @param[in] p_client  Client context information, peer address and data ID are set.
+ *
+ * @return    true if handles were restored, otherwise false.
+ */
+
+bool rotation_restore_handles(client_t * p_client)
+{
+    rotation_handles_t * p_handles = rotation_find_handles(p_client->data_id);
+    uint8_t              count     = 0;
+    uint8_t              srv;
+    uint8_t              cnt;
+
+    if( (p_handles == NULL) ||
+        (memcmp(p_handles->peer_addr.addr, p_client->peer_addr.addr, BLE_GAP_ADDR_LEN) != 0) )
+    {
+        return false;
+    }
+
+    for(srv = 0; srv < BLE_DB_DISCOVERY_MAX_SRV; srv++)
+    {
+        ble_db_discovery_srv_t * p_srv = &p_client->srv_db.services[srv];
+
+        p_srv->char_count     = p_handles->char_count[srv];
+        p_srv->charateristics = &p_client->srv_db.chars[count];
+        for(cnt = 0; cnt < p_srv->char_count; cnt++, count++)
+        {
+            const rotation_char_t * p_char = &p_handles->chars[count];
+
+            p_srv->charateristics[cnt].uuid         = SENSOR_CHAR_UUIDS[p_char->field_id];
+            p_srv->charateristics[cnt].field_id     = p_char->field_id;
+            p_srv->charateristics[cnt].char_props   = p_char->char_props;
+            p_srv->charateristics[cnt].handle_value = p_char->handle_value;
+            p_srv->charateristics[cnt].cccd_handle  = p_char->cccd_handle;
+        }
+    }
+    p_handles->data_id = DATA_ID_ERROR;
+    return true;
+}
@@ -0,0 +1,109 @@
+
+/** @file   rotation.h
+ *  @brief  Rotation of slow sensors through shared connections,
+ *          parking each sensor between its read windows.
+ */
+
+#ifndef ROTATION_H__
+#define ROTATION_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wunderbar_common.h"
+#include "client_handling.h"
+
+#define ROTATION_PENDING_WRITES   4       /**< Writes kept for sensors waiting for their next connection. */
+#define ROTATION_TICK_MS          1000    /**< Period of rotation check. */
+#define ROTATION_HANDLE_CACHE     2       /**< Parked sensors whose discovered handles are kept for reconnection. */
+#define ROTATION_MISSED_WINDOWS   3       /**< Periods parked sensor may miss before host is notified about closed connection. */
+
+/**@brief Duty plan of sensor, set by the host with FIELD_ID_ROTATION.
+ *
+ * @details Sensor with period 0 stays connected, as before. Sensor with period is connected for
+ *          window seconds of every period seconds: notifications are received and pending writes
+ *          are pushed, then link is closed and given to other sensors. Host is not notified
+ *          about planned disconnections, values stay in value cache and reads are answered with
+ *          DATA_ID_RESPONSE_BUSY until next connection. Handles discovered before parking are kept for
+ *          ROTATION_HANDLE_CACHE sensors, their reconnection skips service discovery. Sensor which
+ *          is not found for ROTATION_MISSED_WINDOWS periods is reported as closed connection.
+ */
+typedef struct
+{
+    uint16_t period_s;    /**< Time between connections, 0 if sensor stays connected. */
+    uint8_t  window_s;    /**< Time sensor stays connected after it reached running state. */
+}
+__attribute__((packed)) rotation_plan_t;
+
+/** @brief  Initialize rotation. App timer module shall be initialized before.
+ *
+ *  @return false in case error occurred, otherwise true.
+ */
+bool rotation_init(void);
+
+/** @brief  Set duty plan of sensor.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *  @param  p_plan   Duty plan.
+ *
+ *  @return false if plan is not valid, otherwise true.
+ */
+bool rotation_set_plan(data_id_t data_id, const rotation_plan_t * p_plan);
+
+/** @brief  Close links of sensors whose window elapsed. Called from main loop.
+ *
+ *  @return Void.
+ */
+void rotation_run(void);
+
+/** @brief  Check if sensor may be connected now.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *
+ *  @return false if sensor waits for its next connection, otherwise true.
+ */
+bool rotation_may_connect(data_id_t data_id);
+
+/** @brief  Check if sensor is disconnected by rotation.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *
+ *  @return true if sensor waits for its next connection, otherwise false.
+ */
+bool rotation_is_parked(data_id_t data_id);
+
+/** @brief  Keep write for sensor waiting for its next connection.
+ *
+ *  @param  data_id   Data ID of sensor.
+ *  @param  field_id  Field ID of characteristic.
+ *  @param  data      Value.
+ *  @param  len       Value length.
+ *
+ *  @return false if sensor is not parked or there is no free entry, otherwise true.
+ */
+bool rotation_queue_write(data_id_t data_id, uint8_t field_id, const uint8_t * data, uint8_t len);
+
+/** @brief  Start window of sensor and push pending write. Called when client reached running state.
+ *
+ *  @param  p_client  Client context information.
+ *
+ *  @return Void.
+ */
+void rotation_on_running(client_t * p_client);
+
+/** @brief  Handle disconnection of sensor. Handles of parked sensor are kept.
+ *
+ *  @param  p_client  Client context information.
+ *
+ *  @return true if link was closed by rotation, otherwise false.
+ */
+bool rotation_on_disconnect(const client_t * p_client);
+
+/** @brief  Restore handles kept for reconnected sensor, discovery is not needed then.
+ *
+ *  @param  p_client  Client context information, peer address and data ID are set.
+ *
+ *  @return true if handles were restored, otherwise false.
+ */
+bool rotation_restore_handles(client_t * p_client);
+
+#endif // ROTATION_H__
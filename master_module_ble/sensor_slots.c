@@ -0,0 +1,487 @@
+
+/** @file   sensor_slots.c
+ *  @brief  Persistent slots which map several sensors of the same type
+ *          to instances with own data IDs, addresses and passkeys.
+ */
+
+/* -- Includes -- */
+
+#include "sensor_slots.h"
+#include "client_handling.h"
+#include "pstorage_driver.h"
+#include "onboard.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+_Static_assert(SENSOR_SLOTS_NUM <= 32, "Changed slots do not fit sensor_slots_dirty");
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Extern variables. */
+
+extern passkey_t  sensors_passkey[MAX_CLIENTS];
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of variables. Slots are registered as persistent memory blocks in main.c. */
+
+sensor_slot_t         sensor_slots[SENSOR_SLOTS_NUM] __attribute__((aligned(4)));
+
+static uint32_t       sensor_slots_dirty;                  /**< Bit n set if slot n changed since it was stored. */
+static uint8_t        sensor_slots_storing;                /**< Slot being stored, SENSOR_SLOTS_NUM if none. */
+static uint8_t        sensor_slots_try[SENSOR_TYPES_NUM];  /**< Instance tried first for unknown sensor, per type. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds slot of instance.
+ *
+ * @param[in] data_id  Data ID of instance.
+ *
+ * @return    Slot index, SENSOR_SLOTS_NUM if instance has no slot.
+ */
+
+uint8_t sensor_slots_index(data_id_t data_id)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < SENSOR_SLOTS_NUM; cnt++)
+    {
+        if(sensor_slots[cnt].data_id == data_id)
+        {
+            break;
+        }
+    }
+    return cnt;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds index of sensor in tables kept per sensor. Slot of instance other than 0
+ *        is never released, so index of instance does not change.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ *
+ * @return    Index, SENSOR_SLOTS_SENSORS_NUM if data ID is not sensor or instance has no slot.
+ */
+
+uint8_t sensor_slots_sensor_index(data_id_t data_id)
+{
+    if(DATA_ID_IS_SENSOR(data_id) == false)
+    {
+        return SENSOR_SLOTS_SENSORS_NUM;
+    }
+    if(DATA_ID_GET_INSTANCE(data_id) == 0)
+    {
+        return DATA_ID_GET_TYPE(data_id);
+    }
+    return (SENSOR_TYPES_NUM + sensor_slots_index(data_id));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns sensor of index in tables kept per sensor.
+ *
+ * @param[in] index  Index, see sensor_slots_sensor_index().
+ *
+ * @return    Data ID of sensor, DATA_ID_ERROR if no sensor has the index.
+ */
+
+data_id_t sensor_slots_sensor_data_id(uint8_t index)
+{
+    data_id_t data_id;
+
+    if(index < SENSOR_TYPES_NUM)
+    {
+        return (data_id_t)index;
+    }
+    if(index >= SENSOR_SLOTS_SENSORS_NUM)
+    {
+        return DATA_ID_ERROR;
+    }
+
+    // Slot of instance 0 keeps its binding only, instance 0 has index of its type.
+    data_id = (data_id_t)sensor_slots[index - SENSOR_TYPES_NUM].data_id;
+    if( (data_id == DATA_ID_ERROR) || (DATA_ID_GET_INSTANCE(data_id) == 0) )
+    {
+        return DATA_ID_ERROR;
+    }
+    return data_id;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function marks slot as changed. Changed slots are stored with passkeys during onboarding,
+ *        or right away when instance is bound.
+ *
+ * @param[in] index  Slot index.
+ */
+
+static void sensor_slots_set_dirty(uint8_t index)
+{
+    sensor_slots_dirty |= (1UL << index);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if sensor type has instances other than instance 0.
+ *
+ * @param[in] type  Data ID of sensor type.
+ *
+ * @return    true if type has further instances, otherwise false.
+ */
+
+static bool sensor_slots_has_instances(data_id_t type)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < SENSOR_SLOTS_NUM; cnt++)
+    {
+        if( (sensor_slots[cnt].data_id != DATA_ID_ERROR) &&
+            (DATA_ID_GET_TYPE(sensor_slots[cnt].data_id) == type) &&
+            (DATA_ID_GET_INSTANCE(sensor_slots[cnt].data_id) != 0) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if instance can be given to sensor which is not bound to any instance.
+ *
+ * @param[in] data_id  Data ID of instance.
+ *
+ * @return    true if instance is configured and not bound, otherwise false.
+ */
+
+static bool sensor_slots_is_free(data_id_t data_id)
+{
+    uint8_t index = sensor_slots_index(data_id);
+
+    if(index == SENSOR_SLOTS_NUM)
+    {
+        // Instance 0 exists without slot.
+        return (DATA_ID_GET_INSTANCE(data_id) == 0);
+    }
+    return ((sensor_slots[index].flags & SENSOR_SLOT_FLAG_BOUND) == 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes sensor slots, after slots were loaded from persistent memory.
+ */
+
+void sensor_slots_init(void)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < SENSOR_SLOTS_NUM; cnt++)
+    {
+        // Empty block is loaded as 0xFF, which is free slot.
+        if(DATA_ID_IS_SENSOR(sensor_slots[cnt].data_id) == false)
+        {
+            memset((uint8_t *)&sensor_slots[cnt], 0xFF, sizeof(sensor_slot_t));
+        }
+    }
+
+    sensor_slots_dirty   = 0;
+    sensor_slots_storing = SENSOR_SLOTS_NUM;
+    memset(sensor_slots_try, 0, sizeof(sensor_slots_try));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds instance of sensor which advertises with given type and address.
+ *        Known sensor gets its own instance. Unknown sensor gets first free instance which is not
+ *        connected, starting with instance selected by sensor_slots_try_next().
+ *
+ * @param[in] type    Data ID of sensor type.
+ * @param[in] p_addr  Address of sensor.
+ *
+ * @return    Data ID of instance, DATA_ID_ERROR if there is no instance for the sensor.
+ */
+
+data_id_t sensor_slots_resolve(data_id_t type, const ble_gap_addr_t * p_addr)
+{
+    data_id_t data_id;
+    uint8_t   cnt;
+
+    if(type >= SENSOR_TYPES_NUM)
+    {
+        return DATA_ID_ERROR;
+    }
+
+    for(cnt = 0; cnt < SENSOR_SLOTS_NUM; cnt++)
+    {
+        if( (sensor_slots[cnt].data_id != DATA_ID_ERROR) &&
+            (DATA_ID_GET_TYPE(sensor_slots[cnt].data_id) == type) &&
+            ((sensor_slots[cnt].flags & SENSOR_SLOT_FLAG_BOUND) != 0) &&
+            (memcmp((uint8_t *)&sensor_slots[cnt].addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) == 0) )
+        {
+            return (data_id_t)sensor_slots[cnt].data_id;
+        }
+    }
+
+    for(cnt = 0; cnt < SENSOR_INSTANCES_MAX; cnt++)
+    {
+        data_id = DATA_ID_INSTANCE(type, (sensor_slots_try[type] + cnt) % SENSOR_INSTANCES_MAX);
+
+        if( sensor_slots_is_free(data_id) &&
+            (find_client_by_data_id(data_id) == NULL) )
+        {
+            return data_id;
+        }
+    }
+
+    return DATA_ID_ERROR;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function selects next instance to be tried for unknown sensors of the same type, after pairing failed.
+ *        Sensor with passkey of another instance is accepted on one of next attempts.
+ *
+ * @param[in] data_id  Data ID of instance which failed.
+ *
+ * @return    true if there is another instance to be tried, otherwise false.
+ */
+
+bool sensor_slots_try_next(data_id_t data_id)
+{
+    const data_id_t type     = DATA_ID_GET_TYPE(data_id);
+    const uint8_t   instance = DATA_ID_GET_INSTANCE(data_id);
+    uint8_t         cnt;
+
+    // Known sensor has its instance, as well as sensor of type with single instance.
+    if( (DATA_ID_IS_SENSOR(data_id) == false) ||
+        (sensor_slots_is_free(data_id) == false) )
+    {
+        return false;
+    }
+
+    sensor_slots_try[type] = (instance + 1) % SENSOR_INSTANCES_MAX;
+
+    for(cnt = 1; cnt < SENSOR_INSTANCES_MAX; cnt++)
+    {
+        if(sensor_slots_is_free(DATA_ID_INSTANCE(type, (instance + cnt) % SENSOR_INSTANCES_MAX)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function binds instance to address of sensor, after link was secured. Instance 0 of type
+ *        without further instances is not bound, so that the sensor can be replaced as before.
+ *
+ * @param[in] data_id  Data ID of instance.
+ * @param[in] p_addr   Address of sensor.
+ */
+
+void sensor_slots_bind(data_id_t data_id, const ble_gap_addr_t * p_addr)
+{
+    uint8_t index;
+
+    if( (DATA_ID_IS_SENSOR(data_id) == false) ||
+        ( (DATA_ID_GET_INSTANCE(data_id) == 0) && (sensor_slots_has_instances(DATA_ID_GET_TYPE(data_id)) == false) ) )
+    {
+        return;
+    }
+
+    index = sensor_slots_index(data_id);
+    if(index == SENSOR_SLOTS_NUM)
+    {
+        // Slot of instance 0 only keeps address.
+        index = sensor_slots_index(DATA_ID_ERROR);
+        if(index == SENSOR_SLOTS_NUM)
+        {
+            return;
+        }
+        sensor_slots[index].data_id = data_id;
+    }
+    else if( ((sensor_slots[index].flags & SENSOR_SLOT_FLAG_BOUND) != 0) &&
+             (memcmp((uint8_t *)&sensor_slots[index].addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t)) == 0) )
+    {
+        return;
+    }
+
+    memcpy((uint8_t *)&sensor_slots[index].addr, (uint8_t *)p_addr, sizeof(ble_gap_addr_t));
+    sensor_slots[index].flags = SENSOR_SLOT_FLAG_BOUND;
+    sensor_slots_set_dirty(index);
+
+    // Storage is not requested during onboarding, which stores passkeys block by block.
+    if( (onboard_get_state() == ONBOARD_STATE_IDLE) &&
+        (sensor_slots_storing == SENSOR_SLOTS_NUM) )
+    {
+        sensor_slots_store_next();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function writes passkey of sensor instance and releases instance from its sensor.
+ *        Shall be called from critical region.
+ *
+ * @param[in] data_id    Data ID of instance.
+ * @param[in] p_passkey  Passkey.
+ *
+ * @return    false if there is no free slot, otherwise true.
+ */
+
+static bool sensor_slots_write_passkey(data_id_t data_id, const uint8_t * p_passkey)
+{
+    uint8_t index = sensor_slots_index(data_id);
+
+    // Passkey of instance 0 is stored in its own block, as before.
+    if(DATA_ID_GET_INSTANCE(data_id) == 0)
+    {
+        memcpy((uint8_t *)&sensors_passkey[data_id], p_passkey, sizeof(passkey_t));
+        if(index != SENSOR_SLOTS_NUM)
+        {
+            memset((uint8_t *)&sensor_slots[index], 0xFF, sizeof(sensor_slot_t));
+            sensor_slots_set_dirty(index);
+        }
+        return true;
+    }
+
+    if(index == SENSOR_SLOTS_NUM)
+    {
+        index = sensor_slots_index(DATA_ID_ERROR);
+        if(index == SENSOR_SLOTS_NUM)
+        {
+            return false;
+        }
+        memset((uint8_t *)&sensor_slots[index], 0xFF, sizeof(sensor_slot_t));
+        sensor_slots[index].data_id = data_id;
+    }
+
+    memcpy((uint8_t *)&sensor_slots[index].passkey, p_passkey, sizeof(passkey_t));
+    sensor_slots[index].flags = 0;
+    sensor_slots_set_dirty(index);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function sets passkey of instance and releases instance from its sensor.
+ *
+ * @param[in] data_id    Data ID of instance.
+ * @param[in] p_passkey  Passkey.
+ *
+ * @return    false if there is no free slot, otherwise true.
+ */
+
+bool sensor_slots_set_passkey(data_id_t data_id, const uint8_t * p_passkey)
+{
+    bool result;
+
+    if(DATA_ID_IS_SENSOR(data_id) == false)
+    {
+        return false;
+    }
+
+    // Called from main loop, passkeys and slots are used by BLE interrupt while pairing.
+    CRITICAL_REGION_ENTER();
+    result = sensor_slots_write_passkey(data_id, p_passkey);
+    CRITICAL_REGION_EXIT();
+
+    return result;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns passkey of instance.
+ *
+ * @param[in] data_id  Data ID of instance.
+ *
+ * @return    Pointer to passkey, NULL if instance is not configured.
+ */
+
+const uint8_t * sensor_slots_get_passkey(data_id_t data_id)
+{
+    uint8_t index;
+
+    if(DATA_ID_IS_SENSOR(data_id) == false)
+    {
+        return NULL;
+    }
+
+    if(DATA_ID_GET_INSTANCE(data_id) == 0)
+    {
+        return sensors_passkey[data_id];
+    }
+
+    index = sensor_slots_index(data_id);
+    if(index == SENSOR_SLOTS_NUM)
+    {
+        return NULL;
+    }
+    return sensor_slots[index].passkey;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function requests store of next changed slot to persistent memory.
+ *
+ * @return    true if store was requested, false if there is nothing to store or storage is busy.
+ */
+
+bool sensor_slots_store_next(void)
+{
+    uint8_t cnt;
+
+    sensor_slots_storing = SENSOR_SLOTS_NUM;
+
+    for(cnt = 0; cnt < SENSOR_SLOTS_NUM; cnt++)
+    {
+        if((sensor_slots_dirty & (1UL << cnt)) != 0)
+        {
+            if(pstorage_driver_request_store((uint8_t *)&sensor_slots[cnt]) == false)
+            {
+                return false;
+            }
+            sensor_slots_dirty  &= ~(1UL << cnt);
+            sensor_slots_storing = cnt;
+            return true;
+        }
+    }
+    return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function continues storing changed slots, if completed store was requested by this module.
+ *
+ * @return    true if completed store was requested by this module, otherwise false.
+ */
+
+bool sensor_slots_on_store_complete(void)
+{
+    if(sensor_slots_storing == SENSOR_SLOTS_NUM)
+    {
+        return false;
+    }
+
+    sensor_slots_store_next();
+    return true;
+}
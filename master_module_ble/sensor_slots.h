@@ -0,0 +1,125 @@
+
+/** @file   sensor_slots.h
+ *  @brief  Persistent slots which map several sensors of the same type
+ *          to instances with own data IDs, addresses and passkeys.
+ */
+
+#ifndef SENSOR_SLOTS_H__
+#define SENSOR_SLOTS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ble_gap.h"
+#include "wunderbar_common.h"
+
+#ifndef SENSOR_SLOTS_NUM
+#define SENSOR_SLOTS_NUM          12                                             /**< Number of slots, instances configured at a time across all types. Instance 0 takes slot once its type has further instances. */
+#endif
+#define SENSOR_TYPES_NUM          (DATA_ID_DEV_IR + 1)                           /**< Number of sensor types. */
+#define SENSOR_SLOTS_SENSORS_NUM  (SENSOR_TYPES_NUM + SENSOR_SLOTS_NUM)          /**< Entries of tables kept per sensor, see sensor_slots_sensor_index(). */
+#define SENSOR_SLOT_FLAG_BOUND    0x01                                           /**< Slot is bound to sensor address. */
+
+/**@brief Sensor instance slot, stored in persistent memory.
+ *
+ * @details Instance 0 of each sensor type uses passkey from sensors_passkey[] and accepts any
+ *          address, as single sensor did before, until type gets further instances. From then on
+ *          slot of instance 0 keeps address of its sensor, so that sensors of the same type keep
+ *          their instances. Slot is free if data_id is DATA_ID_ERROR.
+ */
+typedef struct
+{
+    uint8_t         data_id;      /**< Sensor type and instance, see DATA_ID_INSTANCE(). */
+    uint8_t         flags;
+    ble_gap_addr_t  addr;         /**< Address of bonded sensor, valid if SENSOR_SLOT_FLAG_BOUND is set. */
+    passkey_t       passkey;      /**< Passkey of instance, not used for instance 0. */
+    uint8_t         reserved[3];  /**< Block is stored in words. */
+}
+sensor_slot_t;
+
+/** @brief  Initialize sensor slots, after slots were loaded from persistent memory.
+ *
+ *  @return Void.
+ */
+void sensor_slots_init(void);
+
+/** @brief  Find instance of sensor which advertises with given type and address.
+ *
+ *  @param  type    Data ID of sensor type.
+ *  @param  p_addr  Address of sensor.
+ *
+ *  @return Data ID of instance, DATA_ID_ERROR if all instances of type are bound to other sensors or connected.
+ */
+data_id_t sensor_slots_resolve(data_id_t type, const ble_gap_addr_t * p_addr);
+
+/** @brief  Select next instance to be tried for unknown sensors of the same type, after pairing failed.
+ *
+ *  @param  data_id  Data ID of instance which failed.
+ *
+ *  @return true if there is another instance to be tried, otherwise false.
+ */
+bool sensor_slots_try_next(data_id_t data_id);
+
+/** @brief  Bind instance to address of sensor, after link was secured.
+ *
+ *  @param  data_id  Data ID of instance.
+ *  @param  p_addr   Address of sensor.
+ *
+ *  @return Void.
+ */
+void sensor_slots_bind(data_id_t data_id, const ble_gap_addr_t * p_addr);
+
+/** @brief  Set passkey of instance. Instance is released from its sensor.
+ *
+ *  @param  data_id    Data ID of instance.
+ *  @param  p_passkey  Passkey.
+ *
+ *  @return false if there is no free slot, otherwise true.
+ */
+bool sensor_slots_set_passkey(data_id_t data_id, const uint8_t * p_passkey);
+
+/** @brief  Get passkey of instance.
+ *
+ *  @param  data_id  Data ID of instance.
+ *
+ *  @return Pointer to passkey, NULL if instance is not configured.
+ */
+const uint8_t * sensor_slots_get_passkey(data_id_t data_id);
+
+/** @brief  Get slot index of instance.
+ *
+ *  @param  data_id  Data ID of instance.
+ *
+ *  @return Slot index, SENSOR_SLOTS_NUM if instance has no slot.
+ */
+uint8_t sensor_slots_index(data_id_t data_id);
+
+/** @brief  Get index of sensor in tables kept per sensor. Instance 0 of each type has index of its
+ *          type, further instances follow by their slots, so tables are sized by configured slots.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *
+ *  @return Index, SENSOR_SLOTS_SENSORS_NUM if data ID is not sensor or instance has no slot.
+ */
+uint8_t sensor_slots_sensor_index(data_id_t data_id);
+
+/** @brief  Get sensor of index in tables kept per sensor, see sensor_slots_sensor_index().
+ *
+ *  @param  index  Index.
+ *
+ *  @return Data ID of sensor, DATA_ID_ERROR if no sensor has the index.
+ */
+data_id_t sensor_slots_sensor_data_id(uint8_t index);
+
+/** @brief  Request store of next changed slot to persistent memory.
+ *
+ *  @return true if store was requested, false if there is nothing to store or storage is busy.
+ */
+bool sensor_slots_store_next(void);
+
+/** @brief  Continue storing changed slots, if completed store was requested by this module.
+ *
+ *  @return true if completed store was requested by this module, otherwise false.
+ */
+bool sensor_slots_on_store_complete(void);
+
+#endif // SENSOR_SLOTS_H__
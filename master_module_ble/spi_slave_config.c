@@ -18,6 +18,16 @@
 #include "gpio.h"
 #include "client_handling.h"
 #include "onboard.h"
+#include "debug.h"
+#include "stats.h"
+#include "work_flags.h"
+#include "timestamp.h"
+#include "value_cache.h"
+#include "rotation.h"
+#include "adv_ingest.h"
+#include "adv_inventory.h"
+#include "peer_backoff.h"
+#include "sensor_slots.h"
 
 #define DEF_CHARACTER 0xDDu             /**< SPI default character. Character clocked out in case of an ignored transaction. */
 #define ORC_CHARACTER 0xCCu             /**< SPI over-read character. Character clocked out after an over-read of the transmit buffer. */
@@ -28,6 +38,14 @@
 #define SPIS_SCK_PIN     5    // SPI SCK signal.
 #define SPIS_RDY_TO_SEND 2    // SPI Ready To Send signal.
 
+#define SPI_FRAME_HEADER_SIZE      (sizeof(spi_frame_t) - SPI_PACKET_DATA_SIZE)   /**< Size of data_id, field_id and operation. */
+#define SPI_PAYLOAD_SIZE_UNKNOWN   0xFF                                           /**< Payload size of unknown config field. */
+#define SPI_RX_QUEUE_SIZE          4                                              /**< Number of received frames waiting for main loop, power of two. */
+#define SPI_RX_QUEUE_MASK          (SPI_RX_QUEUE_SIZE - 1)
+#define SPI_LINK_CRC_SIZE          (sizeof(spi_link_frame_t) - sizeof(uint16_t))  /**< Bytes covered by link layer CRC. */
+#define SPI_INSTANCE_BUFFERS_NUM   SENSOR_SLOTS_NUM                               /**< Buffers of instances other than 0, one per sensor slot. */
+#define SPI_CLIENT_BUFFERS_NUM     (MAX_CLIENTS + SPI_INSTANCE_BUFFERS_NUM)       /**< Buffers of instance 0 of each client, followed by buffers of further instances. */
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -46,9 +64,41 @@ typedef struct
 {
     spi_frame_t           frame;
     frame_data_status_t   data_status;
+    uint16_t              stamp;          /**< Time the frame was created, see timestamp_stamp(). */
+    uint8_t               sync_id;        /**< Sync frame the stamp is relative to. */
 }
 spi_client_frame_buffer_t;
 
+/**@brief Decoded SPI command. */
+typedef struct
+{
+    data_id_t   data_id;
+    uint8_t     field_id;
+    uint8_t     operation;    /**< Operation without version and length bits. */
+    uint8_t     len;          /**< Payload length, taken from frame or from sensor schema. */
+    bool        v1;           /**< Frame carries version 1 operation byte. */
+    uint8_t *   data;
+}
+spi_command_t;
+
+/**@brief Received frame waiting for main loop. */
+typedef struct
+{
+    spi_frame_t frame;
+    uint8_t     len;          /**< Number of bytes received. */
+}
+spi_rx_entry_t;
+
+/**@brief Frame sent with link layer enabled, waiting for acknowledge. */
+typedef struct
+{
+    spi_client_frame_buffer_t * p_buff;     /**< Buffer frame was sent from, NULL if none. */
+    frame_data_status_t         status;     /**< Status of buffer when frame was sent. */
+    uint8_t                     seq;
+    uint8_t                     retries;
+}
+spi_link_tx_t;
+
 /**@brief SPI transmmiting possible status. */
 typedef enum
 {
@@ -57,33 +107,66 @@ typedef enum
 }
 spi_tx_status_t;
 
-spi_client_frame_buffer_t  spi_clients_frame_buffer[MAX_CLIENTS];
+spi_client_frame_buffer_t  spi_clients_frame_buffer[SPI_CLIENT_BUFFERS_NUM];
 spi_client_frame_buffer_t *spi_curr_frame;
 
 spi_client_frame_buffer_t  spi_response_frame;
 
+/**@brief Time sync frames have own buffer, so they never overwrite a response and are never overwritten by one. */
+static spi_client_frame_buffer_t  spi_sync_frame;
+
+/**@brief Buffer of frame loaded to spi_tx_frame, NULL if no frame is loaded. */
+static spi_client_frame_buffer_t * spi_sent_frame;
+
 spi_tx_status_t spi_tx_status = SPI_TX_STATUS_FREE;
 
+static spi_frame_counters_t spi_frame_counters[SPI_FRAME_COUNTERS_NUM];
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-static spi_frame_t  spi_rx_frame;
-static spi_frame_t  spi_tx_frame;
+static spi_link_frame_t  spi_rx_frame;
+static spi_link_frame_t  spi_tx_frame;
+
+/**@brief Link layer state. Frame clocked out in a transaction is acknowledged by host in next one,
+ *        so there is one frame loaded and one frame pending at most.
+ */
+static bool                 spi_link_enabled;
+static bool                 spi_link_nak;          /**< Last frame received from host failed CRC check. */
+static uint8_t              spi_link_tx_seq;       /**< Sequence number of last new frame sent. */
+static uint8_t              spi_link_rx_seq;       /**< Sequence number of last valid data frame received. */
+static spi_link_tx_t        spi_link_loaded;       /**< Frame in spi_tx_frame. */
+static spi_link_tx_t        spi_link_pending;      /**< Frame sent in previous transaction. */
+static spi_link_tx_t        spi_link_retry;        /**< Buffer restored for retransmission. */
+static spi_link_counters_t  spi_link_counters;
+
+/**@brief Queue of received frames. Single producer (SPI interrupt) and single consumer (main loop),
+ *        each side writes only its own index.
+ */
+static spi_rx_entry_t    spi_rx_queue[SPI_RX_QUEUE_SIZE];
+static volatile uint8_t  spi_rx_queue_head;
+static volatile uint8_t  spi_rx_queue_tail;
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //static void spi_slave_event_handle(spi_slave_evt_t event);
-static bool spi_handler(data_id_t data_id, uint8_t field_id, uint8_t read_write, uint8_t * data);
+static void spi_command_process(spi_frame_t * p_frame, uint8_t rx_len);
+static void spi_fill_frame(spi_client_frame_buffer_t * frame_buff, spi_frame_counters_t * counters,
+                           data_id_t data_id, uint8_t field_id, uint8_t operation, uint8_t * data, uint8_t len);
+static void spi_link_forget(spi_client_frame_buffer_t * p_buff);
+static void spi_link_load(spi_client_frame_buffer_t * p_buff);
+static spi_client_frame_buffer_t * spi_client_buffer(data_id_t data_id);
+static void spi_tx_frame_acquire(void);
+static bool spi_tx_frame_owned(void);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /**@brief Extern variables. */
 
-extern const uint8_t  SENSORS_DEVICE_NAME[MAX_CLIENTS][BLE_DEVNAME_MAX_LEN + 1];
 extern const uint16_t SENSOR_CHAR_UUIDS[NUMBER_OF_RELAYR_CHARACTERISTICS + 4];
 extern const uint8_t  CENTRAL_BLE_FIRMWARE_REV[20];
 
@@ -98,30 +181,83 @@ extern const uint8_t  CENTRAL_BLE_FIRMWARE_REV[20];
 void spi_create_tx_packet(data_id_t data_id, uint8_t field_id, uint8_t operation, uint8_t * data, uint8_t len)
 {
     spi_client_frame_buffer_t * frame_buff;
+    spi_frame_counters_t *      counters;
 
-    if( (data_id >= DATA_ID_RESPONSE_OK) && (data_id <= DATA_ID_RESPONSE_NOT_FOUND) )
+    if( (data_id == DATA_ID_DEV_CENTRAL) && (field_id == FIELD_ID_TIME_SYNC) )
+    {
+        frame_buff = &spi_sync_frame;
+        counters   = &spi_frame_counters[MAX_CLIENTS];
+    }
+    else if( ((data_id >= DATA_ID_RESPONSE_OK) && (data_id <= DATA_ID_RESPONSE_NOT_FOUND)) ||
+             (data_id == DATA_ID_DEV_CENTRAL) )
     {
         frame_buff = &spi_response_frame;
+        counters   = &spi_frame_counters[MAX_CLIENTS];
     }
     else
     {
-        frame_buff = &spi_clients_frame_buffer[data_id];
-        // SENSOR_STATUS has priority
-        if( (frame_buff->data_status == FRAME_DATA_STATUS_LOCK) &&
-            (FIELD_ID_SENSOR_STATUS != field_id) )
+        frame_buff = spi_client_buffer(data_id);
+        counters   = &spi_frame_counters[DATA_ID_GET_TYPE(data_id)];
+        if(frame_buff == NULL)
         {
+            counters->dropped++;
             return;
         }
     }
 
+    // Called from main loop and from BLE and SPI interrupts.
+    CRITICAL_REGION_ENTER();
+
+    // SENSOR_STATUS has priority
+    if( (frame_buff != &spi_response_frame) && (frame_buff != &spi_sync_frame) &&
+        (frame_buff->data_status == FRAME_DATA_STATUS_LOCK) &&
+        (FIELD_ID_SENSOR_STATUS != field_id) )
+    {
+        counters->dropped++;
+    }
+    else
+    {
+        spi_fill_frame(frame_buff, counters, data_id, field_id, operation, data, len);
+    }
+
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function fills frame buffer and marks it as full. Shall be called from critical region.
+ *
+ * @param[in] frame_buff  Frame buffer.
+ * @param[in] counters    Frame counters of the buffer.
+ * @param[in] data_id     Data ID.
+ * @param[in] field_id    Field ID.
+ * @param[in] operation   Operation.
+ * @param[in] data        Payload, can be NULL.
+ * @param[in] len         Payload length.
+ */
+
+static void spi_fill_frame(spi_client_frame_buffer_t * frame_buff, spi_frame_counters_t * counters,
+                           data_id_t data_id, uint8_t field_id, uint8_t operation, uint8_t * data, uint8_t len)
+{
+    counters->written++;
+    if(frame_buff->data_status != FRAME_DATA_STATUS_EMPTY)
+    {
+        counters->overwritten++;
+    }
+
+    // New frame supersedes one waiting for retransmission.
+    spi_link_forget(frame_buff);
+
     // "Clear" tx buffer.
-    memset((uint8_t *)&frame_buff->frame, 0xFF, sizeof(spi_tx_frame));
+    memset((uint8_t *)&frame_buff->frame, 0xFF, sizeof(spi_frame_t));
 
     if(data_id == DATA_ID_DEV_CFG_APP)
     {
         data_id = DATA_ID_CONFIG;
     }
 
+    frame_buff->stamp           = timestamp_stamp(&frame_buff->sync_id);
     frame_buff->frame.data_id   = data_id;
     frame_buff->frame.field_id  = field_id;
     frame_buff->frame.operation = (operation_t)operation;
@@ -131,6 +267,43 @@ void spi_create_tx_packet(data_id_t data_id, uint8_t field_id, uint8_t operation
     }
 
     frame_buff->data_status = FRAME_DATA_STATUS_FULL;
+    work_flags_set(WORK_FLAG_SPI_TX);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns frame buffer of client. Instance 0 of sensor type uses buffer indexed by data ID,
+ *        further instances use buffers of their slots.
+ *
+ * @param[in] data_id  Data ID of client.
+ *
+ * @return    Frame buffer, NULL if data ID is not one of client.
+ */
+
+static spi_client_frame_buffer_t * spi_client_buffer(data_id_t data_id)
+{
+    uint8_t slot;
+
+    if(DATA_ID_GET_INSTANCE(data_id) == 0)
+    {
+        if(data_id > DATA_ID_DEV_CFG_APP)
+        {
+            return NULL;
+        }
+        return &spi_clients_frame_buffer[data_id];
+    }
+
+    if(DATA_ID_IS_SENSOR(data_id) == false)
+    {
+        return NULL;
+    }
+    slot = sensor_slots_index(data_id);
+    if(slot == SENSOR_SLOTS_NUM)
+    {
+        return NULL;
+    }
+    return &spi_clients_frame_buffer[MAX_CLIENTS + slot];
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -139,7 +312,20 @@ void spi_create_tx_packet(data_id_t data_id, uint8_t field_id, uint8_t operation
 
 void spi_lock_tx_packet(data_id_t data_id)
 {
-    spi_clients_frame_buffer[data_id].data_status = FRAME_DATA_STATUS_LOCK;
+    spi_client_frame_buffer_t * frame_buff = spi_client_buffer(data_id);
+
+    if(frame_buff == NULL)
+    {
+        return;
+    }
+
+    // Frame may be clocked out by SPI interrupt since it was filled, empty buffer is not locked.
+    CRITICAL_REGION_ENTER();
+    if(frame_buff->data_status == FRAME_DATA_STATUS_FULL)
+    {
+        frame_buff->data_status = FRAME_DATA_STATUS_LOCK;
+    }
+    CRITICAL_REGION_EXIT();
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -148,11 +334,41 @@ void spi_lock_tx_packet(data_id_t data_id)
 
 void spi_clear_tx_packet(data_id_t data_id)
 {
-    spi_client_frame_buffer_t * frame_buff = &spi_clients_frame_buffer[data_id];
+    spi_client_frame_buffer_t * frame_buff = spi_client_buffer(data_id);
 
-    memset((uint8_t *)&frame_buff->frame, 0xFF, sizeof(spi_tx_frame));
+    if(frame_buff == NULL)
+    {
+        return;
+    }
+
+    CRITICAL_REGION_ENTER();
+    spi_link_forget(frame_buff);
+    if(spi_link_loaded.p_buff == frame_buff)
+    {
+        spi_link_loaded.p_buff = NULL;
+    }
+    if(spi_sent_frame == frame_buff)
+    {
+        spi_sent_frame = NULL;
+    }
+    memset((uint8_t *)&frame_buff->frame, 0xFF, sizeof(spi_frame_t));
     frame_buff->data_status = FRAME_DATA_STATUS_EMPTY;
     spi_tx_status = SPI_TX_STATUS_FREE;
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**@brief Function checks if response frame may be filled without overwriting previous response.
+ *
+ * @return    true if response frame is empty, otherwise false.
+ */
+
+bool spi_response_is_free(void)
+{
+    return (spi_response_frame.data_status == FRAME_DATA_STATUS_EMPTY);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -162,7 +378,7 @@ void spi_clear_tx_packet(data_id_t data_id)
 void set_next_frame(void)
 {
     spi_curr_frame++;
-    if(spi_curr_frame > &spi_clients_frame_buffer[MAX_CLIENTS-1])
+    if(spi_curr_frame > &spi_clients_frame_buffer[SPI_CLIENT_BUFFERS_NUM-1])
     {
         spi_curr_frame = &spi_clients_frame_buffer[0];
     }
@@ -172,8 +388,65 @@ void set_next_frame(void)
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+/**@brief Function copies next frame to be sent to spi_tx_frame. Shall be called from critical region,
+ *        with SPIS semaphore owned.
+ */
+
+static void spi_load_next_frame(void)
+{
+    // Time sync frame goes first, stamps of other frames may already refer to it.
+    if(spi_sync_frame.data_status == FRAME_DATA_STATUS_FULL)
+    {
+        spi_tx_status  = SPI_TX_STATUS_BUSY;
+        spi_sent_frame = &spi_sync_frame;
+        memcpy((uint8_t *)&spi_tx_frame.frame, (uint8_t *)&spi_sync_frame.frame, sizeof(spi_frame_t));
+        spi_link_load(&spi_sync_frame);
+        gpio_write(SPIS_RDY_TO_SEND, true);
+    }
+
+    // Check if there is some RESPONSE to send.
+    else if(spi_response_frame.data_status == FRAME_DATA_STATUS_FULL)
+    {
+        spi_tx_status  = SPI_TX_STATUS_BUSY;
+        spi_sent_frame = &spi_response_frame;
+        memcpy((uint8_t *)&spi_tx_frame.frame, (uint8_t *)&spi_response_frame.frame, sizeof(spi_frame_t));
+        spi_link_load(&spi_response_frame);
+        gpio_write(SPIS_RDY_TO_SEND, true);
+    }
+
+    // Search next client with data ready.
+    else
+    {
+        uint8_t cnt;
+
+        // Semaphore is owned, transaction starting meanwhile is ignored by SPIS and repeated by master.
+        // Frame is loaded anyway, skipping it would leave RDY low with no event to load it later.
+        for(cnt = 0; cnt < SPI_CLIENT_BUFFERS_NUM; cnt++)
+        {
+            set_next_frame();
+
+            if( (spi_curr_frame->data_status == FRAME_DATA_STATUS_FULL) ||
+                (spi_curr_frame->data_status == FRAME_DATA_STATUS_LOCK) )
+            {
+                spi_tx_status  = SPI_TX_STATUS_BUSY;
+                spi_sent_frame = spi_curr_frame;
+                memcpy((uint8_t *)&spi_tx_frame.frame, (uint8_t *)&spi_curr_frame->frame, sizeof(spi_frame_t));
+                spi_link_load(spi_curr_frame);
+                gpio_write(SPIS_RDY_TO_SEND, true);
+                break;
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void spi_check_tx_ready(void)
 {
+    uint32_t stats_start;
+
     // Check if data sends or receives.
     if ( (spi_tx_status == SPI_TX_STATUS_BUSY) ||
          (gpio_read (SPIS_CSN_PIN) == 0) )
@@ -182,33 +455,295 @@ void spi_check_tx_ready(void)
     }
     else
     {
-        // Check if there is some RESPONSE to send.
-        if(spi_response_frame.data_status == FRAME_DATA_STATUS_FULL)
+        stats_start = stats_path_begin();
+
+        // Master can not clock out spi_tx_frame while it is being rewritten.
+        spi_tx_frame_acquire();
+
+        // Frame buffers are filled also from BLE and SPI interrupts.
+        CRITICAL_REGION_ENTER();
+
+        // Transaction which ended meanwhile is handled by SPI interrupt first, it sets WORK_FLAG_SPI_TX again.
+        if(spi_tx_frame_owned())
         {
-            spi_tx_status = SPI_TX_STATUS_BUSY;
-            memcpy((uint8_t *)&spi_tx_frame, (uint8_t *)&spi_response_frame.frame, sizeof(spi_frame_t));
-            gpio_write(SPIS_RDY_TO_SEND, true);
-            return;
+            spi_load_next_frame();
+            NRF_SPIS1->TASKS_RELEASE = 1;
         }
 
-        // Search next client with data ready.
-        else
+        CRITICAL_REGION_EXIT();
+
+        stats_path_end(STATS_PATH_SPI_TX_READY, stats_start);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns frame counters of SPI frame buffer.
+ *
+ * @param[in] index  Index of frame buffer (data ID of client, or MAX_CLIENTS for response frame).
+ *
+ * @return    Pointer to counters, NULL if index is out of range.
+ */
+
+const spi_frame_counters_t * spi_get_frame_counters(uint8_t index)
+{
+    if(index >= SPI_FRAME_COUNTERS_NUM)
+    {
+        return NULL;
+    }
+    return &spi_frame_counters[index];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function clears frame counters of all SPI frame buffers.
+ */
+
+void spi_reset_frame_counters(void)
+{
+    memset((uint8_t *)spi_frame_counters, 0, sizeof(spi_frame_counters));
+    memset((uint8_t *)&spi_link_counters, 0, sizeof(spi_link_counters));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns link layer counters.
+ */
+
+const spi_link_counters_t * spi_get_link_counters(void)
+{
+    return &spi_link_counters;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function fills acknowledge and CRC of link layer trailer of frame to be sent.
+ *
+ * @param[in] p_frame  Frame with sequence number, stamp and sync_id already set.
+ */
+
+static void spi_link_seal(spi_link_frame_t * p_frame)
+{
+    p_frame->link.ack   = spi_link_rx_seq;
+    p_frame->link.flags = (p_frame->link.flags & SPI_LINK_FLAG_SYNC_MASK) | (spi_link_nak ? SPI_LINK_FLAG_NAK : 0);
+    p_frame->link.crc   = crc16_ccitt_compute((uint8_t *)p_frame, SPI_LINK_CRC_SIZE, 0xFFFF);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function stops tracking of frame sent from given buffer, because buffer content changed.
+ *
+ * @param[in] p_buff  Frame buffer.
+ */
+
+static void spi_link_forget(spi_client_frame_buffer_t * p_buff)
+{
+    if(spi_link_pending.p_buff == p_buff)
+    {
+        spi_link_pending.p_buff = NULL;
+    }
+    if(spi_link_retry.p_buff == p_buff)
+    {
+        spi_link_retry.p_buff = NULL;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function assigns sequence number to frame copied to spi_tx_frame and seals it.
+ *        Retransmitted frame keeps its sequence number, so host can discard duplicates.
+ *
+ * @param[in] p_buff  Buffer frame was copied from.
+ */
+
+static void spi_link_load(spi_client_frame_buffer_t * p_buff)
+{
+    if(spi_link_enabled == false)
+    {
+        return;
+    }
+
+    spi_link_loaded.p_buff = p_buff;
+    spi_link_loaded.status = p_buff->data_status;
+
+    if(spi_link_retry.p_buff == p_buff)
+    {
+        spi_link_loaded.seq     = spi_link_retry.seq;
+        spi_link_loaded.retries = spi_link_retry.retries;
+        spi_link_retry.p_buff   = NULL;
+    }
+    else
+    {
+        spi_link_tx_seq = (spi_link_tx_seq == 0xFF) ? 1 : (spi_link_tx_seq + 1);
+        spi_link_loaded.seq     = spi_link_tx_seq;
+        spi_link_loaded.retries = 0;
+    }
+
+    spi_tx_frame.link.seq   = spi_link_loaded.seq;
+    spi_tx_frame.link.stamp = p_buff->stamp;
+    spi_tx_frame.link.flags = p_buff->sync_id << SPI_LINK_FLAG_SYNC_POS;
+    spi_link_seal(&spi_tx_frame);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function schedules retransmission of not acknowledged frame from its buffer.
+ *        If buffer already holds newer frame, the newer one is sent instead.
+ *
+ * @param[in] p_sent  Not acknowledged frame, cleared on return.
+ */
+
+static void spi_link_retransmit(spi_link_tx_t * p_sent)
+{
+    if(p_sent->p_buff == NULL)
+    {
+        return;
+    }
+
+    if(p_sent->retries >= SPI_LINK_MAX_RETRIES)
+    {
+        spi_link_counters.abandoned++;
+    }
+    else if(p_sent->p_buff->data_status == FRAME_DATA_STATUS_EMPTY)
+    {
+        p_sent->p_buff->data_status = p_sent->status;
+        spi_link_retry = *p_sent;
+        spi_link_retry.retries++;
+        spi_link_counters.retransmits++;
+        work_flags_set(WORK_FLAG_SPI_TX);
+    }
+
+    p_sent->p_buff = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function handles link layer at the end of SPI transaction. Called from SPI interrupt.
+ *
+ * @param[in] rx_len  Number of bytes received.
+ *
+ * @return    Length of received frame to be queued as command, 0 if there is no new command.
+ */
+
+static uint8_t spi_link_on_transfer_end(uint8_t rx_len)
+{
+    uint8_t cmd_len = 0;
+
+    if( (rx_len != sizeof(spi_link_frame_t)) ||
+        (crc16_ccitt_compute((uint8_t *)&spi_rx_frame, SPI_LINK_CRC_SIZE, 0xFFFF) != spi_rx_frame.link.crc) )
+    {
+        // Verdict on frame sent in previous transaction is lost as well.
+        spi_link_counters.crc_errors++;
+        spi_link_nak = true;
+        spi_link_retransmit(&spi_link_pending);
+    }
+    else
+    {
+        spi_link_nak = false;
+
+        if( (spi_link_pending.p_buff != NULL) &&
+            (((spi_rx_frame.link.flags & SPI_LINK_FLAG_NAK) != 0) || (spi_rx_frame.link.ack != spi_link_pending.seq)) )
         {
-            uint8_t cnt;
-            for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
-            {
-                set_next_frame();
+            spi_link_counters.naks++;
+            spi_link_retransmit(&spi_link_pending);
+        }
 
-                if( ( (spi_curr_frame->data_status == FRAME_DATA_STATUS_FULL) ||
-                      (spi_curr_frame->data_status == FRAME_DATA_STATUS_LOCK) ) && (gpio_read (SPIS_CSN_PIN) != 0) )
-                {
-                    spi_tx_status = SPI_TX_STATUS_BUSY;
-                    memcpy((uint8_t *)&spi_tx_frame, (uint8_t *)&spi_curr_frame->frame, sizeof(spi_frame_t));
-                    gpio_write(SPIS_RDY_TO_SEND, true);
-                    break;
-                }
+        if(spi_rx_frame.frame.data_id != DATA_ID_ERROR)
+        {
+            // Host sends command again if our acknowledge was lost.
+            if(spi_rx_frame.link.seq == spi_link_rx_seq)
+            {
+                spi_link_counters.duplicates++;
             }
+            else
+            {
+                spi_link_rx_seq = spi_rx_frame.link.seq;
+                cmd_len = sizeof(spi_frame_t);
+            }
+        }
+    }
+
+    spi_link_pending       = spi_link_loaded;
+    spi_link_loaded.p_buff = NULL;
+
+    // Frame without data still carries acknowledge.
+    spi_tx_frame.link.seq   = spi_link_tx_seq;
+    spi_tx_frame.link.stamp = TIMESTAMP_NONE;
+    spi_tx_frame.link.flags = 0;
+    spi_link_seal(&spi_tx_frame);
+
+    return cmd_len;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function requests SPIS semaphore and waits until it is granted. Transaction in progress
+ *        is finished first.
+ */
+
+static void spi_tx_frame_acquire(void)
+{
+    NRF_SPIS1->TASKS_ACQUIRE = 1;
+    while(NRF_SPIS1->SEMSTAT != SPIS_SEMSTAT_SEMSTAT_CPU)
+    {
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function checks if spi_tx_frame may be changed. Semaphore acquired with spi_tx_frame_acquire()
+ *        is released by SPI interrupt if a transaction ended meanwhile. Shall be called from critical region.
+ *
+ * @return    true if CPU owns semaphore and there is no unhandled END event, otherwise false.
+ */
+
+static bool spi_tx_frame_owned(void)
+{
+    return ( (NRF_SPIS1->SEMSTAT == SPIS_SEMSTAT_SEMSTAT_CPU) &&
+             (NRF_SPIS1->EVENTS_END == 0) );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function enables or disables link layer. Called from critical region, with SPIS semaphore
+ *        owned once SPI slave is enabled.
+ *
+ * @param[in] enable  true to enable link layer.
+ */
+
+static void spi_link_enable(bool enable)
+{
+    spi_link_enabled        = enable;
+    spi_link_nak            = false;
+    spi_link_tx_seq         = 0;
+    spi_link_rx_seq         = 0;
+    spi_link_loaded.p_buff  = NULL;
+    spi_link_pending.p_buff = NULL;
+    spi_link_retry.p_buff   = NULL;
+
+    memset((uint8_t *)&spi_tx_frame.link, 0xFF, sizeof(spi_link_trailer_t));
+    if(enable)
+    {
+        // Frame already loaded is sent once, without retransmission.
+        spi_tx_frame.link.seq   = 0;
+        spi_tx_frame.link.stamp = TIMESTAMP_NONE;
+        spi_tx_frame.link.flags = 0;
+        if(spi_tx_frame.frame.data_id != DATA_ID_ERROR)
+        {
+            spi_tx_frame.link.seq = ++spi_link_tx_seq;
         }
+        spi_link_seal(&spi_tx_frame);
     }
 }
 
@@ -225,136 +760,575 @@ void SPI1_TWI1_IRQHandler(void)
 {
     if (NRF_SPIS1->EVENTS_END != 0)
     {
+        const uint32_t stats_start = stats_path_begin();
+
         NRF_SPIS1->EVENTS_END = 0;
 
-        if (spi_response_frame.data_status == FRAME_DATA_STATUS_FULL)
+        // Only the buffer whose frame was loaded has been sent.
+        if ( (spi_sent_frame == &spi_response_frame) || (spi_sent_frame == &spi_sync_frame) )
         {
-            spi_response_frame.data_status = FRAME_DATA_STATUS_EMPTY;
+            spi_sent_frame->data_status = FRAME_DATA_STATUS_EMPTY;
+            spi_frame_counters[MAX_CLIENTS].sent++;
         }
-        else if (spi_curr_frame->data_status == FRAME_DATA_STATUS_FULL ||
-                 spi_curr_frame->data_status == FRAME_DATA_STATUS_LOCK)
+        else if ( (spi_sent_frame != NULL) &&
+                  ((spi_sent_frame->data_status == FRAME_DATA_STATUS_FULL) ||
+                   (spi_sent_frame->data_status == FRAME_DATA_STATUS_LOCK)) )
         {
-            spi_curr_frame->data_status = FRAME_DATA_STATUS_EMPTY;
+            spi_sent_frame->data_status = FRAME_DATA_STATUS_EMPTY;
+            spi_frame_counters[DATA_ID_GET_TYPE(spi_sent_frame->frame.data_id)].sent++;
         }
+        spi_sent_frame = NULL;
 
         memset((uint8_t *)&spi_tx_frame, 0xFF, sizeof(spi_tx_frame));
         spi_tx_status = SPI_TX_STATUS_FREE;
+        work_flags_set(WORK_FLAG_SPI_TX);
+
+        uint8_t rx_len = (uint8_t)NRF_SPIS1->AMOUNTRX;
 
-        const bool opOk = spi_handler(spi_rx_frame.data_id, spi_rx_frame.field_id, spi_rx_frame.operation, spi_rx_frame.data);
+        if(spi_link_enabled)
+        {
+            rx_len = spi_link_on_transfer_end(rx_len);
+        }
 
-        if (DATA_ID_ERROR != spi_rx_frame.data_id  &&
-            false         == opOk)
+        // Queue received command, it is executed from main loop. Transactions in which host
+        // only read data carry no command.
+        if((rx_len != 0) && (spi_rx_frame.frame.data_id != DATA_ID_ERROR))
         {
-            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, INVALID, NOT_USED, NULL, 0);
+            if((uint8_t)(spi_rx_queue_head - spi_rx_queue_tail) < SPI_RX_QUEUE_SIZE)
+            {
+                spi_rx_entry_t * p_entry = &spi_rx_queue[spi_rx_queue_head & SPI_RX_QUEUE_MASK];
+
+                memcpy((uint8_t *)&p_entry->frame, (uint8_t *)&spi_rx_frame.frame, sizeof(spi_frame_t));
+                p_entry->len = rx_len;
+
+                // Entry shall be written before it is published to main loop.
+                __DMB();
+                spi_rx_queue_head++;
+                work_flags_set(WORK_FLAG_SPI_RX);
+            }
+            else
+            {
+                stats_count_spi_rx_overflow();
+                spi_create_tx_packet(DATA_ID_RESPONSE_BUSY, 0xFF, 0xFF, NULL, 0);
+            }
         }
 
+        // Semaphore was acquired by END_ACQUIRE shortcut, master may clock out spi_tx_frame again.
+        NRF_SPIS1->TASKS_RELEASE = 1;
+
         gpio_write(SPIS_RDY_TO_SEND, false);
+
+        stats_path_end(STATS_PATH_SPI_IRQ, stats_start);
     }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief
+/**@brief Function returns payload size of config command.
  *
- * @param[in]
+ * @param[in] field_id  Field ID of config command.
+ *
+ * @return    Payload size, SPI_PAYLOAD_SIZE_UNKNOWN if field is not known.
  */
 
-static bool spi_handler(data_id_t data_id, uint8_t field_id, uint8_t read_write, uint8_t * data)
+static uint8_t spi_config_payload_size(uint8_t field_id)
 {
-    if(
-       (data_id <= DATA_ID_DEV_IR) &&
-       (field_id < FIELD_ID_SENSOR_STATUS) &&
-       (onboard_get_state() == ONBOARD_STATE_IDLE)
-      )
+    switch(field_id)
+    {
+        case FIELD_ID_RUN:
+        case FIELD_ID_CONFIG_START:
+        case FIELD_ID_CONFIG_STOP:
+        case FIELD_ID_CONFIG_STORE_PASSKEYS:
+        case FIELD_ID_KILL:
+        case FIELD_ID_INVENTORY:
+            return 0;
+
+        case FIELD_ID_LINK:
+            return 1;
+
+        case FIELD_ID_ADV_INGEST:
+        case FIELD_ID_OPEN_COMM:
+            return 2;
+
+        case FIELD_ID_LOG_LEVEL:
+        case FIELD_ID_STATS:
+            return 2;
+
+        case FIELD_ID_TIME_SYNC:
+            return sizeof(uint32_t);
+
+        case FIELD_ID_ROTATION:
+            return 1 + sizeof(rotation_plan_t);
+
+        case FIELD_ID_CONFIG_INSTANCE_PASS:
+            return 1 + sizeof(passkey_t);
+
+        // Passkey fields are FIELD_ID_CONFIG_HTU_PASS..FIELD_ID_CONFIG_IR_PASS.
+        default:
+            return (field_id <= FIELD_ID_CONFIG_IR_PASS) ? sizeof(passkey_t) : SPI_PAYLOAD_SIZE_UNKNOWN;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function decodes and validates received frame against sensor schema.
+ *
+ * @param[in]  p_frame  Received frame.
+ * @param[in]  rx_len   Number of bytes received.
+ * @param[out] p_cmd    Decoded command.
+ *
+ * @return     RESPONSE_ERROR_NONE if frame is valid, otherwise error code.
+ */
+
+static response_error_t spi_decode(spi_frame_t * p_frame, uint8_t rx_len, spi_command_t * p_cmd)
+{
+    uint8_t expected_len;
+
+    if(rx_len < SPI_FRAME_HEADER_SIZE)
+    {
+        return RESPONSE_ERROR_FRAME;
+    }
+
+    p_cmd->data_id  = p_frame->data_id;
+    p_cmd->field_id = p_frame->field_id;
+    p_cmd->data     = p_frame->data;
+    p_cmd->v1       = ((p_frame->operation & OPERATION_V1_FLAG) != 0) && (p_frame->operation != NOT_USED);
+
+    if(p_cmd->v1)
+    {
+        p_cmd->operation = p_frame->operation & OPERATION_V1_OP_MASK;
+        p_cmd->len       = (p_frame->operation & OPERATION_V1_LEN_MASK) >> OPERATION_V1_LEN_POS;
+
+        if(p_cmd->len > SPI_PACKET_DATA_SIZE)
+        {
+            return RESPONSE_ERROR_LENGTH;
+        }
+    }
+    else
+    {
+        p_cmd->operation = p_frame->operation;
+        p_cmd->len       = 0;
+    }
+
+    if(DATA_ID_IS_SENSOR(p_cmd->data_id))
+    {
+        if(sensor_field_is_valid(DATA_ID_GET_TYPE(p_cmd->data_id), p_cmd->field_id, OPERATION_READ) == false)
+        {
+            return RESPONSE_ERROR_FIELD_ID;
+        }
+
+        if(p_cmd->v1 == false)
+        {
+            // Legacy frames treat every operation other than write as read.
+            p_cmd->operation = (p_cmd->operation == OPERATION_WRITE) ? OPERATION_WRITE : OPERATION_READ;
+        }
+        else if( (p_cmd->operation != OPERATION_WRITE) &&
+                 (p_cmd->operation != OPERATION_READ) &&
+                 (p_cmd->operation != OPERATION_READ_CACHED) )
+        {
+            return RESPONSE_ERROR_OPERATION;
+        }
+
+        if(sensor_field_is_valid(DATA_ID_GET_TYPE(p_cmd->data_id), p_cmd->field_id, p_cmd->operation) == false)
+        {
+            return RESPONSE_ERROR_OPERATION;
+        }
+
+        expected_len = 0;
+        if(p_cmd->operation == OPERATION_WRITE)
+        {
+            expected_len = sensors_get_msg_size(DATA_ID_GET_TYPE(p_cmd->data_id), (field_id_char_index_t)p_cmd->field_id);
+        }
+        else if(p_cmd->operation == OPERATION_READ_CACHED)
+        {
+            expected_len = sizeof(uint16_t);
+        }
+    }
+    else if(p_cmd->data_id == DATA_ID_CONFIG)
+    {
+        expected_len = spi_config_payload_size(p_cmd->field_id);
+        if(expected_len == SPI_PAYLOAD_SIZE_UNKNOWN)
+        {
+            return RESPONSE_ERROR_FIELD_ID;
+        }
+    }
+    else
+    {
+        return RESPONSE_ERROR_DATA_ID;
+    }
+
+    if(p_cmd->v1 == false)
+    {
+        p_cmd->len = expected_len;
+    }
+    else if(p_cmd->len != expected_len)
+    {
+        return RESPONSE_ERROR_LENGTH;
+    }
+
+    if(rx_len < (SPI_FRAME_HEADER_SIZE + p_cmd->len))
+    {
+        return RESPONSE_ERROR_FRAME;
+    }
+
+    return RESPONSE_ERROR_NONE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function executes decoded SPI command.
+ *
+ * @param[in] p_cmd  Decoded command.
+ *
+ * @return    RESPONSE_ERROR_NONE if command was executed, otherwise error code.
+ */
+
+static response_error_t spi_handler(const spi_command_t * p_cmd)
+{
+    uint8_t * data = p_cmd->data;
+
+    if(DATA_ID_IS_SENSOR(p_cmd->data_id))
     {
         client_t * p_client;
-        p_client = find_client_by_dev_name(SENSORS_DEVICE_NAME[data_id], strlen((const char *)SENSORS_DEVICE_NAME[data_id]));
+
+        if(onboard_get_state() != ONBOARD_STATE_IDLE)
+        {
+            return RESPONSE_ERROR_NOT_IDLE;
+        }
+
+        p_client = find_client_by_data_id(p_cmd->data_id);
+
+        // Answer from cache or from device information read at connection, even while sensor is busy.
+        if(p_cmd->operation != OPERATION_WRITE)
+        {
+            uint8_t  value[SPI_PACKET_DATA_SIZE];
+            uint8_t  len;
+            uint16_t max_age_ms;
+            bool     found = false;
+
+            if(p_cmd->operation == OPERATION_READ_CACHED)
+            {
+                memcpy((uint8_t *)&max_age_ms, data, sizeof(max_age_ms));
+                found = value_cache_lookup(p_cmd->data_id, p_cmd->field_id, max_age_ms, value, &len);
+            }
+            if((found == false) && (p_client != NULL) && client_info_get(p_client, p_cmd->field_id, value, &len))
+            {
+                stats_count_info_read();
+                found = true;
+            }
+
+            if(found)
+            {
+                spi_create_tx_packet(p_cmd->data_id, p_cmd->field_id, OPERATION_WRITE, value, len);
+                spi_lock_tx_packet(p_cmd->data_id);
+                return RESPONSE_ERROR_NONE;
+            }
+        }
 
         // Check if sensor is connected.
         if(p_client == NULL)
         {
+            // Sensor in rotation gets write on its next connection, confirmed with FIELD_ID_SENSOR_WRITE_OK.
+            if(rotation_is_parked(p_cmd->data_id))
+            {
+                if( (p_cmd->operation != OPERATION_WRITE) ||
+                    (rotation_queue_write(p_cmd->data_id, p_cmd->field_id, data, p_cmd->len) == false) )
+                {
+                    spi_create_tx_packet(DATA_ID_RESPONSE_BUSY, 0xFF, 0xFF, NULL, 0);
+                }
+                return RESPONSE_ERROR_NONE;
+            }
+
             spi_create_tx_packet(DATA_ID_RESPONSE_NOT_FOUND, 0xFF, 0xFF, NULL, 0);
-            return true;
+            return RESPONSE_ERROR_NONE;
         }
         // Check if sensor is in running state.
         else if(p_client->state != STATE_RUNNING)
         {
             spi_create_tx_packet(DATA_ID_RESPONSE_BUSY, 0xFF, 0xFF, NULL, 0);
-            return true;
+            return RESPONSE_ERROR_NONE;
         }
 
         // Sensor is in RUNNING state.
-        if(read_write == OPERATION_WRITE)
+        if(p_cmd->operation == OPERATION_WRITE)
         {
-            uint8_t len;
-            len = sensors_get_msg_size(data_id, (field_id_char_index_t)field_id);
-            return write_characteristic_value(p_client, SENSOR_CHAR_UUIDS[field_id], data, len);
+            if(write_characteristic_value(p_client, SENSOR_CHAR_UUIDS[p_cmd->field_id], data, p_cmd->len) == false)
+            {
+                return RESPONSE_ERROR_REJECTED;
+            }
+            // Written field may change others, e.g. config changes data.
+            value_cache_invalidate(p_cmd->data_id, VALUE_CACHE_ALL_FIELDS);
         }
         else
         {
-            return read_characteristic_value(p_client, SENSOR_CHAR_UUIDS[field_id]);
+            if(read_characteristic_value(p_client, SENSOR_CHAR_UUIDS[p_cmd->field_id]) == false)
+            {
+                return RESPONSE_ERROR_REJECTED;
+            }
         }
+        return RESPONSE_ERROR_NONE;
     }
 
-    // Check if config data received.
-    else if(data_id == DATA_ID_CONFIG)
+    // Config data received, decoder accepts only known config fields.
+    switch(p_cmd->field_id)
     {
-        switch(field_id)
+
+        case FIELD_ID_RUN:
+        {
+            onboard_set_mode(ONBOARD_MODE_RUN);
+            break;
+        }
+
+        case FIELD_ID_CONFIG_START:
+        {
+            onboard_set_mode(ONBOARD_MODE_CONFIG);
+            if(onboard_get_state() == ONBOARD_STATE_IDLE)
+            {
+                onboard_set_state(ONBOARD_STATE_START);
+            }
+            break;
+        }
+
+        case FIELD_ID_CONFIG_STOP:
+        {
+            onboard_set_state(ONBOARD_STATE_IDLE);
+            break;
+        }
+
+        case FIELD_ID_CONFIG_STORE_PASSKEYS:
+        {
+            onboard_set_store_passkeys();
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
+        }
+
+        case FIELD_ID_KILL:
+        {
+            NVIC_SystemReset();
+            break;
+        }
+
+        // data[0] - module (0xFF for all modules), data[1] - level; ACK carries dropped messages counter.
+        case FIELD_ID_LOG_LEVEL:
+        {
+            uint32_t dropped;
+
+            if(debug_set_level(data[0], data[1]) == false)
+            {
+                return RESPONSE_ERROR_VALUE;
+            }
+            dropped = debug_get_dropped();
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, (uint8_t *)&dropped, sizeof(dropped));
+            break;
+        }
+
+        // data[0] - page, data[1] - if not 0, take new snapshot and clear counters before reading.
+        // Response is sent as DATA_ID_DEV_CENTRAL frame, data[0] - page, data[1..19] - content of page.
+        case FIELD_ID_STATS:
         {
+            uint8_t page_data[SPI_PACKET_DATA_SIZE];
+
+            if(data[1] != 0)
+            {
+                stats_snapshot();
+            }
 
-            case FIELD_ID_RUN:
+            page_data[0] = data[0];
+            if(stats_get_page(data[0], &page_data[1]) == 0)
             {
-                onboard_set_mode(ONBOARD_MODE_RUN);
-                return true;
+                return RESPONSE_ERROR_VALUE;
             }
+            spi_create_tx_packet(DATA_ID_DEV_CENTRAL, FIELD_ID_STATS, OPERATION_READ, page_data, sizeof(page_data));
+            break;
+        }
 
-            case FIELD_ID_CONFIG_START:
+        // data[0] - SPI_LINK_CAPABILITY to enable link layer, 0 to disable it. ACK is sent in new format.
+        case FIELD_ID_LINK:
+        {
+            if((data[0] != 0) && (data[0] != SPI_LINK_CAPABILITY))
             {
-                onboard_set_mode(ONBOARD_MODE_CONFIG);
-                if(onboard_get_state() == ONBOARD_STATE_IDLE)
+                return RESPONSE_ERROR_VALUE;
+            }
+            bool done = false;
+
+            // Link state is used by SPI interrupt, trailer of spi_tx_frame is rewritten.
+            while(done == false)
+            {
+                spi_tx_frame_acquire();
+                CRITICAL_REGION_ENTER();
+                if(spi_tx_frame_owned())
                 {
-                    onboard_set_state(ONBOARD_STATE_START);
+                    spi_link_enable(data[0] != 0);
+                    NRF_SPIS1->TASKS_RELEASE = 1;
+                    done = true;
                 }
-                return true;
+                CRITICAL_REGION_EXIT();
             }
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
+        }
+
+        // data[0..3] - host time, echoed in DATA_ID_DEV_CENTRAL time sync frame sent as response.
+        case FIELD_ID_TIME_SYNC:
+        {
+            uint32_t host_time;
+
+            memcpy((uint8_t *)&host_time, data, sizeof(host_time));
+            timestamp_sync(host_time);
+            break;
+        }
 
-            case FIELD_ID_CONFIG_STOP:
+        // No data. Records are sent in DATA_ID_DEV_CENTRAL frames, one per response, see adv_inventory_record_t.
+        case FIELD_ID_INVENTORY:
+        {
+            adv_inventory_dump_start();
+            adv_inventory_dump_next();
+            break;
+        }
+
+        // data[0] - data_id of sensor, data[1] - if not 0, forward data from advertising packets instead of connecting sensor.
+        case FIELD_ID_ADV_INGEST:
+        {
+            if(adv_ingest_enable((data_id_t)data[0], data[1] != 0) == false)
             {
-                onboard_set_state(ONBOARD_STATE_IDLE);
-                return true;
+                return RESPONSE_ERROR_VALUE;
             }
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
+        }
 
-            case FIELD_ID_CONFIG_STORE_PASSKEYS:
+        // data[0] - data_id of sensor, data[1] - if not 0, sensor type offering open Relayr service is served without security setup.
+        case FIELD_ID_OPEN_COMM:
+        {
+            if(onboard_set_open_comm((data_id_t)data[0], data[1] != 0) == false)
             {
-                onboard_set_store_passkeys();
-                spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
-                return true;
+                return RESPONSE_ERROR_VALUE;
             }
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
+        }
 
-            case FIELD_ID_KILL:
+        // data[0] - data_id of sensor, data[1..2] - period in s (0 keeps sensor connected), data[3] - window in s.
+        case FIELD_ID_ROTATION:
+        {
+            rotation_plan_t plan;
+
+            memcpy((uint8_t *)&plan, &data[1], sizeof(plan));
+            if(rotation_set_plan((data_id_t)data[0], &plan) == false)
             {
-                NVIC_SystemReset();
-                return true;
+                return RESPONSE_ERROR_VALUE;
             }
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
+        }
 
-            // save passkey locally; will be stored in NVRAM during onboarding
-            case FIELD_ID_CONFIG_HTU_PASS:
-            case FIELD_ID_CONFIG_GYRO_PASS:
-            case FIELD_ID_CONFIG_LIGHT_PASS:
-            case FIELD_ID_CONFIG_SOUND_PASS:
-            case FIELD_ID_CONFIG_BRIDGE_PASS:
-            case FIELD_ID_CONFIG_IR_PASS:
+        // data[0] - data_id of sensor instance, data[1..8] - passkey.
+        case FIELD_ID_CONFIG_INSTANCE_PASS:
+        {
+            if( (DATA_ID_IS_SENSOR(data[0]) == false) ||
+                (onboard_save_passkey_from_wifi(data[0], &data[1]) == false) )
             {
-                onboard_save_passkey_from_wifi(field_id, data);
-                spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
-                return true;
+                return RESPONSE_ERROR_VALUE;
             }
+            peer_backoff_reset();
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
+        }
 
+        default:
+        {
+            // save passkey locally; will be stored in NVRAM during onboarding
+            if(p_cmd->field_id > FIELD_ID_CONFIG_IR_PASS)
+            {
+                return RESPONSE_ERROR_FIELD_ID;
+            }
+            if(onboard_save_passkey_from_wifi(p_cmd->field_id, data) == false)
+            {
+                return RESPONSE_ERROR_VALUE;
+            }
+            // Sensors held back after failed pairing may pair with new passkey.
+            peer_backoff_reset();
+            spi_create_tx_packet(DATA_ID_DEV_CFG_APP, FIELD_ID_CONFIG_ACK, NOT_USED, NULL, 0);
+            break;
         }
     }
 
-    return false;
+    return RESPONSE_ERROR_NONE;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function decodes received frame, executes it and reports error to the host.
+ *
+ * @details Version 1 frames are answered with DATA_ID_RESPONSE_ERROR frame carrying error code,
+ *          legacy frames with INVALID config frame, as before.
+ *
+ * @param[in] p_frame  Received frame.
+ * @param[in] rx_len   Number of bytes received.
+ */
+
+static void spi_command_process(spi_frame_t * p_frame, uint8_t rx_len)
+{
+    spi_command_t    cmd;
+    response_error_t error;
+
+    cmd.v1 = false;
+    error  = spi_decode(p_frame, rx_len, &cmd);
+    if(error == RESPONSE_ERROR_NONE)
+    {
+        error = spi_handler(&cmd);
+    }
+
+    if(error == RESPONSE_ERROR_NONE)
+    {
+        return;
+    }
+
+    debug_log_module(DEBUG_MODULE_SPI, DEBUG_LEVEL_WARNING, "[SP]: Frame 0x%02X 0x%02X rejected, error %d\r\n",
+                     p_frame->data_id, p_frame->field_id, error);
+
+    if(cmd.v1)
+    {
+        uint8_t rejected[2];
+
+        rejected[0] = p_frame->data_id;
+        rejected[1] = p_frame->field_id;
+        spi_create_tx_packet(DATA_ID_RESPONSE_ERROR, error, NOT_USED, rejected, sizeof(rejected));
+    }
+    else
+    {
+        spi_create_tx_packet(DATA_ID_DEV_CFG_APP, INVALID, NOT_USED, NULL, 0);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function executes commands queued by SPI interrupt. Called from main loop.
+ */
+
+void spi_process_rx_queue(void)
+{
+    spi_rx_entry_t * p_entry;
+
+    while(spi_rx_queue_tail != spi_rx_queue_head)
+    {
+        // Entry shall be read after its index.
+        __DMB();
+        p_entry = &spi_rx_queue[spi_rx_queue_tail & SPI_RX_QUEUE_MASK];
+
+        // Commands run with interrupts enabled. Data shared with BLE and SPI interrupts is
+        // protected by the functions which access it.
+        spi_command_process(&p_entry->frame, p_entry->len);
+
+        // Entry shall be released after it was used.
+        __DMB();
+        spi_rx_queue_tail++;
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -370,25 +1344,37 @@ bool spi_slave_app_init(void)
     uint32_t mode_mask;
     uint8_t cnt;
 
-    for(cnt = 0; cnt < MAX_CLIENTS; cnt++)
+    for(cnt = 0; cnt < SPI_CLIENT_BUFFERS_NUM; cnt++)
     {
-        spi_clear_tx_packet((data_id_t)cnt);
+        memset((uint8_t *)&spi_clients_frame_buffer[cnt].frame, 0xFF, sizeof(spi_frame_t));
+        spi_clients_frame_buffer[cnt].data_status = FRAME_DATA_STATUS_EMPTY;
     }
+    memset((uint8_t *)&spi_sync_frame.frame, 0xFF, sizeof(spi_frame_t));
+    spi_sync_frame.data_status = FRAME_DATA_STATUS_EMPTY;
+    spi_tx_status = SPI_TX_STATUS_FREE;
     spi_curr_frame = &spi_clients_frame_buffer[0];
+    spi_sent_frame = NULL;
+
+    spi_link_enable(false);
+    spi_reset_frame_counters();
 
     memset((uint8_t *)&spi_tx_frame, 0xFF, sizeof(spi_tx_frame));
-    spi_tx_frame.data_id   = DATA_ID_DEV_CENTRAL;
-    spi_tx_frame.field_id  = FIELD_ID_CHAR_FIRMWARE_REVISION;
-    spi_tx_frame.operation = OPERATION_WRITE;
-    spi_tx_frame.data[0]   = strlen((const char *)CENTRAL_BLE_FIRMWARE_REV);
+    spi_tx_frame.frame.data_id   = DATA_ID_DEV_CENTRAL;
+    spi_tx_frame.frame.field_id  = FIELD_ID_CHAR_FIRMWARE_REVISION;
+    spi_tx_frame.frame.operation = OPERATION_WRITE;
+    spi_tx_frame.frame.data[0]   = strlen((const char *)CENTRAL_BLE_FIRMWARE_REV);
 
-    if(spi_tx_frame.data[0] > (SPI_PACKET_DATA_SIZE - 1))
+    // Last byte is reserved for link layer capability.
+    if(spi_tx_frame.frame.data[0] > (SPI_PACKET_DATA_SIZE - 2))
     {
-        spi_tx_frame.data[0] = (SPI_PACKET_DATA_SIZE - 1);
+        spi_tx_frame.frame.data[0] = (SPI_PACKET_DATA_SIZE - 2);
     }
-    memcpy((uint8_t *)&spi_tx_frame.data[1], (uint8_t *)CENTRAL_BLE_FIRMWARE_REV, spi_tx_frame.data[0]);
+    memcpy((uint8_t *)&spi_tx_frame.frame.data[1], (uint8_t *)CENTRAL_BLE_FIRMWARE_REV, spi_tx_frame.frame.data[0]);
+    spi_tx_frame.frame.data[SPI_PACKET_DATA_SIZE - 1] = SPI_LINK_CAPABILITY;
 
     memset((uint8_t *)&spi_rx_frame, 0xFF, sizeof(spi_rx_frame));
+    spi_rx_queue_head = 0;
+    spi_rx_queue_tail = 0;
 
     // Configure the SPI pins for input.
     NRF_GPIO->PIN_CNF[SPIS_MISO_PIN] =
@@ -436,8 +1422,9 @@ bool spi_slave_app_init(void)
     NRF_SPIS1->EVENTS_END      = 0;
     NRF_SPIS1->EVENTS_ACQUIRED = 0;
 
-    // Disable END_ACQUIRE shortcut.
-    NRF_SPIS1->SHORTS = 0;
+    // Enable END_ACQUIRE shortcut, buffers are owned by CPU from end of transaction until
+    // SPI interrupt has handled it.
+    NRF_SPIS1->SHORTS = (SPIS_SHORTS_END_ACQUIRE_Enabled << SPIS_SHORTS_END_ACQUIRE_Pos);
 
     // Set correct IRQ priority and clear any possible pending interrupt.
     NVIC_SetPriority(SPI1_TWI1_IRQn, APP_IRQ_PRIORITY_LOW);
@@ -13,6 +13,29 @@
 #include <stdint.h>
 #include "wunderbar_common.h"
 
+#define SPI_FRAME_COUNTERS_NUM (MAX_CLIENTS + 1)   /**< One entry per client frame buffer, last entry is for response frame. */
+
+/**@brief Frame counters of one SPI frame buffer. */
+typedef struct
+{
+    uint32_t written;       /**< Frames put into buffer. */
+    uint32_t overwritten;   /**< Frames replaced before they were sent to the host. */
+    uint32_t dropped;       /**< Frames discarded because buffer was locked. */
+    uint32_t sent;          /**< Frames clocked out to the host. */
+}
+spi_frame_counters_t;
+
+/**@brief SPI link layer counters. */
+typedef struct
+{
+    uint16_t crc_errors;    /**< Frames received from the host with wrong length or CRC. */
+    uint16_t naks;          /**< Frames not acknowledged by the host. */
+    uint16_t retransmits;   /**< Frames scheduled for retransmission. */
+    uint16_t abandoned;     /**< Frames given up after SPI_LINK_MAX_RETRIES retransmissions. */
+    uint16_t duplicates;    /**< Repeated commands from the host, not executed again. */
+}
+spi_link_counters_t;
+
 /**@brief Function for initializing the SPI slave example.
  *
  * @retval NRF_SUCCESS  Operation success.
@@ -22,8 +45,13 @@ bool spi_slave_app_init(void);
 void spi_create_tx_packet(data_id_t data_id_t, uint8_t field_id, uint8_t operation, uint8_t * data, uint8_t len);
 void spi_lock_tx_packet(data_id_t data_id);
 void spi_check_tx_ready(void);
+bool spi_response_is_free(void);
+void spi_process_rx_queue(void);
 void spi_clear_tx_packet(data_id_t data_id);
 bool spi_search_full_frame(void);
+const spi_frame_counters_t * spi_get_frame_counters(uint8_t index);
+void spi_reset_frame_counters(void);
+const spi_link_counters_t * spi_get_link_counters(void);
 
 #endif // SPI_SLAVE_EXAMPLE_H__
 
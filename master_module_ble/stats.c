@@ -0,0 +1,482 @@
+
+/** @file   stats.c
+ *  @brief  Runtime statistics of frames, connections and GATT operations,
+ *          readable over SPI as pages.
+ */
+
+/* -- Includes -- */
+
+#include "stats.h"
+#include "app_timer.h"
+#include "app_error.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+#define STATS_TIMER_INTERVAL  APP_TIMER_TICKS(60000, APP_TIMER_PRESCALER)   /**< Period of timer which keeps RTC1 running and extends 24-bit counter. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static app_timer_id_t stats_timer_id;
+static uint32_t       stats_period_ticks;
+static uint32_t       stats_period_mark;
+static uint32_t       stats_wakeups;
+static stats_path_t   stats_path[STATS_PATH_COUNT];
+static uint16_t       stats_notifications[MAX_CLIENTS];
+static uint16_t       stats_spi_rx_overflows;
+static uint16_t       stats_cache_hits;
+static uint16_t       stats_cache_misses;
+static uint16_t       stats_info_reads;
+static uint32_t       stats_inventory_ticks;
+static uint16_t       stats_rotation_cycles;
+static uint32_t       stats_rotation_lag_ticks;
+static uint16_t       stats_adv_ingested;
+static stats_path_t   stats_connect;
+static uint16_t       stats_connect_failures;
+static uint16_t       stats_peer_failures;
+static stats_path_t   stats_secure_resume;
+static stats_path_t   stats_secure_pair;
+static stats_path_t   stats_bringup_open;
+static stats_path_t   stats_bringup_secure;
+static uint16_t       stats_gatt_timeouts[MAX_CLIENTS];
+static uint8_t        stats_gatt_timeout_ids[MAX_CLIENTS];
+static stats_block_t  stats_snapshot_block;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns number of ticks passed since given tick count.
+ *
+ * @param[in] from  Start tick count.
+ *
+ * @return    Number of ticks.
+ */
+
+static uint32_t stats_ticks_since(uint32_t from)
+{
+    uint32_t now;
+    uint32_t diff;
+
+    app_timer_cnt_get(&now);
+    app_timer_cnt_diff_compute(now, from, &diff);
+    return diff;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Timeout handler of statistics timer. Accumulates ticks before RTC1 counter wraps around.
+ *
+ * @param[in] p_context  Not used.
+ */
+
+static void stats_timer_handler(void * p_context)
+{
+    stats_period_ticks += stats_ticks_since(stats_period_mark);
+    app_timer_cnt_get(&stats_period_mark);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes statistics module.
+ *
+ * @return    false in case error occurred, otherwise true.
+ */
+
+bool stats_init(void)
+{
+    uint32_t err_code;
+
+    memset((uint8_t *)stats_path, 0, sizeof(stats_path));
+    memset((uint8_t *)stats_notifications, 0, sizeof(stats_notifications));
+    memset((uint8_t *)&stats_snapshot_block, 0, sizeof(stats_snapshot_block));
+    stats_period_ticks = 0;
+    stats_wakeups = 0;
+    stats_spi_rx_overflows = 0;
+    stats_cache_hits = 0;
+    stats_cache_misses = 0;
+    stats_info_reads = 0;
+    stats_inventory_ticks = 0;
+    stats_rotation_cycles = 0;
+    stats_rotation_lag_ticks = 0;
+    stats_adv_ingested = 0;
+    memset((uint8_t *)&stats_connect, 0, sizeof(stats_connect));
+    stats_connect_failures = 0;
+    stats_peer_failures = 0;
+    memset((uint8_t *)&stats_secure_resume, 0, sizeof(stats_secure_resume));
+    memset((uint8_t *)&stats_secure_pair, 0, sizeof(stats_secure_pair));
+    memset((uint8_t *)&stats_bringup_open, 0, sizeof(stats_bringup_open));
+    memset((uint8_t *)&stats_bringup_secure, 0, sizeof(stats_bringup_secure));
+    memset((uint8_t *)stats_gatt_timeouts, 0, sizeof(stats_gatt_timeouts));
+    memset((uint8_t *)stats_gatt_timeout_ids, DATA_ID_ERROR, sizeof(stats_gatt_timeout_ids));
+    memset((uint8_t *)stats_snapshot_block.gatt_timeout_ids, DATA_ID_ERROR, sizeof(stats_snapshot_block.gatt_timeout_ids));
+
+    err_code = app_timer_create(&stats_timer_id, APP_TIMER_MODE_REPEATED, stats_timer_handler);
+    if(err_code != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    // Running timer keeps RTC1 counting, which is used as time base for measurements.
+    err_code = app_timer_start(stats_timer_id, STATS_TIMER_INTERVAL, NULL);
+    if(err_code != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    app_timer_cnt_get(&stats_period_mark);
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns current tick count, used as start of measured path.
+ *
+ * @return    Current tick count.
+ */
+
+uint32_t stats_path_begin(void)
+{
+    uint32_t ticks;
+
+    app_timer_cnt_get(&ticks);
+    return ticks;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function adds duration to counters.
+ *
+ * @param[in] p_path  Counters.
+ * @param[in] ticks   Duration in RTC1 ticks.
+ */
+
+static void stats_add_duration(stats_path_t * p_path, uint32_t ticks)
+{
+    p_path->count++;
+    p_path->total_ticks += ticks;
+    if(ticks > p_path->max_ticks)
+    {
+        p_path->max_ticks = ticks;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records execution of measured path.
+ *
+ * @param[in] path   Path identifier.
+ * @param[in] start  Tick count returned by stats_path_begin().
+ */
+
+void stats_path_end(stats_path_id_t path, uint32_t start)
+{
+    stats_add_duration(&stats_path[path], stats_ticks_since(start));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts wakeup of main loop.
+ */
+
+void stats_count_wakeup(void)
+{
+    stats_wakeups++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts notification received from sensor.
+ *
+ * @param[in] data_id  Data ID of sensor.
+ */
+
+void stats_count_notification(uint8_t data_id)
+{
+    if(data_id < MAX_CLIENTS)
+    {
+        stats_notifications[data_id]++;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts received SPI frame dropped because command queue was full.
+ */
+
+void stats_count_spi_rx_overflow(void)
+{
+    stats_spi_rx_overflows++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts cached read request.
+ *
+ * @param[in] hit  true if request was answered from value cache.
+ */
+
+void stats_count_cache_read(bool hit)
+{
+    if(hit)
+    {
+        stats_cache_hits++;
+    }
+    else
+    {
+        stats_cache_misses++;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts read answered from device information read at connection.
+ */
+
+void stats_count_info_read(void)
+{
+    stats_info_reads++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records time from connection to running state of sensor.
+ *
+ * @param[in] ticks  Time in RTC1 ticks.
+ */
+
+void stats_record_inventory(uint32_t ticks)
+{
+    if(ticks > stats_inventory_ticks)
+    {
+        stats_inventory_ticks = ticks;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts sensor value forwarded from advertising packet.
+ */
+
+void stats_count_adv_ingest(void)
+{
+    stats_adv_ingested++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records connection of sensor in rotation.
+ *
+ * @param[in] lag_ticks  Delay of connection after due time, in RTC1 ticks.
+ */
+
+void stats_record_rotation(uint32_t lag_ticks)
+{
+    stats_rotation_cycles++;
+    if(lag_ticks > stats_rotation_lag_ticks)
+    {
+        stats_rotation_lag_ticks = lag_ticks;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records result of connection request.
+ *
+ * @param[in] success  true if connection was established.
+ * @param[in] ticks    Time from first report of advertiser to connection, in RTC1 ticks.
+ */
+
+void stats_record_connect(bool success, uint32_t ticks)
+{
+    if(success == false)
+    {
+        stats_connect_failures++;
+        return;
+    }
+
+    stats_add_duration(&stats_connect, ticks);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts failure which held peer back.
+ */
+
+void stats_count_peer_failure(void)
+{
+    stats_peer_failures++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records security setup of connection.
+ *
+ * @param[in] resumed  true if link was encrypted with stored keys, false if sensor was paired.
+ * @param[in] ticks    Time from connection to secured link, in RTC1 ticks.
+ */
+
+void stats_record_security(bool resumed, uint32_t ticks)
+{
+    stats_add_duration(resumed ? &stats_secure_resume : &stats_secure_pair, ticks);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function records bring-up of connection.
+ *
+ * @param[in] open_comm  true if sensor was served without security setup.
+ * @param[in] ticks      Time from connection to running state, in RTC1 ticks.
+ */
+
+void stats_record_bringup(bool open_comm, uint32_t ticks)
+{
+    stats_add_duration(open_comm ? &stats_bringup_open : &stats_bringup_secure, ticks);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function counts GATT operation which missed its deadline. Counts are kept per client, so
+ *        instances of the same sensor type are told apart.
+ *
+ * @param[in] client   Index of client, which is connection ID.
+ * @param[in] data_id  Data ID of sensor served by client.
+ */
+
+void stats_count_gatt_timeout(uint8_t client, uint8_t data_id)
+{
+    if(client < MAX_CLIENTS)
+    {
+        stats_gatt_timeouts[client]++;
+        stats_gatt_timeout_ids[client] = data_id;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function copies live counters to snapshot and clears them.
+ */
+
+void stats_snapshot(void)
+{
+    uint8_t cnt;
+
+    CRITICAL_REGION_ENTER();
+
+    stats_snapshot_block.period_ticks = stats_period_ticks + stats_ticks_since(stats_period_mark);
+    stats_period_ticks = 0;
+    app_timer_cnt_get(&stats_period_mark);
+
+    stats_snapshot_block.wakeups = stats_wakeups;
+    stats_wakeups = 0;
+
+    memcpy((uint8_t *)stats_snapshot_block.path, (uint8_t *)stats_path, sizeof(stats_path));
+    memset((uint8_t *)stats_path, 0, sizeof(stats_path));
+
+    memcpy((uint8_t *)stats_snapshot_block.notifications, (uint8_t *)stats_notifications, sizeof(stats_notifications));
+    memset((uint8_t *)stats_notifications, 0, sizeof(stats_notifications));
+
+    stats_snapshot_block.spi_rx_overflows = stats_spi_rx_overflows;
+    stats_spi_rx_overflows = 0;
+
+    stats_snapshot_block.cache_hits = stats_cache_hits;
+    stats_snapshot_block.cache_misses = stats_cache_misses;
+    stats_cache_hits = 0;
+    stats_cache_misses = 0;
+
+    stats_snapshot_block.info_reads = stats_info_reads;
+    stats_snapshot_block.inventory_ticks = stats_inventory_ticks;
+    stats_info_reads = 0;
+    stats_inventory_ticks = 0;
+
+    stats_snapshot_block.rotation_cycles = stats_rotation_cycles;
+    stats_snapshot_block.rotation_lag_ticks = stats_rotation_lag_ticks;
+    stats_rotation_cycles = 0;
+    stats_rotation_lag_ticks = 0;
+
+    stats_snapshot_block.adv_ingested = stats_adv_ingested;
+    stats_adv_ingested = 0;
+
+    stats_snapshot_block.connect = stats_connect;
+    stats_snapshot_block.connect_failures = stats_connect_failures;
+    memset((uint8_t *)&stats_connect, 0, sizeof(stats_connect));
+    stats_connect_failures = 0;
+
+    stats_snapshot_block.peer_failures = stats_peer_failures;
+    stats_peer_failures = 0;
+
+    stats_snapshot_block.secure_resume = stats_secure_resume;
+    stats_snapshot_block.secure_pair = stats_secure_pair;
+    memset((uint8_t *)&stats_secure_resume, 0, sizeof(stats_secure_resume));
+    memset((uint8_t *)&stats_secure_pair, 0, sizeof(stats_secure_pair));
+
+    stats_snapshot_block.bringup_open = stats_bringup_open;
+    stats_snapshot_block.bringup_secure = stats_bringup_secure;
+    memset((uint8_t *)&stats_bringup_open, 0, sizeof(stats_bringup_open));
+    memset((uint8_t *)&stats_bringup_secure, 0, sizeof(stats_bringup_secure));
+
+    memcpy((uint8_t *)stats_snapshot_block.gatt_timeouts, (uint8_t *)stats_gatt_timeouts, sizeof(stats_gatt_timeouts));
+    memcpy((uint8_t *)stats_snapshot_block.gatt_timeout_ids, (uint8_t *)stats_gatt_timeout_ids, sizeof(stats_gatt_timeout_ids));
+    memset((uint8_t *)stats_gatt_timeouts, 0, sizeof(stats_gatt_timeouts));
+    memset((uint8_t *)stats_gatt_timeout_ids, DATA_ID_ERROR, sizeof(stats_gatt_timeout_ids));
+
+    for(cnt = 0; cnt < SPI_FRAME_COUNTERS_NUM; cnt++)
+    {
+        memcpy((uint8_t *)&stats_snapshot_block.frames[cnt], (uint8_t *)spi_get_frame_counters(cnt), sizeof(spi_frame_counters_t));
+    }
+    memcpy((uint8_t *)&stats_snapshot_block.link, (uint8_t *)spi_get_link_counters(), sizeof(spi_link_counters_t));
+    spi_reset_frame_counters();
+
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function copies one page of snapshot to buffer.
+ *
+ * @param[in]  page  Page number.
+ * @param[out] data  Destination buffer, at least STATS_PAGE_DATA_SIZE bytes long.
+ *
+ * @return     Number of copied bytes, 0 if page does not exist.
+ */
+
+uint8_t stats_get_page(uint8_t page, uint8_t * data)
+{
+    uint16_t offset = (uint16_t)page * STATS_PAGE_DATA_SIZE;
+    uint16_t len;
+
+    if(offset >= sizeof(stats_block_t))
+    {
+        return 0;
+    }
+
+    len = sizeof(stats_block_t) - offset;
+    if(len > STATS_PAGE_DATA_SIZE)
+    {
+        len = STATS_PAGE_DATA_SIZE;
+    }
+
+    memcpy(data, (uint8_t *)&stats_snapshot_block + offset, len);
+    return (uint8_t)len;
+}
@@ -0,0 +1,208 @@
+
+/** @file   stats.h
+ *  @brief  Runtime statistics of frames, connections and GATT operations,
+ *          readable over SPI as pages.
+ */
+
+#ifndef STATS_H__
+#define STATS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wunderbar_common.h"
+#include "spi_slave_config.h"
+
+#define STATS_PAGE_DATA_SIZE    (SPI_PACKET_DATA_SIZE - 1)   /**< Bytes of statistics block carried by one SPI frame, data[0] is page number. */
+
+/**@brief Measured code paths. */
+typedef enum
+{
+    STATS_PATH_BLE_EVT       = 0,    /**< ble_evt_dispatch() chain. */
+    STATS_PATH_SPI_IRQ       = 1,    /**< SPI1_TWI1_IRQHandler(). */
+    STATS_PATH_SPI_TX_READY  = 2,    /**< spi_check_tx_ready(). */
+    STATS_PATH_PSTORAGE_RUN  = 3,    /**< pstorage_driver_run(). */
+    STATS_PATH_ONBOARD       = 4,    /**< onboard_state_handle(). */
+    STATS_PATH_CLIENT_EVENT  = 5,    /**< search_for_client_event(). */
+    STATS_PATH_ACTIVE        = 6,    /**< Main loop work between two wakeups. */
+    STATS_PATH_SPI_RX        = 7,    /**< spi_process_rx_queue(). */
+    STATS_PATH_ADV_INVENTORY = 8,    /**< adv_inventory_seen(), per advertising report. */
+    STATS_PATH_MODE_SWITCH   = 9,    /**< mode_switch(), scanning pauses meanwhile. */
+    STATS_PATH_COUNT
+}
+stats_path_id_t;
+
+/**@brief Counters of one measured path. Durations are in RTC1 ticks. */
+typedef struct
+{
+    uint32_t count;          /**< Number of executions. */
+    uint32_t total_ticks;    /**< Sum of execution times. */
+    uint32_t max_ticks;      /**< Longest execution time. */
+}
+__attribute__((packed)) stats_path_t;
+
+/**@brief Statistics block. Host reads it page by page as raw little-endian bytes. */
+typedef struct
+{
+    uint32_t              period_ticks;                          /**< RTC1 ticks covered by this block. */
+    uint32_t              wakeups;                               /**< Number of returns from sd_app_evt_wait(). */
+    stats_path_t          path[STATS_PATH_COUNT];                /**< Path durations and counts. */
+    uint16_t              notifications[MAX_CLIENTS];            /**< Notifications received, per data ID. */
+    spi_frame_counters_t  frames[SPI_FRAME_COUNTERS_NUM];        /**< SPI frame counters, per data ID and response frame. */
+    uint16_t              spi_rx_overflows;                      /**< Received frames dropped because command queue was full. */
+    spi_link_counters_t   link;                                  /**< SPI link layer counters. */
+    uint16_t              cache_hits;                            /**< Cached reads answered from value cache. */
+    uint16_t              cache_misses;                          /**< Cached reads passed to the sensor. */
+    uint16_t              info_reads;                            /**< Reads answered from device information read at connection. */
+    uint32_t              inventory_ticks;                       /**< Longest time from connection to running state, including prefetch. */
+    uint16_t              rotation_cycles;                       /**< Connections of sensors in rotation. */
+    uint32_t              rotation_lag_ticks;                    /**< Longest delay of rotated sensor connection after its due time. */
+    uint16_t              adv_ingested;                          /**< Sensor values forwarded from advertising packets. */
+    stats_path_t          connect;                               /**< Time from first report of advertiser to its connection. */
+    uint16_t              connect_failures;                      /**< Connection requests which failed or timed out. */
+    uint16_t              peer_failures;                         /**< Failed connections or pairings which held peer back. */
+    stats_path_t          secure_resume;                         /**< Time from connection to link encrypted with stored keys. */
+    stats_path_t          secure_pair;                           /**< Time from connection to link secured by pairing. */
+    stats_path_t          bringup_open;                          /**< Time from connection to running state, sensor served without security. */
+    stats_path_t          bringup_secure;                        /**< Time from connection to running state, including security setup. */
+    uint16_t              gatt_timeouts[MAX_CLIENTS];            /**< GATT operations which missed their deadline, sensor was disconnected, per client. */
+    uint8_t               gatt_timeout_ids[MAX_CLIENTS];         /**< Data ID of sensor which missed deadline last, per client, DATA_ID_ERROR if none. */
+}
+__attribute__((packed)) stats_block_t;
+
+#define STATS_NUM_OF_PAGES      ((sizeof(stats_block_t) + STATS_PAGE_DATA_SIZE - 1) / STATS_PAGE_DATA_SIZE)
+
+/** @brief  Initialize statistics module. App timer module shall be initialized before.
+ *
+ *  @return false in case error occurred, otherwise true.
+ */
+bool     stats_init(void);
+
+/** @brief  Get current RTC1 tick count, used as start of measured path.
+ *
+ *  @return Current tick count.
+ */
+uint32_t stats_path_begin(void);
+
+/** @brief  Record execution of measured path.
+ *
+ *  @param  path   Path identifier.
+ *  @param  start  Tick count returned by stats_path_begin().
+ *
+ *  @return Void.
+ */
+void     stats_path_end(stats_path_id_t path, uint32_t start);
+
+/** @brief  Count wakeup of main loop.
+ *
+ *  @return Void.
+ */
+void     stats_count_wakeup(void);
+
+/** @brief  Count notification received from sensor.
+ *
+ *  @param  data_id  Data ID of sensor.
+ *
+ *  @return Void.
+ */
+void     stats_count_notification(uint8_t data_id);
+
+/** @brief  Count received SPI frame dropped because command queue was full.
+ *
+ *  @return Void.
+ */
+void     stats_count_spi_rx_overflow(void);
+
+/** @brief  Count cached read request.
+ *
+ *  @param  hit  true if request was answered from value cache.
+ *
+ *  @return Void.
+ */
+void     stats_count_cache_read(bool hit);
+
+/** @brief  Count read answered from device information read at connection.
+ *
+ *  @return Void.
+ */
+void     stats_count_info_read(void);
+
+/** @brief  Record time from connection to running state of sensor.
+ *
+ *  @param  ticks  Time in RTC1 ticks.
+ *
+ *  @return Void.
+ */
+void     stats_record_inventory(uint32_t ticks);
+
+/** @brief  Count sensor value forwarded from advertising packet.
+ *
+ *  @return Void.
+ */
+void     stats_count_adv_ingest(void);
+
+/** @brief  Record connection of sensor in rotation.
+ *
+ *  @param  lag_ticks  Delay of connection after due time, in RTC1 ticks.
+ *
+ *  @return Void.
+ */
+void     stats_record_rotation(uint32_t lag_ticks);
+
+/** @brief  Record result of connection request.
+ *
+ *  @param  success  true if connection was established.
+ *  @param  ticks    Time from first report of advertiser to connection, in RTC1 ticks.
+ *
+ *  @return Void.
+ */
+void     stats_record_connect(bool success, uint32_t ticks);
+
+/** @brief  Count failure which held peer back.
+ *
+ *  @return Void.
+ */
+void     stats_count_peer_failure(void);
+
+/** @brief  Record security setup of connection.
+ *
+ *  @param  resumed  true if link was encrypted with stored keys, false if sensor was paired.
+ *  @param  ticks    Time from connection to secured link, in RTC1 ticks.
+ *
+ *  @return Void.
+ */
+void     stats_record_security(bool resumed, uint32_t ticks);
+
+/** @brief  Record bring-up of connection.
+ *
+ *  @param  open_comm  true if sensor was served without security setup.
+ *  @param  ticks      Time from connection to running state, in RTC1 ticks.
+ *
+ *  @return Void.
+ */
+void     stats_record_bringup(bool open_comm, uint32_t ticks);
+
+/** @brief  Count GATT operation which missed its deadline.
+ *
+ *  @param  client   Index of client, which is connection ID.
+ *  @param  data_id  Data ID of sensor served by client.
+ *
+ *  @return Void.
+ */
+void     stats_count_gatt_timeout(uint8_t client, uint8_t data_id);
+
+/** @brief  Copy live counters to snapshot and clear them.
+ *
+ *  @return Void.
+ */
+void     stats_snapshot(void);
+
+/** @brief  Copy one page of snapshot to buffer.
+ *
+ *  @param  page  Page number.
+ *  @param  data  Destination buffer, at least STATS_PAGE_DATA_SIZE bytes long.
+ *
+ *  @return Number of copied bytes, 0 if page does not exist.
+ */
+uint8_t  stats_get_page(uint8_t page, uint8_t * data);
+
+#endif // STATS_H__
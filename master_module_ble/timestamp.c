@@ -0,0 +1,181 @@
+
+/** @file   timestamp.c
+ *  @brief  Timestamping of sensor data relative to periodic time sync
+ *          frames sent to the host.
+ */
+
+/* -- Includes -- */
+
+#include "timestamp.h"
+#include "spi_slave_config.h"
+#include "app_timer.h"
+#include "app_error.h"
+#include "app_util_platform.h"
+
+#define TIMESTAMP_SYNC_INTERVAL  APP_TIMER_TICKS(30000, APP_TIMER_PRESCALER)   /**< Sync period, shorter than stamp range (~64 s) and RTC1 wrap (512 s). */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static app_timer_id_t   timestamp_timer_id;
+static uint32_t         timestamp_base;          /**< Extended time at timestamp_mark. */
+static uint32_t         timestamp_mark;          /**< RTC1 counter value at last extension. */
+static bool             timestamp_enabled;
+static timestamp_sync_t timestamp_last_sync;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function starts new sync period and queues sync frame for the host. Sync frame has its own
+ *        SPI frame buffer, so it does not compete with responses.
+ */
+
+static void timestamp_send_sync(void)
+{
+    timestamp_sync_t sync;
+
+    CRITICAL_REGION_ENTER();
+    timestamp_last_sync.ticks   = timestamp_now();
+    timestamp_last_sync.sync_id = (timestamp_last_sync.sync_id + 1) & TIMESTAMP_SYNC_ID_MASK;
+    sync = timestamp_last_sync;
+    CRITICAL_REGION_EXIT();
+
+    spi_create_tx_packet(DATA_ID_DEV_CENTRAL, FIELD_ID_TIME_SYNC, OPERATION_WRITE, (uint8_t *)&sync, sizeof(sync));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Timeout handler of timestamp timer. Extends RTC1 counter and sends periodic sync frame.
+ *
+ * @param[in] p_context  Not used.
+ */
+
+static void timestamp_timer_handler(void * p_context)
+{
+    uint32_t cnt;
+    uint32_t diff;
+
+    // Counter is read once, so no tick is lost between base and mark.
+    CRITICAL_REGION_ENTER();
+    app_timer_cnt_get(&cnt);
+    app_timer_cnt_diff_compute(cnt, timestamp_mark, &diff);
+    timestamp_base += diff;
+    timestamp_mark  = cnt;
+    CRITICAL_REGION_EXIT();
+
+    if(timestamp_enabled)
+    {
+        timestamp_send_sync();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes timestamp module.
+ *
+ * @return    false in case error occurred, otherwise true.
+ */
+
+bool timestamp_init(void)
+{
+    uint32_t err_code;
+
+    timestamp_base    = 0;
+    timestamp_enabled = false;
+    timestamp_last_sync.ticks      = 0;
+    timestamp_last_sync.host_time  = 0;
+    timestamp_last_sync.sync_id    = 0;
+    timestamp_last_sync.unit_shift = TIMESTAMP_UNIT_SHIFT;
+    app_timer_cnt_get(&timestamp_mark);
+
+    err_code = app_timer_create(&timestamp_timer_id, APP_TIMER_MODE_REPEATED, timestamp_timer_handler);
+    if(err_code != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    err_code = app_timer_start(timestamp_timer_id, TIMESTAMP_SYNC_INTERVAL, NULL);
+    if(err_code != NRF_SUCCESS)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns master time.
+ *
+ * @return    RTC1 ticks extended to 32 bits.
+ */
+
+uint32_t timestamp_now(void)
+{
+    uint32_t cnt;
+    uint32_t diff;
+    uint32_t now;
+
+    CRITICAL_REGION_ENTER();
+    app_timer_cnt_get(&cnt);
+    app_timer_cnt_diff_compute(cnt, timestamp_mark, &diff);
+    now = timestamp_base + diff;
+    CRITICAL_REGION_EXIT();
+
+    return now;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function handles time sync command of the host.
+ *
+ * @param[in] host_time  Host time, echoed back in sync frame.
+ */
+
+void timestamp_sync(uint32_t host_time)
+{
+    CRITICAL_REGION_ENTER();
+    timestamp_last_sync.host_time = host_time;
+    timestamp_enabled = true;
+    CRITICAL_REGION_EXIT();
+
+    timestamp_send_sync();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns stamp of current time.
+ *
+ * @param[out] p_sync_id  Sync frame the stamp is relative to.
+ *
+ * @return     Stamp, TIMESTAMP_NONE if stamping is not enabled or delta does not fit.
+ */
+
+uint16_t timestamp_stamp(uint8_t * p_sync_id)
+{
+    uint32_t delta;
+
+    if(timestamp_enabled == false)
+    {
+        *p_sync_id = 0;
+        return TIMESTAMP_NONE;
+    }
+
+    CRITICAL_REGION_ENTER();
+    *p_sync_id = timestamp_last_sync.sync_id;
+    delta = (timestamp_now() - timestamp_last_sync.ticks) >> TIMESTAMP_UNIT_SHIFT;
+    CRITICAL_REGION_EXIT();
+
+    if(delta >= TIMESTAMP_NONE)
+    {
+        return TIMESTAMP_NONE;
+    }
+    return (uint16_t)delta;
+}
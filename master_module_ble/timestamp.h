@@ -0,0 +1,60 @@
+
+/** @file   timestamp.h
+ *  @brief  Timestamping of sensor data relative to periodic time sync
+ *          frames sent to the host.
+ */
+
+#ifndef TIMESTAMP_H__
+#define TIMESTAMP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMESTAMP_UNIT_SHIFT       5                       /**< Stamp unit is 2^5 RTC1 ticks, ~0.98 ms. */
+#define TIMESTAMP_NONE             0xFFFF                  /**< Frame carries no stamp, or stamp is out of range. */
+#define TIMESTAMP_SYNC_ID_MASK     0x0F                    /**< Sync frames are numbered modulo 16. */
+
+/**@brief Content of DATA_ID_DEV_CENTRAL, FIELD_ID_TIME_SYNC frame.
+ *
+ * @details Stamps are 16-bit deltas, in units of 2^unit_shift RTC1 ticks, from time of sync frame
+ *          with the same sync_id. Sync frame is sent on FIELD_ID_TIME_SYNC command and then
+ *          periodically, so deltas never overflow.
+ */
+typedef struct
+{
+    uint32_t ticks;        /**< Master time of sync, RTC1 ticks (32768 Hz) extended to 32 bits. */
+    uint32_t host_time;    /**< Host time from last FIELD_ID_TIME_SYNC command, echoed back. */
+    uint8_t  sync_id;      /**< Number of sync frame, modulo 16. */
+    uint8_t  unit_shift;   /**< TIMESTAMP_UNIT_SHIFT. */
+}
+__attribute__((packed)) timestamp_sync_t;
+
+/** @brief  Initialize timestamp module. Shall be called after APP_TIMER_INIT.
+ *
+ *  @return false in case error occurred, otherwise true.
+ */
+bool     timestamp_init(void);
+
+/** @brief  Get master time.
+ *
+ *  @return RTC1 ticks extended to 32 bits.
+ */
+uint32_t timestamp_now(void);
+
+/** @brief  Handle time sync command of the host: enable stamping and send new sync frame.
+ *
+ *  @param  host_time  Host time, echoed back in sync frame.
+ *
+ *  @return Void.
+ */
+void     timestamp_sync(uint32_t host_time);
+
+/** @brief  Get stamp of current time.
+ *
+ *  @param  p_sync_id  Sync frame the stamp is relative to.
+ *
+ *  @return Stamp, TIMESTAMP_NONE if stamping is not enabled or delta does not fit.
+ */
+uint16_t timestamp_stamp(uint8_t * p_sync_id);
+
+#endif // TIMESTAMP_H__
@@ -0,0 +1,189 @@
+
+/** @file   value_cache.c
+ *  @brief  Cache of the last values received from sensors,
+ *          served to SPI reads with a maximum age.
+ */
+
+/* -- Includes -- */
+
+#include "value_cache.h"
+#include "timestamp.h"
+#include "stats.h"
+#include "app_timer.h"
+#include "app_util_platform.h"
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**@brief Cached value. */
+typedef struct
+{
+    uint32_t  stored;                          /**< Master time the value was received. */
+    uint32_t  used;                            /**< Master time the entry was last stored or read. */
+    uint8_t   data_id;                         /**< DATA_ID_ERROR if entry is free. */
+    uint8_t   field_id;
+    uint8_t   len;
+    uint8_t   data[SPI_PACKET_DATA_SIZE];
+}
+value_cache_entry_t;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static value_cache_entry_t value_cache[VALUE_CACHE_SIZE];
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function finds entry of given value.
+ *
+ * @param[in] data_id   Data ID of sensor.
+ * @param[in] field_id  Field ID of characteristic.
+ *
+ * @return    Pointer to entry, NULL if value is not cached.
+ */
+
+static value_cache_entry_t * value_cache_find(data_id_t data_id, uint8_t field_id)
+{
+    uint8_t cnt;
+
+    for(cnt = 0; cnt < VALUE_CACHE_SIZE; cnt++)
+    {
+        if( (value_cache[cnt].data_id == data_id) &&
+            (value_cache[cnt].field_id == field_id) )
+        {
+            return &value_cache[cnt];
+        }
+    }
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function initializes value cache.
+ */
+
+void value_cache_init(void)
+{
+    memset((uint8_t *)value_cache, 0, sizeof(value_cache));
+    value_cache_invalidate(DATA_ID_ERROR, VALUE_CACHE_ALL_FIELDS);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function stores value received from sensor, replacing free or least recently used entry.
+ *
+ * @param[in] data_id   Data ID of sensor.
+ * @param[in] field_id  Field ID of characteristic.
+ * @param[in] data      Value.
+ * @param[in] len       Value length.
+ */
+
+void value_cache_store(data_id_t data_id, uint8_t field_id, const uint8_t * data, uint8_t len)
+{
+    value_cache_entry_t * p_entry;
+    uint32_t              now = timestamp_now();
+    uint8_t               cnt;
+
+    if( (DATA_ID_IS_SENSOR(data_id) == false) ||
+        (field_id >= FIELD_ID_SENSOR_STATUS) ||
+        (len > SPI_PACKET_DATA_SIZE) )
+    {
+        return;
+    }
+
+    p_entry = value_cache_find(data_id, field_id);
+    if(p_entry == NULL)
+    {
+        p_entry = &value_cache[0];
+        for(cnt = 0; cnt < VALUE_CACHE_SIZE; cnt++)
+        {
+            if(value_cache[cnt].data_id == DATA_ID_ERROR)
+            {
+                p_entry = &value_cache[cnt];
+                break;
+            }
+            if((now - value_cache[cnt].used) > (now - p_entry->used))
+            {
+                p_entry = &value_cache[cnt];
+            }
+        }
+    }
+
+    p_entry->stored   = now;
+    p_entry->used     = now;
+    p_entry->data_id  = data_id;
+    p_entry->field_id = field_id;
+    p_entry->len      = len;
+    memcpy(p_entry->data, data, len);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function copies cached value, if it is not older than given age.
+ *
+ * @param[in]  data_id     Data ID of sensor.
+ * @param[in]  field_id    Field ID of characteristic.
+ * @param[in]  max_age_ms  Maximum age of value.
+ * @param[out] data        Destination buffer, at least SPI_PACKET_DATA_SIZE bytes long.
+ * @param[out] p_len       Value length.
+ *
+ * @return     true if value was found, otherwise false.
+ */
+
+bool value_cache_lookup(data_id_t data_id, uint8_t field_id, uint16_t max_age_ms, uint8_t * data, uint8_t * p_len)
+{
+    value_cache_entry_t * p_entry;
+    uint32_t              now   = timestamp_now();
+    bool                  found = false;
+
+    // Called from main loop, values are stored from BLE interrupt.
+    CRITICAL_REGION_ENTER();
+
+    p_entry = value_cache_find(data_id, field_id);
+    if( (p_entry != NULL) &&
+        ((now - p_entry->stored) <= (((uint32_t)max_age_ms * APP_TIMER_CLOCK_FREQ) / 1000)) )
+    {
+        p_entry->used = now;
+        *p_len = p_entry->len;
+        memcpy(data, p_entry->data, p_entry->len);
+        found = true;
+    }
+
+    CRITICAL_REGION_EXIT();
+
+    stats_count_cache_read(found);
+    return found;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function drops cached values.
+ *
+ * @param[in] data_id   Data ID of sensor, DATA_ID_ERROR for all sensors.
+ * @param[in] field_id  Field ID of characteristic, VALUE_CACHE_ALL_FIELDS for all fields of sensor.
+ */
+
+void value_cache_invalidate(data_id_t data_id, uint8_t field_id)
+{
+    uint8_t cnt;
+
+    CRITICAL_REGION_ENTER();
+    for(cnt = 0; cnt < VALUE_CACHE_SIZE; cnt++)
+    {
+        if( ((data_id == DATA_ID_ERROR) || (value_cache[cnt].data_id == data_id)) &&
+            ((field_id == VALUE_CACHE_ALL_FIELDS) || (value_cache[cnt].field_id == field_id)) )
+        {
+            value_cache[cnt].data_id = DATA_ID_ERROR;
+        }
+    }
+    CRITICAL_REGION_EXIT();
+}
@@ -0,0 +1,56 @@
+
+/** @file   value_cache.h
+ *  @brief  Cache of the last values received from sensors,
+ *          served to SPI reads with a maximum age.
+ */
+
+#ifndef VALUE_CACHE_H__
+#define VALUE_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "wunderbar_common.h"
+
+#define VALUE_CACHE_SIZE          8       /**< Number of cached values, least recently used one is replaced. */
+#define VALUE_CACHE_ALL_FIELDS    0xFF    /**< Field ID selecting all fields of sensor. */
+
+/** @brief  Initialize value cache.
+ *
+ *  @return Void.
+ */
+void value_cache_init(void);
+
+/** @brief  Store value received from sensor. Shall be called from BLE event handler or critical region.
+ *
+ *  @param  data_id   Data ID of sensor.
+ *  @param  field_id  Field ID of characteristic.
+ *  @param  data      Value.
+ *  @param  len       Value length.
+ *
+ *  @return Void.
+ */
+void value_cache_store(data_id_t data_id, uint8_t field_id, const uint8_t * data, uint8_t len);
+
+/** @brief  Get cached value, if it is not older than given age. Shall be called from BLE event
+ *          handler or critical region.
+ *
+ *  @param  data_id      Data ID of sensor.
+ *  @param  field_id     Field ID of characteristic.
+ *  @param  max_age_ms   Maximum age of value.
+ *  @param  data         Destination buffer, at least SPI_PACKET_DATA_SIZE bytes long.
+ *  @param  p_len        Value length.
+ *
+ *  @return true if value was found, otherwise false.
+ */
+bool value_cache_lookup(data_id_t data_id, uint8_t field_id, uint16_t max_age_ms, uint8_t * data, uint8_t * p_len);
+
+/** @brief  Drop cached values. Shall be called from BLE event handler or critical region.
+ *
+ *  @param  data_id   Data ID of sensor, DATA_ID_ERROR for all sensors.
+ *  @param  field_id  Field ID of characteristic, VALUE_CACHE_ALL_FIELDS for all fields of sensor.
+ *
+ *  @return Void.
+ */
+void value_cache_invalidate(data_id_t data_id, uint8_t field_id);
+
+#endif // VALUE_CACHE_H__
@@ -0,0 +1,54 @@
+
+/** @file   work_flags.c
+ *  @brief  Flags which signal pending work from interrupt handlers
+ *          to the main loop.
+ */
+
+/* -- Includes -- */
+
+#include "work_flags.h"
+#include "app_util_platform.h"
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Declaration of static variables. */
+
+static volatile uint32_t work_flags = 0;
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function marks work as pending. Can be called from interrupt context.
+ *
+ * @param[in] flags  Work flags to be set.
+ */
+
+void work_flags_set(uint32_t flags)
+{
+    CRITICAL_REGION_ENTER();
+    work_flags |= flags;
+    CRITICAL_REGION_EXIT();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Function returns pending work and clears returned flags.
+ *
+ * @param[in] mask  Work flags of interest. Flags outside of mask stay pending.
+ *
+ * @return    Pending work flags.
+ */
+
+uint32_t work_flags_take(uint32_t mask)
+{
+    uint32_t flags;
+
+    CRITICAL_REGION_ENTER();
+    flags = work_flags & mask;
+    work_flags &= ~flags;
+    CRITICAL_REGION_EXIT();
+
+    return flags;
+}
@@ -0,0 +1,37 @@
+
+/** @file   work_flags.h
+ *  @brief  Flags which signal pending work from interrupt handlers
+ *          to the main loop.
+ */
+
+#ifndef WORK_FLAGS_H__
+#define WORK_FLAGS_H__
+
+#include <stdint.h>
+
+/**@brief Pending work flags. Each flag selects handler which will be called from main loop. */
+#define WORK_FLAG_ONBOARD        (1UL << 0)    /**< onboard_state_handle(). */
+#define WORK_FLAG_PSTORAGE       (1UL << 1)    /**< pstorage_driver_run(). */
+#define WORK_FLAG_CLIENT_EVENT   (1UL << 2)    /**< search_for_client_event(). */
+#define WORK_FLAG_SPI_TX         (1UL << 3)    /**< spi_check_tx_ready(). */
+#define WORK_FLAG_SPI_RX         (1UL << 4)    /**< spi_process_rx_queue(). */
+#define WORK_FLAG_ROTATION       (1UL << 5)    /**< rotation_run(). */
+#define WORK_FLAG_CLIENT_TIMEOUT (1UL << 6)    /**< check_client_timeout(). */
+
+/** @brief  Mark work as pending. Can be called from interrupt context.
+ *
+ *  @param  flags  Work flags to be set.
+ *
+ *  @return Void.
+ */
+void     work_flags_set(uint32_t flags);
+
+/** @brief  Get pending work and clear returned flags.
+ *
+ *  @param  mask  Work flags of interest. Flags outside of mask stay pending.
+ *
+ *  @return Pending work flags.
+ */
+uint32_t work_flags_take(uint32_t mask);
+
+#endif // WORK_FLAGS_H__
@@ -77,7 +77,9 @@ Revision: $Rev: 5504 $
 #define SEGGER_RTT_MAX_NUM_UP_BUFFERS             (1)     // Max. number of up-buffers (T->H) available on this target    (Default: 3)
 #define SEGGER_RTT_MAX_NUM_DOWN_BUFFERS           (1)     // Max. number of down-buffers (H->T) available on this target  (Default: 3)
 
-#define BUFFER_SIZE_UP                            (128)  // Size of the buffer for terminal output of target, up to host (Default: 1k)
+#ifndef BUFFER_SIZE_UP
+  #define BUFFER_SIZE_UP                          (128)  // Size of the buffer for terminal output of target, up to host (Default: 1k). Can be overridden from build.ninja.
+#endif
 #define BUFFER_SIZE_DOWN                          (16)    // Size of the buffer for terminal input to target from host (Usually keyboard input) (Default: 16)
 
 #define SEGGER_RTT_PRINTF_BUFFER_SIZE             (64u)    // Size of buffer for RTT printf to bulk-send chars via RTT     (Default: 64)
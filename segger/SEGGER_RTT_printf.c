@@ -461,9 +461,13 @@ int SEGGER_RTT_vprintf(unsigned BufferIndex, const char * sFormat, va_list * pPa
     // Write remaining data, if any
     //
     if (BufferDesc.Cnt != 0u) {
-      SEGGER_RTT_Write(BufferIndex, acBuffer, BufferDesc.Cnt);
+      if (SEGGER_RTT_Write(BufferIndex, acBuffer, BufferDesc.Cnt) != BufferDesc.Cnt) {
+        BufferDesc.ReturnValue = -1;
+      }
+    }
+    if (BufferDesc.ReturnValue > 0) {
+      BufferDesc.ReturnValue += (int)BufferDesc.Cnt;
     }
-    BufferDesc.ReturnValue += (int)BufferDesc.Cnt;
   }
   return BufferDesc.ReturnValue;
 }
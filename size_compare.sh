@@ -0,0 +1,110 @@
+#!/bin/sh
+# Builds the firmware once without logs and once for every log level floor, and
+# prints image sizes of each variant next to the difference against the build
+# without logs. RAM use of each variant is taken from its linker map, with .data
+# and .bss of every object for the build without logs. Fails if static data and
+# stack do not fit RAM region of the linker script. Used by "ninja size_compare".
+#
+# usage: size_compare.sh <ninja file> <size tool> <image path relative to builddir> [floors]
+
+ninja_file=$1
+objsize=$2
+image=$3
+floors=${4:-"0 1 2 3 4"}
+tmp_dir=size_compare
+
+mkdir -p $tmp_dir
+
+# Build one variant into its own build directory.
+# $1 variant name, $2 log floor, $3 additional defines
+build_variant()
+{
+    sed -e "s|^builddir = .*|builddir = $tmp_dir/$1|" \
+        -e "s|^log_level_floor = .*|log_level_floor = $2|" \
+        -e "s|^additional_defines = .*||" \
+        -e "s|^cflags = \(.*\)|additional_defines = $3\ncflags = \1|" \
+        $ninja_file > $tmp_dir/$1.ninja
+    ninja -f $tmp_dir/$1.ninja $tmp_dir/$1/$image > $tmp_dir/$1.log 2>&1 || { cat $tmp_dir/$1.log; exit 1; }
+}
+
+# Print sizes of one variant.
+# $1 variant name
+print_variant()
+{
+    $objsize -B $tmp_dir/$1/$image | awk -v name=$1 -v base=$base_dec 'NR == 2 \
+        { printf "%-10s %8d %8d %8d %8d %+8d\n", name, $1, $2, $3, $4, $4 - base }'
+}
+
+# Print RAM use of one variant from its linker map, and .data and .bss of every
+# object if requested. Output sections placed in RAM region count, stack and heap
+# included. Returns 1 if they do not fit the region.
+# $1 variant name, $2 "objects" to list objects
+print_ram()
+{
+    awk -v name=$1 -v objects=$2 '
+        function hex(s,    i, n)
+        {
+            n = 0
+            s = tolower(s)
+            sub(/^0x/, "", s)
+            for(i = 1; i <= length(s); i++)
+                n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+            return n
+        }
+        # Output and input section records: name, address and size may be split over two lines.
+        function record(sec, addr, size, file)
+        {
+            if(sec ~ /^\./ && hex(addr) >= ram_start)
+            {
+                if(hex(addr) + hex(size) > ram_end) ram_end = hex(addr) + hex(size)
+                out = sec
+                used[sec] += hex(size)
+            }
+            else if(sec ~ /^ \.(data|bss)/ && out ~ /^\.(data|bss)$/ && hex(size) != 0)
+            {
+                sub(/^ \.(data|bss)\.?/, "", sec)
+                sub(/.*\//, "", file)
+                if(sec == "") sec = "-"
+                list[++count] = sprintf("%8d %-6s %-32s %s", hex(size), out, sec, file)
+            }
+        }
+        /^Memory Configuration/ { mem = 1 }
+        mem && $1 == "RAM" { ram_start = hex($2); ram_len = hex($3) }
+        /^Linker script and memory map/ { mem = 0; map = 1; next }
+        !map { next }
+        /^[^ ]/ { out = "" }
+        pending != "" { record(pending, $1, $2, $3); pending = ""; next }
+        /^ ?\.[^ ]+$/ { pending = $0; sub(/ *$/, "", pending); next }
+        /^ ?\.[^ ]+ +0x[0-9a-fA-F]+ +0x[0-9a-fA-F]+/ { sec = $1; if(substr($0, 1, 1) == " ") sec = " " sec; record(sec, $2, $3, $4) }
+        END {
+            if(ram_len == 0) { print name ": no RAM region in map"; exit 1 }
+            if(objects == "objects")
+            {
+                printf "%8s %-6s %-32s %s\n", "size", "output", "object", "file"
+                for(i = 1; i <= count; i++) print list[i] | "sort -rn"
+                close("sort -rn")
+            }
+            printf "%-10s RAM %d of %d: data %d bss %d heap %d stack %d, %d free\n", name, ram_end - ram_start, ram_len,
+                used[".data"], used[".bss"], used[".heap"], used[".stack_dummy"], ram_len - (ram_end - ram_start)
+            exit (ram_end - ram_start > ram_len)
+        }' $tmp_dir/$1/$image.map
+}
+
+build_variant nolog 0 ""
+base_dec=$($objsize -B $tmp_dir/nolog/$image | awk 'NR == 2 { print $4 }')
+
+printf "%-10s %8s %8s %8s %8s %8s\n" variant text data bss dec delta
+print_variant nolog
+
+for floor in $floors; do
+    build_variant floor$floor $floor "-DSEGGER_RTT_LOG"
+    print_variant floor$floor
+done
+
+echo
+fits=0
+print_ram nolog objects || fits=1
+for floor in $floors; do
+    print_ram floor$floor || fits=1
+done
+exit $fits
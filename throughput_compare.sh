@@ -0,0 +1,87 @@
+#!/bin/sh
+# Builds the host benchmark once without logs and once for every log level floor,
+# with RTT up-buffer of the firmware, runs it and prints throughput and CPU cost
+# of each scenario next to the difference against the build without logs. Used by
+# "ninja throughput_compare", JSON results are kept in throughput_compare/.
+#
+# usage: throughput_compare.sh <ninja file> [floors] [scenario filter]
+
+ninja_file=$1
+floors=${2:-"0 1 2 3 4"}
+filter=$3
+tmp_dir=throughput_compare
+
+mkdir -p $tmp_dir
+
+# Build and run one variant in its own build directory.
+# $1 variant name, $2 log floor, $3 log defines
+run_variant()
+{
+    sed -e "s|^host_builddir = .*|host_builddir = $tmp_dir/$1|" \
+        -e "s|^log_level_floor = .*|log_level_floor = $2|" \
+        -e "s|^host_log_defines = .*|host_log_defines = $3|" \
+        $ninja_file > $tmp_dir/$1.ninja
+    ninja -f $tmp_dir/$1.ninja $tmp_dir/$1/host_bench > $tmp_dir/$1.log 2>&1 || { cat $tmp_dir/$1.log; exit 1; }
+    $tmp_dir/$1/host_bench $filter > $tmp_dir/$1.json 2> $tmp_dir/$1.err || { tail -n 40 $tmp_dir/$1.err; exit 1; }
+}
+
+# Print metrics of one variant, one line per scenario.
+# $1 variant name
+print_variant()
+{
+    awk -v name=$1 -v base_file=$tmp_dir/nolog.json '
+        function parse(file, into,    line, key, scenario)
+        {
+            while((getline line < file) > 0)
+            {
+                if(match(line, /"[a-z0-9_]+": /) == 0)
+                {
+                    continue;
+                }
+                key  = substr(line, RSTART + 1, RLENGTH - 4);
+                line = substr(line, RSTART + RLENGTH);
+                gsub(/[",]/, "", line);
+                if(key == "name")
+                {
+                    scenario = line;
+                    order[++count] = scenario;
+                }
+                else if(scenario != "")
+                {
+                    into[scenario, key] = line;
+                }
+            }
+            close(file);
+        }
+        function delta(scenario, key)
+        {
+            if(base[scenario, key] == 0)
+            {
+                return 0;
+            }
+            return 100 * (run[scenario, key] - base[scenario, key]) / base[scenario, key];
+        }
+        BEGIN {
+            parse(base_file, base);
+            count = 0;
+            parse(ARGV[1], run);
+            for(i = 1; i <= count; i++)
+            {
+                s = order[i];
+                printf "%-10s %-22s %8.2f %8.2f %9d %6d %10.0f %+6.1f%% %10.0f %+6.1f%%\n", name, s,
+                       run[s, "frames_per_s"], run[s, "data_frames_per_s"], run[s, "latency_p99_us"],
+                       run[s, "log_dropped"], run[s, "cpu_ns_per_sd_event"], delta(s, "cpu_ns_per_sd_event"),
+                       run[s, "cpu_ns_per_wakeup"], delta(s, "cpu_ns_per_wakeup");
+            }
+        }' $tmp_dir/$1.json
+}
+
+run_variant nolog 0 ""
+
+printf "%-10s %-22s %8s %8s %9s %6s %10s %7s %10s %7s\n" variant scenario frames/s data/s p99_us logdrop ns/event delta ns/wakeup delta
+print_variant nolog
+
+for floor in $floors; do
+    run_variant floor$floor $floor "-DSEGGER_RTT_LOG"
+    print_variant floor$floor
+done
@@ -1,11 +1,72 @@
 #include "debug.h"
 
+#if defined ENABLE_DEBUG_LOG_SUPPORT || defined SEGGER_RTT_LOG
+
+uint8_t debug_module_level[DEBUG_MODULE_COUNT] =
+{
+    [0 ... (DEBUG_MODULE_COUNT - 1)] = DEBUG_LOG_LEVEL_DEFAULT
+};
+
+static uint32_t debug_dropped = 0;
+
+/**@brief Set runtime log level of module.
+ *
+ * @param module  Module index or DEBUG_MODULE_ALL.
+ * @param level   New level. Levels above DEBUG_LOG_LEVEL_FLOOR are accepted, but have no effect.
+ *
+ * @return  false if module or level is invalid, otherwise true.
+ */
+
+bool debug_set_level(uint8_t module, uint8_t level)
+{
+    uint8_t cnt;
+
+    if (level > DEBUG_LEVEL_VERBOSE)
+    {
+        return false;
+    }
+
+    if (module == DEBUG_MODULE_ALL)
+    {
+        for (cnt = 0; cnt < DEBUG_MODULE_COUNT; cnt++)
+        {
+            debug_module_level[cnt] = level;
+        }
+        return true;
+    }
+
+    if (module >= DEBUG_MODULE_COUNT)
+    {
+        return false;
+    }
+
+    debug_module_level[module] = level;
+    return true;
+}
+
+/**@brief Get number of log messages dropped since reset.
+ *
+ * @return  Number of dropped messages.
+ */
+
+uint32_t debug_get_dropped(void)
+{
+    return debug_dropped;
+}
+
+#endif
+
 #if defined SEGGER_RTT_LOG
 #include <stdarg.h>
 #include "SEGGER_RTT.h"
 
+#define DEBUG_CMD_SIZE 3
+
 extern int SEGGER_RTT_vprintf(unsigned BufferIndex, const char * sFormat, va_list * pParamList);
 
+static char    debug_cmd[DEBUG_CMD_SIZE];
+static uint8_t debug_cmd_len = 0;
+
 int RTT_printf(const char * sFormat, ...) {
   int r;
   va_list ParamList;
@@ -13,6 +74,11 @@ int RTT_printf(const char * sFormat, ...) {
   va_start(ParamList, sFormat);
   r = SEGGER_RTT_vprintf(0, sFormat, &ParamList);
   va_end(ParamList);
+
+  // In NO_BLOCK_SKIP mode message which does not fit into up-buffer is dropped.
+  if (r < 0) {
+    debug_dropped++;
+  }
   return r;
 }
 
@@ -20,4 +86,34 @@ void debug_init(void)
 {
     SEGGER_RTT_ConfigUpBuffer(0, NULL, NULL, 0, SEGGER_RTT_MODE_NO_BLOCK_SKIP);
 }
+
+void debug_poll(void)
+{
+    char c;
+
+    while (SEGGER_RTT_Read(0, &c, 1) == 1)
+    {
+        if (c == 'L')
+        {
+            debug_cmd_len = 0;
+        }
+        else if (debug_cmd_len == 0)
+        {
+            continue;
+        }
+
+        debug_cmd[debug_cmd_len++] = c;
+
+        if (debug_cmd_len == DEBUG_CMD_SIZE)
+        {
+            uint8_t module = (debug_cmd[1] == '*') ? DEBUG_MODULE_ALL : (uint8_t)(debug_cmd[1] - '0');
+
+            if (debug_set_level(module, (uint8_t)(debug_cmd[2] - '0')))
+            {
+                RTT_printf("[DBG]: Module %c level %c\r\n", debug_cmd[1], debug_cmd[2]);
+            }
+            debug_cmd_len = 0;
+        }
+    }
+}
 #endif
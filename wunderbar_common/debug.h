@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 /**
  * @defgroup debug_logger Debug Logger
@@ -12,6 +13,39 @@
  * @details Enables debug logs/ trace over UART. Tracing is enabled only if
  *          ENABLE_DEBUG_LOG_SUPPORT is defined in the project.
  */
+
+/**@brief Log levels. Lower value means more important message. */
+#define DEBUG_LEVEL_NONE    0
+#define DEBUG_LEVEL_ERROR   1
+#define DEBUG_LEVEL_WARNING 2
+#define DEBUG_LEVEL_INFO    3
+#define DEBUG_LEVEL_VERBOSE 4
+
+/**@brief Compile-time floor. Messages with level above floor are removed by the compiler. */
+#ifndef DEBUG_LOG_LEVEL_FLOOR
+    #define DEBUG_LOG_LEVEL_FLOOR DEBUG_LEVEL_INFO
+#endif
+
+/**@brief Level every module starts with after reset. */
+#ifndef DEBUG_LOG_LEVEL_DEFAULT
+    #define DEBUG_LOG_LEVEL_DEFAULT DEBUG_LOG_LEVEL_FLOOR
+#endif
+
+/**@brief Modules which can be filtered independently. */
+typedef enum
+{
+    DEBUG_MODULE_AP = 0,    /**< Application, main.c ("[AP]", "[DM]"). */
+    DEBUG_MODULE_CL,        /**< Client handling ("[CL]"). */
+    DEBUG_MODULE_OB,        /**< Onboarding ("[OB]"). */
+    DEBUG_MODULE_PS,        /**< Persistent storage driver ("[PS]"). */
+    DEBUG_MODULE_DB,        /**< Database discovery ("[DB]"). */
+    DEBUG_MODULE_SPI,       /**< SPI slave ("[SP]"). */
+    DEBUG_MODULE_COUNT
+}
+debug_module_t;
+
+#define DEBUG_MODULE_ALL 0xFF   /**< Module selector used to set level of all modules at once. */
+
 #if defined ENABLE_DEBUG_LOG_SUPPORT
     /**
     * @brief Module Initialization.
@@ -29,6 +63,7 @@
     */
     #define debug_log printf
     void debug_dump(uint8_t * str, uint32_t len);
+    #define debug_poll(...)
 
 #elif defined SEGGER_RTT_LOG
     void debug_init(void);
@@ -36,12 +71,46 @@
     #define debug_log RTT_printf
     #define debug_dump(...)
 
+    /**
+    * @brief Poll RTT down-buffer for log level commands.
+    *
+    * @details Command is three characters: 'L', module digit (or '*' for all modules) and level digit.
+    */
+    void debug_poll(void);
+
 #else
     #define debug_init(...)
     #define debug_log(...)
     #define debug_dump(...)
+    #define debug_poll(...)
 #endif // ENABLE_DEBUG_LOG_SUPPORT
 
+#if defined ENABLE_DEBUG_LOG_SUPPORT || defined SEGGER_RTT_LOG
+    extern uint8_t  debug_module_level[DEBUG_MODULE_COUNT];
+
+    /**
+    * @brief Log message of given module and level.
+    *
+    * @details Level is compared against compile-time floor first, so calls above floor
+    *          generate no code. Remaining calls are filtered by runtime level of the module.
+    */
+    #define debug_log_module(module, level, ...)                                          \
+        do                                                                                \
+        {                                                                                 \
+            if (((level) <= DEBUG_LOG_LEVEL_FLOOR) && ((level) <= debug_module_level[(module)])) \
+            {                                                                             \
+                debug_log(__VA_ARGS__);                                                   \
+            }                                                                             \
+        } while (0)
+
+    bool     debug_set_level(uint8_t module, uint8_t level);
+    uint32_t debug_get_dropped(void);
+#else
+    #define debug_log_module(...)
+    #define debug_set_level(module, level) (false)
+    #define debug_get_dropped()            (0)
+#endif
+
 /** @} */
 
 #endif //__DEBUG_H_
@@ -19,164 +19,124 @@ extern const uint16_t SENSOR_CHAR_UUIDS[NUMBER_OF_RELAYR_CHARACTERISTICS + 4];
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief This function returns size of threshold characteristic for specific sensor.
- *
- * @param sens_id    Sensor ID.
- *
- * @return    Size of threshold characteristic.
- *
- */
+/**@brief Tables and checks generated from SENSOR_SCHEMA. */
 
-static uint8_t sensors_get_threshold_size(data_id_t sens_id)
-{
-    switch (sens_id)
-    {
-    case DATA_ID_DEV_HTU :
-        return (sizeof(sensor_htu_threshold_t));
-
-    case DATA_ID_DEV_GYRO :
-        return (sizeof(sensor_gyro_threshold_t));
+#define SENSOR_SCHEMA_INDEX(data_id, name, fields, threshold_size, config_size, data_size)  SENSOR_SCHEMA_INDEX_##data_id,
 
-    case DATA_ID_DEV_LIGHT :
-        return (sizeof(sensor_lightprox_threshold_t));
-
-    case DATA_ID_DEV_SOUND :
-        return (sizeof(sensor_microphone_threshold_t));
+enum
+{
+    SENSOR_SCHEMA(SENSOR_SCHEMA_INDEX)
+    SENSOR_SCHEMA_COUNT
+};
+
+#define SENSOR_SCHEMA_CHECK(data_id, name, fields, threshold_size, config_size, data_size)                       \
+    _Static_assert((int)SENSOR_SCHEMA_INDEX_##data_id == (int)(data_id), "Sensor schema entry out of order: " #data_id);  \
+    _Static_assert(sizeof(name) <= (BLE_DEVNAME_MAX_LEN + 1), "Device name too long: " #data_id);              \
+    _Static_assert((threshold_size) <= SPI_PACKET_DATA_SIZE, "Threshold does not fit SPI frame: " #data_id);   \
+    _Static_assert((config_size) <= SPI_PACKET_DATA_SIZE, "Config does not fit SPI frame: " #data_id);         \
+    _Static_assert((data_size) <= SPI_PACKET_DATA_SIZE, "Data does not fit SPI frame: " #data_id);             \
+    _Static_assert(((threshold_size) != 0) == (((fields) & SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_THRESHOLD)) != 0), \
+                   "Threshold size does not match fields: " #data_id);                                        \
+    _Static_assert(((config_size) != 0) == (((fields) & SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_CONFIG)) != 0),       \
+                   "Config size does not match fields: " #data_id);
+
+SENSOR_SCHEMA(SENSOR_SCHEMA_CHECK)
+
+_Static_assert(SENSOR_SCHEMA_COUNT == MAX_CLIENTS, "Sensor schema does not cover all clients");
+_Static_assert(sizeof(sensorID_t) <= SPI_PACKET_DATA_SIZE, "Sensor ID does not fit SPI frame");
+_Static_assert(FIELD_ID_SENSOR_STATUS < 16, "Field mask does not fit uint16_t");
+
+#define SENSOR_SCHEMA_FIELDS(data_id, name, fields, threshold_size, config_size, data_size)                      \
+    [data_id] = (fields),
+
+#define SENSOR_SCHEMA_MSG_SIZES(data_id, name, fields, threshold_size, config_size, data_size)                   \
+    [data_id] =                                                                                                 \
+    {                                                                                                           \
+        [FIELD_ID_CHAR_SENSOR_ID]               = sizeof(sensorID_t),                                           \
+        [FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY] = sizeof(beaconFrequency_t),                                    \
+        [FIELD_ID_CHAR_SENSOR_FREQUENCY]        = sizeof(frequency_t),                                          \
+        [FIELD_ID_CHAR_SENSOR_LED_STATE]        = sizeof(led_state_t),                                          \
+        [FIELD_ID_CHAR_SENSOR_THRESHOLD]        = (threshold_size),                                             \
+        [FIELD_ID_CHAR_SENSOR_CONFIG]           = (config_size),                                                \
+        [FIELD_ID_CHAR_SENSOR_DATA_R]           = (data_size),                                                  \
+        [FIELD_ID_CHAR_SENSOR_DATA_W]           = (data_size),                                                  \
+        [FIELD_ID_CHAR_BATTERY_LEVEL]           = 1,                                                            \
+        [FIELD_ID_CHAR_MANUFACTURER_NAME]       = SPI_PACKET_DATA_SIZE,                                         \
+        [FIELD_ID_CHAR_HARDWARE_REVISION]       = SPI_PACKET_DATA_SIZE,                                         \
+        [FIELD_ID_CHAR_FIRMWARE_REVISION]       = SPI_PACKET_DATA_SIZE,                                         \
+        [FIELD_ID_SENSOR_STATUS]                = sizeof(sensorID_t),                                           \
+    },
+
+/**@brief Fields present at each sensor, bit n for field ID n. */
+static const uint16_t SENSOR_FIELDS[SENSOR_SCHEMA_COUNT] =
+{
+    SENSOR_SCHEMA(SENSOR_SCHEMA_FIELDS)
+};
 
-    case DATA_ID_DEV_BRIDGE :
-    case DATA_ID_DEV_IR :
-    default :
-        return 0;
-    }
-}
+/**@brief Message size of each field of each sensor. */
+static const uint8_t SENSOR_MSG_SIZE[SENSOR_SCHEMA_COUNT][FIELD_ID_SENSOR_STATUS + 1] =
+{
+    SENSOR_SCHEMA(SENSOR_SCHEMA_MSG_SIZES)
+};
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief This function returns size of config characteristic for specific sensor.
+/**@brief This function returns message size of "msg_type" characteristic for specific sensor.
  *
  * @param sens_id    Sensor ID.
+ * @param msg_type   Message type.
  *
- * @return    Size of config characteristic.
+ * @return    Message size.
  *
  */
 
-static uint8_t sensors_get_config_size(data_id_t sens_id)
+uint8_t sensors_get_msg_size(data_id_t sens_id, field_id_char_index_t msg_type)
 {
-    switch (sens_id)
+    if(
+       ((uint8_t)sens_id >= SENSOR_SCHEMA_COUNT) ||
+       (msg_type > FIELD_ID_SENSOR_STATUS)
+      )
     {
-    case DATA_ID_DEV_HTU :
-        return (sizeof(sensor_htu_config_t));
-
-    case DATA_ID_DEV_GYRO :
-        return (sizeof(sensor_gyro_config_t));
-
-    case DATA_ID_DEV_LIGHT :
-        return (sizeof(sensor_lightprox_config_t));
-
-    case DATA_ID_DEV_BRIDGE :
-        return (sizeof(sensor_bridge_config_t));
-
-    case DATA_ID_DEV_SOUND :
-    case DATA_ID_DEV_IR :
-    default :
         return 0;
     }
+
+    return SENSOR_MSG_SIZE[sens_id][msg_type];
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief This function returns size of data characteristic for specific sensor.
+/**@brief This function checks if sensor has given field and if the field supports the operation.
  *
- * @param sens_id    Sensor ID.
+ * @param data_id    Sensor ID.
+ * @param field_id   Field ID of characteristic.
+ * @param operation  OPERATION_WRITE or OPERATION_READ.
  *
- * @return    Size of data characteristic.
+ * @return    true if operation on the field is valid, false otherwise.
  *
  */
 
-static uint8_t sensors_get_data_size(data_id_t sens_id)
+bool sensor_field_is_valid(data_id_t data_id, uint8_t field_id, uint8_t operation)
 {
-    switch (sens_id)
+    if(
+       ((uint8_t)data_id >= SENSOR_SCHEMA_COUNT) ||
+       (field_id >= FIELD_ID_SENSOR_STATUS) ||
+       ((SENSOR_FIELDS[data_id] & SENSOR_FIELD(field_id)) == 0)
+      )
     {
-    case DATA_ID_DEV_HTU :
-        return (sizeof(sensor_htu_data_t));
-
-    case DATA_ID_DEV_GYRO :
-        return (sizeof(sensor_gyro_data_t));
-
-    case DATA_ID_DEV_LIGHT :
-        return (sizeof(sensor_lightprox_data_t));
-
-    case DATA_ID_DEV_SOUND :
-        return (sizeof(sensor_microphone_data_t));
-
-    case DATA_ID_DEV_BRIDGE :
-        return (sizeof(sensor_bridge_data_t));
-
-    case DATA_ID_DEV_IR :
-        return (sizeof(uint8_t));
-
-    default :
-        return 0;
+        return false;
     }
-}
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-/**@brief This function returns message size of "msg_type" characteristic for specific sensor.
- *
- * @param sens_id    Sensor ID.
- * @param msg_type   Message type.
- *
- * @return    Message size.
- *
- */
 
-uint8_t sensors_get_msg_size(data_id_t sens_id, field_id_char_index_t msg_type)
-{
-    switch (msg_type)
+    if(
+       (operation == OPERATION_WRITE) &&
+       ((SENSOR_FIELDS_WRITABLE & SENSOR_FIELD(field_id)) == 0)
+      )
     {
-
-    case FIELD_ID_CHAR_SENSOR_ID:
-        return (sizeof(sensorID_t));
-
-    case FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY:
-        return (sizeof(beaconFrequency_t));
-
-    case FIELD_ID_CHAR_SENSOR_FREQUENCY:
-        return (sizeof(frequency_t));
-
-    case FIELD_ID_CHAR_SENSOR_LED_STATE:
-        return (sizeof(led_state_t));
-
-    case FIELD_ID_CHAR_SENSOR_THRESHOLD:
-        return (sensors_get_threshold_size(sens_id));
-
-    case FIELD_ID_CHAR_SENSOR_CONFIG:
-        return (sensors_get_config_size(sens_id));
-
-    case FIELD_ID_CHAR_SENSOR_DATA_R:
-        return (sensors_get_data_size(sens_id));
-
-    case FIELD_ID_CHAR_SENSOR_DATA_W:
-        return (sensors_get_data_size(sens_id));
-
-    case FIELD_ID_CHAR_BATTERY_LEVEL:
-        return (1);
-
-    case FIELD_ID_SENSOR_STATUS :
-        return (16);
-
-    case FIELD_ID_CHAR_MANUFACTURER_NAME :
-    case FIELD_ID_CHAR_HARDWARE_REVISION :
-    case FIELD_ID_CHAR_FIRMWARE_REVISION :
-        return SPI_PACKET_DATA_SIZE;
-
-    default :
-        return 0;
+        return false;
     }
+
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -228,3 +188,33 @@ uint8_t sensor_get_char_index(uint16_t char_uuid)
     }
     return 0xFF;
 }
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief This function computes CRC-16/CCITT (polynomial 0x1021), one nibble at a time.
+ *
+ * @param p_data  Data.
+ * @param size    Number of bytes.
+ * @param crc     Initial value, 0xFFFF for new computation.
+ *
+ * @return    CRC of data.
+ *
+ */
+
+uint16_t crc16_ccitt_compute(const uint8_t * p_data, uint16_t size, uint16_t crc)
+{
+    static const uint16_t CRC16_CCITT_NIBBLE[16] =
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+
+    while(size--)
+    {
+        crc = (uint16_t)(crc << 4) ^ CRC16_CCITT_NIBBLE[(crc >> 12) ^ (*p_data >> 4)];
+        crc = (uint16_t)(crc << 4) ^ CRC16_CCITT_NIBBLE[(crc >> 12) ^ (*p_data & 0x0F)];
+        p_data++;
+    }
+    return crc;
+}
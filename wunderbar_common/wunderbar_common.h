@@ -16,6 +16,7 @@
 
 
 #define SUPERVISION_TIMEOUT_MS           3000
+#define APP_TIMER_PRESCALER              0                                                     /**< Value of the RTC1 PRESCALER register, one tick is ~30.5 us. */
 #define BATTERY_LEVEL_MEAS_INTERVAL_MS   30000
 
 #define SLAVE_LATENCY                    5                                                     /**< Determines slave latency in counts of connection events. */
@@ -99,16 +100,9 @@
 /**@brief Max lenght of Device Name. */
 #define BLE_DEVNAME_MAX_LEN         14
 
-/**@brief List of Sensors Device Names. */
-#define LIST_OF_SENSOR_NAMES  {                      \
-                                DEVICE_NAME_HTU,     \
-                                DEVICE_NAME_GYRO,    \
-                                DEVICE_NAME_LIGHT,   \
-                                DEVICE_NAME_MIC,     \
-                                DEVICE_NAME_BRIDGE,  \
-                                DEVICE_NAME_IR,      \
-                                DEVICE_NAME_CFG_APP, \
-                              };
+/**@brief List of Sensors Device Names, generated from SENSOR_SCHEMA. */
+#define SENSOR_SCHEMA_NAME(data_id, name, fields, threshold_size, config_size, data_size)  name,
+#define LIST_OF_SENSOR_NAMES  { SENSOR_SCHEMA(SENSOR_SCHEMA_NAME) };
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -466,6 +460,24 @@ typedef enum
 }
 data_id_t;
 
+/**@brief Sensor instances.
+ *
+ * @details Several sensors of the same type are told apart by instance number, carried in bits 5..4
+ *          of data ID of sensor frames in both directions. Passkey of instance 0 is configured with
+ *          FIELD_ID_CONFIG_<type>_PASS, of further instances with FIELD_ID_CONFIG_INSTANCE_PASS, as
+ *          field IDs with instance bits would clash with other config fields.
+ *          Instance 0 keeps values used for single sensor of each type.
+ */
+#define SENSOR_INSTANCES_MAX         4
+#define DATA_ID_INSTANCE_POS         4
+#define DATA_ID_INSTANCE_MASK        0x30
+#define DATA_ID_TYPE_MASK            0x0F
+#define DATA_ID_INSTANCE(type, inst) ((data_id_t)((type) | ((inst) << DATA_ID_INSTANCE_POS)))
+#define DATA_ID_GET_TYPE(data_id)    ((data_id_t)((data_id) & DATA_ID_TYPE_MASK))
+#define DATA_ID_GET_INSTANCE(data_id) (((data_id) & DATA_ID_INSTANCE_MASK) >> DATA_ID_INSTANCE_POS)
+#define DATA_ID_IS_SENSOR(data_id)   ( (((data_id) & ~(DATA_ID_INSTANCE_MASK | DATA_ID_TYPE_MASK)) == 0) && \
+                                       (DATA_ID_GET_TYPE(data_id) <= DATA_ID_DEV_IR) )
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 typedef enum
@@ -506,6 +518,15 @@ typedef enum
     FIELD_ID_ONBOARD_DONE                    = 0x21,
     FIELD_ID_KILL                            = 0x22,
     FIELD_ID_SENSOR_WRITE_OK                 = 0x23,
+    FIELD_ID_LOG_LEVEL                       = 0x24,
+    FIELD_ID_STATS                           = 0x25,
+    FIELD_ID_LINK                            = 0x26,
+    FIELD_ID_TIME_SYNC                       = 0x27,
+    FIELD_ID_ROTATION                        = 0x28,
+    FIELD_ID_ADV_INGEST                      = 0x29,
+    FIELD_ID_INVENTORY                       = 0x2A,
+    FIELD_ID_OPEN_COMM                       = 0x2B,
+    FIELD_ID_CONFIG_INSTANCE_PASS            = 0x2C,
 
     INVALID                                  = 0xFF
 }
@@ -518,6 +539,8 @@ typedef enum
     // used for data transfers to/from sensors
     OPERATION_WRITE = 0x0,
     OPERATION_READ  = 0x1,
+    // version 1 frames only, data[0..1] - maximum age of cached value in ms
+    OPERATION_READ_CACHED = 0x2,
 
     // It is used in this manner for FIELD_ID_SENSOR_STATUS, so let's have it explicitly
     CONNECTION_OPENED = 0x0,
@@ -527,6 +550,35 @@ typedef enum
 }
 operation_t;
 
+/**@brief Versioned operation byte.
+ *
+ * @details Bit 7 set marks version 1 frame, bits 6..2 carry payload length and bits 1..0 carry
+ *          operation. Frames with bit 7 cleared are decoded as before, with payload length taken
+ *          from the sensor schema. NOT_USED (0xFF) is never decoded as version 1 operation.
+ */
+#define OPERATION_V1_FLAG            0x80
+#define OPERATION_V1_LEN_POS         2
+#define OPERATION_V1_LEN_MASK        0x7C
+#define OPERATION_V1_OP_MASK         0x03
+#define OPERATION_V1(op, len)        (OPERATION_V1_FLAG | ((len) << OPERATION_V1_LEN_POS) | (op))
+
+/**@brief Error codes sent in field_id of DATA_ID_RESPONSE_ERROR frame, as answer to version 1 frames.
+ *        data[0] and data[1] carry data_id and field_id of rejected frame.
+ */
+typedef enum
+{
+    RESPONSE_ERROR_NONE             = 0x0,    /**< No error, never sent. */
+    RESPONSE_ERROR_FRAME            = 0x1,    /**< Frame shorter than its header or declared payload. */
+    RESPONSE_ERROR_DATA_ID          = 0x2,    /**< Unknown data_id. */
+    RESPONSE_ERROR_FIELD_ID         = 0x3,    /**< Field not present at the sensor or unknown config field. */
+    RESPONSE_ERROR_OPERATION        = 0x4,    /**< Operation not supported by the field. */
+    RESPONSE_ERROR_LENGTH           = 0x5,    /**< Payload length does not match the field. */
+    RESPONSE_ERROR_VALUE            = 0x6,    /**< Payload value out of range. */
+    RESPONSE_ERROR_NOT_IDLE         = 0x7,    /**< Sensor commands are not accepted during onboarding. */
+    RESPONSE_ERROR_REJECTED         = 0x8,    /**< Command could not be passed to the sensor. */
+}
+response_error_t;
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #define SPI_PACKET_DATA_SIZE 20
@@ -540,12 +592,125 @@ typedef struct
 }
 __attribute__((packed)) spi_frame_t;
 
+/**@brief SPI link layer.
+ *
+ * @details Optional, disabled after reset. Central advertises SPI_LINK_CAPABILITY in last data byte of
+ *          DATA_ID_DEV_CENTRAL firmware revision frame, host enables it with FIELD_ID_LINK config command.
+ *          Once enabled, every frame in both directions (also frames without data, DATA_ID_ERROR) is
+ *          followed by trailer:
+ *          - seq:   sequence number of frame carrying data, 1..255. Retransmitted frame keeps its number.
+ *          - ack:   sequence number of last valid data frame received from other side (cumulative ACK).
+ *          - flags: SPI_LINK_FLAG_NAK if frame of previous transaction failed CRC check, bits 7..4
+ *                   carry sync_id of time sync frame the stamp is relative to.
+ *          - stamp: time the frame was created at master (sensor data: time of notification), relative
+ *                   to time sync frame, 0xFFFF if none. Stamping is enabled with FIELD_ID_TIME_SYNC.
+ *          - crc:   CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF) of frame, seq, ack and flags.
+ *          Frame which is not acknowledged in next transaction is sent again, up to SPI_LINK_MAX_RETRIES times.
+ */
+#define SPI_LINK_CAPABILITY          0x02    /**< Link layer version, also value of FIELD_ID_LINK payload enabling it. Version 2 added stamp. */
+#define SPI_LINK_FLAG_NAK            0x01
+#define SPI_LINK_FLAG_SYNC_POS       4
+#define SPI_LINK_FLAG_SYNC_MASK      0xF0
+#define SPI_LINK_MAX_RETRIES         3
+
+typedef struct
+{
+    uint8_t     seq;
+    uint8_t     ack;
+    uint8_t     flags;
+    uint16_t    stamp;
+    uint16_t    crc;
+}
+__attribute__((packed)) spi_link_trailer_t;
+
+typedef struct
+{
+    spi_frame_t         frame;
+    spi_link_trailer_t  link;
+}
+__attribute__((packed)) spi_link_frame_t;
+
+/**@brief Sensor data in advertising packets.
+ *
+ * @details Sensor may carry its data in manufacturer specific AD field, so that the master forwards it
+ *          without connection. Field content is:
+ *          - company ID, little endian, ADV_DATA_COMPANY_ID,
+ *          - sequence number, changed by sensor with every new value, repeated packets carry the same one,
+ *          - value of FIELD_ID_CHAR_SENSOR_DATA_R of the sensor type, in the same format and size.
+ *          Advertising packets are not authenticated, so the host enables ingest per sensor with
+ *          FIELD_ID_ADV_INGEST config command. Flags, Relayr service UUID and complete name shall be
+ *          in the same legacy packet, so types whose value does not fit (GYRO, LIGHT, BRIDGE) are
+ *          rejected with RESPONSE_ERROR_VALUE. Instance of sensor which is not bound forwards values
+ *          of the first sensor of its type it received value from.
+ */
+#define ADV_DATA_COMPANY_ID          0xFFFF  /**< Company ID reserved for internal use. */
+#define ADV_DATA_HEADER_SIZE         3       /**< Company ID and sequence number. */
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/**@brief Sensor schema.
+ *
+ * @details Single description of all sensors, one entry per data ID in data ID order:
+ *          X(data_id, device name, fields present, threshold size, config size, data size)
+ *          Name list, field and message size tables and their compile-time checks are
+ *          generated from it. Size 0 means that the sensor has no such characteristic.
+ */
+
+#define SENSOR_FIELD(field_id)        (1 << (field_id))
+
+/**@brief Fields present at every sensor. */
+#define SENSOR_FIELDS_COMMON          ( SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_ID)               | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY) | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_LED_STATE)        | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_BATTERY_LEVEL)           | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_MANUFACTURER_NAME)       | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_HARDWARE_REVISION)       | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_FIRMWARE_REVISION) )
+
+/**@brief Fields present at sensors which measure data periodically. */
+#define SENSOR_FIELDS_MEASURING       ( SENSOR_FIELDS_COMMON                                | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_FREQUENCY)        | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_THRESHOLD)        | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_DATA_R) )
+
+/**@brief Fields which can be written by the host. */
+#define SENSOR_FIELDS_WRITABLE        ( SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_BEACON_FREQUENCY) | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_FREQUENCY)        | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_LED_STATE)        | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_THRESHOLD)        | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_CONFIG)           | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_DATA_W) )
+
+/**@brief Fields which are sent by sensors as notifications. */
+#define SENSOR_FIELDS_NOTIFY          ( SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_DATA_R)           | \
+                                        SENSOR_FIELD(FIELD_ID_CHAR_BATTERY_LEVEL) )
+
+#define SENSOR_SCHEMA(X)                                                                                                        \
+    X(DATA_ID_DEV_HTU,     DEVICE_NAME_HTU,     SENSOR_FIELDS_MEASURING | SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_CONFIG),             \
+      sizeof(sensor_htu_threshold_t),        sizeof(sensor_htu_config_t),       sizeof(sensor_htu_data_t))                      \
+    X(DATA_ID_DEV_GYRO,    DEVICE_NAME_GYRO,    SENSOR_FIELDS_MEASURING | SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_CONFIG),             \
+      sizeof(sensor_gyro_threshold_t),       sizeof(sensor_gyro_config_t),      sizeof(sensor_gyro_data_t))                     \
+    X(DATA_ID_DEV_LIGHT,   DEVICE_NAME_LIGHT,   SENSOR_FIELDS_MEASURING | SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_CONFIG),             \
+      sizeof(sensor_lightprox_threshold_t),  sizeof(sensor_lightprox_config_t), sizeof(sensor_lightprox_data_t))                \
+    X(DATA_ID_DEV_SOUND,   DEVICE_NAME_MIC,     SENSOR_FIELDS_MEASURING,                                                        \
+      sizeof(sensor_microphone_threshold_t), 0,                                 sizeof(sensor_microphone_data_t))               \
+    X(DATA_ID_DEV_BRIDGE,  DEVICE_NAME_BRIDGE,  SENSOR_FIELDS_COMMON | SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_CONFIG) |              \
+                                                SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_DATA_R) | SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_DATA_W), \
+      0,                                     sizeof(sensor_bridge_config_t),    sizeof(sensor_bridge_data_t))                   \
+    X(DATA_ID_DEV_IR,      DEVICE_NAME_IR,      SENSOR_FIELDS_COMMON | SENSOR_FIELD(FIELD_ID_CHAR_SENSOR_DATA_W),               \
+      0,                                     0,                                 sizeof(sensor_ir_data_t))                       \
+    X(DATA_ID_DEV_CFG_APP, DEVICE_NAME_CFG_APP, 0,                                                                              \
+      0,                                     0,                                 0)
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 uint8_t sensors_get_msg_size(data_id_t sens_name, field_id_char_index_t msg_type);
+bool    sensor_field_is_valid(data_id_t data_id, uint8_t field_id, uint8_t operation);
 uint8_t sensor_get_char_index(uint16_t char_uuid);
+uint16_t crc16_ccitt_compute(const uint8_t * p_data, uint16_t size, uint16_t crc);
 uint8_t sensor_get_name_index(const uint8_t * device_name);
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////